@@ -0,0 +1,164 @@
+/**
+  \file G3D/AABoxTree.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+ */
+
+#ifndef G3D_AABoxTree_h
+#define G3D_AABoxTree_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/AABox.h"
+#include "G3D/Vector2int32.h"
+#include <functional>
+
+namespace G3D {
+
+class Ray;
+class Sphere;
+
+/**
+ \brief Bounding volume hierarchy over an array of axis-aligned boxes
+ that can be refit in linear time when the boxes move.
+
+ The tree stores indices into the caller's array rather than the
+ objects themselves, so one tree can index entities, rigid bodies,
+ or any other objects with bounds.  Build it with setContents() when
+ objects are added or removed, and call refit() after they move.
+ refit() updates the node bounds bottom-up and rebuilds the tree only
+ when the motion has degraded it past Settings::refitRebuildThreshold.
+
+ Unlike G3D::KDTree, which splits space with planes and must remove
+ and reinsert moving members, the nodes of an AABoxTree overlap and
+ simply grow or shrink to follow their members.
+
+ Every box must be non-empty and finite.
+
+ Example:
+ \code
+ Array<AABox> boundsArray;
+ ...
+ AABoxTree tree;
+ tree.setContents(boundsArray);
+
+ float distance = finf();
+ int closest = -1;
+ tree.intersectRay(ray, distance, [&](int index, float& distance) {
+     if (object[index]->intersect(ray, distance)) {
+         closest = index;
+     }
+ });
+ \endcode
+
+ \sa KDTree, TriTree
+*/
+class AABoxTree {
+public:
+
+    class Settings {
+    public:
+        /** Subtrees with at most this many members become leaves */
+        int         valuesPerLeaf;
+
+        /** refit() rebuilds the tree when its estimated ray query cost
+            under the surface area heuristic has grown to more than
+            this multiple of its cost when it was built. */
+        float       refitRebuildThreshold;
+
+        Settings() : valuesPerLeaf(2), refitRebuildThreshold(2.0f) {}
+    };
+
+    /** Invoked on a member whose box a ray hit closer than \a distance.
+        The function may reduce \a distance to cull farther members. */
+    typedef std::function<void (int index, float& distance)> RayCallback;
+
+private:
+
+    class Node {
+    public:
+        AABox       bounds;
+
+        /** If count > 0, this is a leaf whose members are
+            m_value[first...first + count - 1].  Otherwise, the
+            children are m_node[first] and m_node[first + 1]. */
+        int         first;
+        int         count;
+    };
+
+    Settings        m_settings;
+
+    /** Every node precedes its children. Element 0 is the root. */
+    Array<Node>     m_node;
+
+    /** Member indices, grouped by leaf */
+    Array<int>      m_value;
+
+    /** Bounds of each member, indexed by member index */
+    Array<AABox>    m_bounds;
+
+    /** SAH cost at the last build, relative to the root area */
+    float           m_buildCost;
+
+    /** Fills m_node[index] with a subtree over m_value[begin...end - 1] */
+    void build(int index, int begin, int end, const Array<Point3>& centroid);
+
+    /** SAH cost of the whole tree relative to the root area */
+    float computeCost() const;
+
+    /** Appends the intersecting pairs of members within the subtree at m_node[a] */
+    void intersectSelf(int a, Array<Vector2int32>& pairs) const;
+
+    /** Appends the intersecting pairs with one member under m_node[a] and the other under m_node[b] */
+    void intersectNodes(int a, int b, Array<Vector2int32>& pairs) const;
+
+public:
+
+    AABoxTree() : m_buildCost(0.0f) {}
+
+    /** Builds the tree over boxes <code>boundsArray[0...size() - 1]</code>,
+        discarding the previous contents. */
+    void setContents(const Array<AABox>& boundsArray, const Settings& settings = Settings());
+
+    /** Updates the tree after the boxes have moved.  The array must
+        be the same size as the one passed to setContents.
+
+        \return true if the tree was rebuilt */
+    bool refit(const Array<AABox>& boundsArray);
+
+    void clear();
+
+    /** Number of members */
+    int size() const {
+        return m_bounds.size();
+    }
+
+    /** Bounds of member \a index as of the last setContents or refit */
+    const AABox& bounds(int index) const {
+        return m_bounds[index];
+    }
+
+    /** Invokes \a callback on every member whose box \a ray hits closer
+        than \a distance, visiting nearer parts of the tree first so
+        that callbacks which reduce \a distance cull the remainder. */
+    void intersectRay(const Ray& ray, float& distance, const RayCallback& callback) const;
+
+    /** Appends the indices of all members whose boxes intersect \a box */
+    void getIntersectingMembers(const AABox& box, Array<int>& members) const;
+
+    /** Appends the indices of all members whose boxes intersect \a sphere */
+    void getIntersectingMembers(const Sphere& sphere, Array<int>& members) const;
+
+    /** Appends every pair of members whose boxes intersect, as (i, j) with i < j,
+        in an order that depends only on the tree.  This traverses the tree against
+        itself, in parallel on the ThreadPool, which is much faster than invoking
+        getIntersectingMembers() for every member. */
+    void getIntersectingPairs(Array<Vector2int32>& pairs) const;
+};
+
+} // namespace G3D
+
+#endif
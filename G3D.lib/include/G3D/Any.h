@@ -5,7 +5,7 @@
  \maintainer Morgan McGuire
   
  \created 2006-06-11
- \edited  2014-11-08
+ \edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -366,6 +366,15 @@ private:
 
     void _parse(const String& src);
 
+    /** Called from speedSerialize().  Appends strings to \a stringArray the first time that they appear. */
+    void speedSerialize(class BinaryOutput& b, Table<String, int>& stringTable, Array<String>& stringArray) const;
+
+    /** Called from speedDeserialize() */
+    void speedDeserialize(class BinaryInput& b, const Array<String>& stringArray);
+
+    /** Called from load() when the parse cache is enabled */
+    void loadThroughParseCache(const String& filename);
+
 public:
 
     /** Thrown by operator[] when a key is not present in a const table. */
@@ -736,6 +745,10 @@ public:
     void clear();
 
     /** Parse from a file.
+
+     If setParseCacheDirectory() has been called, the result may come from the
+     parse cache instead, in which case it has no comments.
+
      \sa deserialize, parse, fromFile, loadIfExists
      */
     void load(const String& filename);
@@ -759,6 +772,31 @@ public:
 
     void deserialize(class BinaryInput& b);
 
+    /** Writes a compact binary representation used by the parse cache.  Strings,
+        names, and table keys are stored once each and referenced by index.
+        Comments are not stored.  NIL, BOOLEAN, and NUMBER values are stored
+        without their source(), unless they have a name or came from an #include.
+
+        Like all SpeedLoad formats, this is only intended for the machine that wrote it.
+        \sa speedDeserialize, setParseCacheDirectory */
+    void speedSerialize(class BinaryOutput& b) const;
+
+    /** Reads the speedSerialize() format.  Values that were stored without a source()
+        do not allocate any shared data, which makes large parsed files such as scenes
+        much smaller in memory. */
+    void speedDeserialize(class BinaryInput& b);
+
+    /** When not empty, load() stores the speedSerialize() form of each file it parses
+        in \a directory, and reads that instead of parsing the text when neither the
+        file nor any of the files that it #includes have changed.  Cache entries are
+        keyed by the MD5 hash of the file contents.
+
+        Default is the empty string, which disables the cache. */
+    static void setParseCacheDirectory(const String& directory);
+
+    /** \copydoc setParseCacheDirectory */
+    static const String& parseCacheDirectory();
+
     const Source& source() const;
 
     /** Removes this key from the Any, which must be a table. */
@@ -4,7 +4,7 @@
  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
  
  \created 2001-08-09
- \edited  2013-01-03
+ \edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -80,6 +80,10 @@ private:
 #endif
     ;
 
+    /** Uncompressed files at least this large are memory mapped instead of
+        read into a heap buffer. Smaller files are cheaper to copy than to map. */
+    static const int64 MEMORY_MAP_MIN_LENGTH = 1024 * 1024;
+
     /**
      is the file big or little endian
      */
@@ -126,6 +130,14 @@ private:
      */
     bool            m_freeBuffer;
 
+    /** When true, m_buffer is a read-only mapping of the entire file
+        that is unmapped in the destructor. */
+    bool            m_memoryMapped;
+
+    /** Maps the whole of \a file into m_buffer. Returns false if the
+        platform refused, in which case the caller should read the file. */
+    bool memoryMap(FILE* file);
+
     /** Ensures that we are able to read at least minLength from startPosition (relative
         to start of file). */
     void loadIntoMemory(int64 startPosition, int64 minLength = 0);
@@ -150,6 +162,12 @@ public:
        If the file cannot be opened, a zero length buffer is presented.
        Automatically opens files that are inside zipfiles.
 
+       Large uncompressed files outside of zipfiles are memory mapped
+       rather than copied, so that getCArray() is available without a
+       copy for files of any size and pages are only read from disk as
+       they are accessed. Modifying or truncating a file while a
+       BinaryInput has it mapped is an error.
+
        @param compressed Set to true if and only if the file was
        compressed using BinaryOutput's zlib compression.  This has
        nothing to do with whether the input is in a zipfile.
@@ -234,9 +252,14 @@ public:
         return m_pos + m_alreadyRead;
     }
 
+    /** True if the file is memory mapped instead of copied into memory. \sa BinaryInput(const String&, G3DEndian, bool) */
+    bool memoryMapped() const {
+        return m_memoryMapped;
+    }
+
     /**
      Returns a pointer to the internal memory buffer.
-     May throw an exception for huge files.
+     May throw an exception for huge files that are not memoryMapped().
      */
     const uint8* getCArray() {
         if (m_alreadyRead > 0 || m_bufferLength < m_length) {
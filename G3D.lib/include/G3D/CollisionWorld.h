@@ -0,0 +1,218 @@
+/**
+  \file G3D/CollisionWorld.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+
+  Copyright 2000-2016, Morgan McGuire.
+  All rights reserved.
+ */
+
+#ifndef G3D_CollisionWorld_h
+#define G3D_CollisionWorld_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/AABox.h"
+#include "G3D/AABoxTree.h"
+#include "G3D/Box.h"
+#include "G3D/Capsule.h"
+#include "G3D/ReferenceCount.h"
+#include "G3D/Sphere.h"
+
+namespace G3D {
+
+/**
+ \brief Finds the pairs of overlapping shapes among many moving Sphere,
+ Box, Capsule, and AABox proxies, and computes their contacts.
+
+ Each frame, move the proxies with set(), call getOverlappingPairs() to
+ run the broadphase, and pass the pairs to getContacts() to run the
+ narrowphase.  This replaces calling the CollisionDetection tests on all
+ O(n^2) pairs of bodies.
+
+ The broadphase is an AABoxTree over the proxies' bounding boxes.  When
+ proxies only move, getOverlappingPairs() refits the tree in linear time
+ and rebuilds it only when motion has degraded it; inserting or removing
+ proxies rebuilds it on the next call.  The pairs are then found by
+ traversing the tree against itself in parallel on the ThreadPool
+ (AABoxTree::getIntersectingPairs).
+
+ The narrowphase dispatches each pair to the CollisionDetection
+ penetration depth test for its shapes, also in parallel.  CollisionDetection
+ has no fixed-capsule tests, so a capsule is replaced by the sphere on its
+ axis that is closest to the other shape and then tested as a Sphere.
+ AABox proxies are tested as Box.
+
+ Proxy IDs are small integers that are reused after remove().  Both
+ outputs are in a deterministic order that does not depend on the number
+ of threads.
+
+ Example:
+ \code
+ shared_ptr<CollisionWorld> world = CollisionWorld::create();
+ for (int i = 0; i < body.size(); ++i) {
+     body[i]->proxy = world->insert(body[i]->sphere());
+ }
+
+ // Every frame
+ for (int i = 0; i < body.size(); ++i) {
+     world->set(body[i]->proxy, body[i]->sphere());
+ }
+ world->getOverlappingPairs(pairArray);
+ world->getContacts(pairArray, contactArray);
+ \endcode
+
+ \sa CollisionDetection, AABoxTree
+ */
+class CollisionWorld : public ReferenceCountedObject {
+public:
+
+    enum ShapeType {SPHERE, BOX, CAPSULE, AABOX};
+
+    /** Two proxies whose bounding boxes overlap */
+    class Pair {
+    public:
+        /** Proxy IDs, with a < b */
+        int         a;
+        int         b;
+
+        Pair() : a(-1), b(-1) {}
+        Pair(int a, int b) : a(a), b(b) {}
+
+        bool operator==(const Pair& other) const {
+            return (a == other.a) && (b == other.b);
+        }
+    };
+
+    /** Two proxies whose shapes interpenetrate */
+    class Contact {
+    public:
+        /** Proxy IDs, as in the Pair */
+        int         a;
+        int         b;
+
+        /** Penetration depth, at least zero */
+        float       depth;
+
+        /** Point of deepest penetration */
+        Point3      point;
+
+        /** Unit vector pointing away from a and into b */
+        Vector3     normal;
+
+        Contact() : a(-1), b(-1), depth(-1.0f) {}
+    };
+
+protected:
+
+    class Proxy {
+    public:
+        ShapeType   type;
+
+        /** Tight bounds */
+        AABox       bounds;
+
+        /** Only the member corresponding to type is meaningful.  An AABOX
+            proxy also stores its bounds in box. */
+        Sphere      sphere;
+        Capsule     capsule;
+        Box         box;
+
+        bool        inUse;
+
+        Proxy() : type(SPHERE), inUse(false) {}
+    };
+
+    /** Indexed by proxy ID */
+    Array<Proxy>        m_proxy;
+
+    /** Proxy IDs that are not in use */
+    Array<int>          m_freeList;
+
+    /** Proxy IDs in use, indexed by AABoxTree member index */
+    Array<int>          m_member;
+
+    /** Bounds of each tree member, in the order of m_member */
+    Array<AABox>        m_memberBounds;
+
+    AABoxTree           m_tree;
+
+    /** True if proxies were inserted or removed since the tree was built */
+    bool                m_membershipChanged;
+
+    CollisionWorld();
+
+    int allocateProxy();
+
+    Proxy& proxy(int id) {
+        debugAssertM((id >= 0) && (id < m_proxy.size()) && m_proxy[id].inUse, "Invalid proxy ID");
+        return m_proxy[id];
+    }
+
+    const Proxy& proxy(int id) const {
+        debugAssertM((id >= 0) && (id < m_proxy.size()) && m_proxy[id].inUse, "Invalid proxy ID");
+        return m_proxy[id];
+    }
+
+    /** Fills \a contact for proxies \a A and \a B, using \a contactPoints and
+        \a contactNormals as scratch space.  The contact depth is negative if
+        they do not interpenetrate. */
+    static void computeContact(const Proxy& A, const Proxy& B, Contact& contact,
+                               Array<Vector3>& contactPoints, Array<Vector3>& contactNormals);
+
+public:
+
+    static shared_ptr<CollisionWorld> create();
+
+    /** Returns the ID of the new proxy */
+    int insert(const Sphere& sphere);
+    int insert(const Box& box);
+    int insert(const Capsule& capsule);
+    int insert(const AABox& box);
+
+    /** Moves proxy \a id, which may also change its shape type */
+    void set(int id, const Sphere& sphere);
+    void set(int id, const Box& box);
+    void set(int id, const Capsule& capsule);
+    void set(int id, const AABox& box);
+
+    /** The ID may be reused by a later insert() */
+    void remove(int id);
+
+    void clear();
+
+    /** Number of proxies */
+    int size() const {
+        return m_proxy.size() - m_freeList.size();
+    }
+
+    ShapeType shapeType(int id) const {
+        return proxy(id).type;
+    }
+
+    /** Axis-aligned bounds of proxy \a id */
+    const AABox& bounds(int id) const {
+        return proxy(id).bounds;
+    }
+
+    /** Updates the broadphase for the current proxy positions and sets \a pairs
+        to every pair of proxies whose bounding boxes overlap, sorted by a and then b. */
+    void getOverlappingPairs(Array<Pair>& pairs);
+
+    /** Sets \a contacts to the contacts of the proxies in \a pairs that interpenetrate,
+        in the order of \a pairs.  The pairs must be from getOverlappingPairs()
+        since the last insert() or remove(). */
+    void getContacts(const Array<Pair>& pairs, Array<Contact>& contacts) const;
+
+    /** Computes the contact between proxies \a a and \a b as getContacts() does,
+        whether or not their bounds overlap.
+        \return false if they do not interpenetrate */
+    bool getContact(int a, int b, Contact& contact) const;
+};
+
+} // namespace G3D
+
+#endif
@@ -4,7 +4,7 @@
  \author Morgan McGuire, http://graphics.cs.williams.edu
  
  \author  2002-06-06
- \edited  2014-07-09
+ \edited  2026-10-17
  */
 #ifndef G3D_FileSystem_h
 #define G3D_FileSystem_h
@@ -132,6 +132,18 @@ private:
         On Windows, all paths are lowercase */
     Table<String, Dir>     m_cache;
 
+    /** An open zipfile and an index of its central directory. Defined in FileSystem.cpp. */
+    class ZipArchive;
+
+    /** Maps zipfile names, keyed like m_cache, to open archives so that reading many
+        files from one zipfile does not reopen and verify it each time. */
+    Table<String, shared_ptr<ZipArchive> > m_zipArchiveCache;
+
+    /** Returns the open archive for \a zipfile, reopening it if the file changed on disk.
+        The modification time is checked at most once per cacheLifetime().  Returns NULL
+        if \a zipfile cannot be opened. */
+    shared_ptr<ZipArchive> _zipArchive(const String& zipfile);
+
     /** Update the cache entry for path if it is not already present.
      \param forceUpdate If true, always override the current cache value.*/
     Dir& getContents(const String& path, bool forceUpdate);
@@ -210,6 +222,9 @@ private:
     /** \copydoc size */
     int64 _size(const String& path);
 
+    /** \copydoc zipfileEntrySize */
+    int64 _zipfileEntrySize(const String& zipfile, const String& pathInsideZipfile);
+
     /** Called from list() */
     void listHelper(const String& shortSpec, const String& parentPath, Array<String>& result, const ListSettings& settings);
 
@@ -312,6 +327,34 @@ public:
         return b;
     }
 
+    /** Returns the uncompressed size of the file \a pathInsideZipfile, or -1 if
+        it is not in \a zipfile.  Uses the cached directory of the zipfile. */
+    static int64 zipfileEntrySize(const String& zipfile, const String& pathInsideZipfile) {
+        mutex.lock();
+        const int64 s = instance()._zipfileEntrySize(zipfile, pathInsideZipfile);
+        mutex.unlock();
+        return s;
+    }
+
+    /** Reads and decompresses the file \a pathInsideZipfile from \a zipfile.
+
+        Zipfiles stay open with their directories indexed between calls (see cacheLifetime()).
+        Only the read of the compressed data holds a lock on the zipfile, so several threads
+        may decompress entries concurrently.
+
+        \param length Set to the uncompressed size
+        \return A buffer allocated with System::alignedMalloc, which the caller must
+        free with System::alignedFree.  It is one byte longer than \a length, with
+        a zero in the last byte so that it may be used as a C string.
+
+        Throws a String if the file is missing or corrupt. */
+    static uint8* readZipfileEntry(const String& zipfile, const String& pathInsideZipfile, int64& length);
+
+    /** Reads several files that are inside zipfiles, decompressing them on the G3D::ThreadPool.
+        \a dataArray[i] is NULL and \a lengthArray[i] is -1 for files that could not be read.
+        \sa readZipfileEntry */
+    static void readZipfileEntries(const Array<String>& pathArray, Array<uint8*>& dataArray, Array<int64>& lengthArray);
+
     
 	/**
        \brief Delete this file. 
@@ -0,0 +1,764 @@
+/**
+  \file G3D/FlatTable.h
+
+  Open-addressing hash table with the same interface as G3D::Table.
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+  \created 2026-10-17
+  \edited  2026-10-17
+
+  Copyright 2000-2015, Morgan McGuire.
+  All rights reserved.
+ */
+
+#ifndef G3D_FlatTable_h
+#define G3D_FlatTable_h
+
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/debug.h"
+#include "G3D/g3dmath.h"
+#include "G3D/System.h"
+#include "G3D/EqualsTrait.h"
+#include "G3D/HashTrait.h"
+#include "G3D/MemoryManager.h"
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+namespace G3D {
+
+/**
+ \brief An unordered map from keys to values with the same interface,
+ iteration, and HashTrait/EqualsTrait customization as Table, stored
+ in flat arrays instead of a linked list per bucket.
+
+ Entries live directly in a single slot array.  A parallel array holds
+ one control byte per slot: empty, deleted, or seven bits of the hash
+ code of the key in that slot.  Lookups examine sixteen control bytes
+ at a time with SSE2 and compare keys only in the slots whose control
+ byte matches, so most queries touch two cache lines and never call
+ EqualsFunc on a non-matching key.  Groups of sixteen slots are probed
+ in triangular order, which visits every group of a power-of-two table.
+
+ Compared with Table, FlatTable makes no allocation per insertion and
+ iterates over contiguous memory, which makes it several times faster
+ for small keys and values (see perfTable in the test suite).
+
+ Unlike Table, inserting into a FlatTable may move existing entries,
+ so <b>pointers and references returned by getPointer(), getCreate(),
+ getCreateEntry(), and get() are invalidated by any later insertion</b>
+ that creates a new key.  Use Table when the caller holds on to
+ entries across insertions.
+
+ The hash codes from HashFunc are remixed before use, so the
+ identity hashes that G3D uses for integers and pointers work well.
+
+ \sa Table, FastPODTable, SmallTable
+ */
+template<class Key, class Value, class HashFunc = HashTrait<Key>, class EqualsFunc = EqualsTrait<Key> >
+class FlatTable {
+public:
+
+    /**
+     The pairs returned by iterator.
+     */
+    class Entry {
+    public:
+        Key    key;
+        Value  value;
+        Entry() {}
+        Entry(const Key& k) : key(k) {}
+        Entry(const Key& k, const Value& v) : key(k), value(v) {}
+        bool operator==(const Entry &peer) const { return (key == peer.key && value == peer.value); }
+        bool operator!=(const Entry &peer) const { return !operator==(peer); }
+    };
+
+private:
+
+    typedef FlatTable<Key, Value, HashFunc, EqualsFunc> ThisType;
+
+    enum {
+        /** Number of control bytes examined by each SSE2 comparison */
+        GROUP_SIZE = 16,
+
+        /** Control byte of a slot that has never held an entry since the last rehash */
+        EMPTY = 0x80,
+
+        /** Control byte of a slot whose entry was removed (a "tombstone") */
+        DELETED = 0xFE
+    };
+
+    static const size_t NOT_FOUND = ~size_t(0);
+
+    /** One per slot.  EMPTY, DELETED, or the low 7 bits of the mixed hash code.  Only the
+        first two have the high bit set. */
+    uint8*                      m_control;
+
+    /** Raw storage for m_capacity entries, of which only the ones with full control bytes are constructed */
+    Entry*                      m_slot;
+
+    /** Zero or a power of two that is at least GROUP_SIZE */
+    size_t                      m_capacity;
+
+    size_t                      m_size;
+
+    size_t                      m_numDeleted;
+
+    shared_ptr<MemoryManager>   m_memoryManager;
+
+    /** Spreads the entropy of \a code across all bits, so that the
+        table can use the high bits for the position and the low bits
+        for the control byte. */
+    static uint64 mix(size_t code) {
+        const uint64 h = uint64(code) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+
+    static uint8 controlByte(uint64 h) {
+        return uint8(h & 0x7F);
+    }
+
+    static int lowestBit(uint32 bits) {
+        debugAssert(bits != 0);
+#       ifdef _MSC_VER
+            unsigned long index;
+            _BitScanForward(&index, bits);
+            return int(index);
+#       else
+            return __builtin_ctz(bits);
+#       endif
+    }
+
+    size_t numGroups() const {
+        return m_capacity / GROUP_SIZE;
+    }
+
+    size_t firstGroup(uint64 h) const {
+        return size_t(h >> 7) & (numGroups() - 1);
+    }
+
+    /** Bit i is set if control byte i of group \a g is \a c */
+    uint32 match(size_t g, uint8 c) const {
+        const __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m_control + g * GROUP_SIZE));
+        return uint32(_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(char(c)))));
+    }
+
+    /** Bit i is set if slot i of group \a g does not contain an entry */
+    uint32 matchEmptyOrDeleted(size_t g) const {
+        return uint32(_mm_movemask_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(m_control + g * GROUP_SIZE))));
+    }
+
+    bool isFull(size_t i) const {
+        return (m_control[i] & 0x80) == 0;
+    }
+
+    /** Returns the slot containing \a key, or NOT_FOUND */
+    size_t find(const Key& key, uint64 h) const {
+        if (m_size == 0) {
+            return NOT_FOUND;
+        }
+
+        const uint8  c    = controlByte(h);
+        const size_t mask = numGroups() - 1;
+        size_t       g    = firstGroup(h);
+
+        // There is always at least one EMPTY slot, so this terminates
+        for (size_t probe = 1; true; ++probe) {
+            for (uint32 bits = match(g, c); bits != 0; bits &= bits - 1) {
+                const size_t i = g * GROUP_SIZE + lowestBit(bits);
+                if (EqualsFunc::equals(m_slot[i].key, key)) {
+                    return i;
+                }
+            }
+
+            // A key is never stored beyond a group that has an EMPTY slot
+            if (match(g, EMPTY) != 0) {
+                return NOT_FOUND;
+            }
+
+            g = (g + probe) & mask;
+        }
+    }
+
+    /** Returns the first slot without an entry on the probe sequence for \a h */
+    size_t findInsertSlot(uint64 h) const {
+        const size_t mask = numGroups() - 1;
+        size_t       g    = firstGroup(h);
+        for (size_t probe = 1; true; ++probe) {
+            const uint32 bits = matchEmptyOrDeleted(g);
+            if (bits != 0) {
+                return g * GROUP_SIZE + lowestBit(bits);
+            }
+            g = (g + probe) & mask;
+        }
+    }
+
+    /** Smallest capacity that holds \a n entries below the maximum load factor of 7/8 */
+    static size_t capacityFor(size_t n) {
+        size_t c = GROUP_SIZE;
+        while (n * 8 > c * 7) {
+            c *= 2;
+        }
+        return c;
+    }
+
+    /** Moves every entry into new arrays of \a newCapacity slots, discarding tombstones */
+    void rehash(size_t newCapacity) {
+        debugAssert((newCapacity >= GROUP_SIZE) && ((newCapacity & (newCapacity - 1)) == 0));
+        debugAssert(m_size * 8 <= newCapacity * 7);
+
+        uint8*       oldControl  = m_control;
+        Entry*       oldSlot     = m_slot;
+        const size_t oldCapacity = m_capacity;
+
+        m_control = (uint8*)m_memoryManager->alloc(newCapacity);
+        m_slot    = (Entry*)m_memoryManager->alloc(newCapacity * sizeof(Entry));
+        alwaysAssertM((m_control != NULL) && (m_slot != NULL), "MemoryManager::alloc returned NULL. Out of memory.");
+        System::memset(m_control, EMPTY, newCapacity);
+        m_capacity   = newCapacity;
+        m_numDeleted = 0;
+
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if ((oldControl[i] & 0x80) == 0) {
+                Entry& e = oldSlot[i];
+                const uint64 h = mix(HashFunc::hashCode(e.key));
+                const size_t j = findInsertSlot(h);
+                m_control[j] = controlByte(h);
+                new (m_slot + j) Entry(std::move(e));
+                e.~Entry();
+            }
+        }
+
+        if (oldCapacity > 0) {
+            m_memoryManager->free(oldControl);
+            m_memoryManager->free(oldSlot);
+        }
+    }
+
+    void copyFrom(const ThisType& h) {
+        debugAssert(m_capacity == 0);
+        if (h.m_size == 0) {
+            return;
+        }
+
+        m_capacity   = h.m_capacity;
+        m_size       = h.m_size;
+        m_numDeleted = h.m_numDeleted;
+        m_control    = (uint8*)m_memoryManager->alloc(m_capacity);
+        m_slot       = (Entry*)m_memoryManager->alloc(m_capacity * sizeof(Entry));
+        alwaysAssertM((m_control != NULL) && (m_slot != NULL), "MemoryManager::alloc returned NULL. Out of memory.");
+        System::memcpy(m_control, h.m_control, m_capacity);
+
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (isFull(i)) {
+                new (m_slot + i) Entry(h.m_slot[i]);
+            }
+        }
+    }
+
+    /** Destroys all entries and frees the arrays */
+    void freeMemory() {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (isFull(i)) {
+                m_slot[i].~Entry();
+            }
+        }
+
+        if (m_capacity > 0) {
+            m_memoryManager->free(m_control);
+            m_memoryManager->free(m_slot);
+        }
+
+        m_control    = NULL;
+        m_slot       = NULL;
+        m_capacity   = 0;
+        m_size       = 0;
+        m_numDeleted = 0;
+    }
+
+    /** Helper for remove() and getRemove() */
+    bool remove(const Key& key, Key& removedKey, Value& removedValue, bool updateRemoved) {
+        const size_t i = find(key, mix(HashFunc::hashCode(key)));
+        if (i == NOT_FOUND) {
+            return false;
+        }
+
+        if (updateRemoved) {
+            removedKey   = m_slot[i].key;
+            removedValue = m_slot[i].value;
+        }
+        m_slot[i].~Entry();
+        --m_size;
+
+        // A group that still has an EMPTY slot was never full, so no
+        // probe sequence continues past it and the slot can become
+        // EMPTY again instead of a tombstone.
+        if (match(i / GROUP_SIZE, EMPTY) != 0) {
+            m_control[i] = EMPTY;
+        } else {
+            m_control[i] = DELETED;
+            ++m_numDeleted;
+        }
+
+        return true;
+    }
+
+    /** Number of groups examined to find the key in slot \a i */
+    size_t probeLength(size_t i) const {
+        const uint64 h    = mix(HashFunc::hashCode(m_slot[i].key));
+        const size_t mask = numGroups() - 1;
+        size_t       g    = firstGroup(h);
+        size_t       n    = 1;
+        for (size_t probe = 1; g != i / GROUP_SIZE; ++probe, ++n) {
+            g = (g + probe) & mask;
+        }
+        return n;
+    }
+
+public:
+
+    /**
+     Creates an empty hash table using the default MemoryManager.
+     */
+    FlatTable() : m_control(NULL), m_slot(NULL), m_capacity(0), m_size(0), m_numDeleted(0) {
+        m_memoryManager = MemoryManager::create();
+    }
+
+    /** Uses the default memory manager */
+    FlatTable(const ThisType& h) : m_control(NULL), m_slot(NULL), m_capacity(0), m_size(0), m_numDeleted(0) {
+        m_memoryManager = MemoryManager::create();
+        copyFrom(h);
+    }
+
+    FlatTable& operator=(const ThisType& h) {
+        if (this != &h) {
+            freeMemory();
+            copyFrom(h);
+        }
+        return *this;
+    }
+
+    /**
+       Destroys all of the memory allocated by the table, but does <B>not</B>
+       call delete on keys or values if they are pointers.
+    */
+    virtual ~FlatTable() {
+        freeMemory();
+    }
+
+    /** Changes the internal memory manager to m */
+    void clearAndSetMemoryManager(const shared_ptr<MemoryManager>& m) {
+        clear();
+        m_memoryManager = m;
+    }
+
+    /**
+        Recommends that the table resize to anticipate at least this number of elements.
+     */
+    void setSizeHint(size_t n) {
+        const size_t c = capacityFor(n);
+        if (c > m_capacity) {
+            rehash(c);
+        }
+    }
+
+    /** Fraction of the slots that contain entries */
+    double debugGetLoad() const {
+        return (m_capacity == 0) ? 0.0 : (double)size() / m_capacity;
+    }
+
+    /** Returns the number of slots. */
+    size_t debugGetNumBuckets() const {
+        return m_capacity;
+    }
+
+    /** Returns the largest number of groups of slots examined to find any key */
+    size_t debugGetDeepestBucketSize() const {
+        size_t deepest = 0;
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (isFull(i)) {
+                deepest = max(deepest, probeLength(i));
+            }
+        }
+        return deepest;
+    }
+
+    /** Returns the average number of groups of slots examined to find a key */
+    float debugGetAverageBucketSize() const {
+        uint64 total = 0;
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (isFull(i)) {
+                total += probeLength(i);
+            }
+        }
+        return (m_size == 0) ? 0.0f : (float)((double)total / m_size);
+    }
+
+    /**
+     C++ STL style iterator variable.  See begin().
+     */
+    class Iterator {
+    private:
+        friend class FlatTable<Key, Value, HashFunc, EqualsFunc>;
+
+        /** Slot index */
+        size_t              index;
+
+        const uint8*        m_control;
+        Entry*              m_slot;
+        size_t              m_capacity;
+        bool                isDone;
+
+        /**
+         Creates the end iterator.
+         */
+        Iterator() : index(0), m_control(NULL), m_slot(NULL), m_capacity(0), isDone(true) {}
+
+        Iterator(const uint8* control, Entry* slot, size_t capacity) :
+            index(0),
+            m_control(control),
+            m_slot(slot),
+            m_capacity(capacity),
+            isDone(false) {
+            findNext();
+        }
+
+        /** Advances index to the next full slot at or after index. Sets isDone at the end. */
+        void findNext() {
+            while ((index < m_capacity) && ((m_control[index] & 0x80) != 0)) {
+                ++index;
+            }
+            if (index >= m_capacity) {
+                index  = 0;
+                isDone = true;
+            }
+        }
+
+    public:
+        inline bool operator!=(const Iterator& other) const {
+            return !(*this == other);
+        }
+
+        bool operator==(const Iterator& other) const {
+            if (other.isDone || isDone) {
+                // Common case; check against isDone.
+                return (isDone == other.isDone);
+            } else {
+                return (m_slot == other.m_slot) && (index == other.index);
+            }
+        }
+
+        /**
+         Pre increment.
+         */
+        Iterator& operator++() {
+            debugAssert(! isDone);
+            ++index;
+            findNext();
+            return *this;
+        }
+
+        /**
+         Post increment (slower than preincrement).
+         */
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++(*this);
+            return old;
+        }
+
+        const Entry& operator*() const {
+            return m_slot[index];
+        }
+
+        const Value& value() const {
+            return m_slot[index].value;
+        }
+
+        const Key& key() const {
+            return m_slot[index].key;
+        }
+
+        Entry* operator->() const {
+            return m_slot + index;
+        }
+
+        operator Entry*() const {
+            return m_slot + index;
+        }
+
+        bool isValid() const {
+            return ! isDone;
+        }
+
+        /** @deprecated  Use isValid */
+        bool hasMore() const {
+            return ! isDone;
+        }
+    };
+
+    /**
+     C++ STL style iterator method.  Returns the first Entry, which
+     contains a key and value.  Use preincrement (++entry) to get to
+     the next element.  Do not modify the table while iterating.
+     */
+    Iterator begin() const {
+        if (m_size == 0) {
+            return Iterator();
+        }
+        return Iterator(m_control, m_slot, m_capacity);
+    }
+
+    /**
+     C++ STL style iterator method.  Returns one after the last iterator
+     element.
+     */
+    const Iterator end() const {
+        return Iterator();
+    }
+
+    /**
+     Removes all elements. Guaranteed to free all memory associated with
+     the table.
+     */
+    void clear() {
+        freeMemory();
+    }
+
+    /**
+     Returns the number of keys.
+     */
+    size_t size() const {
+        return m_size;
+    }
+
+    /**
+     If you insert a pointer into the key or value of a table, you are
+     responsible for deallocating the object eventually.
+     */
+    void set(const Key& key, const Value& value) {
+        getCreateEntry(key).value = value;
+    }
+
+    /** If @a member is present, sets @a removed to the element
+     being removed and returns true.  Otherwise returns false
+     and does not write to @a removed. */
+    bool getRemove(const Key& key, Key& removedKey, Value& removedValue) {
+        return remove(key, removedKey, removedValue, true);
+    }
+
+    /**
+     Removes an element from the table if it is present.
+     @return true if the element was found and removed, otherwise  false
+     */
+    bool remove(const Key& key) {
+        Key x;
+        Value v;
+        return remove(key, x, v, false);
+    }
+
+    /** If a value that is EqualsFunc to @a member is present, returns a pointer to the
+        version stored in the data structure, otherwise returns NULL.
+     */
+    const Key* getKeyPointer(const Key& key) const {
+        const size_t i = find(key, mix(HashFunc::hashCode(key)));
+        return (i == NOT_FOUND) ? NULL : &(m_slot[i].key);
+    }
+
+    /**
+     Returns the value associated with key.
+     @deprecated Use get(key, val) or getPointer(key)
+     */
+    Value& get(const Key& key) const {
+        Value* v = getPointer(key);
+        debugAssertM(v != NULL, "Key not found");
+        return *v;
+    }
+
+    /** Returns a pointer to the element if it exists, or NULL if it does not.
+        The pointer is invalidated by removing the element or by inserting
+        any new key. */
+    Value* getPointer(const Key& key) const {
+        const size_t i = find(key, mix(HashFunc::hashCode(key)));
+        return (i == NOT_FOUND) ? NULL : &(m_slot[i].value);
+    }
+
+    /**
+     If the key is present in the table, val is set to the associated value and returns true.
+     If the key is not present, returns false.
+     */
+    bool get(const Key& key, Value& val) const {
+        const Value* v = getPointer(key);
+        if (v != NULL) {
+            val = *v;
+            return true;
+        } else {
+            return false;
+        }
+    }
+
+    /** Called by getCreate() and set()
+
+        \param created Set to true if the entry was created by this method.
+    */
+    Entry& getCreateEntry(const Key& key, bool& created) {
+        const uint64 h = mix(HashFunc::hashCode(key));
+
+        size_t i = find(key, h);
+        if (i != NOT_FOUND) {
+            created = false;
+            return m_slot[i];
+        }
+
+        // Keep at least one slot in eight EMPTY so that probes terminate quickly
+        if ((m_size + m_numDeleted + 1) * 8 > m_capacity * 7) {
+            // Grow if the live entries need it; otherwise only discard the tombstones
+            rehash(max(capacityFor(m_size + 1), (m_size + 1) * 16 > m_capacity * 7 ? 2 * m_capacity : m_capacity));
+        }
+
+        i = findInsertSlot(h);
+        if (m_control[i] == DELETED) {
+            --m_numDeleted;
+        }
+        m_control[i] = controlByte(h);
+        new (m_slot + i) Entry(key);
+        ++m_size;
+
+        created = true;
+        return m_slot[i];
+    }
+
+    Entry& getCreateEntry(const Key& key) {
+        bool ignore;
+        return getCreateEntry(key, ignore);
+    }
+
+    /** Returns the current value that key maps to, creating it if necessary.*/
+    Value& getCreate(const Key& key) {
+        return getCreateEntry(key).value;
+    }
+
+    /** \param created True if the element was created. */
+    Value& getCreate(const Key& key, bool& created) {
+        return getCreateEntry(key, created).value;
+    }
+
+    /**
+     Returns true if any key maps to value using operator==.
+     */
+    bool containsValue(const Value& value) const {
+        for (Iterator it = begin(); it.isValid(); ++it) {
+            if (it.value() == value) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     Returns true if key is in the table.
+     */
+    bool containsKey(const Key& key) const {
+        return find(key, mix(HashFunc::hashCode(key))) != NOT_FOUND;
+    }
+
+    /**
+     Short syntax for get.
+     */
+    inline Value& operator[](const Key &key) const {
+        return get(key);
+    }
+
+    /**
+     Returns an array of all of the keys in the table.
+     You can iterate over the keys to get the values.
+     @deprecated
+     */
+    Array<Key> getKeys() const {
+        Array<Key> keyArray;
+        getKeys(keyArray);
+        return keyArray;
+    }
+
+    void getKeys(Array<Key>& keyArray) const {
+        keyArray.resize(0, DONT_SHRINK_UNDERLYING_ARRAY);
+        for (Iterator it = begin(); it.isValid(); ++it) {
+            keyArray.append(it.key());
+        }
+    }
+
+    /** Will contain duplicate values if they exist in the table.  This array is parallel to the one returned by getKeys() if the table has not been modified. */
+    void getValues(Array<Value>& valueArray) const {
+        valueArray.resize(0, DONT_SHRINK_UNDERLYING_ARRAY);
+        for (Iterator it = begin(); it.isValid(); ++it) {
+            valueArray.append(it.value());
+        }
+    }
+
+    /**
+     Calls delete on all of the keys and then clears the table.
+     */
+    void deleteKeys() {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (isFull(i)) {
+                delete m_slot[i].key;
+                m_slot[i].key = NULL;
+            }
+        }
+        clear();
+    }
+
+    /**
+     Calls delete on all of the values.  This is unsafe--
+     do not call unless you know that each value appears
+     at most once.
+
+     Does not clear the table, so you are left with a table
+     of NULL pointers.
+     */
+    void deleteValues() {
+        for (size_t i = 0; i < m_capacity; ++i) {
+            if (isFull(i)) {
+                delete m_slot[i].value;
+                m_slot[i].value = NULL;
+            }
+        }
+    }
+
+    template<class H, class E>
+    bool operator==(const FlatTable<Key, Value, H, E>& other) const {
+        if (size() != other.size()) {
+            return false;
+        }
+
+        for (Iterator it = begin(); it.hasMore(); ++it) {
+            const Value* v = other.getPointer(it->key);
+            if ((v == NULL) || (*v != it->value)) {
+                // Either the key did not exist or the value was not the same
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    template<class H, class E>
+    bool operator!=(const FlatTable<Key, Value, H, E>& other) const {
+        return ! (*this == other);
+    }
+
+    void debugPrintStatus() {
+        debugPrintf("Deepest probe length   = %d\n", (int)debugGetDeepestBucketSize());
+        debugPrintf("Average probe length   = %g\n", debugGetAverageBucketSize());
+        debugPrintf("Load factor            = %g\n", debugGetLoad());
+    }
+};
+
+} // namespace G3D
+
+#endif
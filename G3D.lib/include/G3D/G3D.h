@@ -7,7 +7,7 @@
  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
  \created 2001-08-25
- \edited  2015-08-29
+ \edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -118,6 +118,7 @@ template<class T> struct HashTrait< shared_ptr<T> > {
 };
 
 #include "G3D/Image.h"
+#include "G3D/ImageLoader.h"
 #include "G3D/CollisionDetection.h"
 #include "G3D/Intersect.h"
 #include "G3D/Log.h"
@@ -141,6 +142,8 @@ template<class T> struct HashTrait< shared_ptr<T> > {
 #include "G3D/MeshAlg.h"
 #include "G3D/vectorMath.h"
 #include "G3D/Rect2D.h"
+#include "G3D/AABoxTree.h"
+#include "G3D/CollisionWorld.h"
 #include "G3D/KDTree.h"
 #include "G3D/PointKDTree.h"
 #include "G3D/TextOutput.h"
@@ -149,6 +152,7 @@ template<class T> struct HashTrait< shared_ptr<T> > {
 #include "G3D/AtomicInt32.h"
 #include "G3D/GThread.h"
 #include "G3D/ThreadSet.h"
+#include "G3D/ThreadPool.h"
 #include "G3D/RegistryUtil.h"
 #include "G3D/Any.h"
 #include "G3D/XML.h"
@@ -174,9 +178,11 @@ template<class T> struct HashTrait< shared_ptr<T> > {
 #include "G3D/Parse3DS.h"
 #include "G3D/PathDirection.h"
 #include "G3D/FastPODTable.h"
+#include "G3D/FlatTable.h"
 #include "G3D/FastPointHashGrid.h"
 #include "G3D/PixelTransferBuffer.h"
 #include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/TiledImageEncoder.h"
 #include "G3D/CompassDirection.h"
 #include "G3D/Access.h"
 #include "G3D/DepthFirstTreeBuilder.h"
@@ -2,7 +2,7 @@
   @file GThread.h
  
   @created 2005-09-22
-  @edited  2010-09-10
+  @edited  2026-10-17
 
  */
 
@@ -12,6 +12,7 @@
 #include "G3D/platform.h"
 #include "G3D/ReferenceCount.h"
 #include "G3D/ThreadSet.h"
+#include "G3D/ThreadPool.h"
 #include "G3D/Vector2int32.h"
 #include "G3D/SpawnBehavior.h"
 #include "G3D/G3DString.h"
@@ -37,7 +38,7 @@ typedef shared_ptr<class GThread> GThreadRef;
  dropping all pointers (and causing deallocation) of a GThread does NOT 
  stop the underlying process.
 
- \sa G3D::GMutex, G3D::Spinlock, G3D::AtomicInt32, G3D::ThreadSet
+ \sa G3D::GMutex, G3D::Spinlock, G3D::AtomicInt32, G3D::ThreadSet, G3D::ThreadPool
 */
 class GThread : public ReferenceCountedObject {
 private:
@@ -136,11 +137,13 @@ public:
         blocks until all threads have completed. <p> Evaluates \a
         object->\a method(\a x, \a y) for every <code>start.x <= x <
         upTo.x</code> and <code>start.y <= y < upTo.y</code>.
-        Iteration is row major, so each thread can expect to see
-        successive x values.  </p> 
+        The region is divided into small tiles that are load balanced
+        across the persistent ThreadPool, so no threads are created per
+        call.  Iteration is row major within a tile, so each thread can
+        expect to see successive x values.  </p> 
         \param maxThreads
-        Maximum number of threads to use.  By default at most one
-        thread per processor core will be used.
+        Maximum number of threads to use, including the calling thread.
+        By default at most one thread per processor core will be used.
 
         Example:
 
@@ -169,7 +172,9 @@ public:
 
     /** Like the other version of runConcurrently2D, but tells the
         method the thread index that it is running on.  That enables
-        the caller to manage per-thread state.
+        the caller to manage per-thread state.  The threadID is
+        in <code>[0, min(maxThreads, ThreadPool::numThreads()))</code>
+        and is unique among threads concurrently executing this call.
     */
     template<class Class>
     static void runConcurrently2D
@@ -185,55 +190,6 @@ public:
 
 
 
-    // Can't use an inherited class inside of its parent on g++ 4.2.1 if it is later a template parameter
-
-    /** For use by runConcurrently2D. Designed for arbitrary iteration, although only used for
-        interlaced rows in the current implementation. */
-    template<class Class>
-    class _internalGThreadWorker : public GThread {
-    public:
-        /** Start for this thread, which differs from the others */
-        const int                 threadID;
-        const Vector2int32        start;
-        const Vector2int32        upTo;
-        const Vector2int32        stride;
-        Class*                    object;
-        void             (Class::*method1)(int x, int y);
-        void             (Class::*method2)(int x, int y, int threadID);
-        
-        _internalGThreadWorker(int                 threadID,
-               const Vector2int32& start, 
-               const Vector2int32& upTo, 
-               Class*              object,
-               void (Class::*method1)(int x, int y),
-               void (Class::*method2)(int x, int y, int threadID),
-               const Vector2int32& stride) : 
-            GThread("runConcurrently2D worker"),
-            threadID(threadID),
-            start(start),
-            upTo(upTo), 
-            stride(stride),
-            object(object), 
-            method1(method1),
-            method2(method2) {}
-        
-        virtual void threadMain() {
-            for (int y = start.y; y < upTo.y; y += stride.y) {
-                // Run whichever method was provided
-                if (method1) {
-                    for (int x = start.x; x < upTo.x; x += stride.x) {
-                        (object->*method1)(x, y);
-                    }
-                } else {
-                    for (int x = start.x; x < upTo.x; x += stride.x) {
-                        (object->*method2)(x, y, threadID);
-                    }
-                }
-            }
-        }
-    };
-
-
     template<class Class>
     void _internal_runConcurrently2DHelper
     (const Vector2int32& start, 
@@ -242,24 +198,24 @@ public:
      void (Class::*method1)(int x, int y),
      void (Class::*method2)(int x, int y, int threadID),
      int                 maxThreads) {
-        
-        // Create a group of threads
-        if (maxThreads == GThread::NUM_CORES) {
-            maxThreads = GThread::numCores();
-        }
-
-        const int numRows = upTo.y - start.y;
-        const int numThreads = min(maxThreads, numRows);
-        const Vector2int32 stride(1, numThreads);
-        ThreadSet threadSet;
-        for (int t = 0; t < numThreads; ++t) {
-            threadSet.insert(shared_ptr<_internalGThreadWorker<Class> >(new _internalGThreadWorker<Class>(t, start + Vector2int32(0, t), upTo, object, method1, method2, stride)));
-        }
-
-        // Run the threads, reusing the current thread and blocking until
-        // all complete
-        threadSet.start(USE_CURRENT_THREAD);
-        threadSet.waitForCompletion();
+
+        // Tiles are dynamically load balanced across the persistent
+        // ThreadPool instead of spawning threads for interlaced rows
+        ThreadPool::parallelForTiles(start, upTo, 
+            [&](const Vector2int32& tileStart, const Vector2int32& tileEnd, int threadID) {
+                for (int y = tileStart.y; y < tileEnd.y; ++y) {
+                    // Run whichever method was provided
+                    if (method1) {
+                        for (int x = tileStart.x; x < tileEnd.x; ++x) {
+                            (object->*method1)(x, y);
+                        }
+                    } else {
+                        for (int x = tileStart.x; x < tileEnd.x; ++x) {
+                            (object->*method2)(x, y, threadID);
+                        }
+                    }
+                }
+            }, Vector2int32(32, 8), maxThreads);
     }
 
 
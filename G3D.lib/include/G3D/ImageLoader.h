@@ -0,0 +1,115 @@
+/**
+  \file G3D/ImageLoader.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+ */
+
+#ifndef G3D_ImageLoader_h
+#define G3D_ImageLoader_h
+
+#include "G3D/platform.h"
+#include "G3D/ReferenceCount.h"
+#include "G3D/G3DString.h"
+#include "G3D/ImageFormat.h"
+#include <functional>
+#include <future>
+#include <chrono>
+
+namespace G3D {
+
+class Image;
+
+/**
+ \brief Process-wide service that decodes image files asynchronously on
+ a bounded pool of worker threads.
+
+ Requests are served in priority order, largest first, and in
+ submission order within a priority.  Workers are created on demand,
+ up to maxThreads(), and sleep when the queue is empty.  Unlike
+ ThreadPool, whose threads are sized for compute-bound loops, this
+ pool is intended for work that mixes file I/O with decoding, so it
+ may have more threads than there are cores.
+
+ load() returns a future for an Image.  Arbitrary CPU work, such as
+ preprocessing that must follow a decode, can be scheduled on the
+ same workers with enqueue().  Texture uses both to decode all of the
+ textures of a material concurrently and to run gamma correction and
+ bump map generation on the workers behind the decode.
+
+ Exceptions thrown while loading are captured and rethrown by
+ <code>Future::get()</code> and wait().
+
+ Example:
+ \code
+ ImageLoader::Future a = ImageLoader::load("a.png");
+ ImageLoader::Future b = ImageLoader::load("b.jpg");
+ ...
+ const shared_ptr<Image>& imageA = ImageLoader::wait(a);
+ \endcode
+
+ \sa Image::fromFile, ThreadPool
+*/
+class ImageLoader {
+public:
+
+    typedef std::shared_future<shared_ptr<Image> > Future;
+
+    typedef std::function<void ()> Job;
+
+    enum {
+        /** Used by load() and enqueue() when no priority is specified */
+        DEFAULT_PRIORITY = 0
+    };
+
+    /** Begins decoding \a filename with Image::fromFile on a worker thread and returns immediately. */
+    static Future load
+    (const String&          filename,
+     const ImageFormat*     imageFormat = ImageFormat::AUTO(),
+     int                    priority    = DEFAULT_PRIORITY);
+
+    /** Executes \a job on a worker thread.  The job must not throw. */
+    static void enqueue(const Job& job, int priority = DEFAULT_PRIORITY);
+
+    /** Removes the highest priority pending job from the queue and
+        executes it on the calling thread.  Returns false if there was
+        nothing to execute. */
+    static bool runPendingJob();
+
+    /** \brief Blocks until \a future is ready and returns its value.
+
+        Executes pending jobs on the calling thread instead of
+        sleeping while it waits, so a job may itself wait on other
+        jobs without deadlocking the pool. */
+    template<class T>
+    static const T& wait(const std::shared_future<T>& future) {
+        while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            if (! runPendingJob()) {
+                future.wait_for(std::chrono::milliseconds(1));
+            }
+        }
+        return future.get();
+    }
+
+    /** Sets the maximum number of worker threads that may execute jobs
+        concurrently.  Lowering the limit idles the surplus workers
+        instead of destroying them.  Values less than one restore the
+        default. */
+    static void setMaxThreads(int n);
+
+    /** Defaults to twice System::numCores(), clamped to [2, 16], because workers often block on file I/O */
+    static int maxThreads();
+
+    /** Number of worker threads that have been created so far */
+    static int numThreads();
+
+    /** Number of jobs that are queued and not yet executing. By the time
+        the method returns, the value may be incorrect. */
+    static int numPending();
+};
+
+} // namespace G3D
+
+#endif
@@ -4,7 +4,7 @@
   @maintainer Morgan McGuire, http://graphics.cs.williams.edu
   @cite Backtrace by Aaron Orenstein
   @created 2001-08-04
-  @edited  2014-10-04
+  @edited  2026-10-17
  */
 
 #ifndef G3D_Log_h
@@ -33,6 +33,9 @@ namespace G3D {
     Many G3D routines write useful warnings and debugging information to the
     system log, which makes it a good first place to go when tracking down
     a problem.
+
+    If the common log is Log::setAsynchronous, this returns before the
+    output is written.
      */
 void logPrintf(const char* fmt, ...);
 
@@ -44,10 +47,26 @@ void logLazyPrintf(const char* fmt, ...);
  is the "common log" and can be accessed with the static
  method common().  If you access common() and a common log
  does not yet exist, one is created for you.
+
+ By default every message except those from lazyvprintf() is written
+ and flushed before the method returns, on the calling thread.  In
+ asynchronous mode (setAsynchronous()), messages are instead copied
+ into a fixed-size buffer owned by the calling thread without locking, and a
+ background thread writes them to disk in batches.  Messages from one thread
+ stay in order, but messages from different threads may be interleaved
+ differently than they were logged.  A message that does not fit in its
+ thread's buffer is dropped and counted by numDroppedMessages().
+
+ Pending asynchronous messages are written by flush(), on assertion
+ failures, at exit, when the Log is destroyed, and (best effort) when the
+ program receives a crash signal such as SIGSEGV or SIGABRT.
  */
 class Log {
 private:
 
+    /** Background writer and per-thread buffers. Defined in Log.cpp. */
+    class AsyncWriter;
+
     /**
      Log messages go here.
      */
@@ -55,8 +74,25 @@ private:
 
     String                  filename;
 
+    /** NULL unless asynchronous() */
+    AsyncWriter*            m_asyncWriter;
+
     static Log*             commonLog;
 
+    /** Writes \a len bytes directly or to the asynchronous buffer */
+    void write(const char* s, size_t len, bool flushNow);
+
+    void vwrite(const char* fmt, va_list argPtr, bool flushNow);
+
+    /** Flushes every asynchronous log before exit */
+    static void flushAllAsynchronous();
+
+    static void __cdecl exitHandler();
+
+    static void __cdecl signalHandler(int sig);
+
+    static void installSignalHandler(int sig);
+
 public:
 
     /**
@@ -70,7 +106,8 @@ public:
     virtual ~Log();
 
     /**
-     Returns the handle to the file log.
+     Returns the handle to the file log. If asynchronous(), call
+     flush() before writing to it directly.
      */
     FILE* getFile() const;
 
@@ -100,6 +137,23 @@ public:
     void print(const String& s);
 
     void println(const String& s);
+
+    /** Enables or disables asynchronous writing.  Disabling writes all pending messages first.
+
+        \param bufferSize Bytes of pending messages allowed per thread before
+        further messages from that thread are dropped.  Rounded up to a power of two. */
+    void setAsynchronous(bool a, int bufferSize = 64 * 1024);
+
+    bool asynchronous() const {
+        return m_asyncWriter != NULL;
+    }
+
+    /** Blocks until every message logged before the call is written to disk. 
+        Messages that other threads are logging concurrently may or may not be written. */
+    void flush();
+
+    /** Number of messages dropped because a thread's asynchronous buffer was full */
+    int numDroppedMessages() const;
 };
 
 }
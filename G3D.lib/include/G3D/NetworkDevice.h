@@ -53,6 +53,7 @@
 namespace G3D {
 
 class TextOutput;
+class NetBufferView;
 /**  \deprecated */
 class Conduit : public ReferenceCountedObject {
 protected:
@@ -195,6 +196,10 @@ private:
       */
     size_t                          receiveBufferUsedSize;
 
+    /** Reads the held message in place from receiveBuffer.  Allocated on
+        demand by binaryInput() and released when the message is removed. */
+    shared_ptr<BinaryInput>         receiveBinaryInput;
+
     ReliableConduit(const NetAddress& addr);
 
     ReliableConduit(const SOCKET& sock, 
@@ -235,6 +240,11 @@ private:
 
     void sendBuffer(const BinaryOutput& b);
 
+    /** Writes the 8-byte message header and then all of the views to the
+        socket in order, using a gathering send so that they need not be
+        contiguous.  Closes the socket if anything goes wrong. */
+    void sendBuffers(const uint32 header[2], const NetBufferView* views, int numViews);
+
     /** Accumulates whatever part of the message (not the header) is
         still waiting on the socket into the receiveBuffer during
         state = RECEIVING mode.  Closes the socket if anything goes
@@ -284,6 +294,20 @@ public:
         commands that have no parameters. */
     void send(uint32 type);
 
+    /**
+     Sends one message whose body is the concatenation of the \a numViews
+     buffers, with no serialization and no copy into an intermediate
+     buffer: the header and views are handed to the socket with a single
+     gathering send.  This is useful for large payloads, such as state
+     snapshots, that already live in application memory.
+
+     The data has been written to the socket when this returns, so each
+     view's memoryManager is ignored and the caller may modify or free the
+     memory immediately.  The receiver sees an ordinary message and can
+     read it with receive(T&) or binaryInput().
+     */
+    void send(uint32 type, const NetBufferView* views, int numViews);
+
     /** Send the same message to a number of conduits.  Useful for sending
         data from a server to many clients (only serializes once). */
     template<typename T>
@@ -317,11 +341,12 @@ public:
 
         debugAssert(state == HOLDING);
         // Deserialize
-        BinaryInput b((uint8*)receiveBuffer, receiveBufferUsedSize, G3D_LITTLE_ENDIAN, BinaryInput::NO_COPY);
+        BinaryInput b((uint8*)receiveBuffer, receiveBufferUsedSize, G3D_LITTLE_ENDIAN, false, BinaryInput::NO_COPY);
         message.deserialize(b);
         
         // Don't let anyone read this message again.  We leave the buffer
         // allocated for the next caller, however.
+        receiveBinaryInput.reset();
         receiveBufferUsedSize = 0;
         state = NO_MESSAGE;
         messageType = 0;
@@ -333,11 +358,20 @@ public:
         return true;
     }
 
+    /**
+     A BinaryInput that reads the waiting message directly from the
+     internal receive buffer, without copying it.  It remains valid until
+     the message is removed by receive().  It is an error to call this
+     when no message is waiting.
+     */
+    BinaryInput& binaryInput();
+
     /** Removes the current message from the queue. */
     inline void receive() {
         if (! messageWaiting()) {
             return;
         }
+        receiveBinaryInput.reset();
         receiveBufferUsedSize = 0;
         state = NO_MESSAGE;
         messageType = 0;
@@ -517,7 +551,7 @@ public:
         if (r) {
             BinaryInput b((messageBuffer.getCArray() + 4), 
                           messageBuffer.size() - 4, 
-                          G3D_LITTLE_ENDIAN, BinaryInput::NO_COPY);
+                          G3D_LITTLE_ENDIAN, false, BinaryInput::NO_COPY);
             message.deserialize(b);
         }
 
@@ -128,6 +128,12 @@ public:
         
         Threadsafe. */
     float sampleFloat(int x, int y, int z, int numOctaves = 1);
+
+    /** Evaluates sampleFloat() at four points at once using SSE2, producing
+        identical results: <code>result[i] = sampleFloat(x[i], y[i], z[i], numOctaves)</code>.
+
+        Threadsafe. */
+    void sampleFloat4(const int32 x[4], const int32 y[4], const int32 z[4], float result[4], int numOctaves = 1);
 };
 
 }
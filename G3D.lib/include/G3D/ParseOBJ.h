@@ -4,7 +4,7 @@
  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
  \created 2011-07-19
- \edited  2015-01-03
+ \edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -41,6 +41,11 @@ for object-level culling.
 Uses a special text parser instead of G3D::TextInput for peak performance (about 30x faster
 than TextInput).
 
+Large files are split at line boundaries into chunks whose vertices and faces are tokenized
+concurrently on the G3D::ThreadPool. A short sequential pass then applies groups, materials,
+material libraries, and relative (negative) indices in file order, so the result is identical
+to parsing on a single thread.
+
 This is intentionally designed to map the file format into memory, not to process it further.
 That supports a number of modeling uses of the data beyond specific OpenGL-trimesh rendering.
 
@@ -213,6 +218,15 @@ private:
     /** Options for parsing the obj file (for lightMap coord processing, etc.) */
     Options             m_objOptions;
 
+    /** Output of tokenizing one chunk of a large file; see parseParallel() */
+    class Chunk;
+
+    /** When not NULL, this object is tokenizing one chunk of a larger file
+        on a worker thread.  Faces and group, material, and material library
+        changes are recorded in the chunk for the sequential pass instead of
+        being applied. */
+    Chunk*              m_chunk;
+
     void processCommand(TextInput& ti, const String& cmd);
 
     /** Processes the "f" command.  Called from processCommand. */
@@ -441,9 +455,35 @@ private:
 
     void processCommand(const Command command);
 
+    /** Returns a new face in the current mesh, creating the default
+        material, group, and mesh first if needed. */
+    Face& nextFace();
+
+    void setGroup(const String& groupName);
+
+    void useMaterial(const String& materialName);
+
+    /** Appends to mtlArray and replaces the current material library */
+    void loadMaterialLibrary(const String& mtlFilename);
+
+    /** Processes commands until the end of the input */
+    void parseCommands(const char* ptr, size_t len);
+
+    /** Tokenizes chunks of the input concurrently, then applies them in order */
+    void parseParallel(const char* ptr, size_t len, int maxThreads);
+
 public:
 
-    void parse(const char* ptr, size_t len, const String& basePath, const ParseOBJ::Options& options);
+    /** Inputs shorter than this are always parsed on a single thread */
+    static const size_t PARALLEL_MIN_LENGTH = 1024 * 1024;
+
+    ParseOBJ() : nextCharacter(NULL), remainingCharacters(0), m_line(1), m_chunk(NULL) {}
+
+    /** \param maxThreads Maximum number of ThreadPool threads to use for large inputs.  Values
+        less than one allow all threads.  When that leaves a single thread (including on a
+        one-core machine), parsing runs on the calling thread with the original single-pass
+        parser if the input is small enough for it. */
+    void parse(const char* ptr, size_t len, const String& basePath, const ParseOBJ::Options& options, int maxThreads = -1);
 
     void parse(BinaryInput& bi, const ParseOBJ::Options& options = ParseOBJ::Options(), const String& basePath = "<AUTO>");
 };
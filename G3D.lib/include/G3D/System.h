@@ -8,7 +8,7 @@
   \cite Michael Herf http://www.stereopsis.com/memcpy.html
 
   \created 2003-01-25
-  \edited  2012-10-02
+  \edited  2026-10-17
  */
 
 #ifndef G3D_System_h
@@ -100,6 +100,8 @@ private:
     bool           m_hasSSE;
     bool           m_hasSSE2;
     bool           m_hasSSE3;
+    bool           m_hasSSSE3;
+    bool           m_hasSSE4_1;
     bool           m_has3DNOW;
     bool           m_has3DNOW2;
     bool           m_hasAMDMMX;
@@ -209,6 +211,15 @@ public:
         return instance().m_hasSSE3;
     }
 
+    /** Supplemental SSE3, which provides the byte shuffle used by ImageFormat::convert */
+    inline static bool hasSSSE3() {
+        return instance().m_hasSSSE3;
+    }
+
+    inline static bool hasSSE4_1() {
+        return instance().m_hasSSE4_1;
+    }
+
     inline static bool hasMMX() {
         return instance().m_hasMMX;
     }
@@ -247,13 +258,15 @@ public:
     static String currentTimeString();
 
     /**
-       Uses pooled storage to optimize small allocations (1 byte to 5
+       Uses pooled storage to optimize small allocations (1 byte to 8
        kilobytes).  Can be 10x to 100x faster than calling \c malloc or
        \c new.
        
        The result must be freed with free.
        
-       Threadsafe on Win32.
+       Threadsafe.  Each thread caches free blocks of each size, so
+       concurrent small allocations do not contend for a lock.  Memory
+       may be freed on a different thread than allocated it.
        
        @sa calloc realloc OutOfMemoryCallback free
     */
@@ -272,14 +285,15 @@ public:
        Returns a string describing the current usage of the buffer pools used for
        optimizing System::malloc, and describing how well System::malloc is using
         its internal pooled storage.  "heap" memory was slow to
-        allocate; the other data sizes are comparatively fast.
+        allocate; the other data sizes are comparatively fast.  Includes the
+        number of slabs, free blocks, and allocations for each size class.
      */
     static String mallocStatus();
 
     /**
      Free data allocated with System::malloc.
 
-     Threadsafe on Win32.
+     Threadsafe.
      */
     static void free(void* p);
 
@@ -0,0 +1,127 @@
+/**
+  \file G3D/ThreadPool.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+ */
+
+#ifndef G3D_ThreadPool_h
+#define G3D_ThreadPool_h
+
+#include "G3D/platform.h"
+#include "G3D/Vector2int32.h"
+#include <functional>
+
+namespace G3D {
+
+/**
+ \brief Persistent, process-wide pool of worker threads that executes
+ data-parallel loops by work stealing.
+
+ The pool is created on first use with System::numCores() - 1 worker
+ threads; the thread that invokes a loop always participates as well,
+ so numThreads() == System::numCores().
+
+ Each worker owns a deque of pending iteration ranges.  A thread
+ executing a range larger than the grain size splits it in half,
+ pushes the upper half onto the bottom of its own deque, and keeps
+ working on the lower half.  Idle workers steal from the top of other
+ workers' deques, which holds the largest remaining pieces, so uneven
+ iterations load balance automatically.  Idle workers sleep rather
+ than spin once there is no work left anywhere.
+
+ A thread that is waiting for a loop to finish executes pending work
+ of that loop, and of loops nested within its body, instead of
+ blocking.  So parallelFor() may be invoked from inside the body of
+ another parallelFor() without deadlock or oversubscription, and a
+ waiting thread never starts a second chunk of an enclosing loop
+ while it is still inside the first.
+
+ The threadID argument passed to loop bodies is unique among the
+ threads concurrently executing that loop and lies in
+ <code>[0, min(maxThreads, numThreads()))</code>, which allows the
+ caller to preallocate per-thread state.  The calling thread is always
+ threadID 0.
+
+ Example:
+ \code
+ Array<float> result;
+ result.resize(n);
+ ThreadPool::parallelFor(0, n, [&](int i, int threadID) {
+     result[i] = expensiveFunction(i);
+ });
+ \endcode
+
+ \sa GThread::runConcurrently2D, GThread, ThreadSet
+*/
+class ThreadPool {
+public:
+
+    /** Executes iterations <code>begin <= i < end</code> on thread \a threadID */
+    typedef std::function<void (int begin, int end, int threadID)> RangeFunction;
+
+    /** Executes every pixel <code>tileStart <= P < tileEnd</code> on thread \a threadID */
+    typedef std::function<void (const Vector2int32& tileStart, const Vector2int32& tileEnd, int threadID)> TileFunction;
+
+    /** Maximum number of threads that can execute a single loop,
+        including the calling thread. */
+    static int numThreads();
+
+    /**
+      \brief Invokes \a body on disjoint subranges that exactly cover
+      <code>[start, upTo)</code> and blocks until all have completed.
+
+      This is the most efficient entry point because the body is
+      invoked once per chunk instead of once per iteration.
+
+      \param grainSize Ranges no larger than this are never split.  If
+      less than one, a grain size is chosen that produces several
+      chunks per thread.
+
+      \param maxThreads Maximum number of threads, including the
+      caller, that may participate.  Values less than one (e.g.,
+      GThread::NUM_CORES) allow every thread in the pool.
+     */
+    static void parallelForRange
+    (int                    start,
+     int                    upTo,
+     const RangeFunction&   body,
+     int                    grainSize  = 0,
+     int                    maxThreads = -1);
+
+    /** Evaluates \a body(i, threadID) for every <code>start <= i < upTo</code>
+        and blocks until all have completed. \sa parallelForRange */
+    static void parallelFor
+    (int                    start,
+     int                    upTo,
+     const std::function<void (int i, int threadID)>& body,
+     int                    grainSize  = 0,
+     int                    maxThreads = -1);
+
+    /** Invokes \a body on tiles of at most \a tileSize pixels that
+        exactly cover the rectangle <code>[start, upTo)</code> and
+        blocks until all have completed. */
+    static void parallelForTiles
+    (const Vector2int32&    start,
+     const Vector2int32&    upTo,
+     const TileFunction&    body,
+     const Vector2int32&    tileSize   = Vector2int32(32, 8),
+     int                    maxThreads = -1);
+
+    /** Evaluates \a body(x, y, threadID) for every pixel in the
+        rectangle <code>[start, upTo)</code> and blocks until all have
+        completed.  Pixels are visited in row-major order within
+        each tile of \a tileSize pixels. */
+    static void parallelFor2D
+    (const Vector2int32&    start,
+     const Vector2int32&    upTo,
+     const std::function<void (int x, int y, int threadID)>& body,
+     const Vector2int32&    tileSize   = Vector2int32(32, 8),
+     int                    maxThreads = -1);
+};
+
+} // namespace G3D
+
+#endif
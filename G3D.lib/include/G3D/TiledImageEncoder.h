@@ -0,0 +1,170 @@
+/**
+  \file G3D/TiledImageEncoder.h
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+  \created 2026-10-17
+  \edited  2026-10-17
+
+  Copyright 2000-2016, Morgan McGuire.
+  All rights reserved.
+ */
+#ifndef G3D_TiledImageEncoder_h
+#define G3D_TiledImageEncoder_h
+
+#include "G3D/platform.h"
+#include "G3D/Array.h"
+#include "G3D/Image.h"
+#include "G3D/ReferenceCount.h"
+#include "G3D/Vector2int32.h"
+
+namespace G3D {
+
+class BinaryInput;
+class BinaryOutput;
+class PixelTransferBuffer;
+
+/**
+  \brief Compresses a stream of frames for transmission by sending only the
+  tiles that changed since the previous frame.
+
+  Each frame is divided into square tiles. The encoder remembers a 64-bit hash of
+  every tile of the previous frame and compresses (with Image::serialize, in
+  parallel on the ThreadPool) only the tiles whose hash changed.  For mostly-static
+  content such as a GUI or a visualization dashboard, this reduces both the
+  bandwidth and the server's encoding time by orders of magnitude compared to
+  compressing every full frame.
+
+  The decoder (decode()) keeps an Image and pastes each received tile into it.
+  A keyframe contains every tile and resets the decoder. The first frame, frames
+  after a change in resolution or format, and frames after forceKeyframe() are
+  keyframes.  Invoke forceKeyframe() when a new client connects.
+
+  The encoder assumes that every frame it produces reaches the decoder, so a
+  network layer must not drop frames (or must force a keyframe after dropping).
+  A tile whose contents changed but whose hash did not (with probability about 2^-64
+  per tile) is not resent until it changes again; Settings::keyframeInterval bounds
+  how long such an error can persist.
+
+  Example:
+  \code
+  TiledImageEncoder::Frame frame;
+  encoder->encode(image->toPixelTransferBuffer(), frame);
+  if (frame.tile.size() > 0) {
+      BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+      frame.serialize(bo);
+      send(bo);
+  }
+
+  // On the client
+  TiledImageEncoder::Frame frame;
+  frame.deserialize(bi);
+  TiledImageEncoder::decode(frame, image);
+  \endcode
+
+  \sa Image, CPUPixelTransferBuffer, ThreadPool
+ */
+class TiledImageEncoder : public ReferenceCountedObject {
+public:
+
+    class Settings {
+    public:
+        /** Width and height of a tile in pixels.  Use a multiple of 16 with Image::JPEG,
+            so that JPEG's blocks align with tile boundaries and no seams appear between tiles. */
+        int                         tileSize;
+
+        /** Image::PNG for lossless compression or Image::JPEG for less bandwidth */
+        Image::ImageFileFormat      fileFormat;
+
+        /** If positive, every keyframeInterval-th frame is a keyframe. */
+        int                         keyframeInterval;
+
+        Settings() : tileSize(64), fileFormat(Image::PNG), keyframeInterval(0) {}
+    };
+
+    class Tile {
+    public:
+        /** Upper-left corner in pixels */
+        Point2int32                 origin;
+
+        /** Less than Settings::tileSize along the right and bottom edges of the frame */
+        int                         width;
+        int                         height;
+
+        /** The tile's pixels in the Frame's fileFormat */
+        Array<uint8>                data;
+
+        Tile() : width(0), height(0) {}
+    };
+
+    /** The changes from one frame to the next */
+    class Frame {
+    public:
+        int                         width;
+        int                         height;
+
+        /** Sequence number, starting from zero for each encoder */
+        int64                       index;
+
+        /** If true, tile covers the entire frame */
+        bool                        keyframe;
+
+        Image::ImageFileFormat      fileFormat;
+
+        /** The tiles that changed, in row-major order.  Empty if nothing changed. */
+        Array<Tile>                 tile;
+
+        Frame() : width(0), height(0), index(0), keyframe(false), fileFormat(Image::PNG) {}
+
+        /** Total size of the compressed tile data in bytes */
+        size_t dataSize() const;
+
+        void serialize(BinaryOutput& b) const;
+
+        void deserialize(BinaryInput& b);
+    };
+
+protected:
+
+    Settings                        m_settings;
+
+    /** Dimensions and format of the previous frame */
+    int                             m_width;
+    int                             m_height;
+    const ImageFormat*              m_format;
+
+    /** Hash of each tile of the previous frame, in row-major order */
+    Array<uint64>                   m_tileHash;
+
+    int64                           m_nextIndex;
+
+    bool                            m_forceKeyframe;
+
+    TiledImageEncoder(const Settings& settings);
+
+public:
+
+    static shared_ptr<TiledImageEncoder> create(const Settings& settings = Settings());
+
+    const Settings& settings() const {
+        return m_settings;
+    }
+
+    /** Compresses the tiles of \a src that differ from the previous frame into \a result.
+        \a src must have a format with a whole number of bytes per pixel, and for
+        Image::JPEG it must be convertible to ImageFormat::RGB8().  To encode an Image or Texture,
+        pass its toPixelTransferBuffer(). */
+    void encode(const shared_ptr<PixelTransferBuffer>& src, Frame& result);
+
+    /** Makes the next frame a keyframe */
+    void forceKeyframe() {
+        m_forceKeyframe = true;
+    }
+
+    /** Applies \a frame to \a dst.  If the frame is a keyframe, resizes \a dst to match it.
+        Frames must be decoded in the order that they were encoded. */
+    static void decode(const Frame& frame, const shared_ptr<Image>& dst);
+};
+
+} // namespace G3D
+
+#endif
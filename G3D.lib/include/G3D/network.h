@@ -14,7 +14,7 @@
  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
  \created 2013-01-03
- \edited  2013-04-12
+ \edited  2026-10-17
  */   
 #ifndef G3D_network_h
 #define G3D_network_h
@@ -42,6 +42,8 @@ class NetAddress;
 
 namespace _internal {
     class NetMessageQueue;
+    class NetSendQueue;
+    class NetworkThread;
     class NetClientSideConnection;
     class NetServerSideConnection;
 }
@@ -90,8 +92,11 @@ RealTime networkCommunicationInterval();
   network connections.  State (such as connection status and sending messages) will only update
   inside this call--all other network calls queue for processing.
 
-  If using G3D's internal threaded networking, this is automatically called continuously on 
-  a separate thread. 
+  If using G3D's internal threaded networking, this is automatically called on 
+  a separate thread.  That thread sleeps in select() on the sockets of all hosts and
+  wakes when a packet arrives, when a message is sent from the application, or 
+  every few milliseconds to let enet retransmit and ping, so it does not occupy 
+  a core while the network is idle.
 
    \sa setNetworkCommunicationInterval, G3D::G3DSpecification::threadedNetwork
 */
@@ -128,12 +133,30 @@ protected:
 
 public:
 
-    /** Size of the data in bytes for the current message. */
+    /** Size of the data in bytes for the current message, summed over all parts. */
     size_t size() const;
 
-    /** The raw data bytes for the current message. */
+    /** The raw data bytes for the current message.  For a message with more than one part, 
+        the parts are concatenated into a new buffer on the first call; use partData() to
+        avoid that copy. */
     void* data() const;
 
+    /** Number of payload buffers with which the current message was sent. Messages sent
+        with a single buffer or a BinaryOutput have one part.
+        \sa NetSendConnection::send(NetMessageType, const NetBufferView&, const NetBufferView*, int, NetChannel) */
+    int numParts() const;
+
+    /** Size in bytes of one part of the current message */
+    size_t partSize(int part) const;
+
+    /** The bytes of one part of the current message, directly in the received packet */
+    void* partData(int part) const;
+
+    /** A BinaryInput that reads one part of the current message directly from the received
+        packet, without copying.  Allocated on demand and deallocated when the iterator is
+        incremented with operator++. */
+    BinaryInput& partBinaryInput(int part) const;
+
     /** Application-defined type header for this message */
     NetMessageType type() const;
 
@@ -142,7 +165,8 @@ public:
 
     /** A BinaryInput for the current message.  This is allocated on demand and
         deallocated when the iterator is incremented with operator++.  It is
-        shared across copies of the iterator.
+        shared across copies of the iterator.  It reads directly from the received
+        packet unless the message has more than one part (see data()).
     */
     BinaryInput& binaryInput() const;
 
@@ -200,6 +224,59 @@ public:
 };
 
 
+/** 
+  Counters for a NetSendConnection, NetConnection, or NetServer, for measuring
+  throughput and the delay added by G3D's send queues.  The counters are cumulative
+  from the creation of the connection, so rates are obtained by dividing
+  by duration or by differencing two snapshots.
+
+  \sa NetSendConnection::statistics, NetServer::statistics
+ */
+class NetStatistics {
+public:
+    /** Messages handed to enet for transmission. A broadcast on a NetServer::omniConnection counts once. */
+    uint64      messagesSent;
+
+    /** Bytes of message data (excluding headers) handed to enet for transmission */
+    uint64      bytesSent;
+
+    /** Messages that have arrived, whether or not the application has read them yet */
+    uint64      messagesReceived;
+
+    /** Bytes of message data (excluding headers) that have arrived */
+    uint64      bytesReceived;
+
+    /** Messages sent by the application that the network thread has not yet handed to enet */
+    int         messagesQueued;
+
+    /** Mean time from NetSendConnection::send until the message was handed to enet */
+    RealTime    meanSendDelay;
+
+    /** Maximum time from NetSendConnection::send until a message was handed to enet */
+    RealTime    maxSendDelay;
+
+    /** Estimated one-way latency. For a NetServer, the mean over its connections. 
+        \sa NetConnection::latency */
+    RealTime    latency;
+
+    /** Time since the connection (or server) was created */
+    RealTime    duration;
+
+    NetStatistics() : messagesSent(0), bytesSent(0), messagesReceived(0), bytesReceived(0), messagesQueued(0),
+        meanSendDelay(0), maxSendDelay(0), latency(0), duration(0) {}
+
+    /** Average outgoing data rate over duration, in bytes per second */
+    double sendBytesPerSecond() const {
+        return (duration > 0) ? double(bytesSent) / duration : 0.0;
+    }
+
+    /** Average incoming data rate over duration, in bytes per second */
+    double receiveBytesPerSecond() const {
+        return (duration > 0) ? double(bytesReceived) / duration : 0.0;
+    }
+};
+
+
 /** 
   Manages connections for a machine that accepts incoming ones.  This
   is similar to a TCP listener socket, but also supports efficient sending to
@@ -216,6 +293,7 @@ class NetServer : public ReferenceCountedObject {
 public:
     friend class _internal::NetServerSideConnection;
     friend class NetConnectionIterator;
+    friend class _internal::NetworkThread;
     friend void serviceNetwork();
 
     /** \sa connectToServer */
@@ -238,6 +316,10 @@ protected:
 
     NetServer(_ENetHost* host);
 
+    /** Hand the messages queued on omniConnection() and all clients to enet, in the order in
+        which they were sent. Invoked by serviceHost() while holding the network lock. */
+    void sendQueuedMessages();
+
     /** Service the ENetHost, checking for incoming messages and connections and depositing them
         in the appropriate queues. Invoked by NetServerSideConnection::serviceHost(), 
         incomingConnectionIterator(), and incomingConnectionIterator(). */
@@ -273,6 +355,10 @@ public:
 
     /** Stop listenening for connections and shut down all clients. */
     void stop();
+
+    /** Totals over the omniConnection() and all currently connected clients.
+        Messages broadcast through the omniConnection() are counted once. */
+    NetStatistics statistics() const;
 };
 
 class NetSendConnection;
@@ -296,6 +382,35 @@ public:
 };
 }
 
+/** 
+  A region of memory to be transmitted by NetSendConnection::send.  Several views can
+  be sent as one message, so that an application can transmit data from where it
+  already lives (e.g., a header struct and several arrays of entity state) without
+  first serializing into a single BinaryOutput.
+
+  \sa NetMessageIterator::partBinaryInput
+ */
+class NetBufferView {
+public:
+    const void*                 data;
+
+    size_t                      size;
+
+    /** If not null, the data is transmitted directly from this memory and is freed with this 
+        manager once enet is done with it, so do not modify or free it after
+        sending.  If null, the data is copied when sent and the caller retains ownership. */
+    shared_ptr<MemoryManager>   memoryManager;
+
+    NetBufferView() : data(NULL), size(0) {}
+
+    NetBufferView(const void* d, size_t s, const shared_ptr<MemoryManager>& m = shared_ptr<MemoryManager>()) : 
+        data(d), size(s), memoryManager(m) {}
+
+    /** The current contents of an in-memory BinaryOutput, which will be copied when sent */
+    explicit NetBufferView(const BinaryOutput& bo) : data(bo.getCArray()), size(size_t(bo.size())) {}
+};
+
+
 /** 
  Base class for NetConnection that provides only the sending
  functionality.  This is only used for NetServer::broadcast(), where
@@ -317,7 +432,12 @@ protected:
     /** Callbacks to be run the next time any method is invoked */
     ThreadsafeQueue<_internal::NetworkCallbackInfo> m_freeQueue;
 
-    NetSendConnection(_ENetPeer* p, _ENetHost* h) : m_enetPeer(p), m_enetHost(h) {}
+    /** Lock-free queue of messages waiting for the network thread to hand them to enet.
+        Each connection has its own queue so that senders on different connections
+        never contend. */
+    shared_ptr<_internal::NetSendQueue> m_sendQueue;
+
+    NetSendConnection(_ENetPeer* p, _ENetHost* h);
 
     /** Acutally send the packet with enet.  This allows code reuse with NetConnection, which
         has a different sending mechanism. */
@@ -326,6 +446,15 @@ protected:
 
     void processFreeQueue();
 
+    /** False while the connection is being established, during which messages remain queued */
+    bool readyToSend() const;
+
+    /** Hand all queued messages to enet.  Invoked while holding the network lock, 
+        so there is only ever one consumer of m_sendQueue.
+        Returns true if any message was sent, in which case the caller must flush the host. 
+        \sa NetServer::sendQueuedMessages */
+    bool processSendQueue();
+
 public:
 
     /** Schedule for sending across this connection.
@@ -368,8 +497,32 @@ public:
     /** Includes a header.  The header should be fairly small to avoid increasing latency during the extra copies required. */
     void send(NetMessageType type, BinaryOutput& bo, BinaryOutput& header, NetChannel channel = 0);
 
+    /** Scatter/gather send of one message composed of several buffers.
+
+        The \a header is copied (along with G3D's own message header) into a single small packet and
+        appears to the receiver as NetMessageIterator::headerBinaryInput.  It may be empty.
+
+        Each payload view is handed to enet as its own packet. Views with a memoryManager are
+        transmitted from the application's memory without any copy. The receiver sees a single 
+        message with NetMessageIterator::numParts() == \a numPayloadViews (at least one) and
+        can read each part in place with NetMessageIterator::partBinaryInput.
+
+        Prefer this over the BinaryOutput overloads for large, high-rate traffic such as
+        state replication, where serializing and copying the data would dominate.
+
+        \sa networkSendBacklog
+    */
+    void send(NetMessageType type, const NetBufferView& header, const NetBufferView* payload, int numPayloadViews, NetChannel channel = 0);
+
+    void send(NetMessageType type, const NetBufferView& header, const Array<NetBufferView>& payload, NetChannel channel = 0) {
+        send(type, header, payload.getCArray(), payload.size(), channel);
+    }
+
     /** Address of the other side of the connection */
     virtual NetAddress address() const;
+
+    /** Throughput and send delay counters. Safe to invoke from any thread. */
+    virtual NetStatistics statistics() const;
 };
 
 
@@ -493,6 +646,9 @@ public:
     /** A measure of variance for latency(). */
     RealTime latencyVariance() const;
 
+    /** Includes the received message counters and latency(). */
+    virtual NetStatistics statistics() const override;
+
     /** Check the network for new messages and return an iterator over them.
         This always returns the same iterator for a single NetConnection. */
     NetMessageIterator& incomingMessageIterator();
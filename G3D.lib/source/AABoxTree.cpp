@@ -0,0 +1,433 @@
+/**
+  \file AABoxTree.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+ */
+
+#include "G3D/AABoxTree.h"
+#include "G3D/Ray.h"
+#include "G3D/Sphere.h"
+#include "G3D/SmallArray.h"
+#include "G3D/ThreadPool.h"
+#include <algorithm>
+
+namespace G3D {
+
+/** Number of candidate split planes per axis */
+static const int NUM_BINS = 16;
+
+/** getIntersectingPairs() divides the traversal into about this many tasks per thread */
+static const int PAIR_TASKS_PER_THREAD = 16;
+
+
+void AABoxTree::clear() {
+    m_node.clear();
+    m_value.clear();
+    m_bounds.clear();
+    m_buildCost = 0.0f;
+}
+
+
+void AABoxTree::setContents(const Array<AABox>& boundsArray, const Settings& settings) {
+    clear();
+    m_settings = settings;
+    m_bounds.copyFrom(boundsArray);
+    if (m_bounds.size() == 0) {
+        return;
+    }
+
+    Array<Point3> centroid;
+    centroid.resize(m_bounds.size());
+    m_value.resize(m_bounds.size());
+    for (int i = 0; i < m_bounds.size(); ++i) {
+        debugAssertM(! m_bounds[i].isEmpty() && m_bounds[i].isFinite(), "AABoxTree members must have finite, nonempty bounds");
+        centroid[i] = m_bounds[i].center();
+        m_value[i] = i;
+    }
+
+    // A binary tree with at least one member per leaf has fewer than 2n nodes
+    m_node.reserve(2 * m_bounds.size());
+    m_node.next();
+    build(0, 0, m_bounds.size(), centroid);
+
+    m_buildCost = computeCost();
+}
+
+
+void AABoxTree::build(int index, int begin, int end, const Array<Point3>& centroid) {
+    AABox bounds;
+    AABox centroidBounds;
+    for (int i = begin; i < end; ++i) {
+        bounds.merge(m_bounds[m_value[i]]);
+        centroidBounds.merge(centroid[m_value[i]]);
+    }
+    m_node[index].bounds = bounds;
+
+    const int n = end - begin;
+    if (n <= max(1, m_settings.valuesPerLeaf)) {
+        m_node[index].first = begin;
+        m_node[index].count = n;
+        return;
+    }
+
+    const Vector3::Axis axis = centroidBounds.extent().primaryAxis();
+    const float low  = centroidBounds.low()[axis];
+    const float extent = centroidBounds.extent()[axis];
+
+    int mid = begin;
+    if (extent > 0.0f) {
+        // Binned surface area heuristic
+        int   binCount[NUM_BINS];
+        AABox binBounds[NUM_BINS];
+        for (int b = 0; b < NUM_BINS; ++b) {
+            binCount[b] = 0;
+        }
+
+        const float scale = NUM_BINS / extent;
+        for (int i = begin; i < end; ++i) {
+            const int b = iClamp(int((centroid[m_value[i]][axis] - low) * scale), 0, NUM_BINS - 1);
+            ++binCount[b];
+            binBounds[b].merge(m_bounds[m_value[i]]);
+        }
+
+        // Area and count of everything below each candidate plane
+        float belowArea[NUM_BINS];
+        int   belowCount[NUM_BINS];
+        AABox box;
+        int count = 0;
+        for (int b = 0; b < NUM_BINS - 1; ++b) {
+            box.merge(binBounds[b]);
+            count += binCount[b];
+            belowArea[b]  = box.isEmpty() ? 0.0f : box.area();
+            belowCount[b] = count;
+        }
+
+        int bestPlane = -1;
+        float bestCost = finf();
+        box = AABox();
+        count = 0;
+        for (int b = NUM_BINS - 1; b > 0; --b) {
+            box.merge(binBounds[b]);
+            count += binCount[b];
+            const float cost = belowArea[b - 1] * belowCount[b - 1] + (box.isEmpty() ? 0.0f : box.area()) * count;
+            if ((belowCount[b - 1] > 0) && (count > 0) && (cost < bestCost)) {
+                bestCost = cost;
+                bestPlane = b;
+            }
+        }
+
+        if (bestPlane > 0) {
+            mid = int(std::partition(m_value.getCArray() + begin, m_value.getCArray() + end, [&](int v) {
+                return iClamp(int((centroid[v][axis] - low) * scale), 0, NUM_BINS - 1) < bestPlane;
+            }) - m_value.getCArray());
+        }
+    }
+
+    if ((mid == begin) || (mid == end)) {
+        // Coincident centroids: split by count
+        mid = begin + n / 2;
+        std::nth_element(m_value.getCArray() + begin, m_value.getCArray() + mid, m_value.getCArray() + end, [&](int a, int b) {
+            return centroid[a][axis] < centroid[b][axis];
+        });
+    }
+
+    const int first = m_node.size();
+    m_node[index].first = first;
+    m_node[index].count = 0;
+    m_node.next();
+    m_node.next();
+    build(first, begin, mid, centroid);
+    build(first + 1, mid, end, centroid);
+}
+
+
+float AABoxTree::computeCost() const {
+    if (m_node.size() == 0) {
+        return 0.0f;
+    }
+
+    // Unit cost for entering a node and for testing a member
+    float cost = 0.0f;
+    for (int i = 0; i < m_node.size(); ++i) {
+        const Node& node = m_node[i];
+        cost += node.bounds.area() * ((node.count > 0) ? float(node.count) : 1.0f);
+    }
+    return cost / max(m_node[0].bounds.area(), 1e-20f);
+}
+
+
+bool AABoxTree::refit(const Array<AABox>& boundsArray) {
+    alwaysAssertM(boundsArray.size() == m_bounds.size(), "refit() requires the same number of members as setContents()");
+    m_bounds.copyFrom(boundsArray);
+
+    // Children always follow their parents
+    for (int i = m_node.size() - 1; i >= 0; --i) {
+        Node& node = m_node[i];
+        if (node.count > 0) {
+            node.bounds = m_bounds[m_value[node.first]];
+            for (int v = node.first + 1; v < node.first + node.count; ++v) {
+                node.bounds.merge(m_bounds[m_value[v]]);
+            }
+        } else {
+            node.bounds = m_node[node.first].bounds;
+            node.bounds.merge(m_node[node.first + 1].bounds);
+        }
+    }
+
+    if (computeCost() > m_settings.refitRebuildThreshold * m_buildCost) {
+        const Array<AABox> bounds(m_bounds);
+        setContents(bounds, m_settings);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+
+/** Time at which \a ray enters \a box, or finf() if that is not before \a maxDistance */
+static float entryTime(const Ray& ray, const AABox& box, float maxDistance) {
+    float t0 = 0.0f;
+    float t1 = maxDistance;
+    for (int a = 0; a < 3; ++a) {
+        const float o = ray.origin()[a];
+        if (ray.direction()[a] == 0.0f) {
+            // Parallel to this slab
+            if ((o < box.low()[a]) || (o > box.high()[a])) {
+                return finf();
+            }
+        } else {
+            const float inv = ray.invDirection()[a];
+            float nearT = (box.low()[a] - o) * inv;
+            float farT  = (box.high()[a] - o) * inv;
+            if (nearT > farT) {
+                std::swap(nearT, farT);
+            }
+            t0 = max(t0, nearT);
+            t1 = min(t1, farT);
+            if (t0 > t1) {
+                return finf();
+            }
+        }
+    }
+
+    return (t0 < maxDistance) ? t0 : finf();
+}
+
+
+void AABoxTree::intersectRay(const Ray& ray, float& distance, const RayCallback& callback) const {
+    if (m_node.size() == 0) {
+        return;
+    }
+
+    class StackEntry {
+    public:
+        int     node;
+        float   time;
+        StackEntry() {}
+        StackEntry(int n, float t) : node(n), time(t) {}
+    };
+
+    SmallArray<StackEntry, 64> stack;
+    const float rootTime = entryTime(ray, m_node[0].bounds, distance);
+    if (rootTime < finf()) {
+        stack.append(StackEntry(0, rootTime));
+    }
+
+    while (stack.size() > 0) {
+        const StackEntry entry = stack.pop();
+        if (entry.time >= distance) {
+            // A closer member was found after this node was pushed
+            continue;
+        }
+
+        const Node& node = m_node[entry.node];
+        if (node.count > 0) {
+            for (int v = node.first; v < node.first + node.count; ++v) {
+                const int index = m_value[v];
+                if (entryTime(ray, m_bounds[index], distance) < finf()) {
+                    callback(index, distance);
+                }
+            }
+        } else {
+            float t0 = entryTime(ray, m_node[node.first].bounds, distance);
+            float t1 = entryTime(ray, m_node[node.first + 1].bounds, distance);
+            int c0 = node.first;
+            int c1 = node.first + 1;
+            if (t1 < t0) {
+                std::swap(t0, t1);
+                std::swap(c0, c1);
+            }
+
+            // Push the farther child first so that the nearer one is visited first
+            if (t1 < finf()) {
+                stack.append(StackEntry(c1, t1));
+            }
+            if (t0 < finf()) {
+                stack.append(StackEntry(c0, t0));
+            }
+        }
+    }
+}
+
+
+void AABoxTree::getIntersectingMembers(const AABox& box, Array<int>& members) const {
+    if (m_node.size() == 0) {
+        return;
+    }
+
+    SmallArray<int, 64> stack;
+    stack.append(0);
+    while (stack.size() > 0) {
+        const Node& node = m_node[stack.pop()];
+        if (! node.bounds.intersects(box)) {
+            continue;
+        } else if (node.count > 0) {
+            for (int v = node.first; v < node.first + node.count; ++v) {
+                if (m_bounds[m_value[v]].intersects(box)) {
+                    members.append(m_value[v]);
+                }
+            }
+        } else {
+            stack.append(node.first, node.first + 1);
+        }
+    }
+}
+
+
+void AABoxTree::getIntersectingMembers(const Sphere& sphere, Array<int>& members) const {
+    if (m_node.size() == 0) {
+        return;
+    }
+
+    SmallArray<int, 64> stack;
+    stack.append(0);
+    while (stack.size() > 0) {
+        const Node& node = m_node[stack.pop()];
+        if (! node.bounds.intersects(sphere)) {
+            continue;
+        } else if (node.count > 0) {
+            for (int v = node.first; v < node.first + node.count; ++v) {
+                if (m_bounds[m_value[v]].intersects(sphere)) {
+                    members.append(m_value[v]);
+                }
+            }
+        } else {
+            stack.append(node.first, node.first + 1);
+        }
+    }
+}
+
+
+void AABoxTree::intersectSelf(int a, Array<Vector2int32>& pairs) const {
+    const Node& A = m_node[a];
+    if (A.count > 0) {
+        for (int u = A.first; u < A.first + A.count; ++u) {
+            for (int v = u + 1; v < A.first + A.count; ++v) {
+                if (m_bounds[m_value[u]].intersects(m_bounds[m_value[v]])) {
+                    pairs.append(Vector2int32(min(m_value[u], m_value[v]), max(m_value[u], m_value[v])));
+                }
+            }
+        }
+    } else {
+        intersectSelf(A.first, pairs);
+        intersectSelf(A.first + 1, pairs);
+        intersectNodes(A.first, A.first + 1, pairs);
+    }
+}
+
+
+void AABoxTree::intersectNodes(int a, int b, Array<Vector2int32>& pairs) const {
+    const Node& A = m_node[a];
+    const Node& B = m_node[b];
+    if (! A.bounds.intersects(B.bounds)) {
+        return;
+    }
+
+    if ((A.count > 0) && (B.count > 0)) {
+        for (int u = A.first; u < A.first + A.count; ++u) {
+            const AABox& box = m_bounds[m_value[u]];
+            if (! box.intersects(B.bounds)) {
+                continue;
+            }
+            for (int v = B.first; v < B.first + B.count; ++v) {
+                if (box.intersects(m_bounds[m_value[v]])) {
+                    pairs.append(Vector2int32(min(m_value[u], m_value[v]), max(m_value[u], m_value[v])));
+                }
+            }
+        }
+    } else if ((B.count > 0) || ((A.count == 0) && (A.bounds.area() >= B.bounds.area()))) {
+        // Descend into the larger node
+        intersectNodes(A.first, b, pairs);
+        intersectNodes(A.first + 1, b, pairs);
+    } else {
+        intersectNodes(a, B.first, pairs);
+        intersectNodes(a, B.first + 1, pairs);
+    }
+}
+
+
+void AABoxTree::getIntersectingPairs(Array<Vector2int32>& pairs) const {
+    if (m_node.size() == 0) {
+        return;
+    }
+
+    // Unroll the top of the recursion into independent tasks.  A task (a, a)
+    // is intersectSelf(a) and (a, b) is intersectNodes(a, b).
+    Array<Vector2int32> task, next;
+    task.append(Vector2int32(0, 0));
+    const int targetTasks = PAIR_TASKS_PER_THREAD * ThreadPool::numThreads();
+    bool expanded = true;
+    while (expanded && (task.size() < targetTasks)) {
+        expanded = false;
+        next.fastClear();
+        for (int t = 0; t < task.size(); ++t) {
+            const int a = task[t].x;
+            const int b = task[t].y;
+            const Node& A = m_node[a];
+            const Node& B = m_node[b];
+            if (a == b) {
+                if (A.count > 0) {
+                    next.append(task[t]);
+                } else {
+                    next.append(Vector2int32(A.first, A.first), Vector2int32(A.first + 1, A.first + 1), Vector2int32(A.first, A.first + 1));
+                    expanded = true;
+                }
+            } else if (! A.bounds.intersects(B.bounds)) {
+                expanded = true;
+            } else if ((A.count > 0) && (B.count > 0)) {
+                next.append(task[t]);
+            } else if ((B.count > 0) || ((A.count == 0) && (A.bounds.area() >= B.bounds.area()))) {
+                next.append(Vector2int32(A.first, b), Vector2int32(A.first + 1, b));
+                expanded = true;
+            } else {
+                next.append(Vector2int32(a, B.first), Vector2int32(a, B.first + 1));
+                expanded = true;
+            }
+        }
+        Array<Vector2int32>::swap(task, next);
+    }
+
+    Array<Array<Vector2int32> > taskPairs;
+    taskPairs.resize(task.size());
+    ThreadPool::parallelFor(0, task.size(), [&](int t, int threadID) {
+        if (task[t].x == task[t].y) {
+            intersectSelf(task[t].x, taskPairs[t]);
+        } else {
+            intersectNodes(task[t].x, task[t].y, taskPairs[t]);
+        }
+    }, 1);
+
+    int numPairs = pairs.size();
+    for (int t = 0; t < taskPairs.size(); ++t) {
+        numPairs += taskPairs[t].size();
+    }
+    pairs.reserve(numPairs);
+    for (int t = 0; t < taskPairs.size(); ++t) {
+        pairs.append(taskPairs[t]);
+    }
+}
+
+} // namespace G3D
@@ -5,7 +5,7 @@
  \author Shawn Yarbrough
   
  \created 2006-06-11
- \edited  2013-03-29
+ \edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -19,6 +19,8 @@
 #include "G3D/stringutils.h"
 #include "G3D/fileutils.h"
 #include "G3D/FileSystem.h"
+#include "G3D/Crypto.h"
+#include "G3D/SpeedLoad.h"
 #include <deque>
 #include <iostream>
 
@@ -50,6 +52,183 @@ void Any::deserialize(BinaryInput& b) {
 }
 
 
+/** Set in the first byte of a speedSerialize() node that carries Any::Data fields */
+static const uint8 SPEED_HAS_DATA = 0x80;
+
+static int internString(const String& s, Table<String, int>& stringTable, Array<String>& stringArray) {
+    bool created = false;
+    int& index = stringTable.getCreate(s, created);
+    if (created) {
+        index = stringArray.size();
+        stringArray.append(s);
+    }
+    return index;
+}
+
+
+void Any::speedSerialize(BinaryOutput& b) const {
+    beforeRead();
+
+    // Write the nodes first to discover the strings, then write the strings ahead of them
+    Table<String, int> stringTable;
+    Array<String> stringArray;
+    BinaryOutput nodes("<memory>", b.endian());
+    speedSerialize(nodes, stringTable, stringArray);
+
+    b.writeInt32(stringArray.size());
+    for (int i = 0; i < stringArray.size(); ++i) {
+        b.writeString32(stringArray[i]);
+    }
+    b.writeBytes(nodes.getCArray(), nodes.size());
+}
+
+
+void Any::speedSerialize(BinaryOutput& b, Table<String, int>& stringTable, Array<String>& stringArray) const {
+    // Scalars only need their data for the properties that affect unparsing
+    const bool hasData = notNull(m_data) &&
+        (((m_type != NIL) && (m_type != BOOLEAN) && (m_type != NUMBER)) ||
+         ! m_data->name.empty() || ! m_data->includeLine.empty() || m_data->hexInteger);
+
+    b.writeUInt8(uint8(m_type) | (hasData ? SPEED_HAS_DATA : 0));
+    if (hasData) {
+        b.writeInt32(internString(m_data->name, stringTable, stringArray));
+        b.writeInt32(internString(m_data->includeLine, stringTable, stringArray));
+        b.writeInt32(internString(m_data->source.filename, stringTable, stringArray));
+        b.writeInt32(m_data->source.line);
+        b.writeInt32(m_data->source.character);
+        const char* bracket = m_data->bracket;
+        b.writeUInt8((bracket == PAREN) ? 1 : (bracket == BRACKET) ? 2 : (bracket == BRACE) ? 3 : 0);
+        b.writeUInt8(m_data->separator);
+        b.writeBool8(m_data->hexInteger);
+    }
+
+    switch (m_type) {
+    case NIL:
+    case EMPTY_CONTAINER:
+        break;
+
+    case BOOLEAN:
+        b.writeBool8(m_simpleValue.b);
+        break;
+
+    case NUMBER:
+        b.writeFloat64(m_simpleValue.n);
+        break;
+
+    case STRING:
+        b.writeInt32(internString(*m_data->value.s, stringTable, stringArray));
+        break;
+
+    case ARRAY:
+        {
+            const AnyArray& array = *m_data->value.a;
+            b.writeInt32(array.size());
+            for (int i = 0; i < array.size(); ++i) {
+                array[i].speedSerialize(b, stringTable, stringArray);
+            }
+        }
+        break;
+
+    case TABLE:
+        {
+            // Placeholders were never assigned, so they are not part of the value
+            const AnyTable& table = *m_data->value.t;
+            int n = 0;
+            for (AnyTable::Iterator it = table.begin(); it.isValid(); ++it) {
+                if (! it->value.isPlaceholder()) {
+                    ++n;
+                }
+            }
+            b.writeInt32(n);
+            for (AnyTable::Iterator it = table.begin(); it.isValid(); ++it) {
+                if (! it->value.isPlaceholder()) {
+                    b.writeInt32(internString(it->key, stringTable, stringArray));
+                    it->value.speedSerialize(b, stringTable, stringArray);
+                }
+            }
+        }
+        break;
+    }
+}
+
+
+void Any::speedDeserialize(BinaryInput& b) {
+    beforeRead();
+    Array<String> stringArray;
+    stringArray.resize(b.readInt32());
+    for (int i = 0; i < stringArray.size(); ++i) {
+        stringArray[i] = b.readString32();
+    }
+    speedDeserialize(b, stringArray);
+}
+
+
+void Any::speedDeserialize(BinaryInput& b, const Array<String>& stringArray) {
+    dropReference();
+    m_placeholderName = "";
+    m_simpleValue.n = 0.0;
+
+    const uint8 header = b.readUInt8();
+    m_type = Type(header & ~SPEED_HAS_DATA);
+
+    if ((header & SPEED_HAS_DATA) != 0) {
+        const String& name        = stringArray[b.readInt32()];
+        const String& includeLine = stringArray[b.readInt32()];
+        Source source;
+        source.filename  = stringArray[b.readInt32()];
+        source.line      = b.readInt32();
+        source.character = b.readInt32();
+        static const char* bracketTable[] = {NULL, PAREN, BRACKET, BRACE};
+        const char* bracket = bracketTable[b.readUInt8() & 3];
+        const char separator = char(b.readUInt8());
+        const bool hexInteger = b.readBool8();
+
+        m_data = Data::create(m_type, bracket, separator, hexInteger);
+        m_data->name        = name;
+        m_data->includeLine = includeLine;
+        m_data->source      = source;
+    }
+
+    switch (m_type) {
+    case NIL:
+    case EMPTY_CONTAINER:
+        break;
+
+    case BOOLEAN:
+        m_simpleValue.b = b.readBool8();
+        break;
+
+    case NUMBER:
+        m_simpleValue.n = b.readFloat64();
+        break;
+
+    case STRING:
+        *m_data->value.s = stringArray[b.readInt32()];
+        break;
+
+    case ARRAY:
+        {
+            AnyArray& array = *m_data->value.a;
+            array.resize(b.readInt32());
+            for (int i = 0; i < array.size(); ++i) {
+                array[i].speedDeserialize(b, stringArray);
+            }
+        }
+        break;
+
+    case TABLE:
+        {
+            AnyTable& table = *m_data->value.t;
+            const int n = b.readInt32();
+            for (int i = 0; i < n; ++i) {
+                table.getCreate(stringArray[b.readInt32()]).speedDeserialize(b, stringArray);
+            }
+        }
+        break;
+    }
+}
+
+
 String Any::resolveStringAsFilename(bool errorIfNotFound) const {
     verifyType(STRING);
     if ((string().length() > 0) && (string()[0] == '<') && (string()[string().length() - 1] == '>')) {
@@ -911,8 +1090,112 @@ void Any::_parse(const String& src) {
 }
 
 
+static String s_parseCacheDirectory;
+
+/** Files #included by the parse on this thread, when its result will be cached */
+static __thread Array<String>* s_includeArray = NULL;
+
+/** Increment when the parse cache or speedSerialize format changes */
+static const uint32 PARSE_CACHE_VERSION = 1;
+
+
+void Any::setParseCacheDirectory(const String& directory) {
+    s_parseCacheDirectory = directory;
+}
+
+
+const String& Any::parseCacheDirectory() {
+    return s_parseCacheDirectory;
+}
+
+
+static String md5Hex(const String& s) {
+    const MD5Hash& hash = Crypto::md5(s.c_str(), s.size());
+    String hex;
+    for (int i = 0; i < 16; ++i) {
+        hex += format("%02x", hash[i]);
+    }
+    return hex;
+}
+
+
+void Any::loadThroughParseCache(const String& filename) {
+    const String& src = readWholeFile(filename);
+    const String& cacheFilename = FilePath::concat(s_parseCacheDirectory,
+        FilePath::base(filename) + "-" + md5Hex(filename + "\n" + src) + ".AnyCache");
+
+    if (FileSystem::exists(cacheFilename, false)) {
+        BinaryInput b(cacheFilename, G3D_LITTLE_ENDIAN);
+        bool valid = (b.readString(SpeedLoad::HEADER_LENGTH) == "AnyParseCache") &&
+            (b.readUInt32() == PARSE_CACHE_VERSION) &&
+            (b.readString32() == filename);
+
+        // Reject the cache if any included file has changed since it was written
+        const int numIncludes = valid ? b.readInt32() : 0;
+        for (int i = 0; valid && (i < numIncludes); ++i) {
+            const String& includeFilename = b.readString32();
+            const String& hash = b.readString32();
+            valid = FileSystem::exists(includeFilename) && (md5Hex(readWholeFile(includeFilename)) == hash);
+        }
+
+        if (valid) {
+            speedDeserialize(b);
+            return;
+        }
+    }
+
+    // Parse the text, recording the files that it includes
+    Array<String> includeArray;
+    s_includeArray = &includeArray;
+    try {
+        TextInput::Settings settings;
+        getDeserializeSettings(settings);
+        settings.sourceFileName = filename;
+        TextInput ti(TextInput::FROM_STRING, src, settings);
+        deserialize(ti);
+    } catch (...) {
+        s_includeArray = NULL;
+        throw;
+    }
+    s_includeArray = NULL;
+
+    if (! FileSystem::exists(s_parseCacheDirectory)) {
+        FileSystem::createDirectory(s_parseCacheDirectory);
+    }
+
+    // Write to a temporary file and then rename it, so that a concurrent or
+    // interrupted load never sees a partial cache file
+    const String& tempFilename = cacheFilename + ".tmp";
+    {
+        BinaryOutput b(tempFilename, G3D_LITTLE_ENDIAN);
+        SpeedLoad::writeHeader(b, "AnyParseCache");
+        b.writeUInt32(PARSE_CACHE_VERSION);
+        b.writeString32(filename);
+        b.writeInt32(includeArray.size());
+        for (int i = 0; i < includeArray.size(); ++i) {
+            b.writeString32(includeArray[i]);
+            b.writeString32(md5Hex(readWholeFile(includeArray[i])));
+        }
+        speedSerialize(b);
+        b.commit();
+    }
+
+    if (FileSystem::exists(cacheFilename, false)) {
+        FileSystem::removeFile(cacheFilename);
+    }
+    FileSystem::rename(tempFilename, cacheFilename);
+}
+
+
 void Any::load(const String& filename) {
     beforeRead();
+
+    // Files included by a file that is being cached are parsed directly
+    if (! s_parseCacheDirectory.empty() && isNull(s_includeArray)) {
+        loadThroughParseCache(FileSystem::resolve(filename));
+        return;
+    }
+
     TextInput::Settings settings;
     getDeserializeSettings(settings);
 
@@ -1318,6 +1601,11 @@ void Any::deserialize(TextInput& ti, Token& token) {
                 t = System::findDataFile(includeName);
             }
 
+            if (notNull(s_includeArray)) {
+                // The parse cache must check this file for changes
+                s_includeArray->append(t);
+            }
+
             // Read the included file
             load(t);
 
@@ -5,7 +5,7 @@
  Copyright 2001-2013, Morgan McGuire.  All rights reserved.
  
  \created 2001-08-09
- \edited  2013-01-03
+ \edited  2026-10-17
 
 
   <PRE>
@@ -39,9 +39,14 @@
 #include "G3D/Log.h"
 #include "G3D/FileSystem.h"
 #include "../../zlib.lib/include/zlib.h"
-#include "../../zip.lib/include/zip.h"
 #include <cstring>
 
+#ifdef G3D_WINDOWS
+#   include <io.h>
+#else
+#   include <sys/mman.h>
+#endif
+
 namespace G3D {
 
 const bool BinaryInput::NO_COPY = false;
@@ -74,7 +79,8 @@ BinaryInput::BinaryInput(
     m_beginEndBits(0),
     m_alreadyRead(0),
     m_bufferLength(0),
-    m_pos(0) {
+    m_pos(0),
+    m_memoryMapped(false) {
 
     m_freeBuffer = copyMemory || compressed;
 
@@ -122,7 +128,8 @@ BinaryInput::BinaryInput
     m_bufferLength(0),
     m_buffer(NULL),
     m_pos(0),
-    m_freeBuffer(true) {
+    m_freeBuffer(true),
+    m_memoryMapped(false) {
 
     setEndian(fileEndian);
     
@@ -134,26 +141,8 @@ BinaryInput::BinaryInput
 
         // Zipfiles require Unix-style slashes
         String internalFile = FilePath::canonicalize(m_filename.substr(zipfile.length() + 1));
-        struct zip* z = zip_open(zipfile.c_str(), ZIP_CHECKCONS, NULL);
-        {
-            struct zip_stat info;
-            zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-            zip_stat(z, internalFile.c_str(), ZIP_FL_NOCASE, &info);
-            m_bufferLength = m_length = info.size;
-            // sets machines up to use MMX, if they want
-            m_buffer = reinterpret_cast<uint8*>(System::alignedMalloc(m_length, 16));
-            struct zip_file* zf = zip_fopen( z, internalFile.c_str(), ZIP_FL_NOCASE );
-            if (zf == NULL) {
-                throw String("\"") + internalFile + "\" inside \"" + zipfile + "\" could not be opened.";
-            } else {
-                const int64 bytesRead = zip_fread( zf, m_buffer, m_length );
-                debugAssertM(bytesRead == m_length,
-                             internalFile + " was corrupt because it unzipped to the wrong size.");
-                (void)bytesRead;
-                zip_fclose( zf );
-            }
-        }
-        zip_close( z );
+        m_buffer = FileSystem::readZipfileEntry(zipfile, internalFile, m_length);
+        m_bufferLength = m_length;
 
         if (compressed) {
             decompress();
@@ -174,6 +163,14 @@ BinaryInput::BinaryInput
         return;
     }
 
+    // Files larger than the initial buffer may not fit in a 32-bit address space
+    if (! compressed && (m_length >= MEMORY_MAP_MIN_LENGTH) &&
+        ((sizeof(void*) == 8) || (m_length <= INITIAL_BUFFER_LENGTH)) &&
+        memoryMap(file)) {
+        FileSystem::fclose(file);
+        return;
+    }
+
     if (! compressed && (m_length > INITIAL_BUFFER_LENGTH)) {
         // Read only a subset of the file so we don't consume
         // all available memory.
@@ -213,9 +210,46 @@ BinaryInput::BinaryInput
     }
 }
 
+bool BinaryInput::memoryMap(FILE* file) {
+#   ifdef G3D_WINDOWS
+        const HANDLE mapping = CreateFileMapping((HANDLE)_get_osfhandle(_fileno(file)), NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            return false;
+        }
+        void* ptr = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        // The view keeps the mapping alive
+        CloseHandle(mapping);
+        if (ptr == NULL) {
+            return false;
+        }
+#   else
+        void* ptr = mmap(NULL, size_t(m_length), PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (ptr == MAP_FAILED) {
+            return false;
+        }
+        // Parsers read front to back, so ask for aggressive read-ahead and
+        // early release of pages that have already been consumed
+        madvise(ptr, size_t(m_length), MADV_SEQUENTIAL);
+        madvise(ptr, size_t(m_length), MADV_WILLNEED);
+#   endif
+
+    m_buffer       = static_cast<uint8*>(ptr);
+    m_bufferLength = m_length;
+    m_freeBuffer   = false;
+    m_memoryMapped = true;
+    return true;
+}
+
+
 BinaryInput::~BinaryInput() {
 
-    if (m_freeBuffer) {
+    if (m_memoryMapped) {
+#       ifdef G3D_WINDOWS
+            UnmapViewOfFile(m_buffer);
+#       else
+            munmap(m_buffer, size_t(m_length));
+#       endif
+    } else if (m_freeBuffer) {
         System::alignedFree(m_buffer);
     }
     m_buffer = NULL;
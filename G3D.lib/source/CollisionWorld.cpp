@@ -0,0 +1,362 @@
+/**
+  \file G3D/source/CollisionWorld.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+
+  Copyright 2000-2016, Morgan McGuire.
+  All rights reserved.
+ */
+
+#include "G3D/CollisionWorld.h"
+#include "G3D/CollisionDetection.h"
+#include "G3D/CoordinateFrame.h"
+#include "G3D/ThreadPool.h"
+
+namespace G3D {
+
+/** Pairs per narrowphase task */
+static const int NARROWPHASE_GRAIN = 256;
+
+/** Maximum number of alternating projections for the capsule-box test */
+static const int MAX_CAPSULE_BOX_ITERATIONS = 8;
+
+
+/** Finds the closest points \a c1 on segment p1-q1 and \a c2 on segment p2-q2.
+
+    CollisionDetection::closestPointsBetweenLineAndLine works on infinite lines,
+    which is wrong for capsules whose axes are nearly parallel.
+    \cite Ericson, Real-Time Collision Detection, 5.1.9 */
+static void closestPointsBetweenSegments(const Point3& p1, const Point3& q1, const Point3& p2, const Point3& q2, Point3& c1, Point3& c2) {
+    const Vector3& d1 = q1 - p1;
+    const Vector3& d2 = q2 - p2;
+    const Vector3& r  = p1 - p2;
+    const float a = d1.squaredLength();
+    const float e = d2.squaredLength();
+    const float f = d2.dot(r);
+
+    float s = 0.0f, t = 0.0f;
+    if ((a <= fuzzyEpsilon32) && (e <= fuzzyEpsilon32)) {
+        // Both segments are points
+    } else if (a <= fuzzyEpsilon32) {
+        t = clamp(f / e, 0.0f, 1.0f);
+    } else {
+        const float c = d1.dot(r);
+        if (e <= fuzzyEpsilon32) {
+            s = clamp(-c / a, 0.0f, 1.0f);
+        } else {
+            const float b = d1.dot(d2);
+            const float denom = a * e - b * b;
+
+            // Parallel segments have denom == 0; any s is closest, so pick 0
+            s = (denom > 0.0f) ? clamp((b * f - c * e) / denom, 0.0f, 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = clamp(-c / a, 0.0f, 1.0f);
+            } else if (t > 1.0f) {
+                t = 1.0f;
+                s = clamp((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+
+    c1 = p1 + d1 * s;
+    c2 = p2 + d2 * t;
+}
+
+
+/** The point on the axis of \a capsule that is closest to \a box, found by alternately
+    projecting onto the segment and the box.  For a segment that passes through the
+    box, this is some point inside of the box rather than the deepest one. */
+static Point3 closestPointOnCapsuleAxis(const Capsule& capsule, const Box& box) {
+    CoordinateFrame frame;
+    box.getLocalFrame(frame);
+    const Vector3& halfExtent = box.extent() * 0.5f;
+
+    const Point3& p0 = frame.pointToObjectSpace(capsule.point(0));
+    const Point3& p1 = frame.pointToObjectSpace(capsule.point(1));
+
+    // The box center is the origin of its frame
+    Point3 onSegment = CollisionDetection::closestPointOnLineSegment(p0, p1, Point3::zero());
+    for (int i = 0; i < MAX_CAPSULE_BOX_ITERATIONS; ++i) {
+        const Point3& inBox = onSegment.clamp(-halfExtent, halfExtent);
+        if (inBox == onSegment) {
+            // The segment intersects the box
+            break;
+        }
+        const Point3& next = CollisionDetection::closestPointOnLineSegment(p0, p1, inBox);
+        if (next.fuzzyEq(onSegment)) {
+            onSegment = next;
+            break;
+        }
+        onSegment = next;
+    }
+
+    return frame.pointToWorldSpace(onSegment);
+}
+
+
+/** Tests treat AABOX as BOX */
+static int narrowphaseRank(CollisionWorld::ShapeType type) {
+    switch (type) {
+    case CollisionWorld::SPHERE:
+        return 0;
+    case CollisionWorld::CAPSULE:
+        return 1;
+    default:
+        return 2;
+    }
+}
+
+
+CollisionWorld::CollisionWorld() : m_membershipChanged(false) {}
+
+
+shared_ptr<CollisionWorld> CollisionWorld::create() {
+    return shared_ptr<CollisionWorld>(new CollisionWorld());
+}
+
+
+int CollisionWorld::allocateProxy() {
+    int id;
+    if (m_freeList.size() > 0) {
+        id = m_freeList.pop();
+    } else {
+        id = m_proxy.size();
+        m_proxy.next();
+    }
+    m_proxy[id].inUse = true;
+    m_membershipChanged = true;
+    return id;
+}
+
+
+int CollisionWorld::insert(const Sphere& sphere) {
+    const int id = allocateProxy();
+    set(id, sphere);
+    return id;
+}
+
+
+int CollisionWorld::insert(const Box& box) {
+    const int id = allocateProxy();
+    set(id, box);
+    return id;
+}
+
+
+int CollisionWorld::insert(const Capsule& capsule) {
+    const int id = allocateProxy();
+    set(id, capsule);
+    return id;
+}
+
+
+int CollisionWorld::insert(const AABox& box) {
+    const int id = allocateProxy();
+    set(id, box);
+    return id;
+}
+
+
+void CollisionWorld::set(int id, const Sphere& sphere) {
+    Proxy& p = proxy(id);
+    p.type = SPHERE;
+    p.sphere = sphere;
+    sphere.getBounds(p.bounds);
+}
+
+
+void CollisionWorld::set(int id, const Box& box) {
+    Proxy& p = proxy(id);
+    p.type = BOX;
+    p.box = box;
+    box.getBounds(p.bounds);
+}
+
+
+void CollisionWorld::set(int id, const Capsule& capsule) {
+    Proxy& p = proxy(id);
+    p.type = CAPSULE;
+    p.capsule = capsule;
+    capsule.getBounds(p.bounds);
+}
+
+
+void CollisionWorld::set(int id, const AABox& box) {
+    debugAssertM(! box.isEmpty() && box.isFinite(), "Proxy bounds must be finite and non-empty");
+    Proxy& p = proxy(id);
+    p.type = AABOX;
+    p.box = Box(box);
+    p.bounds = box;
+}
+
+
+void CollisionWorld::remove(int id) {
+    proxy(id).inUse = false;
+    m_freeList.append(id);
+    m_membershipChanged = true;
+}
+
+
+void CollisionWorld::clear() {
+    m_proxy.clear();
+    m_freeList.clear();
+    m_member.clear();
+    m_memberBounds.clear();
+    m_tree.clear();
+    m_membershipChanged = false;
+}
+
+
+void CollisionWorld::getOverlappingPairs(Array<Pair>& pairs) {
+    pairs.fastClear();
+
+    if (m_membershipChanged) {
+        // Members are in increasing ID order, so member index order is ID order
+        m_member.fastClear();
+        for (int id = 0; id < m_proxy.size(); ++id) {
+            if (m_proxy[id].inUse) {
+                m_member.append(id);
+            }
+        }
+        m_memberBounds.resize(m_member.size());
+    }
+
+    const int numMembers = m_member.size();
+    for (int i = 0; i < numMembers; ++i) {
+        m_memberBounds[i] = m_proxy[m_member[i]].bounds;
+    }
+
+    if (m_membershipChanged) {
+        m_tree.setContents(m_memberBounds);
+        m_membershipChanged = false;
+    } else {
+        m_tree.refit(m_memberBounds);
+    }
+
+    Array<Vector2int32> memberPairs;
+    m_tree.getIntersectingPairs(memberPairs);
+
+    // Member index order is ID order, so x < y implies a < b
+    pairs.resize(memberPairs.size());
+    for (int i = 0; i < memberPairs.size(); ++i) {
+        pairs[i] = Pair(m_member[memberPairs[i].x], m_member[memberPairs[i].y]);
+    }
+    pairs.sort([](const Pair& p, const Pair& q) {
+        return (p.a < q.a) || ((p.a == q.a) && (p.b < q.b));
+    });
+}
+
+
+void CollisionWorld::computeContact
+(const Proxy&       A,
+ const Proxy&       B,
+ Contact&           contact,
+ Array<Vector3>&    contactPoints,
+ Array<Vector3>&    contactNormals) {
+
+    // Order the shapes as the CollisionDetection functions expect
+    const bool swapped = narrowphaseRank(A.type) > narrowphaseRank(B.type);
+    const Proxy& P = swapped ? B : A;
+    const Proxy& Q = swapped ? A : B;
+
+    float depth = -1.0f;
+    switch (narrowphaseRank(P.type) * 3 + narrowphaseRank(Q.type)) {
+    case 0: // Sphere-sphere
+        depth = CollisionDetection::penetrationDepthForFixedSphereFixedSphere(P.sphere, Q.sphere, contactPoints, contactNormals);
+        break;
+
+    case 1: // Sphere-capsule
+        {
+            const Point3& C = CollisionDetection::closestPointOnLineSegment(Q.capsule.point(0), Q.capsule.point(1), P.sphere.center);
+            depth = CollisionDetection::penetrationDepthForFixedSphereFixedSphere(P.sphere, Sphere(C, Q.capsule.radius()), contactPoints, contactNormals);
+        }
+        break;
+
+    case 2: // Sphere-box
+        depth = CollisionDetection::penetrationDepthForFixedSphereFixedBox(P.sphere, Q.box, contactPoints, contactNormals);
+        break;
+
+    case 4: // Capsule-capsule
+        {
+            Point3 C1, C2;
+            closestPointsBetweenSegments(P.capsule.point(0), P.capsule.point(1), Q.capsule.point(0), Q.capsule.point(1), C1, C2);
+            depth = CollisionDetection::penetrationDepthForFixedSphereFixedSphere
+                (Sphere(C1, P.capsule.radius()), Sphere(C2, Q.capsule.radius()), contactPoints, contactNormals);
+        }
+        break;
+
+    case 5: // Capsule-box
+        {
+            const Point3& C = closestPointOnCapsuleAxis(P.capsule, Q.box);
+            depth = CollisionDetection::penetrationDepthForFixedSphereFixedBox(Sphere(C, P.capsule.radius()), Q.box, contactPoints, contactNormals);
+        }
+        break;
+
+    case 8: // Box-box
+        depth = CollisionDetection::penetrationDepthForFixedBoxFixedBox(P.box, Q.box, contactPoints, contactNormals);
+        break;
+
+    default:
+        debugAssertM(false, "Unreachable");
+    }
+
+    contact.depth = depth;
+    if ((depth < 0.0f) || (contactPoints.size() == 0)) {
+        contact.depth = min(depth, -1.0f);
+        return;
+    }
+
+    contact.point = contactPoints[0];
+
+    // The sphere-box vertex case returns an unnormalized normal, and concentric
+    // spheres produce NaN
+    Vector3 N = contactNormals[0].directionOrZero();
+    if (N.isNaN() || N.isZero()) {
+        N = Vector3::unitY();
+    }
+    contact.normal = swapped ? -N : N;
+}
+
+
+void CollisionWorld::getContacts(const Array<Pair>& pairs, Array<Contact>& contacts) const {
+    contacts.resize(pairs.size(), DONT_SHRINK_UNDERLYING_ARRAY);
+
+    ThreadPool::parallelForRange(0, pairs.size(), [&](int begin, int end, int threadID) {
+        Array<Vector3> contactPoints, contactNormals;
+        for (int i = begin; i < end; ++i) {
+            const Pair& pair = pairs[i];
+            Contact& contact = contacts[i];
+            contact.a = pair.a;
+            contact.b = pair.b;
+            computeContact(proxy(pair.a), proxy(pair.b), contact, contactPoints, contactNormals);
+        }
+    }, NARROWPHASE_GRAIN);
+
+    // Remove the pairs that do not interpenetrate, preserving order
+    int numContacts = 0;
+    for (int i = 0; i < contacts.size(); ++i) {
+        if (contacts[i].depth >= 0.0f) {
+            if (numContacts != i) {
+                contacts[numContacts] = contacts[i];
+            }
+            ++numContacts;
+        }
+    }
+    contacts.resize(numContacts, DONT_SHRINK_UNDERLYING_ARRAY);
+}
+
+
+bool CollisionWorld::getContact(int a, int b, Contact& contact) const {
+    Array<Vector3> contactPoints, contactNormals;
+    contact.a = a;
+    contact.b = b;
+    computeContact(proxy(a), proxy(b), contact, contactPoints, contactNormals);
+    return contact.depth >= 0.0f;
+}
+
+} // namespace G3D
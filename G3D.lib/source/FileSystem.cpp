@@ -4,7 +4,7 @@
  \author Morgan McGuire, http://graphics.cs.williams.edu
  
  \author  2002-06-06
- \edited  2016-02-16
+ \edited  2026-10-17
  */
 #include "G3D/FileSystem.h"
 #include "G3D/System.h"
@@ -13,9 +13,11 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include "zip.h"
+#include "../../zlib.lib/include/zlib.h"
 #include "G3D/g3dfnmatch.h"
 #include "G3D/BinaryInput.h"
 #include "G3D/BinaryOutput.h"
+#include "G3D/ThreadPool.h"
 
 #ifdef G3D_WINDOWS
     // Needed for _getcwd
@@ -61,8 +63,229 @@ void FileSystem::cleanup() {
     }
 }
 
+class FileSystem::ZipArchive {
+public:
+
+    class Entry {
+    public:
+        /** Index in the zipfile's directory */
+        zip_uint64_t        index;
+
+        /** Uncompressed size in bytes */
+        int64               size;
+
+        int64               compressedSize;
+        int                 compressionMethod;
+        bool                encrypted;
+        uint32              crc;
+    };
+
+private:
+
+    struct zip*             m_zip;
+
+    /** libzip handles are not thread safe, so reads through m_zip are serialized */
+    GMutex                  m_mutex;
+
+    ZipArchive(struct zip* z) : m_zip(z), fileTime(0), fileSize(0), lastChecked(0) {}
+
+public:
+
+    /** Canonical names of all entries, in directory order */
+    Array<String>           nameArray;
+
+    /** Maps lower-case canonical names to entries, for case-insensitive lookup */
+    Table<String, Entry>    entryTable;
+
+    /** Modification time and size of the zipfile when it was opened */
+    time_t                  fileTime;
+    int64                   fileSize;
+
+    /** When the zipfile was last checked for changes */
+    RealTime                lastChecked;
+
+    /** Returns NULL if \a filename cannot be opened as a zipfile */
+    static shared_ptr<ZipArchive> create(const String& filename) {
+        struct zip* z = zip_open(filename.c_str(), ZIP_CHECKCONS, NULL);
+        if (isNull(z)) {
+            return shared_ptr<ZipArchive>();
+        }
+
+        const shared_ptr<ZipArchive> archive(new ZipArchive(z));
+        const int count = zip_get_num_files(z);
+        archive->nameArray.reserve(count);
+        for (int i = 0; i < count; ++i) {
+            struct zip_stat info;
+            zip_stat_init(&info);
+            zip_stat_index(z, i, 0, &info);
+
+            const String& name = FilePath::canonicalize(info.name);
+            archive->nameArray.append(name);
+
+            // Like ZIP_FL_NOCASE, the first of several names that differ only in case wins
+            bool created = false;
+            Entry& entry = archive->entryTable.getCreate(toLower(name), created);
+            if (created) {
+                entry.index             = i;
+                entry.size              = info.size;
+                entry.compressedSize    = info.comp_size;
+                entry.compressionMethod = info.comp_method;
+                entry.encrypted         = (info.encryption_method != ZIP_EM_NONE);
+                entry.crc               = info.crc;
+            }
+        }
+
+        return archive;
+    }
+
+    ~ZipArchive() {
+        zip_close(m_zip);
+    }
+
+    /** Returns NULL if there is no such entry */
+    const Entry* find(const String& pathInsideZipfile) const {
+        return entryTable.getPointer(toLower(FilePath::canonicalize(pathInsideZipfile)));
+    }
+
+    /** Reads exactly \a length bytes of \a entry.
+        \param flags ZIP_FL_COMPRESSED to read the data without decompressing it */
+    bool read(const Entry& entry, int flags, uint8* data, int64 length) {
+        GMutexLock lock(&m_mutex);
+        struct zip_file* zf = zip_fopen_index(m_zip, entry.index, flags);
+        if (isNull(zf)) {
+            return false;
+        }
+        const int64 bytesRead = zip_fread(zf, data, length);
+        zip_fclose(zf);
+        return bytesRead == length;
+    }
+};
+
+
+/** Decompresses raw deflate data, as stored in zipfiles */
+static bool inflateRaw(const uint8* src, int64 srcLength, uint8* dst, int64 dstLength) {
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, -MAX_WBITS) != Z_OK) {
+        return false;
+    }
+
+    stream.next_in   = const_cast<Bytef*>(src);
+    stream.avail_in  = uInt(srcLength);
+    stream.next_out  = dst;
+    stream.avail_out = uInt(dstLength);
+    const int result = inflate(&stream, Z_FINISH);
+    inflateEnd(&stream);
+
+    return (result == Z_STREAM_END) && (int64(stream.total_out) == dstLength);
+}
+
+
 FileSystem::FileSystem() : m_cacheLifetime(10) {}
 
+
+shared_ptr<FileSystem::ZipArchive> FileSystem::_zipArchive(const String& zipfile) {
+    const String& filename = FilePath::canonicalize(FilePath::removeTrailingSlash(_resolve(zipfile)));
+    const String& key =
+#   if defined(G3D_WINDOWS)
+        toLower(filename);
+#   else
+        filename;
+#   endif
+
+    const RealTime now = System::time();
+    shared_ptr<ZipArchive> archive;
+    m_zipArchiveCache.get(key, archive);
+    if (notNull(archive) && (now <= archive->lastChecked + m_cacheLifetime)) {
+        return archive;
+    }
+
+    // Reopen only if the zipfile has changed
+    struct _stat st;
+    if (_stat(filename.c_str(), &st) == -1) {
+        m_zipArchiveCache.remove(key);
+        return shared_ptr<ZipArchive>();
+    }
+
+    if (isNull(archive) || (archive->fileTime != st.st_mtime) || (archive->fileSize != int64(st.st_size))) {
+        archive = ZipArchive::create(filename);
+        if (isNull(archive)) {
+            m_zipArchiveCache.remove(key);
+            return archive;
+        }
+        archive->fileTime = st.st_mtime;
+        archive->fileSize = st.st_size;
+        m_zipArchiveCache.set(key, archive);
+    }
+
+    archive->lastChecked = now;
+    return archive;
+}
+
+
+int64 FileSystem::_zipfileEntrySize(const String& zipfile, const String& pathInsideZipfile) {
+    const shared_ptr<ZipArchive>& archive = _zipArchive(zipfile);
+    const ZipArchive::Entry* entry = isNull(archive) ? NULL : archive->find(pathInsideZipfile);
+    return isNull(entry) ? -1 : entry->size;
+}
+
+
+uint8* FileSystem::readZipfileEntry(const String& zipfile, const String& pathInsideZipfile, int64& length) {
+    mutex.lock();
+    const shared_ptr<ZipArchive> archive = instance()._zipArchive(zipfile);
+    mutex.unlock();
+
+    const ZipArchive::Entry* entry = isNull(archive) ? NULL : archive->find(pathInsideZipfile);
+    if (isNull(entry)) {
+        throw String("\"") + pathInsideZipfile + "\" inside \"" + zipfile + "\" could not be opened.";
+    }
+
+    length = entry->size;
+    uint8* data = reinterpret_cast<uint8*>(System::alignedMalloc(length + 1, 16));
+    data[length] = '\0';
+
+    bool success = true;
+    if (length == 0) {
+        // Nothing to read
+    } else if ((entry->compressionMethod == ZIP_CM_DEFLATE) && ! entry->encrypted) {
+        // Lock the archive only while reading the compressed data so
+        // that other threads can read while this one decompresses
+        uint8* compressed = reinterpret_cast<uint8*>(System::malloc(size_t(entry->compressedSize)));
+        success = archive->read(*entry, ZIP_FL_COMPRESSED, compressed, entry->compressedSize) &&
+            inflateRaw(compressed, entry->compressedSize, data, length) &&
+            (crc32(0, data, uInt(length)) == entry->crc);
+        System::free(compressed);
+    } else {
+        // Stored data, or a method that only libzip can decode
+        success = archive->read(*entry, 0, data, length);
+    }
+
+    if (! success) {
+        System::alignedFree(data);
+        throw pathInsideZipfile + " was corrupt because it unzipped to the wrong size.";
+    }
+
+    return data;
+}
+
+
+void FileSystem::readZipfileEntries(const Array<String>& pathArray, Array<uint8*>& dataArray, Array<int64>& lengthArray) {
+    dataArray.resize(pathArray.size());
+    lengthArray.resize(pathArray.size());
+    ThreadPool::parallelFor(0, pathArray.size(), [&](int i, int threadID) {
+        dataArray[i] = NULL;
+        lengthArray[i] = -1;
+        String zipfile;
+        if (inZipfile(pathArray[i], zipfile)) {
+            try {
+                dataArray[i] = readZipfileEntry(zipfile, pathArray[i].substr(zipfile.length() + 1), lengthArray[i]);
+            } catch (const String&) {
+                lengthArray[i] = -1;
+            }
+        }
+    }, 1);
+}
+
 /////////////////////////////////////////////////////////////
 
 bool FileSystem::Dir::contains(const String& f, bool caseSensitive) const {
@@ -82,18 +305,16 @@ bool FileSystem::Dir::contains(const String& f, bool caseSensitive) const {
     
 void FileSystem::Dir::computeZipListing(const String& zipfile, const String& _pathInsideZipfile) {
     const String& pathInsideZipfile = FilePath::canonicalize(_pathInsideZipfile);
-    struct zip* z = zip_open( FilePath::removeTrailingSlash(zipfile).c_str(), ZIP_CHECKCONS, NULL );
-    debugAssert(z);
+    const shared_ptr<ZipArchive>& archive = instance()._zipArchive(zipfile);
+    debugAssert(archive);
+    if (isNull(archive)) {
+        return;
+    }
 
-    int count = zip_get_num_files( z );
     Set<String> alreadyAdded;
-    for (int i = 0; i < count; ++i) {
-        struct zip_stat info;
-        zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-        zip_stat_index( z, i, ZIP_FL_NOCASE, &info );
-        
+    for (int i = 0; i < archive->nameArray.size(); ++i) {
         // Fully-qualified name of a file inside zipfile
-        String name = FilePath::canonicalize(info.name);
+        String name = archive->nameArray[i];
 
         if (beginsWith(name, pathInsideZipfile)) {
             // We found something inside the directory we were looking for,
@@ -128,9 +349,6 @@ void FileSystem::Dir::computeZipListing(const String& zipfile, const String& _pa
             }
         }
     }
-    
-    zip_close(z);
-    z = NULL;
 }
 
 
@@ -332,6 +550,7 @@ void FileSystem::_clearCache(const String& _path) {
 
     if ((path == "") || FilePath::isRoot(path)) {
         m_cache.clear();
+        m_zipArchiveCache.clear();
     } else {
         Array<String> keys;
         m_cache.getKeys(keys);
@@ -350,6 +569,16 @@ void FileSystem::_clearCache(const String& _path) {
                 m_cache.remove(keys[k]);
             }
         }
+
+        // Close the zipfiles too, which on Windows would otherwise keep them from being replaced
+        keys.fastClear();
+        m_zipArchiveCache.getKeys(keys);
+        for (int k = 0; k < keys.size(); ++k) {
+            const String& key = keys[k];
+            if ((key == prefix) || beginsWith(key, prefixSlash)) {
+                m_zipArchiveCache.remove(keys[k]);
+            }
+        }
     }
 }
 
@@ -534,6 +763,9 @@ void FileSystem::_removeFile(const String& path) {
     Array<String> files;
     getFiles(path, files, true);
 
+    // Close any cached zipfiles before removing them
+    _clearCache(FilePath::parent(path));
+
     for (int i = 0; i < files.size(); ++i) {
         const String& filename = files[i];
         int retval = ::remove(filename.c_str());
@@ -661,19 +893,8 @@ int64 FileSystem::_size(const String& _filename) {
     if (result == -1) {
         String zip, contents;
         if (zipfileExists(filename, zip, contents)) {
-            int64 requiredMem;
-            
-            struct zip *z = zip_open( zip.c_str(), ZIP_CHECKCONS, NULL );
-            debugAssertM(z != NULL, zip + ": zip open failed.");
-            {
-                struct zip_stat info;
-                zip_stat_init( &info );    // Docs unclear if zip_stat_init is required.
-                int success = zip_stat( z, contents.c_str(), ZIP_FL_NOCASE, &info );
-                (void) success;
-                debugAssertM(success == 0, zip + ": " + contents + ": zip stat failed.");
-                requiredMem = info.size;
-            }
-            zip_close(z);
+            const int64 requiredMem = _zipfileEntrySize(zip, contents);
+            debugAssertM(requiredMem != -1, zip + ": " + contents + ": zip stat failed.");
             return requiredMem;
         } else {
             return -1;
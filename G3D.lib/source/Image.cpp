@@ -244,7 +244,8 @@ void Image::set(const shared_ptr<PixelTransferBuffer>& buffer, int x, int y) {
 
             // For each row in the rectangle
             for (int row = 0; row < rect.height(); ++row) {
-                BYTE* dst = m_image->getScanLine(int(rect.y1()) - row - 1) + columnOffset;
+                // FreeImage stores the bottom row first
+                BYTE* dst = m_image->getScanLine(height() - 1 - (int(rect.y0()) + row)) + columnOffset;
                 System::memcpy(dst, src + (buffer->width() * (row + (int(rect.y0()) - y)) + (int(rect.x0()) - x)) * bytesPerPixel, rowStride);
             }
             buffer->unmap();
@@ -467,7 +468,7 @@ shared_ptr<CPUPixelTransferBuffer> Image::toPixelTransferBuffer(Rect2D rect) con
 
         for (int row = 0; row < int(rect.height()); ++row) {
             // Note that we flip while copying
-            System::memcpy(buffer->row(row), m_image->getScanLine(int(rect.height()) - 1 - (row + int(rect.y0()))) + offsetStride, rowStride);
+            System::memcpy(buffer->row(row), m_image->getScanLine(height() - 1 - (row + int(rect.y0()))) + offsetStride, rowStride);
         }
     }
 
@@ -2,14 +2,18 @@
   \file G3D/ImageConvert.cpp
 
   \created 2012-05-24
-  \edited  2012-05-24
+  \edited  2026-10-17
 */
 
 #include "G3D/ImageConvert.h"
 #include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/ThreadPool.h"
 
 namespace G3D {
 
+/** Number of elements per ThreadPool task in the per-component loops below */
+static const int COMPONENTS_PER_TASK = 64 * 1024;
+
 
 shared_ptr<PixelTransferBuffer> ImageConvert::convertBuffer(const shared_ptr<PixelTransferBuffer>& src, const ImageFormat* dstFormat) {
     // Early return for no conversion
@@ -79,9 +83,11 @@ shared_ptr<PixelTransferBuffer> ImageConvert::convertFloatToUnorm8(const shared_
     const float*  srcPtr = static_cast<const float*>(src->mapRead());
     unorm8*       dstPtr = static_cast<unorm8*>(dst->buffer());
 
-    for (int i = 0; i < N; ++i) {
-        dstPtr[i] = unorm8(srcPtr[i]);
-    }
+    ThreadPool::parallelForRange(0, N, [&](int begin, int end, int threadID) {
+        for (int i = begin; i < end; ++i) {
+            dstPtr[i] = unorm8(srcPtr[i]);
+        }
+    }, COMPONENTS_PER_TASK);
     src->unmap(srcPtr);
 
     return dst;
@@ -95,9 +101,11 @@ shared_ptr<PixelTransferBuffer> ImageConvert::convertUnorm8ToFloat(const shared_
     const unorm8* srcPtr = static_cast<const unorm8*>(src->mapRead());
     float*        dstPtr = static_cast<float*>(dst->buffer());
 
-    for (int i = 0; i < N; ++i) {
-        dstPtr[i] = srcPtr[i];
-    }
+    ThreadPool::parallelForRange(0, N, [&](int begin, int end, int threadID) {
+        for (int i = begin; i < end; ++i) {
+            dstPtr[i] = srcPtr[i];
+        }
+    }, COMPONENTS_PER_TASK);
     src->unmap(srcPtr);
 
     return dst;
@@ -109,33 +117,32 @@ shared_ptr<PixelTransferBuffer> ImageConvert::convertRGBAddAlpha(const shared_pt
 
     shared_ptr<CPUPixelTransferBuffer> dstImage = CPUPixelTransferBuffer::create(src->width(), src->height(), dstFormat);
     const unorm8* oldPixels = static_cast<const unorm8*>(src->mapRead());
-    for (int pixelIndex = 0; pixelIndex < src->width() * src->height(); ++pixelIndex) {
-        switch (dstFormat->code) {
-            case ImageFormat::CODE_LA8:
+    switch (dstFormat->code) {
+        case ImageFormat::CODE_LA8:
             {
                 unorm8* newPixels = static_cast<unorm8*>(dstImage->buffer());
-                
-                newPixels[pixelIndex * 2] = oldPixels[pixelIndex];
-                newPixels[pixelIndex * 2 + 1] = unorm8::one();
-
+                for (int pixelIndex = 0; pixelIndex < src->width() * src->height(); ++pixelIndex) {
+                    newPixels[pixelIndex * 2] = oldPixels[pixelIndex];
+                    newPixels[pixelIndex * 2 + 1] = unorm8::one();
+                }
                 break;
             }
 
-            case ImageFormat::CODE_RGBA8:
-            case ImageFormat::CODE_BGRA8:
+        case ImageFormat::CODE_RGBA8:
+        case ImageFormat::CODE_BGRA8:
             {
-                unorm8* newPixels = static_cast<unorm8*>(dstImage->buffer());
-                
-                newPixels[pixelIndex * 4] = oldPixels[pixelIndex * 3];
-                newPixels[pixelIndex * 4 + 1] = oldPixels[pixelIndex * 3 + 1];
-                newPixels[pixelIndex * 4 + 2] = oldPixels[pixelIndex * 3 + 2];
-                newPixels[pixelIndex * 4 + 3] = unorm8::one();
+                // BGR8 -> BGRA8 moves the same bytes as RGB8 -> RGBA8, which has a SIMD converter
+                Array<const void*> srcBytes;
+                Array<void*> dstBytes;
+                srcBytes.append(oldPixels);
+                dstBytes.append(dstImage->buffer());
+                ImageFormat::convert(srcBytes, src->width(), src->height(), ImageFormat::RGB8(), 0, dstBytes, ImageFormat::RGBA8(), 0, false);
                 break;
             }
-            default:
-                debugAssertM(false, "Unsupported destination image format");
-                break;
-        }
+
+        default:
+            debugAssertM(false, "Unsupported destination image format");
+            break;
     }
 
     src->unmap(oldPixels);
@@ -156,12 +163,14 @@ shared_ptr<PixelTransferBuffer> ImageConvert::convertRGBA8toBGRA8(const shared_p
     const int bytesPerPixel = 4;
 
     // From RGBA to BGRA, for every 4 bytes, first and third swapped, others remain in place
-    for(int i = 0; i < (bytesPerPixel * width * height); i += 4) {
-        dstData[i+0] = srcData[i+2];
-        dstData[i+1] = srcData[i+1];
-        dstData[i+2] = srcData[i+0];
-        dstData[i+3] = srcData[i+3];
-    }
+    ThreadPool::parallelForRange(0, width * height, [&](int begin, int end, int threadID) {
+        for (int i = bytesPerPixel * begin; i < bytesPerPixel * end; i += 4) {
+            dstData[i+0] = srcData[i+2];
+            dstData[i+1] = srcData[i+1];
+            dstData[i+2] = srcData[i+0];
+            dstData[i+3] = srcData[i+3];
+        }
+    }, COMPONENTS_PER_TASK / bytesPerPixel);
 
     src->unmap(srcData);
     return dstBuffer;
@@ -5,6 +5,9 @@
 #include "G3D/Color1.h"
 #include "G3D/Color3.h"
 #include "G3D/Color4.h"
+#include "G3D/System.h"
+#include "G3D/ThreadPool.h"
+#include <smmintrin.h>
 
 
 namespace G3D {
@@ -188,7 +191,7 @@ bool ImageFormat::convert(const Array<const void*>& srcBytes, int srcWidth, int
 
             if (toInterConverter && fromInterConverter) {
                 Array<void*> tmp;
-                tmp.append(System::malloc(srcWidth * srcHeight * ImageFormat::RGBA32F()->cpuBitsPerPixel * 8));
+                tmp.append(System::malloc(srcWidth * srcHeight * ImageFormat::RGBA32F()->cpuBitsPerPixel / 8));
 
                 toInterConverter(srcBytes, srcWidth, srcHeight, srcFormat, srcRowPadBits, tmp, ImageFormat::RGBA32F(), 0, false, bayerAlg);
                 fromInterConverter(reinterpret_cast<Array<const void*>&>(tmp), srcWidth, srcHeight, ImageFormat::RGBA32F(), 0, dstBytes, dstFormat, dstRowPadBits, invertY, bayerAlg);
@@ -204,6 +207,229 @@ bool ImageFormat::convert(const Array<const void*>& srcBytes, int srcWidth, int
 }
 
 
+// *******************
+// Row-parallel and SIMD helpers
+// *******************
+
+/** Images with fewer pixels than this are converted on the calling thread */
+static const int MIN_PARALLEL_PIXELS = 128 * 128;
+
+/** Approximate number of pixels in each range of rows handed to the ThreadPool */
+static const int PIXELS_PER_TASK = 32 * 1024;
+
+/** Invokes \a body(begin, end) on disjoint ranges of rows that exactly
+    cover [0, numRows), using the ThreadPool when the image is large
+    enough to amortize the dispatch.  Every converter produces each
+    output row from a bounded set of input rows, so the ranges can be
+    converted in any order. */
+template<class RowRangeFunction>
+static void forEachRowRange(int numRows, int pixelsPerRow, const RowRangeFunction& body) {
+    if ((numRows < 2) || (numRows * pixelsPerRow < MIN_PARALLEL_PIXELS)) {
+        body(0, numRows);
+    } else {
+        ThreadPool::parallelForRange(0, numRows, [&body](int begin, int end, int threadID) {
+            (void)threadID;
+            body(begin, end);
+        }, max(1, PIXELS_PER_TASK / max(1, pixelsPerRow)));
+    }
+}
+
+// GCC and Clang only compile SSSE3 and SSE4.1 intrinsics in functions that
+// are built for those instruction sets.  The vector loops are separate
+// functions so that the scalar code around them, which is the fallback on
+// older processors, is still compiled for the baseline instruction set.
+#if defined(__GNUC__) || defined(__clang__)
+#   define G3D_TARGET_SSE4_1 __attribute__((target("ssse3,sse4.1")))
+#else
+#   define G3D_TARGET_SSE4_1
+#endif
+
+/** True if the SSSE3 byte shuffle and the SSE4.1 pack, blend, and extract
+    instructions used by the kernels below are available.  The scalar
+    loops that follow each kernel handle the remaining pixels and are
+    the only path on older processors; both produce identical bits. */
+static bool useSIMD() {
+    static const bool available = System::hasSSSE3() && System::hasSSE4_1();
+    return available;
+}
+
+/** Vector loop of expand3to4().  Returns the number of pixels that it converted. */
+static G3D_TARGET_SSE4_1 int expand3to4SIMD(const uint8* src, uint8* dst, int n, bool swapRB) {
+    int i = 0;
+    const __m128i shuffle = swapRB ?
+        _mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+        _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(int(0xFF000000));
+
+    // Each load reads four bytes past the four pixels that it converts
+    for (; i + 6 <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), _mm_or_si128(_mm_shuffle_epi8(s, shuffle), alpha));
+    }
+    return i;
+}
+
+/** Packed 3-byte pixels to 4-byte pixels with an opaque alpha, optionally reversing the color channel order */
+static void expand3to4(const uint8* src, uint8* dst, int n, bool swapRB) {
+    int i = useSIMD() ? expand3to4SIMD(src, dst, n, swapRB) : 0;
+
+    const int r = swapRB ? 2 : 0;
+    for (; i < n; ++i) {
+        dst[4 * i + 0] = src[3 * i + r];
+        dst[4 * i + 1] = src[3 * i + 1];
+        dst[4 * i + 2] = src[3 * i + 2 - r];
+        dst[4 * i + 3] = 0xFF;
+    }
+}
+
+/** Vector loop of pack4to3().  Returns the number of pixels that it converted. */
+static G3D_TARGET_SSE4_1 int pack4to3SIMD(const uint8* src, uint8* dst, int n, bool swapRB) {
+    int i = 0;
+    const __m128i shuffle = swapRB ?
+        _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1) :
+        _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+
+    // Each store writes four bytes past the four pixels that it
+    // converts, which the next iteration overwrites
+    for (; i + 6 <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * i), _mm_shuffle_epi8(s, shuffle));
+    }
+    return i;
+}
+
+/** 4-byte pixels to packed 3-byte pixels, discarding alpha and optionally reversing the color channel order */
+static void pack4to3(const uint8* src, uint8* dst, int n, bool swapRB) {
+    int i = useSIMD() ? pack4to3SIMD(src, dst, n, swapRB) : 0;
+
+    const int r = swapRB ? 2 : 0;
+    for (; i < n; ++i) {
+        dst[3 * i + 0] = src[4 * i + r];
+        dst[3 * i + 1] = src[4 * i + 1];
+        dst[3 * i + 2] = src[4 * i + 2 - r];
+    }
+}
+
+/** Vector loop of swap3().  Returns the number of pixels that it converted. */
+static G3D_TARGET_SSE4_1 int swap3SIMD(const uint8* src, uint8* dst, int n) {
+    int i = 0;
+    // Five pixels per iteration; the sixteenth byte is copied unchanged
+    // and then rewritten by the next iteration
+    const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 15);
+    for (; i + 6 <= n; i += 5) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * i));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 3 * i), _mm_shuffle_epi8(s, shuffle));
+    }
+    return i;
+}
+
+/** Reverses the channel order of packed 3-byte pixels. \a src may equal \a dst. */
+static void swap3(const uint8* src, uint8* dst, int n) {
+    int i = useSIMD() ? swap3SIMD(src, dst, n) : 0;
+
+    for (; i < n; ++i) {
+        const uint8 r = src[3 * i];
+        dst[3 * i]     = src[3 * i + 2];
+        dst[3 * i + 1] = src[3 * i + 1];
+        dst[3 * i + 2] = r;
+    }
+}
+
+/** Vector loop of unorm8ToColor4().  Returns the number of pixels that it converted. */
+static G3D_TARGET_SSE4_1 int unorm8ToColor4SIMD(const uint8* src, int srcChannels, bool swapRB, Color4* dst, int n) {
+    int i = 0;
+    const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+    const __m128 one   = _mm_set1_ps(1.0f);
+    const int    r     = swapRB ? 2 : 0;
+    const int    c     = srcChannels;
+
+    // Moves the channels of pixel k of the load into the low byte of each 32-bit lane
+    __m128i shuffle[4];
+    for (int k = 0; k < 4; ++k) {
+        shuffle[k] = _mm_setr_epi8(char(c * k + r), -1, -1, -1, char(c * k + 1), -1, -1, -1, char(c * k + 2 - r), -1, -1, -1,
+                                   (c == 4) ? char(c * k + 3) : -1, -1, -1, -1);
+    }
+
+    // Three-channel loads read four bytes past the four pixels that they convert
+    const int margin = (c == 4) ? 4 : 6;
+    float* d = reinterpret_cast<float*>(dst);
+    for (; i + margin <= n; i += 4) {
+        const __m128i s = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + c * i));
+        for (int k = 0; k < 4; ++k) {
+            __m128 f = _mm_mul_ps(_mm_cvtepi32_ps(_mm_shuffle_epi8(s, shuffle[k])), scale);
+            if (c == 3) {
+                f = _mm_blend_ps(f, one, 8);
+            }
+            _mm_storeu_ps(d + 4 * (i + k), f);
+        }
+    }
+    return i;
+}
+
+/** unorm8 pixels with \a srcChannels (3 or 4) channels to Color4, matching
+    unorm8::operator float. Three-channel pixels receive alpha = 1. */
+static void unorm8ToColor4(const uint8* src, int srcChannels, bool swapRB, Color4* dst, int n) {
+    debugAssert((srcChannels == 3) || (srcChannels == 4));
+    int i = useSIMD() ? unorm8ToColor4SIMD(src, srcChannels, swapRB, dst, n) : 0;
+
+    for (; i < n; ++i) {
+        const uint8* s = src + srcChannels * i;
+        const Color4 color(Color4unorm8(unorm8::fromBits(s[0]), unorm8::fromBits(s[1]), unorm8::fromBits(s[2]),
+                                        (srcChannels == 4) ? unorm8::fromBits(s[3]) : unorm8::one()));
+        dst[i] = swapRB ? Color4(color.b, color.g, color.r, color.a) : color;
+    }
+}
+
+/** Four floats to four integers by the same arithmetic as unorm8(float) */
+static inline __m128i quantizeUnorm8(const float* p) {
+    const __m128 v = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(p), _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    return _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, _mm_set1_ps(255.0f)), _mm_set1_ps(0.5f)));
+}
+
+/** Vector loop of color4ToUnorm8().  Returns the number of pixels that it converted. */
+static G3D_TARGET_SSE4_1 int color4ToUnorm8SIMD(const Color4* src, uint8* dst, int dstChannels, bool swapRB, int n) {
+    int i = 0;
+    const __m128i shuffle = (dstChannels == 4) ?
+        (swapRB ? _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15) :
+                  _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15)) :
+        (swapRB ? _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1) :
+                  _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1));
+
+    const float* s = reinterpret_cast<const float*>(src);
+    for (; i + 4 <= n; i += 4) {
+        const float* p = s + 4 * i;
+        const __m128i bytes = _mm_shuffle_epi8(_mm_packus_epi16(_mm_packus_epi32(quantizeUnorm8(p), quantizeUnorm8(p + 4)),
+                                                                _mm_packus_epi32(quantizeUnorm8(p + 8), quantizeUnorm8(p + 12))), shuffle);
+        if (dstChannels == 4) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 4 * i), bytes);
+        } else {
+            uint8* d = dst + 3 * i;
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(d), bytes);
+            const int32 last = _mm_extract_epi32(bytes, 2);
+            memcpy(d + 8, &last, 4);
+        }
+    }
+    return i;
+}
+
+/** Color4 to unorm8 pixels with \a dstChannels (3 or 4) channels, matching the unorm8(float) constructor */
+static void color4ToUnorm8(const Color4* src, uint8* dst, int dstChannels, bool swapRB, int n) {
+    debugAssert((dstChannels == 3) || (dstChannels == 4));
+    int i = useSIMD() ? color4ToUnorm8SIMD(src, dst, dstChannels, swapRB, n) : 0;
+
+    for (; i < n; ++i) {
+        const Color4& s = src[i];
+        uint8* d = dst + dstChannels * i;
+        d[0] = unorm8(swapRB ? s.b : s.r).bits();
+        d[1] = unorm8(s.g).bits();
+        d[2] = unorm8(swapRB ? s.r : s.b).bits();
+        if (dstChannels == 4) {
+            d[3] = unorm8(s.a).bits();
+        }
+    }
+}
+
+
 // *******************
 // RGB -> RGB color space conversions
 // *******************
@@ -249,164 +475,104 @@ static void l32f_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int s
 
 // RGB8 ->
 static void rgb8_to_rgba8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
-            int i = (invertY) ? ((srcHeight-1-y) * srcWidth +x) : (y * srcWidth + x);
-            int i3 = i * 3;
-            int i4 = i3 + i; 
-
-            dst[i4 + 0] = src[i3 + 0]; 
-            dst[i4 + 1] = src[i3 + 1]; 
-            dst[i4 + 2] = src[i3 + 2]; 
-            dst[i4 + 3] = unorm8::one(); 
-        }
-    }
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        const int i = begin * srcWidth;
+        expand3to4(src + 3 * i, dst + 4 * i, (end - begin) * srcWidth, false);
+    });
 }
 
 static void rgb8_to_bgr8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
-            int i = (invertY) ? ((srcHeight-1-y) * srcWidth +x) : (y * srcWidth + x);
-            int i3 = i * 3;
-            dst[i3 + 0] = src[i3 + 2];
-            dst[i3 + 1] = src[i3 + 1];
-            dst[i3 + 2] = src[i3 + 0];
-        }
-    }
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        const int i = begin * srcWidth;
+        swap3(src + 3 * i, dst + 3 * i, (end - begin) * srcWidth);
+    });
 }
 
 static void rgb8_to_rgba32f(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
     debugAssertM(srcRowPadBits % 8 == 0, "Source row padding must be a multiple of 8 bits for this format");
 
-    int dstIndex = 0;
-    int srcByteOffset = 0;
-    int srcRowPadBytes = srcRowPadBits / 8;
+    const int srcRowBytes = 3 * srcWidth + srcRowPadBits / 8;
     Color4* dst = static_cast<Color4*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        if (invertY) {
-            dstIndex = srcWidth * (srcHeight - 1 - y);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int dstY = invertY ? (srcHeight - 1 - y) : y;
+            unorm8ToColor4(src + y * srcRowBytes, 3, false, dst + dstY * srcWidth, srcWidth);
         }
-        for (int x = 0; x < srcWidth; ++x, ++dstIndex, srcByteOffset += 3) {
-            const Color3unorm8& s = *reinterpret_cast<const Color3unorm8*>(src + srcByteOffset);
-            dst[dstIndex] = Color4(Color3(s), 1.0f);
-        }
-        srcByteOffset += srcRowPadBytes;
-    }
+    });
 }
 
 // BGR8 ->
 static void bgr8_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
-            int i = (invertY) ? ((srcHeight-1-y) * srcWidth +x) : (y * srcWidth + x);
-            int i3 = i * 3;
-            dst[i3 + 0] = src[i3 + 2];
-            dst[i3 + 1] = src[i3 + 1];
-            dst[i3 + 2] = src[i3 + 0];
-        }
-    }
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        const int i = begin * srcWidth;
+        swap3(src + 3 * i, dst + 3 * i, (end - begin) * srcWidth);
+    });
 }
 
 static void bgr8_to_rgba8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
-            int i = (invertY) ? ((srcHeight-1-y) * srcWidth +x) : (y * srcWidth + x);
-            int i3 = i * 3;
-            int i4 = i3 + i; 
-
-            dst[i4 + 0] = src[i3 + 2]; 
-            dst[i4 + 1] = src[i3 + 1]; 
-            dst[i4 + 2] = src[i3 + 0]; 
-            dst[i4 + 3] = unorm8::one(); 
-        }
-    }
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        const int i = begin * srcWidth;
+        expand3to4(src + 3 * i, dst + 4 * i, (end - begin) * srcWidth, true);
+    });
 }
 
 static void bgr8_to_rgba32f(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
     debugAssertM(srcRowPadBits % 8 == 0, "Source row padding must be a multiple of 8 bits for this format");
 
-    int dstIndex = 0;
-    int srcByteOffset = 0;
-    int srcRowPadBytes = srcRowPadBits / 8;
+    const int srcRowBytes = 3 * srcWidth + srcRowPadBits / 8;
     Color4* dst = static_cast<Color4*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        if (invertY) {
-            dstIndex = srcWidth * (srcHeight - 1 - y);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int dstY = invertY ? (srcHeight - 1 - y) : y;
+            unorm8ToColor4(src + y * srcRowBytes, 3, true, dst + dstY * srcWidth, srcWidth);
         }
-
-        for (int x = 0; x < srcWidth; ++x, ++dstIndex, srcByteOffset += 3) {
-            const Color3unorm8& s = *reinterpret_cast<const Color3unorm8*>(src + srcByteOffset);
-            dst[dstIndex] = Color4(Color3(s).bgr(), 1.0f);
-        }
-        srcByteOffset += srcRowPadBytes;
-    }
+    });
 }
 
 // RGBA8 ->
 static void rgba8_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
-            int i = (invertY) ? ((srcHeight-1-y) * srcWidth +x) : (y * srcWidth + x);
-            int i3 = i * 3;
-            int i4 = i3 + i;
-
-            dst[i3 + 0] = src[i4 + 0]; 
-            dst[i3 + 1] = src[i4 + 1]; 
-            dst[i3 + 2] = src[i4 + 2]; 
-        }
-    }
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        const int i = begin * srcWidth;
+        pack4to3(src + 4 * i, dst + 3 * i, (end - begin) * srcWidth, false);
+    });
 }
 
 static void rgba8_to_bgr8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
-            int i = (invertY) ? ((srcHeight-1-y) * srcWidth +x) : (y * srcWidth + x);
-            int i3 = i * 3;
-            int i4 = i3 + i;
-
-            dst[i3 + 0] = src[i4 + 2]; 
-            dst[i3 + 1] = src[i4 + 1]; 
-            dst[i3 + 2] = src[i4 + 0]; 
-        }
-    }
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        const int i = begin * srcWidth;
+        pack4to3(src + 4 * i, dst + 3 * i, (end - begin) * srcWidth, true);
+    });
 }
 
 static void rgba8_to_rgba32f(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
     debugAssertM(srcRowPadBits % 8 == 0, "Source row padding must be a multiple of 8 bits for this format");
 
-    int dstIndex = 0;
-    int srcByteOffset = 0;
-    int srcRowPadBytes = srcRowPadBits / 8;
+    const int srcRowBytes = 4 * srcWidth + srcRowPadBits / 8;
     Color4* dst = static_cast<Color4*>(dstBytes[0]);
-    const unorm8* src = static_cast<const unorm8*>(srcBytes[0]);
+    const uint8* src = static_cast<const uint8*>(srcBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        if (invertY) {
-            dstIndex = srcWidth * (srcHeight - 1 - y);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int dstY = invertY ? (srcHeight - 1 - y) : y;
+            unorm8ToColor4(src + y * srcRowBytes, 4, false, dst + dstY * srcWidth, srcWidth);
         }
-
-        for (int x = 0; x < srcWidth; ++x, ++dstIndex, srcByteOffset += 4) {
-            const Color4unorm8& s = *reinterpret_cast<const Color4unorm8*>(src + srcByteOffset);
-            dst[dstIndex] = Color4(s);
-        }
-        srcByteOffset += srcRowPadBytes;
-    }
+    });
 }
 
 // RGB32F ->
@@ -436,72 +602,46 @@ static void rgb32f_to_rgba32f(const Array<const void*>& srcBytes, int srcWidth,
 static void rgba32f_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
     debugAssertM(dstRowPadBits % 8 == 0, "Destination row padding must be a multiple of 8 bits for this format");
 
-    int srcIndex = 0;
-    int dstByteOffset = 0;
-    int dstRowPadBytes = dstRowPadBits / 8;
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
+    const int dstRowBytes = 3 * srcWidth + dstRowPadBits / 8;
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
     const Color4* src = static_cast<const Color4*>(srcBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        if (invertY) {
-            srcIndex = srcWidth * (srcHeight - y - 1);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int srcY = invertY ? (srcHeight - 1 - y) : y;
+            color4ToUnorm8(src + srcY * srcWidth, dst + y * dstRowBytes, 3, false, srcWidth);
         }
-        
-        for (int x = 0; x < srcWidth; ++x, ++srcIndex, dstByteOffset += 3) {
-            Color3unorm8&  d = *reinterpret_cast<Color3unorm8*>(dst + dstByteOffset);
-            const Color4& s = src[srcIndex];
-
-            d = Color3unorm8(s.rgb());
-        }
-        dstByteOffset += dstRowPadBytes;
-    } 
+    });
 }
 
 static void rgba32f_to_rgba8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
     debugAssertM(dstRowPadBits % 8 == 0, "Destination row padding must be a multiple of 8 bits for this format");
 
-    int srcIndex = 0;
-    int dstByteOffset = 0;
-    int dstRowPadBytes = dstRowPadBits / 8;
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
+    const int dstRowBytes = 4 * srcWidth + dstRowPadBits / 8;
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
     const Color4* src = static_cast<const Color4*>(srcBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        if (invertY) {
-            srcIndex = srcWidth * (srcHeight - 1 - y);
-        }
-        for (int x = 0; x < srcWidth; ++x, ++srcIndex, dstByteOffset += 4) {
-            Color4unorm8&  d = *reinterpret_cast<Color4unorm8*>(dst + dstByteOffset);
-            const Color4& s = src[srcIndex];
-
-            d = Color4unorm8(s);
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int srcY = invertY ? (srcHeight - 1 - y) : y;
+            color4ToUnorm8(src + srcY * srcWidth, dst + y * dstRowBytes, 4, false, srcWidth);
         }
-        dstByteOffset += dstRowPadBytes;
-    } 
+    });
 }
 
 static void rgba32f_to_bgr8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
     debugAssertM(dstRowPadBits % 8 == 0, "Destination row padding must be a multiple of 8 bits for this format");
 
-    int srcIndex = 0;
-    int dstByteOffset = 0;
-    int dstRowPadBytes = dstRowPadBits / 8;
-    unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
+    const int dstRowBytes = 3 * srcWidth + dstRowPadBits / 8;
+    uint8* dst = static_cast<uint8*>(dstBytes[0]);
     const Color4* src = static_cast<const Color4*>(srcBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        if (invertY) {
-            srcIndex = srcWidth * (srcHeight - y - 1);
-        }
-        
-        for (int x = 0; x < srcWidth; ++x, ++srcIndex, dstByteOffset += 3) {
-            Color3unorm8&  d = *reinterpret_cast<Color3unorm8*>(dst + dstByteOffset);
-            const Color4& s = src[srcIndex];
-
-            d = Color3unorm8(s.rgb()).bgr();
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            const int srcY = invertY ? (srcHeight - 1 - y) : y;
+            color4ToUnorm8(src + srcY * srcWidth, dst + y * dstRowBytes, 3, true, srcWidth);
         }
-        dstByteOffset += dstRowPadBytes;
-    } 
+    });
 }
 
 static void rgba32f_to_rgb32f(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
@@ -548,6 +688,41 @@ static uint32 blendPixels(uint32 pixel1, uint32 pixel2) {
 #define PIXEL_RGB8_TO_YUV_U(r, g, b) unorm8::fromBits(iClamp(((-38 * r.bits() - 74 * g.bits() + 112 * b.bits() + 128) >> 8) + 128, 0, 255))
 #define PIXEL_RGB8_TO_YUV_V(r, g, b) unorm8::fromBits(iClamp(((112 * r.bits() - 94 * g.bits() - 18 * b.bits() + 128) >> 8) + 128, 0, 255))
 
+/** Vector loop of rgb8ToLuma().  Returns the number of pixels that it converted. */
+static G3D_TARGET_SSE4_1 int rgb8ToLumaSIMD(const Color3unorm8* src, unorm8* dst, int n) {
+    int i = 0;
+    const uint8* s = reinterpret_cast<const uint8*>(src);
+    // Widens the channels of four pixels to 16 bits as (r, g) pairs and (b, 0) pairs,
+    // so that one multiply-add per pair evaluates the weighted sum
+    const __m128i rgShuffle = _mm_setr_epi8(0, -1, 1, -1, 3, -1, 4, -1, 6, -1, 7, -1,  9, -1, 10, -1);
+    const __m128i bShuffle  = _mm_setr_epi8(2, -1, -1, -1, 5, -1, -1, -1, 8, -1, -1, -1, 11, -1, -1, -1);
+    const __m128i rgWeight  = _mm_setr_epi16(66, 129, 66, 129, 66, 129, 66, 129);
+    const __m128i bWeight   = _mm_setr_epi16(25, 0, 25, 0, 25, 0, 25, 0);
+    const __m128i round     = _mm_set1_epi32(128);
+    const __m128i offset    = _mm_set1_epi32(16);
+
+    // Each load reads four bytes past the four pixels that it converts
+    for (; i + 6 <= n; i += 4) {
+        const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + 3 * i));
+        __m128i y = _mm_add_epi32(_mm_madd_epi16(_mm_shuffle_epi8(rgb, rgShuffle), rgWeight),
+                                  _mm_madd_epi16(_mm_shuffle_epi8(rgb, bShuffle), bWeight));
+        y = _mm_add_epi32(_mm_srai_epi32(_mm_add_epi32(y, round), 8), offset);
+
+        const int32 bytes = _mm_cvtsi128_si32(_mm_packus_epi16(_mm_packus_epi32(y, y), y));
+        memcpy(reinterpret_cast<uint8*>(dst + i), &bytes, 4);
+    }
+    return i;
+}
+
+/** Luma of \a n packed RGB8 pixels, matching PIXEL_RGB8_TO_YUV_Y */
+static void rgb8ToLuma(const Color3unorm8* src, unorm8* dst, int n) {
+    int i = useSIMD() ? rgb8ToLumaSIMD(src, dst, n) : 0;
+
+    for (; i < n; ++i) {
+        dst[i] = PIXEL_RGB8_TO_YUV_Y(src[i].r, src[i].g, src[i].b);
+    }
+}
+
 static void rgb8_to_yuv420p(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
     debugAssertM(srcRowPadBits == 0, "Source row padding must be 0 for this format");
     debugAssertM((srcWidth % 2 == 0) && (srcHeight % 2 == 0), "Source width and height must be a multiple of two");
@@ -558,32 +733,27 @@ static void rgb8_to_yuv420p(const Array<const void*>& srcBytes, int srcWidth, in
     unorm8* dstU = static_cast<unorm8*>(dstBytes[1]);
     unorm8* dstV = static_cast<unorm8*>(dstBytes[2]);
 
-    for (int y = 0; y < srcHeight; y += 2) {
-        for (int x = 0; x < srcWidth; x += 2) {
-
-            // convert 4-pixel block at a time
-            int srcPixelOffset0 = y * srcWidth + x;
-            int srcPixelOffset1 = srcPixelOffset0 + 1;
-            int srcPixelOffset2 = srcPixelOffset0 + srcWidth;
-            int srcPixelOffset3 = srcPixelOffset2 + 1;
-
-            int yIndex = y * srcWidth + x;
-
-            dstY[yIndex] =     PIXEL_RGB8_TO_YUV_Y(src[srcPixelOffset0].r, src[srcPixelOffset0].g, src[srcPixelOffset0].b);
-            dstY[yIndex + 1] = PIXEL_RGB8_TO_YUV_Y(src[srcPixelOffset1].r, src[srcPixelOffset1].g, src[srcPixelOffset1].b);
-
-            yIndex += srcWidth;
-            dstY[yIndex] =     PIXEL_RGB8_TO_YUV_Y(src[srcPixelOffset2].r, src[srcPixelOffset2].g, src[srcPixelOffset2].b);
-            dstY[yIndex + 1] = PIXEL_RGB8_TO_YUV_Y(src[srcPixelOffset3].r, src[srcPixelOffset3].g, src[srcPixelOffset3].b);
-
-            uint32 blendedPixel = blendPixels(src[srcPixelOffset0].asUInt32(), src[srcPixelOffset2].asUInt32());
-            Color3unorm8 uvSrcColor = Color3unorm8::fromARGB(blendedPixel);
-
-            int uvIndex = y / 2 * srcWidth / 2 + x / 2;
-            dstU[uvIndex] =    PIXEL_RGB8_TO_YUV_U(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
-            dstV[uvIndex] =    PIXEL_RGB8_TO_YUV_V(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
+    // Each range of block rows is independent
+    forEachRowRange(srcHeight / 2, 2 * srcWidth, [&](int begin, int end) {
+        for (int y = 2 * begin; y < 2 * end; y += 2) {
+            // The luma of both rows of blocks is contiguous
+            rgb8ToLuma(src + y * srcWidth, dstY + y * srcWidth, 2 * srcWidth);
+
+            for (int x = 0; x < srcWidth; x += 2) {
+                // Chroma of each 4-pixel block, from the average of its left column.
+                // This is blendPixels() without the packing and unpacking.
+                const Color3unorm8& s0 = src[y * srcWidth + x];
+                const Color3unorm8& s2 = src[(y + 1) * srcWidth + x];
+                const Color3unorm8 uvSrcColor(unorm8::fromBits(uint8((s0.r.bits() + s2.r.bits()) >> 1)),
+                                              unorm8::fromBits(uint8((s0.g.bits() + s2.g.bits()) >> 1)),
+                                              unorm8::fromBits(uint8((s0.b.bits() + s2.b.bits()) >> 1)));
+
+                int uvIndex = y / 2 * srcWidth / 2 + x / 2;
+                dstU[uvIndex] =    PIXEL_RGB8_TO_YUV_U(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
+                dstV[uvIndex] =    PIXEL_RGB8_TO_YUV_V(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
+            }
         }
-    }
+    });
 }
 
 static void rgb8_to_yuv422(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
@@ -594,26 +764,28 @@ static void rgb8_to_yuv422(const Array<const void*>& srcBytes, int srcWidth, int
 
     unorm8* dst = static_cast<unorm8*>(dstBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; x += 2) {
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            for (int x = 0; x < srcWidth; x += 2) {
 
-            // convert 2-pixel horizontal block at a time
-            int srcIndex = y * srcWidth + x;
-            int dstIndex = srcIndex * 2;
+                // convert 2-pixel horizontal block at a time
+                int srcIndex = y * srcWidth + x;
+                int dstIndex = srcIndex * 2;
 
-            uint32 blendedPixel = blendPixels(src[srcIndex].asUInt32(), src[srcIndex + 1].asUInt32());
-            Color3unorm8 uvSrcColor = Color3unorm8::fromARGB(blendedPixel);
+                uint32 blendedPixel = blendPixels(src[srcIndex].asUInt32(), src[srcIndex + 1].asUInt32());
+                Color3unorm8 uvSrcColor = Color3unorm8::fromARGB(blendedPixel);
 
-            dst[dstIndex]     = PIXEL_RGB8_TO_YUV_Y(src[srcIndex].r, src[srcIndex].g, src[srcIndex].b);
+                dst[dstIndex]     = PIXEL_RGB8_TO_YUV_Y(src[srcIndex].r, src[srcIndex].g, src[srcIndex].b);
 
-            dst[dstIndex + 1] = PIXEL_RGB8_TO_YUV_U(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
+                dst[dstIndex + 1] = PIXEL_RGB8_TO_YUV_U(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
 
-            dst[dstIndex + 2] = PIXEL_RGB8_TO_YUV_Y(src[srcIndex + 1].r, src[srcIndex + 1].g, src[srcIndex + 1].b);
+                dst[dstIndex + 2] = PIXEL_RGB8_TO_YUV_Y(src[srcIndex + 1].r, src[srcIndex + 1].g, src[srcIndex + 1].b);
 
-            dst[dstIndex + 3] = PIXEL_RGB8_TO_YUV_V(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
+                dst[dstIndex + 3] = PIXEL_RGB8_TO_YUV_V(uvSrcColor.r, uvSrcColor.g, uvSrcColor.b);
 
+            }
         }
-    }
+    });
 }
 
 static void rgb8_to_yuv444(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
@@ -623,20 +795,22 @@ static void rgb8_to_yuv444(const Array<const void*>& srcBytes, int srcWidth, int
 
     Color3unorm8* dst = static_cast<Color3unorm8*>(dstBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            for (int x = 0; x < srcWidth; ++x) {
 
-            // convert 1-pixels at a time
-            int index = y * srcWidth + x;
-            unorm8 y = PIXEL_RGB8_TO_YUV_Y(src[index].r, src[index].g, src[index].b);
-            unorm8 u = PIXEL_RGB8_TO_YUV_U(src[index].r, src[index].g, src[index].b);
-            unorm8 v = PIXEL_RGB8_TO_YUV_V(src[index].r, src[index].g, src[index].b);
+                // convert 1-pixels at a time
+                int index = y * srcWidth + x;
+                unorm8 y = PIXEL_RGB8_TO_YUV_Y(src[index].r, src[index].g, src[index].b);
+                unorm8 u = PIXEL_RGB8_TO_YUV_U(src[index].r, src[index].g, src[index].b);
+                unorm8 v = PIXEL_RGB8_TO_YUV_V(src[index].r, src[index].g, src[index].b);
 
-            dst[index].r = y;
-            dst[index].g = u;
-            dst[index].b = v;
+                dst[index].r = y;
+                dst[index].g = u;
+                dst[index].b = v;
+            }
         }
-    }
+    });
 }
 
 
@@ -654,25 +828,27 @@ static void yuv420p_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, in
 
     Color3unorm8* dst = static_cast<Color3unorm8*>(dstBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; x += 2) {
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            for (int x = 0; x < srcWidth; x += 2) {
 
-            // convert to two rgb pixels in a row
-            Color3unorm8* rgb = &dst[y * srcWidth + x];
+                // convert to two rgb pixels in a row
+                Color3unorm8* rgb = &dst[y * srcWidth + x];
 
-            int yOffset = y * srcWidth + x;
-            int uvOffset = y / 2 * srcWidth / 2 + x / 2;
+                int yOffset = y * srcWidth + x;
+                int uvOffset = y / 2 * srcWidth / 2 + x / 2;
 
-            rgb->r = PIXEL_YUV_TO_RGB8_R(srcY[yOffset], srcU[uvOffset], srcV[uvOffset]);
-            rgb->g = PIXEL_YUV_TO_RGB8_G(srcY[yOffset], srcU[uvOffset], srcV[uvOffset]);
-            rgb->b = PIXEL_YUV_TO_RGB8_B(srcY[yOffset], srcU[uvOffset], srcV[uvOffset]);
+                rgb->r = PIXEL_YUV_TO_RGB8_R(srcY[yOffset], srcU[uvOffset], srcV[uvOffset]);
+                rgb->g = PIXEL_YUV_TO_RGB8_G(srcY[yOffset], srcU[uvOffset], srcV[uvOffset]);
+                rgb->b = PIXEL_YUV_TO_RGB8_B(srcY[yOffset], srcU[uvOffset], srcV[uvOffset]);
 
-            rgb += 1;
-            rgb->r = PIXEL_YUV_TO_RGB8_R(srcY[yOffset + 1], srcU[uvOffset], srcV[uvOffset]);
-            rgb->g = PIXEL_YUV_TO_RGB8_G(srcY[yOffset + 1], srcU[uvOffset], srcV[uvOffset]);
-            rgb->b = PIXEL_YUV_TO_RGB8_B(srcY[yOffset + 1], srcU[uvOffset], srcV[uvOffset]);
+                rgb += 1;
+                rgb->r = PIXEL_YUV_TO_RGB8_R(srcY[yOffset + 1], srcU[uvOffset], srcV[uvOffset]);
+                rgb->g = PIXEL_YUV_TO_RGB8_G(srcY[yOffset + 1], srcU[uvOffset], srcV[uvOffset]);
+                rgb->b = PIXEL_YUV_TO_RGB8_B(srcY[yOffset + 1], srcU[uvOffset], srcV[uvOffset]);
+            }
         }
-    }
+    });
 }
 
 static void yuv422_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
@@ -683,28 +859,30 @@ static void yuv422_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int
 
     Color3unorm8* dst = static_cast<Color3unorm8*>(dstBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; x += 2) {
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            for (int x = 0; x < srcWidth; x += 2) {
 
-            // convert to two rgb pixels in a row
-            Color3unorm8* rgb = &dst[y * srcWidth + x];
+                // convert to two rgb pixels in a row
+                Color3unorm8* rgb = &dst[y * srcWidth + x];
             
-            const int srcIndex = (y * srcWidth + x) * 2;
-            const unorm8 y  = src[srcIndex];
-            const unorm8 u  = src[srcIndex + 1];
-            const unorm8 y2 = src[srcIndex + 2];
-            const unorm8 v  = src[srcIndex + 3];
-
-            rgb->r = PIXEL_YUV_TO_RGB8_R(y, u, v);
-            rgb->g = PIXEL_YUV_TO_RGB8_G(y, u, v);
-            rgb->b = PIXEL_YUV_TO_RGB8_B(y, u, v);
-
-            rgb += 1;
-            rgb->r = PIXEL_YUV_TO_RGB8_R(y2, u, v);
-            rgb->g = PIXEL_YUV_TO_RGB8_G(y2, u, v);
-            rgb->b = PIXEL_YUV_TO_RGB8_B(y2, u, v);
+                const int srcIndex = (y * srcWidth + x) * 2;
+                const unorm8 y  = src[srcIndex];
+                const unorm8 u  = src[srcIndex + 1];
+                const unorm8 y2 = src[srcIndex + 2];
+                const unorm8 v  = src[srcIndex + 3];
+
+                rgb->r = PIXEL_YUV_TO_RGB8_R(y, u, v);
+                rgb->g = PIXEL_YUV_TO_RGB8_G(y, u, v);
+                rgb->b = PIXEL_YUV_TO_RGB8_B(y, u, v);
+
+                rgb += 1;
+                rgb->r = PIXEL_YUV_TO_RGB8_R(y2, u, v);
+                rgb->g = PIXEL_YUV_TO_RGB8_G(y2, u, v);
+                rgb->b = PIXEL_YUV_TO_RGB8_B(y2, u, v);
+            }
         }
-    }
+    });
 }
 
 static void yuv444_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int srcHeight, const ImageFormat* srcFormat, int srcRowPadBits, const Array<void*>& dstBytes, const ImageFormat* dstFormat, int dstRowPadBits, bool invertY, ImageFormat::BayerAlgorithm bayerAlg) {
@@ -714,19 +892,21 @@ static void yuv444_to_rgb8(const Array<const void*>& srcBytes, int srcWidth, int
 
     Color3unorm8* dst = static_cast<Color3unorm8*>(dstBytes[0]);
 
-    for (int y = 0; y < srcHeight; ++y) {
-        for (int x = 0; x < srcWidth; ++x) {
+    forEachRowRange(srcHeight, srcWidth, [&](int begin, int end) {
+        for (int y = begin; y < end; ++y) {
+            for (int x = 0; x < srcWidth; ++x) {
 
-            // convert to one rgb pixels at a time
-            const int index = y * srcWidth + x;
-            const Color3unorm8 s = src[index];
+                // convert to one rgb pixels at a time
+                const int index = y * srcWidth + x;
+                const Color3unorm8 s = src[index];
 
-            Color3unorm8& rgb = dst[index];
-            rgb.r = PIXEL_YUV_TO_RGB8_R(s.r, s.g, s.b);
-            rgb.g = PIXEL_YUV_TO_RGB8_G(s.r, s.g, s.b);
-            rgb.b = PIXEL_YUV_TO_RGB8_B(s.r, s.g, s.b);
+                Color3unorm8& rgb = dst[index];
+                rgb.r = PIXEL_YUV_TO_RGB8_R(s.r, s.g, s.b);
+                rgb.g = PIXEL_YUV_TO_RGB8_G(s.r, s.g, s.b);
+                rgb.b = PIXEL_YUV_TO_RGB8_B(s.r, s.g, s.b);
+            }
         }
-    }
+    });
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -827,11 +1007,10 @@ static unorm8 applyFilter(const unorm8*    I,
 
 /** Helper method for Bayer grbg and bggr --> rgb8 */
 static void swapRedAndBlue(int N, Color3unorm8* out) {
-    for (int i = N - 1; i >= 0; --i) {
-    unorm8 tmp = out[i].r;
-    out[i].r = out[i].b;
-    out[i].b = tmp;
-    }
+    uint8* bytes = reinterpret_cast<uint8*>(out);
+    forEachRowRange(N, 1, [&](int begin, int end) {
+        swap3(bytes + 3 * begin, bytes + 3 * begin, end - begin);
+    });
 }
 
 // RGB -> BAYER color space
@@ -1038,52 +1217,55 @@ static void bayer_rggb8_to_rgb8_mhc(int w, int h,
                     const unorm8* in, unorm8* _out) {
     debugAssert(in != _out);
 
-    Color3unorm8* out = (Color3unorm8*)_out;
+    // Each row of the range pairs an RG row with the GB row below it
+    forEachRowRange(h / 2, 2 * w, [&](int begin, int end) {
+        Color3unorm8* out = (Color3unorm8*)_out + 2 * begin * w;
 
-    for (int y = 0; y < h; ++y) {
+        for (int y = 2 * begin; y < 2 * end; ++y) {
 
-    // Row beginning in the input array.
-    int offset = y * w;
+        // Row beginning in the input array.
+        int offset = y * w;
 
-    // RG row
-    for (int x = 0; x < w; ++x, ++out) {
-        // R pixel
-        {
-        out->r = in[x + offset];
-        out->g = applyFilter(in, x, y, w, h, G_GRR);
-        out->b = applyFilter(in, x, y, w, h, B_GRR);
-        }
-        ++x; ++out;
+        // RG row
+        for (int x = 0; x < w; ++x, ++out) {
+            // R pixel
+            {
+            out->r = in[x + offset];
+            out->g = applyFilter(in, x, y, w, h, G_GRR);
+            out->b = applyFilter(in, x, y, w, h, B_GRR);
+            }
+            ++x; ++out;
 
-        // G pixel
-        {
-        out->r = applyFilter(in, x, y, w, h, R_GRG);
-        out->g = in[x + offset];
-        out->b = applyFilter(in, x, y, w, h, B_GRG);
+            // G pixel
+            {
+            out->r = applyFilter(in, x, y, w, h, R_GRG);
+            out->g = in[x + offset];
+            out->b = applyFilter(in, x, y, w, h, B_GRG);
+            }
         }
-    }
 
-    ++y;
-    offset += w;
+        ++y;
+        offset += w;
 
-    // GB row
-    for (int x = 0; x < w; ++x, ++out) {
-        // G pixel
-        {
-        out->r = applyFilter(in, x, y, w, h, R_BGG);
-        out->g = in[x + offset];
-        out->b = applyFilter(in, x, y, w, h, B_BGG);
-        }
-        ++x; ++out;
+        // GB row
+        for (int x = 0; x < w; ++x, ++out) {
+            // G pixel
+            {
+            out->r = applyFilter(in, x, y, w, h, R_BGG);
+            out->g = in[x + offset];
+            out->b = applyFilter(in, x, y, w, h, B_BGG);
+            }
+            ++x; ++out;
 
-        // B pixel
-        {
-        out->r = applyFilter(in, x, y, w, h, R_BGB);
-        out->g = applyFilter(in, x, y, w, h, G_BGB);
-        out->b = in[x + offset];
+            // B pixel
+            {
+            out->r = applyFilter(in, x, y, w, h, R_BGB);
+            out->g = applyFilter(in, x, y, w, h, G_BGB);
+            out->b = in[x + offset];
+            }
         }
-    }
-    }
+        }
+    });
 }
 
 
@@ -1093,31 +1275,33 @@ static void bayer_gbrg8_to_rgb8_mhc(int w, int h,
 
     debugAssert(in != _out);
 
-    Color3unorm8* out = (Color3unorm8*)_out;
+    forEachRowRange(h, w, [&](int begin, int end) {
+        Color3unorm8* out = (Color3unorm8*)_out + begin * w;
 
-    for (int y = 0; y < h; ++y) {
+        for (int y = begin; y < end; ++y) {
 
-    // Row beginning in the input array.
-    int offset = y * w;
+        // Row beginning in the input array.
+        int offset = y * w;
 
-    // GB row
-    for (int x = 0; x < w; ++x, ++out) {
-        // G pixel
-        {
-        out->r = applyFilter(in, x, y, w, h, R_BGG);
-        out->g = in[x + offset];
-        out->b = applyFilter(in, x, y, w, h, B_BGG);
-        }
-        ++x; ++out;
+        // GB row
+        for (int x = 0; x < w; ++x, ++out) {
+            // G pixel
+            {
+            out->r = applyFilter(in, x, y, w, h, R_BGG);
+            out->g = in[x + offset];
+            out->b = applyFilter(in, x, y, w, h, B_BGG);
+            }
+            ++x; ++out;
 
-        // B pixel
-        {
-        out->r = applyFilter(in, x, y, w, h, R_BGB);
-        out->g = applyFilter(in, x, y, w, h, G_BGB);
-        out->b = in[x + offset];
+            // B pixel
+            {
+            out->r = applyFilter(in, x, y, w, h, R_BGB);
+            out->g = applyFilter(in, x, y, w, h, G_BGB);
+            out->b = in[x + offset];
+            }
         }
-    }
-    }
+        }
+    });
 }
 
 
@@ -0,0 +1,202 @@
+/**
+  \file ImageLoader.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+ */
+
+#include "G3D/ImageLoader.h"
+#include "G3D/Image.h"
+#include "G3D/GThread.h"
+#include "G3D/Array.h"
+#include "G3D/System.h"
+#include <mutex>
+#include <condition_variable>
+#include <queue>
+
+namespace G3D {
+
+namespace _internal {
+
+class ImageLoaderPool {
+private:
+
+    class PendingJob {
+    public:
+        ImageLoader::Job    job;
+        int                 priority;
+
+        /** Breaks ties between equal priorities in submission order */
+        uint64              sequence;
+
+        PendingJob() : priority(0), sequence(0) {}
+
+        PendingJob(const ImageLoader::Job& job, int priority, uint64 sequence) :
+            job(job), priority(priority), sequence(sequence) {}
+
+        /** Ordering for std::priority_queue, which pops the largest element */
+        bool operator<(const PendingJob& other) const {
+            return (priority < other.priority) ||
+                ((priority == other.priority) && (sequence > other.sequence));
+        }
+    };
+
+    class Worker : public GThread {
+    private:
+        ImageLoaderPool*    m_pool;
+        const int           m_index;
+    protected:
+        virtual void threadMain() override {
+            m_pool->workerMain(m_index);
+        }
+    public:
+        Worker(ImageLoaderPool* pool, int index) :
+            GThread(format("ImageLoader worker %d", index)),
+            m_pool(pool),
+            m_index(index) {}
+    };
+
+    std::mutex                          m_mutex;
+    std::condition_variable             m_wakeCondition;
+
+    std::priority_queue<PendingJob>     m_queue;
+    uint64                              m_nextSequence;
+
+    Array<shared_ptr<GThread>>          m_worker;
+
+    /** Workers that are waiting for a job */
+    int                                 m_numIdle;
+
+    int                                 m_maxThreads;
+
+    static int defaultMaxThreads() {
+        return iClamp(2 * System::numCores(), 2, 16);
+    }
+
+    void workerMain(int index) {
+        std::unique_lock<std::mutex> guard(m_mutex);
+        while (true) {
+            ++m_numIdle;
+            m_wakeCondition.wait(guard, [this, index] { return (index < m_maxThreads) && ! m_queue.empty(); });
+            --m_numIdle;
+
+            const PendingJob pending = m_queue.top();
+            m_queue.pop();
+
+            guard.unlock();
+            pending.job();
+            guard.lock();
+        }
+    }
+
+public:
+
+    ImageLoaderPool() : m_nextSequence(0), m_numIdle(0), m_maxThreads(defaultMaxThreads()) {}
+
+    static ImageLoaderPool& instance() {
+        // Intentionally never deleted; the workers sleep until the process exits
+        static ImageLoaderPool* s = new ImageLoaderPool();
+        return *s;
+    }
+
+    void enqueue(const ImageLoader::Job& job, int priority) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_queue.push(PendingJob(job, priority, m_nextSequence++));
+
+        if ((m_numIdle == 0) && (m_worker.size() < m_maxThreads)) {
+            m_worker.append(shared_ptr<GThread>(new Worker(this, m_worker.size())));
+            m_worker.last()->start();
+        } else {
+            // Wake all workers, because a surplus worker that received a
+            // single notification would go back to sleep without the job
+            m_wakeCondition.notify_all();
+        }
+    }
+
+    bool runPendingJob() {
+        PendingJob pending;
+        {
+            std::lock_guard<std::mutex> guard(m_mutex);
+            if (m_queue.empty()) {
+                return false;
+            }
+            pending = m_queue.top();
+            m_queue.pop();
+        }
+        pending.job();
+        return true;
+    }
+
+    void setMaxThreads(int n) {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        m_maxThreads = (n < 1) ? defaultMaxThreads() : n;
+        m_wakeCondition.notify_all();
+    }
+
+    int maxThreads() {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_maxThreads;
+    }
+
+    int numThreads() {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return m_worker.size();
+    }
+
+    int numPending() {
+        std::lock_guard<std::mutex> guard(m_mutex);
+        return int(m_queue.size());
+    }
+};
+
+} // namespace _internal
+
+
+ImageLoader::Future ImageLoader::load(const String& filename, const ImageFormat* imageFormat, int priority) {
+    const shared_ptr<std::promise<shared_ptr<Image> > > promise(new std::promise<shared_ptr<Image> >());
+    const Future future(promise->get_future());
+
+    enqueue([promise, filename, imageFormat]() {
+        try {
+            promise->set_value(Image::fromFile(filename, imageFormat));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    }, priority);
+
+    return future;
+}
+
+
+void ImageLoader::enqueue(const Job& job, int priority) {
+    _internal::ImageLoaderPool::instance().enqueue(job, priority);
+}
+
+
+bool ImageLoader::runPendingJob() {
+    return _internal::ImageLoaderPool::instance().runPendingJob();
+}
+
+
+void ImageLoader::setMaxThreads(int n) {
+    _internal::ImageLoaderPool::instance().setMaxThreads(n);
+}
+
+
+int ImageLoader::maxThreads() {
+    return _internal::ImageLoaderPool::instance().maxThreads();
+}
+
+
+int ImageLoader::numThreads() {
+    return _internal::ImageLoaderPool::instance().numThreads();
+}
+
+
+int ImageLoader::numPending() {
+    return _internal::ImageLoaderPool::instance().numPending();
+}
+
+} // namespace G3D
@@ -3,7 +3,7 @@
 
   @maintainer Morgan McGuire, http://graphics.cs.williams.edu
   @created 2001-08-04
-  @edited  2010-01-15
+  @edited  2026-10-17
  */
 
 #include "G3D/platform.h"
@@ -12,14 +12,24 @@
 #include "G3D/Array.h"
 #include "G3D/fileutils.h"
 #include "G3D/FileSystem.h"
+#include "G3D/GThread.h"
+#include "G3D/Table.h"
 #include <time.h>
+#include <signal.h>
+#include <errno.h>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 #ifdef G3D_WINDOWS
 #   pragma warning(disable : 4091)
 #   include <imagehlp.h>
 #   pragma warning(default : 4091)
+#   include <io.h>
 #else
 #   include <stdarg.h>
+#   include <unistd.h>
 #endif
 
 namespace G3D {
@@ -41,7 +51,247 @@ void logLazyPrintf(const char* fmt, ...) {
 
 Log* Log::commonLog = NULL;
 
-Log::Log(const String& filename) {
+/** Only the owning thread writes to the buffer and only drain() reads from it,
+    so appending needs no lock. */
+class Log::AsyncWriter {
+public:
+
+    class ThreadBuffer {
+    public:
+        /** Power-of-two length. Byte i is stored at ring[i % size()]. */
+        Array<char>             ring;
+
+        /** Number of bytes ever appended. Written by the owning thread. */
+        std::atomic<uint64>     head;
+
+        /** Number of bytes ever written to disk. Written by drain(). */
+        std::atomic<uint64>     tail;
+
+        std::atomic<int>        numDropped;
+
+        ThreadBuffer(int size) : head(0), tail(0), numDropped(0) {
+            ring.resize(ceilPow2(max(size, 256)));
+        }
+    };
+
+    /** Unique across all AsyncWriters ever created, so that a thread's
+        cached buffer is never mistaken for one belonging to a destroyed writer */
+    const uint64                id;
+
+    FILE*                       file;
+
+    /** Descriptor of file, for writing without stdio from a signal handler */
+    const int                   fd;
+
+    const int                   bufferSize;
+
+    /** Protects everything below and the file */
+    std::mutex                  mutex;
+
+    std::condition_variable     wakeCondition;
+
+    bool                        quit;
+
+    Array<ThreadBuffer*>        bufferArray;
+
+    /** Keyed by the address of a thread-local variable, which is unique among running threads */
+    Table<uintptr_t, ThreadBuffer*> bufferTable;
+
+    /** Total messages dropped, including those not yet reported in the file */
+    std::atomic<int>            numDropped;
+
+    GThreadRef                  thread;
+
+    /** The buffer last used by this thread and the id of the AsyncWriter that owns it */
+    static __thread ThreadBuffer* s_threadBuffer;
+    static __thread uint64      s_threadBufferWriterID;
+
+    AsyncWriter(FILE* file, int bufferSize);
+
+    /** Writes the pending messages and stops the writer thread */
+    ~AsyncWriter();
+
+    /** Buffer for the current thread, created on first use */
+    ThreadBuffer* threadBuffer();
+
+    void append(const char* s, size_t len);
+
+    /** Writes all published messages and flushes the file. Requires the mutex. */
+    void drain();
+
+    /** Writes the published messages straight to fd without locks or stdio, so that
+        it can run in a signal handler. Best effort: a crash while a thread is adding
+        its buffer may leave bufferArray inconsistent. */
+    void drainFromSignal();
+
+    static void threadMain(void* writer);
+};
+
+
+static std::atomic<uint64> s_nextAsyncWriterID(1);
+
+__thread Log::AsyncWriter::ThreadBuffer* Log::AsyncWriter::s_threadBuffer = NULL;
+__thread uint64 Log::AsyncWriter::s_threadBufferWriterID = 0;
+
+/** Logs that are asynchronous, for flushing at exit and on crashes */
+static std::mutex s_asyncLogMutex;
+static Array<Log*> s_asyncLogArray;
+
+
+Log::AsyncWriter::AsyncWriter(FILE* file, int bufferSize) : 
+    id(s_nextAsyncWriterID.fetch_add(1)), file(file),
+#   ifdef G3D_WINDOWS
+        fd(_fileno(file)),
+#   else
+        fd(fileno(file)),
+#   endif
+    bufferSize(bufferSize), quit(false), numDropped(0) {
+    thread = GThread::create("Log::AsyncWriter", &threadMain, this);
+    thread->start();
+}
+
+
+Log::AsyncWriter::~AsyncWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+    }
+    wakeCondition.notify_one();
+    thread->waitForCompletion();
+
+    for (int i = 0; i < bufferArray.size(); ++i) {
+        delete bufferArray[i];
+    }
+}
+
+
+void Log::AsyncWriter::threadMain(void* w) {
+    AsyncWriter* writer = static_cast<AsyncWriter*>(w);
+    std::unique_lock<std::mutex> lock(writer->mutex);
+    while (! writer->quit) {
+        writer->wakeCondition.wait_for(lock, std::chrono::milliseconds(10));
+        writer->drain();
+    }
+    writer->drain();
+}
+
+
+Log::AsyncWriter::ThreadBuffer* Log::AsyncWriter::threadBuffer() {
+    if (s_threadBufferWriterID != id) {
+        std::lock_guard<std::mutex> lock(mutex);
+        const uintptr_t key = uintptr_t(&s_threadBuffer);
+        ThreadBuffer** existing = bufferTable.getPointer(key);
+        if (notNull(existing)) {
+            // A previous thread with the same thread-local address has exited
+            s_threadBuffer = *existing;
+        } else {
+            s_threadBuffer = new ThreadBuffer(bufferSize);
+            bufferArray.append(s_threadBuffer);
+            bufferTable.set(key, s_threadBuffer);
+        }
+        s_threadBufferWriterID = id;
+    }
+    return s_threadBuffer;
+}
+
+
+void Log::AsyncWriter::append(const char* s, size_t len) {
+    ThreadBuffer* buffer = threadBuffer();
+    const uint64 size = buffer->ring.size();
+    const uint64 h = buffer->head.load(std::memory_order_relaxed);
+    const uint64 used = h - buffer->tail.load(std::memory_order_acquire);
+
+    if (used + len > size) {
+        buffer->numDropped.fetch_add(1, std::memory_order_relaxed);
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Copy in up to two pieces around the end of the ring
+    const size_t start = size_t(h & (size - 1));
+    const size_t first = min(len, size_t(size) - start);
+    System::memcpy(buffer->ring.getCArray() + start, s, first);
+    System::memcpy(buffer->ring.getCArray(), s + first, len - first);
+    buffer->head.store(h + len, std::memory_order_release);
+
+    if (used + len > size / 2) {
+        // Write early instead of waiting for the timeout
+        wakeCondition.notify_one();
+    }
+}
+
+
+void Log::AsyncWriter::drain() {
+    bool wrote = false;
+    for (int b = 0; b < bufferArray.size(); ++b) {
+        ThreadBuffer* buffer = bufferArray[b];
+        const uint64 size = buffer->ring.size();
+        const uint64 h = buffer->head.load(std::memory_order_acquire);
+        const uint64 t = buffer->tail.load(std::memory_order_relaxed);
+
+        if (h > t) {
+            const size_t start = size_t(t & (size - 1));
+            const size_t len = size_t(h - t);
+            const size_t first = min(len, size_t(size) - start);
+            fwrite(buffer->ring.getCArray() + start, 1, first, file);
+            fwrite(buffer->ring.getCArray(), 1, len - first, file);
+            buffer->tail.store(h, std::memory_order_release);
+            wrote = true;
+        }
+
+        const int dropped = buffer->numDropped.exchange(0, std::memory_order_relaxed);
+        if (dropped > 0) {
+            fprintf(file, "[Log dropped %d messages from a full buffer]\n", dropped);
+            wrote = true;
+        }
+    }
+
+    if (wrote) {
+        fflush(file);
+    }
+}
+
+
+/** Writes all of [s, s + len) with the async-signal-safe write(2) */
+static void writeToDescriptor(int fd, const char* s, size_t len) {
+    while (len > 0) {
+#       ifdef G3D_WINDOWS
+            const int n = _write(fd, s, (unsigned int)min(len, size_t(1) << 30));
+#       else
+            const ssize_t n = ::write(fd, s, len);
+#       endif
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        s += n;
+        len -= size_t(n);
+    }
+}
+
+
+void Log::AsyncWriter::drainFromSignal() {
+    for (int b = 0; b < bufferArray.size(); ++b) {
+        ThreadBuffer* buffer = bufferArray[b];
+        const uint64 size = buffer->ring.size();
+        const uint64 h = buffer->head.load(std::memory_order_acquire);
+        const uint64 t = buffer->tail.load(std::memory_order_relaxed);
+
+        if (h > t) {
+            const size_t start = size_t(t & (size - 1));
+            const size_t len = size_t(h - t);
+            const size_t first = min(len, size_t(size) - start);
+            writeToDescriptor(fd, buffer->ring.getCArray() + start, first);
+            writeToDescriptor(fd, buffer->ring.getCArray(), len - first);
+            buffer->tail.store(h, std::memory_order_release);
+        }
+    }
+}
+
+
+Log::Log(const String& filename) : m_asyncWriter(NULL) {
     this->filename = filename;
 
     logFile = FileSystem::fopen(filename.c_str(), "w");
@@ -80,6 +330,7 @@ Log::Log(const String& filename) {
 Log::~Log() {
     section("Shutdown");
     println("Closing log file");
+    setAsynchronous(false);
     
     // Make sure we don't leave a dangling pointer
     if (Log::commonLog == this) {
@@ -117,40 +368,165 @@ String Log::getCommonLogFilename() {
 }
 
 
+void Log::write(const char* s, size_t len, bool flushNow) {
+    if (notNull(m_asyncWriter)) {
+        m_asyncWriter->append(s, len);
+    } else {
+        fwrite(s, 1, len, logFile);
+        if (flushNow) {
+            fflush(logFile);
+        }
+    }
+}
+
+
+void Log::vwrite(const char* fmt, va_list argPtr, bool flushNow) {
+    // Format short messages on the stack to avoid allocation
+    char buffer[512];
+    va_list argCopy;
+    va_copy(argCopy, argPtr);
+    const int len = vsnprintf(buffer, sizeof(buffer), fmt, argCopy);
+    va_end(argCopy);
+
+    if ((len >= 0) && (len < int(sizeof(buffer)))) {
+        write(buffer, len, flushNow);
+    } else {
+        const String& s = vformat(fmt, argPtr);
+        write(s.c_str(), s.size(), flushNow);
+    }
+}
+
+
 void Log::section(const String& s) {
-    fprintf(logFile, "_____________________________________________________\n");
-    fprintf(logFile, "\n    ###    %s    ###\n\n", s.c_str());
+    const String& text = "_____________________________________________________\n\n    ###    " + s + "    ###\n\n";
+    write(text.c_str(), text.size(), false);
 }
 
 
 void __cdecl Log::printf(const char* fmt, ...) {
     va_list arg_list;
     va_start(arg_list, fmt);
-    print(vformat(fmt, arg_list));
+    vwrite(fmt, arg_list, true);
     va_end(arg_list);
 }
 
 
 void __cdecl Log::vprintf(const char* fmt, va_list argPtr) {
-    vfprintf(logFile, fmt, argPtr);
-    fflush(logFile);
+    vwrite(fmt, argPtr, true);
 }
 
 
 void __cdecl Log::lazyvprintf(const char* fmt, va_list argPtr) {
-    vfprintf(logFile, fmt, argPtr);
+    vwrite(fmt, argPtr, false);
 }
 
 
 void Log::print(const String& s) {
-    fprintf(logFile, "%s", s.c_str());
-    fflush(logFile);
+    write(s.c_str(), s.size(), true);
 }
 
 
 void Log::println(const String& s) {
-    fprintf(logFile, "%s\n", s.c_str());
-    fflush(logFile);
+    if (notNull(m_asyncWriter)) {
+        // Keep the line in a single message
+        const String& line = s + "\n";
+        m_asyncWriter->append(line.c_str(), line.size());
+    } else {
+        fprintf(logFile, "%s\n", s.c_str());
+        fflush(logFile);
+    }
+}
+
+
+/** Installs Log::signalHandler for \a sig unless the program already handles it */
+void Log::installSignalHandler(int sig) {
+    void (*previous)(int) = signal(sig, &signalHandler);
+    if ((previous != SIG_DFL) && (previous != SIG_ERR)) {
+        signal(sig, previous);
+    }
+}
+
+
+void Log::setAsynchronous(bool a, int bufferSize) {
+    if (a == asynchronous()) {
+        return;
+    }
+
+    if (a) {
+        fflush(logFile);
+        m_asyncWriter = new AsyncWriter(logFile, bufferSize);
+
+        std::lock_guard<std::mutex> lock(s_asyncLogMutex);
+        static bool installedHandlers = false;
+        if (! installedHandlers) {
+            installedHandlers = true;
+            atexit(&exitHandler);
+            installSignalHandler(SIGSEGV);
+            installSignalHandler(SIGABRT);
+            installSignalHandler(SIGFPE);
+            installSignalHandler(SIGILL);
+#           ifdef SIGBUS
+                installSignalHandler(SIGBUS);
+#           endif
+        }
+        s_asyncLogArray.append(this);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(s_asyncLogMutex);
+            const int i = s_asyncLogArray.findIndex(this);
+            if (i != -1) {
+                s_asyncLogArray.fastRemove(i);
+            }
+        }
+
+        // The destructor writes all pending messages
+        delete m_asyncWriter;
+        m_asyncWriter = NULL;
+    }
+}
+
+
+void Log::flush() {
+    if (notNull(m_asyncWriter)) {
+        std::lock_guard<std::mutex> lock(m_asyncWriter->mutex);
+        m_asyncWriter->drain();
+    } else {
+        fflush(logFile);
+    }
+}
+
+
+int Log::numDroppedMessages() const {
+    return notNull(m_asyncWriter) ? m_asyncWriter->numDropped.load() : 0;
+}
+
+
+void Log::flushAllAsynchronous() {
+    std::lock_guard<std::mutex> lock(s_asyncLogMutex);
+    for (int i = 0; i < s_asyncLogArray.size(); ++i) {
+        AsyncWriter* writer = s_asyncLogArray[i]->m_asyncWriter;
+        std::lock_guard<std::mutex> writerLock(writer->mutex);
+        writer->drain();
+    }
+}
+
+
+void __cdecl Log::exitHandler() {
+    flushAllAsynchronous();
+}
+
+
+void __cdecl Log::signalHandler(int sig) {
+    // The crashing thread may hold any lock or be inside malloc or stdio, so
+    // only read the published ring bytes and hand them to write(2).  Bytes
+    // that drain() had already passed to fwrite but not yet flushed are lost.
+    for (int i = 0; i < s_asyncLogArray.size(); ++i) {
+        s_asyncLogArray[i]->m_asyncWriter->drainFromSignal();
+    }
+
+    // Invoke the default behavior (usually termination) for the signal
+    signal(sig, SIG_DFL);
+    raise(sig);
 }
 
 }
@@ -17,6 +17,10 @@
 #include "G3D/stringutils.h"
 #include "G3D/debug.h"
 #include "G3D/networkHelpers.h"
+#include "G3D/network.h"
+#ifndef G3D_WINDOWS
+#   include <sys/uio.h>
+#endif
 
 
 namespace G3D {
@@ -866,6 +870,154 @@ void ReliableConduit::send(uint32 type) {
 }
 
 
+void ReliableConduit::send(uint32 type, const NetBufferView* views, int numViews) {
+    debugAssert((numViews == 0) || (views != NULL));
+
+    size_t len = 0;
+    for (int i = 0; i < numViews; ++i) {
+        len += views[i].size;
+    }
+
+    // receive assumes that a zero length message is an error, so send the
+    // same placeholder byte that serializeMessage does.
+    static const uint8 placeholder = 0xFF;
+    const NetBufferView placeholderView(&placeholder, 1);
+    if (len == 0) {
+        views    = &placeholderView;
+        numViews = 1;
+        len      = 1;
+    }
+    alwaysAssertM(len <= 0xFFFFFFFF, "Message is too large for the 32-bit size header");
+
+    // Same header as serializeMessage: the type in little endian order,
+    // followed by the body size in network order.
+    uint32 header[2];
+    header[0] = (System::machineEndian() == G3D_LITTLE_ENDIAN) ? type : flipEndian32(type);
+    #if defined(__GNUC__)
+        header[1] = gcchtonl((uint32)len);
+    #else
+        header[1] = htonl((uint32)len);
+    #endif
+
+    sendBuffers(header, views, numViews);
+}
+
+
+/** Segment \a i of a gathered send: the header when i == 0, otherwise views[i - 1] */
+static void gatherSegment(const uint32 header[2], const NetBufferView* views, int i, const char*& data, size_t& size) {
+    if (i == 0) {
+        data = (const char*)header;
+        size = 2 * sizeof(uint32);
+    } else {
+        data = (const char*)views[i - 1].data;
+        size = views[i - 1].size;
+    }
+}
+
+
+void ReliableConduit::sendBuffers(const uint32 header[2], const NetBufferView* views, int numViews) {
+    NetworkDevice* nd = NetworkDevice::instance();
+
+    // Segments are gathered in batches so that any number of views fits
+    // under the platform limit on buffers per call, and so that a partial
+    // send can resume in the middle of a segment.
+    static const int MAX_BATCH = 64;
+
+#   ifdef G3D_WINDOWS
+        WSABUF buffer[MAX_BATCH];
+#   else
+        iovec  buffer[MAX_BATCH];
+#   endif
+
+    const int numSegments = numViews + 1;
+    int       segment     = 0;
+    size_t    offset      = 0;
+    size_t    total       = 0;
+
+    while (segment < numSegments) {
+        const char* data;
+        size_t size;
+        gatherSegment(header, views, segment, data, size);
+        if (offset >= size) {
+            // Fully sent, or an empty view
+            ++segment;
+            offset = 0;
+            continue;
+        }
+
+        int n = 0;
+        for (int i = segment; (i < numSegments) && (n < MAX_BATCH); ++i) {
+            gatherSegment(header, views, i, data, size);
+            const size_t skip = (i == segment) ? offset : 0;
+            if (size > skip) {
+#               ifdef G3D_WINDOWS
+                    buffer[n].buf = const_cast<char*>(data + skip);
+                    buffer[n].len = (ULONG)(size - skip);
+#               else
+                    buffer[n].iov_base = const_cast<char*>(data + skip);
+                    buffer[n].iov_len  = size - skip;
+#               endif
+                ++n;
+            }
+        }
+
+        size_t sent = 0;
+#       ifdef G3D_WINDOWS
+            DWORD numSent = 0;
+            const int ret = WSASend(sock, buffer, (DWORD)n, &numSent, 0, NULL, NULL);
+            sent = (size_t)numSent;
+#       else
+            msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov    = buffer;
+            msg.msg_iovlen = n;
+            const ssize_t ret = sendmsg(sock, &msg, 0);
+            if ((ret < 0) && (errno == EINTR)) {
+                continue;
+            }
+            sent = (size_t)ret;
+#       endif
+
+        if (ret == SOCKET_ERROR) {
+            Log::common()->println("Error occured while sending message.");
+            Log::common()->println(socketErrorCode());
+            nd->closesocket(sock);
+            return;
+        }
+
+        total += sent;
+
+        // Advance past the bytes that the socket accepted
+        while (sent > 0) {
+            gatherSegment(header, views, segment, data, size);
+            if (sent >= size - offset) {
+                sent -= size - offset;
+                ++segment;
+                offset = 0;
+            } else {
+                offset += sent;
+                sent = 0;
+            }
+        }
+    }
+
+    ++mSent;
+    bSent += total;
+}
+
+
+BinaryInput& ReliableConduit::binaryInput() {
+    alwaysAssertM(messageWaiting(), "No message is waiting");
+    debugAssert(state == HOLDING);
+
+    if (isNull(receiveBinaryInput)) {
+        receiveBinaryInput.reset(new BinaryInput((const uint8*)receiveBuffer, receiveBufferUsedSize, G3D_LITTLE_ENDIAN, false, BinaryInput::NO_COPY));
+    }
+
+    return *receiveBinaryInput;
+}
+
+
 
 NetAddress ReliableConduit::address() const {
     return addr;
@@ -1,5 +1,6 @@
 #include "G3D/platform.h"
 #include "G3D/Noise.h"
+#include <emmintrin.h>
 
 namespace G3D {
 
@@ -64,4 +65,132 @@ float Noise::sampleFloat(int x, int y, int z, int numOctaves) {
 
     return n;
 }
+
+
+/** table[index[i]] in each lane. SSE has no gather instruction. */
+static inline __m128i gather4(const int* table, __m128i index) {
+    int32 i[4];
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(i), index);
+    return _mm_setr_epi32(table[i[0]], table[i[1]], table[i[2]], table[i[3]]);
+}
+
+
+// The kernel is limited to SSE2, which every x64 CPU has, because it is not
+// dispatched on the CPU's features.  These emulate the SSE4.1 instructions
+// _mm_mullo_epi32, _mm_min_epi32, and _mm_blendv_epi8.
+
+/** Low 32 bits of a[i] * b[i], which are the same for signed and unsigned values */
+static inline __m128i mullo4(__m128i a, __m128i b) {
+    const __m128i even = _mm_mul_epu32(a, b);
+    const __m128i odd  = _mm_mul_epu32(_mm_srli_si128(a, 4), _mm_srli_si128(b, 4));
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+}
+
+
+/** mask[i] ? a[i] : b[i], where each lane of \a mask is all ones or all zeros */
+static inline __m128i select4(__m128i mask, __m128i a, __m128i b) {
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+
+static inline __m128i min4(__m128i a, __m128i b) {
+    return select4(_mm_cmplt_epi32(a, b), a, b);
+}
+
+
+/** Vector version of Noise::fade */
+static inline __m128i fade4(const int* fadeArray, __m128i t) {
+    const __m128i hi = _mm_srai_epi32(t, 8);
+    const __m128i t0 = gather4(fadeArray, hi);
+    const __m128i t1 = gather4(fadeArray, min4(_mm_set1_epi32(255), _mm_add_epi32(hi, _mm_set1_epi32(1))));
+    return _mm_add_epi32(t0, _mm_srai_epi32(mullo4(_mm_and_si128(t, _mm_set1_epi32(255)), _mm_sub_epi32(t1, t0)), 8));
+}
+
+
+/** Vector version of Noise::lerp */
+static inline __m128i lerp4(__m128i t, __m128i a, __m128i b) {
+    return _mm_add_epi32(a, _mm_srai_epi32(mullo4(t, _mm_sub_epi32(b, a)), 12));
+}
+
+
+/** Vector version of Noise::grad */
+static inline __m128i grad4(__m128i hash, __m128i x, __m128i y, __m128i z) {
+    const __m128i h = _mm_and_si128(hash, _mm_set1_epi32(15));
+
+    // u = (h < 8) ? x : y
+    const __m128i u = select4(_mm_cmplt_epi32(h, _mm_set1_epi32(8)), x, y);
+
+    // v = (h < 4) ? y : ((h == 12 || h == 14) ? x : z)
+    const __m128i isXForV = _mm_or_si128(_mm_cmpeq_epi32(h, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h, _mm_set1_epi32(14)));
+    const __m128i v = select4(_mm_cmplt_epi32(h, _mm_set1_epi32(4)), y, select4(isXForV, x, z));
+
+    // Negate where bit 0 (for u) or bit 1 (for v) of h is set
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i negU = _mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(1)), _mm_set1_epi32(1));
+    const __m128i negV = _mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(2)), _mm_set1_epi32(2));
+    return _mm_add_epi32(select4(negU, _mm_sub_epi32(zero, u), u), select4(negV, _mm_sub_epi32(zero, v), v));
+}
+
+
+void Noise::sampleFloat4(const int32 xArray[4], const int32 yArray[4], const int32 zArray[4], float result[4], int numOctaves) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(xArray));
+    __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(yArray));
+    __m128i z = _mm_loadu_si128(reinterpret_cast<const __m128i*>(zArray));
+
+    const __m128i mask255 = _mm_set1_epi32(255);
+    const __m128i maskN   = _mm_set1_epi32((1 << 16) - 1);
+    const __m128i N       = _mm_set1_epi32(1 << 16);
+    const __m128i one     = _mm_set1_epi32(1);
+
+    __m128 n = _mm_setzero_ps();
+    float a = 1.0f;
+
+    for (int i = 0; i < numOctaves; ++i) {
+        // Same steps as sample()
+        const __m128i X = _mm_and_si128(_mm_srai_epi32(x, 16), mask255);
+        const __m128i Y = _mm_and_si128(_mm_srai_epi32(y, 16), mask255);
+        const __m128i Z = _mm_and_si128(_mm_srai_epi32(z, 16), mask255);
+        const __m128i fx = _mm_and_si128(x, maskN);
+        const __m128i fy = _mm_and_si128(y, maskN);
+        const __m128i fz = _mm_and_si128(z, maskN);
+
+        const __m128i u  = fade4(fadeArray, fx);
+        const __m128i v  = fade4(fadeArray, fy);
+        const __m128i w  = fade4(fadeArray, fz);
+        const __m128i A  = _mm_add_epi32(gather4(p, X), Y);
+        const __m128i AA = _mm_add_epi32(gather4(p, A), Z);
+        const __m128i AB = _mm_add_epi32(gather4(p, _mm_add_epi32(A, one)), Z);
+        const __m128i B  = _mm_add_epi32(gather4(p, _mm_add_epi32(X, one)), Y);
+        const __m128i BA = _mm_add_epi32(gather4(p, B), Z);
+        const __m128i BB = _mm_add_epi32(gather4(p, _mm_add_epi32(B, one)), Z);
+
+        const __m128i fxN = _mm_sub_epi32(fx, N);
+        const __m128i fyN = _mm_sub_epi32(fy, N);
+        const __m128i fzN = _mm_sub_epi32(fz, N);
+
+        const __m128i sample = 
+            lerp4(w, lerp4(v, lerp4(u, grad4(gather4(p, AA), fx,  fy,  fz),
+                                       grad4(gather4(p, BA), fxN, fy,  fz)),
+                              lerp4(u, grad4(gather4(p, AB), fx,  fyN, fz),
+                                       grad4(gather4(p, BB), fxN, fyN, fz))),
+                     lerp4(v, lerp4(u, grad4(gather4(p, _mm_add_epi32(AA, one)), fx,  fy,  fzN),
+                                       grad4(gather4(p, _mm_add_epi32(BA, one)), fxN, fy,  fzN)),
+                              lerp4(u, grad4(gather4(p, _mm_add_epi32(AB, one)), fx,  fyN, fzN),
+                                       grad4(gather4(p, _mm_add_epi32(BB, one)), fxN, fyN, fzN))));
+
+        // Exact conversion, since |sample| <= 2^17
+        n = _mm_add_ps(n, _mm_mul_ps(_mm_mul_ps(_mm_cvtepi32_ps(sample), _mm_set1_ps(1.0f / (1 << 16))), _mm_set1_ps(a)));
+
+        // Same frequency doubling and rotation as sampleFloat()
+        const __m128i temp = z;
+        x = _mm_slli_epi32(y, 1);
+        y = _mm_slli_epi32(z, 1);
+        z = _mm_slli_epi32(temp, 1);
+
+        a *= 0.5f;
+    }
+
+    _mm_storeu_ps(result, n);
+}
+
 }
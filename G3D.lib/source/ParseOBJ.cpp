@@ -3,19 +3,106 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \created 2011-07-16
- \edited  2015-01-03
+ \edited  2026-10-17
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
 */
+#include <climits>
 #include "G3D/ParseOBJ.h"
 #include "G3D/BinaryInput.h"
 #include "G3D/FileSystem.h"
 #include "G3D/stringutils.h"
 #include "G3D/TextInput.h"
+#include "G3D/ThreadPool.h"
 
 namespace G3D {
 
+/** Faces and commands of one chunk of a file tokenized by ParseOBJ::parseParallel.
+    The vertex attributes are in the ParseOBJ that tokenized the chunk. */
+class ParseOBJ::Chunk {
+public:
+
+    /** A group, material, or material library command, or a run of faces */
+    class Op {
+    public:
+        Command         command;
+
+        /** Index into nameArray, or of the first face in faceArray */
+        int             index;
+
+        /** Number of faces */
+        int             count;
+    };
+
+    /** An index component that was relative to the end of an attribute
+        array, and so must be offset by the size of that array in the
+        preceding chunks */
+    class Fixup {
+    public:
+        int             face;
+        int             index;
+
+        /** 0 = vertex, 1 = texCoord, 2 = normal */
+        int             attribute;
+    };
+
+    Array<Op>           opArray;
+    Array<String>       nameArray;
+    Array<Face>         faceArray;
+    Array<Fixup>        fixupArray;
+
+    /** Number of newlines consumed by this chunk */
+    int                 numLines;
+
+    bool                hasError;
+    ParseError          error;
+
+    Chunk() : numLines(0), hasError(false) {}
+
+    void appendCommand(Command command, const String& name) {
+        Op& op = opArray.next();
+        op.command = command;
+        op.index = nameArray.size();
+        op.count = 0;
+        nameArray.append(name);
+    }
+
+    Face& nextFace() {
+        if ((opArray.size() == 0) || (opArray.last().command != FACE)) {
+            Op& op = opArray.next();
+            op.command = FACE;
+            op.index = faceArray.size();
+            op.count = 0;
+        }
+        ++opArray.last().count;
+        return faceArray.next();
+    }
+
+    /** Records that the last index of the last face is relative */
+    void appendFixup(int attribute) {
+        Fixup& fixup = fixupArray.next();
+        fixup.face = faceArray.size() - 1;
+        fixup.index = faceArray.last().size() - 1;
+        fixup.attribute = attribute;
+    }
+
+    /** Offsets the relative indices by the sizes of the attribute arrays in the preceding chunks */
+    void applyFixups(int vertexBase, int texCoordBase, int normalBase) {
+        for (int f = 0; f < fixupArray.size(); ++f) {
+            const Fixup& fixup = fixupArray[f];
+            Index& index = faceArray[fixup.face][fixup.index];
+            switch (fixup.attribute) {
+            case 0:  index.vertex   += vertexBase;   break;
+            case 1:  index.texCoord += texCoordBase; break;
+            default: index.normal   += normalBase;   break;
+            }
+        }
+        fixupArray.clear();
+    }
+};
+
+
 ParseOBJ::Options::Options(const Any& a) {
     *this = Options();
     a.verifyName("OBJOptions");
@@ -49,7 +136,7 @@ Any ParseOBJ::Options::toAny() const {
     return a;
 }
 
-void ParseOBJ::parse(const char* ptr, size_t len, const String& basePath, const Options& options) {
+void ParseOBJ::parse(const char* ptr, size_t len, const String& basePath, const Options& options, int maxThreads) {
     vertexArray.clear();
     normalArray.clear();
     texCoord0Array.clear();
@@ -63,6 +150,15 @@ void ParseOBJ::parse(const char* ptr, size_t len, const String& basePath, const
 
     m_basePath = basePath;
     m_objOptions = options;
+    m_line = 1;
+
+    // With one effective thread the chunked parser is only overhead, but it is
+    // still the only one that can address more than INT_MAX characters
+    const int numThreads = (maxThreads < 1) ? ThreadPool::numThreads() : min(maxThreads, ThreadPool::numThreads());
+    if ((len >= PARALLEL_MIN_LENGTH) && ((numThreads > 1) || (len > INT_MAX))) {
+        parseParallel(ptr, len, maxThreads);
+        return;
+    }
 
     // Guess the vertex count based on number of characters; intentionally underestimate to avoid overallocation on low RAM machines
     // Assume 50 char/line, 2/3 of lines for v, vt, and vc
@@ -76,9 +172,13 @@ void ParseOBJ::parse(const char* ptr, size_t len, const String& basePath, const
         texCoord1Array.reserve(numVertexEstimate);
     }
 
+    parseCommands(ptr, len);
+}
+
 
+void ParseOBJ::parseCommands(const char* ptr, size_t len) {
     nextCharacter = ptr;
-    alwaysAssertM(len < 0xFFFFFFFF, "Cannot handle more than 4GB of input text.");
+    alwaysAssertM(len <= INT_MAX, "Cannot handle more than 2GB of input text in one chunk.");
     remainingCharacters = (int)len;
     m_line = 1;
 
@@ -89,13 +189,135 @@ void ParseOBJ::parse(const char* ptr, size_t len, const String& basePath, const
         const Command command = readCommand();
         processCommand(command);
 
-        if (m_line % 100000 == 0) {
+        if (isNull(m_chunk) && (m_line % 100000 == 0)) {
             debugPrintf("  ParseOBJ at line %d\n", m_line);
         }
     }        
 }
 
 
+/** True if \a i is the first character of a line that begins with a command or comment */
+static bool isChunkStart(const char* ptr, size_t i) {
+    const char prev = ptr[i - 1];
+    const char c = ptr[i];
+    return ((prev == '\n') || (prev == '\r')) &&
+        (((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) || (c == '#'));
+}
+
+
+void ParseOBJ::parseParallel(const char* ptr, size_t len, int maxThreads) {
+    // Each chunk must fit in the int character count of the tokenizer
+    const size_t MAX_CHUNK_LENGTH = size_t(1) << 30;
+    const int numThreads = (maxThreads < 1) ? ThreadPool::numThreads() : min(maxThreads, ThreadPool::numThreads());
+
+    // Several chunks per thread balance the load, since
+    // faces are more expensive to tokenize than vertices
+    const size_t numChunks = max(len / MAX_CHUNK_LENGTH + 1, min(len / PARALLEL_MIN_LENGTH, size_t(numThreads) * 8));
+
+    // Split at line boundaries
+    Array<size_t> chunkStart;
+    chunkStart.append(0);
+    for (size_t c = 1; c < numChunks; ++c) {
+        size_t i = max(len / numChunks * c, chunkStart.last() + 1);
+        while ((i < len) && ! isChunkStart(ptr, i)) {
+            ++i;
+        }
+        if (i >= len) {
+            break;
+        }
+        chunkStart.append(i);
+    }
+    chunkStart.append(len);
+    const int n = chunkStart.size() - 1;
+
+    // Tokenize the chunks independently.  Vertex attributes go directly into
+    // each chunk's parser; faces and state changes are recorded in the Chunk.
+    Array<shared_ptr<ParseOBJ> > parserArray;
+    parserArray.resize(n);
+    Array<Chunk> chunkArray;
+    chunkArray.resize(n);
+    ThreadPool::parallelFor(0, n, [&](int c, int threadID) {
+        const shared_ptr<ParseOBJ> parser(new ParseOBJ());
+        parser->m_filename   = m_filename;
+        parser->m_basePath   = m_basePath;
+        parser->m_objOptions = m_objOptions;
+        parser->m_chunk      = &chunkArray[c];
+        try {
+            parser->parseCommands(ptr + chunkStart[c], chunkStart[c + 1] - chunkStart[c]);
+        } catch (const ParseError& e) {
+            chunkArray[c].hasError = true;
+            chunkArray[c].error = e;
+        }
+        chunkArray[c].numLines = parser->m_line - 1;
+        parser->m_chunk = NULL;
+        parserArray[c] = parser;
+    }, 1, maxThreads);
+
+    // Concatenate the vertex attributes and resolve relative indices
+    Array<int> vertexBase, texCoord0Base, texCoord1Base, normalBase;
+    vertexBase.append(0); texCoord0Base.append(0); texCoord1Base.append(0); normalBase.append(0);
+    for (int c = 0; c < n; ++c) {
+        vertexBase.append(vertexBase.last() + parserArray[c]->vertexArray.size());
+        texCoord0Base.append(texCoord0Base.last() + parserArray[c]->texCoord0Array.size());
+        texCoord1Base.append(texCoord1Base.last() + parserArray[c]->texCoord1Array.size());
+        normalBase.append(normalBase.last() + parserArray[c]->normalArray.size());
+    }
+    vertexArray.resize(vertexBase.last());
+    texCoord0Array.resize(texCoord0Base.last());
+    texCoord1Array.resize(texCoord1Base.last());
+    normalArray.resize(normalBase.last());
+
+    ThreadPool::parallelFor(0, n, [&](int c, int threadID) {
+        shared_ptr<ParseOBJ>& parser = parserArray[c];
+        System::memcpy(vertexArray.getCArray() + vertexBase[c], parser->vertexArray.getCArray(), sizeof(Point3) * parser->vertexArray.size());
+        System::memcpy(texCoord0Array.getCArray() + texCoord0Base[c], parser->texCoord0Array.getCArray(), sizeof(Point2) * parser->texCoord0Array.size());
+        System::memcpy(texCoord1Array.getCArray() + texCoord1Base[c], parser->texCoord1Array.getCArray(), sizeof(Point2) * parser->texCoord1Array.size());
+        System::memcpy(normalArray.getCArray() + normalBase[c], parser->normalArray.getCArray(), sizeof(Vector3) * parser->normalArray.size());
+        parser.reset();
+
+        chunkArray[c].applyFixups(vertexBase[c], texCoord0Base[c], normalBase[c]);
+    }, 1, maxThreads);
+
+    // Apply the commands in file order
+    int line = 0;
+    for (int c = 0; c < n; ++c) {
+        Chunk& chunk = chunkArray[c];
+        for (int i = 0; i < chunk.opArray.size(); ++i) {
+            const Chunk::Op& op = chunk.opArray[i];
+            switch (op.command) {
+            case GROUP:
+                setGroup(chunk.nameArray[op.index]);
+                break;
+
+            case USEMTL:
+                useMaterial(chunk.nameArray[op.index]);
+                break;
+
+            case MTLLIB:
+                loadMaterialLibrary(chunk.nameArray[op.index]);
+                break;
+
+            default:
+                for (int f = op.index; f < op.index + op.count; ++f) {
+                    nextFace() = chunk.faceArray[f];
+                }
+                break;
+            }
+        }
+
+        if (chunk.hasError) {
+            ParseError e = chunk.error;
+            e.line += line;
+            throw e;
+        }
+
+        line += chunk.numLines;
+        chunk.faceArray.clear();
+    }
+    m_line = line + 1;
+}
+
+
 void ParseOBJ::parse(BinaryInput& bi, const ParseOBJ::Options& options, const String& basePath) {
     m_filename = bi.getFilename();
 
@@ -252,7 +474,7 @@ ParseOBJ::Command ParseOBJ::readCommand() {
 }
 
 
-void ParseOBJ::readFace() {
+ParseOBJ::Face& ParseOBJ::nextFace() {
     // Ensure that we have a material
     if (isNull(m_currentMaterial)) {
         m_currentMaterial = m_currentMaterialLibrary.materialTable["default"];
@@ -281,7 +503,42 @@ void ParseOBJ::readFace() {
         m_currentMesh = m;
     }
 
-    Face& face = m_currentMesh->faceArray.next();
+    return m_currentMesh->faceArray.next();
+}
+
+
+void ParseOBJ::setGroup(const String& groupName) {
+    shared_ptr<Group>& g = groupTable.getCreate(groupName);
+
+    if (isNull(g)) {
+        // Newly created
+        g = Group::create();
+        g->name = groupName;
+    }
+
+    m_currentGroup = g;
+}
+
+
+void ParseOBJ::useMaterial(const String& materialName) {
+    m_currentMaterial = getMaterial(materialName);
+
+    // Force re-obtaining or creating of the appropriate mesh
+    m_currentMesh.reset();
+}
+
+
+void ParseOBJ::loadMaterialLibrary(const String& mtlFilename) {
+    mtlArray.append(mtlFilename);
+
+    TextInput ti2(FilePath::concat(m_basePath, mtlFilename));
+    m_currentMaterialLibrary.parse(ti2);
+}
+
+
+void ParseOBJ::readFace() {
+    // When tokenizing a chunk, the face is attached to a mesh later
+    Face& face = isNull(m_chunk) ? nextFace() : m_chunk->nextFace();
 
     const int vertexArraySize   = vertexArray.size();
     const int texCoordArraySize = texCoord0Array.size();
@@ -301,6 +558,9 @@ void ParseOBJ::readFace() {
             // Negative; make relative to the current end of the array.
             // -1 will be the last element, so just add the size of the array.
             index.vertex += vertexArraySize;
+            if (notNull(m_chunk)) {
+                m_chunk->appendFixup(0);
+            }
         }
 
         if ((remainingCharacters > 0) && (*nextCharacter == '/')) {
@@ -319,6 +579,9 @@ void ParseOBJ::readFace() {
                         // of the array.  -1 will be the last element,
                         // so just add the size of the array.
                         index.texCoord += texCoordArraySize;
+                        if (notNull(m_chunk)) {
+                            m_chunk->appendFixup(1);
+                        }
                     }
                 }
 
@@ -337,6 +600,9 @@ void ParseOBJ::readFace() {
                         // element, so just add the size of the
                         // array.
                         index.normal += normalArraySize;
+                        if (notNull(m_chunk)) {
+                            m_chunk->appendFixup(2);
+                        }
                     }       
                 }
             }
@@ -390,16 +656,11 @@ void ParseOBJ::processCommand(const Command command) {
         {
             // Change group
             const String& groupName = readName();
-
-            shared_ptr<Group>& g = groupTable.getCreate(groupName);
-
-            if (isNull(g)) {
-                // Newly created
-                g = Group::create();
-                g->name = groupName;
+            if (isNull(m_chunk)) {
+                setGroup(groupName);
+            } else {
+                m_chunk->appendCommand(GROUP, groupName);
             }
-
-            m_currentGroup = g;
         }
         // Consume anything else on this line
         readUntilNewline();
@@ -409,10 +670,11 @@ void ParseOBJ::processCommand(const Command command) {
         {
             // Change the mesh within the group
             const String& materialName = readName();
-            m_currentMaterial = getMaterial(materialName);
-
-            // Force re-obtaining or creating of the appropriate mesh
-            m_currentMesh.reset();
+            if (isNull(m_chunk)) {
+                useMaterial(materialName);
+            } else {
+                m_chunk->appendCommand(USEMTL, materialName);
+            }
         }
         // Consume anything else on this line
         readUntilNewline();
@@ -421,12 +683,12 @@ void ParseOBJ::processCommand(const Command command) {
     case MTLLIB:
         {
             // Specify material library 
-            String mtlFilename = readName();
-            mtlArray.append(mtlFilename);
-            mtlFilename = FilePath::concat(m_basePath, mtlFilename);
-
-            TextInput ti2(mtlFilename);
-            m_currentMaterialLibrary.parse(ti2);
+            const String& mtlFilename = readName();
+            if (isNull(m_chunk)) {
+                loadMaterialLibrary(mtlFilename);
+            } else {
+                m_chunk->appendCommand(MTLLIB, mtlFilename);
+            }
         }
         // Consume anything else on this line
         readUntilNewline();
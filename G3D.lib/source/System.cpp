@@ -11,7 +11,7 @@
   determine if we can safely call the routines that use that assembly.
 
   \created 2003-01-25
-  \edited  2012-01-05
+  \edited  2026-10-17
  */
 
 #include "G3D/platform.h"
@@ -33,6 +33,7 @@
 
 #include <cstring>
 #include <cstdio>
+#include <atomic>
 
 // Uncomment the following line to turn off G3D::System memory
 // allocation and use the operating system's malloc.
@@ -118,6 +119,8 @@ System::System() :
     m_hasSSE(false),
     m_hasSSE2(false),
     m_hasSSE3(false),
+    m_hasSSSE3(false),
+    m_hasSSE4_1(false),
     m_has3DNOW(false),
     m_has3DNOW2(false),
     m_hasAMDMMX(false),
@@ -584,6 +587,8 @@ void System::getStandardProcessorExtensions() {
     // Bit 28 is HTT; not checked by G3D
 
     m_hasSSE3     = checkBit(ecxreg, 0);
+    m_hasSSSE3    = checkBit(ecxreg, 9);
+    m_hasSSE4_1   = checkBit(ecxreg, 19);
 
     if (m_highestCPUIDFunction >= CPUID_EXTENDED_FEATURES) {
         cpuid(CPUID_EXTENDED_FEATURES, eaxreg, ebxreg, ecxreg, features);
@@ -975,16 +980,32 @@ RealTime System::time() {
 #define REALSIZE_FROM_USERPTR(u) (*(size_t*)USERPTR_TO_REALPTR(ptr) + ALIGNMENT_SIZE)
 #define USERSIZE_FROM_USERPTR(u) (*(size_t*)USERPTR_TO_REALPTR(ptr))
 
+/**
+ Allocations up to medBufferSize are rounded up to one of about 30
+ size classes and served from 64 kB slabs carved out of a single
+ preallocated region.  Each slab holds blocks of one size class.
+
+ Every thread keeps a free list per size class and exchanges blocks
+ with a central free list for that class in batches, so most calls to
+ malloc and free touch only the calling thread's cache and take no lock.
+ A block freed by a thread other than the one that allocated it goes
+ into the freeing thread's cache and returns to the central list when
+ that cache overflows, so producer/consumer patterns recycle memory
+ without tracking the owner of each block.  When a thread exits, its
+ cached blocks return to the central lists and its cache is handed to
+ the next new thread.
+
+ Slabs are never returned to the operating system or reassigned to
+ another size class.  When the region is exhausted, and for requests
+ larger than medBufferSize, blocks come from ::malloc with a size
+ header in front of them.
+ */
 class BufferPool {
 public:
 
-    /** Only store buffers up to these sizes (in bytes) in each pool->
-        Different pools have different management strategies.
-
-        A large block is preallocated for tiny buffers; they are used with
-        tremendous frequency.  Other buffers are allocated as demanded.
-        Tiny buffers are 128 bytes long because that seems to align well with
-        cache sizes on many machines.
+    /** Allocations up to tinyBufferSize, smallBufferSize, and medBufferSize
+        are reported separately by the performance counters.  Allocations up
+        to medBufferSize come from the slabs.
       */
 #ifdef G3D_64BIT
     // 64-bit machines have larger pointers...and probably have more memory as well
@@ -994,337 +1015,323 @@ public:
 #endif
 
     /** 
-       Most buffers we're allowed to store.
-       250000 * { 128 |  256} = {32 | 64} MB (preallocated)
-        40000 * {1024 | 2048} = {40 | 80} MB (allocated on demand)
-         5000 * {4096 | 8192} = {20 | 40} MB (allocated on demand)
+       The slab region is preallocated, although the operating system
+       only commits its pages as slabs are carved from it.
+       {512 | 2048} * 64 kB = {32 | 128} MB
      */
-    enum {maxTinyBuffers = 250000, maxSmallBuffers = 40000, maxMedBuffers = 5000};
+#ifdef G3D_64BIT
+    enum {slabSize = 64 * 1024, maxSlabs = 2048};
+#else
+    enum {slabSize = 64 * 1024, maxSlabs = 512};
+#endif
+
+    enum {MAX_SIZE_CLASSES = 32};
 
 private:
 
-    /** Pointer given to the program.  Unless in the tiny heap, the user size of the block is stored right in front of the pointer as a uint32.*/
+    /** Pointer given to the program.  Unless in the slab region, the user size of the block is stored right in front of the pointer.*/
     typedef void* UserPtr;
 
     /** Actual block allocated on the heap */
     typedef void* RealPtr;
 
-    class MemBlock {
+    /** A block that is on a free list stores the next block in its first word */
+    class FreeBlock {
     public:
-        UserPtr     ptr;
-        size_t      bytes;
-
-        inline MemBlock() : ptr(NULL), bytes(0) {}
-        inline MemBlock(UserPtr p, size_t b) : ptr(p), bytes(b) {}
+        FreeBlock*  next;
     };
 
-    MemBlock smallPool[maxSmallBuffers];
-    int smallPoolSize;
+    /** Singly-linked list of free blocks of one size class */
+    class FreeList {
+    public:
+        FreeBlock*  head;
+        int         size;
 
-    MemBlock medPool[maxMedBuffers];
-    int medPoolSize;
+        FreeList() : head(NULL), size(0) {}
 
-    /** The tiny pool is a single block of storage into which all tiny
-        objects are allocated.  This provides better locality for
-        small objects and avoids the search time, since all tiny
-        blocks are exactly the same size. */
-    void* tinyPool[maxTinyBuffers];
-    int tinyPoolSize;
+        inline void push(FreeBlock* block) {
+            block->next = head;
+            head = block;
+            ++size;
+        }
 
-    /** Pointer to the data in the tiny pool */
-    void* tinyHeap;
+        inline FreeBlock* pop() {
+            debugAssert(head != NULL);
+            FreeBlock* block = head;
+            head = block->next;
+            --size;
+            return block;
+        }
 
-    Spinlock            m_lock;
+        /** Removes the first \a n blocks and returns them as a chain from \a first to \a last */
+        void popChain(int n, FreeBlock*& first, FreeBlock*& last) {
+            debugAssert((n > 0) && (n <= size));
+            first = last = head;
+            for (int i = 1; i < n; ++i) {
+                last = last->next;
+            }
+            head = last->next;
+            last->next = NULL;
+            size -= n;
+        }
 
-    inline void __fastcall lock() {
-        m_lock.lock();
-    }
+        void pushChain(int n, FreeBlock* first, FreeBlock* last) {
+            last->next = head;
+            head = first;
+            size += n;
+        }
+    };
 
-    inline void __fastcall unlock() {
-        m_lock.unlock();
-    }
+    /** Central state for one size class */
+    class SizeClass {
+    public:
+        /** Size of each block */
+        size_t      bytes;
 
-    /** 
-     Malloc out of the tiny heap. Returns NULL if allocation failed.
-     */
-    inline UserPtr __fastcall tinyMalloc(size_t bytes) {
-        // Note that we ignore the actual byte size
-        // and create a constant size block.
-        (void)bytes;
-        assert(tinyBufferSize >= bytes);
+        /** Number of blocks moved between a thread cache and the central list at once */
+        int         batchSize;
 
-        UserPtr ptr = NULL;
+        /** Protects everything below */
+        Spinlock    lock;
 
-        if (tinyPoolSize > 0) {
-            --tinyPoolSize;
+        FreeList    freeList;
 
-            // Return the old last pointer from the freelist
-            ptr = tinyPool[tinyPoolSize];
+        int         numSlabs;
 
-#           ifdef G3D_DEBUG
-                if (tinyPoolSize > 0) {
-                    assert(tinyPool[tinyPoolSize - 1] != ptr); 
-                     //   "System::malloc heap corruption detected: "
-                     //   "the last two pointers on the freelist are identical (during tinyMalloc).");
-                }
-#           endif
+        SizeClass() : bytes(0), batchSize(0), numSlabs(0) {}
+    };
 
-            // NULL out the entry to help detect corruption
-            tinyPool[tinyPoolSize] = NULL;
-        }
+    /** Free lists and performance counters for one thread. */
+    class ThreadCache {
+    public:
+        FreeList                freeList[MAX_SIZE_CLASSES];
 
-        return ptr;
-    }
+        /** Written only by the owning thread and read by status(), so they
+            are atomic but incremented without a read-modify-write */
+        std::atomic<uint64>     numMallocs[MAX_SIZE_CLASSES];
+        std::atomic<uint64>     numHeapMallocs;
 
-    /** Returns true if this is a pointer into the tiny heap. */
-    bool __fastcall inTinyHeap(UserPtr ptr) {
-        return 
-            (ptr >= tinyHeap) && 
-            (ptr < (uint8*)tinyHeap + maxTinyBuffers * tinyBufferSize);
-    }
+        /** False once the owning thread has exited, when another thread may adopt this */
+        bool                    inUse;
 
-    void __fastcall tinyFree(UserPtr ptr) {
-        assert(ptr);
-        assert(tinyPoolSize < maxTinyBuffers);
- //           "Tried to free a tiny pool buffer when the tiny pool freelist is full.");
+        ThreadCache*            next;
 
-#       ifdef G3D_DEBUG
-            if (tinyPoolSize > 0) {
-                UserPtr prevOnHeap = tinyPool[tinyPoolSize - 1];
-                assert(prevOnHeap != ptr); 
-//                    "System::malloc heap corruption detected: "
-//                    "the last two pointers on the freelist are identical (during tinyFree).");
+        ThreadCache(ThreadCache* next) : numHeapMallocs(0), inUse(true), next(next) {
+            for (int c = 0; c < MAX_SIZE_CLASSES; ++c) {
+                numMallocs[c] = 0;
             }
-#       endif
-
-        assert(tinyPool[tinyPoolSize] == NULL);
-
-        // Put the pointer back into the free list
-        tinyPool[tinyPoolSize] = ptr;
-        ++tinyPoolSize;
-
-    }
-
-    void flushPool(MemBlock* pool, int& poolSize) {
-        for (int i = 0; i < poolSize; ++i) {
-            bytesAllocated -= USERSIZE_TO_REALSIZE(pool[i].bytes);
-            ::free(USERPTR_TO_REALPTR(pool[i].ptr));
-            pool[i].ptr = NULL;
-            pool[i].bytes = 0;
         }
-        poolSize = 0;
-    }
-
-
-    /** Allocate out of a specific pool.  Return NULL if no suitable 
-        memory was found. */
-    UserPtr poolMalloc(MemBlock* pool, int& poolSize, const int maxPoolSize, size_t bytes) {
-
-        // OPT: find the smallest block that satisfies the request.
-
-        // See if there's something we can use in the buffer pool.
-        // Search backwards since usually we'll re-use the last one.
-        for (int i = (int)poolSize - 1; i >= 0; --i) {
-            if (pool[i].bytes >= bytes) {
-                // We found a suitable entry in the pool.
+    };
 
-                // No need to offset the pointer; it is already offset
-                UserPtr ptr = pool[i].ptr;
+    /** Returns the current thread's cache to the pool when the thread exits */
+    class ThreadCacheRetirer {
+    public:
+        BufferPool*     pool;
+        ThreadCache*    cache;
 
-                // Remove this element from the pool, replacing it with
-                // the one from the end (same as Array::fastRemove)
-                --poolSize;
-                pool[i] = pool[poolSize];
+        ThreadCacheRetirer() : pool(NULL), cache(NULL) {}
 
-                return ptr;
+        ~ThreadCacheRetirer() {
+            if (cache != NULL) {
+                pool->retireThreadCache(cache);
             }
         }
+    };
 
-        if (poolSize == maxPoolSize) {
-            // Free even-indexed pools, and compact array in the same loop
-            for (int i = 0; i < poolSize; i += 2) {
-                bytesAllocated -= USERSIZE_TO_REALSIZE(pool[i].bytes);
-                ::free(USERPTR_TO_REALPTR(pool[i].ptr));
-                pool[i].ptr = NULL;
-                pool[i].bytes = 0;
-                // Compact: (i/2) is the next open slot
-                pool[i/2].ptr   = pool[i+1].ptr;
-                pool[i/2].bytes = pool[i+1].bytes;
-                pool[i+1].ptr = NULL;
-                pool[i+1].bytes = 0;
-            }
-            poolSize = poolSize/2;
-            if (maxPoolSize == maxMedBuffers) {
-                ++medPoolPurgeCount;
-            } else if (maxPoolSize == maxSmallBuffers) {
-                ++smallPoolPurgeCount;
-            }
+    /** The cache of the current thread, or NULL if it has not allocated yet
+        or has retired its cache */
+    static __thread ThreadCache* s_threadCache;
 
-        }
+    /** True once the current thread's exit hook has run.  Later allocations
+        by that thread, such as from other thread-exit destructors, bypass
+        the thread caches. */
+    static __thread bool s_threadCacheRetired;
 
-        return NULL;
-    }
-
-public:
+    int                 m_numSizeClasses;
 
-    /** Count of memory allocations that have occurred. */
-    int totalMallocs;
-    int mallocsFromTinyPool;
-    int mallocsFromSmallPool;
-    int mallocsFromMedPool;
+    SizeClass           m_sizeClass[MAX_SIZE_CLASSES];
 
-    int smallPoolPurgeCount;
-    int medPoolPurgeCount;
+    /** Size class for a request of n bytes at index (n + 15) / 16 */
+    uint8               m_sizeClassOfRequest[medBufferSize / 16 + 1];
 
-    /** Amount of memory currently allocated (according to the application). 
-        This does not count the memory still remaining in the buffer pool,
-        but does count extra memory required for rounding off to the size
-        of a buffer.
-        Primarily useful for detecting leaks.*/
-    // TODO: make me an atomic int!
-    volatile size_t bytesAllocated;
+    /** Size class of every slab that has been carved */
+    uint8               m_sizeClassOfSlab[maxSlabs];
 
-    BufferPool() {
-        totalMallocs         = 0;
+    /** 16-byte aligned start of the slab region within m_regionAllocation */
+    uint8*              m_region;
 
-        mallocsFromTinyPool  = 0;
-        mallocsFromSmallPool = 0;
-        mallocsFromMedPool   = 0;
+    void*               m_regionAllocation;
 
-        bytesAllocated       = 0;
+    std::atomic<int>    m_numSlabsUsed;
 
-        tinyPoolSize         = 0;
-        tinyHeap             = NULL;
+    /** Protects the list of thread caches and the counter baselines */
+    Spinlock            m_threadCacheLock;
 
-        smallPoolSize        = 0;
+    /** Every cache ever created.  The caches of exited threads are empty
+        and are adopted by new threads. */
+    ThreadCache*        m_threadCacheList;
 
-        medPoolSize          = 0;
+    int                 m_numThreadCaches;
 
-        smallPoolPurgeCount = 0;
-        medPoolPurgeCount   = 0;
+    /** Counter totals at the last resetPerformanceCounters() */
+    uint64              m_baseMallocs[MAX_SIZE_CLASSES];
+    uint64              m_baseHeapMallocs;
 
+    static inline void increment(std::atomic<uint64>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
 
-        // Initialize the tiny heap as a bunch of pointers into one
-        // pre-allocated buffer.
-        tinyHeap = ::malloc(maxTinyBuffers * tinyBufferSize);
-        for (int i = 0; i < maxTinyBuffers; ++i) {
-            tinyPool[i] = (uint8*)tinyHeap + (tinyBufferSize * i);
+    /** Returns NULL if the current thread is exiting */
+    inline ThreadCache* threadCache() {
+        ThreadCache* cache = s_threadCache;
+        if (cache == NULL) {
+            cache = createThreadCache();
         }
-        tinyPoolSize = maxTinyBuffers;
-
-#if 0        ///---------------------------------- old mutex
-#       ifdef G3D_WINDOWS
-            InitializeCriticalSection(&mutex);
-#       else
-            pthread_mutex_init(&mutex, NULL);
-#       endif
-#endif        ///---------------------------------- old mutex
+        return cache;
     }
 
+    ThreadCache* createThreadCache() {
+        if (s_threadCacheRetired) {
+            return NULL;
+        }
 
-    ~BufferPool() {
-        ::free(tinyHeap);
-        flushPool(smallPool, smallPoolSize);
-        flushPool(medPool, medPoolSize);
-#if 0 //-------------------------------- old mutex
-#       ifdef G3D_WINDOWS
-            DeleteCriticalSection(&mutex);
-#       else
-            // No destruction on pthreads
-#       endif
-#endif //--------------------------------old mutex
-    }
-
-    
-    UserPtr realloc(UserPtr ptr, size_t bytes) {
-        if (ptr == NULL) {
-            return malloc(bytes);
+        m_threadCacheLock.lock();
+        ThreadCache* cache = m_threadCacheList;
+        while ((cache != NULL) && cache->inUse) {
+            cache = cache->next;
+        }
+        if (cache == NULL) {
+            // ::operator new does not use System::malloc, so this cannot recurse
+            cache = new ThreadCache(m_threadCacheList);
+            m_threadCacheList = cache;
+            ++m_numThreadCaches;
+        } else {
+            cache->inUse = true;
         }
+        m_threadCacheLock.unlock();
 
-        if (inTinyHeap(ptr)) {
-            if (bytes <= tinyBufferSize) {
-                // The old pointer actually had enough space.
-                return ptr;
-            } else {
-                // Free the old pointer and malloc
-                
-                UserPtr newPtr = malloc(bytes);
-                System::memcpy(newPtr, ptr, tinyBufferSize);
-                tinyFree(ptr);
-                return newPtr;
+        // thread_local rather than __thread because it has a destructor
+        static thread_local ThreadCacheRetirer retirer;
+        retirer.pool = this;
+        retirer.cache = cache;
 
-            }
-        } else {
-            // In one of our heaps.
+        s_threadCache = cache;
+        return cache;
+    }
 
-            // See how big the block really was
-            size_t userSize = USERSIZE_FROM_USERPTR(ptr);
-            if (bytes <= userSize) {
-                // The old block was big enough.
-                return ptr;
+    /** Moves all blocks in \a cache to the central lists and makes it
+        available to other threads.  Invoked when the owning thread exits. */
+    void retireThreadCache(ThreadCache* cache) {
+        s_threadCache = NULL;
+        s_threadCacheRetired = true;
+
+        for (int c = 0; c < m_numSizeClasses; ++c) {
+            FreeList& list = cache->freeList[c];
+            if (list.size > 0) {
+                const int n = list.size;
+                FreeBlock* first;
+                FreeBlock* last;
+                list.popChain(n, first, last);
+
+                SizeClass& sizeClass = m_sizeClass[c];
+                sizeClass.lock.lock();
+                sizeClass.freeList.pushChain(n, first, last);
+                sizeClass.lock.unlock();
             }
-
-            // Need to reallocate and move
-            UserPtr newPtr = malloc(bytes);
-            System::memcpy(newPtr, ptr, userSize);
-            free(ptr);
-            return newPtr;
         }
-    }
 
+        // The counters stay in the cache so that the totals are unchanged
+        m_threadCacheLock.lock();
+        cache->inUse = false;
+        m_threadCacheLock.unlock();
+    }
 
-    UserPtr __fastcall malloc(size_t bytes) {
-        lock();
-        ++totalMallocs;
+    /** Returns true if this is a pointer into the slab region. */
+    inline bool __fastcall inSlabRegion(UserPtr ptr) const {
+        return
+            (ptr >= m_region) &&
+            (ptr < m_region + size_t(maxSlabs) * slabSize);
+    }
 
-        if (bytes <= tinyBufferSize) {
+    /** Assigns a new slab to size class \a c and adds its blocks to the
+        central list.  Returns false if the region is exhausted.  Requires
+        the lock of the size class. */
+    bool carveSlab(int c) {
+        int s = m_numSlabsUsed.load();
+        do {
+            if (s >= maxSlabs) {
+                return false;
+            }
+        } while (! m_numSlabsUsed.compare_exchange_weak(s, s + 1));
 
-            UserPtr ptr = tinyMalloc(bytes);
+        SizeClass& sizeClass = m_sizeClass[c];
+        m_sizeClassOfSlab[s] = uint8(c);
+        ++sizeClass.numSlabs;
 
-            if (ptr) {
-                debugAssertM((intptr_t)ptr % 16 == 0, "BufferPool::tinyMalloc returned non-16 byte aligned memory");
-                ++mallocsFromTinyPool;
-                unlock();
-                return ptr;
-            }
+        // Push in reverse so that blocks are allocated in address order
+        uint8* slab = m_region + size_t(s) * slabSize;
+        const int n = int(slabSize / sizeClass.bytes);
+        for (int i = n - 1; i >= 0; --i) {
+            sizeClass.freeList.push(reinterpret_cast<FreeBlock*>(slab + sizeClass.bytes * i));
+        }
+        return true;
+    }
 
-        } 
-        
-        // Failure to allocate a tiny buffer is allowed to flow
-        // through to a small buffer
-        if (bytes <= smallBufferSize) {
-            
-            UserPtr ptr = poolMalloc(smallPool, smallPoolSize, maxSmallBuffers, bytes);
+    /** Moves up to one batch from the central list of size class \a c to \a list.
+        Returns false if no memory was available. */
+    bool refill(int c, FreeList& list) {
+        SizeClass& sizeClass = m_sizeClass[c];
+        sizeClass.lock.lock();
+        if ((sizeClass.freeList.size == 0) && ! carveSlab(c)) {
+            sizeClass.lock.unlock();
+            return false;
+        }
 
-            if (ptr) {
-                debugAssertM((intptr_t)ptr % 16 == 0, "BufferPool::poolMalloc(small) returned non-16 byte aligned memory");
-                ++mallocsFromSmallPool;
-                unlock();
-                return ptr;
-            }
+        FreeBlock* first;
+        FreeBlock* last;
+        const int n = min(sizeClass.batchSize, sizeClass.freeList.size);
+        sizeClass.freeList.popChain(n, first, last);
+        sizeClass.lock.unlock();
 
-        } else if (bytes <= medBufferSize) {
-            // Note that a small allocation failure does *not* fall
-            // through into a medium allocation because that would
-            // waste the medium buffer's resources.
+        list.pushChain(n, first, last);
+        return true;
+    }
 
-            UserPtr ptr = poolMalloc(medPool, medPoolSize, maxMedBuffers, bytes);
+    /** Moves one batch from \a list to the central list of size class \a c */
+    void release(int c, FreeList& list) {
+        SizeClass& sizeClass = m_sizeClass[c];
+        FreeBlock* first;
+        FreeBlock* last;
+        const int n = sizeClass.batchSize;
+        list.popChain(n, first, last);
+
+        sizeClass.lock.lock();
+        sizeClass.freeList.pushChain(n, first, last);
+        sizeClass.lock.unlock();
+    }
 
-            if (ptr) {
-                debugAssertM((intptr_t)ptr % 16 == 0, "BufferPool::poolMalloc(med) returned non-16 byte aligned memory");
-                ++mallocsFromMedPool;
-                unlock();
-                debugAssertM(ptr != NULL, "BufferPool::malloc returned NULL");
-                return ptr;
-            }
+    /** Allocates directly from the central list of size class \a c, for
+        threads without a cache.  Returns NULL if the slab region is exhausted. */
+    UserPtr centralMalloc(int c) {
+        SizeClass& sizeClass = m_sizeClass[c];
+        sizeClass.lock.lock();
+        UserPtr ptr = NULL;
+        if ((sizeClass.freeList.size > 0) || carveSlab(c)) {
+            ptr = sizeClass.freeList.pop();
         }
+        sizeClass.lock.unlock();
+        return ptr;
+    }
 
+    /** Allocates from ::malloc with a size header */
+    UserPtr heapMalloc(size_t bytes) {
+        ThreadCache* cache = threadCache();
+        if (cache != NULL) {
+            increment(cache->numHeapMallocs);
+        }
         bytesAllocated += USERSIZE_TO_REALSIZE(bytes);
-        unlock();
-
-        // Heap allocate
 
-        // Allocate 4 extra bytes for our size header (unfortunate,
+        // Allocate extra bytes for our size header (unfortunate,
         // since malloc already added its own header).
         RealPtr ptr = ::malloc(USERSIZE_TO_REALSIZE(bytes));
         if (ptr == NULL) {
@@ -1333,22 +1340,15 @@ public:
                 alwaysAssertM(_CrtCheckMemory() == TRUE, "Heap corruption detected.");
 #           endif
 
-            // Flush memory pools to try and recover space
-            flushPool(smallPool, smallPoolSize);
-            flushPool(medPool, medPoolSize);
-            ptr = ::malloc(USERSIZE_TO_REALSIZE(bytes));
-        }
-
-        if (ptr == NULL) {
             if ((System::outOfMemoryCallback() != NULL) &&
                 (System::outOfMemoryCallback()(USERSIZE_TO_REALSIZE(bytes), true) == true)) {
                 // Re-attempt the malloc
                 ptr = ::malloc(USERSIZE_TO_REALSIZE(bytes));
-                
             }
         }
 
         if (ptr == NULL) {
+            bytesAllocated -= USERSIZE_TO_REALSIZE(bytes);
             if (System::outOfMemoryCallback() != NULL) {
                 // Notify the application
                 System::outOfMemoryCallback()(USERSIZE_TO_REALSIZE(bytes), false);
@@ -1368,89 +1368,251 @@ public:
         return REALPTR_TO_USERPTR(ptr);
     }
 
+    /** Sums the counters of all thread caches, less the baselines */
+    void getPerformanceCounters(uint64 numMallocs[MAX_SIZE_CLASSES], uint64& numHeapMallocs) {
+        m_threadCacheLock.lock();
+        for (int c = 0; c < m_numSizeClasses; ++c) {
+            numMallocs[c] = 0;
+        }
+        numHeapMallocs = 0;
+        for (ThreadCache* cache = m_threadCacheList; cache != NULL; cache = cache->next) {
+            for (int c = 0; c < m_numSizeClasses; ++c) {
+                numMallocs[c] += cache->numMallocs[c].load(std::memory_order_relaxed);
+            }
+            numHeapMallocs += cache->numHeapMallocs.load(std::memory_order_relaxed);
+        }
+        for (int c = 0; c < m_numSizeClasses; ++c) {
+            numMallocs[c] -= m_baseMallocs[c];
+        }
+        numHeapMallocs -= m_baseHeapMallocs;
+        m_threadCacheLock.unlock();
+    }
 
-    void free(UserPtr ptr) {
+public:
+
+    /** Amount of memory currently allocated from ::malloc (according to the application),
+        not counting the slabs.  Primarily useful for detecting leaks.*/
+    std::atomic<size_t> bytesAllocated;
+
+    BufferPool() : m_numSlabsUsed(0), m_threadCacheList(NULL), m_numThreadCaches(0), m_baseHeapMallocs(0), bytesAllocated(0) {
+        // Size classes are multiples of 16 bytes, spaced so that rounding
+        // up wastes at most 25% of a block beyond 128 bytes
+        m_numSizeClasses = 0;
+        for (size_t bytes = 16; bytes <= medBufferSize; ) {
+            debugAssert(m_numSizeClasses < MAX_SIZE_CLASSES);
+            SizeClass& sizeClass = m_sizeClass[m_numSizeClasses];
+            sizeClass.bytes = bytes;
+            // Move about 16 kB per batch
+            sizeClass.batchSize = iClamp(int(16 * 1024 / bytes), 4, 128);
+            m_baseMallocs[m_numSizeClasses] = 0;
+            ++m_numSizeClasses;
+
+            // Four classes per power of two
+            size_t step = 16;
+            while (step * 8 <= bytes) {
+                step *= 2;
+            }
+            bytes += step;
+        }
+
+        int c = 0;
+        for (int i = 0; i <= medBufferSize / 16; ++i) {
+            while (m_sizeClass[c].bytes < size_t(i) * 16) {
+                ++c;
+            }
+            m_sizeClassOfRequest[i] = uint8(c);
+        }
+
+        m_regionAllocation = ::malloc(size_t(maxSlabs) * slabSize + ALIGNMENT_SIZE);
+        alwaysAssertM(m_regionAllocation != NULL, "Could not allocate the System::malloc slab region");
+        m_region = (uint8*)(((uintptr_t)m_regionAllocation + ALIGNMENT_SIZE - 1) & ~uintptr_t(ALIGNMENT_SIZE - 1));
+    }
+
+
+    ~BufferPool() {
+        ::free(m_regionAllocation);
+        while (m_threadCacheList != NULL) {
+            ThreadCache* next = m_threadCacheList->next;
+            delete m_threadCacheList;
+            m_threadCacheList = next;
+        }
+    }
+
+    
+    UserPtr realloc(UserPtr ptr, size_t bytes) {
         if (ptr == NULL) {
-            // Free does nothing on null pointers
-            return;
+            return malloc(bytes);
         }
 
-        assert(isValidPointer(ptr));
+        // See how big the block really was
+        const size_t userSize = inSlabRegion(ptr) ?
+            m_sizeClass[m_sizeClassOfSlab[((uint8*)ptr - m_region) / slabSize]].bytes :
+            USERSIZE_FROM_USERPTR(ptr);
+
+        if (bytes <= userSize) {
+            // The old block was big enough.
+            return ptr;
+        }
 
-        if (inTinyHeap(ptr)) {
-            lock();
-            tinyFree(ptr);
-            unlock();
+        // Need to reallocate and move
+        UserPtr newPtr = malloc(bytes);
+        if (newPtr != NULL) {
+            System::memcpy(newPtr, ptr, userSize);
+            free(ptr);
+        }
+        return newPtr;
+    }
+
+
+    UserPtr __fastcall malloc(size_t bytes) {
+        if (bytes <= medBufferSize) {
+            const int c = m_sizeClassOfRequest[(bytes + 15) / 16];
+            ThreadCache* cache = threadCache();
+            if (cache == NULL) {
+                // The thread is exiting; these are not counted
+                UserPtr ptr = centralMalloc(c);
+                if (ptr != NULL) {
+                    return ptr;
+                }
+            } else {
+                FreeList& list = cache->freeList[c];
+                if ((list.head != NULL) || refill(c, list)) {
+                    increment(cache->numMallocs[c]);
+                    UserPtr ptr = list.pop();
+                    debugAssertM((intptr_t)ptr % 16 == 0, "BufferPool::malloc returned non-16 byte aligned memory");
+                    return ptr;
+                }
+            }
+
+            // The slab region is exhausted; fall through to the heap
+        }
+
+        return heapMalloc(bytes);
+    }
+
+
+    void free(UserPtr ptr) {
+        if (ptr == NULL) {
+            // Free does nothing on null pointers
             return;
         }
 
-        size_t bytes = USERSIZE_FROM_USERPTR(ptr);
+        assert(isValidPointer(ptr));
 
-        lock();
-        if (bytes <= smallBufferSize) {
-            if (smallPoolSize < maxSmallBuffers) {
-                smallPool[smallPoolSize] = MemBlock(ptr, bytes);
-                ++smallPoolSize;
-                unlock();
+        if (inSlabRegion(ptr)) {
+            const size_t offset = (uint8*)ptr - m_region;
+            const int c = m_sizeClassOfSlab[offset / slabSize];
+            debugAssertM((offset % slabSize) % m_sizeClass[c].bytes == 0,
+                         "System::free called on a pointer that System::malloc did not return");
+
+            ThreadCache* cache = threadCache();
+            if (cache == NULL) {
+                // The thread is exiting
+                SizeClass& sizeClass = m_sizeClass[c];
+                sizeClass.lock.lock();
+                sizeClass.freeList.push((FreeBlock*)ptr);
+                sizeClass.lock.unlock();
                 return;
             }
-        } else if (bytes <= medBufferSize) {
-            if (medPoolSize < maxMedBuffers) {
-                medPool[medPoolSize] = MemBlock(ptr, bytes);
-                ++medPoolSize;
-                unlock();
-                return;
+
+            FreeList& list = cache->freeList[c];
+            debugAssertM(list.head != ptr, 
+                         "System::malloc heap corruption detected: "
+                         "the same pointer was freed twice in a row.");
+            list.push((FreeBlock*)ptr);
+
+            if (list.size > 2 * m_sizeClass[c].batchSize) {
+                release(c, list);
             }
+            return;
         }
+
+        const size_t bytes = USERSIZE_FROM_USERPTR(ptr);
         bytesAllocated -= USERSIZE_TO_REALSIZE(bytes);
-        unlock();
 
-        // Free; the buffer pools are full or this is too big to store.
+        // Too big for a slab
         ::free(USERPTR_TO_REALPTR(ptr));
     }
 
-    String mallocRatioString() const {
-        if (totalMallocs > 0) {
-            int pooled = mallocsFromTinyPool +
-                         mallocsFromSmallPool + 
-                         mallocsFromMedPool;
 
-            int total = totalMallocs;
+    void resetPerformanceCounters() {
+        m_threadCacheLock.lock();
+        for (int c = 0; c < m_numSizeClasses; ++c) {
+            m_baseMallocs[c] = 0;
+        }
+        m_baseHeapMallocs = 0;
+        for (ThreadCache* cache = m_threadCacheList; cache != NULL; cache = cache->next) {
+            for (int c = 0; c < m_numSizeClasses; ++c) {
+                m_baseMallocs[c] += cache->numMallocs[c].load(std::memory_order_relaxed);
+            }
+            m_baseHeapMallocs += cache->numHeapMallocs.load(std::memory_order_relaxed);
+        }
+        m_threadCacheLock.unlock();
+    }
+
+
+    String status() {
+        uint64 numMallocs[MAX_SIZE_CLASSES];
+        uint64 numHeapMallocs;
+        getPerformanceCounters(numMallocs, numHeapMallocs);
 
-            return format("Percent of Mallocs: %5.1f%% <= %db, %5.1f%% <= %db, "
-                          "%5.1f%% <= %db, %5.1f%% > %db",
+        uint64 mallocsFromTinyPool = 0, mallocsFromSmallPool = 0, mallocsFromMedPool = 0;
+        for (int c = 0; c < m_numSizeClasses; ++c) {
+            const size_t bytes = m_sizeClass[c].bytes;
+            if (bytes <= tinyBufferSize) {
+                mallocsFromTinyPool += numMallocs[c];
+            } else if (bytes <= smallBufferSize) {
+                mallocsFromSmallPool += numMallocs[c];
+            } else {
+                mallocsFromMedPool += numMallocs[c];
+            }
+        }
+        const uint64 totalMallocs = mallocsFromTinyPool + mallocsFromSmallPool + mallocsFromMedPool + numHeapMallocs;
+
+        String mallocRatioString;
+        if (totalMallocs > 0) {
+            const double total = double(totalMallocs);
+            mallocRatioString = format("Percent of Mallocs: %5.1f%% <= %db, %5.1f%% <= %db, "
+                          "%5.1f%% <= %db, %5.1f%% > %db or out of slabs",
                           100.0 * mallocsFromTinyPool  / total,
                           BufferPool::tinyBufferSize,
                           100.0 * mallocsFromSmallPool / total,
                           BufferPool::smallBufferSize,
                           100.0 * mallocsFromMedPool   / total,
                           BufferPool::medBufferSize,
-                          100.0 * (1.0 - (double)pooled / total),
+                          100.0 * numHeapMallocs / total,
                           BufferPool::medBufferSize);
         } else {
-            return "No System::malloc calls made yet.";
+            mallocRatioString = "No System::malloc calls made yet.";
         }
-    }
 
-    String status() const {
-        String tinyPoolString = format("Tiny Pool: %5.1f%% of %d x %db Free", 100.0 * tinyPoolSize / maxTinyBuffers, 
-                                       maxTinyBuffers, tinyBufferSize);
-        String poolSizeString = format("Pool Sizes: %5d/%d x %db, %5d/%d x %db, %5d/%d x %db",
-                                       tinyPoolSize,     maxTinyBuffers,     tinyBufferSize, 
-                                       smallPoolSize,    maxSmallBuffers,    smallBufferSize,
-                                       medPoolSize,      maxMedBuffers,      medBufferSize);
-
-        int pooled = mallocsFromTinyPool +
-            mallocsFromSmallPool + 
-            mallocsFromMedPool;
-        int outOfPoolsMallocs = totalMallocs - pooled;
-        String outOfBufferMemoryString = format("Total out of pools mallocs: %d; Bytes allocated: %d", outOfPoolsMallocs, int(bytesAllocated));
-        String purgeString = format("Small Pool Purges: %d; Med Pool Purges: %d", smallPoolPurgeCount, medPoolPurgeCount);
-        return mallocRatioString() + "\n" + poolSizeString + "\n" + outOfBufferMemoryString + "\n" + purgeString;
+        String slabString = format("Slabs: %d/%d x %d kB in use; %d thread caches", 
+                                   min(int(m_numSlabsUsed.load()), int(maxSlabs)), int(maxSlabs), int(slabSize / 1024), 
+                                   m_numThreadCaches);
+        String outOfBufferMemoryString = format("Total out of pools mallocs: %lld; Bytes allocated: %lld", 
+                                                (long long)numHeapMallocs, (long long)bytesAllocated.load());
+
+        String sizeClassString = "Size class   Slabs  Central free      Mallocs";
+        for (int c = 0; c < m_numSizeClasses; ++c) {
+            SizeClass& sizeClass = m_sizeClass[c];
+            sizeClass.lock.lock();
+            const int numSlabs = sizeClass.numSlabs;
+            const int numFree  = sizeClass.freeList.size;
+            sizeClass.lock.unlock();
+
+            if ((numSlabs > 0) || (numMallocs[c] > 0)) {
+                sizeClassString += format("\n    %5db   %5d  %12d %12lld", 
+                                          int(sizeClass.bytes), numSlabs, numFree, (long long)numMallocs[c]);
+            }
+        }
 
+        return mallocRatioString + "\n" + slabString + "\n" + outOfBufferMemoryString + "\n" + sizeClassString;
     }
 };
 
+__thread BufferPool::ThreadCache* BufferPool::s_threadCache = NULL;
+__thread bool BufferPool::s_threadCacheRetired = false;
+
 // Dynamically allocated because we need to ensure that
 // the buffer pool is still around when the last global variable 
 // is deallocated.
@@ -1467,10 +1629,7 @@ String System::mallocStatus() {
 
 void System::resetMallocPerformanceCounters() {
 #ifndef NO_BUFFERPOOL
-    bufferpool->totalMallocs         = 0;
-    bufferpool->mallocsFromMedPool   = 0;
-    bufferpool->mallocsFromSmallPool = 0;
-    bufferpool->mallocsFromTinyPool  = 0;
+    bufferpool->resetPerformanceCounters();
 #endif
 }
 
@@ -1696,6 +1855,8 @@ void System::describeSystem(
         var(t, "hasSSE", System::hasSSE());
         var(t, "hasSSE2", System::hasSSE2());
         var(t, "hasSSE3", System::hasSSE3());
+        var(t, "hasSSSE3", System::hasSSSE3());
+        var(t, "hasSSE4_1", System::hasSSE4_1());
         var(t, "has3DNow", System::has3DNow());
         var(t, "hasRDTSC", System::hasRDTSC());
         var(t, "numCores", System::numCores());
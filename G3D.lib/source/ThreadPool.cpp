@@ -0,0 +1,452 @@
+/**
+  \file ThreadPool.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+ */
+
+#include "G3D/ThreadPool.h"
+#include "G3D/GThread.h"
+#include "G3D/GMutex.h"
+#include "G3D/Queue.h"
+#include "G3D/Array.h"
+#include "G3D/System.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+namespace G3D {
+
+namespace _internal {
+
+/** Index of the current thread within the pool.  Zero for every
+    thread that is not a pool worker. */
+static __thread int s_poolIndex = 0;
+
+class ParallelJob;
+
+/** Job whose body the current thread is executing, or NULL */
+static __thread ParallelJob* s_currentJob = NULL;
+
+/** State of a single ThreadPool::parallelForRange invocation.  Lives
+    on the stack of the invoking thread. */
+class ParallelJob {
+public:
+    enum { UNASSIGNED = -1, REFUSED = -2 };
+
+    const ThreadPool::RangeFunction&  body;
+    const int                         grainSize;
+    const int                         maxThreads;
+
+    /** Job whose body invoked this one, or NULL.  The parent outlives
+        this job because its caller waits for the nested loop. */
+    const ParallelJob*                parent;
+
+    /** Number of iterations that have not yet been executed. The job
+        is complete when this reaches zero. */
+    std::atomic<int>                  remaining;
+
+    /** Number of threads that have been assigned a job-local ID */
+    std::atomic<int>                  numJoined;
+
+    /** Job-local thread ID for each pool index. After construction,
+        element i is only accessed by pool thread i. */
+    Array<int>                        localID;
+
+    ParallelJob
+    (const ThreadPool::RangeFunction& body,
+     int                              grainSize,
+     int                              maxThreads,
+     int                              numIterations,
+     int                              callerIndex,
+     int                              poolSize,
+     const ParallelJob*               parent) :
+        body(body),
+        grainSize(grainSize),
+        maxThreads(maxThreads),
+        parent(parent),
+        remaining(numIterations),
+        numJoined(1) {
+
+        localID.resize(poolSize);
+        for (int i = 0; i < poolSize; ++i) {
+            localID[i] = UNASSIGNED;
+        }
+        localID[callerIndex] = 0;
+    }
+
+    /** Returns the job-local thread ID for pool thread \a poolIndex,
+        assigning one if this is the first time that the thread has
+        participated.  Returns -1 if the job already has maxThreads
+        participants. */
+    int join(int poolIndex) {
+        int& id = localID[poolIndex];
+        if (id == UNASSIGNED) {
+            const int n = numJoined.fetch_add(1);
+            id = (n < maxThreads) ? n : REFUSED;
+        }
+        return (id == REFUSED) ? -1 : id;
+    }
+
+    /** True if this is \a job or was invoked, possibly indirectly, from its body */
+    bool isWithin(const ParallelJob* job) const {
+        for (const ParallelJob* j = this; j; j = j->parent) {
+            if (j == job) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+
+class ParallelTask {
+public:
+    ParallelJob*    job;
+    int             begin;
+    int             end;
+
+    ParallelTask() : job(NULL), begin(0), end(0) {}
+
+    ParallelTask(ParallelJob* job, int begin, int end) : job(job), begin(begin), end(end) {}
+};
+
+
+class WorkStealingScheduler {
+private:
+
+    class TaskDeque {
+    public:
+        Spinlock                lock;
+        Queue<ParallelTask>     queue;
+
+        /** Mirrors queue.size() so that thieves can skip empty
+            deques without taking the lock */
+        std::atomic<int>        size;
+
+        TaskDeque() : size(0) {}
+    };
+
+    class Worker : public GThread {
+    private:
+        WorkStealingScheduler*  m_scheduler;
+        const int               m_index;
+    protected:
+        virtual void threadMain() override {
+            m_scheduler->workerMain(m_index);
+        }
+    public:
+        Worker(WorkStealingScheduler* scheduler, int index) :
+            GThread(format("ThreadPool worker %d", index)),
+            m_scheduler(scheduler),
+            m_index(index) {}
+    };
+
+    /** Number of failed attempts to find work before a worker sleeps */
+    enum { SPIN_COUNT = 64 };
+
+    /** Element 0 receives tasks pushed by threads outside of the
+        pool.  Element i > 0 is owned by worker i. */
+    Array<TaskDeque*>           m_deque;
+
+    Array<shared_ptr<GThread>>  m_worker;
+
+    /** Number of tasks ever pushed.  An idle worker's refusals are
+        permanent (ParallelJob::join), so only a push can give a worker
+        that found nothing acceptable something new to run. */
+    std::atomic<uint64>         m_numPushed;
+
+    std::atomic<int>            m_numSleeping;
+
+    std::mutex                  m_sleepMutex;
+    std::condition_variable     m_wakeCondition;
+
+    WorkStealingScheduler() : m_numPushed(0), m_numSleeping(0) {
+        const int numWorkers = max(0, System::numCores() - 1);
+        m_deque.resize(numWorkers + 1);
+        for (int i = 0; i < m_deque.size(); ++i) {
+            m_deque[i] = new TaskDeque();
+        }
+
+        for (int i = 1; i <= numWorkers; ++i) {
+            m_worker.append(shared_ptr<GThread>(new Worker(this, i)));
+            m_worker.last()->start();
+        }
+    }
+
+    void push(const ParallelTask& task, int poolIndex) {
+        TaskDeque* d = m_deque[poolIndex];
+        d->lock.lock();
+        d->queue.pushBack(task);
+        d->size.store(d->queue.size());
+        d->lock.unlock();
+
+        m_numPushed.fetch_add(1);
+        if (m_numSleeping.load() > 0) {
+            std::lock_guard<std::mutex> guard(m_sleepMutex);
+            if (task.job->numJoined.load() >= task.job->maxThreads) {
+                // An arbitrary sleeper would likely be refused, so wake
+                // the ones that have already joined as well
+                m_wakeCondition.notify_all();
+            } else {
+                m_wakeCondition.notify_one();
+            }
+        }
+    }
+
+    /** True if the thread at \a poolIndex may execute \a task while
+        waiting for \a waitJob, which is NULL for an idle worker.
+
+        A waiting thread is still inside the bodies of the jobs that
+        enclose \a waitJob, so running another chunk of one of them
+        would reuse its threadID on the same stack.  Waiting workers
+        therefore only run tasks of \a waitJob and of loops nested
+        within it.  Threads outside of the pool all have pool index 0,
+        so they only run tasks of \a waitJob itself. */
+    bool accept(const ParallelTask& task, int poolIndex, const ParallelJob* waitJob) const {
+        if (poolIndex == 0) {
+            return task.job == waitJob;
+        } else if (waitJob && ! task.job->isWithin(waitJob)) {
+            return false;
+        } else {
+            return task.job->join(poolIndex) >= 0;
+        }
+    }
+
+    /** Removes an acceptable task from the front of \a d, which is not owned by the caller */
+    bool steal(TaskDeque* d, int poolIndex, const ParallelJob* waitJob, ParallelTask& task) {
+        if (d->size.load() == 0) {
+            return false;
+        }
+
+        bool found = false;
+        d->lock.lock();
+        Queue<ParallelTask>& q = d->queue;
+        for (int i = 0; i < q.size(); ++i) {
+            if (accept(q[i], poolIndex, waitJob)) {
+                // Shift the earlier tasks back over the accepted one, preserving
+                // the order that take() relies on, then remove the front
+                task = q[i];
+                for (int j = i; j > 0; --j) {
+                    q[j] = q[j - 1];
+                }
+                q.popFront();
+                d->size.store(q.size());
+                found = true;
+                break;
+            }
+        }
+        d->lock.unlock();
+
+        return found;
+    }
+
+    bool take(int poolIndex, const ParallelJob* waitJob, ParallelTask& task) {
+        bool found = false;
+
+        if (poolIndex > 0) {
+            // Take the most recently split (smallest) owned task for locality.
+            // Owned tasks are in nesting order, so tasks of enclosing jobs are
+            // only at the back when nothing acceptable is left.
+            TaskDeque* own = m_deque[poolIndex];
+            if (own->size.load() > 0) {
+                own->lock.lock();
+                Queue<ParallelTask>& q = own->queue;
+                if ((q.size() > 0) && ((waitJob == NULL) || q.last().job->isWithin(waitJob))) {
+                    task = q.popBack();
+                    own->size.store(q.size());
+                    found = true;
+                }
+                own->lock.unlock();
+            }
+        }
+
+        // Steal, visiting the other deques in a different order on each thread
+        for (int i = 0; (i < m_deque.size()) && ! found; ++i) {
+            const int victim = (poolIndex + i) % m_deque.size();
+            if ((victim != poolIndex) || (poolIndex == 0)) {
+                found = steal(m_deque[victim], poolIndex, waitJob, task);
+            }
+        }
+
+        return found;
+    }
+
+    void execute(ParallelTask task, int poolIndex) {
+        ParallelJob* job = task.job;
+        const int threadID = (poolIndex == 0) ? 0 : job->join(poolIndex);
+        debugAssert(threadID >= 0);
+
+        // Split, exposing the upper halves to thieves
+        while (task.end - task.begin > job->grainSize) {
+            const int mid = task.begin + (task.end - task.begin) / 2;
+            push(ParallelTask(job, mid, task.end), poolIndex);
+            task.end = mid;
+        }
+
+        ParallelJob* enclosingJob = s_currentJob;
+        s_currentJob = job;
+        job->body(task.begin, task.end, threadID);
+        s_currentJob = enclosingJob;
+
+        // The job may be destroyed by its caller as soon as this completes
+        job->remaining.fetch_sub(task.end - task.begin);
+    }
+
+    void workerMain(int index) {
+        s_poolIndex = index;
+
+        int numFailures = 0;
+        while (true) {
+            // Read before searching, so that a push racing with the
+            // search prevents the sleep below
+            const uint64 numPushed = m_numPushed.load();
+            ParallelTask task;
+            if (take(index, NULL, task)) {
+                execute(task, index);
+                numFailures = 0;
+            } else if (numFailures < SPIN_COUNT) {
+                ++numFailures;
+                std::this_thread::yield();
+            } else {
+                // Sleep until there is new work.  Queued tasks that this
+                // worker was refused do not count, or it would never sleep
+                // while a job with maxThreads participants is running.
+                std::unique_lock<std::mutex> guard(m_sleepMutex);
+                m_numSleeping.fetch_add(1);
+                m_wakeCondition.wait(guard, [this, numPushed] { return m_numPushed.load() != numPushed; });
+                m_numSleeping.fetch_sub(1);
+                numFailures = 0;
+            }
+        }
+    }
+
+public:
+
+    static WorkStealingScheduler& instance() {
+        // Intentionally never deleted; the workers sleep until the process exits
+        static WorkStealingScheduler* s = new WorkStealingScheduler();
+        return *s;
+    }
+
+    int numThreads() const {
+        return m_deque.size();
+    }
+
+    void run(int start, int upTo, const ThreadPool::RangeFunction& body, int grainSize, int maxThreads) {
+        const int poolIndex = s_poolIndex;
+        ParallelJob job(body, grainSize, maxThreads, upTo - start, poolIndex, m_deque.size(), s_currentJob);
+
+        execute(ParallelTask(&job, start, upTo), poolIndex);
+
+        // Help with this loop and the loops nested within it instead of blocking
+        while (job.remaining.load() > 0) {
+            ParallelTask task;
+            if (take(poolIndex, &job, task)) {
+                execute(task, poolIndex);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+};
+
+} // namespace _internal
+
+
+int ThreadPool::numThreads() {
+    return _internal::WorkStealingScheduler::instance().numThreads();
+}
+
+
+void ThreadPool::parallelForRange
+(int                    start,
+ int                    upTo,
+ const RangeFunction&   body,
+ int                    grainSize,
+ int                    maxThreads) {
+
+    if (upTo <= start) {
+        return;
+    }
+
+    _internal::WorkStealingScheduler& scheduler = _internal::WorkStealingScheduler::instance();
+
+    if ((maxThreads < 1) || (maxThreads > scheduler.numThreads())) {
+        maxThreads = scheduler.numThreads();
+    }
+
+    const int n = upTo - start;
+    if (grainSize < 1) {
+        // Several chunks per thread, so that thieves have something to take
+        grainSize = max(1, n / (maxThreads * 8));
+    }
+
+    if ((maxThreads == 1) || (n <= grainSize)) {
+        body(start, upTo, 0);
+    } else {
+        scheduler.run(start, upTo, body, grainSize, maxThreads);
+    }
+}
+
+
+void ThreadPool::parallelFor
+(int                    start,
+ int                    upTo,
+ const std::function<void (int i, int threadID)>& body,
+ int                    grainSize,
+ int                    maxThreads) {
+
+    parallelForRange(start, upTo, [&body](int begin, int end, int threadID) {
+        for (int i = begin; i < end; ++i) {
+            body(i, threadID);
+        }
+    }, grainSize, maxThreads);
+}
+
+
+void ThreadPool::parallelForTiles
+(const Vector2int32&    start,
+ const Vector2int32&    upTo,
+ const TileFunction&    body,
+ const Vector2int32&    tileSize,
+ int                    maxThreads) {
+
+    if ((upTo.x <= start.x) || (upTo.y <= start.y)) {
+        return;
+    }
+
+    const Vector2int32 size = tileSize.max(Vector2int32(1, 1));
+    const Vector2int32 extent = upTo - start;
+    const int tilesX = (extent.x + size.x - 1) / size.x;
+    const int tilesY = (extent.y + size.y - 1) / size.y;
+
+    parallelForRange(0, tilesX * tilesY, [&](int begin, int end, int threadID) {
+        for (int t = begin; t < end; ++t) {
+            const Vector2int32 tileStart(start.x + (t % tilesX) * size.x, start.y + (t / tilesX) * size.y);
+            body(tileStart, (tileStart + size).min(upTo), threadID);
+        }
+    }, 0, maxThreads);
+}
+
+
+void ThreadPool::parallelFor2D
+(const Vector2int32&    start,
+ const Vector2int32&    upTo,
+ const std::function<void (int x, int y, int threadID)>& body,
+ const Vector2int32&    tileSize,
+ int                    maxThreads) {
+
+    parallelForTiles(start, upTo, [&body](const Vector2int32& tileStart, const Vector2int32& tileEnd, int threadID) {
+        for (int y = tileStart.y; y < tileEnd.y; ++y) {
+            for (int x = tileStart.x; x < tileEnd.x; ++x) {
+                body(x, y, threadID);
+            }
+        }
+    }, tileSize, maxThreads);
+}
+
+} // namespace G3D
@@ -0,0 +1,238 @@
+/**
+  \file G3D/source/TiledImageEncoder.cpp
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+  \created 2026-10-17
+  \edited  2026-10-17
+
+  Copyright 2000-2016, Morgan McGuire.
+  All rights reserved.
+ */
+#include "G3D/TiledImageEncoder.h"
+#include "G3D/BinaryInput.h"
+#include "G3D/BinaryOutput.h"
+#include "G3D/CPUPixelTransferBuffer.h"
+#include "G3D/ThreadPool.h"
+
+namespace G3D {
+
+/** Hashes a \a rows x \a rowBytes block of memory whose rows are \a stride bytes apart.
+    Four independent lanes hide the latency of the multiplies.  Each step is invertible,
+    so changing any single word of the input always changes the hash. */
+static uint64 hashTile(const uint8* src, size_t stride, size_t rowBytes, int rows) {
+    static const uint64 PRIME = 0x9E3779B97F4A7C15ULL;
+    uint64 h[4] = {0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL};
+
+    for (int y = 0; y < rows; ++y) {
+        const uint8* row = src + y * stride;
+        size_t i = 0;
+        for (; i + 32 <= rowBytes; i += 32) {
+            for (int lane = 0; lane < 4; ++lane) {
+                uint64 w;
+                System::memcpy(&w, row + i + lane * 8, 8);
+                h[lane] = (h[lane] ^ w) * PRIME;
+                h[lane] ^= h[lane] >> 29;
+            }
+        }
+
+        for (; i < rowBytes; ++i) {
+            h[0] = (h[0] ^ row[i]) * PRIME;
+        }
+    }
+
+    uint64 result = h[0];
+    for (int lane = 1; lane < 4; ++lane) {
+        result = (result ^ ((h[lane] << (lane * 16)) | (h[lane] >> (64 - lane * 16)))) * PRIME;
+        result ^= result >> 32;
+    }
+    return result;
+}
+
+
+size_t TiledImageEncoder::Frame::dataSize() const {
+    size_t s = 0;
+    for (int t = 0; t < tile.size(); ++t) {
+        s += tile[t].data.size();
+    }
+    return s;
+}
+
+
+void TiledImageEncoder::Frame::serialize(BinaryOutput& b) const {
+    b.writeInt32(width);
+    b.writeInt32(height);
+    b.writeInt64(index);
+    b.writeBool8(keyframe);
+    b.writeInt32(fileFormat);
+    b.writeInt32(tile.size());
+    for (int t = 0; t < tile.size(); ++t) {
+        const Tile& T = tile[t];
+        b.writeInt32(T.origin.x);
+        b.writeInt32(T.origin.y);
+        b.writeInt32(T.width);
+        b.writeInt32(T.height);
+        b.writeInt32(T.data.size());
+        b.writeBytes(T.data.getCArray(), T.data.size());
+    }
+}
+
+
+void TiledImageEncoder::Frame::deserialize(BinaryInput& b) {
+    width = b.readInt32();
+    height = b.readInt32();
+    index = b.readInt64();
+    keyframe = b.readBool8();
+    fileFormat = Image::ImageFileFormat(b.readInt32());
+    tile.resize(b.readInt32());
+    for (int t = 0; t < tile.size(); ++t) {
+        Tile& T = tile[t];
+        T.origin.x = b.readInt32();
+        T.origin.y = b.readInt32();
+        T.width = b.readInt32();
+        T.height = b.readInt32();
+        T.data.resize(b.readInt32());
+        b.readBytes(T.data.getCArray(), T.data.size());
+    }
+}
+
+
+TiledImageEncoder::TiledImageEncoder(const Settings& settings) :
+    m_settings(settings),
+    m_width(0),
+    m_height(0),
+    m_format(NULL),
+    m_nextIndex(0),
+    m_forceKeyframe(true) {
+    alwaysAssertM(settings.tileSize > 0, "Tile size must be positive");
+    alwaysAssertM((settings.fileFormat == Image::PNG) || (settings.fileFormat == Image::JPEG), "Only PNG and JPEG are supported");
+}
+
+
+shared_ptr<TiledImageEncoder> TiledImageEncoder::create(const Settings& settings) {
+    return shared_ptr<TiledImageEncoder>(new TiledImageEncoder(settings));
+}
+
+
+void TiledImageEncoder::encode(const shared_ptr<PixelTransferBuffer>& src, Frame& result) {
+    const ImageFormat* format = src->format();
+    alwaysAssertM((format->cpuBitsPerPixel % 8) == 0, "Pixels must be a whole number of bytes");
+    alwaysAssertM(src->depth() == 1, "Only 2D images are supported");
+    const size_t bytesPerPixel = format->cpuBitsPerPixel / 8;
+
+    const int tileSize = m_settings.tileSize;
+    const int tilesWide = iCeil(float(src->width()) / float(tileSize));
+    const int tilesHigh = iCeil(float(src->height()) / float(tileSize));
+    const int numTiles = tilesWide * tilesHigh;
+
+    const bool keyframe = m_forceKeyframe ||
+        (src->width() != m_width) || (src->height() != m_height) || (format != m_format) ||
+        ((m_settings.keyframeInterval > 0) && ((m_nextIndex % m_settings.keyframeInterval) == 0));
+
+    if (keyframe) {
+        m_width = src->width();
+        m_height = src->height();
+        m_format = format;
+        m_tileHash.resize(numTiles);
+        m_forceKeyframe = false;
+    }
+
+    result.width = m_width;
+    result.height = m_height;
+    result.index = m_nextIndex;
+    result.keyframe = keyframe;
+    result.fileFormat = m_settings.fileFormat;
+
+    // Every tile's slot is filled in parallel and then the unchanged ones are removed,
+    // so that the output order does not depend on scheduling
+    result.tile.resize(numTiles);
+
+    const uint8* pixels = static_cast<const uint8*>(src->mapRead());
+    const size_t stride = src->stride();
+
+    // Each tile is hashed and, if changed, compressed by the same task.  Compression
+    // dominates, so the grain size is a single tile.
+    ThreadPool::parallelFor(0, numTiles, [&](int t, int threadID) {
+        Tile& tile = result.tile[t];
+        tile.origin = Point2int32((t % tilesWide) * tileSize, (t / tilesWide) * tileSize);
+        tile.width = min(tileSize, m_width - tile.origin.x);
+        tile.height = min(tileSize, m_height - tile.origin.y);
+
+        const uint8* corner = pixels + tile.origin.y * stride + tile.origin.x * bytesPerPixel;
+        const size_t rowBytes = tile.width * bytesPerPixel;
+        const uint64 hash = hashTile(corner, stride, rowBytes, tile.height);
+        if (! keyframe && (hash == m_tileHash[t])) {
+            tile.data.fastClear();
+            tile.width = 0;
+            return;
+        }
+        m_tileHash[t] = hash;
+
+        // JPEG has no alpha channel, so drop it while copying the common RGBA8 case
+        const bool stripAlpha = (m_settings.fileFormat == Image::JPEG) && (format == ImageFormat::RGBA8());
+        const shared_ptr<CPUPixelTransferBuffer>& buffer = CPUPixelTransferBuffer::create(tile.width, tile.height, stripAlpha ? ImageFormat::RGB8() : format);
+        for (int y = 0; y < tile.height; ++y) {
+            const uint8* srcRow = corner + y * stride;
+            uint8* dstRow = static_cast<uint8*>(buffer->row(y));
+            if (stripAlpha) {
+                for (int x = 0; x < tile.width; ++x) {
+                    dstRow[3 * x + 0] = srcRow[4 * x + 0];
+                    dstRow[3 * x + 1] = srcRow[4 * x + 1];
+                    dstRow[3 * x + 2] = srcRow[4 * x + 2];
+                }
+            } else {
+                System::memcpy(dstRow, srcRow, rowBytes);
+            }
+        }
+
+        const shared_ptr<Image>& image = Image::fromPixelTransferBuffer(buffer);
+        if ((m_settings.fileFormat == Image::JPEG) && (image->format() != ImageFormat::RGB8())) {
+            image->convert(ImageFormat::RGB8());
+        }
+
+        BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+        image->serialize(bo, m_settings.fileFormat);
+        tile.data.resize(int(bo.size()), false);
+        bo.commit(tile.data.getCArray());
+    }, 1);
+
+    src->unmap();
+
+    // Remove unchanged tiles, preserving order
+    int numChanged = 0;
+    for (int t = 0; t < numTiles; ++t) {
+        if (result.tile[t].width > 0) {
+            if (numChanged != t) {
+                Tile& dst = result.tile[numChanged];
+                Tile& tile = result.tile[t];
+                dst.origin = tile.origin;
+                dst.width = tile.width;
+                dst.height = tile.height;
+                Array<uint8>::swap(dst.data, tile.data);
+            }
+            ++numChanged;
+        }
+    }
+    result.tile.resize(numChanged);
+
+    ++m_nextIndex;
+}
+
+
+void TiledImageEncoder::decode(const Frame& frame, const shared_ptr<Image>& dst) {
+    for (int t = 0; t < frame.tile.size(); ++t) {
+        const Tile& tile = frame.tile[t];
+        BinaryInput bi(tile.data.getCArray(), tile.data.size(), G3D_LITTLE_ENDIAN, false, false);
+        const shared_ptr<Image>& image = Image::fromBinaryInput(bi);
+
+        if (frame.keyframe && (t == 0)) {
+            // Adopt the format of the compressed data
+            dst->setSize(frame.width, frame.height, image->format());
+        }
+        debugAssertM((dst->width() == frame.width) && (dst->height() == frame.height),
+                     "The first frame decoded must be a keyframe");
+
+        dst->set(image->toPixelTransferBuffer(), tile.origin.x, tile.origin.y);
+    }
+}
+
+} // namespace G3D
@@ -154,6 +154,7 @@ bool _handleDebugAssert_(
 
     // Log the error
     Log::common()->print(String("\n**************************\n\n") + dialogTitle + "\n" + dialogText);
+    Log::common()->flush();
 
     const int result = G3D::prompt(dialogTitle.c_str(), dialogText.c_str(), (const char**)choices, 3, useGuiPrompt);
 
@@ -198,6 +199,7 @@ bool _handleErrorCheck_(
 
     // Log the error
     Log::common()->print(String("\n**************************\n\n") + dialogTitle + "\n" + dialogText);
+    Log::common()->flush();
     #ifdef G3D_WINDOWS
         DWORD lastErr = GetLastError();
         (void)lastErr;
@@ -357,14 +359,12 @@ String __cdecl debugPrintf(const char* fmt ...) {
 }
 
 String consolePrint(const String& s) {
-    FILE* L = Log::common()->getFile();
-    fprintf(L, "%s", s.c_str());
+    Log::common()->print(s);
 
     if (consolePrintHook()) {
         consolePrintHook()(s);
     }
 
-    fflush(L);
     return s;
 }
 
@@ -4,7 +4,7 @@
  @author Morgan McGuire, graphics3d.com
  
  @author  2002-06-06
- @edited  2010-02-05
+ @edited  2026-10-17
  */
 
 #include <cstring>
@@ -135,31 +135,14 @@ String readWholeFile(const String& filename) {
 
         // Zipfiles require Unix-style slashes
         String internalFile = FilePath::canonicalize(filename.substr(zipfile.length() + 1));
-        struct zip* z = zip_open(zipfile.c_str(), ZIP_CHECKCONS, NULL);
-        {
-            struct zip_stat info;
-            zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-            zip_stat(z, internalFile.c_str(), ZIP_FL_NOCASE, &info);
-
-            // Add NULL termination
-            char* buffer = reinterpret_cast<char*>(System::alignedMalloc(info.size + 1, 16));
-            buffer[info.size] = '\0';
-
-            struct zip_file* zf = zip_fopen( z, internalFile.c_str(), ZIP_FL_NOCASE );
-            if (zf == NULL) {
-                throw String("\"") + internalFile + "\" inside \"" + zipfile + "\" could not be opened.";
-            } else {
-                const int64 bytesRead = zip_fread( zf, buffer, (info.size));
-                debugAssertM((int64)bytesRead == (int64)info.size,
-                             internalFile + " was corrupt because it unzipped to the wrong size.");
-                (void)bytesRead;
-                zip_fclose( zf );
-            }
-            // Copy the string
-            s = buffer;
-            System::alignedFree(buffer);
-        }
-        zip_close( z );
+
+        // The buffer is NULL terminated
+        int64 length = 0;
+        char* buffer = reinterpret_cast<char*>(FileSystem::readZipfileEntry(zipfile, internalFile, length));
+
+        // Copy the string
+        s = buffer;
+        System::alignedFree(buffer);
     }
 
     return s;
@@ -173,19 +156,8 @@ int64 fileLength(const String& filename) {
     if (result == -1) {
         String zip, contents;
         if(zipfileExists(filename, zip, contents)){
-            int64 requiredMem;
-
-                        struct zip *z = zip_open( zip.c_str(), ZIP_CHECKCONS, NULL );
-                        debugAssertM(z != NULL, zip + ": zip open failed.");
-            {
-                                struct zip_stat info;
-                                zip_stat_init( &info );    // TODO: Docs unclear if zip_stat_init is required.
-                                int success = zip_stat( z, contents.c_str(), ZIP_FL_NOCASE, &info );
-                (void)success;
-                                debugAssertM(success == 0, zip + ": " + contents + ": zip stat failed.");
-                                requiredMem = info.size;
-            }
-                        zip_close( z );
+            const int64 requiredMem = FileSystem::zipfileEntrySize(zip, contents);
+            debugAssertM(requiredMem != -1, zip + ": " + contents + ": zip stat failed.");
             return requiredMem;
         } else {
         return -1;
@@ -309,15 +281,8 @@ static void _zip_resolveDirectory(String& completeDir, const String& drive, cons
 
 /** assumes that zipDir references a .zip file */
 static bool _zip_zipContains(const String& zipDir, const String& desiredFile){
-        struct zip *z = zip_open( zipDir.c_str(), ZIP_CHECKCONS, NULL );
-    //the last parameter, an int, determines case sensitivity:
-    //1 is sensitive, 2 is not, 0 is default
-        int test = zip_name_locate( z, desiredFile.c_str(), ZIP_FL_NOCASE );
-        zip_close( z );
-    if(test == -1){
-        return false;
-    }
-    return true;
+    // Case insensitive, using the cached directory of the zipfile
+    return FileSystem::zipfileEntrySize(zipDir, desiredFile) != -1;
 }
 
 
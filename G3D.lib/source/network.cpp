@@ -3,14 +3,17 @@
 #include "G3D/units.h"
 #include "G3D/ThreadsafeQueue.h"
 #include "G3D/GThread.h"
+#include <atomic>
 #ifdef G3D_OSX
 #   include <netdb.h>
+#   include <poll.h>
 #endif
 #ifdef G3D_WINDOWS
 #   include <Mmsystem.h>
 #endif
 #ifdef G3D_LINUX
 #   include <netdb.h>
+#   include <poll.h>
 
 
 #endif
@@ -56,7 +59,8 @@ static RealTime         s_networkCommunicationInterval;
 
 static AtomicInt32      s_backlog;
 
-/** Protects s_allServers and s_allClientConnections */
+/** Protects s_allServers and s_allClientConnections. The network thread holds this
+    while waiting for network activity, so other threads should acquire it with NetworkLock. */
 static GMutex           s_allServerAndClientConnectionMutex;
 static Array< weak_ptr<NetServer> > s_allServers;
 
@@ -65,6 +69,22 @@ namespace _internal {
 }
 static Array< weak_ptr<_internal::NetClientSideConnection> > s_allClientConnections;
 
+static void wakeNetworkThread();
+
+/** Acquires s_allServerAndClientConnectionMutex for the lifetime of the object, 
+    first waking the network thread so that it releases the lock promptly. */
+class NetworkLock {
+public:
+    NetworkLock() {
+        wakeNetworkThread();
+        s_allServerAndClientConnectionMutex.lock();
+    }
+
+    ~NetworkLock() {
+        s_allServerAndClientConnectionMutex.unlock();
+    }
+};
+
 static unsigned int backlogForPeer(_ENetPeer* enetPeer) {
     const size_t outgoingReliableCommandCount     = enet_list_size(&(enetPeer->outgoingReliableCommands));      
     const size_t outgoingUnreliableCommandCount   = enet_list_size(&(enetPeer->outgoingUnreliableCommands));    
@@ -92,67 +112,253 @@ unsigned int networkSendBacklog() {
 }
 
 
+/** Bytes of G3D's header at the front of the header packet: the message type and the channel word */
+static const size_t G3D_HEADER_SIZE = 8;
+
+/** The channel word of the header packet holds the channel in its low bits and the number
+    of data packets minus one in its high bits, so that a single-part message has the same
+    encoding as before multi-part messages existed. */
+static const int PART_COUNT_SHIFT = 16;
+
+
 namespace _internal {
 
+/** A G3D header packet and the data packets (parts) that it describes. Copies are shallow; 
+    destroy() must be invoked explicitly on exactly one of them. */
 class NetMessage {
 public:
 
     NetMessageType          type;
     NetChannel              channel;
-    ENetPacket*             packet;
-    ENetPacket*             header;
 
-    /** Only for outgoing messages */
-    ENetPeer*               enetPeer;
+    /** Number of data packets that make up the message */
+    int                     numParts;
 
-    /** Only for outgoing messages */
-    ENetHost*               enetHost;
+    ENetPacket*             header;
 
+    /** First data packet */
+    ENetPacket*             packet;
 
-    NetMessage() : type(0), channel(0), packet(NULL), header(NULL), enetPeer(NULL), enetHost(NULL) {}
+    /** Data packets after the first, or NULL if there are none */
+    Array<ENetPacket*>*     extraPart;
 
+    NetMessage() : type(0), channel(0), numParts(0), header(NULL), packet(NULL), extraPart(NULL) {}
 
-    NetMessage(_ENetPacket* p, _ENetPacket* h, ENetPeer* peer = NULL, ENetHost* host = NULL) : 
-        packet(p), header(h), enetPeer(peer), enetHost(host) {
+    /** Decodes the type, channel, and number of parts from \a h. Data packets are then added with attach(). */
+    explicit NetMessage(_ENetPacket* h) : header(h), packet(NULL), extraPart(NULL) {
+        debugAssertM(header->dataLength >= G3D_HEADER_SIZE, "Packet is too small");
         const uint32* data = reinterpret_cast<const uint32*>(header->data);
         type = ntohl(data[0]);
-        channel = ntohl(data[1]);
+        const uint32 channelWord = ntohl(data[1]);
+        channel = channelWord & ((1 << PART_COUNT_SHIFT) - 1);
+        numParts = int(channelWord >> PART_COUNT_SHIFT) + 1;
+    }
+
+    int numAttached() const {
+        return isNull(packet) ? 0 : 1 + (isNull(extraPart) ? 0 : extraPart->size());
+    }
+
+    bool complete() const {
+        return numAttached() == numParts;
     }
 
+    void attach(ENetPacket* p) {
+        if (isNull(packet)) {
+            packet = p;
+        } else {
+            if (isNull(extraPart)) {
+                extraPart = new Array<ENetPacket*>();
+            }
+            extraPart->append(p);
+        }
+    }
+
+    ENetPacket* part(int i) const {
+        return (i == 0) ? packet : (*extraPart)[i - 1];
+    }
+
+    /** Total bytes of the data packets */
+    size_t size() const {
+        size_t s = 0;
+        for (int i = 0; i < numAttached(); ++i) {
+            s += part(i)->dataLength;
+        }
+        return s;
+    }
 
     void destroy() {
-        enet_packet_destroy(packet);
-        enet_packet_destroy(header);
+        for (int i = 0; i < numAttached(); ++i) {
+            enet_packet_destroy(part(i));
+        }
+        if (notNull(header)) {
+            enet_packet_destroy(header);
+        }
+        delete extraPart;
+        extraPart = NULL;
         packet = NULL;
         header = NULL;
     }
 };
-} // namespace _internal
 
-static ThreadsafeQueue<_internal::NetMessage>& sendQueue() {
-    static ThreadsafeQueue<_internal::NetMessage> q;
-    return q;
-}
 
-/** Called from serviceNetwork() */
-static void processSendQueue() {
-    ThreadsafeQueue<_internal::NetMessage>& queue = sendQueue();
+/** Orders messages across all send queues, so that a host with several connections (such as 
+    a NetServer and its omniConnection) transmits them in the order that they were sent */
+static std::atomic<uint64> s_nextSendSequence(0);
+
+/** Outgoing messages of one NetSendConnection.  This is an intrusive linked list
+    in which producers only swap the head pointer (Vyukov's multiple-producer,
+    single-consumer queue), so application threads never block each other or the
+    network thread when sending.  Any thread may push; only the thread holding
+    s_allServerAndClientConnectionMutex pops. */
+class NetSendQueue : public ReferenceCountedObject {
+public:
+
+    class Node {
+    public:
+        std::atomic<Node*>      next;
+        NetMessage              message;
 
-    _internal::NetMessage message;
-    while (queue.popFront(message)) {
+        /** System::time() when the message was sent by the application */
+        RealTime                time;
 
-        debugAssert(notNull(message.enetHost));
+        /** From s_nextSendSequence */
+        uint64                  sequence;
 
-        if (isNull(message.enetPeer)) {
+        Node() : next(NULL), time(0), sequence(0) {}
+    };
+
+private:
+
+    /** Most recently pushed node */
+    std::atomic<Node*>          m_head;
+
+    /** Oldest node. Only accessed by the consumer. */
+    Node*                       m_tail;
+
+    /** Placeholder that keeps the list non-empty */
+    Node                        m_stub;
+
+    std::atomic<int>            m_numQueued;
+
+    // The following are written only by the consumer
+    std::atomic<uint64>         m_messagesSent;
+    std::atomic<uint64>         m_bytesSent;
+    std::atomic<double>         m_totalSendDelay;
+    std::atomic<double>         m_maxSendDelay;
+
+    const RealTime              m_creationTime;
+
+    void pushNode(Node* node) {
+        node->next.store(NULL, std::memory_order_relaxed);
+        Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+        // Between the exchange and this store, the consumer cannot see past prev
+        prev->next.store(node, std::memory_order_release);
+    }
+
+public:
+
+    NetSendQueue() : m_head(&m_stub), m_tail(&m_stub), m_numQueued(0), m_messagesSent(0), m_bytesSent(0),
+        m_totalSendDelay(0), m_maxSendDelay(0), m_creationTime(System::time()) {}
+
+    ~NetSendQueue() {
+        // Destroy any unsent packets
+        for (Node* node = popFront(); notNull(node); node = popFront()) {
+            node->message.destroy();
+            delete node;
+        }
+    }
+
+    /** Threadsafe */
+    void pushBack(const NetMessage& message) {
+        Node* node = new Node();
+        node->message = message;
+        node->time = System::time();
+        node->sequence = s_nextSendSequence++;
+        ++m_numQueued;
+        pushNode(node);
+    }
+
+    /** Returns NULL if the queue is empty or the only remaining node is still being 
+        pushed by another thread.  The caller must delete the node. */
+    Node* popFront() {
+        Node* tail = m_tail;
+        Node* next = tail->next.load(std::memory_order_acquire);
+        if (tail == &m_stub) {
+            if (isNull(next)) {
+                return NULL;
+            }
+            m_tail = next;
+            tail = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (isNull(next)) {
+            if (tail != m_head.load(std::memory_order_acquire)) {
+                // A producer has swapped the head but not yet linked it
+                return NULL;
+            }
+
+            // Re-insert the stub so that tail can be removed
+            pushNode(&m_stub);
+            next = tail->next.load(std::memory_order_acquire);
+            if (isNull(next)) {
+                return NULL;
+            }
+        }
+
+        m_tail = next;
+        --m_numQueued;
+        return tail;
+    }
+
+    /** Called by the consumer after handing a message to enet */
+    void recordSent(size_t bytes, RealTime delay) {
+        m_messagesSent.store(m_messagesSent.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        m_bytesSent.store(m_bytesSent.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+        m_totalSendDelay.store(m_totalSendDelay.load(std::memory_order_relaxed) + delay, std::memory_order_relaxed);
+        if (delay > m_maxSendDelay.load(std::memory_order_relaxed)) {
+            m_maxSendDelay.store(delay, std::memory_order_relaxed);
+        }
+    }
+
+    /** Fills the send fields of \a s */
+    void getStatistics(NetStatistics& s) const {
+        s.messagesSent  = m_messagesSent.load(std::memory_order_relaxed);
+        s.bytesSent     = m_bytesSent.load(std::memory_order_relaxed);
+        s.messagesQueued = m_numQueued.load(std::memory_order_relaxed);
+        s.meanSendDelay = (s.messagesSent > 0) ? m_totalSendDelay.load(std::memory_order_relaxed) / double(s.messagesSent) : 0.0;
+        s.maxSendDelay  = m_maxSendDelay.load(std::memory_order_relaxed);
+        s.duration      = System::time() - m_creationTime;
+    }
+};
+
+} // namespace _internal
+
+
+/** Hands \a node's message to enet on behalf of the connection that owns \a queue 
+    and then deletes \a node. \a peer is NULL for a broadcast. */
+static void transmit(ENetHost* host, ENetPeer* peer, _internal::NetSendQueue& queue, _internal::NetSendQueue::Node* node, RealTime now) {
+    _internal::NetMessage& message = node->message;
+    const size_t bytes = message.size();
+
+    // The header and all parts go out on the same enet channel, which preserves their order
+    for (int i = -1; i < message.numParts; ++i) {
+        ENetPacket* packet = (i < 0) ? message.header : message.part(i);
+        if (isNull(peer)) {
             // Must be a NetSendConnection broadcast message
-            enet_host_broadcast(message.enetHost, message.channel, message.header);
-            enet_host_broadcast(message.enetHost, message.channel, message.packet);
-        } else {
-            enet_peer_send(message.enetPeer, message.channel, message.header);
-            enet_peer_send(message.enetPeer, message.channel, message.packet);
+            enet_host_broadcast(host, message.channel, packet);
+        } else if (enet_peer_send(peer, message.channel, packet) < 0) {
+            // enet only takes ownership of packets that it accepts
+            enet_packet_destroy(packet);
         }
-        enet_host_flush(message.enetHost);
     }
+
+    // enet owns the packets now
+    delete message.extraPart;
+    message.extraPart = NULL;
+
+    queue.recordSent(bytes, max(0.0, now - node->time));
+    delete node;
 }
 
 
@@ -167,33 +373,60 @@ protected:
 
     mutable GMutex           m_mutex;
 
-    /** BinaryInput for the first packet, or NULL */
+    /** BinaryInput for the first message, or NULL */
     BinaryInput*             m_binaryInput;
 
-    /** BinaryInput for the first packet's header, or NULL */
+    /** BinaryInput for the first message's header, or NULL */
     BinaryInput*             m_headerBinaryInput;
 
+    /** BinaryInputs for the parts of the first message, allocated on demand */
+    Array<BinaryInput*>      m_partBinaryInput;
+
+    /** Concatenation of the parts of the first message if it has more than one and
+        data() was requested, otherwise NULL */
+    uint8*                   m_coalesced;
+
     /** Incoming packets waiting for iterators */
     Queue<NetMessage>        m_packetQueue;
 
-    /** Header packet describing the next packet, which has not yet arrived.
-        Set to NULL as soon as that packet arrives */
-    _ENetPacket*             m_header;
+    /** Messages whose header has arrived but some of whose parts have not, indexed by
+        enet channel.  enet only orders packets within a channel. */
+    Array<NetMessage>        m_incomplete;
+
+    uint64                   m_messagesReceived;
+    uint64                   m_bytesReceived;
+
+    /** Deallocates the views of the first message */
+    void clearViews() {
+        delete m_binaryInput;
+        m_binaryInput = NULL;
+
+        delete m_headerBinaryInput;
+        m_headerBinaryInput = NULL;
+
+        m_partBinaryInput.invokeDeleteOnAllElements();
+        m_partBinaryInput.fastClear();
+
+        System::free(m_coalesced);
+        m_coalesced = NULL;
+    }
 
 public:
 
-    NetMessageQueue() : m_binaryInput(NULL), m_headerBinaryInput(NULL), m_header(NULL) {}
+    NetMessageQueue() : m_binaryInput(NULL), m_headerBinaryInput(NULL), m_coalesced(NULL), m_messagesReceived(0), m_bytesReceived(0) {}
 
 
     ~NetMessageQueue() {
         GMutexLock lock(&m_mutex);
-        delete m_headerBinaryInput;
-        delete m_binaryInput;
+        clearViews();
 
         // Destroy any unread packets
         for (int i = 0; i < m_packetQueue.size(); ++i) {
             m_packetQueue[i].destroy();
         }
+        for (int i = 0; i < m_incomplete.size(); ++i) {
+            m_incomplete[i].destroy();
+        }
     }
 
 
@@ -206,42 +439,90 @@ public:
 
     void popFrontDiscard() {
         GMutexLock lock(&m_mutex);
-        delete m_binaryInput;
-        m_binaryInput = NULL;
-
-        delete m_headerBinaryInput;
-        m_headerBinaryInput = NULL;
+        clearViews();
 
         m_packetQueue[0].destroy();
         m_packetQueue.popFront();
     }
 
 
-    /** Add this packet to the back of the queue.  Packets come in pairs, 
-        where the first is the G3D header and the second is the actual
-        data.  The queue automatically keeps track of which this is. 
+    /** Add this packet, which arrived on \a enetChannel, to the message being assembled
+        on that channel.  Each message is a G3D header packet followed by the number of
+        data packets that the header specifies.  Complete messages move to the back 
+        of the queue.
         
         Called on the network thread.
         */
-    void halfPushBack(ENetPacket* p) {
+    void halfPushBack(ENetPacket* p, int enetChannel) {
         GMutexLock lock(&m_mutex);
-        if (isNull(m_header)) {
-            m_header = p;
-        } else {
-            // This is the data packet
-            debugAssertM(m_header->dataLength >= sizeof(uint32) * 2, "Packet is too small");
-            m_packetQueue.pushBack(NetMessage(p, m_header));
+        if (m_incomplete.size() <= enetChannel) {
+            m_incomplete.resize(enetChannel + 1);
+        }
 
-            // The header packet is no longer needed here
-            m_header = NULL;
+        NetMessage& message = m_incomplete[enetChannel];
+        if (isNull(message.header)) {
+            message = NetMessage(p);
+        } else {
+            message.attach(p);
+            if (message.complete()) {
+                m_packetQueue.pushBack(message);
+                ++m_messagesReceived;
+                m_bytesReceived += message.size();
+
+                // Ownership of the packets moved to the queue
+                message = NetMessage();
+            }
         }
     }
 
+
+    /** Fills the receive fields of \a s */
+    void getStatistics(NetStatistics& s) const {
+        GMutexLock lock(&m_mutex);
+        s.messagesReceived = m_messagesReceived;
+        s.bytesReceived    = m_bytesReceived;
+    }
+
     // The following methods are called on the application thread...but it is the application's responsibility to verify that there is an element in the queue first,
     // so this code just has to ensure that the queue is not reallocated while being accessed, not make sure that there is something in the queue.
-    ENetPacket* packet() const {
+    int numParts() const {
         GMutexLock lock(&m_mutex);
-        return m_packetQueue[0].packet;
+        return m_packetQueue[0].numParts;
+    }
+
+
+    ENetPacket* part(int i) const {
+        GMutexLock lock(&m_mutex);
+        debugAssertM(i >= 0 && i < m_packetQueue[0].numParts, "Part index out of bounds");
+        return m_packetQueue[0].part(i);
+    }
+
+
+    /** Total bytes of the parts of the first message */
+    size_t messageSize() const {
+        GMutexLock lock(&m_mutex);
+        return m_packetQueue[0].size();
+    }
+
+
+    /** The data of the first message, concatenating its parts if there is more than one */
+    uint8* data() {
+        GMutexLock lock(&m_mutex);
+        const NetMessage& message = m_packetQueue[0];
+        if (message.numParts == 1) {
+            return message.packet->data;
+        }
+
+        if (isNull(m_coalesced)) {
+            m_coalesced = (uint8*)System::malloc(max(message.size(), size_t(1)));
+            size_t offset = 0;
+            for (int i = 0; i < message.numParts; ++i) {
+                const ENetPacket* p = message.part(i);
+                System::memcpy(m_coalesced + offset, p->data, p->dataLength);
+                offset += p->dataLength;
+            }
+        }
+        return m_coalesced;
     }
 
 
@@ -260,19 +541,36 @@ public:
     BinaryInput& binaryInput() {
         GMutexLock lock(&m_mutex);
         if (isNull(m_binaryInput)) {
-            ENetPacket* packet = m_packetQueue[0].packet;
-            m_binaryInput = new BinaryInput(packet->data, packet->dataLength, G3D_LITTLE_ENDIAN, false, false);
+            m_binaryInput = new BinaryInput(data(), messageSize(), G3D_LITTLE_ENDIAN, false, false);
         }
 
         return *m_binaryInput;
     }
 
 
+    BinaryInput& partBinaryInput(int i) {
+        GMutexLock lock(&m_mutex);
+        if (m_partBinaryInput.size() <= i) {
+            const int oldSize = m_partBinaryInput.size();
+            m_partBinaryInput.resize(i + 1);
+            for (int j = oldSize; j <= i; ++j) {
+                m_partBinaryInput[j] = NULL;
+            }
+        }
+
+        if (isNull(m_partBinaryInput[i])) {
+            const ENetPacket* p = part(i);
+            m_partBinaryInput[i] = new BinaryInput(p->data, p->dataLength, G3D_LITTLE_ENDIAN, false, false);
+        }
+
+        return *m_partBinaryInput[i];
+    }
+
+
     BinaryInput& headerBinaryInput() {
         GMutexLock lock(&m_mutex);
         if (isNull(m_headerBinaryInput)) {
             ENetPacket* header = m_packetQueue[0].header;
-            const size_t G3D_HEADER_SIZE = 8;
             m_headerBinaryInput = new BinaryInput(reinterpret_cast<uint8*>(header->data) + G3D_HEADER_SIZE, header->dataLength - G3D_HEADER_SIZE, G3D_LITTLE_ENDIAN, false, false);
         }
 
@@ -285,6 +583,7 @@ namespace _internal {
 class NetClientSideConnection : public NetConnection {
 protected:
     friend class NetConnection;
+    friend class NetworkThread;
     friend void G3D::serviceNetwork();
 
     void onDisconnect() {
@@ -305,6 +604,10 @@ protected:
             return;
         }
 
+        if (processSendQueue()) {
+            enet_host_flush(m_enetHost);
+        }
+
         ENetEvent event;
         int result = 0;
         // Note that the following code assigns result inside the conditional
@@ -317,7 +620,7 @@ protected:
 
             case ENET_EVENT_TYPE_RECEIVE:
                 // Insert into the appropriate queue
-                m_netMessageIterator.m_queue->halfPushBack(event.packet);
+                m_netMessageIterator.m_queue->halfPushBack(event.packet, event.channelID);
                 updateLatencyEstimate();
                 break;
        
@@ -351,13 +654,24 @@ public:
     virtual void disconnect(bool waitForOtherSide) override {
         // Lock the entire system.  Grabbing this lock intentionally prevents serviceNetwork() from making progress or 
         // trying to access any clients.
-        GMutexLock lock(&s_allServerAndClientConnectionMutex);
+        NetworkLock lock;
         if (m_status.value() == DISCONNECTED) {
             debugAssert(m_enetHost == NULL);
-        } else {        
+        } else if (waitForOtherSide) {
             NetConnection::disconnect(waitForOtherSide);
-            if (! waitForOtherSide) {
-                // Destroy my host now since I will not receive more events
+        } else {
+            // Messages already sent by the application go out before the disconnect request
+            if (processSendQueue()) {
+                enet_host_flush(m_enetHost);
+            }
+
+            // Make a last attempt to service the host, which may itself observe a disconnection
+            serviceHost();
+            if (m_status.value() != DISCONNECTED) {
+                enet_peer_disconnect_now(m_enetPeer, 0);
+
+                // Destroy my host now since I will not receive more events. NetConnection::disconnect
+                // would only reset the peer, leaking the host that this connection owns.
                 onDisconnect();
             }
         }
@@ -412,10 +726,8 @@ static int32 backlogForHost(ENetHost* host) {
 
 
 void serviceNetwork() {
-    // Process the G3D send queue first, filling the enet communication queues in a
-    // threadsafe fashion. This way, servicing the host below can empty these queues.
-    processSendQueue();
-
+    // Each host hands the messages queued on its connections to enet before 
+    // servicing, so that they are transmitted in this pass.
     int32 b = 0;
 
     // Service all server enet hosts (and flush those that are gone)
@@ -449,6 +761,70 @@ void serviceNetwork() {
 }
 
 
+/** Longest time that the network thread sleeps without a packet arriving or a message 
+    being sent.  enet must be serviced periodically to retransmit lost packets and send pings. */
+static const uint32 MAX_NETWORK_THREAD_WAIT_MILLISECONDS = 5;
+
+/** Loopback UDP socket that the network thread waits on along with the enet hosts' sockets,
+    so that NetSendConnection::send can wake it.  ENET_SOCKET_NULL when there is no network thread. */
+static ENetSocket           s_wakeupSocket = ENET_SOCKET_NULL;
+static ENetAddress          s_wakeupAddress;
+
+/** True if a wakeup datagram has been sent since the network thread last began servicing, so
+    that a burst of sends costs only one system call */
+static std::atomic<bool>    s_wakeupPending(false);
+
+
+static void createWakeupSocket() {
+    s_wakeupSocket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+    if (s_wakeupSocket == ENET_SOCKET_NULL) {
+        logPrintf("Warning: could not create the network thread wakeup socket\n");
+        return;
+    }
+
+    ENetAddress address;
+    address.host = htonl(INADDR_LOOPBACK);
+    address.port = 0;
+
+    // enet 1.3.6 has no enet_socket_get_address, so ask the OS which port was assigned
+    struct sockaddr_in sin;
+#   ifdef G3D_WINDOWS
+        int length = sizeof(sin);
+#   else
+        socklen_t length = sizeof(sin);
+#   endif
+
+    if ((enet_socket_bind(s_wakeupSocket, &address) < 0) ||
+        (getsockname(s_wakeupSocket, (struct sockaddr*)&sin, &length) < 0) ||
+        (enet_socket_set_option(s_wakeupSocket, ENET_SOCKOPT_NONBLOCK, 1) < 0)) {
+        logPrintf("Warning: could not bind the network thread wakeup socket\n");
+        enet_socket_destroy(s_wakeupSocket);
+        s_wakeupSocket = ENET_SOCKET_NULL;
+        return;
+    }
+
+    s_wakeupAddress.host = address.host;
+    s_wakeupAddress.port = ntohs(sin.sin_port);
+}
+
+
+static void sendWakeup() {
+    uint8 byte = 0;
+    ENetBuffer buffer;
+    buffer.data = &byte;
+    buffer.dataLength = 1;
+    enet_socket_send(s_wakeupSocket, &s_wakeupAddress, &buffer, 1);
+}
+
+
+/** Invoked after queueing a message so that the network thread sends it immediately */
+static void wakeNetworkThread() {
+    if ((s_wakeupSocket != ENET_SOCKET_NULL) && ! s_wakeupPending.exchange(true)) {
+        sendWakeup();
+    }
+}
+
+
 namespace _internal {
 class NetworkThread : public GThread {
 public:
@@ -458,14 +834,82 @@ public:
 
     NetworkThread() : GThread("G3D::NetworkThread"), keepGoing(1) {}
 
+#   ifdef G3D_WINDOWS
+        typedef WSAPOLLFD PollDescriptor;
+#   else
+        typedef struct pollfd PollDescriptor;
+#   endif
+
+    /** Blocks the network thread until some host's socket is readable, wakeNetworkThread() is 
+        invoked, or \a timeout milliseconds elapse.  Uses poll() rather than select(), which
+        cannot wait on descriptors numbered FD_SETSIZE or higher. */
+    static void waitForNetworkActivity(uint32 timeout) {
+        // Only the network thread waits, so the array is reused without locking
+        static Array<PollDescriptor> descriptorArray;
+        descriptorArray.fastClear();
+
+        const auto& add = [&](ENetSocket socket) {
+            PollDescriptor& d = descriptorArray.next();
+            d.fd      = socket;
+            d.events  = POLLIN;
+            d.revents = 0;
+        };
+
+        // The wakeup socket is always first
+        if (s_wakeupSocket != ENET_SOCKET_NULL) {
+            add(s_wakeupSocket);
+        }
+
+        s_allServerAndClientConnectionMutex.lock();
+        for (int i = 0; i < s_allServers.size(); ++i) {
+            const shared_ptr<NetServer>& s = s_allServers[i].lock();
+            if (notNull(s) && notNull(s->m_enetHost)) {
+                add(s->m_enetHost->socket);
+            }
+        }
+        for (int i = 0; i < s_allClientConnections.size(); ++i) {
+            const shared_ptr<_internal::NetClientSideConnection>& c = s_allClientConnections[i].lock();
+            if (notNull(c) && notNull(c->m_enetHost)) {
+                add(c->m_enetHost->socket);
+            }
+        }
+
+        if (descriptorArray.size() == 0) {
+            s_allServerAndClientConnectionMutex.unlock();
+            System::sleep(timeout * units::milliseconds());
+            return;
+        }
+
+        // Hold the lock while waiting so that no host is destroyed while its socket is 
+        // being polled. NetworkLock wakes this thread before acquiring it.
+#       ifdef G3D_WINDOWS
+            const int numReady = WSAPoll(descriptorArray.getCArray(), ULONG(descriptorArray.size()), INT(timeout));
+#       else
+            const int numReady = poll(descriptorArray.getCArray(), nfds_t(descriptorArray.size()), int(timeout));
+#       endif
+
+        if ((numReady > 0) && (s_wakeupSocket != ENET_SOCKET_NULL) && (descriptorArray[0].revents & POLLIN)) {
+            uint8 data[64];
+            ENetBuffer buffer;
+            buffer.data = data;
+            buffer.dataLength = sizeof(data);
+            while (enet_socket_receive(s_wakeupSocket, NULL, &buffer, 1) > 0) {}
+        }
+        s_allServerAndClientConnectionMutex.unlock();
+    }
+
     virtual void threadMain() override {
         while (keepGoing.value() != 0) {
+            // Clear before servicing, so that any message queued after the send queues
+            // are drained triggers a new wakeup
+            s_wakeupPending = false;
 
             serviceNetwork();
 
-            // Yield, since we can't access enet's internal select() call to make it process
-            // multiple hosts at once and sleep until one is needed
-            System::sleep(0);
+            if (keepGoing.value() != 0) {
+                // Sleep until there is work, rather than polling
+                waitForNetworkActivity(MAX_NETWORK_THREAD_WAIT_MILLISECONDS);
+            }
         }
     }
 };}
@@ -513,6 +957,7 @@ static GMutex s_networkThreadMutex;
 static void maybeStartNetworkThread() {
 	s_networkThreadMutex.lock();
     if (isNull(s_networkThread) && _internal::g3dInitializationSpecification().threadedNetworking) {
+        createWakeupSocket();
         s_networkThread = shared_ptr<_internal::NetworkThread>(new _internal::NetworkThread());
         s_networkThread->start();
     }
@@ -524,11 +969,20 @@ namespace _internal {
 void cleanupNetwork() {
     if (notNull(s_networkThread)) {
         s_networkThread->keepGoing = 0;
+        if (s_wakeupSocket != ENET_SOCKET_NULL) {
+            sendWakeup();
+        }
+
         // Wait for the thread to shut down
-        System::sleep(5 * units::milliseconds());
+        s_networkThread->waitForCompletion();
         s_networkThread.reset();
     }
 
+    if (s_wakeupSocket != ENET_SOCKET_NULL) {
+        enet_socket_destroy(s_wakeupSocket);
+        s_wakeupSocket = ENET_SOCKET_NULL;
+    }
+
 #   ifdef G3D_WINDOWS
         // End request millisecond accuracy on timers for enet
         timeEndPeriod(1);
@@ -568,13 +1022,22 @@ static Table<ENetPacket*, _internal::NetworkCallbackInfo>& callbackTable() {
 }
 
 
+/** Protects callbackTable(), which is written by application threads in send() and
+    read by the network thread when enet releases a packet */
+static Spinlock s_callbackTableLock;
+
+
 /** Registered callback for all ENet packets with a memory manager.  This is how ENet tells us 
     that it has processed a packet and we are allowed to free the data. */
 void freePacketDataCallback(_ENetPacket* packet) {
     ENetPacket* ignore = NULL;
 
     _internal::NetworkCallbackInfo callbackInfo;
-    if (callbackTable().getRemove(packet, ignore, callbackInfo)) {
+    s_callbackTableLock.lock();
+    const bool found = callbackTable().getRemove(packet, ignore, callbackInfo);
+    s_callbackTableLock.unlock();
+
+    if (found) {
         callbackInfo.connection->m_freeQueue.pushBack(callbackInfo);
     } else {
         debugPrintf("Warning: tried to free a packet that had no callback registered\n");
@@ -591,7 +1054,9 @@ void NetSendConnection::processFreeQueue() {
 
 
 void addCallback(const shared_ptr<NetSendConnection>& conn, ENetPacket* packet, const shared_ptr<MemoryManager>& manager, const void* data) {
+    s_callbackTableLock.lock();
     callbackTable().set(packet, _internal::NetworkCallbackInfo(conn, manager, data));
+    s_callbackTableLock.unlock();
 }
 
 
@@ -608,7 +1073,7 @@ shared_ptr<NetServer> NetServer::create
     maybeStartNetworkThread();
     // Lock the entire system.  Grabbing this lock intentionally prevents serviceNetwork() from making progress or 
     // trying to access any clients.
-    GMutexLock lock(&s_allServerAndClientConnectionMutex);
+    NetworkLock lock;
 
     _ENetAddress addr = toENetAddress(myAddress);
     _ENetHost* host = enet_host_create(&addr, maxClients, numChannels,
@@ -637,7 +1102,7 @@ NetServer::~NetServer() {
 void NetServer::stop() {
     // Lock the entire system.  Grabbing this lock intentionally prevents serviceNetwork() from making progress or 
     // trying to access any clients.
-    GMutexLock lock(&s_allServerAndClientConnectionMutex);
+    NetworkLock lock;
 
     // Shut down all connections.  Can't iterate through the table
     // because events received could cause modification of that table.
@@ -667,8 +1132,56 @@ void NetServer::stop() {
 }
 
 
+namespace _internal {
+class PendingMessage {
+public:
+    NetSendQueue::Node*     node;
+    NetSendConnection*      connection;
+    PendingMessage() : node(NULL), connection(NULL) {}
+    PendingMessage(NetSendQueue::Node* n, NetSendConnection* c) : node(n), connection(c) {}
+};}
+
+
+void NetServer::sendQueuedMessages() {
+    // Only accessed while holding the network lock
+    static Array<_internal::PendingMessage> pending;
+    pending.fastClear();
+
+    // Gather from the omniConnection and all clients
+    NetSendConnection* omni = m_omniConnection.get();
+    for (_internal::NetSendQueue::Node* node = omni->m_sendQueue->popFront(); notNull(node); node = omni->m_sendQueue->popFront()) {
+        pending.append(_internal::PendingMessage(node, omni));
+    }
+    for (ClientTable::Iterator it = m_client.begin(); it.isValid(); ++it) {
+        // Cast to the base class, of which NetServer is a friend
+        NetSendConnection* c = it->value.get();
+        if (c->readyToSend()) {
+            for (_internal::NetSendQueue::Node* node = c->m_sendQueue->popFront(); notNull(node); node = c->m_sendQueue->popFront()) {
+                pending.append(_internal::PendingMessage(node, c));
+            }
+        }
+    }
+
+    if (pending.size() > 0) {
+        // A broadcast must not overtake a message sent earlier to an individual client, or vice versa
+        pending.sort([](const _internal::PendingMessage& a, const _internal::PendingMessage& b) {
+            return a.node->sequence < b.node->sequence;
+        });
+
+        const RealTime now = System::time();
+        for (int i = 0; i < pending.size(); ++i) {
+            NetSendConnection* c = pending[i].connection;
+            transmit(m_enetHost, c->m_enetPeer, *c->m_sendQueue, pending[i].node, now);
+        }
+        enet_host_flush(m_enetHost);
+    }
+}
+
+
 void NetServer::serviceHost() {
     alwaysAssertM(notNull(m_enetHost), "Cannot perform more actions after NetServer::stop()");
+
+    sendQueuedMessages();
    
     ENetEvent event;
     int result = 0;
@@ -689,7 +1202,7 @@ void NetServer::serviceHost() {
             {
                 const shared_ptr<_internal::NetServerSideConnection>& client = m_client[event.peer];
                 // Insert into the appropriate queue
-                client->m_netMessageIterator.m_queue->halfPushBack(event.packet);  
+                client->m_netMessageIterator.m_queue->halfPushBack(event.packet, event.channelID);  
                 client->updateLatencyEstimate();
             }
             break;
@@ -712,67 +1225,145 @@ void NetServer::serviceHost() {
     debugAssert(result == 0);
 }
 
+NetStatistics NetServer::statistics() const {
+    // Clients are added and removed by the network thread while holding this lock
+    NetworkLock lock;
+
+    NetStatistics total = m_omniConnection->statistics();
+    RealTime totalSendDelay = total.meanSendDelay * double(total.messagesSent);
+    RealTime totalLatency = 0;
+
+    for (ClientTable::Iterator it = m_client.begin(); it.isValid(); ++it) {
+        const NetStatistics& s = it->value->statistics();
+        total.messagesSent      += s.messagesSent;
+        total.bytesSent         += s.bytesSent;
+        total.messagesReceived  += s.messagesReceived;
+        total.bytesReceived     += s.bytesReceived;
+        total.messagesQueued    += s.messagesQueued;
+        total.maxSendDelay       = max(total.maxSendDelay, s.maxSendDelay);
+        totalSendDelay          += s.meanSendDelay * double(s.messagesSent);
+        totalLatency            += s.latency;
+    }
+
+    if (total.messagesSent > 0) {
+        total.meanSendDelay = totalSendDelay / double(total.messagesSent);
+    }
+    if (m_client.size() > 0) {
+        total.latency = totalLatency / double(m_client.size());
+    }
+
+    return total;
+}
+
 /////////////////////////////////////////////////////////////////////////
 
-/** \sa NetMessageQueue::halfPushBack */
-static ENetPacket* makeHeader(NetMessageType type, NetChannel channel, BinaryOutput& userData) {
-    if (userData.size() == 0) {
-        uint32 data[2];
-        data[0] = htonl(type);
-        data[1] = htonl(channel);
-        return enet_packet_create(data, sizeof(data), ENET_PACKET_FLAG_RELIABLE);
-    } else {
-        // Copy the data to insert the header
-        const size_t dataSize = size_t(8 + userData.size());
-        ENetPacket* packet = enet_packet_create(NULL, dataSize, ENET_PACKET_FLAG_RELIABLE);
+/** Creates the packet that precedes the \a numParts data packets of a message.
+    \sa NetMessageQueue::halfPushBack */
+static ENetPacket* makeHeader(NetMessageType type, NetChannel channel, int numParts, const void* userHeader, size_t userHeaderSize) {
+    debugAssertM(channel < (1 << PART_COUNT_SHIFT), "Channel out of range");
+    debugAssertM(numParts >= 1, "A message must have at least one part");
 
-        uint32* data = (uint32*)(packet->data);
-        data[0] = htonl(type);
-        data[1] = htonl(channel);
+    ENetPacket* packet = enet_packet_create(NULL, G3D_HEADER_SIZE + userHeaderSize, ENET_PACKET_FLAG_RELIABLE);
 
-        // Copy the data into the packet, starting 2 x uint32 in
-        userData.commit((uint8*)(data + 2));
+    uint32* data = reinterpret_cast<uint32*>(packet->data);
+    data[0] = htonl(type);
+    data[1] = htonl(uint32(channel) | (uint32(numParts - 1) << PART_COUNT_SHIFT));
 
-        return enet_packet_create(data, dataSize, ENET_PACKET_FLAG_RELIABLE);
+    if (userHeaderSize > 0) {
+        System::memcpy(data + 2, userHeader, userHeaderSize);
     }
+
+    return packet;
 }
 
 
-void NetSendConnection::send(NetMessageType type, const void* bytes, size_t size, BinaryOutput& header, NetChannel channel, const shared_ptr<MemoryManager>& memoryManager) {
+void NetSendConnection::send(NetMessageType type, const NetBufferView& header, const NetBufferView* payload, int numPayloadViews, NetChannel channel) {
     beforeSend();
-
     debugAssert(notNull(m_enetHost));
-    const uint32 extraFlags = isNull(memoryManager) ? 0 : ENET_PACKET_FLAG_NO_ALLOCATE;
-    ENetPacket* packet = enet_packet_create(bytes, size, ENET_PACKET_FLAG_RELIABLE | extraFlags);
+    debugAssert(numPayloadViews >= 0);
 
-    // Register the callback (in a threadsafe way) before calling
-    if (notNull(memoryManager)) {
-        packet->freeCallback = &freePacketDataCallback;
-        addCallback(dynamic_pointer_cast<NetSendConnection>(shared_from_this()), packet, memoryManager, bytes);
+    // Sending zero views sends one empty part, so that every message has a data packet
+    const NetBufferView empty;
+    if (numPayloadViews == 0) {
+        payload = &empty;
+        numPayloadViews = 1;
     }
 
-    sendQueue().pushBack(_internal::NetMessage(packet,  makeHeader(type, channel, header), m_enetPeer, m_enetHost));
+    _internal::NetMessage message(makeHeader(type, channel, numPayloadViews, header.data, header.size));
+    if (notNull(header.memoryManager)) {
+        // The header was copied, so the application's memory can be released now
+        header.memoryManager->free(const_cast<void*>(header.data));
+    }
+
+    for (int i = 0; i < numPayloadViews; ++i) {
+        const NetBufferView& view = payload[i];
+        if (isNull(view.memoryManager)) {
+            message.attach(enet_packet_create(view.data, view.size, ENET_PACKET_FLAG_RELIABLE));
+        } else {
+            ENetPacket* packet = enet_packet_create(view.data, view.size, ENET_PACKET_FLAG_RELIABLE | ENET_PACKET_FLAG_NO_ALLOCATE);
+
+            // Register the callback (in a threadsafe way) before queuing
+            packet->freeCallback = &freePacketDataCallback;
+            addCallback(dynamic_pointer_cast<NetSendConnection>(shared_from_this()), packet, view.memoryManager, view.data);
+            message.attach(packet);
+        }
+    }
+
+    m_sendQueue->pushBack(message);
+    wakeNetworkThread();
 }
 
 
-static BinaryOutput emptyHeader;
+void NetSendConnection::send(NetMessageType type, const void* bytes, size_t size, BinaryOutput& header, NetChannel channel, const shared_ptr<MemoryManager>& memoryManager) {
+    const NetBufferView payload(bytes, size, memoryManager);
+    send(type, NetBufferView(header), &payload, 1, channel);
+}
+
 
 void NetSendConnection::send(NetMessageType type, const void* bytes, size_t size, NetChannel channel, const shared_ptr<MemoryManager>& memoryManager) {
-    send(type, bytes, size, emptyHeader, channel, memoryManager);
+    const NetBufferView payload(bytes, size, memoryManager);
+    send(type, NetBufferView(), &payload, 1, channel);
 }
 
 
 void NetSendConnection::send(NetMessageType type, BinaryOutput& bo, NetChannel channel) {
-    send(type, bo, emptyHeader, channel);
+    const NetBufferView payload(bo);
+    send(type, NetBufferView(), &payload, 1, channel);
 }
 
 
 void NetSendConnection::send(NetMessageType type, BinaryOutput& bo, BinaryOutput& header, NetChannel channel) {
-    beforeSend();
-    ENetPacket* packet = enet_packet_create(NULL, size_t(bo.size()), ENET_PACKET_FLAG_RELIABLE);
-    bo.commit(packet->data);
+    const NetBufferView payload(bo);
+    send(type, NetBufferView(header), &payload, 1, channel);
+}
+
+
+bool NetSendConnection::readyToSend() const {
+    // enet drops packets sent before the connection is established, so hold them until then
+    return notNull(m_enetHost) && (isNull(m_enetPeer) || (m_enetPeer->state == ENET_PEER_STATE_CONNECTED));
+}
+
+
+bool NetSendConnection::processSendQueue() {
+    if (! readyToSend()) {
+        return false;
+    }
+
+    const RealTime now = System::time();
+    bool sent = false;
+    for (_internal::NetSendQueue::Node* node = m_sendQueue->popFront(); notNull(node); node = m_sendQueue->popFront()) {
+        transmit(m_enetHost, m_enetPeer, *m_sendQueue, node, now);
+        sent = true;
+    }
 
-    sendQueue().pushBack(_internal::NetMessage(packet,  makeHeader(type, channel, header), m_enetPeer, m_enetHost));
+    return sent;
+}
+
+
+NetStatistics NetSendConnection::statistics() const {
+    NetStatistics s;
+    m_sendQueue->getStatistics(s);
+    return s;
 }
 
 
@@ -791,14 +1382,38 @@ NetMessageIterator::NetMessageIterator() :
 /** Size of the data in bytes. */
 size_t NetMessageIterator::size() const {
     alwaysAssertM(isValid(), "Not a valid message!");
-    return m_queue->packet()->dataLength;
+    return m_queue->messageSize();
 }
 
 
 /** The raw data bytes. */
 void* NetMessageIterator::data() const {
     alwaysAssertM(isValid(), "Not a valid message!");
-    return m_queue->packet()->data;
+    return m_queue->data();
+}
+
+
+int NetMessageIterator::numParts() const {
+    alwaysAssertM(isValid(), "Not a valid message!");
+    return m_queue->numParts();
+}
+
+
+size_t NetMessageIterator::partSize(int part) const {
+    alwaysAssertM(isValid(), "Not a valid message!");
+    return m_queue->part(part)->dataLength;
+}
+
+
+void* NetMessageIterator::partData(int part) const {
+    alwaysAssertM(isValid(), "Not a valid message!");
+    return m_queue->part(part)->data;
+}
+
+
+BinaryInput& NetMessageIterator::partBinaryInput(int part) const {
+    alwaysAssertM(isValid(), "Not a valid message!");
+    return m_queue->partBinaryInput(part);
 }
 
 
@@ -850,6 +1465,12 @@ static float intToFloat(int32 i) {
 }
 
 
+NetSendConnection::NetSendConnection(_ENetPeer* p, _ENetHost* h) : 
+    m_enetPeer(p), 
+    m_enetHost(h), 
+    m_sendQueue(new _internal::NetSendQueue()) {}
+
+
 NetConnection::NetConnection(_ENetPeer* peer, _ENetHost* host) : 
     NetSendConnection(peer, host), 
     m_status(WAITING_TO_CONNECT),
@@ -902,6 +1523,14 @@ RealTime NetConnection::latencyVariance() const {
 }
 
 
+NetStatistics NetConnection::statistics() const {
+    NetStatistics s = NetSendConnection::statistics();
+    m_netMessageIterator.m_queue->getStatistics(s);
+    s.latency = latency();
+    return s;
+}
+
+
 shared_ptr<NetConnection> NetConnection::connectToServer
     (const NetAddress&                 server, 
      uint32                            numChannels, 
@@ -914,7 +1543,7 @@ shared_ptr<NetConnection> NetConnection::connectToServer
 
     // Lock the entire system.  Grabbing this lock intentionally prevents serviceNetwork() from making progress or 
     // trying to access any clients.
-    s_allServerAndClientConnectionMutex.lock();
+    NetworkLock lock;
     ENetHost* host = enet_host_create(NULL, 1, numChannels, (enet_uint32)incomingBytesPerSecondThrottle, (enet_uint32)outgoingBytesPerSecondThrottle);
     
     const _ENetAddress addr = toENetAddress(server);
@@ -924,7 +1553,6 @@ shared_ptr<NetConnection> NetConnection::connectToServer
     connection->m_netMessageIterator.m_connection = connection;
 
     s_allClientConnections.append(connection);
-    s_allServerAndClientConnectionMutex.unlock();
 
     return connection;
 }
@@ -982,7 +1610,7 @@ void NetConnection::debugPrintPeerAndHost() {
 void NetConnection::disconnect(bool waitForOtherSide) {
     // Lock the entire system.  Grabbing this lock intentionally prevents serviceNetwork() from making progress or 
     // trying to access any clients.
-    GMutexLock lock(&s_allServerAndClientConnectionMutex);
+    NetworkLock lock;
 
     if (m_status.value() == DISCONNECTED) {
         // Note that if this is a NetServerSideConnection, then the 
@@ -992,18 +1620,28 @@ void NetConnection::disconnect(bool waitForOtherSide) {
         return;
     }
 
+    // Messages already sent by the application go out before the disconnect request
+    if (processSendQueue()) {
+        enet_host_flush(m_enetHost);
+    }
+
     if (waitForOtherSide) {
         m_status = WAITING_TO_DISCONNECT;
         enet_peer_disconnect_later(m_enetPeer, 0);
         enet_host_flush(m_enetHost);
         serviceHost();
     } else {
-        // Force immediate disconnect (although make a last attempt to service the host)
+        // Force immediate disconnect (although make a last attempt to service the host).
+        // Servicing may observe the other side's disconnection and release the host.
         serviceHost();
-        enet_peer_disconnect_now(m_enetPeer, 0);
-        enet_host_flush(m_enetHost);
-        serviceHost();
-        enet_peer_reset(m_enetPeer);
+        if (notNull(m_enetHost)) {
+            enet_peer_disconnect_now(m_enetPeer, 0);
+            enet_host_flush(m_enetHost);
+            serviceHost();
+        }
+        if (notNull(m_enetHost)) {
+            enet_peer_reset(m_enetPeer);
+        }
         m_enetHost = NULL;
         m_status = DISCONNECTED;
     }
@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu, Michael Mara, http://illuminationcodified.com
  \created 2011-07-19
- \edited  2016-03-12
+ \edited  2026-10-17
 
   G3D Library http://g3d.cs.williams.edu
   Copyright 2000-2016, Morgan McGuire morgan@cs.williams.edu
@@ -34,6 +34,7 @@
 #include "GLG3D/UniformTable.h"
 #include "G3D/TextOutput.h"
 #include "G3D/ParseOBJ.h"
+#include "G3D/GMutex.h"
 
 namespace G3D {
 
@@ -46,6 +47,7 @@ namespace _internal {
     class AssimpNodesToArticulatedModelParts;
 }
 class AMIntersector;
+class TriTree;
 /**
  \brief A 3D object composed of multiple rigid triangle meshes connected by joints.
 
@@ -660,7 +662,8 @@ Example:
 
         AABox                       boxBounds;
 
-        /** If you modify cpuVertexArray, invoke this method to force the GPU arrays to update on the next ArticulatedMode::pose() */
+        /** If you modify cpuVertexArray, invoke this method to force the GPU arrays to update on the next ArticulatedMode::pose().
+            This also invalidates the Mesh trees that ArticulatedModel::intersect() caches. */
         void clearAttributeArrays();
 
         void determineCleaningNeeds(bool& computeSomeNormals, bool& computeSomeTangents);
@@ -669,7 +672,29 @@ Example:
 
     private:
 
-        Geometry(const String& name) : name(name) {}
+        /** Seconds spent in each phase of the most recent cleanGeometry() call, which
+            ArticulatedModel::cleanGeometry() sums over all Geometry when profiling */
+        class CleanGeometryTimes {
+        public:
+            RealTime                prepare;
+            RealTime                buildFaceArray;
+            RealTime                computeNormals;
+            RealTime                mergeVertices;
+            RealTime                computeTangents;
+            RealTime                computeBounds;
+
+            CleanGeometryTimes() : prepare(0), buildFaceArray(0), computeNormals(0), mergeVertices(0), computeTangents(0), computeBounds(0) {}
+        };
+
+        /** Incremented by clearAttributeArrays(), so that Meshes can detect out of date trees */
+        int                         m_changeCount;
+
+        CleanGeometryTimes          m_cleanGeometryTimes;
+
+        Geometry(const String& name) : name(name), m_changeCount(0) {}
+
+        /** Data-parallel version of mergeVertices() for large face arrays, with identical output */
+        void mergeVerticesParallel(const Array<Face>& faceArray, float maxNormalWeldAngle);
 
         void copyToGPU(ArticulatedModel* model);
     };
@@ -732,8 +757,18 @@ Example:
         void clearIndexStream();
 
     private:
+
+        /** Object-space tree over this mesh's triangles, built on
+            demand by ArticulatedModel::intersect() and shared by
+            every Entity that instances the model. Tri i of the tree
+            is triangle i of cpuIndexArray.  The tree holds a copy of only
+            the Geometry vertices that this mesh references. */
+        shared_ptr<TriTree>                     m_triTree;
+
+        /** Value of Geometry::m_changeCount when m_triTree was built */
+        int                                     m_triTreeChangeCount;
         
-        Mesh(const String& n, Part* p, Geometry* geom, int ID) : name(n), logicalPart(p), geometry(geom), primitive(PrimitiveType::TRIANGLES), twoSided(false), uniqueID(ID) {
+        Mesh(const String& n, Part* p, Geometry* geom, int ID) : name(n), logicalPart(p), geometry(geom), primitive(PrimitiveType::TRIANGLES), twoSided(false), uniqueID(ID), m_triTreeChangeCount(0) {
             contributingJoints.append(p);
         }
 
@@ -1095,6 +1130,15 @@ protected:
        only noneempty when loaded from an OBJ */
     Array<String>              m_mtlArray;
 
+    /** Guards Mesh::m_triTree for concurrent intersect() calls */
+    GMutex                          m_triTreeMutex;
+
+    /** Returns the cached object-space tree for a rigid \a mesh,
+        building it if it is missing or out of date. Used by intersect().
+        Thread-safe; the result stays valid even if another thread
+        replaces the cached tree. */
+    shared_ptr<TriTree> meshTriTree(Mesh* mesh);
+
     int getID() {
         ++m_nextID;
         return m_nextID - 1;
@@ -1152,6 +1196,25 @@ protected:
 
     void load(const Specification& specification);
 
+    /** Reads the format written by speedSerialize into this empty model */
+    void speedDeserialize(BinaryInput& b);
+
+    /** True if every material can be recreated from its UniversalMaterial::Specification,
+        which speedSerialize requires. */
+    bool supportsSpeedLoad() const;
+
+    /** Returns the empty string if the SpeedLoad cache is disabled */
+    static String speedLoadCacheFilename(const Specification& specification);
+
+    /** The files whose modification invalidates the cache for this model: the
+        model itself and any OBJ material libraries. */
+    void getSourceFilenames(const Specification& specification, Array<String>& filenames) const;
+
+    /** Returns false without modifying this model if \a cacheFilename is missing or stale */
+    bool loadFromSpeedLoadCache(const Specification& specification, const String& cacheFilename);
+
+    void saveToSpeedLoadCache(const Specification& specification, const String& cacheFilename) const;
+
     ArticulatedModel() : m_nextID(1) {}
 
     Mesh* mesh(const Instruction::Identifier& mesh);
@@ -1240,6 +1303,33 @@ public:
     /** \copydoc create */
     static lazy_ptr<Model> lazyCreate(const Specification& s, const String& name = "");
 
+    /** Writes the fully processed parts, geometry, meshes, bones, and
+        animations in a binary format that speedCreate can read without
+        parsing or cleaning geometry. Materials are stored as their
+        UniversalMaterial::Specification, so their textures are still
+        loaded from the original image files.
+
+        Like all SpeedLoad formats, the result is only intended for the
+        machine that wrote it.
+
+        \sa setSpeedLoadCacheDirectory */
+    void speedSerialize(BinaryOutput& b) const;
+
+    /** \copydoc speedSerialize */
+    static shared_ptr<ArticulatedModel> speedCreate(BinaryInput& b);
+
+    /** When not empty, create() stores each model that it loads from a file in
+        this directory in the speedSerialize format, keyed by the Specification,
+        and loads later requests for the same Specification from there as long
+        as the source files have not changed. Models with materials that cannot
+        be serialized are not cached.
+
+        Default is the empty string, which disables the cache. */
+    static void setSpeedLoadCacheDirectory(const String& directory);
+
+    /** \copydoc setSpeedLoadCacheDirectory */
+    static const String& speedLoadCacheDirectory();
+
     static shared_ptr<ArticulatedModel> fromFile(const String& filename) {
         Specification s;
         s.filename = filename;
@@ -1372,7 +1462,9 @@ public:
     void scaleWholeModel(float scaleFactor);
 
     /** 
-      Invokes Part::cleanGeometry on all meshes.       
+      Invokes Geometry::cleanGeometry on all Geometry, in parallel.
+      Very large Geometry are also cleaned with data-parallel kernels.
+      The result is independent of the number of threads.
      */
     void cleanGeometry(const CleanGeometrySettings& settings = CleanGeometrySettings());
 
@@ -1416,8 +1508,18 @@ public:
        The barycentric coordinate of vertex <code>triStartIndex + 2</code>
        is <code>1 - u - v</code>.
 
-       This is primarily intended for mouse selection.  For ray tracing
-       or physics, consider G3D::TriTree instead.
+       Meshes attached to a single joint are intersected using a
+       G3D::TriTree over their object-space triangles that is built on
+       the first call and cached in the model, so that each call costs
+       time logarithmic in the number of triangles and moving an Entity
+       never rebuilds it.  Invoke Geometry::clearAttributeArrays() or
+       Mesh::clearIndexStream() after editing the CPU geometry to
+       invalidate the cache.  Skinned meshes are tested triangle by
+       triangle.
+
+       This is primarily intended for mouse selection and game queries.
+       For rendering by ray tracing, construct a G3D::TriTree over the
+       whole posed scene instead.
 
        Does not overwrite the arguments unless there is a hit closer than maxDistance.
      */
@@ -1436,9 +1538,9 @@ public:
     void getBoundingBox(AABox& box);
 
     virtual const String& className() const override;
-
-    /** Saves C++ code for generating the geometry of mesh[0] */
-    void saveGeometryAsCode(const String& filename, bool compress = false);
+
+    /** Saves C++ code for generating the geometry of mesh[0] */
+    void saveGeometryAsCode(const String& filename, bool compress = false);
 
 };
 
@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \created 2009-02-19
- \edited  2015-09-24
+ \edited  2026-10-17
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -89,6 +89,8 @@ public:
             a table of texture and settings */
         Specification(const Any& any);
 
+        Any toAny() const;
+
         bool operator==(const Specification& other) const;
 
         bool operator!=(const Specification& other) const {
@@ -390,6 +390,9 @@ public:
         This is always at least as tight as the AABox bounds and often tighter.*/
     virtual void getLastBounds(class Box& box) const;
 
+    /** Return an axis-aligned bounding box in the space of frame() as of the last call to onPose(). */
+    virtual void getLastObjectSpaceBounds(class AABox& box) const;
+
     /** Returns true if there is conservatively some intersection
         with the object's bounds closer than \a maxDistance to the
         ray origin.  If so, updates maxDistance with the intersection distance.
@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2015-08-30
-  \edited  2016-02-22
+  \edited  2026-10-17
  
  G3D Library http://g3d.cs.williams.edu
  Copyright 2000-2016, Morgan McGuire morgan@cs.williams.edu
@@ -388,7 +388,8 @@ protected:
     ParticleSystem();
 
     /** Computes net forces from the brownian, wind, and gravity values and then 
-        applies euler integration to the particles. */
+        applies euler integration to the particles. Blocks of particles are
+        processed by integrateParticles() on ThreadPool workers. */
     virtual void applyPhysics(float t, float dt);
 
     /** Called by onPose */
@@ -403,6 +404,22 @@ protected:
     void spawnParticles(SimTime absoluteTime, SimTime deltaTime);
 
 public:
+
+    /** Euler integration of gravity, wind, Brownian motion, and drag for
+        <code>particle[0...count - 1]</code>, as used by applyPhysics().
+
+        Groups of four particles are transposed into one SSE register per
+        component (structure-of-arrays form) so that the noise, drag, and 
+        integration run four wide; the remainder are integrated one at a time.
+        Threadsafe for disjoint ranges of particles. */
+    static void integrateParticles
+    (Particle*                      particle,
+     int                            count,
+     const Vector3&                 gravitationalAcceleration,
+     const Vector3&                 windVelocity,
+     float                          maxBrownianVelocity,
+     int                            brownianTemporalOffset,
+     float                          dt);
     
     /** For deserialization from Any / loading from file */
     static shared_ptr<Entity> create 
@@ -3,7 +3,7 @@
   @author Morgan McGuire, http://graphics.cs.williams.edu
   
  @created 2009-01-01
- @edited  2013-07-14
+ @edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -29,12 +29,41 @@ namespace G3D {
 /** 
     \brief Measures execution time of CPU and GPU events across multiple threads.
 
+    Recording is designed for instrumenting hot loops.  Each call site
+    of BEGIN_PROFILER_EVENT interns its name, file, and line once as an
+    EventID.  beginEvent() and endEvent() then only append a small record
+    to a preallocated per-thread ring buffer, without locking or allocating.
+    nextFrame() drains the rings and assembles the event trees returned by
+    getEvents().  An event that is still open when nextFrame() is invoked
+    appears in the following frame.  When a thread's ring is full, new events
+    on it are dropped (see numDroppedEvents() and setEventBufferSize()).
+
+    For headless profiling, startTraceCapture() and stopTraceCapture()
+    save the events of every frame between them in the Chrome trace event
+    JSON format, which can be viewed with chrome://tracing or
+    https://ui.perfetto.dev.
+
+    \code
+    Profiler::setEnabled(true);
+    Profiler::startTraceCapture();
+    for (int frame = 0; frame < 100; ++frame) {
+        BEGIN_PROFILER_EVENT("Simulate");
+        ...
+        END_PROFILER_EVENT();
+        Profiler::nextFrame();
+    }
+    Profiler::stopTraceCapture("trace.json");
+    \endcode
+
     \beta
 
  */
 class Profiler {
 public:
 
+    /** Identifies an interned event call site.  \sa internEvent */
+    typedef int EventID;
+
     /**
       May have child Events.
      */
@@ -66,13 +95,16 @@ public:
 
         int             m_level;
 
+        /** True for the "other" event that holds the time of a parent not accounted for by its children */
+        bool            m_unaccounted;
+
     public:
 
         /** For the root's parent */
         enum { NONE = -1 };
 
         Event() : m_line(0), m_hash(0), m_gfxStart(nan()), m_gfxEnd(nan()), m_cpuStart(nan()), m_cpuEnd(nan()), m_numChildren(0),
-            m_parentIndex(NONE), m_openGLStartID(GL_NONE), m_openGLEndID(GL_NONE),   m_level(0) {
+            m_parentIndex(NONE), m_openGLStartID(GL_NONE), m_openGLEndID(GL_NONE),   m_level(0), m_unaccounted(false) {
         }
 
         /** Tree level, 0 == root.  This information can be inferred from the tree structure but
@@ -154,38 +186,33 @@ public:
     };
 
 private:
-    
-    /** Per-thread profiling information */
-    class ThreadInfo {
-    public:
-        /** GPU query objects available for use.*/
-        Array<GLuint>                       queryFreelist;
-    
-        /** Full tree of all events for the current frame on the current thread */
-        Array<Event>                        eventTree;
 
-        /** Indices of the ancestors of the current event, in m_taskTree */
-        Array<int>                          ancestorStack;
-
-        /** Full tree of events for the previous frame */
-        Array<Event>                        previousEventTree;
+    /** Name, location, and hash of an interned call site. Never deallocated. */
+    class EventDescription;
+    
+    /** Per-thread ring buffer and event trees. Defined in Profiler.cpp. */
+    class ThreadInfo;
 
-        void beginEvent(const String& name, const String& file, int line, const size_t baseHash, const String& hint = "");
+    /** Information about the current thread. Initialized by beginEvent */
+    static __thread ThreadInfo*             s_threadInfo;
 
-        void endEvent();
+    /** Stores information about all threads for the current frame */
+    static Array<shared_ptr<ThreadInfo> >   s_threadInfoArray;
 
-        GLuint newQueryID();
+    /** Indexed by EventID.  Protected by s_profilerMutex. */
+    static Array<EventDescription*>         s_eventDescriptionArray;
 
-        ~ThreadInfo();
-    };
+    /** Capacity of rings allocated after the last setEventBufferSize() call */
+    static int                              s_eventBufferSize;
 
-    /** Information about the current thread. Initialized by beginEvent */
-    static __thread shared_ptr<ThreadInfo>* s_threadInfo;
+    /** Events dropped in nextFrame() because a ring was full */
+    static int                              s_numDroppedEvents;
 
-    static __thread int                     s_level;
+    /** Events latched by nextFrame() since startTraceCapture(), or NULL when not capturing */
+    static Array<Event>*                    s_traceCapture;
 
-    /** Stores information about all threads for the current frame */
-    static Array<shared_ptr<ThreadInfo> >   s_threadInfoArray;
+    /** Thread of each event in s_traceCapture */
+    static Array<int>                       s_traceCaptureThread;
 
     static GMutex                           s_profilerMutex;
 
@@ -199,6 +226,12 @@ private:
 
     static int calculateUnaccountedTime(Array<Event>& eventTree, const int index, RealTime& cpuTime, RealTime& gpuTime);
 
+    /** Returns the ThreadInfo for the current thread, creating it if needed */
+    static ThreadInfo* threadInfo();
+
+    /** Requires s_profilerMutex to be held */
+    static EventID internEventLocked(const String& name, const String& file, int line);
+
     /** Prevent allocation using this private constructor */
     Profiler() {}
 
@@ -235,13 +268,61 @@ public:
     /** \copydoc enabled() */
     static void setEnabled(bool e);
 
+    /** Returns the EventID for a call site, creating it on the first call.
+        This acquires a lock, so call it once per call site and store the result,
+        as BEGIN_PROFILER_EVENT does. */
+    static EventID internEvent(const String& name, const String& file, int line);
+
     /** Calls to beginEvent may be nested on a single thread. Events on different
-        threads are tracked independently.*/
+        threads are tracked independently.
+
+        Does not lock or allocate memory after the first event on each thread. */
+    static void beginEvent(EventID id);
+
+    /** \copydoc beginEvent(EventID)
+
+        \param hint Additional text for this instance of the event, e.g., the arguments
+        of a shader launch. Copying it may allocate if it is longer than the
+        String's internal buffer. */
+    static void beginEvent(EventID id, const String& hint);
+
+    /** Interns the event on every call through a per-thread cache. Prefer
+        beginEvent(EventID) with a static EventID when the name is constant.
+        \a baseHash is ignored and is retained for compatibility. */
     static void beginEvent(const String& name, const String& file, int line, const size_t baseHash, const String& hint = "");
     
     /** Ends the most recent pending event on the current thread. */
     static void endEvent();
 
+    /** Sets the number of begin and end records in each per-thread ring buffer,
+        rounded up to a power of two.  Only affects threads that have not yet
+        recorded an event. Default is 65536, which uses about 2 MB per thread. */
+    static void setEventBufferSize(int numRecords);
+
+    /** Number of events that were not recorded since the last call to
+        nextFrame() because a thread's ring buffer was full. An event that
+        has not ended by the time its thread fills the ring also causes
+        later events on that thread to be dropped. */
+    static int numDroppedEvents() {
+        return s_numDroppedEvents;
+    }
+
+    /** Begins saving the events latched by each subsequent nextFrame() call
+        for stopTraceCapture().  Discards any capture in progress. */
+    static void startTraceCapture();
+
+    /** Whether startTraceCapture() has been called without a matching stopTraceCapture() */
+    static bool traceCaptureActive() {
+        return notNull(s_traceCapture);
+    }
+
+    /** Writes the events captured since startTraceCapture() to \a filename as
+        Chrome trace event JSON, which chrome://tracing and the Perfetto UI load directly.
+        CPU events appear on one track per thread and GPU events on a separate process.
+        Times are in microseconds relative to the first captured event.
+        Does nothing if no capture is active. */
+    static void stopTraceCapture(const String& filename);
+
     /** Return all events from the previous frame, one array per thread. The underlying
         arrays will be mutated when nextFrame() is invoked.
 		
@@ -276,8 +357,8 @@ public:
    \sa END_PROFILER_EVENT, Profiler, Profiler::beginEvent
  */
 
-#define BEGIN_PROFILER_EVENT_WITH_HINT(eventName, hint) { static const String& _ProfilerEventName = (eventName); static const int _profilerHashBase = int(HashTrait<String>::hashCode(__FILE__)) + __LINE__; Profiler::beginEvent(_ProfilerEventName, __FILE__, __LINE__, _profilerHashBase, hint); }
-#define BEGIN_PROFILER_EVENT(eventName) { BEGIN_PROFILER_EVENT_WITH_HINT(eventName, "") }
+#define BEGIN_PROFILER_EVENT_WITH_HINT(eventName, hint) { static const ::G3D::Profiler::EventID _profilerEventID = ::G3D::Profiler::internEvent((eventName), __FILE__, __LINE__); ::G3D::Profiler::beginEvent(_profilerEventID, (hint)); }
+#define BEGIN_PROFILER_EVENT(eventName) { static const ::G3D::Profiler::EventID _profilerEventID = ::G3D::Profiler::internEvent((eventName), __FILE__, __LINE__); ::G3D::Profiler::beginEvent(_profilerEventID); }
 /** \def END_PROFILER_EVENT 
     \sa BEGIN_PROFILER_EVENT, Profiler, Profiler::endEvent
     */
@@ -14,6 +14,9 @@
 #include "G3D/Array.h"
 #include "G3D/SmallArray.h"
 #include "G3D/lazy_ptr.h"
+#include "G3D/AABoxTree.h"
+#include "G3D/GMutex.h"
+#include <atomic>
 #include "GLG3D/LightingEnvironment.h"
 #include "GLG3D/ArticulatedModel.h"
 
@@ -121,8 +124,51 @@ protected:
 
     shared_ptr<GFont>                   m_font;
 
+    /** An Entity in the acceleration structure for intersect() and intersectBounds() */
+    class IndexedEntity {
+    public:
+        shared_ptr<Entity>              entity;
+
+        /** Cached to avoid a dynamic cast per query */
+        bool                            isMarker;
+
+        IndexedEntity() : isMarker(false) {}
+        IndexedEntity(const shared_ptr<Entity>& e);
+    };
+
+    /** Top level of the two-level hierarchy used by intersect() and
+        intersectBounds(), over the world-space bounds of the Entitys
+        that had finite bounds when it was last updated.  The bottom
+        level is the TriTree that each ArticulatedModel caches per
+        mesh, which is shared by all instances of the model.
+
+        Rebuilt when Entitys are inserted or removed and refit when
+        they move.  Mutable because queries rebuild it on demand, under
+        m_entityTreeMutex so that concurrent queries may do so. */
+    mutable AABoxTree                   m_entityTree;
+
+    /** Entity for each member of m_entityTree */
+    mutable Array<IndexedEntity>        m_entityTreeArray;
+
+    /** Entitys with empty or infinite bounds, which every query tests */
+    mutable Array<IndexedEntity>        m_unboundedEntityArray;
+
+    /** True if m_entityTree must be rebuilt before the next query.
+        Cleared only after the rebuilt tree is complete, so that queries
+        that see false may read the tree without locking. */
+    mutable std::atomic<bool>           m_entityTreeNeedsRebuild;
+
+    /** Guards updates of m_entityTree, m_entityTreeArray, and m_unboundedEntityArray */
+    mutable GMutex                      m_entityTreeMutex;
+
     Scene(const shared_ptr<AmbientOcclusion>& ambientOcclusion);
 
+    /** Rebuilds m_entityTree if needed, and otherwise refits it to the
+        current bounds of the Entitys when \a refit is true.  Called from
+        onSimulation, onPose, and the intersection queries, which only
+        lock when a rebuild is pending. */
+    void updateEntityTree(bool refit) const;
+
     const shared_ptr<Entity> _entity(const String& name) const;
      
     /** If m_needEntitySort, sort Entitys to resolve dependencies and set m_needEntitySort = false. Called fromOnSimulation */
@@ -329,6 +375,10 @@ public:
         Note that this may not return the closest Entity if another's bounds
         project in front of it.
 
+        Entity%s are culled using a bounding volume hierarchy over
+        their bounds as of the last onSimulation() or onPose(), so
+        this takes time logarithmic in the number of Entity%s.
+
         \param ray World space ray
 
         \param distance Maximum distance at which to allow selection
@@ -346,6 +396,12 @@ public:
     /** Performs very precise (usually, ray-triangle) intersection, and is much slower
         than intersectBounds.  
 
+        Only Entity%s whose bounds as of the last onSimulation() or
+        onPose() are hit are tested, nearest first.  An Entity that
+        has moved since then may be missed.  Rigid ArticulatedModel
+        meshes are tested against cached trees, so the total cost is
+        logarithmic in both the number of Entity%s and triangles.
+
         \param intersectMarkers If true, allow MarkerEntity instances
         to be intersected.  Default is false.
 
@@ -548,7 +548,7 @@ protected:
     Array<PreprocessedShaderSource>             m_preprocessedSource;
 
     /** Maps preamble + macro definitions to compiled shaders */
-    Table<String, shared_ptr<ShaderProgram> >   m_compilationCache;
+    ShaderVariantTable<shared_ptr<ShaderProgram> > m_compilationCache;
 
     String                                      m_name;
 
@@ -840,10 +840,10 @@ fit the common pattern.
 
 #define LAUNCH_SHADER_WITH_HINT(pattern, args, hint) {\
     static const shared_ptr<G3D::Shader> __theShader = G3D::Shader::getShaderFromPattern(pattern); \
-    static const size_t _profilerHashBase = ::HashTrait<G3D::String>::hashCode(__theShader->name()) ^ ::HashTrait<G3D::String>::hashCode(G3D::String(__FILE__)) ^ size_t(__LINE__); \
+    static const G3D::Profiler::EventID _profilerEventID = G3D::Profiler::internEvent(__theShader->name(), __FILE__, __LINE__); \
     bool LAUNCH_SHADER_timingEnabled = G3D::Profiler::LAUNCH_SHADER_timingEnabled();\
     if (LAUNCH_SHADER_timingEnabled) {\
-	    G3D::Profiler::beginEvent(__theShader->name(), __FILE__, __LINE__, _profilerHashBase, hint);\
+	    G3D::Profiler::beginEvent(_profilerEventID, hint);\
     }\
 	G3D::RenderDevice::current->apply(__theShader, (args)); \
     if (LAUNCH_SHADER_timingEnabled) {\
@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2001-02-28
-  \edited  2016-05-16
+  \edited  2026-10-17
 */
 
 #ifndef GLG3D_Texture_h
@@ -51,6 +51,10 @@ class GLPixelTransferBuffer;
 class Args;
 class UniformTable;
 
+namespace _internal {
+    class DecodedTexture;
+}
+
 
 /**
  \brief A 1D, 2D, or 3D array (e.g., an image) stored on the GPU, commonly used for
@@ -545,6 +549,7 @@ public:
 
     private:
         friend class Texture;
+        friend class _internal::DecodedTexture;
 
         /**
          Scales the intensity up or down of an entire image and gamma corrects.
@@ -733,6 +738,24 @@ public:
 
     static shared_ptr<Texture> create(const Specification& s);
 
+    /** \brief Begins decoding the file for \a s on the ImageLoader
+        worker threads and returns immediately.
+
+        A later create() with an equal
+        specification waits for that decode instead of loading the
+        file itself, and then only uploads to the GPU.  Preprocessing
+        that does not require OpenGL, such as gamma adjustment and bump
+        map generation, also runs on the worker.  Prefetching every
+        texture of a model before creating any of them decodes them all
+        concurrently.
+
+        Does nothing for specifications that are cached or that do not
+        load from a single file.  Must be invoked on the OpenGL thread.
+        Decodes that are never consumed are released by clearCache().
+
+        \param priority Larger values are decoded first. \sa ImageLoader */
+    static void prefetch(const Specification& s, int priority = 0);
+
     /** 
         Returns a pointer to a texture with the name textureName, if such a texture exists. Returns null otherwise.
         If multiple textures have the name textureName, one is chosen arbitrarily.
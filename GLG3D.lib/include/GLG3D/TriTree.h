@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2009-06-10
-  \edited  2012-10-04
+  \edited  2026-10-17
 */
 #ifndef G3D_TriTree_h
 #define G3D_TriTree_h
@@ -31,6 +31,11 @@ class Surface;
 class Surfel;
 class Material;
 
+namespace _internal {
+    class SIMDRay;
+    class TriMailbox;
+}
+
 /** 
  \brief Static bounding interval hierarchy for Ray-Tri intersections.
 
@@ -48,10 +53,17 @@ class Material;
  that trade between ray-intersection performance and tree-building
  performance.
 
+ Setting Settings::hierarchy to BVH4 instead builds a four-wide
+ bounding volume hierarchy that is traversed with SSE; see
+ TriTree::Hierarchy.
+
  @cite Watcher and Keller, Instant Ray Tracing: The Bounding Interval Hierarchy, EGSR 2006
  http://citeseerx.ist.psu.edu/viewdoc/summary?doi=10.1.1.87.4612
 */
 class TriTree {
+private:
+    friend class _internal::SIMDRay;
+
 public:
     enum SplitAlgorithm {
         /** Produce nodes with approximately equal shape by splitting
@@ -72,11 +84,42 @@ public:
             Theory indicates that this gives the highest performance
             for ray intersection, although that may not be the case
             for specific scenes and rays.*/
-        SAH};
+        SAH,
+
+        /** Evaluate the surface area heuristic only at
+            Settings::numBins evenly spaced planes per axis, bucketing
+            polygons by their centroids.  This requires no sorting and
+            takes linear time per node, so it builds trees of nearly
+            SAH quality in a small fraction of the time.  The axis
+            with the lowest estimated cost is tried first.
+
+            @cite Wald, On fast Construction of SAH-based Bounding Volume Hierarchies, IRT 2007 */
+        BINNED_SAH};
+
+    /** The acceleration structure built by setContents. */
+    enum Hierarchy {
+        /** Binary bounding interval hierarchy constructed with
+            Settings::algorithm.  Triangles may be clipped and
+            referenced from several nodes. */
+        BIH,
+
+        /** Four-wide bounding volume hierarchy flattened into a
+            depth-first array of nodes that each store the bounds of
+            their four children in structure-of-arrays form.  Leaves
+            refer to blocks of four triangles with precomputed edge
+            vectors, so that one ray is tested against four boxes or
+            four triangles at once with SSE.  Always built with a
+            binned SAH; Settings::algorithm is ignored.
+
+            This usually traces rays substantially faster than BIH
+            and stores each triangle exactly once.*/
+        BVH4};
 
     class Settings {
     public:
 
+        Hierarchy          hierarchy;
+
         SplitAlgorithm     algorithm;
 
         /** Fraction of the bounding box surface area that one polygon is allowed
@@ -90,7 +133,7 @@ public:
 
         /** Put approximately this many triangles at each leaf.  Some
            leaves may have more because no suitable splitting plane
-           could be found. */
+           could be found.  BVH4 leaves are padded to a multiple of four. */
         int                valuesPerLeaf;
 
         /** SAH uses an approximation to the published heuristic to
@@ -104,15 +147,89 @@ public:
             the fast method.*/
         int                accurateSAHCountThreshold;
 
+        /** Number of candidate planes per axis for BINNED_SAH and BVH4. */
+        int                numBins;
+
+        /** Nodes containing at least this many polygons build their
+            two children concurrently on the G3D::ThreadPool, and very
+            large nodes also bin and partition their polygons in
+            parallel.  The resulting tree is identical to a
+            single-threaded build.
+
+            Set to <code>std::numeric_limits<int>::max()</code> to
+            build on the calling thread only.*/
+        int                parallelBuildThreshold;
+
+        /** refit() rebuilds a BVH4 subtree when its estimated ray
+            intersection cost under the surface area heuristic grows to
+            more than this multiple of its cost when it was built.
+            Set to <code>finf()</code> to only refit bounds, and to 1.0
+            to rebuild whenever the tree degrades at all. */
+        float              refitRebuildThreshold;
+
         inline Settings() : 
+            hierarchy(BIH),
             algorithm(MEAN_EXTENT), 
             maxAreaFraction(1.0f / 11.0f), 
             valuesPerLeaf(4),
-            accurateSAHCountThreshold(125) {}
+            accurateSAHCountThreshold(125),
+            numBins(32),
+            parallelBuildThreshold(2048),
+            refitRebuildThreshold(1.5f) {}
     };
 
     static const char* algorithmName(SplitAlgorithm s);
 
+    static const char* hierarchyName(Hierarchy h);
+
+    /** Bit flags for intersectRays */
+    typedef unsigned int IntersectRayOptions;
+
+    /** Return any intersection instead of the closest one, and stop
+        tracing each ray as soon as it is found.  Use for shadow and
+        visibility rays. */
+    static const IntersectRayOptions OCCLUSION_TEST_ONLY      = 1;
+
+    /** Test both sides of every triangle (see the \a twoSided argument to intersectRay) */
+    static const IntersectRayOptions DO_NOT_CULL_BACKFACES    = 2;
+
+    /** Ignore material coverage (alpha) when testing intersections */
+    static const IntersectRayOptions NO_PARTIAL_COVERAGE_TEST = 4;
+
+    /** Rays that are adjacent in the array have similar origins and
+        directions, for example primary rays generated in scanline or
+        tile order.  Such rays are traced together as packets that
+        share node traversal.  Without this flag, rays are first sorted
+        by direction and origin to recover coherence. */
+    static const IntersectRayOptions COHERENT_RAY_HINT        = 8;
+
+    /** Compact result of intersectRays. */
+    class Hit {
+    public:
+        enum {NONE = -1};
+
+        /** Index of the triangle hit (see operator[]), or NONE if the ray missed. */
+        int         triIndex;
+
+        /** Barycentric coordinate of the hit corresponding to <code>tri.position(1)</code> */
+        float       u;
+
+        /** Barycentric coordinate of the hit corresponding to <code>tri.position(2)</code> */
+        float       v;
+
+        /** Distance along the ray to the hit. finf() on a miss. */
+        float       distance;
+
+        /** True if the back face of the triangle was hit */
+        bool        backside;
+
+        Hit() : triIndex(NONE), u(0.0f), v(0.0f), distance(finf()), backside(false) {}
+
+        bool hit() const {
+            return triIndex != NONE;
+        }
+    };
+
     class Stats {
     public:
         int numLeaves;
@@ -337,6 +454,17 @@ private:
 
         float chooseSAHSplitLocationFast(Array<Poly>& source, Vector3::Axis axis, const Settings& settings);
 
+        /** Computes the best BINNED_SAH split location and its
+            estimated cost along each axis in a single pass over \a source. */
+        void chooseBinnedSAHSplitLocations(const Array<Poly>& source, const Settings& settings, 
+                                           Vector3& location, Vector3& cost) const;
+
+        /** Applies Poly::split to every element of \a original, in parallel
+            for very large arrays. The output order is independent of the
+            number of threads. */
+        static void partition(const Array<Poly>& original, Vector3::Axis axis, float offset, float minSpanArea,
+                              Array<Poly>& lowArray, Array<Poly>& highArray, Array<Poly>& spanArray);
+
         /** The SAHCost of tracing against just this array. */
         static float SAHCost(int size, float area, float containingArea);
 
@@ -345,11 +473,14 @@ private:
 
           Surface area heuristic: Trace time ~= boxIntersectTime +
           triIntersectTime * num * polyArea / boxArea
-                      
+
+          The three arrays are scratch space, passed in so that 
+          concurrent builds do not share state.
         */
         static float SAHCost(Vector3::Axis axis, float offset,
                              const Array<Poly>& original, float containingArea, 
-                             const Settings& settings);
+                             const Settings& settings,
+                             Array<Poly>& lowArray, Array<Poly>& highArray, Array<Poly>& spanArray);
 
         /** Called from intersect to determine which child the ray hits first.
 
@@ -412,14 +543,14 @@ private:
 
         void draw(RenderDevice* rd, const CPUVertexArray& vertexArray, int level, bool showBoxes, int minNodeSize) const;
 
-        /** Append all contained triangles that intersect this to triArray. Assumes that this node 
-            does intersect the box. 
+        /** Append the indices (relative to \a triBase) of all contained triangles that intersect
+            the box to triIndexArray.
 
-            \param alreadyAdded Since nodes do not have unique ownership of triangles, this set is needed
-            to avoid adding duplicates to the triArray.
+            \param mailbox Since nodes do not have unique ownership of triangles, this records
+            which triangles the current query has already tested, to avoid adding duplicates.
           */  
-        void intersectBox(const AABox& box, const CPUVertexArray& vertexArray, Array<Tri>& triArray, Set<Tri*>& alreadyAdded) const;
-        void intersectSphere(const Sphere& sphere, const CPUVertexArray& vertexArray, Array<Tri>& triArray, Set<Tri*>& alreadyAdded) const;
+        void intersectBox(const AABox& box, const CPUVertexArray& vertexArray, const Tri* triBase, _internal::TriMailbox& mailbox, Array<int>& triIndexArray) const;
+        void intersectSphere(const Sphere& sphere, const CPUVertexArray& vertexArray, const Tri* triBase, _internal::TriMailbox& mailbox, Array<int>& triIndexArray) const;
 
         void print(const String& indent) const;
 
@@ -434,6 +565,66 @@ private:
          bool            twoSided) const;
     };
 
+    /** Node of the BVH4 hierarchy. Element i of each bounds array
+        describes child i, so that all four child boxes can be loaded
+        into SSE registers directly. Unused children have empty
+        (inverted) bounds. */
+    class BVHNode4 {
+    public:
+        float           lowX[4];
+        float           lowY[4];
+        float           lowZ[4];
+        float           highX[4];
+        float           highY[4];
+        float           highZ[4];
+
+        /** Index into m_bvhNode when numBlocks[i] == 0, otherwise index
+            of the first TriBlock4 of the leaf.  -1 for unused children. */
+        int32           child[4];
+
+        /** Number of consecutive TriBlock4s in leaf child i; zero for
+            internal children. */
+        int32           numBlocks[4];
+
+        /** Makes child \a i empty */
+        void setEmpty(int i);
+
+        void setBounds(int i, const AABox& box);
+
+        AABox bounds(int i) const {
+            return AABox(Point3(lowX[i], lowY[i], lowZ[i]), Point3(highX[i], highY[i], highZ[i]));
+        }
+
+        bool isLeaf(int i) const {
+            return numBlocks[i] > 0;
+        }
+    };
+
+    /** Four triangles in structure-of-arrays form, for testing one ray
+        against all of them at once. */
+    class TriBlock4 {
+    public:
+        float           v0X[4];
+        float           v0Y[4];
+        float           v0Z[4];
+
+        /** v1 - v0 */
+        float           e1X[4];
+        float           e1Y[4];
+        float           e1Z[4];
+
+        /** v2 - v0 */
+        float           e2X[4];
+        float           e2Y[4];
+        float           e2Z[4];
+
+        /** Index into TriTree::m_triArray, or -1 for unused lanes. */
+        int32           triIndex[4];
+
+        /** Fills lane \a i from m_triArray[index], or makes it unused if \a index is negative */
+        void set(int i, int index, const Array<Tri>& triArray, const CPUVertexArray& vertexArray);
+    };
+
     /** Memory manager used to allocate Nodes and Tri arrays. */
     shared_ptr<MemoryManager>   m_memoryManager;
 
@@ -451,6 +642,89 @@ private:
     /** All vertices referenced by the Tris in the TriTree */
     CPUVertexArray       m_cpuVertexArray;
 
+    /** Settings passed to the last setContents, for refit() */
+    Settings             m_settings;
+
+    /** BVH4 nodes in depth-first order. Element 0 is the root.  Empty
+        unless m_settings.hierarchy == BVH4.
+
+        Subtrees rebuilt by refit() are appended, so the only ordering
+        guarantee is that every node precedes its children. */
+    Array<BVHNode4>      m_bvhNode;
+
+    /** Triangle blocks referenced by BVH4 leaves, in depth-first order */
+    Array<TriBlock4>     m_triBlock;
+
+    /** SAH cost of each BVH4 subtree when it was built, divided by
+        the surface area of the entire tree at that time. refit()
+        compares against this to detect degraded subtrees. Parallel to
+        m_bvhNode. */
+    Array<float>         m_bvhNodeCost;
+
+    /** Number of elements of m_bvhNode that are no longer reachable
+        because refit() rebuilt the subtrees containing them */
+    int                  m_bvhGarbage;
+
+    /** Builds m_root or m_bvhNode from m_triArray and m_cpuVertexArray. Called from setContents. */
+    void buildTree(const Settings& settings);
+
+    /** \param sourceIndex Indices of the Tris with nonzero area */
+    void buildBVH4(const Array<int>& sourceIndex, const Settings& settings);
+
+    /** Builds a BVH4 over the Tris with indices \a triIndex, appends
+        it to m_bvhNode and m_triBlock, and returns the index of its
+        root node.  The caller must normalize the new elements of
+        m_bvhNodeCost, which hold unnormalized costs.
+
+        \param depth Depth of the new root within the whole tree, so that
+        subtrees rebuilt by refit() respect the traversal stack limit. */
+    int appendBVH4(const Array<int>& triIndex, const Settings& settings, int depth);
+
+    /** Surface area heuristic cost of the subtree at BVH4 node \a
+        index, given the costs of its internal children in \a cost.
+        This is not normalized by the node's area, so that bounds that
+        grow without bound during refit() increase the cost. */
+    float computeBVH4Cost(int index, const Array<float>& cost) const;
+
+    /** Surface area of the bounds of BVH4 node \a index */
+    float bvh4Area(int index) const;
+
+    /** Appends the indices of all Tris below BVH4 node \a index and
+        returns the number of nodes in that subtree */
+    int gatherBVH4Tris(int index, Array<int>& triIndex) const;
+
+    /** Called from refit() after m_triArray and m_cpuVertexArray have been updated */
+    int refitBVH4();
+
+    /** Traces the subtree identified by \a startChild and \a startNumBlocks
+        (see BVHNode4), which defaults to the entire tree. */
+    bool intersectRayBVH4
+    (const Ray&         ray,
+     Tri::Intersector&  intersectCallback, 
+     float&             distance,
+     bool               exitOnAnyHit,
+     bool               twoSided,
+     int                startChild = 0,
+     int                startNumBlocks = 0) const;
+
+    void intersectSphereBVH4(const Sphere& sphere, Array<int>& triIndexArray) const;
+
+    void intersectBoxBVH4(const AABox& box, Array<int>& triIndexArray) const;
+
+    void getBVH4Stats(Stats& s, int node, int level, int valuesPerNode) const;
+
+    /** Traces up to 32 rays through the BVH4 together, sharing node
+        visits among rays that enter the same boxes. \a distance is
+        input and output. */
+    void intersectPacketBVH4
+    (const Ray*         ray,
+     int                numRays,
+     Tri::Intersector*  intersectCallback,
+     float*             distance,
+     bool*              hit,
+     bool               exitOnAnyHit,
+     bool               twoSided) const;
+
 public:
 
     TriTree();
@@ -493,6 +767,42 @@ public:
         return m_triArray.size();
     }
 
+    /** The structure built by the last call to setContents */
+    Hierarchy hierarchy() const {
+        return m_settings.hierarchy;
+    }
+
+    /** \brief Updates the tree after the vertices have moved, without
+        changing which vertices each triangle references.
+
+        For BVH4, this recomputes the triangle blocks and the node
+        bounds bottom-up in time linear in the size of the tree.
+        Subtrees whose SAH cost has grown past
+        Settings::refitRebuildThreshold times their cost when built
+        are then rebuilt from scratch, and the entire tree is rebuilt
+        when the root has degraded or when rebuilt subtrees have left
+        too much unused memory.  For BIH, whose splitting planes cannot
+        move, this rebuilds the entire tree.
+
+        Triangles that had zero area when setContents was called are
+        not reconsidered.
+
+        \param vertexArray Must have the same number of vertices as the
+        array passed to setContents.
+
+        \return The number of subtrees that were rebuilt. 0 means that
+        only the bounds were updated.
+     */
+    int refit(const CPUVertexArray& vertexArray);
+
+    /** Extracts the current geometry of the surfaces with
+        Surface::getTris and then refits to it.  If the number of
+        triangles or vertices has changed, this calls setContents with
+        the previous Settings instead. */
+    int refit
+    (const Array<shared_ptr<Surface> >& surfaceArray,
+     bool computePrevPosition = false);
+
     /** Returns true if there was an intersection.
 
         Example:
@@ -520,6 +830,29 @@ public:
      bool exitOnAnyHit = false,
      bool twoSided = false) const;
 
+    /** \brief Intersects a batch of rays in parallel and writes one Hit per ray.
+
+        For the BVH4 hierarchy, coherent rays (see COHERENT_RAY_HINT)
+        are traced as packets and other rays are sorted by direction
+        octant and origin before tracing so that neighboring rays visit
+        similar nodes.  The BIH traces sorted rays one at a time.
+
+        Results are always in the same order as \a rayArray.
+
+        \param maxDistanceArray If not empty, hits farther than
+        maxDistanceArray[i] are ignored for ray i (e.g., the distance
+        to a light for shadow rays).
+
+        \param options Bitwise OR of OCCLUSION_TEST_ONLY,
+        DO_NOT_CULL_BACKFACES, NO_PARTIAL_COVERAGE_TEST, and
+        COHERENT_RAY_HINT.
+     */
+    void intersectRays
+    (const Array<Ray>&      rayArray,
+     Array<Hit>&            results,
+     IntersectRayOptions    options = 0,
+     const Array<float>&    maxDistanceArray = Array<float>()) const;
+
     /** Returns the surfel hit, or NULL if none */
     shared_ptr<Surfel> intersectRay
     (const Ray& ray,
@@ -527,18 +860,55 @@ public:
      bool exitOnAnyHit = false,
      bool twoSided = false) const;
 
-    /** Returns all triangles that intersect or are contained within
-        the sphere (technically, this is a ball intersection). */
+    /** Appends all triangles that intersect or are contained within
+        the sphere (technically, this is a ball intersection). 
+
+        The overload that produces indices is faster because it does not copy the Tris. */
     void intersectSphere
     (const Sphere& sphere,
      Array<Tri>&   triArray) const;
 
-    /** Returns all triangles that intersect or are contained within
-        the box. */
+    /** Appends all triangles that intersect or are contained within
+        the box. 
+
+        The overload that produces indices is faster because it does not copy the Tris. */
     void intersectBox
     (const AABox&  box,
      Array<Tri>&   triArray) const;
 
+    /** Appends the indices of all triangles that intersect or are
+        contained within the sphere, each exactly once.  Use
+        operator[] to access the Tris.
+
+        Does not allocate memory except to grow \a triIndexArray and,
+        for the BIH, the first time that each thread queries a tree of
+        a given size.  Safe to invoke concurrently from multiple threads. */
+    void intersectSphere
+    (const Sphere& sphere,
+     Array<int>&   triIndexArray) const;
+
+    /** Appends the indices of all triangles that intersect or are
+        contained within the box, each exactly once.  \sa intersectSphere */
+    void intersectBox
+    (const AABox&  box,
+     Array<int>&   triIndexArray) const;
+
+    /** \brief Intersects a batch of spheres in parallel, e.g., the
+        collision proxies of all moving characters.
+
+        \a results is resized to match \a sphereArray, and then
+        results[i] is set to the indices of the triangles that
+        sphereArray[i] intersects.  Reusing \a results across frames
+        reuses its memory. */
+    void intersectSpheres
+    (const Array<Sphere>&   sphereArray,
+     Array<Array<int> >&    results) const;
+
+    /** Intersects a batch of boxes in parallel. \sa intersectSpheres */
+    void intersectBoxes
+    (const Array<AABox>&    boxArray,
+     Array<Array<int> >&    results) const;
+
     /** Render the tree for debugging and visualization purposes. 
         Inefficent.
 
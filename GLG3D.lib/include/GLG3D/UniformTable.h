@@ -4,7 +4,7 @@
  \maintainer Michael Mara, http://www.illuminationcodified.com
 
  \created 2012-06-16
- \edited  2015-07-07
+ \edited  2026-10-17
 
  G3D Innovation Engine
  Copyright 2000-2015, Morgan McGuire.
@@ -31,6 +31,7 @@ class Texture;
 class GLPixelTransferBuffer;
 class GLSamplerObject;
 class BindlessTextureHandle;
+template<class Value> class ShaderVariantTable;
 
 
 /** \brief Uniform and macro arguments for a G3D::Shader.
@@ -45,6 +46,7 @@ class BindlessTextureHandle;
 class UniformTable {
 public:
     friend class Shader;
+    template<class Value> friend class ShaderVariantTable;
 
     /** 8-byte storage used for all argument types */
     union Scalar {
@@ -173,6 +175,15 @@ protected:
 
     /** Must be empty if m_immediateModeArgs is non-empty */
     GPUAttributeTable               m_streamArgs;
+
+    /** Hash of m_preamble, updated when it changes */
+    uint64                          m_preambleHash;
+
+    /** Sum of macroHash() over m_macroArgs, so that it is independent of
+        macro order and can be updated as each macro is set */
+    uint64                          m_macroHash;
+
+    static uint64 macroHash(const MacroArgPair& macro);
     
 public:
 
@@ -204,13 +215,23 @@ public:
     /** The preamble with macro arg definitions appended */
     String preambleAndMacroString() const;
 
+    /** A 64-bit hash of preambleAndMacroString() that is maintained as the
+        preamble and macros change, so reading it does not build any strings.
+        Tables with different strings may collide; use sameVariant() to check. 
+        \sa ShaderVariantTable */
+    uint64 variantHash() const {
+        return m_preambleHash ^ m_macroHash;
+    }
+
+    /** True if preambleAndMacroString() is the same for \a this and \a other.
+        Does not build either string. */
+    bool sameVariant(const UniformTable& other) const;
+
     String preamble() const {
         return m_preamble;
     }
 
-    void appendToPreamble(const String& extra) {
-        m_preamble += extra;
-    }
+    void appendToPreamble(const String& extra);
 
     /** Arbitrary string to append to beginning of the shader */
     void setPreamble(const String& preamble);
@@ -355,9 +376,7 @@ public:
         }
     }
 
-    UniformTable(const UniformTable& other) {
-        append(other);
-    }
+    UniformTable(const UniformTable& other);
 
     const GPUAttributeTable& gpuAttributeTable() const {
         return m_streamArgs;
@@ -375,5 +394,72 @@ public:
 
 }; // class UniformTable
 
+
+/** \brief Maps the preamble and macros of a UniformTable to a value, such as
+    a compiled shader program, without building strings on lookup.
+
+    Entries are keyed by UniformTable::variantHash() and checked with
+    UniformTable::sameVariant(), so hash collisions produce separate entries.
+    Only set() copies the preamble and macros.
+
+    \sa Shader */
+template<class Value>
+class ShaderVariantTable {
+private:
+
+    class Entry {
+    public:
+        /** Holds only the preamble and macros of the key */
+        UniformTable    key;
+        Value           value;
+    };
+
+    Table<uint64, SmallArray<shared_ptr<Entry>, 1> >  m_table;
+
+    int                 m_size;
+
+public:
+
+    ShaderVariantTable() : m_size(0) {}
+
+    /** Returns NULL if there is no entry for the variant of \a args */
+    Value* getPointer(const UniformTable& args) const {
+        const SmallArray<shared_ptr<Entry>, 1>* bucket = m_table.getPointer(args.variantHash());
+        if (notNull(bucket)) {
+            for (int i = 0; i < bucket->size(); ++i) {
+                if ((*bucket)[i]->key.sameVariant(args)) {
+                    return &((*bucket)[i]->value);
+                }
+            }
+        }
+        return NULL;
+    }
+
+    void set(const UniformTable& args, const Value& value) {
+        Value* existing = getPointer(args);
+        if (notNull(existing)) {
+            *existing = value;
+        } else {
+            const shared_ptr<Entry> entry(new Entry());
+            entry->key.setPreamble(args.m_preamble);
+            for (int i = 0; i < args.m_macroArgs.size(); ++i) {
+                entry->key.setMacro(args.m_macroArgs[i].name, args.m_macroArgs[i].value);
+            }
+            entry->value = value;
+            m_table.getCreate(args.variantHash()).append(entry);
+            ++m_size;
+        }
+    }
+
+    void clear() {
+        m_table.clear();
+        m_size = 0;
+    }
+
+    int size() const {
+        return m_size;
+    }
+};
+
 } // G3D
 #endif
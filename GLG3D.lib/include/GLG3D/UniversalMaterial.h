@@ -2,7 +2,7 @@
  \file   GLG3D/UniversalMaterial.h
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \date   2008-08-10
- \edited 2016-03-15
+ \edited 2026-10-17
  
  G3D Innovation Engine
  Copyright 2000-2016, Morgan McGuire.
@@ -229,8 +229,24 @@ Any component can be a Texture::Specification, Color3/Color4, or table of <code>
 
         bool operator==(const Specification& s) const;
 
+        /** Texture%s set directly by object (e.g., with setLambertian(const shared_ptr<Texture>&),
+            light maps, and custom textures) cannot be represented in an Any and are omitted.
+            \sa referencesTextureObjects */
         Any toAny() const;
 
+        /** True if this specification contains Texture objects, rather than
+            only Texture::Specification%s, so that toAny() cannot fully represent it. */
+        bool referencesTextureObjects() const;
+
+        /** Starts decoding every texture that this specification loads
+            from a file, so that they decode concurrently on the
+            ImageLoader workers.  UniversalMaterial::create() invokes this
+            automatically; invoke it on the specifications of many
+            materials before creating any of them to overlap their decoding
+            as well.  Must be invoked on the OpenGL thread.
+            \sa Texture::prefetch */
+        void prefetchTextures() const;
+
         bool operator!=(const Specification& s) const {
             return !((*this) == s);
         }
@@ -418,6 +434,10 @@ protected:
 
     Sampler                     m_sampler;
 
+    /** The specification this was created from by create(const String&, const Specification&),
+        or NULL if it was assembled from components. */
+    shared_ptr<Specification>   m_specification;
+
     UniversalMaterial();
 
 public:
@@ -432,6 +452,13 @@ public:
        return m_name;
     }
 
+    /** The specification that this material was created from, or NULL if
+        it was constructed directly from a UniversalBSDF and components. 
+        Used for re-creating materials from a cache, as by ArticulatedModel's SpeedLoad format. */
+    const shared_ptr<Specification>& specification() const {
+        return m_specification;
+    }
+
     /** The sampler used for all Texture%s */
     const Sampler& sampler() const {
         return m_sampler;
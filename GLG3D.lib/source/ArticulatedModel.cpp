@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \created 2011-07-19
- \edited  2016-02-10
+ \edited  2026-10-17
  
  Copyright 2000-2016, Morgan McGuire.
  All rights reserved.
@@ -13,6 +13,7 @@
 #include "G3D/FileSystem.h"
 #include "G3D/Stopwatch.h"
 #include "GLG3D/GApp.h"
+#include "GLG3D/TriTree.h"
 #include <memory>
 
 namespace G3D {
@@ -223,6 +224,12 @@ ArticulatedModel::Part* ArticulatedModel::part(const String& partName) {
 void ArticulatedModel::load(const Specification& specification) {
     Stopwatch timer;
     timer.setEnabled(false);
+
+    const String& cacheFilename = speedLoadCacheFilename(specification);
+    if (! cacheFilename.empty() && loadFromSpeedLoadCache(specification, cacheFilename)) {
+        timer.after("SpeedLoad cache");
+        return;
+    }
     
     const String& ext = toLower(FilePath::ext(specification.filename));
 
@@ -280,6 +287,10 @@ void ArticulatedModel::load(const Specification& specification) {
 
     maybeCompactArrays();
     timer.after("cleanGeometry");
+
+    if (! cacheFilename.empty()) {
+        saveToSpeedLoadCache(specification, cacheFilename);
+    }
 }
 
 
@@ -445,6 +456,41 @@ public:
             }
         }
 
+        if (mesh->contributingJoints.size() == 1) {
+            // Rigid mesh: trace the cached object-space tree
+            const shared_ptr<TriTree> tree = model->meshTriTree(mesh);
+            Tri::Intersector intersector;
+            intersector.alphaTest = false;
+            float distance = m_maxDistance;
+            if (tree->intersectRay(intersectingRay, intersector, distance)) {
+                hit = true;
+                m_maxDistance = distance;
+
+                // TriTree has the same indices as cpuIndexArray
+                const int i = intersector.primitiveIndex * 3;
+                const Point3& p0 = vertex[index[i]].position;
+                const Point3& p1 = vertex[index[i + 1]].position;
+                const Point3& p2 = vertex[index[i + 2]].position;
+                normal = (p1 - p0).cross(p2 - p0).direction();
+                if (intersector.backside) {
+                    normal = -normal;
+                }
+
+                m_info.set(
+                    model, 
+                    m_entity,
+                    mesh->material,
+                    jointCFrameArray[0].normalToWorldSpace(normal),
+                    m_wsR.origin() + m_maxDistance * m_wsR.direction(),
+                    mesh->name,
+                    mesh->uniqueID,
+                    intersector.primitiveIndex,
+                    1.0f - intersector.u - intersector.v,
+                    intersector.v);
+            }
+            return;
+        }
+
         Array<Point3> triMesh;
         for (int i = 0; i < numIndices; i += 3) {    
             
@@ -530,6 +576,61 @@ public:
 }; // AMIntersector
 
 
+shared_ptr<TriTree> ArticulatedModel::meshTriTree(Mesh* mesh) {
+    // Concurrent queries may find the tree missing or stale at the same time
+    GMutexLock lock(&m_triTreeMutex);
+    if (isNull(mesh->m_triTree) || (mesh->m_triTreeChangeCount != mesh->geometry->m_changeCount)) {
+        const CPUVertexArray& geometryVertexArray = mesh->geometry->cpuVertexArray;
+        const Array<int>& index = mesh->cpuIndexArray;
+
+        // The tree keeps its own copy of the vertices, so copy only the ones
+        // that this mesh references instead of the Geometry's entire array,
+        // which every Mesh of that Geometry would otherwise duplicate
+        Array<int> compactIndex;
+        compactIndex.resize(geometryVertexArray.size());
+        for (int v = 0; v < compactIndex.size(); ++v) {
+            compactIndex[v] = -1;
+        }
+
+        CPUVertexArray vertexArray;
+        vertexArray.hasTexCoord0 = geometryVertexArray.hasTexCoord0;
+        vertexArray.hasTexCoord1 = geometryVertexArray.hasTexCoord1;
+        vertexArray.hasTangent   = geometryVertexArray.hasTangent;
+
+        Array<int> remappedIndex;
+        remappedIndex.resize(index.size());
+        for (int i = 0; i < index.size(); ++i) {
+            int& c = compactIndex[index[i]];
+            if (c == -1) {
+                c = vertexArray.vertex.size();
+                vertexArray.vertex.append(geometryVertexArray.vertex[index[i]]);
+                if (geometryVertexArray.texCoord1.size() > 0) {
+                    vertexArray.texCoord1.append(geometryVertexArray.texCoord1[index[i]]);
+                }
+            }
+            remappedIndex[i] = c;
+        }
+
+        Array<Tri> triArray;
+        triArray.resize(index.size() / 3);
+        for (int t = 0; t < triArray.size(); ++t) {
+            triArray[t] = Tri(remappedIndex[t * 3], remappedIndex[t * 3 + 1], remappedIndex[t * 3 + 2], vertexArray, lazy_ptr<ReferenceCountedObject>(), mesh->twoSided);
+        }
+
+        TriTree::Settings settings;
+        settings.hierarchy = TriTree::BVH4;
+        settings.algorithm = TriTree::BINNED_SAH;
+        // Build before publishing, so that a query still holding the previous
+        // tree keeps it alive and never sees a partially built one
+        const shared_ptr<TriTree> tree(new TriTree());
+        tree->setContents(triArray, vertexArray, settings);
+        mesh->m_triTree = tree;
+        mesh->m_triTreeChangeCount = mesh->geometry->m_changeCount;
+    }
+    return mesh->m_triTree;
+}
+
+
 bool ArticulatedModel::intersect
     (const Ray&     R, 
     const CFrame&   cframe, 
@@ -537,9 +638,11 @@ bool ArticulatedModel::intersect
     float&          maxDistance, 
     Model::HitInfo& info,
     const shared_ptr<Entity>& entity) {
-    // TODO: change structure to no longer keep cache of part transforms
-    computePartTransforms(m_partTransformTable, m_partTransformTable, cframe, pose, cframe, pose);
-    AMIntersector intersectOperation(R, maxDistance, info, m_partTransformTable, entity);
+    // Per thread rather than the m_partTransformTable member, so that
+    // queries may run concurrently.  Reusing it avoids allocating nodes.
+    static thread_local Table<Part*, CFrame> partTransformTable;
+    computePartTransforms(partTransformTable, partTransformTable, cframe, pose, cframe, pose);
+    AMIntersector intersectOperation(R, maxDistance, info, partTransformTable, entity);
     forEachMesh(intersectOperation);
 
     return intersectOperation.hit;
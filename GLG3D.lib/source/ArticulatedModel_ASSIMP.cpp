@@ -3,7 +3,7 @@
 
  \author Michael Mara, http://www.illuminationcodified.com/
  \created 2013-01-09
- \edited  2013-01-09
+ \edited  2026-10-17
  
 */
 #include "GLG3D/ArticulatedModel.h"
@@ -740,6 +740,10 @@ void ArticulatedModel::loadASSIMP(const Specification& specification) {
             if (inverted) {
                 materialSpecs[i].setTransmissive(Texture::Specification(Color3(1.0, 1.0, 1.0) - transmissives[i]));
             } 
+            // Decode every material's textures concurrently
+            materialSpecs[i].prefetchTextures();
+        }
+        for (int i = 0; i < materials.size(); ++i) {
             materials[i] = UniversalMaterial::create(materialNames[i], materialSpecs[i]);
         }
     }
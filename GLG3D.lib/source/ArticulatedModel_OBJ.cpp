@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \created 2011-07-19
- \edited  2014-10-25
+ \edited  2026-10-17
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -12,6 +12,7 @@
 #include "G3D/ParseOBJ.h"
 #include "G3D/FileSystem.h"
 #include "G3D/Stopwatch.h"
+#include "G3D/Set.h"
 
 namespace G3D {
 
@@ -297,8 +298,10 @@ void ArticulatedModel::loadOBJ(const Specification& specification) {
     int numSpecifiedNormals = 0;
     int numSpecifiedTexCoord0s = 0;
 
-    // Preallocate enough memory to store all the faces if the faces are triangles
+    // Preallocate enough memory to store all the faces if the faces are triangles,
+    // and start decoding every texture before the first material is created below
     int numVertices = 0;
+    Set<String> prefetchedMaterials;
     for (ParseOBJ::GroupTable::Iterator git = parseData.groupTable.begin();
         git.isValid();
         ++git) {
@@ -309,6 +312,11 @@ void ArticulatedModel::loadOBJ(const Specification& specification) {
             ++mit) {
             shared_ptr<ParseOBJ::Mesh>& srcMesh = mit->value;
             numVertices += srcMesh->faceArray.size() * 3;
+
+            if (! specification.stripMaterials && ! prefetchedMaterials.contains(srcMesh->material->name)) {
+                prefetchedMaterials.insert(srcMesh->material->name);
+                toMaterialSpecification(specification, srcMesh->material, specification.alphaHint, specification.refractionHint).prefetchTextures();
+            }
         }
     }
     geom->cpuVertexArray.vertex.reserve(numVertices);
@@ -0,0 +1,431 @@
+/**
+ \file GLG3D/source/ArticulatedModel_SpeedLoad.cpp
+
+ \author Morgan McGuire, http://graphics.cs.williams.edu
+ \created 2026-10-17
+ \edited  2026-10-17
+
+ Copyright 2000-2026, Morgan McGuire.
+ All rights reserved.
+*/
+#include "GLG3D/ArticulatedModel.h"
+#include "G3D/SpeedLoad.h"
+#include "G3D/FileSystem.h"
+#include "G3D/Crypto.h"
+#include "G3D/Log.h"
+
+namespace G3D {
+
+/** Increment whenever the layout written by speedSerialize changes */
+static const uint32 SPEEDLOAD_VERSION = 1;
+
+static String s_speedLoadCacheDirectory;
+
+/** Writes the array as its element count followed by its raw bytes.
+    Only valid for types without pointers. */
+template<class T>
+static void writeRaw(BinaryOutput& b, const Array<T>& array) {
+    b.writeInt32(array.size());
+    if (array.size() > 0) {
+        b.writeBytes(array.getCArray(), sizeof(T) * array.size());
+    }
+}
+
+
+template<class T>
+static void readRaw(BinaryInput& b, Array<T>& array) {
+    const int n = b.readInt32();
+    array.resize(n);
+    if (n > 0) {
+        b.readBytes(array.getCArray(), int64(sizeof(T)) * n);
+    }
+}
+
+
+/** Writes the indices of \a part elements in \a all, or -1 for NULL */
+template<class T>
+static void writeIndices(BinaryOutput& b, const Array<T*>& array, const Table<const T*, int>& index) {
+    b.writeInt32(array.size());
+    for (int i = 0; i < array.size(); ++i) {
+        b.writeInt32(isNull(array[i]) ? -1 : index[array[i]]);
+    }
+}
+
+
+template<class T>
+static void readIndices(BinaryInput& b, Array<T*>& array, const Array<T*>& all) {
+    array.resize(b.readInt32());
+    for (int i = 0; i < array.size(); ++i) {
+        const int index = b.readInt32();
+        array[i] = (index == -1) ? NULL : all[index];
+    }
+}
+
+
+static void serialize(const CPUVertexArray& cpuVertexArray, BinaryOutput& b) {
+    b.writeBool8(cpuVertexArray.hasTexCoord0);
+    b.writeBool8(cpuVertexArray.hasTexCoord1);
+    b.writeBool8(cpuVertexArray.hasTangent);
+    b.writeBool8(cpuVertexArray.hasBones);
+    b.writeBool8(cpuVertexArray.hasVertexColors);
+    writeRaw(b, cpuVertexArray.vertex);
+    writeRaw(b, cpuVertexArray.texCoord1);
+    writeRaw(b, cpuVertexArray.vertexColors);
+    writeRaw(b, cpuVertexArray.boneIndices);
+    writeRaw(b, cpuVertexArray.boneWeights);
+    writeRaw(b, cpuVertexArray.prevPosition);
+}
+
+
+static void deserialize(CPUVertexArray& cpuVertexArray, BinaryInput& b) {
+    cpuVertexArray.hasTexCoord0    = b.readBool8();
+    cpuVertexArray.hasTexCoord1    = b.readBool8();
+    cpuVertexArray.hasTangent      = b.readBool8();
+    cpuVertexArray.hasBones        = b.readBool8();
+    cpuVertexArray.hasVertexColors = b.readBool8();
+    readRaw(b, cpuVertexArray.vertex);
+    readRaw(b, cpuVertexArray.texCoord1);
+    readRaw(b, cpuVertexArray.vertexColors);
+    readRaw(b, cpuVertexArray.boneIndices);
+    readRaw(b, cpuVertexArray.boneWeights);
+    readRaw(b, cpuVertexArray.prevPosition);
+}
+
+
+static void serialize(const PhysicsFrameSpline& spline, BinaryOutput& b) {
+    b.writeInt32(int(spline.extrapolationMode));
+    b.writeInt32(int(spline.interpolationMode));
+    b.writeFloat32(spline.finalInterval);
+    writeRaw(b, spline.time);
+    b.writeInt32(spline.control.size());
+    for (int i = 0; i < spline.control.size(); ++i) {
+        spline.control[i].serialize(b);
+    }
+}
+
+
+static void deserialize(PhysicsFrameSpline& spline, BinaryInput& b) {
+    spline.extrapolationMode = SplineExtrapolationMode(b.readInt32());
+    spline.interpolationMode = SplineInterpolationMode(b.readInt32());
+    spline.finalInterval     = b.readFloat32();
+    readRaw(b, spline.time);
+    spline.control.resize(b.readInt32());
+    for (int i = 0; i < spline.control.size(); ++i) {
+        spline.control[i].deserialize(b);
+    }
+}
+
+
+bool ArticulatedModel::supportsSpeedLoad() const {
+    for (int m = 0; m < m_meshArray.size(); ++m) {
+        const shared_ptr<UniversalMaterial>& material = m_meshArray[m]->material;
+        if (notNull(material) && (isNull(material->specification()) || material->specification()->referencesTextureObjects())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void ArticulatedModel::speedSerialize(BinaryOutput& b) const {
+    alwaysAssertM(supportsSpeedLoad(), "SpeedLoad ArticulatedModel format requires materials created from file-based UniversalMaterial::Specifications");
+
+    SpeedLoad::writeHeader(b, "ArticulatedModel");
+    b.writeUInt32(SPEEDLOAD_VERSION);
+    b.writeString32(m_name);
+    b.writeInt32(m_nextID);
+
+    // Materials are shared between meshes, so write each once and refer to it by index
+    Table<const UniversalMaterial*, int> materialIndex;
+    Array<const UniversalMaterial*> materialArray;
+    for (int m = 0; m < m_meshArray.size(); ++m) {
+        const UniversalMaterial* material = m_meshArray[m]->material.get();
+        if (notNull(material) && ! materialIndex.containsKey(material)) {
+            materialIndex.set(material, materialArray.size());
+            materialArray.append(material);
+        }
+    }
+    b.writeInt32(materialArray.size());
+    for (int i = 0; i < materialArray.size(); ++i) {
+        b.writeString32(materialArray[i]->name());
+        materialArray[i]->specification()->toAny().serialize(b);
+    }
+
+    // Parts, in creation order
+    Table<const Part*, int> partIndex;
+    for (int p = 0; p < m_partArray.size(); ++p) {
+        partIndex.set(m_partArray[p], p);
+    }
+    b.writeInt32(m_partArray.size());
+    for (int p = 0; p < m_partArray.size(); ++p) {
+        const Part* part = m_partArray[p];
+        b.writeString32(part->name);
+        b.writeInt32(part->uniqueID);
+        b.writeInt32(isNull(part->m_parent) ? -1 : partIndex[part->m_parent]);
+        writeIndices(b, part->m_children, partIndex);
+        part->cframe.serialize(b);
+        part->inverseBindPoseTransform.serialize(b);
+    }
+    writeIndices(b, m_rootArray, partIndex);
+    writeIndices(b, m_boneArray, partIndex);
+
+    Table<const Geometry*, int> geometryIndex;
+    b.writeInt32(m_geometryArray.size());
+    for (int g = 0; g < m_geometryArray.size(); ++g) {
+        const Geometry* geom = m_geometryArray[g];
+        geometryIndex.set(geom, g);
+        b.writeString32(geom->name);
+        serialize(geom->cpuVertexArray, b);
+        geom->sphereBounds.serialize(b);
+        geom->boxBounds.serialize(b);
+    }
+
+    b.writeInt32(m_meshArray.size());
+    for (int m = 0; m < m_meshArray.size(); ++m) {
+        const Mesh* mesh = m_meshArray[m];
+        b.writeString32(mesh->name);
+        b.writeInt32(mesh->uniqueID);
+        b.writeInt32(isNull(mesh->logicalPart) ? -1 : partIndex[mesh->logicalPart]);
+        writeIndices(b, mesh->contributingJoints, partIndex);
+        b.writeInt32(isNull(mesh->material) ? -1 : materialIndex[mesh->material.get()]);
+        b.writeInt32(isNull(mesh->geometry) ? -1 : geometryIndex[mesh->geometry]);
+        b.writeInt32(int(mesh->primitive));
+        b.writeBool8(mesh->twoSided);
+        writeRaw(b, mesh->cpuIndexArray);
+        mesh->sphereBounds.serialize(b);
+        mesh->boxBounds.serialize(b);
+    }
+
+    b.writeInt32(m_animationTable.size());
+    for (Table<String, Animation>::Iterator it = m_animationTable.begin(); it.isValid(); ++it) {
+        b.writeString32(it->key);
+        b.writeFloat64(it->value.duration);
+        const PoseSpline::SplineTable& splineTable = it->value.poseSpline.partSpline;
+        b.writeInt32(splineTable.size());
+        for (PoseSpline::SplineTable::Iterator s = splineTable.begin(); s.isValid(); ++s) {
+            b.writeString32(s->key);
+            serialize(s->value, b);
+        }
+    }
+
+    b.writeInt32(m_mtlArray.size());
+    for (int i = 0; i < m_mtlArray.size(); ++i) {
+        b.writeString32(m_mtlArray[i]);
+    }
+}
+
+
+void ArticulatedModel::speedDeserialize(BinaryInput& b) {
+    SpeedLoad::readHeader(b, "ArticulatedModel");
+    const uint32 version = b.readUInt32();
+    alwaysAssertM(version == SPEEDLOAD_VERSION, format("Unsupported SpeedLoad ArticulatedModel version %d", version));
+
+    m_name   = b.readString32();
+    m_nextID = b.readInt32();
+
+    Array<shared_ptr<UniversalMaterial> > materialArray;
+    materialArray.resize(b.readInt32());
+    Array<String> materialNameArray;
+    Array<UniversalMaterial::Specification> materialSpecArray;
+    for (int i = 0; i < materialArray.size(); ++i) {
+        materialNameArray.append(b.readString32());
+        Any any;
+        any.deserialize(b);
+        materialSpecArray.append(UniversalMaterial::Specification(any));
+
+        // Decode every material's textures concurrently
+        materialSpecArray.last().prefetchTextures();
+    }
+    for (int i = 0; i < materialArray.size(); ++i) {
+        materialArray[i] = UniversalMaterial::create(materialNameArray[i], materialSpecArray[i]);
+    }
+
+    // Allocate all parts before linking them, because children may precede their parents
+    m_partArray.resize(b.readInt32());
+    for (int p = 0; p < m_partArray.size(); ++p) {
+        m_partArray[p] = new Part("", NULL, 0);
+    }
+    for (int p = 0; p < m_partArray.size(); ++p) {
+        Part* part = m_partArray[p];
+        part->name     = b.readString32();
+        part->uniqueID = b.readInt32();
+        const int parent = b.readInt32();
+        part->m_parent = (parent == -1) ? NULL : m_partArray[parent];
+        readIndices(b, part->m_children, m_partArray);
+        part->cframe.deserialize(b);
+        part->inverseBindPoseTransform.deserialize(b);
+    }
+    readIndices(b, m_rootArray, m_partArray);
+    readIndices(b, m_boneArray, m_partArray);
+
+    m_geometryArray.resize(b.readInt32());
+    for (int g = 0; g < m_geometryArray.size(); ++g) {
+        Geometry* geom = new Geometry(b.readString32());
+        m_geometryArray[g] = geom;
+        deserialize(geom->cpuVertexArray, b);
+        geom->sphereBounds.deserialize(b);
+        geom->boxBounds.deserialize(b);
+    }
+
+    if (m_boneArray.size() > 0) {
+        m_gpuBoneTransformations     = Texture::createEmpty(m_name + "_boneTexture", m_boneArray.size() * 2, 2, ImageFormat::RGBA32F(), Texture::DIM_2D);
+        m_gpuBonePrevTransformations = Texture::createEmpty(m_name + "_prevBoneTexture", m_boneArray.size() * 2, 2, ImageFormat::RGBA32F(), Texture::DIM_2D);
+    }
+
+    m_meshArray.resize(b.readInt32());
+    for (int m = 0; m < m_meshArray.size(); ++m) {
+        const String& name = b.readString32();
+        const int uniqueID = b.readInt32();
+        const int logicalPart = b.readInt32();
+        Mesh* mesh = new Mesh(name, (logicalPart == -1) ? NULL : m_partArray[logicalPart], NULL, uniqueID);
+        m_meshArray[m] = mesh;
+        readIndices(b, mesh->contributingJoints, m_partArray);
+
+        const int material = b.readInt32();
+        if (material != -1) {
+            mesh->material = materialArray[material];
+        }
+        const int geometry = b.readInt32();
+        mesh->geometry  = (geometry == -1) ? NULL : m_geometryArray[geometry];
+        mesh->primitive = PrimitiveType(b.readInt32());
+        mesh->twoSided  = b.readBool8();
+        readRaw(b, mesh->cpuIndexArray);
+        mesh->sphereBounds.deserialize(b);
+        mesh->boxBounds.deserialize(b);
+        mesh->boneTexture     = m_gpuBoneTransformations;
+        mesh->prevBoneTexture = m_gpuBonePrevTransformations;
+    }
+
+    const int numAnimations = b.readInt32();
+    for (int i = 0; i < numAnimations; ++i) {
+        Animation& animation = m_animationTable.getCreate(b.readString32());
+        animation.duration = b.readFloat64();
+        const int numSplines = b.readInt32();
+        for (int s = 0; s < numSplines; ++s) {
+            deserialize(animation.poseSpline.partSpline.getCreate(b.readString32()), b);
+        }
+    }
+
+    m_mtlArray.resize(b.readInt32());
+    for (int i = 0; i < m_mtlArray.size(); ++i) {
+        m_mtlArray[i] = b.readString32();
+    }
+}
+
+
+shared_ptr<ArticulatedModel> ArticulatedModel::speedCreate(BinaryInput& b) {
+    const shared_ptr<ArticulatedModel> model(new ArticulatedModel());
+    model->speedDeserialize(b);
+    return model;
+}
+
+
+void ArticulatedModel::setSpeedLoadCacheDirectory(const String& directory) {
+    s_speedLoadCacheDirectory = directory;
+}
+
+
+const String& ArticulatedModel::speedLoadCacheDirectory() {
+    return s_speedLoadCacheDirectory;
+}
+
+
+/** Everything that affects the result of load() except for the source files themselves */
+static String speedLoadKey(const ArticulatedModel::Specification& specification) {
+    TextOutput::Settings settings;
+    settings.wordWrap = TextOutput::Settings::WRAP_NONE;
+    return specification.toAny().unparse(settings) + specification.colladaOptions.toAny().unparse(settings);
+}
+
+
+String ArticulatedModel::speedLoadCacheFilename(const Specification& specification) {
+    if (s_speedLoadCacheDirectory.empty()) {
+        return "";
+    }
+
+    const String& key = speedLoadKey(specification);
+    const MD5Hash& hash = Crypto::md5(key.c_str(), key.size());
+    String hex;
+    for (int i = 0; i < 16; ++i) {
+        hex += format("%02x", hash[i]);
+    }
+    return FilePath::concat(s_speedLoadCacheDirectory, FilePath::base(specification.filename) + "-" + hex + ".ArticulatedModel");
+}
+
+
+void ArticulatedModel::getSourceFilenames(const Specification& specification, Array<String>& filenames) const {
+    filenames.append(specification.filename);
+    const String& directory = FilePath::parent(specification.filename);
+    for (int i = 0; i < m_mtlArray.size(); ++i) {
+        if (! m_mtlArray[i].empty()) {
+            filenames.append(FileSystem::resolve(m_mtlArray[i], directory));
+        }
+    }
+}
+
+
+bool ArticulatedModel::loadFromSpeedLoadCache(const Specification& specification, const String& cacheFilename) {
+    if (! FileSystem::exists(cacheFilename, false)) {
+        return false;
+    }
+
+    BinaryInput b(cacheFilename, G3D_LITTLE_ENDIAN);
+    if ((b.readString(SpeedLoad::HEADER_LENGTH) != "ArticulatedModelCache") ||
+        (b.readUInt32() != SPEEDLOAD_VERSION) ||
+        (b.readString32() != speedLoadKey(specification))) {
+        // Written by another version of G3D, or an MD5 collision
+        return false;
+    }
+
+    // Reject the cache if any source file has changed since it was written
+    const int numSources = b.readInt32();
+    for (int i = 0; i < numSources; ++i) {
+        const String& filename = b.readString32();
+        const int64 size = b.readInt64();
+        if ((FileSystem::size(filename) != size) || FileSystem::isNewer(filename, cacheFilename)) {
+            return false;
+        }
+    }
+
+    speedDeserialize(b);
+    return true;
+}
+
+
+void ArticulatedModel::saveToSpeedLoadCache(const Specification& specification, const String& cacheFilename) const {
+    if (! supportsSpeedLoad()) {
+        logPrintf("ArticulatedModel: not caching %s because a material cannot be represented by a Specification\n", specification.filename.c_str());
+        return;
+    }
+
+    if (! FileSystem::exists(s_speedLoadCacheDirectory)) {
+        FileSystem::createDirectory(s_speedLoadCacheDirectory);
+    }
+
+    Array<String> sourceArray;
+    getSourceFilenames(specification, sourceArray);
+
+    // Write to a temporary file and then rename it, so that a concurrent or
+    // interrupted load never sees a partial cache file
+    const String& tempFilename = cacheFilename + ".tmp";
+    {
+        BinaryOutput b(tempFilename, G3D_LITTLE_ENDIAN);
+        SpeedLoad::writeHeader(b, "ArticulatedModelCache");
+        b.writeUInt32(SPEEDLOAD_VERSION);
+        b.writeString32(speedLoadKey(specification));
+        b.writeInt32(sourceArray.size());
+        for (int i = 0; i < sourceArray.size(); ++i) {
+            b.writeString32(sourceArray[i]);
+            b.writeInt64(FileSystem::size(sourceArray[i]));
+        }
+        speedSerialize(b);
+        b.commit();
+    }
+
+    if (FileSystem::exists(cacheFilename, false)) {
+        FileSystem::removeFile(cacheFilename);
+    }
+    FileSystem::rename(tempFilename, cacheFilename);
+}
+
+} // namespace G3D
@@ -3,7 +3,7 @@
 
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \created 2011-07-18
- \edited  2015-09-03
+ \edited  2026-10-17
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -12,15 +12,71 @@
 #include "G3D/AreaMemoryManager.h"
 #include "GLG3D/ArticulatedModel.h"
 #include "G3D/FastPointHashGrid.h"
+#include "G3D/ThreadPool.h"
+#include <atomic>
 
 namespace G3D {
-    
+
+/** Iterations per task in the data-parallel kernels. Smaller loops run on the calling thread. */
+static const int CLEAN_GEOMETRY_GRAIN_SIZE = 4096;
+
+/** Face arrays at least this large are welded by mergeVerticesParallel */
+static const int PARALLEL_MERGE_MIN_FACES = 1 << 16;
+
 void ArticulatedModel::cleanGeometry(const CleanGeometrySettings& settings) {
+    Stopwatch timer("ArticulatedModel::cleanGeometry");
+    timer.setEnabled(false);
+
+    // Release the GPU data on this thread, since the worker threads have no
+    // OpenGL context.  Geometry::cleanGeometry() then only releases empty arrays.
     for (int g = 0; g < m_geometryArray.size(); ++g) {
-        m_geometryArray[g]->cleanGeometry(settings, m_meshArray);
-        debugAssertM((m_geometryArray[g]->cpuVertexArray.size() == 0) ||
-            ! m_geometryArray[g]->cpuVertexArray.vertex[0].normal.isNaN(),
+        m_geometryArray[g]->clearAttributeArrays();
+    }
+    for (int m = 0; m < m_meshArray.size(); ++m) {
+        m_meshArray[m]->gpuIndexArray = IndexStream();
+    }
+
+    // Start the largest Geometry first so that a huge one does not
+    // begin after every thread has run out of small ones
+    Array<int> order;
+    order.resize(m_geometryArray.size());
+    for (int g = 0; g < order.size(); ++g) {
+        order[g] = g;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) {
+        return m_geometryArray[a]->cpuVertexArray.size() > m_geometryArray[b]->cpuVertexArray.size();
+    });
+
+    // Each Geometry affects only its own Meshes, so they are independent
+    timer.tick();
+    ThreadPool::parallelFor(0, order.size(), [&](int i, int threadID) {
+        Geometry* geometry = m_geometryArray[order[i]];
+        geometry->cleanGeometry(settings, m_meshArray);
+        debugAssertM((geometry->cpuVertexArray.size() == 0) ||
+            ! geometry->cpuVertexArray.vertex[0].normal.isNaN(),
             "Undefined normal remained after cleanGeometry");
+    }, 1);
+    timer.tock();
+
+    if (timer.enabled()) {
+        // Phases run concurrently on different Geometry, so their sum may exceed the elapsed time
+        Geometry::CleanGeometryTimes total;
+        for (int g = 0; g < m_geometryArray.size(); ++g) {
+            const Geometry::CleanGeometryTimes& t = m_geometryArray[g]->m_cleanGeometryTimes;
+            total.prepare           += t.prepare;
+            total.buildFaceArray    += t.buildFaceArray;
+            total.computeNormals    += t.computeNormals;
+            total.mergeVertices     += t.mergeVertices;
+            total.computeTangents   += t.computeTangents;
+            total.computeBounds     += t.computeBounds;
+        }
+        debugPrintf("%s: %d Geometry in %f s elapsed\n", name().c_str(), m_geometryArray.size(), timer.elapsedTime());
+        debugPrintf("  prepare              %f s\n", total.prepare);
+        debugPrintf("  buildFaceArray       %f s\n", total.buildFaceArray);
+        debugPrintf("  computeNormals       %f s\n", total.computeNormals);
+        debugPrintf("  mergeVertices        %f s\n", total.mergeVertices);
+        debugPrintf("  computeTangents      %f s\n", total.computeTangents);
+        debugPrintf("  computeBounds        %f s\n", total.computeBounds);
     }
 }
 
@@ -304,8 +360,17 @@ void ArticulatedModel::Geometry::subdivideUntilThresholdEdgeLength
 
 
 void ArticulatedModel::Geometry::cleanGeometry(const CleanGeometrySettings& settings, const Array<Mesh*>& meshes) {
+    m_cleanGeometryTimes = CleanGeometryTimes();
+
+    // Adds the time since the previous call to \a phase
     Stopwatch timer;
-    timer.setEnabled(false);
+    timer.tick();
+    const auto after = [&](RealTime& phase) {
+        timer.tock();
+        phase += timer.elapsedTime();
+        timer.tick();
+    };
+
     clearAttributeArrays();
     // The meshes that use this geometry
     Array<Mesh*> affectedMeshes;
@@ -314,24 +379,25 @@ void ArticulatedModel::Geometry::cleanGeometry(const CleanGeometrySettings& sett
         subdivideUntilThresholdEdgeLength(affectedMeshes, settings.maxEdgeLength);
     }
 
-    if (settings.forceComputeNormals) {
-        // Wipe the normal array
-        for (int i = 0; i < cpuVertexArray.size(); ++i) {
-            cpuVertexArray.vertex[i].normal = Vector3::nan();
-        }
-    }
-
-    if (settings.forceComputeTangents) {
-        // Wipe the tangent array
-        for (int i = 0; i < cpuVertexArray.size(); ++i) {
-            cpuVertexArray.vertex[i].tangent = Vector4::nan();
-        }
+    if (settings.forceComputeNormals || settings.forceComputeTangents) {
+        // Wipe the normal and tangent arrays
+        CPUVertexArray::Vertex* vertex = cpuVertexArray.vertex.getCArray();
+        ThreadPool::parallelForRange(0, cpuVertexArray.size(), [&](int begin, int end, int threadID) {
+            for (int i = begin; i < end; ++i) {
+                if (settings.forceComputeNormals) {
+                    vertex[i].normal = Vector3::nan();
+                }
+                if (settings.forceComputeTangents) {
+                    vertex[i].tangent = Vector4::nan();
+                }
+            }
+        }, CLEAN_GEOMETRY_GRAIN_SIZE);
     }
 
     bool computeSomeNormals  = settings.forceComputeNormals;
     bool computeSomeTangents = settings.forceComputeTangents;
     determineCleaningNeeds(computeSomeNormals, computeSomeTangents);
-    timer.after("  determineCleaningNeeds");
+    after(m_cleanGeometryTimes.prepare);
     
     if (computeSomeNormals || (settings.forceVertexMerging && settings.allowVertexMerging)) {
         // Expand into an un-indexed triangle list.  This allows us to consider
@@ -341,11 +407,11 @@ void ArticulatedModel::Geometry::cleanGeometry(const CleanGeometrySettings& sett
         adjacentFaceTable.clearAndSetMemoryManager(AreaMemoryManager::create());
 
         buildFaceArray(faceArray, adjacentFaceTable, affectedMeshes);
-        timer.after("  buildFaceArray");
+        after(m_cleanGeometryTimes.buildFaceArray);
 
         if (computeSomeNormals) {
             computeMissingVertexNormals(faceArray, adjacentFaceTable, settings.maxSmoothAngle);
-            timer.after("  computeMissingVertexNormals");
+            after(m_cleanGeometryTimes.computeNormals);
         }
     
         // Merge vertices that have nearly equal normals, positions, and texcoords.
@@ -353,7 +419,6 @@ void ArticulatedModel::Geometry::cleanGeometry(const CleanGeometrySettings& sett
         // solely from shared vertex information.
         if (settings.allowVertexMerging) {
             mergeVertices(faceArray, settings.maxNormalWeldAngle, affectedMeshes);
-            timer.after("  mergeVertices");
         } else if (computeSomeNormals) {
             // Write the vertex normal data from the face array back to the vertex
             // array. This is needed because we aren't merging geometry.
@@ -366,15 +431,17 @@ void ArticulatedModel::Geometry::cleanGeometry(const CleanGeometrySettings& sett
             }
         }
     }
-    timer.after("  deallocation of adjacentFaceTable");
+    // Includes deallocation of the face array and adjacentFaceTable
+    after(m_cleanGeometryTimes.mergeVertices);
 
     if (computeSomeTangents) {
         // Compute tangent space
         computeMissingTangents(affectedMeshes);
-        timer.after("  computeMissingTangents");
+        after(m_cleanGeometryTimes.computeTangents);
     }
 
     computeBounds(affectedMeshes);
+    after(m_cleanGeometryTimes.computeBounds);
 }
 
 
@@ -387,38 +454,46 @@ void ArticulatedModel::Geometry::clearAttributeArrays() {
     gpuVertexColorArray = AttributeArray();
     gpuBoneIndicesArray = AttributeArray();
     gpuBoneWeightsArray = AttributeArray();
+    ++m_changeCount;
 }
 
 
 void ArticulatedModel::Mesh::clearIndexStream() {
     gpuIndexArray = IndexStream();
+    m_triTree.reset();
 }
 
 
 void ArticulatedModel::Geometry::determineCleaningNeeds(bool& computeSomeNormals, bool& computeSomeTangents) {
-    computeSomeTangents = false;
-    computeSomeNormals = false;;
-
-    // See if normals are needed
-    for (int i = 0; i < cpuVertexArray.size(); ++i) {
-        if (isNaN(cpuVertexArray.vertex[i].normal.x)) {
-            computeSomeNormals = true;
-            computeSomeTangents = true;
-            // Wipe out the corresponding tangent vector
-            cpuVertexArray.vertex[i].tangent.x = fnan();
-        }
-    }
-    
-    // See if tangents are needed
-    if (! computeSomeTangents) {
-        // Maybe there is a NaN tangent in there
-        for (int i = 0; i < cpuVertexArray.size(); ++i) {
-            if (isNaN(cpuVertexArray.vertex[i].tangent.x)) {
-                computeSomeTangents = true;
-                break;
+    std::atomic<bool> anyNaNNormal(false);
+    std::atomic<bool> anyNaNTangent(false);
+    CPUVertexArray::Vertex* vertex = cpuVertexArray.vertex.getCArray();
+
+    ThreadPool::parallelForRange(0, cpuVertexArray.size(), [&](int begin, int end, int threadID) {
+        bool nanNormal = false;
+        bool nanTangent = false;
+        for (int i = begin; i < end; ++i) {
+            // See if normals are needed
+            if (isNaN(vertex[i].normal.x)) {
+                nanNormal = true;
+                // Wipe out the corresponding tangent vector
+                vertex[i].tangent.x = fnan();
             }
+
+            // Maybe there is a NaN tangent in there
+            nanTangent = nanTangent || isNaN(vertex[i].tangent.x);
         }
-    }    
+
+        if (nanNormal) {
+            anyNaNNormal = true;
+        }
+        if (nanTangent) {
+            anyNaNTangent = true;
+        }
+    }, CLEAN_GEOMETRY_GRAIN_SIZE);
+
+    computeSomeNormals = anyNaNNormal;
+    computeSomeTangents = anyNaNNormal || anyNaNTangent;
 }
 
 
@@ -493,29 +568,28 @@ void ArticulatedModel::Geometry::computeMissingTangents(const Array<Mesh*> affec
     // Compute all tangents, but only extract those that we need at the bottom.
 
     // See http://www.terathon.com/code/tangent.html for a derivation of the following code
-    Array<Vector3>  tangent1;
-    Array<Vector3>  tangent2;
-    tangent1.resize(cpuVertexArray.size());
-    tangent2.resize(cpuVertexArray.size());
-    Vector3* tan1 = tangent1.getCArray();
-    Vector3* tan2 = tangent2.getCArray();
-    CPUVertexArray::Vertex* vertexArray = cpuVertexArray.vertex.getCArray();
-    debugAssertM(tan1[0].x == 0, "This implementation assumes that new Vector3 values are initialized to zero.");
 
-    // For each face
+    // Concatenate the index arrays so that all triangles can be processed in one parallel loop
+    Array<int> allIndices;
     for (int m = 0; m < affectedMeshes.size(); ++m) {
-        const Mesh* mesh = affectedMeshes[m];        
-        const Array<int>& cpuIndexArray = mesh->cpuIndexArray;
-        const int* indexArray = cpuIndexArray.getCArray();
-
-        for (int i = 0; i < cpuIndexArray.size(); i += 3) {
-            const int i0 = indexArray[i];
-            const int i1 = indexArray[i + 1];
-            const int i2 = indexArray[i + 2];
-        
-            const CPUVertexArray::Vertex& vertex0 = vertexArray[i0];
-            const CPUVertexArray::Vertex& vertex1 = vertexArray[i1];
-            const CPUVertexArray::Vertex& vertex2 = vertexArray[i2];
+        allIndices.append(affectedMeshes[m]->cpuIndexArray);
+    }
+    const int* indexArray = allIndices.getCArray();
+    const int numTriangles = allIndices.size() / 3;
+
+    // Tangent directions of each triangle
+    Array<Vector3>  triangleS;
+    Array<Vector3>  triangleT;
+    triangleS.resize(numTriangles);
+    triangleT.resize(numTriangles);
+    CPUVertexArray::Vertex* vertexArray = cpuVertexArray.vertex.getCArray();
+
+    ThreadPool::parallelForRange(0, numTriangles, [&](int begin, int end, int threadID) {
+        for (int t = begin; t < end; ++t) {
+            const int i = 3 * t;
+            const CPUVertexArray::Vertex& vertex0 = vertexArray[indexArray[i]];
+            const CPUVertexArray::Vertex& vertex1 = vertexArray[indexArray[i + 1]];
+            const CPUVertexArray::Vertex& vertex2 = vertexArray[indexArray[i + 2]];
 
             const Point3& v0 = vertex0.position;
             const Point3& v1 = vertex1.position;
@@ -541,56 +615,69 @@ void ArticulatedModel::Geometry::computeMissingTangents(const Array<Mesh*> affec
         
             const float r = 1.0f / (s0 * t1 - s1 * t0);
             
-            const Vector3 sdir
+            triangleS[t] = Vector3
                 ((t1 * x0 - t0 * x1) * r, 
                  (t1 * y0 - t0 * y1) * r,
                  (t1 * z0 - t0 * z1) * r);
 
-            const Vector3 tdir
+            triangleT[t] = Vector3
                 ((s0 * x1 - s1 * x0) * r, 
                  (s0 * y1 - s1 * y0) * r,
                  (s0 * z1 - s1 * z0) * r);
-        
-            tan1[i0] += sdir;
-            tan1[i1] += sdir;
-            tan1[i2] += sdir;
-        
-            tan2[i0] += tdir;
-            tan2[i1] += tdir;
-            tan2[i2] += tdir;        
         } // For each triangle
-    } // For each mesh
+    }, CLEAN_GEOMETRY_GRAIN_SIZE);
 
-    for (int v = 0; v < cpuVertexArray.size(); ++v) {
-        CPUVertexArray::Vertex& vertex = vertexArray[v];
+    // Accumulate at the vertices in triangle order, so that the sums do
+    // not depend on the number of threads
+    Array<Vector3>  tangent1;
+    Array<Vector3>  tangent2;
+    tangent1.resize(cpuVertexArray.size());
+    tangent2.resize(cpuVertexArray.size());
+    Vector3* tan1 = tangent1.getCArray();
+    Vector3* tan2 = tangent2.getCArray();
+    debugAssertM((tangent1.size() == 0) || (tan1[0].x == 0), "This implementation assumes that new Vector3 values are initialized to zero.");
 
-        if (isNaN(vertex.tangent.x)) {
-            // This tangent needs to be overriden
-            const Vector3& n = vertex.normal;
-            const Vector3& t1 = tan1[v];
-            const Vector3& t2 = tan2[v];
+    for (int t = 0; t < numTriangles; ++t) {
+        const Vector3& sdir = triangleS[t];
+        const Vector3& tdir = triangleT[t];
+        for (int v = 0; v < 3; ++v) {
+            const int i = indexArray[3 * t + v];
+            tan1[i] += sdir;
+            tan2[i] += tdir;
+        }
+    }
+
+    ThreadPool::parallelForRange(0, cpuVertexArray.size(), [&](int begin, int end, int threadID) {
+        for (int v = begin; v < end; ++v) {
+            CPUVertexArray::Vertex& vertex = vertexArray[v];
+
+            if (isNaN(vertex.tangent.x)) {
+                // This tangent needs to be overriden
+                const Vector3& n = vertex.normal;
+                const Vector3& t1 = tan1[v];
+                const Vector3& t2 = tan2[v];
         
-            // Gram-Schmidt orthogonalize
-            const Vector3& T = (t1 - n * n.dot(t1)).directionOrZero();
-
-            if ( T.isZero() ) {
-                Vector3 tan1, tan2;
-                n.direction().getTangents(tan1, tan2);
-                const Vector3& tan = tan1.direction();
-                vertex.tangent.x = tan.x;
-                vertex.tangent.y = tan.y;
-                vertex.tangent.z = tan.z;
-            } else {
-                vertex.tangent.x = T.x;
-                vertex.tangent.y = T.y;
-                vertex.tangent.z = T.z;
-            }
+                // Gram-Schmidt orthogonalize
+                const Vector3& T = (t1 - n * n.dot(t1)).directionOrZero();
+
+                if ( T.isZero() ) {
+                    Vector3 tan1, tan2;
+                    n.direction().getTangents(tan1, tan2);
+                    const Vector3& tan = tan1.direction();
+                    vertex.tangent.x = tan.x;
+                    vertex.tangent.y = tan.y;
+                    vertex.tangent.z = tan.z;
+                } else {
+                    vertex.tangent.x = T.x;
+                    vertex.tangent.y = T.y;
+                    vertex.tangent.z = T.z;
+                }
 
-            // Calculate handedness
-            vertex.tangent.w = (n.cross(t1).dot(t2) < 0.0f) ? 1.0f : -1.0f;
-        } // if this must be updated
-    } // for each vertex
-    
+                // Calculate handedness
+                vertex.tangent.w = (n.cross(t1).dot(t2) < 0.0f) ? 1.0f : -1.0f;
+            } // if this must be updated
+        } // for each vertex
+    }, CLEAN_GEOMETRY_GRAIN_SIZE);
  }
 
  
@@ -609,8 +696,10 @@ void ArticulatedModel::Geometry::mergeVertices(const Array<Face>& faceArray, flo
     cpuVertexArray.boneIndices.fastClear();
     cpuVertexArray.boneWeights.fastClear();
 
-    Stopwatch timer;
-    timer.setEnabled(false);
+    if (faceArray.size() >= PARALLEL_MERGE_MIN_FACES) {
+        mergeVerticesParallel(faceArray, maxNormalWeldAngle);
+        return;
+    }
 
     // Track the location of vertices in cpuVertexArray by their exact texcoord and position.
     // The vertices in the list may have differing normals.
@@ -690,6 +779,158 @@ void ArticulatedModel::Geometry::mergeVertices(const Array<Face>& faceArray, flo
 }
 
 
+void ArticulatedModel::Geometry::mergeVerticesParallel(const Array<Face>& faceArray, float maxNormalWeldAngle) {
+    // Corner c is vertex c % 3 of face c / 3. The serial algorithm visits the
+    // corners in this order, creating a new vertex for each corner that does
+    // not match an earlier one.  This produces the same vertices in the same
+    // order by first finding each corner's representative--the earlier corner
+    // that it matches, or itself--and then numbering the representatives.
+    const int numCorners = faceArray.size() * 3;
+    const Face* face = faceArray.getCArray();
+
+    // Partition the corners into shards by hash code, so that corners that
+    // can match always share a shard, and keep their order within each shard
+    static const int NUM_SHARDS = 64;
+    Array<uint8> shardOfCorner;
+    shardOfCorner.resize(numCorners);
+    ThreadPool::parallelForRange(0, numCorners, [&](int begin, int end, int threadID) {
+        for (int c = begin; c < end; ++c) {
+            const uint64 h = uint64(Face::AMFaceVertexHash::hashCode(face[c / 3].vertex[c % 3])) * 0x9E3779B97F4A7C15ULL;
+            shardOfCorner[c] = uint8(h >> 58);
+        }
+    }, CLEAN_GEOMETRY_GRAIN_SIZE);
+
+    int shardStart[NUM_SHARDS + 1];
+    System::memset(shardStart, 0, sizeof(shardStart));
+    for (int c = 0; c < numCorners; ++c) {
+        ++shardStart[shardOfCorner[c] + 1];
+    }
+    for (int s = 0; s < NUM_SHARDS; ++s) {
+        shardStart[s + 1] += shardStart[s];
+    }
+
+    Array<int> sortedCorner;
+    sortedCorner.resize(numCorners);
+    {
+        int next[NUM_SHARDS];
+        System::memcpy(next, shardStart, sizeof(next));
+        for (int c = 0; c < numCorners; ++c) {
+            sortedCorner[next[shardOfCorner[c]]++] = c;
+        }
+    }
+    shardOfCorner.clear();
+
+    const float normalClosenessThreshold = cos(maxNormalWeldAngle);
+
+    Array<int> representative;
+    representative.resize(numCorners);
+    ThreadPool::parallelFor(0, NUM_SHARDS, [&](int s, int threadID) {
+        // Earlier representatives with each exact texcoord and position. They may have differing normals.
+        typedef SmallArray<int, 4> CornerList;
+        Table<Face::Vertex, CornerList, Face::AMFaceVertexHash, Face::AMFaceVertexHash> cornerTable;
+        cornerTable.clearAndSetMemoryManager(AreaMemoryManager::create());
+        cornerTable.setSizeHint((shardStart[s + 1] - shardStart[s]) / 6);
+
+        for (int i = shardStart[s]; i < shardStart[s + 1]; ++i) {
+            const int c = sortedCorner[i];
+            const Face::Vertex& vertex = face[c / 3].vertex[c % 3];
+            CornerList& list = cornerTable.getCreate(vertex);
+
+            int r = -1;
+            for (int j = 0; j < list.size(); ++j) {
+                // See if the normals are close (we know that the texcoords and positions match exactly)
+                const Vector3& otherNormal = face[list[j] / 3].vertex[list[j] % 3].normal;
+                if ((otherNormal.dot(vertex.normal) >= normalClosenessThreshold) 
+                    || otherNormal.isZero() || vertex.normal.isZero()) { 
+                    r = list[j];
+                    break;
+                }
+            }
+
+            if (r == -1) {
+                // This must be a new vertex
+                r = c;
+                list.append(c);
+            }
+            representative[c] = r;
+        }
+    }, 1);
+    sortedCorner.clear();
+
+    // Number the representatives in corner order by counting them in fixed-size chunks
+    static const int CHUNK_SIZE = 1 << 14;
+    const int numChunks = iCeil(numCorners / float(CHUNK_SIZE));
+    Array<int> chunkStart;
+    chunkStart.resize(numChunks + 1);
+    chunkStart[0] = 0;
+    ThreadPool::parallelFor(0, numChunks, [&](int k, int threadID) {
+        int count = 0;
+        for (int c = k * CHUNK_SIZE; c < min(numCorners, (k + 1) * CHUNK_SIZE); ++c) {
+            count += (representative[c] == c) ? 1 : 0;
+        }
+        chunkStart[k + 1] = count;
+    }, 1);
+    for (int k = 0; k < numChunks; ++k) {
+        chunkStart[k + 1] += chunkStart[k];
+    }
+
+    const int numVertices = chunkStart[numChunks];
+    cpuVertexArray.vertex.resize(numVertices);
+    if (cpuVertexArray.hasTexCoord1) {
+        cpuVertexArray.texCoord1.resize(numVertices);
+    }
+    if (cpuVertexArray.hasVertexColors) {
+        cpuVertexArray.vertexColors.resize(numVertices);
+    }
+    if (cpuVertexArray.hasBones) {
+        cpuVertexArray.boneIndices.resize(numVertices);
+        cpuVertexArray.boneWeights.resize(numVertices);
+    }
+
+    // Write the new vertices
+    Array<int> newIndex;
+    newIndex.resize(numCorners);
+    ThreadPool::parallelFor(0, numChunks, [&](int k, int threadID) {
+        int index = chunkStart[k];
+        for (int c = k * CHUNK_SIZE; c < min(numCorners, (k + 1) * CHUNK_SIZE); ++c) {
+            if (representative[c] == c) {
+                const Face::Vertex& vertex = face[c / 3].vertex[c % 3];
+                cpuVertexArray.vertex[index] = vertex;
+                if (cpuVertexArray.hasTexCoord1) {
+                    cpuVertexArray.texCoord1[index] = vertex.texCoord1;
+                }
+                if (cpuVertexArray.hasVertexColors) {
+                    cpuVertexArray.vertexColors[index] = vertex.vertexColor;
+                }
+                if (cpuVertexArray.hasBones) {
+                    cpuVertexArray.boneIndices[index] = vertex.boneIndices;
+                    cpuVertexArray.boneWeights[index] = vertex.boneWeights;
+                }
+                newIndex[c] = index;
+                ++index;
+            }
+        }
+    }, 1);
+
+    // Representatives precede the corners that they represent, which may be in other chunks
+    ThreadPool::parallelForRange(0, numCorners, [&](int begin, int end, int threadID) {
+        for (int c = begin; c < end; ++c) {
+            if (representative[c] != c) {
+                newIndex[c] = newIndex[representative[c]];
+            }
+        }
+    }, CLEAN_GEOMETRY_GRAIN_SIZE);
+
+    // Add only non-degenerate triangles
+    for (int f = 0; f < faceArray.size(); ++f) {
+        const int* vertexIndex = newIndex.getCArray() + 3 * f;
+        if ((vertexIndex[0] != vertexIndex[1]) && (vertexIndex[1] != vertexIndex[2]) && (vertexIndex[2] != vertexIndex[0])) {
+            face[f].mesh->cpuIndexArray.append(vertexIndex[0], vertexIndex[1], vertexIndex[2]);
+        }
+    }
+}
+
+
 void ArticulatedModel::Geometry::computeMissingVertexNormals
  (Array<Face>&                      faceArray, 
   const Face::AdjacentFaceTable&    adjacentFaceTable, 
@@ -697,61 +938,64 @@ void ArticulatedModel::Geometry::computeMissingVertexNormals
 
     const float smoothThreshold = cos(maximumSmoothAngle);
 
-    // Compute vertex normals as needed
-    for (int f = 0; f < faceArray.size(); ++f) {
-        Face& face = faceArray[f];
+    // Compute vertex normals as needed.  Each iteration only writes to its own
+    // face and only reads the face normals, so faces are independent.
+    ThreadPool::parallelForRange(0, faceArray.size(), [&](int begin, int end, int threadID) {
+        for (int f = begin; f < end; ++f) {
+            Face& face = faceArray[f];
 
-        for (int v = 0; v < 3; ++v) {
-            CPUVertexArray::Vertex& vertex = face.vertex[v];
-
-            // Only process vertices with normals that have been flagged as NaN
-            if (isNaN(vertex.normal.x)) {
-                // This normal needs to be computed
-                vertex.normal = Vector3::zero();
-                const Face::IndexArray& faceIndexArray = adjacentFaceTable.get(vertex.position);
-
-                // Did we arrive at this vertex by considering a denegerate face?
-                if (face.unitNormal.isZero()) {
-                    // This face has no normal (presumably this is a degenerate face formed by three collinear points), 
-                    // so just average adjacent ones directly.
-                    for (int i = 0; i < faceIndexArray.size(); ++i) {
-                        vertex.normal += faceArray[faceIndexArray[i]].normal;
-                    }
+            for (int v = 0; v < 3; ++v) {
+                CPUVertexArray::Vertex& vertex = face.vertex[v];
+
+                // Only process vertices with normals that have been flagged as NaN
+                if (isNaN(vertex.normal.x)) {
+                    // This normal needs to be computed
+                    vertex.normal = Vector3::zero();
+                    const Face::IndexArray& faceIndexArray = adjacentFaceTable.get(vertex.position);
+
+                    // Did we arrive at this vertex by considering a denegerate face?
+                    if (face.unitNormal.isZero()) {
+                        // This face has no normal (presumably this is a degenerate face formed by three collinear points), 
+                        // so just average adjacent ones directly.
+                        for (int i = 0; i < faceIndexArray.size(); ++i) {
+                            vertex.normal += faceArray[faceIndexArray[i]].normal;
+                        }
 
-                    if (vertex.normal.isZero()) {
-                        // All adjacent faces are degenerate--choose an arbitrary normal, since it won't matter.
-                        vertex.normal = Vector3::unitY();
-                    }
+                        if (vertex.normal.isZero()) {
+                            // All adjacent faces are degenerate--choose an arbitrary normal, since it won't matter.
+                            vertex.normal = Vector3::unitY();
+                        }
 
-                } else {
-                    // The face containing this vertex has a valid normal.  Consider all adjacent
-                    // faces and the angles that they subtend around the vertex.
-                    for (int i = 0; i < faceIndexArray.size(); ++i) {
-                        const Face& adjacentFace = faceArray[faceIndexArray[i]];
-                        const float cosAngle = face.unitNormal.dot(adjacentFace.unitNormal);
-
-                        // Only process if within the cutoff angle
-                        if (cosAngle >= smoothThreshold) {
-                            // These faces are close enough to be considered part of a
-                            // smooth surface.  Add the non-unit normal.
-                            vertex.normal += adjacentFace.normal;
+                    } else {
+                        // The face containing this vertex has a valid normal.  Consider all adjacent
+                        // faces and the angles that they subtend around the vertex.
+                        for (int i = 0; i < faceIndexArray.size(); ++i) {
+                            const Face& adjacentFace = faceArray[faceIndexArray[i]];
+                            const float cosAngle = face.unitNormal.dot(adjacentFace.unitNormal);
+
+                            // Only process if within the cutoff angle
+                            if (cosAngle >= smoothThreshold) {
+                                // These faces are close enough to be considered part of a
+                                // smooth surface.  Add the non-unit normal.
+                                vertex.normal += adjacentFace.normal;
+                            }
                         }
-                    }
 
-                    if (vertex.normal.isZero()) {
-                        // The faces must have been exactly opposed.  Revert to the face's normal.
-                        vertex.normal = face.unitNormal;
+                        if (vertex.normal.isZero()) {
+                            // The faces must have been exactly opposed.  Revert to the face's normal.
+                            vertex.normal = face.unitNormal;
+                        }
                     }
-                }
 
-                // Make the vertex normal unit length
-                vertex.normal = vertex.normal.directionOrZero();
-                debugAssertM(! vertex.normal.isNaN() && ! vertex.normal.isZero(),
-                    "computeMissingVertexNormals() produced an illegal value--"
-                    "the adjacent face normals were probably corrupt"); 
+                    // Make the vertex normal unit length
+                    vertex.normal = vertex.normal.directionOrZero();
+                    debugAssertM(! vertex.normal.isNaN() && ! vertex.normal.isZero(),
+                        "computeMissingVertexNormals() produced an illegal value--"
+                        "the adjacent face normals were probably corrupt"); 
+                }
             }
         }
-    }
+    }, CLEAN_GEOMETRY_GRAIN_SIZE);
 }
 
 
@@ -762,47 +1006,47 @@ void ArticulatedModel::Geometry::buildFaceArray
 
     faceArray.fastClear();
 
-    int triangleCount = 0;
-    for (int i = 0; i < affectedMeshes.size(); ++i) {
-        triangleCount += affectedMeshes[i]->triangleCount();
+    // Index of the first face of each mesh
+    Array<int> meshFirstFace;
+    meshFirstFace.resize(affectedMeshes.size() + 1);
+    meshFirstFace[0] = 0;
+    for (int m = 0; m < affectedMeshes.size(); ++m) {
+        meshFirstFace[m + 1] = meshFirstFace[m] + affectedMeshes[m]->cpuIndexArray.size() / 3;
     }
-    faceArray.reserve(triangleCount);
+    const int triangleCount = meshFirstFace.last();
+    faceArray.resize(triangleCount);
     adjacentFaceTable.setSizeHint(triangleCount / 2); // low ball estimate
 
-    // Maps positions to the faces adjacent to that position.  The valence of the average vertex in a closed mesh is 6, so
-    // allocate slightly more indices so that we rarely need to allocate extra heap space.
+    // For every indexed triangle, create a Face
+    ThreadPool::parallelForRange(0, triangleCount, [&](int begin, int end, int threadID) {
+        // Mesh containing face begin
+        int m = int(std::upper_bound(meshFirstFace.begin(), meshFirstFace.end(), begin) - meshFirstFace.begin()) - 1;
 
-    for (int m = 0; m < affectedMeshes.size(); ++m) {
-        Mesh* mesh = affectedMeshes[m];
-        const Array<int>& indexArray = mesh->cpuIndexArray;
-
-        // For every indexed triangle, create a Face
-        for (int i = 0; i < indexArray.size(); i += 3) {
-            const Face::Index faceIndex = faceArray.size();
-            Face& face = faceArray.next();
+        for (int f = begin; f < end; ++f) {
+            while (f >= meshFirstFace[m + 1]) {
+                ++m;
+            }
+            Mesh* mesh = affectedMeshes[m];
+            const int* index = mesh->cpuIndexArray.getCArray() + 3 * (f - meshFirstFace[m]);
+            Face& face = faceArray[f];
             face.mesh = mesh;
 
-            // Copy each vertex, updating the adjacency table
+            // Copy each vertex
             for (int v = 0; v < 3; ++v) {
-                int index = indexArray[i + v];
-                face.vertex[v] = Face::Vertex(cpuVertexArray.vertex[index], index);
+                face.vertex[v] = Face::Vertex(cpuVertexArray.vertex[index[v]], index[v]);
 
                 // Copy texCoord1s as well, if they exist
                 if (cpuVertexArray.hasTexCoord1) {
-                    face.vertex[v].texCoord1 = cpuVertexArray.texCoord1[index];
+                    face.vertex[v].texCoord1 = cpuVertexArray.texCoord1[index[v]];
                 }
                 if (cpuVertexArray.hasVertexColors) {
-                    face.vertex[v].vertexColor = cpuVertexArray.vertexColors[index];
+                    face.vertex[v].vertexColor = cpuVertexArray.vertexColors[index[v]];
                 }
                 if (cpuVertexArray.hasBones) {
-                    face.vertex[v].boneWeights = cpuVertexArray.boneWeights[index];
-                    face.vertex[v].boneIndices = cpuVertexArray.boneIndices[index];
+                    face.vertex[v].boneWeights = cpuVertexArray.boneWeights[index[v]];
+                    face.vertex[v].boneIndices = cpuVertexArray.boneIndices[index[v]];
                 }
-
-                // Record that this face is next to this vertex
-                adjacentFaceTable.getCreate(face.vertex[v].position).append(faceIndex);
             }
-            
 
             // Compute the non-unit and unit face normals
             face.normal = 
@@ -811,6 +1055,17 @@ void ArticulatedModel::Geometry::buildFaceArray
 
             face.unitNormal = face.normal.directionOrZero();
         }
+    }, CLEAN_GEOMETRY_GRAIN_SIZE);
+
+    // Maps positions to the faces adjacent to that position.  The valence of the average vertex in a closed mesh is 6, so
+    // allocate slightly more indices so that we rarely need to allocate extra heap space.
+    // Built in face order so that adjacency lists do not depend on the number of threads.
+    for (int f = 0; f < triangleCount; ++f) {
+        const Face& face = faceArray[f];
+        for (int v = 0; v < 3; ++v) {
+            // Record that this face is next to this vertex
+            adjacentFaceTable.getCreate(face.vertex[v].position).append(f);
+        }
     }
 }
 
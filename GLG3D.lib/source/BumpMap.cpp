@@ -2,7 +2,7 @@
  \file    BumpMap.cpp
  \author  Morgan McGuire, http://graphics.cs.williams.edu
  \created 2009-03-25
- \edited  2014-11-13
+ \edited  2026-10-17
  
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -43,6 +43,14 @@ BumpMap::Specification::Specification(const Any& any) {
 }
 
 
+Any BumpMap::Specification::toAny() const {
+    Any any(Any::TABLE, "BumpMap::Specification");
+    any["texture"] = texture;
+    any["settings"] = settings;
+    return any;
+}
+
+
 shared_ptr<BumpMap> BumpMap::speedCreate(BinaryInput& b) {
     shared_ptr<BumpMap> bump(new BumpMap());
 
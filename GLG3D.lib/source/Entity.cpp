@@ -137,6 +137,11 @@ void Entity::getLastBounds(Box& box) const {
 }
 
 
+void Entity::getLastObjectSpaceBounds(AABox& box) const {
+    box = m_lastObjectSpaceAABoxBounds;
+}
+
+
 void Entity::getLastBounds(Sphere& sphere) const {
     sphere = m_lastSphereBounds;
 }
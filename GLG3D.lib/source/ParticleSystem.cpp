@@ -4,7 +4,7 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2015-08-30
-  \edited  2016-02-14
+  \edited  2026-10-17
  
  G3D Library http://g3d.cs.williams.edu
  Copyright 2000-2015, Morgan McGuire morgan@cs.williams.edu
@@ -13,11 +13,13 @@
  */
 
 #include "G3D/Noise.h"
+#include "G3D/ThreadPool.h"
 #include "GLG3D/ParticleSystem.h"
 #include "GLG3D/ParticleSurface.h"
 #include "GLG3D/Scene.h"
 #include "G3D/Vector4uint16.h"
 #include "GLG3D/ParticleSystemModel.h"
+#include <emmintrin.h>
 
 namespace G3D {
 
@@ -324,6 +326,135 @@ void ParticleSystem::updateBounds() {
 }
 
 
+/** Scalar version of ParticleSystem::integrateParticles, for the particles that do not fill an SSE register */
+static void integrateParticle
+   (ParticleSystem::Particle&   P,
+    const Vector3&              gravitationalAcceleration,
+    const Vector3&              windVelocity,
+    float                       maxBrownianVelocity,
+    int                         brownianTemporalOffset,
+    float                       dt) {
+
+    // https://en.wikipedia.org/wiki/Drag_equation
+    const float area = pif() * square(P.radius);
+        
+    // Sample three, different artbitray noise functions
+    const Point3int32& fixedPos = Point3int32(P.position * 200.0f);
+    const Vector3 brownianDirection(Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.y + 10208, fixedPos.z + 55010, 2),
+                                    Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.z + 10208, fixedPos.x + 55010, 2),
+                                    Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.x + 10208, fixedPos.y + 55010, 2));
+    const Vector3& localWindVelocity = windVelocity + maxBrownianVelocity * brownianDirection;
+    const Vector3& relativeVelocity = localWindVelocity - P.velocity;
+    const Vector3& dragForce = relativeVelocity.directionOrZero() * (0.5f * 1.185f * relativeVelocity.squaredMagnitude() * P.dragCoefficient * area);
+        
+    const Vector3& acceleration = gravitationalAcceleration + dragForce / P.mass;
+        
+    P.velocity += acceleration * dt;
+    P.position += P.velocity * dt;
+    P.angle += P.angularVelocity * dt;
+}
+
+
+/** Rounds four floats to int32 the way Point3int32(Vector3) does: the +0.5 and the truncation
+    happen in double precision, so that large coordinates agree with the scalar path. */
+static inline void roundToInt4(__m128 v, int32* out) {
+    const __m128d half = _mm_set1_pd(0.5);
+    const __m128i lo = _mm_cvttpd_epi32(_mm_add_pd(_mm_cvtps_pd(v), half));
+    const __m128i hi = _mm_cvttpd_epi32(_mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(v, v)), half));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi64(lo, hi));
+}
+
+
+void ParticleSystem::integrateParticles
+   (Particle*                   particle,
+    int                         count,
+    const Vector3&              gravitationalAcceleration,
+    const Vector3&              windVelocity,
+    float                       maxBrownianVelocity,
+    int                         brownianTemporalOffset,
+    float                       dt) {
+
+    Noise& noise = Noise::common();
+
+    const __m128 dtv = _mm_set1_ps(dt);
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        Particle& P0 = particle[i];
+        Particle& P1 = particle[i + 1];
+        Particle& P2 = particle[i + 2];
+        Particle& P3 = particle[i + 3];
+
+        // Transpose into one register per component
+        __m128 px = _mm_setr_ps(P0.position.x, P1.position.x, P2.position.x, P3.position.x);
+        __m128 py = _mm_setr_ps(P0.position.y, P1.position.y, P2.position.y, P3.position.y);
+        __m128 pz = _mm_setr_ps(P0.position.z, P1.position.z, P2.position.z, P3.position.z);
+        __m128 vx = _mm_setr_ps(P0.velocity.x, P1.velocity.x, P2.velocity.x, P3.velocity.x);
+        __m128 vy = _mm_setr_ps(P0.velocity.y, P1.velocity.y, P2.velocity.y, P3.velocity.y);
+        __m128 vz = _mm_setr_ps(P0.velocity.z, P1.velocity.z, P2.velocity.z, P3.velocity.z);
+        const __m128 radius = _mm_setr_ps(P0.radius, P1.radius, P2.radius, P3.radius);
+        const __m128 drag   = _mm_setr_ps(P0.dragCoefficient, P1.dragCoefficient, P2.dragCoefficient, P3.dragCoefficient);
+        const __m128 mass   = _mm_setr_ps(P0.mass, P1.mass, P2.mass, P3.mass);
+
+        // Fixed-point noise coordinates, rounded as Point3int32(Vector3) does
+        const __m128 scale = _mm_set1_ps(200.0f);
+        int32 fixedX[4], fixedY[4], fixedZ[4];
+        roundToInt4(_mm_mul_ps(px, scale), fixedX);
+        roundToInt4(_mm_mul_ps(py, scale), fixedY);
+        roundToInt4(_mm_mul_ps(pz, scale), fixedZ);
+
+        const int32 time[4] = {brownianTemporalOffset, brownianTemporalOffset, brownianTemporalOffset, brownianTemporalOffset};
+        int32 a[4], b[4];
+        float bx[4], by[4], bz[4];
+        for (int j = 0; j < 4; ++j) { a[j] = fixedY[j] + 10208; b[j] = fixedZ[j] + 55010; }
+        noise.sampleFloat4(time, a, b, bx, 2);
+        for (int j = 0; j < 4; ++j) { a[j] = fixedZ[j] + 10208; b[j] = fixedX[j] + 55010; }
+        noise.sampleFloat4(time, a, b, by, 2);
+        for (int j = 0; j < 4; ++j) { a[j] = fixedX[j] + 10208; b[j] = fixedY[j] + 55010; }
+        noise.sampleFloat4(time, a, b, bz, 2);
+
+        // Relative velocity = wind + Brownian motion - particle velocity
+        const __m128 brownian = _mm_set1_ps(maxBrownianVelocity);
+        const __m128 rx = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(windVelocity.x), _mm_mul_ps(brownian, _mm_loadu_ps(bx))), vx);
+        const __m128 ry = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(windVelocity.y), _mm_mul_ps(brownian, _mm_loadu_ps(by))), vy);
+        const __m128 rz = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(windVelocity.z), _mm_mul_ps(brownian, _mm_loadu_ps(bz))), vz);
+
+        // Drag along the direction of the relative velocity with magnitude proportional to its square:
+        // direction * speed^2 = relativeVelocity * speed, which needs no division.
+        // Zero for tiny speeds, as in Vector3::directionOrZero.
+        const __m128 speed = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(rx, rx), _mm_mul_ps(ry, ry)), _mm_mul_ps(rz, rz)));
+        const __m128 area  = _mm_mul_ps(_mm_set1_ps(pif()), _mm_mul_ps(radius, radius));
+        __m128 k = _mm_mul_ps(_mm_mul_ps(_mm_set1_ps(0.5f * 1.185f), speed), _mm_mul_ps(drag, area));
+        k = _mm_and_ps(_mm_cmpge_ps(speed, _mm_set1_ps(0.0000001f)), _mm_div_ps(k, mass));
+
+        // Euler integration
+        vx = _mm_add_ps(vx, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(gravitationalAcceleration.x), _mm_mul_ps(rx, k)), dtv));
+        vy = _mm_add_ps(vy, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(gravitationalAcceleration.y), _mm_mul_ps(ry, k)), dtv));
+        vz = _mm_add_ps(vz, _mm_mul_ps(_mm_add_ps(_mm_set1_ps(gravitationalAcceleration.z), _mm_mul_ps(rz, k)), dtv));
+        px = _mm_add_ps(px, _mm_mul_ps(vx, dtv));
+        py = _mm_add_ps(py, _mm_mul_ps(vy, dtv));
+        pz = _mm_add_ps(pz, _mm_mul_ps(vz, dtv));
+        const __m128 angle = _mm_add_ps(_mm_setr_ps(P0.angle, P1.angle, P2.angle, P3.angle), 
+                                        _mm_mul_ps(_mm_setr_ps(P0.angularVelocity, P1.angularVelocity, P2.angularVelocity, P3.angularVelocity), dtv));
+
+        // Transpose back
+        float out[8][4];
+        _mm_storeu_ps(out[0], px);  _mm_storeu_ps(out[1], py);  _mm_storeu_ps(out[2], pz);
+        _mm_storeu_ps(out[3], vx);  _mm_storeu_ps(out[4], vy);  _mm_storeu_ps(out[5], vz);
+        _mm_storeu_ps(out[6], angle);
+        for (int j = 0; j < 4; ++j) {
+            Particle& P = particle[i + j];
+            P.position = Point3(out[0][j], out[1][j], out[2][j]);
+            P.velocity = Vector3(out[3][j], out[4][j], out[5][j]);
+            P.angle    = out[6][j];
+        }
+    }
+
+    for (; i < count; ++i) {
+        integrateParticle(particle[i], gravitationalAcceleration, windVelocity, maxBrownianVelocity, brownianTemporalOffset, dt);
+    }
+}
+
+
 void ParticleSystem::applyPhysics(float t, float dt) {
     debugAssert(notNull(m_physicsEnvironment));
     // Convert to the local reference frame
@@ -334,27 +465,13 @@ void ParticleSystem::applyPhysics(float t, float dt) {
     const float     maxBrownianVelocity         = m_physicsEnvironment->maxBrownianVelocity * 0.35f;
     const int       brownianTemporalOffset      = int(t * (m_physicsEnvironment->windVelocity.length() + 1.f) - 1000.0f); 
 
-    for (int i = 0; i < m_particle.size(); ++i) {
-        Particle& P = m_particle[i];
-        
-        // https://en.wikipedia.org/wiki/Drag_equation
-        const float area = pif() * square(P.radius);
-        
-        // Sample three, different artbitray noise functions
-        const Point3int32& fixedPos = Point3int32(P.position * 200.0f);
-        const Vector3 brownianDirection(Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.y + 10208, fixedPos.z + 55010, 2),
-                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.z + 10208, fixedPos.x + 55010, 2),
-                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.x + 10208, fixedPos.y + 55010, 2));
-        const Vector3& localWindVelocity = windVelocity + maxBrownianVelocity * brownianDirection;
-        const Vector3& relativeVelocity = localWindVelocity - P.velocity;
-        const Vector3& dragForce = relativeVelocity.directionOrZero() * (0.5f * 1.185f * relativeVelocity.squaredMagnitude() * P.dragCoefficient * area);
-        
-        const Vector3& acceleration = gravitationalAcceleration + dragForce / P.mass;
-        
-        P.velocity += acceleration * dt;
-        P.position += P.velocity * dt;
-        P.angle += P.angularVelocity * dt;
-    }
+    // Construct the noise tables before any worker uses them
+    Noise::common();
+
+    Particle* particle = m_particle.getCArray();
+    ThreadPool::parallelForRange(0, m_particle.size(), [&](int begin, int end, int threadID) {
+        integrateParticles(particle + begin, end - begin, gravitationalAcceleration, windVelocity, maxBrownianVelocity, brownianTemporalOffset, dt);
+    }, 2048);
     
     markChanged();
 }
@@ -3,25 +3,138 @@
  \author Morgan McGuire, http://graphics.cs.williams.edu
 
  \created 2009-01-01
- \edited  2013-07-21
+ \edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
 */
 #include "G3D/stringutils.h"
 #include "G3D/Log.h"
+#include "G3D/fileutils.h"
+#include "G3D/Set.h"
 #include "GLG3D/Profiler.h"
 #include "GLG3D/glcalls.h"
 #include "GLG3D/GLCaps.h"
 #include "GLG3D/glheaders.h"
 #include "GLG3D/RenderDevice.h"
+#include <atomic>
 
 namespace G3D {
-    
-__thread shared_ptr<Profiler::ThreadInfo>*  Profiler::s_threadInfo = NULL;
-__thread int                                Profiler::s_level = 0;
+
+class Profiler::EventDescription {
+public:
+    EventID         id;
+    String          name;
+    String          file;
+    int             line;
+
+    /** Hash of name, file, and line */
+    size_t          hash;
+};
+
+
+namespace {
+
+/** A beginEvent() or endEvent() call, as stored in a ThreadInfo ring */
+class Record {
+public:
+    /** Value of id for endEvent() records */
+    enum { END = -1 };
+
+    RealTime            time;
+    Profiler::EventID   id;
+    GLuint              queryID;
+
+    /** If true, the hint is the next entry of the hint ring */
+    bool                hasHint;
+};
+
+int s_nextThreadID = 0;
+
+}
+
+
+/** The ring is written only by the owning thread (the producer) and read
+    only by nextFrame() (the consumer).  Each side publishes its progress
+    through an atomic counter, so neither needs a lock. */
+class Profiler::ThreadInfo {
+public:
+    //////////////////////////////////////////////////
+    // Producer state
+
+    /** Power-of-two length.  Slot i % size() holds record i. */
+    Array<Record>                       ring;
+
+    /** Hints for records with hasHint, in the same order */
+    Array<String>                       hintRing;
+
+    /** Number of records ever written */
+    std::atomic<uint64>                 head;
+
+    uint64                              hintHead;
+
+    /** Recorded begins without a recorded end.  beginEvent() leaves room
+        in the ring for their end records so that ends are never dropped. */
+    int                                 numOpen;
+
+    /** Nesting depth including dropped events */
+    int                                 depth;
+
+    /** Depth of the outermost dropped event that is still open, or NONE */
+    int                                 skipDepth;
+
+    std::atomic<int>                    numDropped;
+
+    /** Cache for the String version of Profiler::beginEvent, keyed by the
+        hash of the name, file, and line */
+    Table<size_t, const EventDescription*> internCache;
+
+    /** GPU query objects available for use.*/
+    Array<GLuint>                       queryFreelist;
+
+    //////////////////////////////////////////////////
+    // Consumer state, protected by s_profilerMutex
+
+    /** Number of records that nextFrame() has consumed */
+    std::atomic<uint64>                 tail;
+
+    std::atomic<uint64>                 hintTail;
+
+    /** Stable identifier for trace export */
+    const int                           threadID;
+
+    /** Full tree of all events for the current frame on the current thread */
+    Array<Event>                        eventTree;
+
+    /** Indices of the ancestors of the current event, in eventTree */
+    Array<int>                          ancestorStack;
+
+    /** Full tree of events for the previous frame */
+    Array<Event>                        previousEventTree;
+
+    ThreadInfo(int capacity, int threadID);
+
+    ~ThreadInfo();
+
+    void beginEvent(EventID id, const String* hint);
+
+    void endEvent();
+
+    GLuint newQueryID();
+
+    /** Appends all complete top-level events in the ring to eventTree */
+    void drain(const Array<EventDescription*>& descriptionArray);
+};
+
+
+__thread Profiler::ThreadInfo*              Profiler::s_threadInfo = NULL;
 
 Array< shared_ptr<Profiler::ThreadInfo> >   Profiler::s_threadInfoArray;
+Array<Profiler::EventDescription*>          Profiler::s_eventDescriptionArray;
+int                                         Profiler::s_eventBufferSize = 1 << 16;
+int                                         Profiler::s_numDroppedEvents = 0;
+Array<Profiler::Event>*                     Profiler::s_traceCapture = NULL;
+Array<int>                                  Profiler::s_traceCaptureThread;
 GMutex                                      Profiler::s_profilerMutex;
 uint64                                      Profiler::s_frameNum = 0;
 bool                                        Profiler::s_enabled = false;
@@ -36,6 +149,16 @@ bool Profiler::LAUNCH_SHADER_timingEnabled() {
     return s_timeShaderLaunches;
 }
 
+
+Profiler::ThreadInfo::ThreadInfo(int capacity, int threadID) : 
+    head(0), hintHead(0), numOpen(0), depth(0), skipDepth(Event::NONE), numDropped(0), tail(0), hintTail(0), threadID(threadID) {
+
+    ring.resize(ceilPow2(max(capacity, 16)));
+    // Hints are uncommon, so they get a smaller ring
+    hintRing.resize(max(ring.size() / 16, 16));
+}
+
+
 GLuint Profiler::ThreadInfo::newQueryID() {
     if (queryFreelist.length() == 0) {
         queryFreelist.resize(queryFreelist.length() + 10);
@@ -47,138 +170,289 @@ GLuint Profiler::ThreadInfo::newQueryID() {
 
 
 Profiler::ThreadInfo::~ThreadInfo() {
-    glDeleteQueries(queryFreelist.length(), queryFreelist.getCArray());
-    queryFreelist.clear();
-    debugAssertGLOk();
+    if (queryFreelist.length() > 0) {
+        glDeleteQueries(queryFreelist.length(), queryFreelist.getCArray());
+        queryFreelist.clear();
+        debugAssertGLOk();
+    }
 }
 
 
-void Profiler::ThreadInfo::beginEvent(const String& name, const String& file, int line, const size_t baseHash, const String& hint) {
-    Event event; //eventTree.next();
-    event.m_hash = HashTrait<String>::hashCode(name) ^ HashTrait<String>::hashCode(file) ^ size_t(line) ^ HashTrait<String>::hashCode(hint);
-    if (ancestorStack.length() == 0) {
-        event.m_parentIndex = -1;
-    } else {
-        event.m_parentIndex = ancestorStack.last();
-        if (eventTree[event.m_parentIndex].m_numChildren == 0) {
-            ++eventTree[event.m_parentIndex].m_numChildren;
-            Event dummy;
-            dummy.m_name = "other";
-            dummy.m_file = eventTree[event.m_parentIndex].m_file;
-            dummy.m_line = eventTree[event.m_parentIndex].m_line;
-            dummy.m_level = s_level;
-            dummy.m_openGLStartID = GL_NONE;
-            dummy.m_openGLEndID = GL_NONE;
-            dummy.m_hash = eventTree[event.m_parentIndex].hash() ^ HashTrait<String>::hashCode(dummy.m_name);
-            dummy.m_parentIndex = ancestorStack.last();
-            eventTree.append(dummy);
-        }
-        ++eventTree[event.m_parentIndex].m_numChildren;
-        event.m_hash = eventTree[event.m_parentIndex].m_hash ^ event.m_hash;
-        const Event& prev = eventTree.last();
-        if (prev.m_name == name && prev.m_file == file && prev.m_line == line && prev.m_hint == hint) {
-            event.m_hash = prev.m_hash + 1;
+void Profiler::ThreadInfo::beginEvent(EventID id, const String* hint) {
+    const uint64 h = head.load(std::memory_order_relaxed);
+    const uint64 used = h - tail.load(std::memory_order_acquire);
+    if ((skipDepth != Event::NONE) || (used + numOpen + 2 > uint64(ring.size()))) {
+        // Drop this event and everything nested within it
+        if (skipDepth == Event::NONE) {
+            skipDepth = depth;
         }
+        ++depth;
+        numDropped.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
-    ancestorStack.push(eventTree.length());
 
+    Record& record = ring[int(h & (ring.size() - 1))];
+    record.id = id;
+    record.hasHint = false;
+    if (notNull(hint) && ! hint->empty() && (hintHead - hintTail.load(std::memory_order_acquire) < uint64(hintRing.size()))) {
+        // Assignment reuses the slot's storage
+        hintRing[int(hintHead & (hintRing.size() - 1))] = *hint;
+        ++hintHead;
+        record.hasHint = true;
+    }
+
+    record.queryID = GL_NONE;
     if (RenderDevice::current) {
         // Take a GPU sample
-        event.m_openGLStartID = newQueryID();
-        glQueryCounter(event.m_openGLStartID, GL_TIMESTAMP);
+        record.queryID = newQueryID();
+        glQueryCounter(record.queryID, GL_TIMESTAMP);
         debugAssertGLOk();
     }
 
     // Take a CPU sample
-    event.m_name = name;
-    event.m_file = file;
-    event.m_line = line;
-    event.m_hint = hint;
-    event.m_cpuStart = System::time();
-    event.m_level = s_level;
-    ++s_level;
-    eventTree.append(event);
+    record.time = System::time();
+
+    ++depth;
+    ++numOpen;
+    head.store(h + 1, std::memory_order_release);
 }
 
 
 void Profiler::ThreadInfo::endEvent() {
-    const int i = ancestorStack.pop();
+    debugAssertM(depth > 0, "Profiler::endEvent() called without a matching beginEvent()");
+    --depth;
+    if (skipDepth != Event::NONE) {
+        if (depth == skipDepth) {
+            skipDepth = Event::NONE;
+        }
+        return;
+    }
 
-    Event& event(eventTree[i]);
+    // beginEvent() reserved this slot
+    const uint64 h = head.load(std::memory_order_relaxed);
+    Record& record = ring[int(h & (ring.size() - 1))];
+    record.id = Record::END;
+    record.hasHint = false;
 
+    record.queryID = GL_NONE;
     if (RenderDevice::current) {
         // Take a GPU sample
-        event.m_openGLEndID = newQueryID();
-        glQueryCounter(event.m_openGLEndID, GL_TIMESTAMP);
+        record.queryID = newQueryID();
+        glQueryCounter(record.queryID, GL_TIMESTAMP);
         debugAssertGLOk();
     }
 
     // Take a CPU sample
-    event.m_cpuEnd = System::time();
-    --s_level;
+    record.time = System::time();
+
+    --numOpen;
+    head.store(h + 1, std::memory_order_release);
+}
+
+
+void Profiler::ThreadInfo::drain(const Array<EventDescription*>& descriptionArray) {
+    static const size_t otherHash = HashTrait<String>::hashCode("other");
+    static const size_t emptyHintHash = HashTrait<String>::hashCode("");
+
+    const uint64 h = head.load(std::memory_order_acquire);
+    const uint64 t = tail.load(std::memory_order_relaxed);
+    const int mask = ring.size() - 1;
+
+    // Leave events that are still open in the ring for the next frame
+    uint64 end = t;
+    int d = 0;
+    for (uint64 i = t; i < h; ++i) {
+        d += (ring[int(i & mask)].id == Record::END) ? -1 : 1;
+        if (d == 0) {
+            end = i + 1;
+        }
+    }
+
+    uint64 ht = hintTail.load(std::memory_order_relaxed);
+    for (uint64 i = t; i < end; ++i) {
+        const Record& record = ring[int(i & mask)];
+
+        if (record.id == Record::END) {
+            Event& event = eventTree[ancestorStack.pop()];
+            event.m_cpuEnd = record.time;
+            event.m_openGLEndID = record.queryID;
+            continue;
+        }
+
+        const EventDescription* description = descriptionArray[record.id];
+        Event event;
+        if (record.hasHint) {
+            event.m_hint = hintRing[int(ht & (hintRing.size() - 1))];
+            ++ht;
+        }
+        event.m_hash = description->hash ^ (record.hasHint ? HashTrait<String>::hashCode(event.m_hint) : emptyHintHash);
+
+        if (ancestorStack.length() == 0) {
+            event.m_parentIndex = Event::NONE;
+        } else {
+            event.m_parentIndex = ancestorStack.last();
+            Event& parent = eventTree[event.m_parentIndex];
+            if (parent.m_numChildren == 0) {
+                ++parent.m_numChildren;
+                Event dummy;
+                dummy.m_name = "other";
+                dummy.m_file = parent.m_file;
+                dummy.m_line = parent.m_line;
+                dummy.m_level = ancestorStack.length();
+                dummy.m_hash = parent.m_hash ^ otherHash;
+                dummy.m_parentIndex = event.m_parentIndex;
+                dummy.m_unaccounted = true;
+                eventTree.append(dummy);
+            }
+            // The append may have moved the parent
+            ++eventTree[event.m_parentIndex].m_numChildren;
+            event.m_hash = eventTree[event.m_parentIndex].m_hash ^ event.m_hash;
+            const Event& prev = eventTree.last();
+            if (prev.m_name == description->name && prev.m_file == description->file && prev.m_line == description->line && prev.m_hint == event.m_hint) {
+                event.m_hash = prev.m_hash + 1;
+            }
+        }
+
+        event.m_name = description->name;
+        event.m_file = description->file;
+        event.m_line = description->line;
+        event.m_cpuStart = record.time;
+        event.m_openGLStartID = record.queryID;
+        event.m_level = ancestorStack.length();
+        ancestorStack.push(eventTree.length());
+        eventTree.append(event);
+    }
+
+    hintTail.store(ht, std::memory_order_release);
+    tail.store(end, std::memory_order_release);
 }
 
 //////////////////////////////////////////////////////////////////////////
 
-int Profiler::calculateUnaccountedTime(Array<Event>& eventTree, const int index, RealTime& cpuTime, RealTime& gpuTime) {
-    const Event& event = eventTree[index];
-    
-    if (event.m_numChildren == 0) {
-        cpuTime = event.cpuDuration();
-        gpuTime = event.gfxDuration();
-        return index + 1;    
-    }        
-    
-    int childIndex = index + 2;
-    RealTime totalChildCpu = 0;
-    RealTime totalChildGfx = 0;
-    for (int child = 1; child < event.m_numChildren; ++child) {
-        RealTime childCpu = 0;
-        RealTime childGfx = 0;
-        childIndex = calculateUnaccountedTime(eventTree, childIndex, childCpu, childGfx);
-        totalChildCpu += childCpu;
-        totalChildGfx += childGfx;
-    }
-
-    Event& dummy = eventTree[index + 1];
-    dummy.m_cpuStart = 0;
-    dummy.m_cpuEnd = event.cpuDuration() - totalChildCpu;
-    dummy.m_gfxStart = 0;
-    dummy.m_gfxEnd = event.gfxDuration() - totalChildGfx;
-
-    cpuTime = event.cpuDuration();
-    gpuTime = event.gfxDuration();
-    return childIndex;
-}
-
+int Profiler::calculateUnaccountedTime(Array<Event>& eventTree, const int index, RealTime& cpuTime, RealTime& gpuTime) {
+    const Event& event = eventTree[index];
+    
+    if (event.m_numChildren == 0) {
+        cpuTime = event.cpuDuration();
+        gpuTime = event.gfxDuration();
+        return index + 1;    
+    }        
+    
+    int childIndex = index + 2;
+    RealTime totalChildCpu = 0;
+    RealTime totalChildGfx = 0;
+    for (int child = 1; child < event.m_numChildren; ++child) {
+        RealTime childCpu = 0;
+        RealTime childGfx = 0;
+        childIndex = calculateUnaccountedTime(eventTree, childIndex, childCpu, childGfx);
+        totalChildCpu += childCpu;
+        totalChildGfx += childGfx;
+    }
+
+    Event& dummy = eventTree[index + 1];
+    dummy.m_cpuStart = 0;
+    dummy.m_cpuEnd = event.cpuDuration() - totalChildCpu;
+    dummy.m_gfxStart = 0;
+    dummy.m_gfxEnd = event.gfxDuration() - totalChildGfx;
+
+    cpuTime = event.cpuDuration();
+    gpuTime = event.gfxDuration();
+    return childIndex;
+}
+
 void Profiler::threadShutdownHook() {
     GMutexLock lock(&s_profilerMutex);
-    const int i = s_threadInfoArray.findIndex(*s_threadInfo);
-    alwaysAssertM(i != -1, "Could not find thread info during thread destruction for Profiler");
-    s_threadInfoArray.remove(i);
+    if (isNull(s_threadInfo)) {
+        // This thread never recorded an event
+        return;
+    }
 
-    delete s_threadInfo;
+    int i = 0;
+    while ((i < s_threadInfoArray.length()) && (s_threadInfoArray[i].get() != s_threadInfo)) {
+        ++i;
+    }
+    alwaysAssertM(i < s_threadInfoArray.length(), "Could not find thread info during thread destruction for Profiler");
+    s_threadInfoArray.remove(i);
     s_threadInfo = NULL;
 }
 
 
+Profiler::ThreadInfo* Profiler::threadInfo() {
+    if (isNull(s_threadInfo)) {
+        // First time that this thread invoked beginEvent--intialize it
+        GMutexLock lock(&s_profilerMutex);
+        const shared_ptr<ThreadInfo> info(new ThreadInfo(s_eventBufferSize, s_nextThreadID));
+        ++s_nextThreadID;
+        s_threadInfoArray.append(info);
+        s_threadInfo = info.get();
+    }
+    return s_threadInfo;
+}
+
+
+Profiler::EventID Profiler::internEventLocked(const String& name, const String& file, int line) {
+    // Interning happens once per call site, so a linear search is fine
+    for (int i = 0; i < s_eventDescriptionArray.length(); ++i) {
+        const EventDescription* d = s_eventDescriptionArray[i];
+        if ((d->line == line) && (d->name == name) && (d->file == file)) {
+            return d->id;
+        }
+    }
+
+    EventDescription* d = new EventDescription();
+    d->id   = s_eventDescriptionArray.length();
+    d->name = name;
+    d->file = file;
+    d->line = line;
+    d->hash = HashTrait<String>::hashCode(name) ^ HashTrait<String>::hashCode(file) ^ size_t(line);
+    s_eventDescriptionArray.append(d);
+    return d->id;
+}
+
+
+Profiler::EventID Profiler::internEvent(const String& name, const String& file, int line) {
+    GMutexLock lock(&s_profilerMutex);
+    return internEventLocked(name, file, line);
+}
+
+
+void Profiler::beginEvent(EventID id) {
+    if (! s_enabled) { return; }
+    threadInfo()->beginEvent(id, NULL);
+}
+
+
+void Profiler::beginEvent(EventID id, const String& hint) {
+    if (! s_enabled) { return; }
+    threadInfo()->beginEvent(id, &hint);
+}
+
+
 void Profiler::beginEvent(const String& name, const String& file, int line, const size_t baseHash, const String& hint) {
+    (void)baseHash;
     if (! s_enabled) { return; }
+    ThreadInfo* info = threadInfo();
 
-    if (isNull(s_threadInfo)) {
-        // First time that this thread invoked beginEvent--intialize it
-        s_threadInfo = new shared_ptr<ThreadInfo>(new ThreadInfo());
+    const size_t key = HashTrait<String>::hashCode(name) ^ HashTrait<String>::hashCode(file) ^ size_t(line);
+    const EventDescription** cached = info->internCache.getPointer(key);
+    EventID id;
+    if (notNull(cached) && ((*cached)->line == line) && ((*cached)->name == name) && ((*cached)->file == file)) {
+        id = (*cached)->id;
+    } else {
         GMutexLock lock(&s_profilerMutex);
-        s_threadInfoArray.append(*s_threadInfo);
+        id = internEventLocked(name, file, line);
+        if (isNull(cached)) {
+            info->internCache.set(key, s_eventDescriptionArray[id]);
+        }
     }
 
-    (*s_threadInfo)->beginEvent(name, file, line, baseHash, hint);
+    info->beginEvent(id, &hint);
 }
 
 
 void Profiler::endEvent() {
     if (! s_enabled) { return; }
-    (*s_threadInfo)->endEvent();
+    threadInfo()->endEvent();
 }
 
 
@@ -187,16 +461,29 @@ void Profiler::setEnabled(bool e) {
 }
 
 
+void Profiler::setEventBufferSize(int numRecords) {
+    GMutexLock lock(&s_profilerMutex);
+    s_eventBufferSize = numRecords;
+}
+
+
 void Profiler::nextFrame() {
     if (! s_enabled) { return; }
 
     GMutexLock lock(&s_profilerMutex);
-    debugAssertGLOk();
+    if (RenderDevice::current) {
+        debugAssertGLOk();
+    }
+
+    s_numDroppedEvents = 0;
 
     // For each thread
     for (int t = 0; t < s_threadInfoArray.length(); ++t) {
         shared_ptr<ThreadInfo> info = s_threadInfoArray[t];
 
+        info->drain(s_eventDescriptionArray);
+        s_numDroppedEvents += info->numDropped.exchange(0, std::memory_order_relaxed);
+
         for (int e = 0; e < info->eventTree.length(); ++e) {
             Event& event = info->eventTree[e];
             if (event.m_openGLStartID != GL_NONE) {
@@ -238,6 +525,15 @@ void Profiler::nextFrame() {
         RealTime a, b;
         for (int e = 0; e < info->eventTree.length(); e = calculateUnaccountedTime(info->eventTree, e, a, b));
 
+        if (notNull(s_traceCapture)) {
+            for (int e = 0; e < info->eventTree.length(); ++e) {
+                if (! info->eventTree[e].m_unaccounted) {
+                    s_traceCapture->append(info->eventTree[e]);
+                    s_traceCaptureThread.append(info->threadID);
+                }
+            }
+        }
+
         // Swap pointers (to avoid a massive array copy)
         Array<Event>::swap(info->previousEventTree, info->eventTree);
 
@@ -248,6 +544,7 @@ void Profiler::nextFrame() {
     ++s_frameNum;
 }
 
+
 void Profiler::getEvents(Array<const Array<Event>*>& eventTrees) {
     eventTrees.fastClear();
     GMutexLock lock(&s_profilerMutex);
@@ -257,4 +554,97 @@ void Profiler::getEvents(Array<const Array<Event>*>& eventTrees) {
     }
 }
 
+
+void Profiler::startTraceCapture() {
+    GMutexLock lock(&s_profilerMutex);
+    delete s_traceCapture;
+    s_traceCapture = new Array<Event>();
+    s_traceCaptureThread.clear();
+}
+
+
+/** Quotes and escapes \a s for JSON */
+static String jsonString(const String& s) {
+    String result = "\"";
+    for (size_t i = 0; i < s.size(); ++i) {
+        const char c = s[i];
+        switch (c) {
+        case '"':  result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n";  break;
+        case '\r': result += "\\r";  break;
+        case '\t': result += "\\t";  break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                result += format("\\u%04x", int(c));
+            } else {
+                result += c;
+            }
+        }
+    }
+    return result + "\"";
+}
+
+
+void Profiler::stopTraceCapture(const String& filename) {
+    GMutexLock lock(&s_profilerMutex);
+    if (isNull(s_traceCapture)) {
+        return;
+    }
+    const Array<Event>& eventArray = *s_traceCapture;
+
+    // CPU times are relative to the first event. The GPU clock has an
+    // arbitrary baseline, so align the first GPU event with its CPU start.
+    RealTime cpuBase = finf();
+    RealTime gfxBase = finf();
+    RealTime gfxOffset = 0;
+    for (int e = 0; e < eventArray.length(); ++e) {
+        const Event& event = eventArray[e];
+        cpuBase = min(cpuBase, event.m_cpuStart);
+        if (! isNaN(event.m_gfxStart) && (event.m_gfxStart < gfxBase)) {
+            gfxBase = event.m_gfxStart;
+            gfxOffset = event.m_cpuStart - event.m_gfxStart;
+        }
+    }
+
+    static const int CPU_PID = 1;
+    static const int GPU_PID = 2;
+
+    String json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    json += format("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"CPU\"}},\n", CPU_PID);
+    json += format("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"GPU\"}}", GPU_PID);
+
+    Set<int> namedThreads;
+    for (int e = 0; e < eventArray.length(); ++e) {
+        const Event& event = eventArray[e];
+        const int tid = s_traceCaptureThread[e];
+        if (! namedThreads.contains(tid)) {
+            namedThreads.insert(tid);
+            json += format(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"Thread %d\"}}", CPU_PID, tid, tid);
+        }
+
+        String args = format("{\"file\":%s,\"line\":%d", jsonString(event.m_file).c_str(), event.m_line);
+        if (! event.m_hint.empty()) {
+            args += ",\"hint\":" + jsonString(event.m_hint);
+        }
+        args += "}";
+
+        const String name = jsonString(event.m_name);
+        json += format(",\n{\"name\":%s,\"cat\":\"CPU\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":%s}",
+                       name.c_str(), (event.m_cpuStart - cpuBase) * 1e6, event.cpuDuration() * 1e6, CPU_PID, tid, args.c_str());
+
+        if (! isNaN(event.m_gfxStart)) {
+            json += format(",\n{\"name\":%s,\"cat\":\"GPU\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":%s}",
+                           name.c_str(), (event.m_gfxStart + gfxOffset - cpuBase) * 1e6, event.gfxDuration() * 1e6, GPU_PID, tid, args.c_str());
+        }
+    }
+    json += "\n]}\n";
+
+    writeWholeFile(filename, json);
+
+    delete s_traceCapture;
+    s_traceCapture = NULL;
+    s_traceCaptureThread.clear();
+}
+
 } // namespace G3D
@@ -23,6 +23,7 @@
 #include "GLG3D/Skybox.h"
 #include "GLG3D/ParticleSystemModel.h"
 #include "GLG3D/GFont.h"
+#include <algorithm>
 
 using namespace G3D::units;
 
@@ -48,6 +49,7 @@ void Scene::onSimulation(SimTime deltaTime) {
         m_lastEditingTime = System::time();
     }
 
+    updateEntityTree(true);
 }
 
 
@@ -169,7 +171,8 @@ Scene::Scene(const shared_ptr<AmbientOcclusion>& ambientOcclusion) :
     m_lastLightChangeTime(0),
     m_editing(false),
     m_lastEditingTime(0),
-    m_needEntitySort(false) {
+    m_needEntitySort(false),
+    m_entityTreeNeedsRebuild(true) {
 
     m_localLightingEnvironment.ambientOcclusion = ambientOcclusion;
     registerEntitySubclass("VisibleEntity",  &VisibleEntity::create);
@@ -190,6 +193,10 @@ void Scene::clear() {
     m_entityTable.clear();
     m_entityArray.fastClear();
     m_cameraArray.fastClear();
+    m_entityTree.clear();
+    m_entityTreeArray.fastClear();
+    m_unboundedEntityArray.fastClear();
+    m_entityTreeNeedsRebuild = true;
     m_localLightingEnvironment = LightingEnvironment();
     m_localLightingEnvironment.ambientOcclusion = old;
     m_skybox.reset();
@@ -467,7 +474,7 @@ void Scene::remove(const shared_ptr<Entity>& entity) {
     debugAssert(notNull(entity));
     m_entityTable.remove(entity->name());
     m_entityArray.remove(m_entityArray.findIndex(entity));
-
+    m_entityTreeNeedsRebuild = true;
 
     const shared_ptr<VisibleEntity>& visible = dynamic_pointer_cast<VisibleEntity>(entity);
     if (notNull(visible)) {
@@ -494,6 +501,7 @@ shared_ptr<Entity> Scene::insert(const shared_ptr<Entity>& entity) {
     debugAssertM(! m_entityTable.containsKey(entity->name()), "Two Entitys with the same name, \"" + entity->name() + "\"");
     m_entityTable.set(entity->name(), entity);
     m_entityArray.append(entity);
+    m_entityTreeNeedsRebuild = true;
     m_lastStructuralChangeTime = System::time();
     
     const shared_ptr<VisibleEntity>& visible = dynamic_pointer_cast<VisibleEntity>(entity);
@@ -553,37 +561,159 @@ void Scene::onPose(Array<shared_ptr<Surface> >& surfaceArray) {
     for (int e = 0; e < m_entityArray.size(); ++e) {
         m_entityArray[e]->onPose(surfaceArray);
     }
+
+    updateEntityTree(true);
+}
+
+
+Scene::IndexedEntity::IndexedEntity(const shared_ptr<Entity>& e) : 
+    entity(e), 
+    isMarker(notNull(dynamic_pointer_cast<MarkerEntity>(e))) {}
+
+
+/** True if \a box can be placed in an AABoxTree */
+static bool isBounded(const AABox& box) {
+    return ! box.isEmpty() && box.isFinite();
+}
+
+
+/** World-space bounds of \a entity for the entity tree.  Entitys compute
+    their bounds in onPose(), but onSimulation() moves them first, so the
+    last posed bounds are merged with the object-space bounds placed at the
+    current frame.  That covers rigid motion since the last pose; other
+    changes of shape appear after the next onPose(). */
+static void getCurrentBounds(const Entity* entity, AABox& box) {
+    entity->getLastBounds(box);
+
+    AABox objectSpaceBox;
+    entity->getLastObjectSpaceBounds(objectSpaceBox);
+    if (isBounded(box) && isBounded(objectSpaceBox)) {
+        AABox moved;
+        entity->frame().toWorldSpace(objectSpaceBox).getBounds(moved);
+        box.merge(moved);
+    }
+}
+
+
+void Scene::updateEntityTree(bool refit) const {
+    if (! refit && ! m_entityTreeNeedsRebuild) {
+        // Common case for queries
+        return;
+    }
+
+    GMutexLock lock(&m_entityTreeMutex);
+    Array<AABox> boundsArray;
+    boundsArray.resize(m_entityTreeArray.size());
+
+    if (! m_entityTreeNeedsRebuild && refit) {
+        for (int e = 0; (e < m_entityTreeArray.size()) && ! m_entityTreeNeedsRebuild; ++e) {
+            getCurrentBounds(m_entityTreeArray[e].entity.get(), boundsArray[e]);
+            m_entityTreeNeedsRebuild = ! isBounded(boundsArray[e]);
+        }
+
+        for (int e = 0; (e < m_unboundedEntityArray.size()) && ! m_entityTreeNeedsRebuild; ++e) {
+            AABox box;
+            getCurrentBounds(m_unboundedEntityArray[e].entity.get(), box);
+            m_entityTreeNeedsRebuild = isBounded(box);
+        }
+
+        if (! m_entityTreeNeedsRebuild) {
+            // Moving Entitys only changes the bounds of the top level
+            m_entityTree.refit(boundsArray);
+        }
+    }
+
+    if (m_entityTreeNeedsRebuild) {
+        m_entityTreeArray.fastClear();
+        m_unboundedEntityArray.fastClear();
+        boundsArray.fastClear();
+        for (int e = 0; e < m_entityArray.size(); ++e) {
+            AABox box;
+            getCurrentBounds(m_entityArray[e].get(), box);
+            if (isBounded(box)) {
+                m_entityTreeArray.append(IndexedEntity(m_entityArray[e]));
+                boundsArray.append(box);
+            } else {
+                m_unboundedEntityArray.append(IndexedEntity(m_entityArray[e]));
+            }
+        }
+        m_entityTree.setContents(boundsArray);
+        m_entityTreeNeedsRebuild = false;
+    }
+}
+
+
+/** Sorts the Entitys of \a exclude into \a sorted, so that each candidate of a query
+    is tested with a binary search instead of a scan of \a exclude */
+static void sortExcluded(const Array<shared_ptr<Entity> >& exclude, Array<const Entity*>& sorted) {
+    sorted.resize(exclude.size());
+    for (int i = 0; i < exclude.size(); ++i) {
+        sorted[i] = exclude[i].get();
+    }
+    std::sort(sorted.getCArray(), sorted.getCArray() + sorted.size());
+}
+
+
+static bool isExcluded(const Array<const Entity*>& sorted, const shared_ptr<Entity>& entity) {
+    return (sorted.size() > 0) && std::binary_search(sorted.getCArray(), sorted.getCArray() + sorted.size(), (const Entity*)entity.get());
 }
 
 
 shared_ptr<Entity> Scene::intersectBounds(const Ray& ray, float& distance, bool intersectMarkers, const Array<shared_ptr<Entity> >& exclude) const {
+    updateEntityTree(false);
     shared_ptr<Entity> closest;
+
+    Array<const Entity*> excluded;
+    sortExcluded(exclude, excluded);
     
-    for (int e = 0; e < m_entityArray.size(); ++e) {
-        const shared_ptr<Entity>& entity = m_entityArray[e];
-        if ((intersectMarkers || isNull(dynamic_pointer_cast<MarkerEntity>(entity))) &&
-            ! exclude.contains(entity) && 
-            entity->intersectBounds(ray, distance)) {
-            closest = entity;
+    for (int e = 0; e < m_unboundedEntityArray.size(); ++e) {
+        const IndexedEntity& indexed = m_unboundedEntityArray[e];
+        if ((intersectMarkers || ! indexed.isMarker) &&
+            ! isExcluded(excluded, indexed.entity) && 
+            indexed.entity->intersectBounds(ray, distance)) {
+            closest = indexed.entity;
         }
     }
 
+    m_entityTree.intersectRay(ray, distance, [&](int e, float& distance) {
+        const IndexedEntity& indexed = m_entityTreeArray[e];
+        if ((intersectMarkers || ! indexed.isMarker) &&
+            ! isExcluded(excluded, indexed.entity) && 
+            indexed.entity->intersectBounds(ray, distance)) {
+            closest = indexed.entity;
+        }
+    });
+
     return closest;
 }
 
 
 shared_ptr<Entity> Scene::intersect(const Ray& ray, float& distance, bool intersectMarkers, const Array<shared_ptr<Entity> >& exclude, Model::HitInfo& info) const {
+    updateEntityTree(false);
     shared_ptr<Entity> closest;
+
+    Array<const Entity*> excluded;
+    sortExcluded(exclude, excluded);
     
-    for (int e = 0; e < m_entityArray.size(); ++e) {
-        const shared_ptr<Entity>& entity = m_entityArray[e];
-        if ((intersectMarkers || isNull(dynamic_pointer_cast<MarkerEntity>(entity))) &&
-            ! exclude.contains(entity) &&
-            entity->intersect(ray, distance, info)) {
-            closest = entity;
+    for (int e = 0; e < m_unboundedEntityArray.size(); ++e) {
+        const IndexedEntity& indexed = m_unboundedEntityArray[e];
+        if ((intersectMarkers || ! indexed.isMarker) &&
+            ! isExcluded(excluded, indexed.entity) &&
+            indexed.entity->intersect(ray, distance, info)) {
+            closest = indexed.entity;
         }
     }
 
+    // Nearest Entitys first, so that their hits cull the rest
+    m_entityTree.intersectRay(ray, distance, [&](int e, float& distance) {
+        const IndexedEntity& indexed = m_entityTreeArray[e];
+        if ((intersectMarkers || ! indexed.isMarker) &&
+            ! isExcluded(excluded, indexed.entity) &&
+            indexed.entity->intersect(ray, distance, info)) {
+            closest = indexed.entity;
+        }
+    });
+
     return closest;
 }
 
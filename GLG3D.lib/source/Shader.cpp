@@ -1233,21 +1233,20 @@ void Shader::handleRecoverableError(RecoverableErrorType eType,  const Args& arg
 
 
 shared_ptr<Shader::ShaderProgram> Shader::shaderProgram(const Args& args, String& messages){
-    const String& preambleAndMacroString = args.preambleAndMacroString();
-
-    shared_ptr<ShaderProgram>* sp = m_compilationCache.getPointer(preambleAndMacroString);
+    // Keyed by the variant hash so that cache hits build no strings
+    shared_ptr<ShaderProgram>* sp = m_compilationCache.getPointer(args);
     shared_ptr<ShaderProgram> s;
 
     if (isNull(sp)) { 
         // There was no cached value
 		debugAssertGLOk();
 
-        s = ShaderProgram::create(m_preprocessedSource, preambleAndMacroString, args, m_indexToFilenameTable);
+        s = ShaderProgram::create(m_preprocessedSource, args.preambleAndMacroString(), args, m_indexToFilenameTable);
         debugAssertGLOk();
         sp = &s;        
         
         if (s->ok) {
-            m_compilationCache.set(preambleAndMacroString, s);
+            m_compilationCache.set(args, s);
         } else {
             messages = s->messages;
             return shared_ptr<ShaderProgram>();
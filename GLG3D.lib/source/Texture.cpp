@@ -4,7 +4,7 @@
  \author Morgan McGuire, http://graphics.cs.williams.edu
 
  \created 2001-02-28
- \edited  2016-06-01
+ \edited  2026-10-17
 
  Copyright 2000-2016, Morgan McGuire.
  All rights reserved.
@@ -15,7 +15,8 @@
 #include "G3D/Rect2D.h"
 #include "G3D/fileutils.h"
 #include "G3D/FileSystem.h"
-#include "G3D/ThreadSet.h"
+#include "G3D/ImageLoader.h"
+#include "G3D/GMutex.h"
 #include "G3D/ImageFormat.h"
 #include "G3D/CoordinateFrame.h"
 #include "GLG3D/glcalls.h"
@@ -182,8 +183,14 @@ shared_ptr<Texture> Texture::uniformRandom() {
 
 //////////////////////////////////////////////////////////
 
+namespace _internal {
+    /** Discards decodes started by Texture::prefetch that were never consumed */
+    static void clearPendingDecodes();
+}
+
 void Texture::clearCache() {
     s_cache.clear();
+    _internal::clearPendingDecodes();
 }
 
 WeakCache<uint64, shared_ptr<Texture> > Texture::s_allTextures;
@@ -830,117 +837,146 @@ static void transform(shared_ptr<Image>& image, const CubeMapConvention::CubeMap
 }
 
 
-shared_ptr<Texture> Texture::loadTextureFromSpec(const Texture::Specification& s) {
-    shared_ptr<Texture> t;
-
-    
-
-    if (s.alphaFilename.empty()) {
-        t = Texture::fromFile(s.filename, s.encoding, s.dimension, s.generateMipMaps, s.preprocess, s.assumeSRGBSpaceForAuto);
-    } else {
-        t = Texture::fromTwoFiles(s.filename, s.alphaFilename, s.encoding, s.dimension, s.generateMipMaps, s.preprocess, s.assumeSRGBSpaceForAuto, false);
-    }
-
-    if (s.filename == "<white>" && (! s.encoding.readMultiplyFirst.isOne() || ! s.encoding.readAddSecond.isZero())) {
-        t->m_name = String("Color4") + (s.encoding.readMultiplyFirst + s.encoding.readAddSecond).toString();
-        t->m_appearsInTextureBrowserWindow = false;
-    }
+namespace _internal {
 
-    if (s.name != "") {
-        t->m_name = s.name;
-    }
+static Texture::Dimension fileDimension(const String& filename, Texture::Dimension dimension) {
+    if (filename.find('*') != String::npos) {
+        String filenameBase, filenameExt;
+        Texture::splitFilenameAtWildCard(filename, filenameBase, filenameExt);
 
-    return t;
-}
+        // Cube map formats:
+        if ((FileSystem::exists(filenameBase + "east" + filenameExt)) || (FileSystem::exists(filenameBase + "lf" + filenameExt)) || 
+            (FileSystem::exists(filenameBase + "+x" + filenameExt)) || (FileSystem::exists(filenameBase + "+X" + filenameExt)) || 
+            (FileSystem::exists(filenameBase + "PX" + filenameExt)) || 
+            (FileSystem::exists(filenameBase + "px" + filenameExt))) {
 
-Texture::TexelType Texture::texelType() const {
-    const ImageFormat* f = format();
-    if (f->numberFormat == ImageFormat::INTEGER_FORMAT) {
-        if (f->openGLDataFormat == GL_UNSIGNED_BYTE ||
-            f->openGLDataFormat == GL_UNSIGNED_SHORT ||
-            f->openGLDataFormat == GL_UNSIGNED_INT) {
-            return TexelType::UNSIGNED_INTEGER;
+            return Texture::DIM_CUBE_MAP;
         } else {
-            return TexelType::INTEGER;
-        }
-    }
-    return TexelType::FLOAT;
-}
-
-shared_ptr<Texture> Texture::create(const Specification& s) {
-    if (s.cachable) {
-        if ((s.filename == "<white>") && s.alphaFilename.empty() && (s.dimension == DIM_2D) && s.encoding.readMultiplyFirst.isOne() && s.encoding.readAddSecond.isZero()) {
-            // Make a single white texture when the other properties don't matter
-            return Texture::white();
-        } else {
-            shared_ptr<Texture> cachedValue = s_cache[s];
-            if (isNull(cachedValue)) {
-                cachedValue = loadTextureFromSpec(s);
-                s_cache.set(s, cachedValue);
-            }
-            return cachedValue;
+            // Must be a texture array
+            return Texture::DIM_2D_ARRAY;
         }
+    } else if ((dimension == Texture::DIM_CUBE_MAP) && (filename != "<white>")) {
+        return Texture::DIM_2D;
     } else {
-        return loadTextureFromSpec(s);
+        return dimension;
     }
 }
 
 
-class ImageLoaderThread : public GThread {
-private:
-    String         m_filename;
-    shared_ptr<Image>&         m_image;
-    const ImageFormat*         m_format;
+/** The images for one Texture after decoding and CPU preprocessing,
+    ready to upload on the thread that owns the OpenGL context. */
+class DecodedTexture {
 public:
-    
-    ImageLoaderThread(const String& filename, shared_ptr<Image>& im, const ImageFormat* format = ImageFormat::AUTO()) : 
-        GThread(filename), m_filename(filename), m_image(im) { m_format = format; }
+    String                                      name;
+    Texture::Dimension                          dimension;
+    Texture::Encoding                           encoding;
+
+    /** The steps of the requested preprocessing that remain to be
+        applied during the upload */
+    Texture::Preprocess                         preprocess;
+
+    /** One element per cube map face, or a single element holding
+        every layer of a DIM_2D_ARRAY texture */
+    Array<shared_ptr<CPUPixelTransferBuffer> >  faceArray;
+
+    /** Applies the parts of preprocess that do not require OpenGL, in
+        the same order as Texture::fromMemory, and removes them from
+        preprocess.  Steps that the data does not support are left for
+        fromMemory to report. */
+    void applyCPUPreprocess() {
+        const ImageFormat* format = faceArray[0]->format();
+
+        if (((preprocess.modulate != Color4::one()) || (preprocess.gammaAdjust != 1.0f) || preprocess.convertToPremultipliedAlpha) &&
+            ((format->code == ImageFormat::CODE_R8) || (format->code == ImageFormat::CODE_L8) ||
+             (format->code == ImageFormat::CODE_RGB8) || (format->code == ImageFormat::CODE_RGBA8))) {
+
+            for (int f = 0; f < faceArray.size(); ++f) {
+                const shared_ptr<CPUPixelTransferBuffer>& face = faceArray[f];
+                const int numBytes = iCeil(face->width() * face->height() * format->cpuBitsPerPixel / 8.0f);
+                preprocess.modulateImage(format->code, face->buffer(), numBytes);
+            }
+
+            preprocess.modulate = Color4::one();
+            preprocess.gammaAdjust = 1.0f;
+            preprocess.convertToPremultipliedAlpha = false;
+        }
+
+        if (preprocess.computeNormalMap && (faceArray.size() == 1) &&
+            ((format->redBits == 8) || (format->luminanceBits == 8)) && ! format->compressed && ! format->floatingPoint &&
+            ((format->numComponents == 1) || (format->numComponents == 3) || (format->numComponents == 4))) {
+
+            const shared_ptr<CPUPixelTransferBuffer> heightField = faceArray[0];
+            faceArray[0] = dynamic_pointer_cast<CPUPixelTransferBuffer>
+                (BumpMap::computeNormalMap(heightField->width(), heightField->height(), format->numComponents, 
+                                           reinterpret_cast<const unorm8*>(heightField->buffer()), preprocess.bumpMapPreprocess));
+            debugAssert(notNull(faceArray[0]));
 
-    void threadMain() {
-        m_image = Image::fromFile(m_filename, m_format);
+            preprocess.computeNormalMap = false;
+            if (encoding.format == ImageFormat::AUTO()) {
+                encoding.format = ImageFormat::RGBA8();
+            }
+            debugAssertM(encoding.format->openGLBaseFormat == GL_RGBA, "Desired format must contain RGBA channels for bump mapping");
+        }
     }
 };
 
 
-shared_ptr<Texture> Texture::fromFile
+static shared_ptr<Image> whiteImage() {
+    const shared_ptr<Image>& image = Image::fromPixelTransferBuffer(CPUPixelTransferBuffer::create(1, 1, ImageFormat::RGBA8()));
+    image->set(Point2int32(0, 0), Color4unorm8::one());
+    return image;
+}
+
+
+/** Loads and preprocesses the images for Texture::fromFile.  Does not
+    require OpenGL, so it may run on an ImageLoader worker.  Cube map
+    faces and array layers are decoded concurrently.
+
+    \param convertL8 If true, L8 images are expanded to RGB8 because
+    the GPU does not support L8 textures. */
+static shared_ptr<DecodedTexture> decodeTextureFiles
    (const String                    filename[6],
-    Encoding                        desiredEncoding,
-    Dimension                       dimension,
-    bool                            generateMipMaps,
-    const Preprocess&               preprocess,
-    bool                            preferSRGBSpaceForAuto) {
-    
+    Texture::Encoding               desiredEncoding,
+    Texture::Dimension              dimension,
+    const Texture::Preprocess&      preprocess,
+    bool                            convertL8,
+    int                             priority) {
+
+    const shared_ptr<DecodedTexture> decoded(new DecodedTexture());
+    decoded->name       = FilePath::base(filename[0]);
+    decoded->dimension  = dimension;
+    decoded->preprocess = preprocess;
+
     if (endsWith(toLower(filename[0]), ".exr") && (desiredEncoding.format == ImageFormat::AUTO())) {
         desiredEncoding.format = ImageFormat::RGBA32F();
     }
+    decoded->encoding = desiredEncoding;
     
-    if (dimension == DIM_2D_ARRAY) {
+    if (dimension == Texture::DIM_2D_ARRAY) {
         Array<String> files;
         FileSystem::getFiles(filename[0], files, true);
         files.sort();
 
-        Array < shared_ptr<Image> > images;
-        images.resize(files.length());
-        ThreadSet threadSet;
+        Array<ImageLoader::Future> futures;
+        futures.resize(files.size());
+        for (int i = 0; i < files.size(); ++i) {
+            futures[i] = ImageLoader::load(files[i], ImageFormat::AUTO(), priority);
+        }
+
+        Array< shared_ptr<Image> > images;
+        images.resize(files.size());
         for (int i = 0; i < files.size(); ++i) {
-            threadSet.insert(shared_ptr<ImageLoaderThread>(new ImageLoaderThread(files[i], images[i])));
+            images[i] = ImageLoader::wait(futures[i]);
         }
-        threadSet.start(GThread::USE_CURRENT_THREAD);
-        threadSet.waitForCompletion();
 
-        return Texture::fromPixelTransferBuffer(FilePath::base(filename[0]), Image::arrayToPixelTransferBuffer(images), desiredEncoding.format, dimension);
+        // Preprocessing has never been applied to arrays
+        decoded->faceArray.append(Image::arrayToPixelTransferBuffer(images));
+        return decoded;
     }
 
     String realFilename[6];
-    Array< Array< const void* > > byteMipMapFaces;
 
-    const int numFaces = (dimension == DIM_CUBE_MAP) ? 6 : 1;
-
-    // Single mip-map level
-    byteMipMapFaces.resize(1);
-    
-    Array<const void*>& array = byteMipMapFaces[0];
-    array.resize(numFaces);
+    const int numFaces = (dimension == Texture::DIM_CUBE_MAP) ? 6 : 1;
 
     debugAssertM(filename[1] == "",
         "Can't specify more than one filename");
@@ -957,35 +993,34 @@ shared_ptr<Texture> Texture::fromFile
     // The six cube map faces, or the one texture and 5 dummys.
     shared_ptr<Image> image[6];
 
-    if (((numFaces == 1) && (dimension == DIM_2D)) || (dimension == DIM_3D)) {
+    if (((numFaces == 1) && (dimension == Texture::DIM_2D)) || (dimension == Texture::DIM_3D)) {
         if ((toLower(realFilename[0]) == "<white>") || realFilename[0].empty()) {
-            const shared_ptr<CPUPixelTransferBuffer>& buffer = CPUPixelTransferBuffer::create(1, 1, ImageFormat::RGBA8());
-            image[0] = Image::fromPixelTransferBuffer(buffer);
-            image[0]->set(Point2int32(0, 0), Color4unorm8::one());
+            image[0] = whiteImage();
         } else {
+            // Decode directly; this is either on a worker already or the caller has nothing else to do
             image[0] = Image::fromFile(realFilename[0]);
 
             alwaysAssertM(image[0]->width() > 0, 
                 G3D::format("Image not found: \"%s\" and GImage failed to throw an exception", realFilename[0].c_str()));
         }
     } else {
-        // Load each cube face on a different thread to overlap compute and I/O
-        ThreadSet threadSet;
-
+        // Overlap the faces' compute and I/O on the ImageLoader workers
+        ImageLoader::Future future[6];
         for (int f = 0; f < numFaces; ++f) {
             if ((toLower(realFilename[f]) == "<white>") || realFilename[f].empty()) {
-                const shared_ptr<CPUPixelTransferBuffer>& buffer = CPUPixelTransferBuffer::create(1, 1, ImageFormat::RGBA8());
-                image[f] = Image::fromPixelTransferBuffer(buffer);
-                image[f]->set(Point2int32(0, 0), Color4unorm8::one());
+                image[f] = whiteImage();
             } else {
-                threadSet.insert(shared_ptr<ImageLoaderThread>(new ImageLoaderThread(realFilename[f], image[f])));
+                future[f] = ImageLoader::load(realFilename[f], ImageFormat::AUTO(), priority);
+            }
+        }
+
+        for (int f = 0; f < numFaces; ++f) {
+            if (future[f].valid()) {
+                image[f] = ImageLoader::wait(future[f]);
             }
         }
-        threadSet.start(GThread::USE_CURRENT_THREAD);
-        threadSet.waitForCompletion();
     }
 
-    shared_ptr<PixelTransferBuffer> buffers[6];
     for (int f = 0; f < numFaces; ++f) {
         //debugPrintf("Loading %s\n", realFilename[f].c_str());
         alwaysAssertM(image[f]->width() > 0,  "Image not found");
@@ -995,36 +1030,188 @@ shared_ptr<Texture> Texture::fromFile
             transform(image[f], info.face[f]);
         }
         
-        if (! GLCaps::supportsTexture(image[f]->format())) {
-            if (image[f]->format() == ImageFormat::L8()) {
-                image[f]->convertToRGB8();
-            } else { 
-                debugAssertM(false, "Unsupported texture format on this machine");
-            }
+        if (convertL8 && (image[f]->format() == ImageFormat::L8())) {
+            image[f]->convertToRGB8();
         }
 
-        const shared_ptr<CPUPixelTransferBuffer>& b = image[f]->toPixelTransferBuffer();
-        buffers[f] = b;
-        array[f] = b->buffer();
-    }
-
-    const shared_ptr<Texture>& t =
-        fromMemory(FilePath::base(filename[0]), 
-                   byteMipMapFaces, 
-                   buffers[0]->format(),
-                   buffers[0]->width(), 
-                   buffers[0]->height(), 
-                   1,
-                   1,
-                   desiredEncoding, 
-                   dimension,
-                   generateMipMaps,
-                   preprocess,
-                   preferSRGBSpaceForAuto);
-    
+        decoded->faceArray.append(image[f]->toPixelTransferBuffer());
+    }
+
+    decoded->applyCPUPreprocess();
+
+    return decoded;
+}
+
+
+static shared_ptr<Texture> uploadDecodedTexture(const DecodedTexture& decoded, bool generateMipMaps, bool preferSRGBSpaceForAuto) {
+    if (decoded.dimension == Texture::DIM_2D_ARRAY) {
+        return Texture::fromPixelTransferBuffer(decoded.name, decoded.faceArray[0], decoded.encoding.format, decoded.dimension);
+    }
+
+    Array< Array< const void* > > byteMipMapFaces;
+
+    // Single mip-map level
+    byteMipMapFaces.resize(1);
+    for (int f = 0; f < decoded.faceArray.size(); ++f) {
+        debugAssertM(GLCaps::supportsTexture(decoded.faceArray[f]->format()), "Unsupported texture format on this machine");
+        byteMipMapFaces[0].append(decoded.faceArray[f]->buffer());
+    }
+
+    const shared_ptr<CPUPixelTransferBuffer>& first = decoded.faceArray[0];
+    return Texture::fromMemory
+        (decoded.name, 
+         byteMipMapFaces, 
+         first->format(),
+         first->width(), 
+         first->height(), 
+         1,
+         1,
+         decoded.encoding, 
+         decoded.dimension,
+         generateMipMaps,
+         decoded.preprocess,
+         preferSRGBSpaceForAuto);
+}
+
+
+typedef std::shared_future<shared_ptr<DecodedTexture> > DecodedTextureFuture;
+
+/** Decodes started by Texture::prefetch that have not yet been uploaded */
+static Table<Texture::Specification, DecodedTextureFuture>& pendingDecodeTable() {
+    static Table<Texture::Specification, DecodedTextureFuture> t;
     return t;
 }
 
+static GMutex& pendingDecodeMutex() {
+    static GMutex m;
+    return m;
+}
+
+
+static void startPendingDecode(const Texture::Specification& s, bool convertL8, int priority) {
+    GMutexLock lock(&pendingDecodeMutex());
+    if (pendingDecodeTable().containsKey(s)) {
+        return;
+    }
+
+    const shared_ptr<std::promise<shared_ptr<DecodedTexture> > > promise(new std::promise<shared_ptr<DecodedTexture> >());
+    pendingDecodeTable().set(s, DecodedTextureFuture(promise->get_future()));
+
+    ImageLoader::enqueue([promise, s, convertL8, priority]() {
+        try {
+            String f[6];
+            f[0] = s.filename;
+            promise->set_value(decodeTextureFiles(f, s.encoding, fileDimension(s.filename, s.dimension), s.preprocess, convertL8, priority));
+        } catch (...) {
+            promise->set_exception(std::current_exception());
+        }
+    }, priority);
+}
+
+
+static bool takePendingDecode(const Texture::Specification& s, DecodedTextureFuture& future) {
+    GMutexLock lock(&pendingDecodeMutex());
+    Texture::Specification removedKey;
+    return pendingDecodeTable().getRemove(s, removedKey, future);
+}
+
+
+static void clearPendingDecodes() {
+    GMutexLock lock(&pendingDecodeMutex());
+    pendingDecodeTable().clear();
+}
+
+} // namespace _internal
+
+
+shared_ptr<Texture> Texture::loadTextureFromSpec(const Texture::Specification& s) {
+    shared_ptr<Texture> t;
+
+    _internal::DecodedTextureFuture pending;
+    if (s.alphaFilename.empty() && _internal::takePendingDecode(s, pending)) {
+        // Started by prefetch()
+        t = _internal::uploadDecodedTexture(*ImageLoader::wait(pending), s.generateMipMaps, s.assumeSRGBSpaceForAuto);
+    } else if (s.alphaFilename.empty()) {
+        t = Texture::fromFile(s.filename, s.encoding, s.dimension, s.generateMipMaps, s.preprocess, s.assumeSRGBSpaceForAuto);
+    } else {
+        t = Texture::fromTwoFiles(s.filename, s.alphaFilename, s.encoding, s.dimension, s.generateMipMaps, s.preprocess, s.assumeSRGBSpaceForAuto, false);
+    }
+
+    if (s.filename == "<white>" && (! s.encoding.readMultiplyFirst.isOne() || ! s.encoding.readAddSecond.isZero())) {
+        t->m_name = String("Color4") + (s.encoding.readMultiplyFirst + s.encoding.readAddSecond).toString();
+        t->m_appearsInTextureBrowserWindow = false;
+    }
+
+    if (s.name != "") {
+        t->m_name = s.name;
+    }
+
+    return t;
+}
+
+
+void Texture::prefetch(const Specification& s, int priority) {
+    if (! s.alphaFilename.empty() || s.filename.empty() || beginsWith(s.filename, "<")) {
+        // Only textures loaded from a single file are decoded asynchronously
+        return;
+    }
+
+    if (s.cachable && notNull(s_cache[s])) {
+        return;
+    }
+
+    const bool convertL8 = ! GLCaps::supportsTexture(ImageFormat::L8());
+    _internal::startPendingDecode(s, convertL8, priority);
+}
+
+Texture::TexelType Texture::texelType() const {
+    const ImageFormat* f = format();
+    if (f->numberFormat == ImageFormat::INTEGER_FORMAT) {
+        if (f->openGLDataFormat == GL_UNSIGNED_BYTE ||
+            f->openGLDataFormat == GL_UNSIGNED_SHORT ||
+            f->openGLDataFormat == GL_UNSIGNED_INT) {
+            return TexelType::UNSIGNED_INTEGER;
+        } else {
+            return TexelType::INTEGER;
+        }
+    }
+    return TexelType::FLOAT;
+}
+
+shared_ptr<Texture> Texture::create(const Specification& s) {
+    if (s.cachable) {
+        if ((s.filename == "<white>") && s.alphaFilename.empty() && (s.dimension == DIM_2D) && s.encoding.readMultiplyFirst.isOne() && s.encoding.readAddSecond.isZero()) {
+            // Make a single white texture when the other properties don't matter
+            return Texture::white();
+        } else {
+            shared_ptr<Texture> cachedValue = s_cache[s];
+            if (isNull(cachedValue)) {
+                cachedValue = loadTextureFromSpec(s);
+                s_cache.set(s, cachedValue);
+            }
+            return cachedValue;
+        }
+    } else {
+        return loadTextureFromSpec(s);
+    }
+}
+
+
+shared_ptr<Texture> Texture::fromFile
+   (const String                    filename[6],
+    Encoding                        desiredEncoding,
+    Dimension                       dimension,
+    bool                            generateMipMaps,
+    const Preprocess&               preprocess,
+    bool                            preferSRGBSpaceForAuto) {
+
+    const bool convertL8 = ! GLCaps::supportsTexture(ImageFormat::L8());
+    const shared_ptr<_internal::DecodedTexture>& decoded = 
+        _internal::decodeTextureFiles(filename, desiredEncoding, dimension, preprocess, convertL8, ImageLoader::DEFAULT_PRIORITY);
+
+    return _internal::uploadDecodedTexture(*decoded, generateMipMaps, preferSRGBSpaceForAuto);
+}
+
 
 shared_ptr<Texture> Texture::fromFile
    (const String&           filename,
@@ -1042,27 +1229,7 @@ shared_ptr<Texture> Texture::fromFile
     f[4] = "";
     f[5] = "";
 
-    if (filename.find('*') != String::npos) {
-        CubeMapConvention::CubeMapInfo info;
-        String filenameBase, filenameExt;
-        Texture::splitFilenameAtWildCard(filename, filenameBase, filenameExt);
-
-        // Cube map formats:
-        if ((FileSystem::exists(filenameBase + "east" + filenameExt)) || (FileSystem::exists(filenameBase + "lf" + filenameExt)) || 
-            (FileSystem::exists(filenameBase + "+x" + filenameExt)) || (FileSystem::exists(filenameBase + "+X" + filenameExt)) || 
-            (FileSystem::exists(filenameBase + "PX" + filenameExt)) || 
-            (FileSystem::exists(filenameBase + "px" + filenameExt))) {
-
-            dimension = DIM_CUBE_MAP;
-        } else {
-            // Must be a texture array
-            dimension = DIM_2D_ARRAY;
-        }
-    } else if ((dimension == DIM_CUBE_MAP) && (filename != "<white>")) {
-        dimension = DIM_2D;
-    }
-
-    return fromFile(f, desiredEncoding, dimension, generateMipMaps, preprocess, preferSRGBSpaceForAuto);
+    return fromFile(f, desiredEncoding, _internal::fileDimension(filename, dimension), generateMipMaps, preprocess, preferSRGBSpaceForAuto);
 }
 
 
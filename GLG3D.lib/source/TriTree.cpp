@@ -4,10 +4,12 @@
   \maintainer Morgan McGuire, http://graphics.cs.williams.edu
 
   \created 2009-06-10
-  \edited  2012-09-02
+  \edited  2026-10-17
 */
 
 #include "G3D/AreaMemoryManager.h"
+#include "G3D/GMutex.h"
+#include "G3D/ThreadPool.h"
 #include "GLG3D/TriTree.h"
 #include "GLG3D/RenderDevice.h"
 #include "GLG3D/Draw.h"
@@ -16,33 +18,193 @@
 
 namespace G3D {
 
+namespace _internal {
+
+/** Serializes allocation from a non-threadsafe MemoryManager so that
+    subtrees may be built concurrently. */
+class SynchronizedMemoryManager : public MemoryManager {
+private:
+    shared_ptr<MemoryManager>   m_base;
+    Spinlock                    m_lock;
+
+    SynchronizedMemoryManager(const shared_ptr<MemoryManager>& base) : m_base(base) {}
+
+public:
+
+    static shared_ptr<SynchronizedMemoryManager> create(const shared_ptr<MemoryManager>& base) {
+        return shared_ptr<SynchronizedMemoryManager>(new SynchronizedMemoryManager(base));
+    }
+
+    virtual void* alloc(size_t s) override {
+        m_lock.lock();
+        void* ptr = m_base->alloc(s);
+        m_lock.unlock();
+        return ptr;
+    }
+
+    virtual void free(void* ptr) override {
+        m_lock.lock();
+        m_base->free(ptr);
+        m_lock.unlock();
+    }
+
+    virtual bool isThreadsafe() const override {
+        return true;
+    }
+};
+
+/** Arrays with at least this many polys are binned and partitioned in parallel */
+static const int PARALLEL_PARTITION_SIZE = 1 << 16;
+
+/** Number of polys per task when binning and partitioning in parallel */
+static const int PARTITION_CHUNK_SIZE = 1 << 14;
+
+/** Volume queries per task in TriTree::intersectSpheres and intersectBoxes */
+static const int VOLUME_QUERY_GRAIN = 8;
+
+/** \brief Records which Tris the current BIH volume query has visited,
+    so that Tris referenced from several nodes are tested and reported once.
+
+    Each query takes a new stamp, so starting a query costs nothing
+    regardless of the number of Tris; the stamps are cleared only when
+    the counter wraps around. */
+class TriMailbox {
+private:
+    Array<uint32>       m_stamp;
+    uint32              m_current;
+
+public:
+
+    TriMailbox() : m_current(0) {}
+
+    /** Begins a query on a tree with \a numTris Tris */
+    void begin(int numTris) {
+        if (m_stamp.size() < numTris) {
+            const int oldSize = m_stamp.size();
+            m_stamp.resize(numTris, false);
+            System::memset(m_stamp.getCArray() + oldSize, 0, sizeof(uint32) * (numTris - oldSize));
+        }
+
+        ++m_current;
+        if (m_current == 0) {
+            System::memset(m_stamp.getCArray(), 0, sizeof(uint32) * m_stamp.size());
+            m_current = 1;
+        }
+    }
+
+    /** Returns true the first time that it is invoked for \a index during the current query */
+    bool visit(int index) {
+        if (m_stamp[index] == m_current) {
+            return false;
+        } else {
+            m_stamp[index] = m_current;
+            return true;
+        }
+    }
+
+    /** The mailbox of the calling thread, which is freed when the thread exits */
+    static TriMailbox& current();
+};
+
+
+TriMailbox& TriMailbox::current() {
+    // thread_local rather than __thread because the mailbox has a destructor
+    static thread_local TriMailbox mailbox;
+    return mailbox;
+}
+
+} // namespace _internal
+
 
 const char* TriTree::algorithmName(SplitAlgorithm s) {
-    const char* n[] = {"Mean extent", "Median area", "Median count", "SAH"};
+    const char* n[] = {"Mean extent", "Median area", "Median count", "SAH", "Binned SAH"};
     return n[s];
 }
 
 
+const char* TriTree::hierarchyName(Hierarchy h) {
+    const char* n[] = {"BIH", "BVH4"};
+    return n[h];
+}
+
+
 void TriTree::intersectSphere
 (const Sphere& sphere,
  Array<Tri>&   triArray) const {
 
-    if (m_root) {
-        Set<Tri*> alreadyAdded;
-        m_root->intersectSphere(sphere, m_cpuVertexArray, triArray, alreadyAdded);
+    // Reused so that only the Tri copies allocate
+    static thread_local Array<int> triIndexArray;
+    triIndexArray.fastClear();
+    intersectSphere(sphere, triIndexArray);
+    for (int i = 0; i < triIndexArray.size(); ++i) {
+        triArray.append(m_triArray[triIndexArray[i]]);
     }
-
 }
 
 
 void TriTree::intersectBox
 (const AABox&  box,
  Array<Tri>&   triArray) const {
+
+    // Reused so that only the Tri copies allocate
+    static thread_local Array<int> triIndexArray;
+    triIndexArray.fastClear();
+    intersectBox(box, triIndexArray);
+    for (int i = 0; i < triIndexArray.size(); ++i) {
+        triArray.append(m_triArray[triIndexArray[i]]);
+    }
+}
+
+
+void TriTree::intersectSphere
+(const Sphere& sphere,
+ Array<int>&   triIndexArray) const {
+
+    if (m_root) {
+        _internal::TriMailbox& mailbox = _internal::TriMailbox::current();
+        mailbox.begin(m_triArray.size());
+        m_root->intersectSphere(sphere, m_cpuVertexArray, m_triArray.getCArray(), mailbox, triIndexArray);
+    } else if (m_bvhNode.size() > 0) {
+        intersectSphereBVH4(sphere, triIndexArray);
+    }
+}
+
+
+void TriTree::intersectBox
+(const AABox&  box,
+ Array<int>&   triIndexArray) const {
+
     if (m_root) {
-        Set<Tri*> alreadyAdded;
-        m_root->intersectBox(box, m_cpuVertexArray, triArray, alreadyAdded);
+        _internal::TriMailbox& mailbox = _internal::TriMailbox::current();
+        mailbox.begin(m_triArray.size());
+        m_root->intersectBox(box, m_cpuVertexArray, m_triArray.getCArray(), mailbox, triIndexArray);
+    } else if (m_bvhNode.size() > 0) {
+        intersectBoxBVH4(box, triIndexArray);
     }
+}
+
 
+void TriTree::intersectSpheres
+(const Array<Sphere>&   sphereArray,
+ Array<Array<int> >&    results) const {
+
+    results.resize(sphereArray.size());
+    ThreadPool::parallelFor(0, sphereArray.size(), [&](int i, int threadID) {
+        results[i].fastClear();
+        intersectSphere(sphereArray[i], results[i]);
+    }, _internal::VOLUME_QUERY_GRAIN);
+}
+
+
+void TriTree::intersectBoxes
+(const Array<AABox>&    boxArray,
+ Array<Array<int> >&    results) const {
+
+    results.resize(boxArray.size());
+    ThreadPool::parallelFor(0, boxArray.size(), [&](int i, int threadID) {
+        results[i].fastClear();
+        intersectBox(boxArray[i], results[i]);
+    }, _internal::VOLUME_QUERY_GRAIN);
 }
 
 
@@ -52,7 +214,6 @@ void TriTree::setContents
  ImageStorage                       newStorage, 
  const Settings&                    settings,
  bool                               computePrevPosition) {
-    static const float epsilon = 0.000001f;
     clear();
     Surface::getTris(surfaceArray, m_cpuVertexArray, m_triArray, computePrevPosition);
    
@@ -64,18 +225,7 @@ void TriTree::setContents
         }
     }
 
-    Array<Poly> source;
-    // Don't add 0 area triangles to source
-    for (int i = 0; i < m_triArray.size(); ++i) {
-        if (m_triArray[i].area() > epsilon) {
-            source.append(Poly(m_cpuVertexArray, &m_triArray[i]));
-        }
-    }
-    
-    if (source.size() > 0) {
-        m_memoryManager = AreaMemoryManager::create();
-        m_root = new (m_memoryManager->alloc(sizeof(Node))) Node(source, settings, m_memoryManager);
-    }
+    buildTree(settings);
 
     //alwaysAssertM(m_triArray.size() == m_triArray.capacity(), "Allocated too much memory for the Tri Array");
     alwaysAssertM(m_cpuVertexArray.vertex.size() == m_cpuVertexArray.vertex.capacity(), 
@@ -151,12 +301,29 @@ void TriTree::Node::split(Array<Poly>& original, const Settings& settings, const
         preferredAxis[1] = temp;
     }
     
+    Vector3 binnedLocation, binnedCost;
+    if (settings.algorithm == BINNED_SAH) {
+        // Evaluate all axes at once, and then prefer them in order of cost
+        chooseBinnedSAHSplitLocations(original, settings, binnedLocation, binnedCost);
+        for (int i = 0; i < 2; ++i) {
+            for (int j = 2; j > i; --j) {
+                if (binnedCost[preferredAxis[j]] < binnedCost[preferredAxis[j - 1]]) {
+                    std::swap(preferredAxis[j], preferredAxis[j - 1]);
+                }
+            }
+        }
+    }
+    
     Array<Poly> lowArray, highArray, spanArray;
     for (int i = 0; i < 3; ++i) {
         lowArray.fastClear(); highArray.fastClear(); spanArray.fastClear();
         
         Vector3::Axis axis = preferredAxis[i];
-        splitLocation = chooseSplitLocation(original, settings, axis);
+        if (settings.algorithm == BINNED_SAH) {
+            splitLocation = binnedLocation[axis];
+        } else {
+            splitLocation = chooseSplitLocation(original, settings, axis);
+        }
         
         // Once an underlying triangle's underlying area from
         // all of the original triangles exceeds that of (on
@@ -164,9 +331,7 @@ void TriTree::Node::split(Array<Poly>& original, const Settings& settings, const
         // the triangle because otherwise it is being
         // multiplied at every split.
         const float maxArea = bounds.area() * settings.maxAreaFraction;
-        for (int j = 0; j < original.size(); ++j) {
-            original[j].split(axis, splitLocation, maxArea, lowArray, highArray, spanArray);
-        }
+        partition(original, axis, splitLocation, maxArea, lowArray, highArray, spanArray);
         
         if (badSplit(original.size(), lowArray.size(), highArray.size())) {
             if (i == 2) {
@@ -177,6 +342,13 @@ void TriTree::Node::split(Array<Poly>& original, const Settings& settings, const
         } else {
             // This was a good split
             setValueArray(spanArray, mm);
+
+            const bool parallel = (original.size() >= settings.parallelBuildThreshold);
+
+            // The originals are no longer needed; release them before recursing
+            // to reduce peak memory on large trees
+            original.clear();
+            spanArray.clear();
             
             // Create child nodes
             Node* ptr = (Node*) mm->alloc(sizeof(Node) * 2);
@@ -185,14 +357,171 @@ void TriTree::Node::split(Array<Poly>& original, const Settings& settings, const
                           format("Pointer is not a multiple of four bytes: %d", (int)(intptr_t)ptr));
             packedChildAxis = reinterpret_cast<uintptr_t>(ptr) | static_cast<uintptr_t>(axis);
 
-            new (ptr) Node(lowArray, settings, mm);
-            new (ptr + 1) Node(highArray, settings, mm);
+            if (parallel) {
+                // Fork the subtrees onto the thread pool. The calling
+                // thread helps with other work while it waits, so this
+                // nests safely all the way down the tree.
+                ThreadPool::parallelFor(0, 2, [&](int c, int threadID) {
+                    new (ptr + c) Node((c == 0) ? lowArray : highArray, settings, mm);
+                }, 1);
+            } else {
+                new (ptr) Node(lowArray, settings, mm);
+                new (ptr + 1) Node(highArray, settings, mm);
+            }
             return;
         }
     }
 }
 
 
+void TriTree::Node::partition
+(const Array<Poly>& original,
+ Vector3::Axis      axis,
+ float              offset,
+ float              minSpanArea,
+ Array<Poly>&       lowArray,
+ Array<Poly>&       highArray,
+ Array<Poly>&       spanArray) {
+
+    if (original.size() < _internal::PARALLEL_PARTITION_SIZE) {
+        for (int j = 0; j < original.size(); ++j) {
+            original[j].split(axis, offset, minSpanArea, lowArray, highArray, spanArray);
+        }
+        return;
+    }
+
+    // Split each chunk into its own arrays and then concatenate them in
+    // chunk order, so that the result matches a serial partition
+    const int numChunks = iCeil(original.size() / float(_internal::PARTITION_CHUNK_SIZE));
+    Array<Array<Poly>> low, high, span;
+    low.resize(numChunks); high.resize(numChunks); span.resize(numChunks);
+
+    ThreadPool::parallelFor(0, numChunks, [&](int c, int threadID) {
+        const int end = min(original.size(), (c + 1) * _internal::PARTITION_CHUNK_SIZE);
+        for (int j = c * _internal::PARTITION_CHUNK_SIZE; j < end; ++j) {
+            original[j].split(axis, offset, minSpanArea, low[c], high[c], span[c]);
+        }
+    }, 1);
+
+    for (int c = 0; c < numChunks; ++c) {
+        lowArray.append(low[c]);   low[c].clear();
+        highArray.append(high[c]); high[c].clear();
+        spanArray.append(span[c]); span[c].clear();
+    }
+}
+
+
+void TriTree::Node::chooseBinnedSAHSplitLocations
+(const Array<Poly>& source,
+ const Settings&    settings,
+ Vector3&           location,
+ Vector3&           cost) const {
+
+    class Bin {
+    public:
+        Vector3 low;
+        Vector3 high;
+        int     count;
+        Bin() : low(Vector3::inf()), high(-Vector3::inf()), count(0) {}
+
+        void merge(const Bin& other) {
+            low   = low.min(other.low);
+            high  = high.max(other.high);
+            count += other.count;
+        }
+
+        float area() const {
+            return (count == 0) ? 0.0f : AABox(low, high).area();
+        }
+    };
+
+    const int numBins = max(2, settings.numBins);
+    const bool parallel = (source.size() >= _internal::PARALLEL_PARTITION_SIZE);
+    const int numChunks = parallel ? iCeil(source.size() / float(_internal::PARTITION_CHUNK_SIZE)) : 1;
+    const int chunkSize = parallel ? _internal::PARTITION_CHUNK_SIZE : source.size();
+
+    // Bounds on the centroids (scaled by two to avoid a multiply)
+    Array<Bin> centroidBounds;
+    centroidBounds.resize(numChunks);
+    ThreadPool::parallelFor(0, numChunks, [&](int c, int threadID) {
+        Bin& b = centroidBounds[c];
+        const int end = min(source.size(), (c + 1) * chunkSize);
+        for (int j = c * chunkSize; j < end; ++j) {
+            const Vector3& centroid2 = source[j].low() + source[j].high();
+            b.low  = b.low.min(centroid2);
+            b.high = b.high.max(centroid2);
+        }
+    }, 1);
+    for (int c = 1; c < numChunks; ++c) {
+        centroidBounds[0].merge(centroidBounds[c]);
+    }
+    const Vector3& cLow    = centroidBounds[0].low;
+    const Vector3& cExtent = centroidBounds[0].high - cLow;
+
+    // Bin every poly along all three axes
+    Array<Bin> bin;
+    bin.resize(numChunks * 3 * numBins);
+    ThreadPool::parallelFor(0, numChunks, [&](int c, int threadID) {
+        Bin* chunkBin = bin.getCArray() + c * 3 * numBins;
+        const int end = min(source.size(), (c + 1) * chunkSize);
+        for (int j = c * chunkSize; j < end; ++j) {
+            const Poly& poly = source[j];
+            const Vector3& centroid2 = poly.low() + poly.high();
+            for (int a = 0; a < 3; ++a) {
+                if (cExtent[a] > 0.0f) {
+                    const int b = min(numBins - 1, int(numBins * (centroid2[a] - cLow[a]) / cExtent[a]));
+                    Bin& dst = chunkBin[a * numBins + b];
+                    dst.low  = dst.low.min(poly.low());
+                    dst.high = dst.high.max(poly.high());
+                    ++dst.count;
+                }
+            }
+        }
+    }, 1);
+    for (int c = 1; c < numChunks; ++c) {
+        for (int i = 0; i < 3 * numBins; ++i) {
+            bin[i].merge(bin[c * 3 * numBins + i]);
+        }
+    }
+
+    // Sweep each axis for the plane with lowest cost
+    const float containingArea = max(bounds.area(), 1e-20f);
+    Array<float> highCost;
+    highCost.resize(numBins);
+    for (int a = 0; a < 3; ++a) {
+        location[a] = bounds.center()[a];
+        cost[a]     = finf();
+        if (! (cExtent[a] > 0.0f)) {
+            // All centroids lie in a plane perpendicular to this axis
+            continue;
+        }
+
+        const Bin* axisBin = bin.getCArray() + a * numBins;
+
+        // highCost[i] is the cost of everything in bins [i, numBins)
+        Bin accum;
+        for (int i = numBins - 1; i > 0; --i) {
+            accum.merge(axisBin[i]);
+            highCost[i] = accum.count * accum.area();
+        }
+
+        accum = Bin();
+        for (int i = 1; i < numBins; ++i) {
+            accum.merge(axisBin[i - 1]);
+            const int numHigh = source.size() - accum.count;
+            if ((accum.count > 0) && (numHigh > 0)) {
+                const float c = (accum.count * accum.area() + highCost[i]) / containingArea;
+                if (c < cost[a]) {
+                    cost[a] = c;
+                    // Map the bin boundary back from doubled centroid coordinates
+                    location[a] = 0.5f * (cLow[a] + cExtent[a] * i / float(numBins));
+                }
+            }
+        }
+    }
+}
+
+
 void TriTree::Node::destroy(const shared_ptr<MemoryManager>& mm) {
     // Destroy children
     if (! isLeaf()) {
@@ -226,6 +555,13 @@ float TriTree::Node::chooseSplitLocation(Array<Poly>& source, const Settings& se
         
     case SAH:
         return chooseSAHSplitLocation(source, axis, settings);
+
+    case BINNED_SAH:
+        {
+            Vector3 location, cost;
+            chooseBinnedSAHSplitLocations(source, settings, location, cost);
+            return location[axis];
+        }
         
     default:
         alwaysAssertM(false, "Fell through switch");
@@ -371,11 +707,12 @@ float TriTree::Node::chooseSAHSplitLocationAccurate(Array<Poly>& source, Vector3
     positionSet.getMembers(position);
     positionSet.clear();
     
+    Array<Poly> lowArray, highArray, spanArray;
     int lowestCostIndex = 0;
     float lowestCost = (float)inf();
     //debugPrintf("\nChoosing split:\n");
     for (int i = 0; i < position.size(); ++i) {
-        float cost = SAHCost(axis, position[i], source, bounds.area(), settings);
+        float cost = SAHCost(axis, position[i], source, bounds.area(), settings, lowArray, highArray, spanArray);
         //debugPrintf("  pos = %f, cost = %f\n", position[i], cost);
         if (cost < lowestCost) {
             lowestCost = cost;
@@ -399,10 +736,16 @@ float TriTree::Node::SAHCost(int size, float area, float containingArea) {
 }
 
 
-float TriTree::Node::SAHCost(Vector3::Axis axis, float offset, const Array<Poly>& original, float containingArea, const Settings& settings) {
-    // TODO: pass these arrays in for thread-safing
-    static Array<Poly> lowArray, highArray, spanArray;
-    
+float TriTree::Node::SAHCost
+(Vector3::Axis      axis,
+ float              offset,
+ const Array<Poly>& original,
+ float              containingArea,
+ const Settings&    settings,
+ Array<Poly>&       lowArray,
+ Array<Poly>&       highArray,
+ Array<Poly>&       spanArray) {
+
     lowArray.fastClear();
     highArray.fastClear();
     spanArray.fastClear();
@@ -535,7 +878,7 @@ static void draw(RenderDevice* rd, const AABox& m_box, const Color4& color) {
 #endif
 
 
-void TriTree::Node::intersectSphere(const Sphere& sphere, const CPUVertexArray& vertexArray, Array<Tri>& triArray, Set<Tri*>& alreadyAdded) const {
+void TriTree::Node::intersectSphere(const Sphere& sphere, const CPUVertexArray& vertexArray, const Tri* triBase, _internal::TriMailbox& mailbox, Array<int>& triIndexArray) const {
     if (! bounds.intersects(sphere)) {
         return;
     }
@@ -543,12 +886,12 @@ void TriTree::Node::intersectSphere(const Sphere& sphere, const CPUVertexArray&
     // Add the triangles at this node
     if (valueArray && valueArray->bounds.intersects(sphere)) {
         for (int v = 0; v < valueArray->size; ++v) {
-            Tri* tri = const_cast<Tri*>(valueArray->data[v]);
-            if (! alreadyAdded.contains(tri)) {
+            const Tri* tri = valueArray->data[v];
+            const int index = int(tri - triBase);
+            if (mailbox.visit(index)) {
                 if ((tri->area() > 0) && CollisionDetection::fixedSolidSphereIntersectsFixedTriangle(sphere, Triangle(tri->position(vertexArray, 0), 
                                                                                        tri->position(vertexArray, 1), tri->position(vertexArray, 2)))) {
-                    triArray.append(*tri);
-                    alreadyAdded.insert(tri);
+                    triIndexArray.append(index);
                 }
             }
         }
@@ -557,13 +900,13 @@ void TriTree::Node::intersectSphere(const Sphere& sphere, const CPUVertexArray&
     // Recurse into children
     if (! isLeaf()) {
         for (int c = 0; c < 2; ++c) {
-            child(c).intersectSphere(sphere, vertexArray, triArray, alreadyAdded);
+            child(c).intersectSphere(sphere, vertexArray, triBase, mailbox, triIndexArray);
         }
     }
 }
 
 
-void TriTree::Node::intersectBox(const AABox& box,  const CPUVertexArray& vertexArray, Array<Tri>& triArray, Set<Tri*>& alreadyAdded) const {
+void TriTree::Node::intersectBox(const AABox& box,  const CPUVertexArray& vertexArray, const Tri* triBase, _internal::TriMailbox& mailbox, Array<int>& triIndexArray) const {
     if (! bounds.intersects(box)) {
         return;
     }
@@ -571,12 +914,12 @@ void TriTree::Node::intersectBox(const AABox& box,  const CPUVertexArray& vertex
     // Add the triangles at this node
     if (valueArray && valueArray->bounds.intersects(box)) {
         for (int v = 0; v < valueArray->size; ++v) {
-            Tri* tri = const_cast<Tri*>(valueArray->data[v]);
-            if (! alreadyAdded.contains(tri)) {
+            const Tri* tri = valueArray->data[v];
+            const int index = int(tri - triBase);
+            if (mailbox.visit(index)) {
                 if ((tri->area() > 0) && CollisionDetection::fixedSolidBoxIntersectsFixedTriangle(box, Triangle(tri->position(vertexArray, 0), 
                                                                                  tri->position(vertexArray, 1), tri->position(vertexArray, 2)))) {
-                    triArray.append(*tri);
-                    alreadyAdded.insert(tri);
+                    triIndexArray.append(index);
                 }
             }
         }
@@ -585,7 +928,7 @@ void TriTree::Node::intersectBox(const AABox& box,  const CPUVertexArray& vertex
     // Recurse into children
     if (! isLeaf()) {
         for (int c = 0; c < 2; ++c) {
-            child(c).intersectBox(box, vertexArray, triArray, alreadyAdded);
+            child(c).intersectBox(box, vertexArray, triBase, mailbox, triIndexArray);
         }
     }
 }
@@ -678,7 +1021,7 @@ void TriTree::Node::getStats(Stats& s, int level, int valuesPerNode) const {
 }
 
 
-TriTree::TriTree() : m_root(NULL) {}
+TriTree::TriTree() : m_root(NULL), m_bvhGarbage(0) {}
 
 
 TriTree::~TriTree() {
@@ -692,6 +1035,9 @@ TriTree::Stats TriTree::stats(int valuesPerNode) const {
     if (m_root) {
         m_root->getStats(s, 0, valuesPerNode);
         s.averageValuesPerLeaf /= s.numLeaves;
+    } else if (m_bvhNode.size() > 0) {
+        getBVH4Stats(s, 0, 0, valuesPerNode);
+        s.averageValuesPerLeaf /= max(1, s.numLeaves);
     } else {
         s.shallowestLeaf = 0;
         s.shallowestNodeOverMin = 0;
@@ -705,18 +1051,54 @@ void TriTree::clear() {
         m_root->destroy(m_memoryManager);
         m_memoryManager->free(m_root);
         m_root = NULL;
-        m_triArray.fastClear();
-        m_cpuVertexArray.clear();
         m_memoryManager.reset();
     }
+    m_bvhNode.clear();
+    m_triBlock.clear();
+    m_bvhNodeCost.clear();
+    m_bvhGarbage = 0;
+    m_triArray.fastClear();
+    m_cpuVertexArray.clear();
 }
 
 
-void TriTree::setContents(const Array<Tri>& triArray, const CPUVertexArray& vertexArray, const Settings& settings) {
+void TriTree::buildTree(const Settings& settings) {
     static const float epsilon = 0.000001f;
+
+    // Don't add 0 area triangles to source
+    Array<int> sourceIndex;
+    sourceIndex.reserve(m_triArray.size());
+    for (int i = 0; i < m_triArray.size(); ++i) {
+        if (m_triArray[i].area() > epsilon) {
+            sourceIndex.append(i);
+        }
+    }
+
+    m_settings = settings;
+    if (sourceIndex.size() == 0) {
+        return;
+    }
+
+    if (settings.hierarchy == BVH4) {
+        buildBVH4(sourceIndex, settings);
+        return;
+    }
+
+    Array<Poly> source;
+    source.resize(sourceIndex.size());
+    ThreadPool::parallelFor(0, source.size(), [&](int i, int threadID) {
+        source[i] = Poly(m_cpuVertexArray, &m_triArray[sourceIndex[i]]);
+    });
+    sourceIndex.clear();
+
+    m_memoryManager = _internal::SynchronizedMemoryManager::create(AreaMemoryManager::create());
+    m_root = new (m_memoryManager->alloc(sizeof(Node))) Node(source, settings, m_memoryManager);
+}
+
+
+void TriTree::setContents(const Array<Tri>& triArray, const CPUVertexArray& vertexArray, const Settings& settings) {
     clear();
     
-    Array<Poly> source;
     // Copy the source data 
 
     // Copy the vertex array
@@ -725,23 +1107,57 @@ void TriTree::setContents(const Array<Tri>& triArray, const CPUVertexArray& vert
     // Copy the tri array
     m_triArray.copyFrom(triArray);
 
-    
-    for (int i = 0; i < triArray.size(); ++i) {
-        if (triArray[i].area() > epsilon) {
-            source.append(Poly(m_cpuVertexArray, &m_triArray[i]));
-        }
-    }
-    
-    if (source.size() > 0) {
-        m_memoryManager = AreaMemoryManager::create();
-        m_root = new (m_memoryManager->alloc(sizeof(Node))) Node(source, settings, m_memoryManager);
-    }
+    buildTree(settings);
 
     alwaysAssertM(m_triArray.size() == m_triArray.capacity(), "Allocated too much memory for the Tri Array");
     alwaysAssertM(m_cpuVertexArray.vertex.size() == m_cpuVertexArray.vertex.capacity(), "Allocated too much memory for the vertex array");
 }
 
 
+int TriTree::refit(const CPUVertexArray& vertexArray) {
+    alwaysAssertM(vertexArray.size() == m_cpuVertexArray.size(), "refit() requires the same number of vertices as setContents()");
+    m_cpuVertexArray.copyFrom(vertexArray);
+
+    ThreadPool::parallelFor(0, m_triArray.size(), [&](int i, int threadID) {
+        Tri& tri = m_triArray[i];
+        const bool twoSided = tri.twoSided();
+        const float area = tri.e1(m_cpuVertexArray).cross(tri.e2(m_cpuVertexArray)).length() * 0.5f;
+        // Keep the sign bit nonzero so that a triangle which has
+        // collapsed remains two-sided
+        tri.m_area = twoSided ? -max(area, FLT_MIN) : area;
+    });
+
+    if (m_bvhNode.size() > 0) {
+        return refitBVH4();
+    } else if (m_root) {
+        // The BIH splitting planes cannot move with the geometry
+        m_root->destroy(m_memoryManager);
+        m_memoryManager->free(m_root);
+        m_root = NULL;
+        m_memoryManager.reset();
+        buildTree(m_settings);
+        return 1;
+    } else {
+        return 0;
+    }
+}
+
+
+int TriTree::refit(const Array<shared_ptr<Surface> >& surfaceArray, bool computePrevPosition) {
+    CPUVertexArray vertexArray;
+    Array<Tri> triArray;
+    Surface::getTris(surfaceArray, vertexArray, triArray, computePrevPosition);
+
+    if ((triArray.size() != m_triArray.size()) || (vertexArray.size() != m_cpuVertexArray.size())) {
+        setContents(triArray, vertexArray, m_settings);
+        return 1;
+    } else {
+        m_triArray = triArray;
+        return refit(vertexArray);
+    }
+}
+
+
 void TriTree::draw(RenderDevice* rd, int level, bool showBoxes, int minNodeSize) {
     if (m_root) {
         rd->setCullFace(CullFace::NONE);
@@ -775,8 +1191,118 @@ bool TriTree::intersectRay
     bool hit = false;
     if (m_root != NULL) {
         hit = m_root->intersectRay(*this, ray, intersectCallback, distance, exitOnAnyHit, twoSided);
+    } else if (m_bvhNode.size() > 0) {
+        hit = intersectRayBVH4(ray, intersectCallback, distance, exitOnAnyHit, twoSided);
     }
     return hit;
 }
 
+/** Interleaves the low 9 bits of x with two zero bits between each bit */
+static uint32 spreadBits9(uint32 x) {
+    x &= 0x1FF;
+    x = (x | (x << 16)) & 0x030000FF;
+    x = (x | (x <<  8)) & 0x0300F00F;
+    x = (x | (x <<  4)) & 0x030C30C3;
+    x = (x | (x <<  2)) & 0x09249249;
+    return x;
+}
+
+
+/** Orders rays by direction octant and then by the Morton code of their
+    origins, so that rays traced consecutively tend to visit the same nodes. */
+static void computeRaySortOrder(const Array<Ray>& rayArray, Array<int>& order) {
+    AABox originBounds(rayArray[0].origin());
+    for (int r = 1; r < rayArray.size(); ++r) {
+        originBounds.merge(rayArray[r].origin());
+    }
+    const Vector3 scale = Vector3(511.0f, 511.0f, 511.0f) / originBounds.extent().max(Vector3(1e-20f, 1e-20f, 1e-20f));
+
+    // Key in the high 32 bits, ray index in the low 32 bits
+    Array<uint64> key;
+    key.resize(rayArray.size());
+    ThreadPool::parallelFor(0, rayArray.size(), [&](int r, int threadID) {
+        const Ray& ray = rayArray[r];
+        const uint32 octant =
+            ((ray.direction().x < 0.0f) ? 1 : 0) |
+            ((ray.direction().y < 0.0f) ? 2 : 0) |
+            ((ray.direction().z < 0.0f) ? 4 : 0);
+        const Vector3& q = (ray.origin() - originBounds.low()) * scale;
+        const uint32 morton = spreadBits9(uint32(q.x)) | (spreadBits9(uint32(q.y)) << 1) | (spreadBits9(uint32(q.z)) << 2);
+        key[r] = (uint64((octant << 27) | morton) << 32) | uint64(r);
+    });
+
+    std::sort(key.begin(), key.end());
+
+    order.resize(key.size());
+    for (int i = 0; i < key.size(); ++i) {
+        order[i] = int(key[i] & 0xFFFFFFFF);
+    }
+}
+
+
+void TriTree::intersectRays
+(const Array<Ray>&      rayArray,
+ Array<Hit>&            results,
+ IntersectRayOptions    options,
+ const Array<float>&    maxDistanceArray) const {
+
+    debugAssertM((maxDistanceArray.size() == 0) || (maxDistanceArray.size() == rayArray.size()),
+                 "maxDistanceArray must be empty or the same size as rayArray");
+
+    results.resize(rayArray.size());
+    if ((rayArray.size() == 0) || ((m_root == NULL) && (m_bvhNode.size() == 0))) {
+        for (int r = 0; r < results.size(); ++r) {
+            results[r] = Hit();
+        }
+        return;
+    }
+
+    const bool exitOnAnyHit = (options & OCCLUSION_TEST_ONLY) != 0;
+    const bool twoSided     = (options & DO_NOT_CULL_BACKFACES) != 0;
+    const bool alphaTest    = (options & NO_PARTIAL_COVERAGE_TEST) == 0;
+    const bool packets      = ((options & COHERENT_RAY_HINT) != 0) && (m_bvhNode.size() > 0);
+
+    Array<int> order;
+    if (! packets) {
+        computeRaySortOrder(rayArray, order);
+    }
+
+    enum {PACKET_SIZE = 32};
+    const int numPackets = (rayArray.size() + PACKET_SIZE - 1) / PACKET_SIZE;
+    ThreadPool::parallelFor(0, numPackets, [&](int p, int threadID) {
+        const int begin = p * PACKET_SIZE;
+        const int count = min(int(PACKET_SIZE), rayArray.size() - begin);
+
+        Tri::Intersector intersector[PACKET_SIZE];
+        float            distance[PACKET_SIZE];
+        bool             hit[PACKET_SIZE];
+
+        for (int i = 0; i < count; ++i) {
+            const int r = packets ? (begin + i) : order[begin + i];
+            intersector[i].alphaTest = alphaTest;
+            distance[i] = (maxDistanceArray.size() > 0) ? maxDistanceArray[r] : finf();
+        }
+
+        if (packets) {
+            intersectPacketBVH4(rayArray.getCArray() + begin, count, intersector, distance, hit, exitOnAnyHit, twoSided);
+        } else {
+            for (int i = 0; i < count; ++i) {
+                hit[i] = intersectRay(rayArray[order[begin + i]], intersector[i], distance[i], exitOnAnyHit, twoSided);
+            }
+        }
+
+        for (int i = 0; i < count; ++i) {
+            Hit& result = results[packets ? (begin + i) : order[begin + i]];
+            result = Hit();
+            if (hit[i]) {
+                result.triIndex = intersector[i].primitiveIndex;
+                result.u        = intersector[i].u;
+                result.v        = intersector[i].v;
+                result.distance = distance[i];
+                result.backside = intersector[i].backside;
+            }
+        }
+    });
+}
+
 }
@@ -0,0 +1,1034 @@
+/**
+  \file GLG3D/TriTree_BVH.cpp
+
+  Construction and traversal of the TriTree::BVH4 hierarchy.
+
+  \maintainer Morgan McGuire, http://graphics.cs.williams.edu
+
+  \created 2026-10-17
+  \edited  2026-10-17
+*/
+
+#include "GLG3D/TriTree.h"
+#include "G3D/ThreadPool.h"
+#include <xmmintrin.h>
+#include <algorithm>
+#ifdef _MSC_VER
+#   include <intrin.h>
+#endif
+
+namespace G3D {
+
+namespace _internal {
+
+/** Internal node of the hierarchy while it is being built. Flattened
+    into TriTree::m_bvhNode once construction is complete. */
+class BVHBuildNode {
+public:
+    int                 numChildren;
+    AABox               bounds[4];
+
+    /** NULL for leaf children */
+    BVHBuildNode*       child[4];
+
+    /** Range of BVHBuilder::prim for leaf children */
+    int                 begin[4];
+    int                 end[4];
+
+    BVHBuildNode() : numChildren(0) {
+        for (int i = 0; i < 4; ++i) {
+            child[i] = NULL;
+            begin[i] = end[i] = 0;
+        }
+    }
+
+    ~BVHBuildNode() {
+        for (int i = 0; i < numChildren; ++i) {
+            delete child[i];
+        }
+    }
+};
+
+
+/** Top-down binned SAH construction over triangle bounding boxes.
+    Triangles are never split, so each appears in exactly one leaf. */
+class BVHBuilder {
+public:
+    /** Nodes deeper than this become leaves regardless of size, which bounds
+        the traversal stack. */
+    enum {MAX_DEPTH = 48};
+
+    /** Ranges with at least this many triangles are binned in parallel */
+    enum {PARALLEL_BIN_SIZE = 1 << 16, BIN_CHUNK_SIZE = 1 << 14};
+
+    const TriTree::Settings&    settings;
+    const int                   leafSize;
+
+    /** Index into TriTree::m_triArray of each triangle being built */
+    Array<int>                  triIndex;
+
+    /** Bounds of each triangle, parallel to triIndex */
+    Array<AABox>                primBounds;
+
+    /** Twice the bounding box center of each triangle, parallel to triIndex */
+    Array<Vector3>              centroid2;
+
+    /** Indices into triIndex. Every node owns a contiguous range. */
+    Array<int>                  prim;
+
+    class Bin {
+    public:
+        Vector3 low;
+        Vector3 high;
+        int     count;
+        Bin() : low(Vector3::inf()), high(-Vector3::inf()), count(0) {}
+
+        void merge(const Bin& other) {
+            low   = low.min(other.low);
+            high  = high.max(other.high);
+            count += other.count;
+        }
+
+        void merge(const AABox& box) {
+            low   = low.min(box.low());
+            high  = high.max(box.high());
+            ++count;
+        }
+
+        float area() const {
+            return (count == 0) ? 0.0f : AABox(low, high).area();
+        }
+    };
+
+    BVHBuilder(const TriTree::Settings& settings) : settings(settings), leafSize(max(1, settings.valuesPerLeaf)) {}
+
+    AABox rangeBounds(int begin, int end) const {
+        Bin b;
+        for (int i = begin; i < end; ++i) {
+            b.merge(primBounds[prim[i]]);
+        }
+        return AABox(b.low, b.high);
+    }
+
+    /** Reorders prim[begin..end) about the binned SAH plane and returns
+        the index of the first element of the upper half, which is
+        always strictly between begin and end. */
+    int split(int begin, int end) {
+        debugAssert(end - begin > 1);
+        const int n = end - begin;
+        const int numBins = max(2, settings.numBins);
+        const bool parallel = (n >= PARALLEL_BIN_SIZE);
+        const int chunkSize = parallel ? int(BIN_CHUNK_SIZE) : n;
+        const int numChunks = (n + chunkSize - 1) / chunkSize;
+
+        // Bounds on the centroids
+        Array<Bin> cbounds;
+        cbounds.resize(numChunks);
+        ThreadPool::parallelFor(0, numChunks, [&](int c, int threadID) {
+            Bin& b = cbounds[c];
+            const int e = min(end, begin + (c + 1) * chunkSize);
+            for (int i = begin + c * chunkSize; i < e; ++i) {
+                const Vector3& p = centroid2[prim[i]];
+                b.low  = b.low.min(p);
+                b.high = b.high.max(p);
+            }
+        }, 1);
+        for (int c = 1; c < numChunks; ++c) {
+            cbounds[0].merge(cbounds[c]);
+        }
+        const Vector3 cLow    = cbounds[0].low;
+        const Vector3 cExtent = cbounds[0].high - cLow;
+
+        // Bin along all three axes
+        Array<Bin> bin;
+        bin.resize(numChunks * 3 * numBins);
+        ThreadPool::parallelFor(0, numChunks, [&](int c, int threadID) {
+            Bin* chunkBin = bin.getCArray() + c * 3 * numBins;
+            const int e = min(end, begin + (c + 1) * chunkSize);
+            for (int i = begin + c * chunkSize; i < e; ++i) {
+                const Vector3& p = centroid2[prim[i]];
+                const AABox& box = primBounds[prim[i]];
+                for (int a = 0; a < 3; ++a) {
+                    if (cExtent[a] > 0.0f) {
+                        const int b = min(numBins - 1, int(numBins * (p[a] - cLow[a]) / cExtent[a]));
+                        chunkBin[a * numBins + b].merge(box);
+                    }
+                }
+            }
+        }, 1);
+        for (int c = 1; c < numChunks; ++c) {
+            for (int i = 0; i < 3 * numBins; ++i) {
+                bin[i].merge(bin[c * 3 * numBins + i]);
+            }
+        }
+
+        // Sweep for the cheapest plane
+        int   bestAxis = -1;
+        int   bestBin  = 0;
+        float bestCost = finf();
+        Array<float> highCost;
+        highCost.resize(numBins);
+        for (int a = 0; a < 3; ++a) {
+            if (! (cExtent[a] > 0.0f)) {
+                continue;
+            }
+            const Bin* axisBin = bin.getCArray() + a * numBins;
+
+            Bin accum;
+            for (int i = numBins - 1; i > 0; --i) {
+                accum.merge(axisBin[i]);
+                highCost[i] = accum.count * accum.area();
+            }
+
+            accum = Bin();
+            for (int i = 1; i < numBins; ++i) {
+                accum.merge(axisBin[i - 1]);
+                if ((accum.count > 0) && (accum.count < n)) {
+                    const float cost = accum.count * accum.area() + highCost[i];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = a;
+                        bestBin  = i;
+                    }
+                }
+            }
+        }
+
+        int mid = begin + n / 2;
+        int* first = prim.getCArray() + begin;
+        int* last  = prim.getCArray() + end;
+        if (bestAxis == -1) {
+            // All centroids coincide; any division is as good as another
+            return mid;
+        }
+
+        const float a0 = cLow[bestAxis];
+        const float scale = numBins / cExtent[bestAxis];
+        mid = int(std::partition(first, last, [&](int p) {
+            return min(numBins - 1, int((centroid2[p][bestAxis] - a0) * scale)) < bestBin;
+        }) - prim.getCArray());
+
+        if ((mid == begin) || (mid == end)) {
+            // Roundoff put everything on one side; fall back to the median
+            mid = begin + n / 2;
+            std::nth_element(first, prim.getCArray() + mid, last, [&](int p, int q) {
+                return centroid2[p][bestAxis] < centroid2[q][bestAxis];
+            });
+        }
+        return mid;
+    }
+
+    /** Builds a node with up to four children covering prim[begin..end) */
+    BVHBuildNode* build(int begin, int end, int depth) {
+        BVHBuildNode* node = new BVHBuildNode();
+
+        // Repeatedly split the largest child until there are four
+        node->numChildren = 1;
+        node->begin[0] = begin;
+        node->end[0]   = end;
+        while (node->numChildren < 4) {
+            int largest = -1;
+            for (int i = 0; i < node->numChildren; ++i) {
+                const int count = node->end[i] - node->begin[i];
+                if ((count > leafSize) && ((largest == -1) || (count > node->end[largest] - node->begin[largest]))) {
+                    largest = i;
+                }
+            }
+
+            if ((largest == -1) || (depth >= MAX_DEPTH)) {
+                break;
+            }
+
+            const int c = node->numChildren;
+            const int mid = split(node->begin[largest], node->end[largest]);
+            node->begin[c] = mid;
+            node->end[c]   = node->end[largest];
+            node->end[largest] = mid;
+            ++node->numChildren;
+        }
+
+        for (int i = 0; i < node->numChildren; ++i) {
+            node->bounds[i] = rangeBounds(node->begin[i], node->end[i]);
+        }
+
+        // Recurse into children that are too large to be leaves
+        const bool parallel = (end - begin >= settings.parallelBuildThreshold);
+        ThreadPool::parallelFor(0, node->numChildren, [&](int i, int threadID) {
+            if ((node->end[i] - node->begin[i] > leafSize) && (depth < MAX_DEPTH)) {
+                node->child[i] = build(node->begin[i], node->end[i], depth + 1);
+            }
+        }, 1, parallel ? -1 : 1);
+
+        return node;
+    }
+};
+
+} // namespace _internal
+
+
+void TriTree::BVHNode4::setEmpty(int i) {
+    lowX[i] = lowY[i] = lowZ[i] = finf();
+    highX[i] = highY[i] = highZ[i] = -finf();
+    child[i] = -1;
+    numBlocks[i] = 0;
+}
+
+
+void TriTree::BVHNode4::setBounds(int i, const AABox& box) {
+    lowX[i]  = box.low().x;
+    lowY[i]  = box.low().y;
+    lowZ[i]  = box.low().z;
+    highX[i] = box.high().x;
+    highY[i] = box.high().y;
+    highZ[i] = box.high().z;
+}
+
+
+void TriTree::TriBlock4::set(int i, int index, const Array<Tri>& triArray, const CPUVertexArray& vertexArray) {
+    triIndex[i] = index;
+    if (index < 0) {
+        // A degenerate triangle never passes the intersection test
+        v0X[i] = v0Y[i] = v0Z[i] = 0.0f;
+        e1X[i] = e1Y[i] = e1Z[i] = 0.0f;
+        e2X[i] = e2Y[i] = e2Z[i] = 0.0f;
+    } else {
+        const Tri& tri = triArray[index];
+        const Point3& v0 = tri.position(vertexArray, 0);
+        const Vector3& e1 = tri.position(vertexArray, 1) - v0;
+        const Vector3& e2 = tri.position(vertexArray, 2) - v0;
+        v0X[i] = v0.x; v0Y[i] = v0.y; v0Z[i] = v0.z;
+        e1X[i] = e1.x; e1Y[i] = e1.y; e1Z[i] = e1.z;
+        e2X[i] = e2.x; e2Y[i] = e2.y; e2Z[i] = e2.z;
+    }
+}
+
+
+int TriTree::appendBVH4(const Array<int>& triIndex, const Settings& settings, int depth) {
+    _internal::BVHBuilder builder(settings);
+
+    const int n = triIndex.size();
+    builder.triIndex.copyFrom(triIndex);
+    builder.primBounds.resize(n);
+    builder.centroid2.resize(n);
+    builder.prim.resize(n);
+    ThreadPool::parallelFor(0, n, [&](int i, int threadID) {
+        const Tri& tri = m_triArray[triIndex[i]];
+        const Point3& a = tri.position(m_cpuVertexArray, 0);
+        const Point3& b = tri.position(m_cpuVertexArray, 1);
+        const Point3& c = tri.position(m_cpuVertexArray, 2);
+        const AABox box(a.min(b).min(c), a.max(b).max(c));
+        builder.primBounds[i] = box;
+        builder.centroid2[i]  = box.low() + box.high();
+        builder.prim[i]       = i;
+    });
+
+    _internal::BVHBuildNode* root = builder.build(0, n, depth);
+
+    // Flatten in depth-first order, so that the first child of every
+    // node immediately follows it in memory
+    std::function<int (const _internal::BVHBuildNode*)> flatten = [&](const _internal::BVHBuildNode* src) {
+        const int index = m_bvhNode.size();
+        m_bvhNode.next();
+        for (int i = 0; i < 4; ++i) {
+            m_bvhNode[index].setEmpty(i);
+        }
+
+        for (int i = 0; i < src->numChildren; ++i) {
+            m_bvhNode[index].setBounds(i, src->bounds[i]);
+            if (src->child[i]) {
+                const int c = flatten(src->child[i]);
+                m_bvhNode[index].child[i] = c;
+            } else {
+                const int count = src->end[i] - src->begin[i];
+                const int numBlocks = (count + 3) / 4;
+                m_bvhNode[index].child[i] = m_triBlock.size();
+                m_bvhNode[index].numBlocks[i] = numBlocks;
+                for (int b = 0; b < numBlocks; ++b) {
+                    TriBlock4& block = m_triBlock.next();
+                    for (int lane = 0; lane < 4; ++lane) {
+                        const int p = src->begin[i] + b * 4 + lane;
+                        block.set(lane, (p < src->end[i]) ? builder.triIndex[builder.prim[p]] : -1, m_triArray, m_cpuVertexArray);
+                    }
+                }
+            }
+        }
+        return index;
+    };
+    const int rootIndex = flatten(root);
+    delete root;
+
+    // Record the cost of the new nodes as the baseline for refit(),
+    // which the caller will normalize
+    m_bvhNodeCost.resize(m_bvhNode.size());
+    for (int i = m_bvhNode.size() - 1; i >= rootIndex; --i) {
+        m_bvhNodeCost[i] = computeBVH4Cost(i, m_bvhNodeCost);
+    }
+
+    return rootIndex;
+}
+
+
+void TriTree::buildBVH4(const Array<int>& sourceIndex, const Settings& settings) {
+    m_bvhNode.fastClear();
+    m_triBlock.fastClear();
+    m_bvhNodeCost.fastClear();
+    m_bvhGarbage = 0;
+
+    appendBVH4(sourceIndex, settings, 0);
+
+    const float rootArea = max(bvh4Area(0), 1e-20f);
+    for (int i = 0; i < m_bvhNodeCost.size(); ++i) {
+        m_bvhNodeCost[i] /= rootArea;
+    }
+
+    m_bvhNode.trimToSize();
+    m_triBlock.trimToSize();
+    m_bvhNodeCost.trimToSize();
+}
+
+
+float TriTree::computeBVH4Cost(int index, const Array<float>& cost) const {
+    const BVHNode4& node = m_bvhNode[index];
+
+    // Surface area heuristic with unit cost for entering a child and
+    // for testing a block of four triangles
+    float c = 0.0f;
+    for (int i = 0; i < 4; ++i) {
+        if (node.child[i] >= 0) {
+            const float area = node.bounds(i).area();
+            if (node.isLeaf(i)) {
+                c += area * (1.0f + float(node.numBlocks[i]));
+            } else {
+                c += area + cost[node.child[i]];
+            }
+        }
+    }
+    return c;
+}
+
+
+float TriTree::bvh4Area(int index) const {
+    const BVHNode4& node = m_bvhNode[index];
+    AABox bounds;
+    bool empty = true;
+    for (int i = 0; i < 4; ++i) {
+        if (node.child[i] >= 0) {
+            if (empty) {
+                bounds = node.bounds(i);
+                empty = false;
+            } else {
+                bounds.merge(node.bounds(i));
+            }
+        }
+    }
+    return empty ? 0.0f : bounds.area();
+}
+
+
+int TriTree::gatherBVH4Tris(int index, Array<int>& triIndex) const {
+    const BVHNode4& node = m_bvhNode[index];
+    int numNodes = 1;
+    for (int i = 0; i < 4; ++i) {
+        if (node.child[i] < 0) {
+            continue;
+        } else if (node.isLeaf(i)) {
+            for (int b = node.child[i]; b < node.child[i] + node.numBlocks[i]; ++b) {
+                for (int lane = 0; lane < 4; ++lane) {
+                    if (m_triBlock[b].triIndex[lane] >= 0) {
+                        triIndex.append(m_triBlock[b].triIndex[lane]);
+                    }
+                }
+            }
+        } else {
+            numNodes += gatherBVH4Tris(node.child[i], triIndex);
+        }
+    }
+    return numNodes;
+}
+
+
+int TriTree::refitBVH4() {
+    // Move the triangles
+    ThreadPool::parallelFor(0, m_triBlock.size(), [&](int b, int threadID) {
+        TriBlock4& block = m_triBlock[b];
+        for (int lane = 0; lane < 4; ++lane) {
+            if (block.triIndex[lane] >= 0) {
+                block.set(lane, block.triIndex[lane], m_triArray, m_cpuVertexArray);
+            }
+        }
+    });
+
+    // Every node precedes its children, so a reverse pass visits
+    // children first. This also updates unreachable nodes, which is
+    // harmless and bounded by the compaction below.
+    Array<float> cost;
+    cost.resize(m_bvhNode.size());
+    for (int n = m_bvhNode.size() - 1; n >= 0; --n) {
+        BVHNode4& node = m_bvhNode[n];
+        for (int i = 0; i < 4; ++i) {
+            if (node.child[i] < 0) {
+                continue;
+            }
+
+            AABox box;
+            bool empty = true;
+            if (node.isLeaf(i)) {
+                for (int b = node.child[i]; b < node.child[i] + node.numBlocks[i]; ++b) {
+                    const TriBlock4& block = m_triBlock[b];
+                    for (int lane = 0; lane < 4; ++lane) {
+                        if (block.triIndex[lane] >= 0) {
+                            const Point3 v0(block.v0X[lane], block.v0Y[lane], block.v0Z[lane]);
+                            const Point3 v1 = v0 + Vector3(block.e1X[lane], block.e1Y[lane], block.e1Z[lane]);
+                            const Point3 v2 = v0 + Vector3(block.e2X[lane], block.e2Y[lane], block.e2Z[lane]);
+                            const AABox triBox(v0.min(v1).min(v2), v0.max(v1).max(v2));
+                            if (empty) {
+                                box = triBox;
+                                empty = false;
+                            } else {
+                                box.merge(triBox);
+                            }
+                        }
+                    }
+                }
+            } else {
+                const BVHNode4& child = m_bvhNode[node.child[i]];
+                for (int j = 0; j < 4; ++j) {
+                    if (child.child[j] >= 0) {
+                        if (empty) {
+                            box = child.bounds(j);
+                            empty = false;
+                        } else {
+                            box.merge(child.bounds(j));
+                        }
+                    }
+                }
+            }
+            debugAssert(! empty);
+            node.setBounds(i, box);
+        }
+        cost[n] = computeBVH4Cost(n, cost);
+    }
+
+    // Compare each subtree's share of the cost of the whole tree
+    // against the share when it was built, so that uniformly scaling
+    // the geometry does not trigger a rebuild
+    const float rootArea = max(bvh4Area(0), 1e-20f);
+    for (int n = 0; n < cost.size(); ++n) {
+        cost[n] /= rootArea;
+    }
+
+    const float threshold = m_settings.refitRebuildThreshold;
+    Array<int> triIndex;
+    if (cost[0] > threshold * m_bvhNodeCost[0]) {
+        // The entire tree has degraded
+        gatherBVH4Tris(0, triIndex);
+        buildBVH4(triIndex, m_settings);
+        return 1;
+    }
+
+    // Rebuild the highest degraded subtrees in place of the originals.
+    // Depths are tracked so that a rebuilt subtree continues counting
+    // from its parent and the whole tree stays within MAX_DEPTH.
+    int numRebuilt = 0;
+    Array<int> stack, depthStack;
+    stack.append(0);
+    depthStack.append(0);
+    while (stack.size() > 0) {
+        const int n = stack.pop();
+        const int depth = depthStack.pop();
+        for (int i = 0; i < 4; ++i) {
+            const int c = m_bvhNode[n].child[i];
+            if ((c < 0) || m_bvhNode[n].isLeaf(i)) {
+                continue;
+            } else if (cost[c] > threshold * m_bvhNodeCost[c]) {
+                triIndex.fastClear();
+                m_bvhGarbage += gatherBVH4Tris(c, triIndex);
+                // The bounds of the slot are unchanged because the triangles are the same
+                const int newChild = appendBVH4(triIndex, m_settings, depth + 1);
+                for (int k = newChild; k < m_bvhNodeCost.size(); ++k) {
+                    m_bvhNodeCost[k] /= rootArea;
+                }
+                m_bvhNode[n].child[i] = newChild;
+                ++numRebuilt;
+            } else {
+                stack.append(c);
+                depthStack.append(depth + 1);
+            }
+        }
+    }
+
+    if (m_bvhGarbage > m_bvhNode.size() / 2) {
+        // Compact
+        triIndex.fastClear();
+        gatherBVH4Tris(0, triIndex);
+        buildBVH4(triIndex, m_settings);
+        ++numRebuilt;
+    }
+
+    return numRebuilt;
+}
+
+
+namespace _internal {
+
+/** One ray broadcast across SSE lanes, for testing it against the four
+    children of a TriTree::BVHNode4 or the four triangles of a
+    TriTree::TriBlock4 at once. */
+class SIMDRay {
+private:
+    // Slack for roundoff in the SIMD tests.  Candidates are always
+    // confirmed by Tri::Intersector, so these only need to be conservative.
+    static float boxEpsilon() { return 1.0f + 4.0f * 1.2e-7f; }
+    static float barycentricEpsilon() { return 1e-5f; }
+
+    __m128  ox, oy, oz;
+    __m128  dx, dy, dz;
+    __m128  ix, iy, iz;
+
+    /** True if the inverse direction is non-negative on each axis */
+    bool    xPositive, yPositive, zPositive;
+
+public:
+
+    void set(const Ray& ray) {
+        const Vector3& origin    = ray.origin();
+        const Vector3& direction = ray.direction();
+
+        // Division by zero produces signed infinity, which selects the
+        // correct slab planes in boxes()
+        const Vector3 invDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+        ox = _mm_set1_ps(origin.x);
+        oy = _mm_set1_ps(origin.y);
+        oz = _mm_set1_ps(origin.z);
+        dx = _mm_set1_ps(direction.x);
+        dy = _mm_set1_ps(direction.y);
+        dz = _mm_set1_ps(direction.z);
+        ix = _mm_set1_ps(invDirection.x);
+        iy = _mm_set1_ps(invDirection.y);
+        iz = _mm_set1_ps(invDirection.z);
+
+        xPositive = (invDirection.x >= 0.0f);
+        yPositive = (invDirection.y >= 0.0f);
+        zPositive = (invDirection.z >= 0.0f);
+    }
+
+    /** Returns a bit mask of the children of \a node whose boxes the ray
+        enters before \a distance, and the entry distance of each child. */
+    int boxes(const TriTree::BVHNode4& node, float distance, float nearDistance[4]) const {
+        // Choose the slab planes that the ray enters and exits. When a direction
+        // component is zero, (plane - origin) * inf is NaN only for rays lying
+        // exactly in a plane; _mm_max_ps and _mm_min_ps then return their
+        // second operand, which ignores that axis.
+        const __m128 nearX = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(xPositive ? node.lowX : node.highX), ox), ix);
+        const __m128 nearY = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(yPositive ? node.lowY : node.highY), oy), iy);
+        const __m128 nearZ = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(zPositive ? node.lowZ : node.highZ), oz), iz);
+        const __m128 farX  = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(xPositive ? node.highX : node.lowX), ox), ix);
+        const __m128 farY  = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(yPositive ? node.highY : node.lowY), oy), iy);
+        const __m128 farZ  = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(zPositive ? node.highZ : node.lowZ), oz), iz);
+
+        const __m128 slack = _mm_set1_ps(boxEpsilon());
+        const __m128 tNear = _mm_max_ps(nearZ, _mm_max_ps(nearY, _mm_max_ps(nearX, _mm_setzero_ps())));
+        const __m128 tFar  = _mm_min_ps(_mm_mul_ps(farZ, slack), _mm_min_ps(_mm_mul_ps(farY, slack),
+                             _mm_min_ps(_mm_mul_ps(farX, slack), _mm_set1_ps(distance))));
+
+        _mm_storeu_ps(nearDistance, tNear);
+        return _mm_movemask_ps(_mm_cmple_ps(tNear, tFar));
+    }
+
+    /** Returns a bit mask of the triangles in \a block that the ray may
+        hit before \a distance, ignoring sidedness. */
+    int triangles(const TriTree::TriBlock4& block, float distance) const {
+        const __m128 e1x = _mm_loadu_ps(block.e1X);
+        const __m128 e1y = _mm_loadu_ps(block.e1Y);
+        const __m128 e1z = _mm_loadu_ps(block.e1Z);
+        const __m128 e2x = _mm_loadu_ps(block.e2X);
+        const __m128 e2y = _mm_loadu_ps(block.e2Y);
+        const __m128 e2z = _mm_loadu_ps(block.e2Z);
+
+        // p = direction x e2
+        const __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        const __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        const __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+
+        const __m128 a = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        const __m128 f = _mm_div_ps(_mm_set1_ps(1.0f), a);
+
+        const __m128 sx = _mm_sub_ps(ox, _mm_loadu_ps(block.v0X));
+        const __m128 sy = _mm_sub_ps(oy, _mm_loadu_ps(block.v0Y));
+        const __m128 sz = _mm_sub_ps(oz, _mm_loadu_ps(block.v0Z));
+
+        const __m128 u = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)));
+
+        // q = s x e1
+        const __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        const __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        const __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+
+        const __m128 v = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)));
+        const __m128 t = _mm_mul_ps(f, _mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)));
+
+        const __m128 minusEpsilon   = _mm_set1_ps(-barycentricEpsilon());
+        const __m128 onePlusEpsilon = _mm_set1_ps(1.0f + barycentricEpsilon());
+        const __m128 d = _mm_set1_ps(distance);
+
+        // NaN (from degenerate or padding triangles) fails every comparison
+        __m128 inside = _mm_and_ps(_mm_cmpge_ps(u, minusEpsilon), _mm_cmpge_ps(v, minusEpsilon));
+        inside = _mm_and_ps(inside, _mm_cmple_ps(_mm_add_ps(u, v), onePlusEpsilon));
+        inside = _mm_and_ps(inside, _mm_cmpgt_ps(t, _mm_mul_ps(d, minusEpsilon)));
+        inside = _mm_and_ps(inside, _mm_cmplt_ps(t, _mm_mul_ps(d, onePlusEpsilon)));
+
+        return _mm_movemask_ps(inside);
+    }
+};
+
+
+/** Index of the lowest set bit of a nonzero mask */
+static inline int lowestBit(uint32 mask) {
+    debugAssert(mask != 0);
+#   ifdef _MSC_VER
+        unsigned long i;
+        _BitScanForward(&i, mask);
+        return int(i);
+#   else
+        return __builtin_ctz(mask);
+#   endif
+}
+
+
+static inline int countBits(uint32 mask) {
+#   ifdef _MSC_VER
+        return int(__popcnt(mask));
+#   else
+        return __builtin_popcount(mask);
+#   endif
+}
+
+
+/** Entry on the BVH4 traversal stack */
+class BVHStackEntry {
+public:
+    int     child;
+    int     numBlocks;
+
+    /** Entry distance for single rays; the active ray mask for packets */
+    union {
+        float   distance;
+        uint32  rayMask;
+    };
+};
+
+/** Upper bound on the traversal stack size, because each node pushes at most three more entries than it pops */
+static const int BVH_STACK_SIZE = 3 * BVHBuilder::MAX_DEPTH + 8;
+
+/** Packet traversal continues with individual rays below nodes that
+    fewer than this many rays of the packet enter, where sharing
+    node visits no longer pays for the lost per-ray ordering. */
+static const int MIN_PACKET_RAYS = 4;
+
+} // namespace _internal
+
+
+bool TriTree::intersectRayBVH4
+(const Ray&         ray,
+ Tri::Intersector&  intersectCallback,
+ float&             distance,
+ bool               exitOnAnyHit,
+ bool               twoSided,
+ int                startChild,
+ int                startNumBlocks) const {
+
+    _internal::SIMDRay simdRay;
+    simdRay.set(ray);
+
+    _internal::BVHStackEntry stack[_internal::BVH_STACK_SIZE];
+    int stackSize = 1;
+    stack[0].child = startChild;
+    stack[0].numBlocks = startNumBlocks;
+    stack[0].distance = 0.0f;
+
+    bool hit = false;
+    while (stackSize > 0) {
+        const _internal::BVHStackEntry entry = stack[--stackSize];
+        if (entry.distance > distance) {
+            // Something closer was found after this was pushed
+            continue;
+        }
+
+        if (entry.numBlocks == 0) {
+            // Internal node: test all four child boxes at once
+            const BVHNode4& node = m_bvhNode[entry.child];
+            float nearDistance[4];
+            const int mask = simdRay.boxes(node, distance, nearDistance);
+
+            // Push the children so that the closest is popped first
+            const int base = stackSize;
+            for (int i = 0; i < 4; ++i) {
+                if ((mask & (1 << i)) && (node.child[i] >= 0)) {
+                    _internal::BVHStackEntry e;
+                    e.child     = node.child[i];
+                    e.numBlocks = node.numBlocks[i];
+                    e.distance  = nearDistance[i];
+
+                    // Insertion sort, farthest at the bottom
+                    int j = stackSize;
+                    while ((j > base) && (stack[j - 1].distance < e.distance)) {
+                        stack[j] = stack[j - 1];
+                        --j;
+                    }
+                    stack[j] = e;
+                    ++stackSize;
+                }
+            }
+        } else {
+            // Leaf: test four triangles at a time
+            for (int b = 0; b < entry.numBlocks; ++b) {
+                const TriBlock4& block = m_triBlock[entry.child + b];
+                uint32 mask = simdRay.triangles(block, distance);
+                while (mask != 0) {
+                    const int lane = _internal::lowestBit(mask);
+                    mask &= ~(1 << lane);
+
+                    const int index = block.triIndex[lane];
+                    debugAssert(index >= 0);
+
+                    // The scalar test applies sidedness and alpha and produces the exact result
+                    if (intersectCallback(ray, m_cpuVertexArray, m_triArray[index], twoSided, distance)) {
+                        hit = true;
+                        intersectCallback.primitiveIndex = index;
+                        intersectCallback.cpuVertexArray = &m_cpuVertexArray;
+                        if (exitOnAnyHit) {
+                            return true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    return hit;
+}
+
+
+void TriTree::intersectPacketBVH4
+(const Ray*         ray,
+ int                numRays,
+ Tri::Intersector*  intersectCallback,
+ float*             distance,
+ bool*              hit,
+ bool               exitOnAnyHit,
+ bool               twoSided) const {
+
+    debugAssert(numRays > 0 && numRays <= 32);
+
+    _internal::SIMDRay simdRay[32];
+    for (int r = 0; r < numRays; ++r) {
+        simdRay[r].set(ray[r]);
+        hit[r] = false;
+    }
+
+    // Rays that have not yet terminated. Only any-hit rays terminate early.
+    uint32 active = (numRays == 32) ? 0xFFFFFFFF : ((1u << numRays) - 1);
+
+    _internal::BVHStackEntry stack[_internal::BVH_STACK_SIZE];
+    int stackSize = 1;
+    stack[0].child = 0;
+    stack[0].numBlocks = 0;
+    stack[0].rayMask = active;
+
+    while (stackSize > 0) {
+        const _internal::BVHStackEntry entry = stack[--stackSize];
+        const uint32 entryMask = entry.rayMask & active;
+        if (entryMask == 0) {
+            continue;
+        }
+
+        if (_internal::countBits(entryMask) < _internal::MIN_PACKET_RAYS) {
+            uint32 m = entryMask;
+            while (m != 0) {
+                const int r = _internal::lowestBit(m);
+                m &= ~(1u << r);
+                if (intersectRayBVH4(ray[r], intersectCallback[r], distance[r], exitOnAnyHit, twoSided, entry.child, entry.numBlocks)) {
+                    hit[r] = true;
+                    if (exitOnAnyHit) {
+                        active &= ~(1u << r);
+                    }
+                }
+            }
+            continue;
+        }
+
+        if (entry.numBlocks == 0) {
+            // Visit each child box with the rays that hit it, so that the
+            // node is fetched once for the whole packet
+            const BVHNode4& node = m_bvhNode[entry.child];
+            uint32 childMask[4] = {0, 0, 0, 0};
+            float  minDistance[4] = {finf(), finf(), finf(), finf()};
+
+            uint32 m = entryMask;
+            while (m != 0) {
+                const int r = _internal::lowestBit(m);
+                m &= ~(1u << r);
+
+                float nearDistance[4];
+                const int boxMask = simdRay[r].boxes(node, distance[r], nearDistance);
+                for (int i = 0; i < 4; ++i) {
+                    if (boxMask & (1 << i)) {
+                        childMask[i] |= (1u << r);
+                        minDistance[i] = min(minDistance[i], nearDistance[i]);
+                    }
+                }
+            }
+
+            // Push so that the child that the packet reaches first is popped first
+            float pushedDistance[4];
+            const int base = stackSize;
+            for (int i = 0; i < 4; ++i) {
+                if ((childMask[i] != 0) && (node.child[i] >= 0)) {
+                    _internal::BVHStackEntry e;
+                    e.child     = node.child[i];
+                    e.numBlocks = node.numBlocks[i];
+                    e.rayMask   = childMask[i];
+
+                    int j = stackSize;
+                    while ((j > base) && (pushedDistance[j - 1 - base] < minDistance[i])) {
+                        stack[j] = stack[j - 1];
+                        pushedDistance[j - base] = pushedDistance[j - 1 - base];
+                        --j;
+                    }
+                    stack[j] = e;
+                    pushedDistance[j - base] = minDistance[i];
+                    ++stackSize;
+                }
+            }
+        } else {
+            for (int b = 0; b < entry.numBlocks; ++b) {
+                const TriBlock4& block = m_triBlock[entry.child + b];
+
+                uint32 m = entryMask & active;
+                while (m != 0) {
+                    const int r = _internal::lowestBit(m);
+                    m &= ~(1u << r);
+
+                    uint32 triMask = simdRay[r].triangles(block, distance[r]);
+                    while (triMask != 0) {
+                        const int lane = _internal::lowestBit(triMask);
+                        triMask &= ~(1u << lane);
+
+                        const int index = block.triIndex[lane];
+                        if (intersectCallback[r](ray[r], m_cpuVertexArray, m_triArray[index], twoSided, distance[r])) {
+                            hit[r] = true;
+                            intersectCallback[r].primitiveIndex = index;
+                            intersectCallback[r].cpuVertexArray = &m_cpuVertexArray;
+                            if (exitOnAnyHit) {
+                                active &= ~(1u << r);
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+void TriTree::intersectSphereBVH4(const Sphere& sphere, Array<int>& triIndexArray) const {
+    int stack[_internal::BVH_STACK_SIZE];
+    int stackSize = 1;
+    stack[0] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode4& node = m_bvhNode[stack[--stackSize]];
+        for (int i = 0; i < 4; ++i) {
+            if ((node.child[i] < 0) || ! node.bounds(i).intersects(sphere)) {
+                continue;
+            }
+
+            if (node.isLeaf(i)) {
+                for (int b = 0; b < node.numBlocks[i]; ++b) {
+                    const TriBlock4& block = m_triBlock[node.child[i] + b];
+                    for (int lane = 0; lane < 4; ++lane) {
+                        const int index = block.triIndex[lane];
+                        if (index >= 0) {
+                            const Tri& tri = m_triArray[index];
+                            if (CollisionDetection::fixedSolidSphereIntersectsFixedTriangle(sphere, tri.toTriangle(m_cpuVertexArray))) {
+                                triIndexArray.append(index);
+                            }
+                        }
+                    }
+                }
+            } else {
+                stack[stackSize++] = node.child[i];
+            }
+        }
+    }
+}
+
+
+void TriTree::intersectBoxBVH4(const AABox& box, Array<int>& triIndexArray) const {
+    int stack[_internal::BVH_STACK_SIZE];
+    int stackSize = 1;
+    stack[0] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode4& node = m_bvhNode[stack[--stackSize]];
+        for (int i = 0; i < 4; ++i) {
+            if ((node.child[i] < 0) || ! node.bounds(i).intersects(box)) {
+                continue;
+            }
+
+            if (node.isLeaf(i)) {
+                for (int b = 0; b < node.numBlocks[i]; ++b) {
+                    const TriBlock4& block = m_triBlock[node.child[i] + b];
+                    for (int lane = 0; lane < 4; ++lane) {
+                        const int index = block.triIndex[lane];
+                        if (index >= 0) {
+                            const Tri& tri = m_triArray[index];
+                            if (CollisionDetection::fixedSolidBoxIntersectsFixedTriangle(box, tri.toTriangle(m_cpuVertexArray))) {
+                                triIndexArray.append(index);
+                            }
+                        }
+                    }
+                }
+            } else {
+                stack[stackSize++] = node.child[i];
+            }
+        }
+    }
+}
+
+
+void TriTree::getBVH4Stats(Stats& s, int index, int level, int valuesPerNode) const {
+    const BVHNode4& node = m_bvhNode[index];
+    ++s.numNodes;
+    s.depth = max(s.depth, level);
+    for (int i = 0; i < 4; ++i) {
+        if (node.child[i] < 0) {
+            continue;
+        }
+
+        if (node.isLeaf(i)) {
+            int n = 0;
+            for (int b = 0; b < node.numBlocks[i]; ++b) {
+                for (int lane = 0; lane < 4; ++lane) {
+                    n += (m_triBlock[node.child[i] + b].triIndex[lane] >= 0) ? 1 : 0;
+                }
+            }
+            ++s.numNodes;
+            ++s.numLeaves;
+            s.numTris += n;
+            s.averageValuesPerLeaf += n;
+            s.largestNode = max(s.largestNode, n);
+            s.depth = max(s.depth, level + 1);
+            s.shallowestLeaf = min(s.shallowestLeaf, level + 1);
+            if (n > valuesPerNode) {
+                s.shallowestNodeOverMin = min(s.shallowestNodeOverMin, level + 1);
+            }
+        } else {
+            getBVH4Stats(s, node.child[i], level + 1, valuesPerNode);
+        }
+    }
+}
+
+} // namespace G3D
@@ -4,7 +4,7 @@
  \maintainer Morgan McGuire, Michael Mara http://graphics.cs.williams.edu
  
  \created 2012-06-27
- \edited  2015-07-20
+ \edited  2026-10-17
 
  */
 
@@ -30,10 +30,44 @@ static const String SYMBOL_SPACE = " ";
 static const String SYMBOL_NEWLINE = "\n";
 static const String SYMBOL_POUND_define = "#define ";
 
+/** 64-bit FNV-1a */
+static uint64 hashString(const String& s) {
+    uint64 h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < s.size(); ++i) {
+        h = (h ^ uint8(s[i])) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+
+/** Scrambles the bits of \a h so that sums of different hashes rarely collide */
+static uint64 finalizeHash(uint64 h) {
+    h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    h = (h ^ (h >> 27)) * 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+
+/** The empty preamble hashes to zero so that default-constructed tables need no computation */
+static uint64 preambleHash(const String& preamble) {
+    return preamble.empty() ? 0 : finalizeHash(hashString(preamble));
+}
+
+
+uint64 UniformTable::macroHash(const MacroArgPair& macro) {
+    return finalizeHash(hashString(macro.name) * 31 + hashString(macro.value));
+}
+
+
 UniformTable::~UniformTable() {}
 
 
-UniformTable::UniformTable(const Any& any) {
+UniformTable::UniformTable(const UniformTable& other) : m_preambleHash(0), m_macroHash(0) {
+    append(other);
+}
+
+
+UniformTable::UniformTable(const Any& any) : m_preambleHash(0), m_macroHash(0) {
     for (Table<String, Any>::Iterator it = any.table().begin(); it.hasMore(); ++it) {
         const Any& v = it->value;
         switch (v.type()) {
@@ -95,8 +129,51 @@ UniformTable::UniformTable(const Any& any) {
 }
 
 
-	void UniformTable::setPreamble(const String& preamble) {
+void UniformTable::setPreamble(const String& preamble) {
     m_preamble = preamble;
+    m_preambleHash = preambleHash(m_preamble);
+}
+
+
+void UniformTable::appendToPreamble(const String& extra) {
+    m_preamble += extra;
+    m_preambleHash = preambleHash(m_preamble);
+}
+
+
+bool UniformTable::sameVariant(const UniformTable& other) const {
+    if ((variantHash() != other.variantHash()) || (m_macroArgs.size() != other.m_macroArgs.size()) || (m_preamble != other.m_preamble)) {
+        return false;
+    }
+
+    // setMacro() guarantees that names are unique, so matching every
+    // macro of this table implies that the sets are equal
+    for (int i = 0; i < m_macroArgs.size(); ++i) {
+        const MacroArgPair& macro = m_macroArgs[i];
+
+        // Tables built by the same code set their macros in the same order
+        if (other.m_macroArgs[i].name == macro.name) {
+            if (other.m_macroArgs[i].value != macro.value) {
+                return false;
+            }
+            continue;
+        }
+
+        bool found = false;
+        for (int j = 0; j < other.m_macroArgs.size(); ++j) {
+            if (other.m_macroArgs[j].name == macro.name) {
+                if (other.m_macroArgs[j].value != macro.value) {
+                    return false;
+                }
+                found = true;
+                break;
+            }
+        }
+        if (! found) {
+            return false;
+        }
+    }
+    return true;
 }
 
 
@@ -115,8 +192,9 @@ String UniformTable::preambleAndMacroString() const {
         macros[i] = &m_macroArgs[i];
     }
 
-    // Sort
-    macros.sort();
+    // Sort by name (sorting the pointers themselves would make the string
+    // depend on the order in which the macros were set)
+    macros.sort([](const MacroArgPair* a, const MacroArgPair* b) { return a->name < b->name; });
 
     // Accumulate the minimal set and retain alphabetical order
     const MacroArgPair* prev = NULL;
@@ -249,12 +327,17 @@ void UniformTable::setMacro(const String& name, const String& value) {
 
     for (int i = 0; i < m_macroArgs.size(); ++i){
         if (m_macroArgs[i].name == name) {
-            m_macroArgs[i].value = value;
+            if (m_macroArgs[i].value != value) {
+                m_macroHash -= macroHash(m_macroArgs[i]);
+                m_macroArgs[i].value = value;
+                m_macroHash += macroHash(m_macroArgs[i]);
+            }
             return;
         }
     }
 
     m_macroArgs.append(MacroArgPair(name, value));
+    m_macroHash += macroHash(m_macroArgs.last());
 }
 
 
@@ -698,7 +781,7 @@ void UniformTable::setUniform(const String& name, const shared_ptr<BindlessTextu
 }
 
 
-UniformTable::UniformTable() {}
+UniformTable::UniformTable() : m_preambleHash(0), m_macroHash(0) {}
 
 void UniformTable::setArrayUniform(const String& name, int index, const shared_ptr<BindlessTextureHandle>& val, bool optional) {
     Arg& arg = m_uniformArgs.getCreate(name + format("[%d]", index));
@@ -4,7 +4,7 @@
  \author Morgan McGuire, http://graphics.cs.williams.edu
 
  \created  2009-03-19
- \edited   2016-02-06
+ \edited   2026-10-17
 
  Copyright 2000-2016, Morgan McGuire.
   All rights reserved.
@@ -168,6 +168,9 @@ shared_ptr<UniversalMaterial> UniversalMaterial::create(const String& name, cons
     shared_ptr<UniversalMaterial> value = cache[specification];
 
     if (isNull(value)) {
+        // Decode all of the textures concurrently while the first ones upload
+        specification.prefetchTextures();
+
         // Construct the appropriate material
         value.reset(new UniversalMaterial());
 
@@ -203,6 +206,7 @@ shared_ptr<UniversalMaterial> UniversalMaterial::create(const String& name, cons
         }
 
         value->m_name = name;
+        value->m_specification.reset(new Specification(specification));
 
         value->m_constantTable = specification.m_constantTable;
 
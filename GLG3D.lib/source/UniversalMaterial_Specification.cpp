@@ -2,7 +2,7 @@
  \file   Material_Specification.cpp
  \author Morgan McGuire, http://graphics.cs.williams.edu
  \date   2009-03-10
- \edited 2016-02-06
+ \edited 2026-10-17
 */
 #include "GLG3D/UniversalMaterial.h"
 #include "G3D/Any.h"
@@ -147,12 +147,63 @@ UniversalMaterial::Specification::Specification(const Any& any) {
 
 Any UniversalMaterial::Specification::toAny() const {
     Any a(Any::TABLE, "UniversalMaterial::Specification");
-    // TODO
-    debugAssertM(false, "Unimplemented");
+    a["lambertian"]         = m_lambertian;
+    a["glossy"]             = m_glossy;
+    a["transmissive"]       = m_transmissive;
+    a["emissive"]           = m_emissive;
+    if (! m_bump.texture.filename.empty()) {
+        a["bump"]           = m_bump.toAny();
+    }
+    a["etaTransmit"]        = m_etaTransmit;
+    a["extinctionTransmit"] = m_extinctionTransmit;
+    a["etaReflect"]         = m_etaReflect;
+    a["extinctionReflect"]  = m_extinctionReflect;
+    a["refractionHint"]     = m_refractionHint.toAny();
+    a["mirrorHint"]         = m_mirrorHint.toAny();
+    a["alphaHint"]          = m_alphaHint.toAny();
+    a["sampler"]            = m_sampler;
+    a["inferAmbientOcclusionAtTransparentPixels"] = m_inferAmbientOcclusionAtTransparentPixels;
+
+    if (! m_customShaderPrefix.empty()) {
+        a["customShaderPrefix"] = m_customShaderPrefix;
+    }
+
+    if (m_constantTable.size() > 0) {
+        Any constants(Any::TABLE);
+        for (Table<String, double>::Iterator it = m_constantTable.begin(); it.isValid(); ++it) {
+            constants[it->key] = it->value;
+        }
+        a["constantTable"] = constants;
+    }
+
     return a;
 }
 
 
+bool UniversalMaterial::Specification::referencesTextureObjects() const {
+    return notNull(m_lambertianTex) || notNull(m_glossyTex) || notNull(m_transmissiveTex) || 
+        notNull(m_emissiveTex) || notNull(m_customTex) || (m_numLightMapDirections > 0);
+}
+
+
+void UniversalMaterial::Specification::prefetchTextures() const {
+    // UniversalMaterial::create() uploads the lambertian texture first
+    if (isNull(m_lambertianTex)) {
+        Texture::prefetch(m_lambertian, 1);
+    }
+    if (isNull(m_glossyTex)) {
+        Texture::prefetch(m_glossy);
+    }
+    if (isNull(m_transmissiveTex)) {
+        Texture::prefetch(m_transmissive);
+    }
+    if (isNull(m_emissiveTex)) {
+        Texture::prefetch(m_emissive);
+    }
+    Texture::prefetch(m_bump.texture);
+}
+
+
 void UniversalMaterial::Specification::setLambertian(const shared_ptr<Texture>& tex) {
     m_lambertianTex = tex;
 }
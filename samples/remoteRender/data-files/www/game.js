@@ -18,6 +18,9 @@ var MessageType = {
     // Matches G3D::GEventType::KEY_UP
     KEY_UP: 3,
 
+    // Only the tiles that changed since the previous frame.  See G3D::TiledImageEncoder
+    TILED_IMAGE: 4,
+
     SEND_IMAGE: 1000
 };
 
@@ -40,6 +43,9 @@ var dpad;
 /** Current image being displayed */
 var img;
 
+/** Offscreen canvas into which TILED_IMAGE messages are assembled */
+var frameCanvas;
+
 ///////////////////////////////////////////////////////////////
 //                                                           //
 //                      EVENT RULES                          //
@@ -140,6 +146,10 @@ function onReceiveMessage(msg) {
             sendMessage({ type: MessageType.SEND_IMAGE });
             break;
 
+        case MessageType.TILED_IMAGE:
+            receiveTiles(msg);
+            break;
+
     case MessageType.COMMENT:
         console.log('Server says: ' + msg.value);
         break;
@@ -154,6 +164,60 @@ function onReceiveMessage(msg) {
 //                                                           //
 //                      HELPER RULES                         //
 
+/** Decodes the tiles of a TILED_IMAGE message and draws them onto frameCanvas. The 
+    tiles are drawn together once all have decoded, so that a frame never appears half-updated,
+    and only then is the next frame requested.  That keeps at most one frame in flight, so a 
+    slow connection or device lowers the frame rate instead of queuing stale frames. */
+function receiveTiles(msg) {
+    if (! frameCanvas || msg.keyframe) {
+        frameCanvas = document.createElement('canvas');
+        frameCanvas.width = msg.width;
+        frameCanvas.height = msg.height;
+    }
+
+    var tileImage = [];
+    var remaining = msg.tiles.length;
+    var offset = 0;
+
+    if (remaining === 0) {
+        sendMessage({ type: MessageType.SEND_IMAGE });
+        return;
+    }
+
+    function onTileDone() {
+        --remaining;
+        if (remaining === 0) {
+            var ctx = frameCanvas.getContext('2d');
+            for (var i = 0; i < msg.tiles.length; ++i) {
+                if (tileImage[i]) {
+                    ctx.drawImage(tileImage[i], msg.tiles[i][0], msg.tiles[i][1]);
+                }
+            }
+            img = frameCanvas;
+            sendMessage({ type: MessageType.SEND_IMAGE });
+        }
+    }
+
+    msg.tiles.forEach(function (tile, i) {
+        // tile is [x, y, width, height, bytes]
+        var url = URL.createObjectURL(new Blob([msg.data.subarray(offset, offset + tile[4])], { type: msg.mimeType }));
+        offset += tile[4];
+
+        var image = new Image();
+        image.onload = function () {
+            URL.revokeObjectURL(url);
+            tileImage[i] = image;
+            onTileDone();
+        };
+        image.onerror = function () {
+            URL.revokeObjectURL(url);
+            console.log('error loading tile');
+            onTileDone();
+        };
+        image.src = url;
+    });
+}
+
 function createDPad() {
     // Create the directional pad.  Note that images might not have
     // loaded yet, so we can't refer to their width and height.
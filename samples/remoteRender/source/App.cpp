@@ -17,6 +17,9 @@ static Set<struct mg_connection*>   clientSet;
 /** Set to 1 when the client requests a full-screen image and back to 0 after the frame is sent. */
 static AtomicInt32                  clientWantsImage(0);
 
+/** Set to 1 when a client connects, so that the next frame sent contains every tile */
+static AtomicInt32                  clientNeedsKeyframe(0);
+
 int main(int argc, const char* argv[]) {
     initGLG3D();
 
@@ -35,7 +38,7 @@ int main(int argc, const char* argv[]) {
 }
 
 
-App::App(const GApp::Settings& settings) : GApp(settings), m_webServer(NULL) {
+App::App(const GApp::Settings& settings) : GApp(settings), m_webServer(NULL), m_imageClient(NULL) {
 }
 
 
@@ -60,6 +63,11 @@ void App::onInit() {
     developerWindow->cameraControlWindow->moveTo(Point2(developerWindow->cameraControlWindow->rect().x0(), 0));
     m_finalFramebuffer = Framebuffer::create(Texture::createEmpty("App::m_finalFramebuffer[0]", renderDevice->width(), renderDevice->height(), ImageFormat::RGB8(), Texture::DIM_2D));
 
+    // JPEG encoding/decoding takes more time but substantially less bandwidth than PNG
+    TiledImageEncoder::Settings encoderSettings;
+    encoderSettings.fileFormat = Image::JPEG;
+    m_tileEncoder = TiledImageEncoder::create(encoderSettings);
+
     //loadScene(developerWindow->sceneEditorWindow->selectedSceneName());
     loadScene("G3D Sponza");
     
@@ -100,6 +108,7 @@ static void websocket_ready_handler(struct mg_connection* conn) {
 
     mg_websocket_write(conn, 0x1, "{\"type\": 0, \"value\":\"server ready\"}");
     debugPrintf("Connection 0x%x: Opened for websocket\n",  (unsigned int)(uintptr_t)conn);
+    clientNeedsKeyframe = 1;
     clientWantsImage = 1;
 }
 
@@ -260,14 +269,22 @@ String futureTime(int secondsIntoFuture) {
 }
 
 
-static const int IMAGE = 1;
-void mg_websocket_write_image(mg_connection* conn, const shared_ptr<Image>& buf, Image::ImageFileFormat ff) {
+static const int TILED_IMAGE = 4;
+
+/** Sends the changed tiles of a frame as a single binary message.  The JSON header lists
+    the tiles as [x, y, width, height, bytes] and is followed by their compressed data. */
+void mg_websocket_write_tiles(mg_connection* conn, const TiledImageEncoder::Frame& frame) {
     BinaryOutput bo("<memory>", G3D_BIG_ENDIAN);
 
-    alwaysAssertM((ff == Image::PNG) || (ff == Image::JPEG), "Only PNG and JPEG are supported right now");
-    const char* mimeType = (ff == Image::PNG) ? "image/png" : "image/jpeg";
-    const String& msg = 
-        format("{\"type\":%d,\"width\":%d,\"height\":%d,\"mimeType\":\"%s\"}",IMAGE, buf->width(), buf->height(), mimeType);
+    const char* mimeType = (frame.fileFormat == Image::PNG) ? "image/png" : "image/jpeg";
+    String msg = 
+        format("{\"type\":%d,\"width\":%d,\"height\":%d,\"keyframe\":%s,\"mimeType\":\"%s\",\"tiles\":[",
+               TILED_IMAGE, frame.width, frame.height, frame.keyframe ? "true" : "false", mimeType);
+    for (int t = 0; t < frame.tile.size(); ++t) {
+        const TiledImageEncoder::Tile& tile = frame.tile[t];
+        msg += format("%s[%d,%d,%d,%d,%d]", (t > 0) ? "," : "", tile.origin.x, tile.origin.y, tile.width, tile.height, tile.data.size());
+    }
+    msg += "]}";
 
     // JSON header length (in network byte order)
     bo.writeInt32((int32)msg.length());
@@ -276,7 +293,9 @@ void mg_websocket_write_image(mg_connection* conn, const shared_ptr<Image>& buf,
     bo.writeString(msg, (int32)msg.length());
 
     // Binary data
-    buf->serialize(bo, ff);
+    for (int t = 0; t < frame.tile.size(); ++t) {
+        bo.writeBytes(frame.tile[t].data.getCArray(), frame.tile[t].data.size());
+    }
     
     const size_t bytes = mg_websocket_write(conn, 0x2, (const char*)bo.getCArray(), bo.length());
     (void)bytes;
@@ -409,9 +428,23 @@ void App::onGraphics3D(RenderDevice* rd, Array<shared_ptr<Surface> >& allSurface
         // Send the image to the first client
         mg_connection* conn = *clientSet.begin();
 
-        // JPEG encoding/decoding takes more time but substantially less bandwidth than PNG
-        mg_websocket_write_image(conn, m_finalFramebuffer->texture(0)->toImage(ImageFormat::RGB8()), Image::JPEG);
-        clientWantsImage = 0;
+        // The encoder's previous frame is only valid for the client that received it
+        if ((clientNeedsKeyframe.value() != 0) || (conn != m_imageClient)) {
+            m_tileEncoder->forceKeyframe();
+            clientNeedsKeyframe = 0;
+            m_imageClient = conn;
+        }
+
+        TiledImageEncoder::Frame frame;
+        m_tileEncoder->encode(m_finalFramebuffer->texture(0)->toImage(ImageFormat::RGB8())->toPixelTransferBuffer(), frame);
+
+        // If nothing changed, send nothing and check again next frame.  The client requests
+        // each frame only after drawing the previous one, so at most one frame is ever in flight
+        // and a slow connection lowers the frame rate instead of building a backlog.
+        if (frame.tile.size() > 0) {
+            mg_websocket_write_tiles(conn, frame);
+            clientWantsImage = 0;
+        }
     }
     clientSetMutex.unlock();
 }
@@ -11,6 +11,7 @@
 shared_ptr<Texture> qrEncodeHTTPAddress(const NetAddress& addr);
 
 struct mg_context;
+struct mg_connection;
 
 /** 
   Simple example of sending G3D events from a web browser and injecting them
@@ -36,6 +37,12 @@ protected:
     /** The image sent across the network */
     shared_ptr<Framebuffer> m_finalFramebuffer;
 
+    /** Compresses the parts of m_finalFramebuffer that changed since the last frame sent */
+    shared_ptr<TiledImageEncoder> m_tileEncoder;
+
+    /** The client that received the last frame sent */
+    mg_connection*          m_imageClient;
+
     /** Called from onInit */
     void makeGUI();
 
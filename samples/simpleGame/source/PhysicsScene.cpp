@@ -55,13 +55,13 @@ Any PhysicsScene::load(const String& sceneName, const LoadOptions& loadOptions)
 
 
 
-void PhysicsScene::staticIntersectSphere(const Sphere& sphere, Array<Tri>& triArray) const {
-    m_collisionTree.intersectSphere(sphere, triArray);
+void PhysicsScene::staticIntersectSphere(const Sphere& sphere, Array<int>& triIndexArray) const {
+    m_collisionTree.intersectSphere(sphere, triIndexArray);
 }
 
 
-void PhysicsScene::staticIntersectBox(const AABox& box, Array<Tri>& triArray) const {
-    m_collisionTree.intersectBox(box, triArray);
+void PhysicsScene::staticIntersectBox(const AABox& box, Array<int>& triIndexArray) const {
+    m_collisionTree.intersectBox(box, triIndexArray);
 }
 
 
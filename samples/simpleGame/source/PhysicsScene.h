@@ -29,11 +29,19 @@ public:
     /** Extend to read in physics properties */
     virtual Any load(const String& sceneName, const LoadOptions& loadOptions = LoadOptions()) override;
 
-    /** Gets all static triangles within this world-space sphere. */
-    void staticIntersectSphere(const Sphere& sphere, Array<Tri>& triArray) const;
-    void staticIntersectBox(const AABox& box, Array<Tri>& triArray) const;
+    /** Appends the indices of all static triangles within this
+        world-space sphere.  Use staticTri() to access them.  Does not
+        allocate once \a triIndexArray has grown large enough, so
+        reuse it across frames. */
+    void staticIntersectSphere(const Sphere& sphere, Array<int>& triIndexArray) const;
+    void staticIntersectBox(const AABox& box, Array<int>& triIndexArray) const;
     bool staticIntersectRay(const Ray& ray, Tri::Intersector& intersectCallback, float& distance) const;
 
+    /** The static triangle with an index produced by staticIntersectSphere() or staticIntersectBox() */
+    const Tri& staticTri(int index) const {
+        return m_collisionTree[index];
+    }
+
     const CPUVertexArray& getCPUVertexArrayOfCollisionTree() const {
         return m_collisionTree.cpuVertexArray();
     }
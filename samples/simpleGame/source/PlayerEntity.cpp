@@ -109,20 +109,24 @@ void PlayerEntity::onSimulation(SimTime absoluteTime, SimTime deltaTime) {
 }
 
 
-void PlayerEntity::getConservativeCollisionTris(Array<Tri>& triArray, const Vector3& velocity, float deltaTime) const {
+void PlayerEntity::getConservativeCollisionTris(Array<int>& triIndexArray, const Vector3& velocity, float deltaTime) const {
     Sphere nearby = collisionProxy();
     nearby.radius += velocity.length() * deltaTime;
-    ((PhysicsScene*)m_scene)->staticIntersectSphere(nearby, triArray);
+    ((PhysicsScene*)m_scene)->staticIntersectSphere(nearby, triIndexArray);
 
 #   ifdef SHOW_COLLISIONS
         //debugDraw(new SphereShape(nearby), 0, Color4::clear(), Color3::black());
-        debugDraw(new MeshShape(triArray), 0, Color3::cyan(), Color3::blue());
+        Array<Tri> triArray;
+        for (int t = 0; t < triIndexArray.size(); ++t) {
+            triArray.append(((PhysicsScene*)m_scene)->staticTri(triIndexArray[t]));
+        }
+        debugDraw(new MeshShape(((PhysicsScene*)m_scene)->getCPUVertexArrayOfCollisionTree(), triArray), 0, Color3::cyan(), Color3::blue());
 #   endif
 }
 
 
 bool PlayerEntity::findFirstCollision
-(const Array<Tri>&    triArray, 
+(const Array<int>&    triIndexArray, 
  const Vector3&       velocity, 
  float&               stepTime, 
  Vector3&             collisionNormal,
@@ -131,10 +135,11 @@ bool PlayerEntity::findFirstCollision
     bool collision = false;
 
     const Sphere& startSphere = collisionProxy();
-    for (int t = 0; t < triArray.size(); ++t) {
+    const PhysicsScene* scene = (PhysicsScene*)m_scene;
+    const CPUVertexArray& cpuVertexArray = scene->getCPUVertexArrayOfCollisionTree();
+    for (int t = 0; t < triIndexArray.size(); ++t) {
 
-        const Tri& tri = triArray[t];
-        const CPUVertexArray& cpuVertexArray = ((PhysicsScene*)m_scene)->getCPUVertexArrayOfCollisionTree();
+        const Tri& tri = scene->staticTri(triIndexArray[t]);
         Triangle triangle(tri.position(cpuVertexArray,0),tri.position(cpuVertexArray,1), tri.position(cpuVertexArray,2));
         Vector3 C;
         const float d = 
@@ -192,8 +197,8 @@ void PlayerEntity::slideMove(SimTime timeLeft) {
     // Initial velocity
     Vector3 velocity = frame().vectorToWorldSpace(m_desiredOSVelocity) + ((PhysicsScene*)m_scene)->gravity();
 
-    Array<Tri> triArray;
-    getConservativeCollisionTris(triArray, velocity, (float)timeLeft);
+    m_collisionTriIndexArray.fastClear();
+    getConservativeCollisionTris(m_collisionTriIndexArray, velocity, (float)timeLeft);
     
     // Trivial implementation that ignores collisions:
 #   if 0
@@ -214,7 +219,7 @@ void PlayerEntity::slideMove(SimTime timeLeft) {
         Point3 collisionPoint;
 
         const bool collided = 
-            findFirstCollision(triArray, velocity, stepTime, collisionNormal, collisionPoint);
+            findFirstCollision(m_collisionTriIndexArray, velocity, stepTime, collisionNormal, collisionPoint);
 #       ifdef TRACE_COLLISIONS
             debugPrintf("  stepTime = %f\n", stepTime);
 #       endif
@@ -20,6 +20,10 @@ protected:
     /** Unused for rendering, for use by a fps cam. */
     float           m_headTilt;
 
+    /** Indices of the PhysicsScene static triangles near the player.
+        Kept between frames so that collision queries do not allocate. */
+    Array<int>      m_collisionTriIndexArray;
+
     PlayerEntity() {}
 
 #ifdef G3D_OSX
@@ -41,10 +45,11 @@ public:
         velocity may be decreased along some axes during movement.
 
         Called from slideMove(). */
-    void getConservativeCollisionTris(Array<Tri>& triArray, const Vector3& velocity, float deltaTime) const;
+    void getConservativeCollisionTris(Array<int>& triIndexArray, const Vector3& velocity, float deltaTime) const;
     
     /** Finds the first collision between m_collisionProxySphere
-        travelling with \a velocity and the triArray.  Travels for at
+        travelling with \a velocity and the PhysicsScene static
+        triangles indexed by \a triIndexArray.  Travels for at
         most \a stepTime, and updates \a stepTime with the
         collision time if there is one.  Returns true if there is a
         collision before the end of the original \a stepTime.
@@ -53,7 +58,7 @@ public:
         the collision time (separating axis).
     */
     bool findFirstCollision
-    (const Array<Tri>&      triArray, 
+    (const Array<int>&      triIndexArray, 
      const Vector3&         velocity, 
      float&                 stepTime, 
      Vector3&               collisionNormal,
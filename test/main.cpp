@@ -74,11 +74,45 @@ void testQuat();
 void perfKDTree();
 void testKDTree();
 
+void perfTriTree();
+void testTriTree();
+
+void perfAABoxTree();
+void testAABoxTree();
+
+void perfProfiler();
+void testProfiler();
+
+void perfLog();
+void testLog();
+
+void perfUniformTable();
+void testUniformTable();
+
+void perfParticleSystem();
+void testParticleSystem();
+
+void perfParseOBJ();
+void testParseOBJ();
+
+void perfImageLoader();
+void perfImageConvert();
+void testImageLoader();
+
 void testSphere();
 
 void testAABox();
 
 void testReliableConduit(NetworkDevice*);
+void perfReliableConduit();
+void testNetwork();
+void perfNetwork();
+
+void testTiledImageEncoder();
+void perfTiledImageEncoder();
+
+void testCollisionWorld();
+void perfCollisionWorld();
 
 void perfSystemMemcpy();
 void testSystemMemcpy();
@@ -86,6 +120,12 @@ void testSystemMemcpy();
 void perfSystemMemset();
 void testSystemMemset();
 
+void perfSystemMalloc();
+void testSystemMalloc();
+
+void perfArticulatedModel();
+void testArticulatedModel();
+
 void testMap2D();
 
 void testReferenceCount();
@@ -107,6 +147,7 @@ void testTextInput();
 void testTextInput2();
 
 void testTable();
+void testFlatTable();
 void testAdjacency();
 
 void perfTable();
@@ -117,9 +158,13 @@ void testCoordinateFrame();
 
 void testGThread();
 
+void testThreadPool();
+void perfThreadPool();
+
 void testfilter();
 
 void testAny();
+void perfAny();
 
 
 void testunorm8();
@@ -718,10 +763,23 @@ int main(int argc, char* argv[]) {
 
         perfSystemMemcpy();
         perfSystemMemset();
+        perfSystemMalloc();
         printf("%s\n", System::mallocStatus().c_str());
 
         perfArray();
 
+        perfArticulatedModel();
+
+        perfNetwork();
+
+        perfReliableConduit();
+
+        perfTiledImageEncoder();
+
+        perfCollisionWorld();
+
+        perfThreadPool();
+
         perfBinaryIO();
 
         perfTable();
@@ -755,6 +813,22 @@ int main(int argc, char* argv[]) {
         
         perfKDTree();
 
+        perfTriTree();
+
+        perfAABoxTree();
+
+        perfProfiler();
+
+        perfLog();
+
+        perfUniformTable();
+
+        perfParticleSystem();
+        perfParseOBJ();
+        perfAny();
+        perfImageLoader();
+        perfImageConvert();
+
         if (renderDevice) {
             renderDevice->cleanup();
             delete renderDevice;
@@ -795,12 +869,34 @@ int main(int argc, char* argv[]) {
 
     testSpeedLoad();
 
+    testArticulatedModel();
+
     testReliableConduit(NetworkDevice::instance());
 
+    testNetwork();
+
+    testTiledImageEncoder();
+
+    testCollisionWorld();
+
     testFileSystem();
 
     testCollisionDetection();  
 
+    testTriTree();
+
+    testAABoxTree();
+
+    testProfiler();
+
+    testLog();
+
+    testUniformTable();
+
+    testParticleSystem();
+    testParseOBJ();
+    testImageLoader();
+
     testTextInput();
     testTextInput2();
     printf("  passed\n");
@@ -843,6 +939,7 @@ int main(int argc, char* argv[]) {
     testMatrix4();
 
     testTable();
+    testFlatTable();
 
     testTableTable();  
 
@@ -855,11 +952,15 @@ int main(int argc, char* argv[]) {
     testAtomicInt32();
 
     testGThread();
+
+    testThreadPool();
     
     testWeakCache();
     
     testSystemMemset();
 
+    testSystemMalloc();
+
     testSystemMemcpy();
 
     testuint128();
@@ -0,0 +1,246 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+/** Spheres inscribed in their bounding boxes stand in for objects with
+    exact intersection tests */
+void makeSpheres(int n, float worldSize, Random& rnd, Array<Sphere>& sphereArray, Array<AABox>& boundsArray) {
+    sphereArray.fastClear();
+    boundsArray.fastClear();
+    for (int i = 0; i < n; ++i) {
+        const Point3 center(rnd.uniform(0, worldSize), rnd.uniform(0, worldSize * 0.1f), rnd.uniform(0, worldSize));
+        sphereArray.append(Sphere(center, rnd.uniform(0.1f, 2.0f)));
+        AABox box;
+        sphereArray.last().getBounds(box);
+        boundsArray.append(box);
+    }
+}
+
+
+int closestLinear(const Ray& ray, const Array<Sphere>& sphereArray, float& distance) {
+    int closest = -1;
+    for (int i = 0; i < sphereArray.size(); ++i) {
+        const float t = ray.intersectionTime(sphereArray[i]);
+        if (t < distance) {
+            distance = t;
+            closest = i;
+        }
+    }
+    return closest;
+}
+
+
+int closestTree(const Ray& ray, const AABoxTree& tree, const Array<Sphere>& sphereArray, float& distance) {
+    int closest = -1;
+    tree.intersectRay(ray, distance, [&](int index, float& distance) {
+        const float t = ray.intersectionTime(sphereArray[index]);
+        if (t < distance) {
+            distance = t;
+            closest = index;
+        }
+    });
+    return closest;
+}
+
+
+Ray randomRay(float worldSize, Random& rnd) {
+    const Point3 origin(rnd.uniform(-10, worldSize + 10), rnd.uniform(-5, worldSize * 0.1f + 5), rnd.uniform(-10, worldSize + 10));
+    Vector3 direction = Vector3::random(rnd);
+    if (rnd.integer(0, 9) == 0) {
+        // Exercise the axis-parallel cases
+        direction = Vector3::unitX() * float(rnd.integer(0, 1) * 2 - 1);
+    }
+    return Ray::fromOriginAndDirection(origin, direction);
+}
+
+
+void checkQueries(const AABoxTree& tree, const Array<Sphere>& sphereArray, const Array<AABox>& boundsArray, float worldSize, Random& rnd) {
+    testAssert(tree.size() == boundsArray.size());
+
+    for (int r = 0; r < 500; ++r) {
+        const Ray& ray = randomRay(worldSize, rnd);
+        float expectedDistance = finf();
+        const int expected = closestLinear(ray, sphereArray, expectedDistance);
+        float distance = finf();
+        const int actual = closestTree(ray, tree, sphereArray, distance);
+        testAssertM(actual == expected, format("ray %d hit %d, expected %d", r, actual, expected));
+        testAssert(distance == expectedDistance);
+    }
+
+    for (int q = 0; q < 100; ++q) {
+        const Point3 center(rnd.uniform(0, worldSize), rnd.uniform(0, worldSize * 0.1f), rnd.uniform(0, worldSize));
+        const AABox box(center, center + Vector3(rnd.uniform(0, 10), rnd.uniform(0, 10), rnd.uniform(0, 10)));
+        const Sphere sphere(center, rnd.uniform(0, 10));
+
+        Array<int> boxMembers, sphereMembers;
+        tree.getIntersectingMembers(box, boxMembers);
+        tree.getIntersectingMembers(sphere, sphereMembers);
+
+        int numBox = 0, numSphere = 0;
+        for (int i = 0; i < boundsArray.size(); ++i) {
+            if (boundsArray[i].intersects(box)) {
+                ++numBox;
+                testAssert(boxMembers.contains(i));
+            }
+            if (boundsArray[i].intersects(sphere)) {
+                ++numSphere;
+                testAssert(sphereMembers.contains(i));
+            }
+        }
+        testAssert(boxMembers.size() == numBox);
+        testAssert(sphereMembers.size() == numSphere);
+    }
+
+    Array<Vector2int32> pairs;
+    tree.getIntersectingPairs(pairs);
+    Set<Vector2int32> pairSet;
+    for (int p = 0; p < pairs.size(); ++p) {
+        testAssert(pairs[p].x < pairs[p].y);
+        testAssertM(! pairSet.contains(pairs[p]), "Duplicate pair");
+        pairSet.insert(pairs[p]);
+    }
+    int numPairs = 0;
+    for (int i = 0; i < boundsArray.size(); ++i) {
+        for (int j = i + 1; j < boundsArray.size(); ++j) {
+            if (boundsArray[i].intersects(boundsArray[j])) {
+                ++numPairs;
+                testAssert(pairSet.contains(Vector2int32(i, j)));
+            }
+        }
+    }
+    testAssert(pairs.size() == numPairs);
+}
+
+}
+
+
+static void testQueries() {
+    Random rnd(10, false);
+    const float worldSize = 200.0f;
+    Array<Sphere> sphereArray;
+    Array<AABox> boundsArray;
+    makeSpheres(2000, worldSize, rnd, sphereArray, boundsArray);
+
+    AABoxTree tree;
+    tree.setContents(boundsArray);
+    checkQueries(tree, sphereArray, boundsArray, worldSize, rnd);
+
+    // Every member at the same place forces count-based splits
+    Array<AABox> sameArray;
+    Array<Sphere> sameSphereArray;
+    for (int i = 0; i < 50; ++i) {
+        sameSphereArray.append(Sphere(Point3(1, 2, 3), 1.0f));
+        sameArray.append(AABox(Point3(0, 1, 2), Point3(2, 3, 4)));
+    }
+    tree.setContents(sameArray);
+    Array<int> members;
+    tree.getIntersectingMembers(AABox(Point3(1, 1, 1), Point3(2, 2, 2)), members);
+    testAssert(members.size() == 50);
+    Array<Vector2int32> pairs;
+    tree.getIntersectingPairs(pairs);
+    testAssert(pairs.size() == 50 * 49 / 2);
+    float distance = finf();
+    testAssert(closestTree(Ray::fromOriginAndDirection(Point3(1, 2, -10), Vector3::unitZ()), tree, sameSphereArray, distance) >= 0);
+
+    tree.clear();
+    testAssert(tree.size() == 0);
+    distance = finf();
+    testAssert(closestTree(Ray::fromOriginAndDirection(Point3::zero(), Vector3::unitZ()), tree, sphereArray, distance) == -1);
+}
+
+
+static void testRefit() {
+    Random rnd(11, false);
+    const float worldSize = 200.0f;
+    Array<Sphere> sphereArray;
+    Array<AABox> boundsArray;
+    makeSpheres(1000, worldSize, rnd, sphereArray, boundsArray);
+
+    AABoxTree tree;
+    tree.setContents(boundsArray);
+
+    // Small motion only refits
+    for (int i = 0; i < sphereArray.size(); ++i) {
+        sphereArray[i].center += Vector3::random(rnd) * 0.1f;
+        sphereArray[i].getBounds(boundsArray[i]);
+    }
+    testAssert(! tree.refit(boundsArray));
+    checkQueries(tree, sphereArray, boundsArray, worldSize, rnd);
+
+    // Shuffling everything degrades the tree enough to rebuild
+    for (int i = 0; i < sphereArray.size(); ++i) {
+        sphereArray[i].center = Point3(rnd.uniform(0, worldSize), rnd.uniform(0, worldSize * 0.1f), rnd.uniform(0, worldSize));
+        sphereArray[i].getBounds(boundsArray[i]);
+    }
+    testAssert(tree.refit(boundsArray));
+    checkQueries(tree, sphereArray, boundsArray, worldSize, rnd);
+}
+
+
+void testAABoxTree() {
+    printf("AABoxTree ");
+
+    testQueries();
+    testRefit();
+
+    printf("passed\n");
+}
+
+
+void perfAABoxTree() {
+    printf("AABoxTree:\n");
+
+    Random rnd(12, false);
+    const float worldSize = 1000.0f;
+    Array<Sphere> sphereArray;
+    Array<AABox> boundsArray;
+
+    printf("  %8s %12s %12s %12s %12s\n", "Members", "Build(ms)", "Refit(ms)", "Linear(us)", "Tree(us)");
+    for (int n = 100; n <= 100000; n *= 10) {
+        makeSpheres(n, worldSize, rnd, sphereArray, boundsArray);
+
+        AABoxTree tree;
+        Stopwatch sw;
+        sw.tick();
+        tree.setContents(boundsArray);
+        sw.tock();
+        const RealTime buildTime = sw.elapsedTime();
+
+        for (int i = 0; i < sphereArray.size(); ++i) {
+            sphereArray[i].center += Vector3::random(rnd) * 0.5f;
+            sphereArray[i].getBounds(boundsArray[i]);
+        }
+        sw.tick();
+        tree.refit(boundsArray);
+        sw.tock();
+        const RealTime refitTime = sw.elapsedTime();
+
+        Array<Ray> rayArray;
+        for (int r = 0; r < 1000; ++r) {
+            rayArray.append(randomRay(worldSize, rnd));
+        }
+
+        int check = 0;
+        sw.tick();
+        for (int r = 0; r < rayArray.size(); ++r) {
+            float distance = finf();
+            check += closestLinear(rayArray[r], sphereArray, distance);
+        }
+        sw.tock();
+        const RealTime linearTime = sw.elapsedTime() / rayArray.size();
+
+        sw.tick();
+        for (int r = 0; r < rayArray.size(); ++r) {
+            float distance = finf();
+            check -= closestTree(rayArray[r], tree, sphereArray, distance);
+        }
+        sw.tock();
+        const RealTime treeTime = sw.elapsedTime() / rayArray.size();
+        testAssert(check == 0);
+
+        printf("  %8d %12.3f %12.3f %12.2f %12.2f\n", n, buildTime / units::milliseconds(), refitTime / units::milliseconds(),
+               linearTime * 1e6, treeTime * 1e6);
+    }
+    printf("\n");
+}
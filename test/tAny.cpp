@@ -5,7 +5,7 @@
  \author Shawn Yarbrough
 
  \created 2009-11-03
- \edited  2011-10-30
+ \edited  2026-10-17
 
  Copyright 2000-2015, Morgan McGuire.
  All rights reserved.
@@ -289,6 +289,102 @@ static void testParse() {
     }
 }
 
+/** Text similar to a large .Scene.Any file */
+static String makeSceneText(int numEntities) {
+    String s = "// Generated scene\nScene {\n    name = \"Test\";\n    entities = {\n";
+    for (int i = 0; i < numEntities; ++i) {
+        s += format("        entity%d = VisibleEntity {\n"
+                    "            // Entity %d\n"
+                    "            model = \"model%d\";\n"
+                    "            frame = CFrame::fromXYZYPRDegrees(%d, 1.5, -2, 45, 0, %d);\n"
+                    "            canChange = %s;\n"
+                    "            mask = 0x%x;\n"
+                    "            track = nil;\n"
+                    "        };\n", i, i, i % 10, i, i % 90, (i % 2 == 0) ? "true" : "false", i);
+    }
+    s += "    };\n    models = { model0 = ArticulatedModel::Specification { filename = \"a.obj\"; scale = [1, 2, 3]; } };\n};\n";
+    return s;
+}
+
+
+static void testSpeedSerialize() {
+    const Any& original = Any::parse(makeSceneText(20));
+
+    BinaryOutput out("<memory>", G3D_LITTLE_ENDIAN);
+    original.speedSerialize(out);
+    BinaryInput in(out.getCArray(), out.size(), G3D_LITTLE_ENDIAN);
+    Any copy;
+    copy.speedDeserialize(in);
+    testAssert(! in.hasMore());
+
+    testAssert(copy == original);
+    testAssert(copy.name() == "Scene");
+    testAssert(copy["entities"]["entity3"]["frame"].name() == "CFrame::fromXYZYPRDegrees");
+    testAssert(copy["entities"]["entity3"]["frame"][0].number() == 3);
+    testAssert(copy["entities"]["entity3"]["canChange"].boolean() == false);
+    testAssert(copy["entities"]["entity3"].comment().empty());
+
+    // Containers keep their source for error messages
+    testAssert(copy["entities"]["entity3"].source().line == original["entities"]["entity3"].source().line);
+    testAssert(copy["entities"].source().filename == original["entities"].source().filename);
+
+    // Hex integers still unparse as hex
+    TextOutput::Settings settings;
+    settings.wordWrap = TextOutput::Settings::WRAP_NONE;
+    testAssert(copy["entities"]["entity10"]["mask"].unparse(settings) == "0xa");
+}
+
+
+static void testParseCache() {
+    const String directory = "anycache";
+    {
+        TextOutput t("anycache-include.Any");
+        t.printf("[1, 2, 3]");
+        t.commit();
+    }
+    {
+        TextOutput t("anycache-test.Any");
+        t.printf("// Comment\n{ a = #include(\"anycache-include.Any\"); b = \"x\"; }");
+        t.commit();
+    }
+
+    Any::setParseCacheDirectory(directory);
+
+    // The first load parses the text and keeps its comments
+    Any a = Any::fromFile("anycache-test.Any");
+    testAssert(a.comment() == "Comment");
+    Array<String> cacheFiles;
+    FileSystem::getFiles(FilePath::concat(directory, "*.AnyCache"), cacheFiles);
+    testAssert(cacheFiles.size() == 1);
+
+    // The second comes from the cache, without comments
+    Any b = Any::fromFile("anycache-test.Any");
+    testAssert(b.comment().empty());
+    testAssert(a == b);
+    testAssert(b["a"].size() == 3);
+
+    // Saving preserves the #include
+    TextOutput::Settings settings;
+    settings.wordWrap = TextOutput::Settings::WRAP_NONE;
+    testAssert(b.unparse(settings).find("#include") != String::npos);
+
+    // Changing an included file invalidates the cache
+    {
+        TextOutput t("anycache-include.Any");
+        t.printf("[1, 2, 3, 4]");
+        t.commit();
+    }
+    Any c = Any::fromFile("anycache-test.Any");
+    testAssert(c.comment() == "Comment");
+    testAssert(c["a"].size() == 4);
+
+    Any::setParseCacheDirectory("");
+    FileSystem::removeFile(FilePath::concat(directory, "*.AnyCache"));
+    FileSystem::removeFile("anycache-test.Any");
+    FileSystem::removeFile("anycache-include.Any");
+}
+
+
 static void testTableReader() {
     Any a(Any::TABLE);
     a["HI"] = 3;
@@ -311,6 +407,8 @@ void testAny() {
     printf("G3D::Any ");
     testTableReader();
     testParse();
+    testSpeedSerialize();
+    testParseCache();
 
     testRefCount1();
     testRefCount2();
@@ -363,3 +461,30 @@ void testAny() {
     printf("passed\n");
 
 };    // void testAny()
+
+
+void perfAny() {
+    printf("Any parse (5000 entity scene):\n");
+    const String& src = makeSceneText(5000);
+    Stopwatch sw;
+
+    sw.tick();
+    const Any& parsed = Any::parse(src);
+    sw.tock();
+    const RealTime parseTime = sw.elapsedTime();
+
+    BinaryOutput out("<memory>", G3D_LITTLE_ENDIAN);
+    parsed.speedSerialize(out);
+
+    sw.tick();
+    {
+        BinaryInput in(out.getCArray(), out.size(), G3D_LITTLE_ENDIAN);
+        Any copy;
+        copy.speedDeserialize(in);
+    }
+    sw.tock();
+    const RealTime speedTime = sw.elapsedTime();
+
+    printf("  Text:      %7.2f ms  (%6.2f MB)\n", parseTime / units::milliseconds(), src.size() / (1024.0 * 1024.0));
+    printf("  SpeedLoad: %7.2f ms  (%6.2f MB)\n\n", speedTime / units::milliseconds(), out.size() / (1024.0 * 1024.0));
+}
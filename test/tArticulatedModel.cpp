@@ -0,0 +1,170 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+#include <thread>
+#include <atomic>
+
+/** Spacing of the grids, chosen so that positions are not small integers, which hash poorly */
+static const float GRID_SPACING = 0.0371f;
+
+/** Adds an n x n grid of quads in the XY plane with unwelded vertices and
+    no normals or tangents, as a loader might produce */
+static ArticulatedModel::Geometry* addGrid(const shared_ptr<ArticulatedModel>& model, ArticulatedModel::Part* part, const String& name, int n) {
+    ArticulatedModel::Geometry* geometry = model->addGeometry(name);
+    ArticulatedModel::Mesh* mesh = model->addMesh(name, part, geometry);
+    CPUVertexArray& cpuVertexArray = geometry->cpuVertexArray;
+    cpuVertexArray.hasTexCoord0 = true;
+
+    const int corner[6][2] = {{0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1}};
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            for (int c = 0; c < 6; ++c) {
+                mesh->cpuIndexArray.append(cpuVertexArray.size());
+                CPUVertexArray::Vertex& v = cpuVertexArray.vertex.next();
+                v.position  = Point3(float(x + corner[c][0]), float(y + corner[c][1]), 0.0f) * GRID_SPACING;
+                v.texCoord0 = Point2(float(x + corner[c][0]), float(y + corner[c][1])) / float(n);
+                v.normal    = Vector3::nan();
+                v.tangent   = Vector4::nan();
+            }
+        }
+    }
+
+    return geometry;
+}
+
+
+static void checkGrid(const ArticulatedModel::Geometry* geometry, const ArticulatedModel::Mesh* mesh, int n) {
+    const CPUVertexArray& cpuVertexArray = geometry->cpuVertexArray;
+    testAssertM(cpuVertexArray.size() == square(n + 1), "Vertices were not welded");
+    testAssert(mesh->cpuIndexArray.size() == 6 * n * n);
+
+    for (int i = 0; i < mesh->cpuIndexArray.size(); ++i) {
+        testAssert(mesh->cpuIndexArray[i] >= 0 && mesh->cpuIndexArray[i] < cpuVertexArray.size());
+    }
+
+    for (int i = 0; i < cpuVertexArray.size(); ++i) {
+        const CPUVertexArray::Vertex& v = cpuVertexArray.vertex[i];
+        testAssert(v.normal.fuzzyEq(Vector3::unitZ()));
+        testAssert(v.tangent.xyz().fuzzyEq(Vector3::unitX()));
+    }
+
+    testAssert(geometry->boxBounds.high().fuzzyEq(Point3(float(n), float(n), 0.0f) * GRID_SPACING));
+}
+
+
+/** Two meshes that share one welded Geometry, each tracing its own half of a grid */
+static void testSharedGeometryIntersect() {
+    const int n = 8;
+    const shared_ptr<ArticulatedModel> model = ArticulatedModel::createEmpty("split");
+    ArticulatedModel::Part* part = model->addPart("root");
+    ArticulatedModel::Geometry* geometry = addGrid(model, part, "left", n);
+
+    // Move the quads with x >= n / 2 to a second mesh of the same Geometry
+    ArticulatedModel::Mesh* left = model->meshArray()[0];
+    ArticulatedModel::Mesh* right = model->addMesh("right", part, geometry);
+    Array<int> leftIndex;
+    for (int i = 0; i < left->cpuIndexArray.size(); i += 6) {
+        const int x = (i / 6) % n;
+        Array<int>& dst = (x < n / 2) ? leftIndex : right->cpuIndexArray;
+        for (int c = 0; c < 6; ++c) {
+            dst.append(left->cpuIndexArray[i + c]);
+        }
+    }
+    left->cpuIndexArray = leftIndex;
+    model->cleanGeometry();
+
+    for (int x = 0; x < n; ++x) {
+        const Point3 origin(Point2(x + 0.3f, 2.6f) * GRID_SPACING, 1.0f);
+        float distance = finf();
+        Model::HitInfo info;
+        testAssert(model->intersect(Ray(origin, -Vector3::unitZ()), CFrame(), ArticulatedModel::Pose(), distance, info));
+        testAssert(fuzzyEq(distance, 1.0f));
+        testAssert(info.meshName == ((x < n / 2) ? "left" : "right"));
+
+        // The primitive index refers to the mesh's own index array
+        const ArticulatedModel::Mesh* mesh = (x < n / 2) ? left : right;
+        const int i = info.primitiveIndex * 3;
+        testAssert(i + 2 < mesh->cpuIndexArray.size());
+        const Point3& p0 = geometry->cpuVertexArray.vertex[mesh->cpuIndexArray[i]].position;
+        testAssert(abs(p0.x - origin.x) <= GRID_SPACING);
+    }
+}
+
+
+/** Several threads trace a model whose mesh trees have not been built yet, so
+    that they all reach the lazy build at once */
+static void testConcurrentIntersect() {
+    const int n = 16;
+    const shared_ptr<ArticulatedModel> model = ArticulatedModel::createEmpty("concurrent");
+    ArticulatedModel::Part* part = model->addPart("root");
+    addGrid(model, part, "grid", n);
+    model->cleanGeometry();
+
+    std::atomic<int> numMisses(0);
+    Array<shared_ptr<std::thread> > threadArray;
+    for (int t = 0; t < 4; ++t) {
+        threadArray.append(shared_ptr<std::thread>(new std::thread([&model, &numMisses, t] {
+            for (int r = 0; r < 200; ++r) {
+                const Point3 origin(Point2((r % n) + 0.3f, ((r / n + t) % n) + 0.6f) * GRID_SPACING, 1.0f);
+                float distance = finf();
+                if (! model->intersect(Ray(origin, -Vector3::unitZ()), CFrame(), ArticulatedModel::Pose(), distance) ||
+                    ! fuzzyEq(distance, 1.0f)) {
+                    ++numMisses;
+                }
+            }
+        })));
+    }
+    for (int t = 0; t < threadArray.size(); ++t) {
+        threadArray[t]->join();
+    }
+    testAssert(numMisses.load() == 0);
+}
+
+
+void testArticulatedModel() {
+    printf("ArticulatedModel::cleanGeometry ");
+
+    // The large grid exceeds the size at which vertices are welded in parallel
+    const int size[] = {3, 260, 1, 40, 7};
+    const int numGrids = sizeof(size) / sizeof(size[0]);
+
+    const shared_ptr<ArticulatedModel> model = ArticulatedModel::createEmpty("grids");
+    ArticulatedModel::Part* part = model->addPart("root");
+    for (int g = 0; g < numGrids; ++g) {
+        addGrid(model, part, format("grid%d", g), size[g]);
+    }
+
+    model->cleanGeometry();
+
+    for (int g = 0; g < numGrids; ++g) {
+        checkGrid(model->geometryArray()[g], model->meshArray()[g], size[g]);
+    }
+
+    testSharedGeometryIntersect();
+    testConcurrentIntersect();
+
+    printf("passed\n");
+}
+
+
+void perfArticulatedModel() {
+    printf("ArticulatedModel::cleanGeometry\n");
+
+    for (int numGrids = 1; numGrids <= 8; numGrids *= 8) {
+        const int n = 300;
+        const shared_ptr<ArticulatedModel> model = ArticulatedModel::createEmpty("grids");
+        ArticulatedModel::Part* part = model->addPart("root");
+        for (int g = 0; g < numGrids; ++g) {
+            addGrid(model, part, format("grid%d", g), n);
+        }
+
+        Stopwatch sw;
+        sw.tick();
+        model->cleanGeometry();
+        sw.tock();
+
+        const int numTriangles = numGrids * 2 * n * n;
+        printf("  %d Geometry, %d triangles: %7.1f ms (%5.0f ns/triangle)\n", numGrids, numTriangles,
+               sw.elapsedTime() / units::milliseconds(), sw.elapsedTime() * 1e9 / numTriangles);
+    }
+    printf("\n");
+}
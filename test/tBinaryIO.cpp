@@ -239,9 +239,61 @@ static void measureOverhead() {
 }
 
 
+/** Compares opening and scanning a large file through a memory mapped
+    BinaryInput against copying it into a heap buffer first. */
+static void measureFileReadPerformance() {
+    const String filename = "mmap-perf.bin";
+    const int64 length = 64 * 1024 * 1024;
+    {
+        Array<uint32> data;
+        data.resize(int(length / sizeof(uint32)));
+        for (int i = 0; i < data.size(); ++i) {
+            data[i] = i;
+        }
+        BinaryOutput bo(filename, G3D_LITTLE_ENDIAN);
+        bo.writeBytes(data.getCArray(), length);
+        bo.commit();
+    }
+
+    uint64 sum0 = 0, sum1 = 0;
+    Stopwatch sw;
+    sw.tick();
+    {
+        FILE* file = FileSystem::fopen(filename.c_str(), "rb");
+        uint8* buffer = (uint8*)System::alignedMalloc(size_t(length), 16);
+        (void)fread(buffer, 1, size_t(length), file);
+        FileSystem::fclose(file);
+        for (int64 i = 0; i < length; i += 64) {
+            sum0 += buffer[i];
+        }
+        System::alignedFree(buffer);
+    }
+    sw.tock();
+    const RealTime copyTime = sw.elapsedTime();
+
+    sw.tick();
+    {
+        BinaryInput bi(filename, G3D_LITTLE_ENDIAN);
+        const uint8* buffer = bi.getCArray();
+        for (int64 i = 0; i < length; i += 64) {
+            sum1 += buffer[i];
+        }
+    }
+    sw.tock();
+    const RealTime mapTime = sw.elapsedTime();
+    testAssert(sum0 == sum1);
+    FileSystem::removeFile(filename);
+
+    printf("Open and scan 64 MB file (warm cache):\n");
+    printf("  fread into heap buffer:     %7.2f ms\n", copyTime / units::milliseconds());
+    printf("  Memory mapped BinaryInput:  %7.2f ms\n\n", mapTime / units::milliseconds());
+}
+
+
 void perfBinaryIO() {
     measureOverhead();
     measureSerializerPerformance();
+    measureFileReadPerformance();
 }
 
 
@@ -404,9 +456,61 @@ static void testStringSerialization() {
 
 }
 
+static void testMemoryMapped() {
+    const String filename = "mmap-test.bin";
+    const int n = 3 * 1024 * 1024 / sizeof(uint32);
+    {
+        BinaryOutput bo(filename, G3D_LITTLE_ENDIAN);
+        for (int i = 0; i < n; ++i) {
+            bo.writeUInt32(i * 2654435761u);
+        }
+        bo.writeString("end");
+        bo.commit();
+    }
+
+    {
+        BinaryInput bi(filename, G3D_LITTLE_ENDIAN);
+        testAssert(bi.memoryMapped());
+        testAssert(bi.getLength() == int64(n) * 4 + 4);
+
+        // Zero-copy access to the whole file
+        const uint8* data = bi.getCArray();
+        testAssert(*(const uint32*)(data + 4 * 1000) == 1000 * 2654435761u);
+
+        for (int i = 0; i < n; ++i) {
+            if (bi.readUInt32() != i * 2654435761u) {
+                testAssertM(false, format("Element %d", i));
+            }
+        }
+        testAssert(bi.readString() == "end");
+        testAssert(! bi.hasMore());
+
+        // Random access
+        bi.setPosition(4 * 12345);
+        testAssert(bi.readUInt32() == 12345 * 2654435761u);
+        bi.setEndian(G3D_BIG_ENDIAN);
+        bi.setPosition(4 * 7);
+        testAssert(bi.readUInt32() == flipEndian32(7 * 2654435761u));
+    }
+
+    {
+        // Small files are copied
+        BinaryOutput bo(filename, G3D_LITTLE_ENDIAN);
+        bo.writeUInt32(7);
+        bo.commit();
+        BinaryInput bi(filename, G3D_LITTLE_ENDIAN);
+        testAssert(! bi.memoryMapped());
+        testAssert(bi.readUInt32() == 7);
+    }
+
+    FileSystem::removeFile(filename);
+}
+
+
 void testBinaryIO() {
     testStringSerialization();
     testBasicSerialization();
     testBitSerialization();
     testCompression();
+    testMemoryMapped();
 }
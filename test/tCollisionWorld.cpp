@@ -0,0 +1,287 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+class Body {
+public:
+    CollisionWorld::ShapeType   type;
+    Point3                      position;
+    Vector3                     velocity;
+    Vector3                     axis;
+    float                       radius;
+    int                         proxy;
+};
+
+
+/** Inserts or moves the proxy for \a body */
+void place(const shared_ptr<CollisionWorld>& world, Body& body, bool insert) {
+    const Vector3& halfAxis = body.axis * body.radius;
+    switch (body.type) {
+    case CollisionWorld::SPHERE:
+        {
+            const Sphere s(body.position, body.radius);
+            if (insert) { body.proxy = world->insert(s); } else { world->set(body.proxy, s); }
+        }
+        break;
+
+    case CollisionWorld::CAPSULE:
+        {
+            const Capsule c(body.position - halfAxis, body.position + halfAxis, body.radius * 0.5f);
+            if (insert) { body.proxy = world->insert(c); } else { world->set(body.proxy, c); }
+        }
+        break;
+
+    case CollisionWorld::BOX:
+        {
+            const CFrame frame(Matrix3::fromUnitAxisAngle(body.axis, body.radius * 3.0f), body.position);
+            const Box b = frame.toWorldSpace(Box(-Vector3::one() * body.radius, Vector3::one() * body.radius));
+            if (insert) { body.proxy = world->insert(b); } else { world->set(body.proxy, b); }
+        }
+        break;
+
+    case CollisionWorld::AABOX:
+        {
+            const AABox b(body.position - Vector3::one() * body.radius, body.position + Vector3::one() * body.radius);
+            if (insert) { body.proxy = world->insert(b); } else { world->set(body.proxy, b); }
+        }
+        break;
+    }
+}
+
+
+void makeBodies(int n, float worldSize, bool spheresOnly, Random& rnd, const shared_ptr<CollisionWorld>& world, Array<Body>& bodyArray) {
+    bodyArray.resize(n);
+    for (int i = 0; i < n; ++i) {
+        Body& body = bodyArray[i];
+        body.type = spheresOnly ? CollisionWorld::SPHERE : CollisionWorld::ShapeType(rnd.integer(0, 3));
+        body.position = Point3(rnd.uniform(0, worldSize), rnd.uniform(0, worldSize), rnd.uniform(0, worldSize));
+        body.velocity = Vector3::random(rnd) * rnd.uniform(0.0f, 2.0f);
+        body.axis = Vector3::random(rnd);
+        body.radius = rnd.uniform(0.25f, 1.0f);
+        place(world, body, true);
+    }
+}
+
+
+/** Advances every body by \a dt, bouncing off of the walls of the world */
+void step(const shared_ptr<CollisionWorld>& world, Array<Body>& bodyArray, float worldSize, float dt) {
+    for (int i = 0; i < bodyArray.size(); ++i) {
+        Body& body = bodyArray[i];
+        body.position += body.velocity * dt;
+        for (int a = 0; a < 3; ++a) {
+            if ((body.position[a] < 0.0f) || (body.position[a] > worldSize)) {
+                body.velocity[a] = -body.velocity[a];
+                body.position[a] = clamp(body.position[a], 0.0f, worldSize);
+            }
+        }
+        place(world, body, false);
+    }
+}
+
+
+/** The O(n^2) algorithm that CollisionWorld replaces */
+void bruteForcePairs(const shared_ptr<CollisionWorld>& world, const Array<int>& idArray, Array<CollisionWorld::Pair>& pairs) {
+    pairs.fastClear();
+    for (int i = 0; i < idArray.size(); ++i) {
+        for (int j = i + 1; j < idArray.size(); ++j) {
+            const int a = min(idArray[i], idArray[j]);
+            const int b = max(idArray[i], idArray[j]);
+            if (world->bounds(a).intersects(world->bounds(b))) {
+                pairs.append(CollisionWorld::Pair(a, b));
+            }
+        }
+    }
+    pairs.sort([](const CollisionWorld::Pair& x, const CollisionWorld::Pair& y) {
+        return (x.a < y.a) || ((x.a == y.a) && (x.b < y.b));
+    });
+}
+
+
+void checkPairs(const shared_ptr<CollisionWorld>& world, const Array<int>& idArray) {
+    Array<CollisionWorld::Pair> actual, expected;
+    world->getOverlappingPairs(actual);
+    bruteForcePairs(world, idArray, expected);
+    testAssertM(actual.size() == expected.size(), format("Found %d pairs instead of %d", actual.size(), expected.size()));
+    for (int i = 0; i < actual.size(); ++i) {
+        testAssertM(actual[i] == expected[i], "Wrong or unsorted pair");
+    }
+
+    Array<CollisionWorld::Contact> contactArray;
+    world->getContacts(actual, contactArray);
+    int numContacts = 0;
+    for (int i = 0; i < expected.size(); ++i) {
+        CollisionWorld::Contact contact;
+        if (world->getContact(expected[i].a, expected[i].b, contact)) {
+            testAssert(numContacts < contactArray.size());
+            const CollisionWorld::Contact& c = contactArray[numContacts];
+            testAssert((c.a == contact.a) && (c.b == contact.b) && (c.depth == contact.depth));
+            testAssert(fuzzyEq(c.normal.length(), 1.0f));
+            ++numContacts;
+        }
+    }
+    testAssert(numContacts == contactArray.size());
+}
+
+
+void testKnownContacts() {
+    const shared_ptr<CollisionWorld>& world = CollisionWorld::create();
+    CollisionWorld::Contact contact;
+
+    const int s0 = world->insert(Sphere(Point3(0, 0, 0), 1.0f));
+    const int s1 = world->insert(Sphere(Point3(1.5f, 0, 0), 1.0f));
+    testAssert(world->getContact(s0, s1, contact));
+    testAssert(fuzzyEq(contact.depth, 0.5f));
+    testAssert(contact.normal.fuzzyEq(Vector3::unitX()));
+
+    // The normal points from a to b
+    testAssert(world->getContact(s1, s0, contact));
+    testAssert(contact.normal.fuzzyEq(-Vector3::unitX()));
+
+    // A sphere beside the middle of a capsule
+    const int c0 = world->insert(Capsule(Point3(0, -5, 3), Point3(0, 5, 3), 0.5f));
+    const int s2 = world->insert(Sphere(Point3(0, 0, 4), 0.75f));
+    testAssert(world->getContact(c0, s2, contact));
+    testAssert(fuzzyEq(contact.depth, 0.25f));
+    testAssert(contact.normal.fuzzyEq(Vector3::unitZ()));
+    testAssert(! world->getContact(c0, s0, contact));
+
+    // Crossed capsules, which infinite-line closest points would also handle,
+    // and parallel ones offset along their axes, which they would not
+    const int c1 = world->insert(Capsule(Point3(-5, 0, 3.8f), Point3(5, 0, 3.8f), 0.5f));
+    testAssert(world->getContact(c0, c1, contact));
+    testAssert(fuzzyEq(contact.depth, 0.2f));
+    const int c2 = world->insert(Capsule(Point3(0, 5.5f, 3.6f), Point3(0, 15, 3.6f), 0.5f));
+    testAssert(world->getContact(c0, c2, contact));
+    testAssert(abs(contact.depth - (1.0f - Vector2(0.5f, 0.6f).length())) < 1e-4f);
+    world->set(c2, Capsule(Point3(0, 7, 3.1f), Point3(0, 15, 3.1f), 0.5f));
+    testAssert(! world->getContact(c0, c2, contact));
+
+    // A capsule lying across the top of a rotated box
+    const int b0 = world->insert(CFrame(Matrix3::fromAxisAngle(Vector3::unitY(), 0.5f), Point3(20, 0, 0)).toWorldSpace(Box(-Vector3::one(), Vector3::one())));
+    const int c3 = world->insert(Capsule(Point3(15, 1.25f, 0.3f), Point3(25, 1.25f, -0.2f), 0.5f));
+    testAssert(world->getContact(b0, c3, contact));
+    testAssert(abs(contact.depth - 0.25f) < 1e-3f);
+    testAssert(contact.normal.fuzzyEq(Vector3::unitY()));
+    world->set(c3, Capsule(Point3(15, 1.75f, 0.3f), Point3(25, 1.75f, -0.2f), 0.5f));
+    testAssert(! world->getContact(b0, c3, contact));
+
+    // Boxes, with an AABox
+    const int a0 = world->insert(AABox(Point3(20.5f, -1, -1), Point3(22, 1, 1)));
+    testAssert(world->shapeType(a0) == CollisionWorld::AABOX);
+    testAssert(world->getContact(b0, a0, contact));
+    testAssert(contact.depth > 0.0f);
+    testAssert(contact.normal.x > 0.8f);
+
+    // Removed IDs are reused
+    world->remove(s2);
+    testAssert(world->size() == 8);
+    testAssert(world->insert(AABox(Point3(-0.5f, -0.5f, 0.8f), Point3(0.5f, 0.5f, 2))) == s2);
+    testAssert(world->getContact(s2, s0, contact));
+    testAssert(fuzzyEq(contact.depth, 0.2f));
+    testAssert(contact.normal.fuzzyEq(-Vector3::unitZ()));
+}
+
+}
+
+
+void testCollisionWorld() {
+    printf("CollisionWorld ");
+
+    testKnownContacts();
+
+    Random rnd(1337, false);
+    const float worldSize = 30.0f;
+    const shared_ptr<CollisionWorld>& world = CollisionWorld::create();
+    Array<Body> bodyArray;
+    makeBodies(600, worldSize, false, rnd, world, bodyArray);
+
+    Array<int> idArray;
+    for (int i = 0; i < bodyArray.size(); ++i) {
+        idArray.append(bodyArray[i].proxy);
+    }
+
+    for (int frame = 0; frame < 20; ++frame) {
+        checkPairs(world, idArray);
+        step(world, bodyArray, worldSize, 0.5f);
+
+        if (frame == 5) {
+            // Remove a third of the bodies, then add some back
+            for (int i = bodyArray.size() - 1; i >= 0; i -= 3) {
+                world->remove(bodyArray[i].proxy);
+                bodyArray.remove(i);
+            }
+            Array<Body> added;
+            makeBodies(50, worldSize, false, rnd, world, added);
+            bodyArray.append(added);
+
+            idArray.fastClear();
+            for (int i = 0; i < bodyArray.size(); ++i) {
+                idArray.append(bodyArray[i].proxy);
+            }
+            testAssert(world->size() == idArray.size());
+        }
+    }
+
+    printf("passed\n");
+}
+
+
+void perfCollisionWorld() {
+    printf("CollisionWorld, moving spheres, boxes, capsules, and AABoxes on %d threads:\n", ThreadPool::numThreads());
+
+    const int sizes[] = {10000, 100000};
+    for (int s = 0; s < 2; ++s) {
+        const int n = sizes[s];
+
+        // About 30 cubic units per body, so that each overlaps a few others
+        const float worldSize = pow(30.0f * n, 1.0f / 3.0f);
+        Random rnd(1000 + s, false);
+        const shared_ptr<CollisionWorld>& world = CollisionWorld::create();
+        Array<Body> bodyArray;
+        makeBodies(n, worldSize, false, rnd, world, bodyArray);
+
+        Array<CollisionWorld::Pair> pairArray;
+        Array<CollisionWorld::Contact> contactArray;
+
+        // Builds the tree
+        world->getOverlappingPairs(pairArray);
+
+        const int numFrames = 10;
+        RealTime setTime = 0, broadTime = 0, narrowTime = 0;
+        Stopwatch sw;
+        for (int frame = 0; frame < numFrames; ++frame) {
+            sw.tick();
+            step(world, bodyArray, worldSize, 1.0f / 30.0f);
+            sw.tock();
+            setTime += sw.elapsedTime();
+
+            sw.tick();
+            world->getOverlappingPairs(pairArray);
+            sw.tock();
+            broadTime += sw.elapsedTime();
+
+            sw.tick();
+            world->getContacts(pairArray, contactArray);
+            sw.tock();
+            narrowTime += sw.elapsedTime();
+        }
+
+        printf("  %6d bodies: move %6.2f ms  broadphase %7.2f ms  narrowphase %6.2f ms  (%d pairs, %d contacts per frame)\n",
+               n, setTime / numFrames / units::milliseconds(), broadTime / numFrames / units::milliseconds(),
+               narrowTime / numFrames / units::milliseconds(), pairArray.size(), contactArray.size());
+
+        if (n <= 10000) {
+            Array<int> idArray;
+            for (int i = 0; i < bodyArray.size(); ++i) {
+                idArray.append(bodyArray[i].proxy);
+            }
+            Array<CollisionWorld::Pair> expected;
+            sw.tick();
+            bruteForcePairs(world, idArray, expected);
+            sw.tock();
+            printf("  %6d bodies: O(n^2) bounds tests %7.2f ms\n", n, sw.elapsedTime() / units::milliseconds());
+        }
+    }
+    printf("\n");
+}
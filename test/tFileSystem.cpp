@@ -1,6 +1,58 @@
 #include "G3D/G3DAll.h"
 #include "testassert.h"
 
+static void testZipfileCache() {
+    const String& expected = readWholeFile("apiTest.zip/Test.txt");
+    testAssert(expected.size() == 69);
+
+    {
+        BinaryInput b("apiTest.zip/zipTest/Folder/TestCompare.txt", G3D_LITTLE_ENDIAN);
+        testAssert(b.getLength() == 69);
+        testAssert(memcmp(b.getCArray(), expected.c_str(), 69) == 0);
+    }
+
+    // Case-insensitive lookup, and the buffer is NULL terminated
+    int64 length = 0;
+    uint8* data = FileSystem::readZipfileEntry("apiTest.zip", "TEST.txt", length);
+    testAssert(length == 69);
+    testAssert(String((const char*)data) == expected);
+    System::alignedFree(data);
+    testAssert(FileSystem::zipfileEntrySize("apiTest.zip", "zipTest/Folder/TestCompare.txt") == 69);
+    testAssert(FileSystem::zipfileEntrySize("apiTest.zip", "no.txt") == -1);
+
+    bool threw = false;
+    try {
+        FileSystem::readZipfileEntry("apiTest.zip", "no.txt", length);
+    } catch (const String&) {
+        threw = true;
+    }
+    testAssert(threw);
+
+    // Many reads at once
+    Array<String> pathArray;
+    for (int i = 0; i < 100; ++i) {
+        pathArray.append((i % 2 == 0) ? "apiTest.zip/Test.txt" : "apiTest.zip/zipTest/Folder/TestCompare.txt");
+    }
+    pathArray.append("apiTest.zip/no.txt");
+    Array<uint8*> dataArray;
+    Array<int64> lengthArray;
+    FileSystem::readZipfileEntries(pathArray, dataArray, lengthArray);
+    for (int i = 0; i < pathArray.size() - 1; ++i) {
+        testAssert(lengthArray[i] == 69);
+        testAssert(memcmp(dataArray[i], expected.c_str(), 69) == 0);
+        System::alignedFree(dataArray[i]);
+    }
+    testAssert(isNull(dataArray.last()) && (lengthArray.last() == -1));
+
+    // Removing a zipfile closes its cached handle
+    FileSystem::copyFile("apiTest.zip", "zipcache-test.zip");
+    testAssert(FileSystem::zipfileEntrySize("zipcache-test.zip", "Test.txt") == 69);
+    FileSystem::removeFile("zipcache-test.zip");
+    testAssert(! FileSystem::exists("zipcache-test.zip"));
+    testAssert(FileSystem::zipfileEntrySize("zipcache-test.zip", "Test.txt") == -1);
+}
+
+
 void testFileSystem() {
     printf("FileSystem...");
 
@@ -45,6 +97,9 @@ void testFileSystem() {
     testAssert(! FileSystem::exists("apiTest.zip/no.txt"));
 
     testAssert(FileSystem::size("apiTest.zip") == 488);
+    testAssert(FileSystem::size("apiTest.zip/Test.txt") == 69);
+
+    testZipfileCache();
 
     printf("passed\n");
 }
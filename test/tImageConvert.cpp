@@ -59,6 +59,209 @@ static void printBoard(const Color4* b, int S) {
 #define RECAST reinterpret_cast<void*>
 
 
+namespace {
+
+/** Deterministic pseudo-random bytes */
+void fillBytes(Array<uint8>& a, int n, uint32 seed) {
+    a.resize(n);
+    for (int i = 0; i < n; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        a[i] = uint8(seed >> 24);
+    }
+}
+
+
+/** Floats on [0, 1] in steps of 1/510, which includes every value that
+    rounds to a tie, plus out-of-range values that must clamp */
+void fillFloats(Array<float>& a, int n, uint32 seed) {
+    a.resize(n);
+    for (int i = 0; i < n; ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        switch (i % 16) {
+        case 0:  a[i] = -0.25f; break;
+        case 1:  a[i] = 1.75f;  break;
+        default: a[i] = float((seed >> 8) % 511) / 510.0f;
+        }
+    }
+}
+
+
+class ByteCase {
+public:
+    const ImageFormat*  src;
+    const ImageFormat*  dst;
+    bool                swapRB;
+};
+
+
+/** Scalar reference for the 8-bit channel reordering converters */
+void referenceBytes(const ByteCase& c, const uint8* src, uint8* dst, int numPixels) {
+    const int sc = c.src->numComponents;
+    const int dc = c.dst->numComponents;
+    for (int i = 0; i < numPixels; ++i) {
+        for (int k = 0; k < 3; ++k) {
+            dst[dc * i + k] = src[sc * i + (c.swapRB ? 2 - k : k)];
+        }
+        if (dc == 4) {
+            dst[dc * i + 3] = 0xFF;
+        }
+    }
+}
+
+
+/** Scalar reference for the 8-bit to RGBA32F converters */
+void referenceToFloat(const ByteCase& c, const uint8* src, int w, int h, int srcRowPadBytes, bool invertY, Color4* dst) {
+    const int sc = c.src->numComponents;
+    for (int y = 0; y < h; ++y) {
+        const uint8* row = src + y * (sc * w + srcRowPadBytes);
+        for (int x = 0; x < w; ++x) {
+            const uint8* s = row + sc * x;
+            Color4 color(unorm8::fromBits(s[0]), unorm8::fromBits(s[1]), unorm8::fromBits(s[2]), (sc == 4) ? float(unorm8::fromBits(s[3])) : 1.0f);
+            if (c.swapRB) {
+                std::swap(color.r, color.b);
+            }
+            dst[(invertY ? (h - 1 - y) : y) * w + x] = color;
+        }
+    }
+}
+
+
+/** Scalar reference for the RGBA32F to 8-bit converters */
+void referenceFromFloat(const ByteCase& c, const Color4* src, int w, int h, int dstRowPadBytes, bool invertY, uint8* dst) {
+    const int dc = c.dst->numComponents;
+    for (int y = 0; y < h; ++y) {
+        uint8* row = dst + y * (dc * w + dstRowPadBytes);
+        for (int x = 0; x < w; ++x) {
+            const Color4& s = src[(invertY ? (h - 1 - y) : y) * w + x];
+            uint8* d = row + dc * x;
+            d[0] = unorm8(c.swapRB ? s.b : s.r).bits();
+            d[1] = unorm8(s.g).bits();
+            d[2] = unorm8(c.swapRB ? s.r : s.b).bits();
+            if (dc == 4) {
+                d[3] = unorm8(s.a).bits();
+            }
+        }
+    }
+}
+
+
+/** Scalar reference for RGB8 to YUV420P */
+void referenceYUV420(const uint8* src, int w, int h, uint8* dstY, uint8* dstU, uint8* dstV) {
+    for (int i = 0; i < w * h; ++i) {
+        const uint8* s = src + 3 * i;
+        dstY[i] = uint8(iClamp(((66 * s[0] + 129 * s[1] + 25 * s[2] + 128) >> 8) + 16, 0, 255));
+    }
+    for (int y = 0; y < h; y += 2) {
+        for (int x = 0; x < w; x += 2) {
+            // Chroma of the average of the left column of the block
+            const uint8* a = src + 3 * (y * w + x);
+            const uint8* b = a + 3 * w;
+            const int r = (a[0] + b[0]) >> 1, g = (a[1] + b[1]) >> 1, bl = (a[2] + b[2]) >> 1;
+            const int i = (y / 2) * (w / 2) + x / 2;
+            dstU[i] = uint8(iClamp(((-38 * r - 74 * g + 112 * bl + 128) >> 8) + 128, 0, 255));
+            dstV[i] = uint8(iClamp(((112 * r - 94 * g - 18 * bl + 128) >> 8) + 128, 0, 255));
+        }
+    }
+}
+
+
+const ByteCase byteCase[] = {
+    {ImageFormat::RGB8(),  ImageFormat::RGBA8(), false},
+    {ImageFormat::RGB8(),  ImageFormat::BGR8(),  true},
+    {ImageFormat::BGR8(),  ImageFormat::RGB8(),  true},
+    {ImageFormat::BGR8(),  ImageFormat::RGBA8(), true},
+    {ImageFormat::RGBA8(), ImageFormat::RGB8(),  false},
+    {ImageFormat::RGBA8(), ImageFormat::BGR8(),  true}};
+
+const ByteCase floatCase[] = {
+    {ImageFormat::RGB8(),  ImageFormat::RGB8(),  false},
+    {ImageFormat::BGR8(),  ImageFormat::BGR8(),  true},
+    {ImageFormat::RGBA8(), ImageFormat::RGBA8(), false}};
+
+const int numByteCases  = sizeof(byteCase) / sizeof(byteCase[0]);
+const int numFloatCases = sizeof(floatCase) / sizeof(floatCase[0]);
+
+bool convert(const void* src, int w, int h, const ImageFormat* srcFormat, int srcRowPadBytes, void* dst, const ImageFormat* dstFormat, int dstRowPadBytes, bool invertY) {
+    Array<const void*> input;
+    Array<void*> output;
+    input.append(src);
+    output.append(dst);
+    return ImageFormat::convert(input, w, h, srcFormat, srcRowPadBytes * 8, output, dstFormat, dstRowPadBytes * 8, invertY);
+}
+
+}
+
+
+/** The SIMD and row-parallel converters must match the scalar references
+    bit for bit, including at the image sizes where only the scalar tail
+    runs and at the sizes where rows are split across threads. */
+static void testConvertKernels() {
+    const int size[][2] = {{1, 1}, {2, 2}, {7, 3}, {37, 23}, {302, 200}};
+    for (int s = 0; s < int(sizeof(size) / sizeof(size[0])); ++s) {
+        const int w = size[s][0], h = size[s][1], N = w * h;
+
+        Array<uint8> src, expected, actual;
+        for (int c = 0; c < numByteCases; ++c) {
+            const ByteCase& bc = byteCase[c];
+            fillBytes(src, N * bc.src->numComponents, 17 + c);
+            expected.resize(N * bc.dst->numComponents);
+            actual.resize(expected.size());
+            referenceBytes(bc, src.getCArray(), expected.getCArray(), N);
+            testAssert(convert(src.getCArray(), w, h, bc.src, 0, actual.getCArray(), bc.dst, 0, false));
+            testAssert(memcmp(expected.getCArray(), actual.getCArray(), expected.size()) == 0);
+        }
+
+        for (int c = 0; c < numFloatCases; ++c) {
+            const ByteCase& fc = floatCase[c];
+            for (int pad = 0; pad <= 4; pad += 4) {
+                for (int invert = 0; invert < 2; ++invert) {
+                    // unorm8 -> float, with source row padding
+                    fillBytes(src, (fc.src->numComponents * w + pad) * h, 31 + c);
+                    Array<Color4> expectedColor, actualColor;
+                    expectedColor.resize(N);
+                    actualColor.resize(N);
+                    referenceToFloat(fc, src.getCArray(), w, h, pad, invert != 0, expectedColor.getCArray());
+                    testAssert(convert(src.getCArray(), w, h, fc.src, pad, actualColor.getCArray(), ImageFormat::RGBA32F(), 0, invert != 0));
+                    testAssert(memcmp(expectedColor.getCArray(), actualColor.getCArray(), N * sizeof(Color4)) == 0);
+
+                    // float -> unorm8, with destination row padding
+                    Array<float> floats;
+                    fillFloats(floats, 4 * N, 43 + c);
+                    const Color4* color = reinterpret_cast<const Color4*>(floats.getCArray());
+                    expected.resize((fc.dst->numComponents * w + pad) * h);
+                    actual.resize(expected.size());
+                    expected.setAll(0);
+                    actual.setAll(0);
+                    referenceFromFloat(fc, color, w, h, pad, invert != 0, expected.getCArray());
+                    testAssert(convert(color, w, h, ImageFormat::RGBA32F(), 0, actual.getCArray(), fc.dst, pad, invert != 0));
+                    for (int y = 0; y < h; ++y) {
+                        // Padding bytes are unspecified
+                        const int rowBytes = fc.dst->numComponents * w;
+                        const int offset = y * (rowBytes + pad);
+                        testAssert(memcmp(expected.getCArray() + offset, actual.getCArray() + offset, rowBytes) == 0);
+                    }
+                }
+            }
+        }
+
+        if (isEven(w) && isEven(h)) {
+            fillBytes(src, 3 * N, 59);
+            Array<uint8> expectedYUV, actualYUV;
+            expectedYUV.resize(N + N / 2);
+            actualYUV.resize(N + N / 2);
+            referenceYUV420(src.getCArray(), w, h, expectedYUV.getCArray(), expectedYUV.getCArray() + N, expectedYUV.getCArray() + N + N / 4);
+
+            Array<const void*> input;
+            Array<void*> output;
+            input.append(src.getCArray());
+            output.append(actualYUV.getCArray(), actualYUV.getCArray() + N, actualYUV.getCArray() + N + N / 4);
+            testAssert(ImageFormat::convert(input, w, h, ImageFormat::RGB8(), 0, output, ImageFormat::YUV420_PLANAR(), 0, false));
+            testAssert(memcmp(expectedYUV.getCArray(), actualYUV.getCArray(), expectedYUV.size()) == 0);
+        }
+    }
+}
+
+
 
 void testImageConvert() {
 
@@ -154,11 +357,72 @@ void testImageConvert() {
 
 
 
+    testConvertKernels();
+
     printf("passed\n");
 }
 
 
-void perfTest() {
-    printf("ImageFormat::convert performance test is not implemented.");
+void perfImageConvert() {
+    const int w = 1920, h = 1080, N = w * h;
+    printf("ImageFormat::convert (%dx%d, %d ThreadPool threads, %s):\n", w, h, ThreadPool::numThreads(),
+           (System::hasSSSE3() && System::hasSSE4_1()) ? "SSE4.1" : "scalar kernels");
+    printf("                       scalar reference     convert()\n");
+
+    Array<uint8> src, dst;
+    fillBytes(src, 4 * N, 7);
+    dst.resize(4 * N * int(sizeof(float)));
+
+    Array<float> floats;
+    fillFloats(floats, 4 * N, 11);
+    const Color4* color = reinterpret_cast<const Color4*>(floats.getCArray());
+
+    Stopwatch sw;
+    const int trials = 5;
+    // Prints the best of several trials, in megapixels per second
+    const auto report = [&](const String& name, const std::function<void ()>& reference, const std::function<void ()>& converted) {
+        RealTime referenceTime = finf(), convertTime = finf();
+        for (int t = 0; t < trials; ++t) {
+            sw.tick(); reference(); sw.tock();
+            referenceTime = min(referenceTime, sw.elapsedTime());
+            sw.tick(); converted(); sw.tock();
+            convertTime = min(convertTime, sw.elapsedTime());
+        }
+        printf("  %-18s %9.0f MPix/s %9.0f MPix/s  (%.1fx)\n", name.c_str(), N / referenceTime / 1e6, N / convertTime / 1e6, referenceTime / convertTime);
+    };
+
+    for (int c = 0; c < numByteCases; ++c) {
+        const ByteCase& bc = byteCase[c];
+        report(bc.src->name() + "->" + bc.dst->name(),
+               [&]() { referenceBytes(bc, src.getCArray(), dst.getCArray(), N); },
+               [&]() { convert(src.getCArray(), w, h, bc.src, 0, dst.getCArray(), bc.dst, 0, false); });
+    }
 
+    for (int c = 0; c < numFloatCases; ++c) {
+        const ByteCase& fc = floatCase[c];
+        Color4* d = reinterpret_cast<Color4*>(dst.getCArray());
+        report(fc.src->name() + "->RGBA32F",
+               [&]() { referenceToFloat(fc, src.getCArray(), w, h, 0, false, d); },
+               [&]() { convert(src.getCArray(), w, h, fc.src, 0, d, ImageFormat::RGBA32F(), 0, false); });
+    }
+
+    for (int c = 0; c < numFloatCases; ++c) {
+        const ByteCase& fc = floatCase[c];
+        report("RGBA32F->" + fc.dst->name(),
+               [&]() { referenceFromFloat(fc, color, w, h, 0, false, dst.getCArray()); },
+               [&]() { convert(color, w, h, ImageFormat::RGBA32F(), 0, dst.getCArray(), fc.dst, 0, false); });
+    }
+
+    {
+        uint8* d = dst.getCArray();
+        Array<const void*> input;
+        Array<void*> output;
+        input.append(src.getCArray());
+        output.append(d, d + N, d + N + N / 4);
+        report("RGB8->YUV420P",
+               [&]() { referenceYUV420(src.getCArray(), w, h, d, d + N, d + N + N / 4); },
+               [&]() { ImageFormat::convert(input, w, h, ImageFormat::RGB8(), 0, output, ImageFormat::YUV420_PLANAR(), 0, false); });
+    }
+
+    printf("\n");
 }
@@ -0,0 +1,173 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+#include <atomic>
+#include <thread>
+
+namespace {
+
+/** Writes \a n distinct RGB8 PNG files and returns their names */
+void writeImages(int n, int size, Array<String>& filenameArray) {
+    for (int i = 0; i < n; ++i) {
+        const shared_ptr<Image>& im = Image::create(size, size, ImageFormat::RGB8());
+        for (int y = 0; y < size; ++y) {
+            for (int x = 0; x < size; ++x) {
+                im->set(x, y, Color3unorm8(unorm8::fromBits(uint8(x * 7 + i)), unorm8::fromBits(uint8(y * 3)), unorm8::fromBits(uint8((x ^ y) + i))));
+            }
+        }
+        filenameArray.append(format("imageloader-%d.png", i));
+        im->save(filenameArray.last());
+    }
+}
+
+
+void removeImages(const Array<String>& filenameArray) {
+    for (int i = 0; i < filenameArray.size(); ++i) {
+        FileSystem::removeFile(filenameArray[i]);
+    }
+}
+
+}
+
+
+static void testLoad() {
+    Array<String> filenameArray;
+    writeImages(6, 64, filenameArray);
+
+    Array<ImageLoader::Future> futureArray;
+    for (int i = 0; i < filenameArray.size(); ++i) {
+        futureArray.append(ImageLoader::load(filenameArray[i]));
+    }
+
+    for (int i = 0; i < filenameArray.size(); ++i) {
+        const shared_ptr<Image>& expected = Image::fromFile(filenameArray[i]);
+        const shared_ptr<Image>& actual = ImageLoader::wait(futureArray[i]);
+        testAssert(actual->format() == expected->format());
+        testAssert((actual->width() == 64) && (actual->height() == 64));
+        for (int y = 0; y < 64; y += 5) {
+            for (int x = 0; x < 64; x += 3) {
+                testAssert(actual->get<Color3unorm8>(x, y) == expected->get<Color3unorm8>(x, y));
+            }
+        }
+    }
+
+    // Errors are rethrown by the waiting thread
+    const ImageLoader::Future& missing = ImageLoader::load("imageloader-does-not-exist.png");
+    bool threw = false;
+    try {
+        ImageLoader::wait(missing);
+    } catch (...) {
+        threw = true;
+    }
+    testAssert(threw);
+
+    removeImages(filenameArray);
+}
+
+
+static void testPriority() {
+    // A single worker, held busy while the queue fills
+    ImageLoader::setMaxThreads(1);
+
+    std::atomic<bool> started(false);
+    std::atomic<bool> release(false);
+    ImageLoader::enqueue([&]() {
+        started = true;
+        while (! release) {
+            std::this_thread::yield();
+        }
+    });
+    while (! started) {
+        std::this_thread::yield();
+    }
+
+    GMutex mutex;
+    Array<int> order;
+    std::atomic<int> numDone(0);
+    const int priority[] = {0, 5, 1, 5, -3};
+    for (int i = 0; i < 5; ++i) {
+        ImageLoader::enqueue([&, i]() {
+            mutex.lock();
+            order.append(i);
+            mutex.unlock();
+            ++numDone;
+        }, priority[i]);
+    }
+    testAssert(ImageLoader::numPending() == 5);
+
+    release = true;
+    while (numDone < 5) {
+        System::sleep(0.001);
+    }
+
+    // Highest priority first, in submission order within a priority
+    testAssert(order.size() == 5);
+    testAssert((order[0] == 1) && (order[1] == 3) && (order[2] == 2) && (order[3] == 0) && (order[4] == 4));
+
+    ImageLoader::setMaxThreads(-1);
+    testAssert(ImageLoader::maxThreads() >= 2);
+}
+
+
+static void testNestedWait() {
+    // Jobs that wait on other jobs do not deadlock, even when every worker is waiting
+    ImageLoader::setMaxThreads(1);
+
+    Array<String> filenameArray;
+    writeImages(2, 16, filenameArray);
+
+    const shared_ptr<std::promise<int> > promise(new std::promise<int>());
+    const std::shared_future<int> outer(promise->get_future());
+    ImageLoader::enqueue([promise, filenameArray]() {
+        const ImageLoader::Future& a = ImageLoader::load(filenameArray[0]);
+        const ImageLoader::Future& b = ImageLoader::load(filenameArray[1]);
+        promise->set_value(ImageLoader::wait(a)->width() + ImageLoader::wait(b)->width());
+    });
+    testAssert(ImageLoader::wait(outer) == 32);
+
+    ImageLoader::setMaxThreads(-1);
+    removeImages(filenameArray);
+}
+
+
+void testImageLoader() {
+    printf("ImageLoader ");
+    testLoad();
+    testPriority();
+    testNestedWait();
+    printf("passed\n");
+}
+
+
+void perfImageLoader() {
+    printf("ImageLoader (24 512x512 PNG files):\n");
+
+    Array<String> filenameArray;
+    writeImages(24, 512, filenameArray);
+
+    Stopwatch sw;
+
+    sw.tick();
+    for (int i = 0; i < filenameArray.size(); ++i) {
+        Image::fromFile(filenameArray[i]);
+    }
+    sw.tock();
+    const RealTime serialTime = sw.elapsedTime();
+
+    sw.tick();
+    {
+        Array<ImageLoader::Future> futureArray;
+        for (int i = 0; i < filenameArray.size(); ++i) {
+            futureArray.append(ImageLoader::load(filenameArray[i]));
+        }
+        for (int i = 0; i < futureArray.size(); ++i) {
+            ImageLoader::wait(futureArray[i]);
+        }
+    }
+    sw.tock();
+    const RealTime pooledTime = sw.elapsedTime();
+
+    removeImages(filenameArray);
+
+    printf("  Serial Image::fromFile:  %7.1f ms\n", serialTime / units::milliseconds());
+    printf("  ImageLoader (%2d max):    %7.1f ms\n\n", ImageLoader::maxThreads(), pooledTime / units::milliseconds());
+}
@@ -0,0 +1,118 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+/** Lines of \a filename that begin with \a prefix */
+int countLines(const String& filename, const String& prefix, Array<String>& lines) {
+    lines.fastClear();
+    const Array<String>& all = stringSplit(readWholeFile(filename), '\n');
+    for (int i = 0; i < all.size(); ++i) {
+        if (beginsWith(all[i], prefix)) {
+            lines.append(all[i]);
+        }
+    }
+    return lines.size();
+}
+
+}
+
+
+static void testAsynchronous() {
+    const String filename = "Log-async-test.txt";
+    Array<String> lines;
+    {
+        Log log(filename);
+        log.setAsynchronous(true);
+        testAssert(log.asynchronous());
+
+        const int numThreads = 4;
+        const int numMessages = 500;
+        ThreadPool::parallelFor(0, numThreads, [&](int t, int threadID) {
+            for (int i = 0; i < numMessages; ++i) {
+                log.printf("msg %d %d\n", t, i);
+            }
+        }, 1);
+        log.flush();
+        testAssert(log.numDroppedMessages() == 0);
+        testAssert(countLines(filename, "msg ", lines) == numThreads * numMessages);
+
+        // Each thread's messages stay in order
+        Array<int> next;
+        next.resize(numThreads);
+        next.setAll(0);
+        for (int i = 0; i < lines.size(); ++i) {
+            int t = -1, m = -1;
+            testAssert(sscanf(lines[i].c_str(), "msg %d %d", &t, &m) == 2);
+            testAssert(m == next[t]);
+            ++next[t];
+        }
+
+        // Long messages bypass the stack buffer
+        const String longMessage = "long " + String(2000, 'x');
+        log.println(longMessage);
+        log.flush();
+        testAssert(countLines(filename, "long ", lines) == 1);
+        testAssert(lines[0] == longMessage);
+
+        log.setAsynchronous(false);
+        testAssert(! log.asynchronous());
+        log.println("sync");
+        testAssert(countLines(filename, "sync", lines) == 1);
+    }
+    FileSystem::removeFile(filename);
+
+    // A small buffer drops messages rather than blocking or growing
+    {
+        Log log(filename);
+        log.setAsynchronous(true, 256);
+        const int numMessages = 10000;
+        for (int i = 0; i < numMessages; ++i) {
+            log.printf("small %d\n", i);
+        }
+        const int numDropped = log.numDroppedMessages();
+        log.flush();
+        testAssert(countLines(filename, "small ", lines) + numDropped == numMessages);
+    }
+    FileSystem::removeFile(filename);
+}
+
+
+void testLog() {
+    printf("Log ");
+    testAsynchronous();
+    printf("passed\n");
+}
+
+
+void perfLog() {
+    printf("Log:\n");
+    const String filename = "Log-perf.txt";
+    const int numMessages = 20000;
+    const int numThreads = max(4, ThreadPool::numThreads());
+
+    for (int async = 0; async < 2; ++async) {
+        Log log(filename);
+        log.setAsynchronous(async == 1, 1024 * 1024);
+
+        Stopwatch sw;
+        sw.tick();
+        ThreadPool::parallelFor(0, numThreads, [&](int t, int threadID) {
+            for (int i = 0; i < numMessages; ++i) {
+                log.printf("Thread %d processed asset %d of %d\n", t, i, numMessages);
+            }
+        }, 1);
+        sw.tock();
+        const RealTime logTime = sw.elapsedTime();
+
+        sw.tick();
+        log.flush();
+        sw.tock();
+
+        printf("  %-12s %d threads x %d messages: %7.1f ms (%5.0f ns/message), flush %6.2f ms, %d dropped\n",
+               (async == 1) ? "Asynchronous" : "Synchronous", numThreads, numMessages, logTime / units::milliseconds(),
+               logTime * 1e9 / (numThreads * numMessages), sw.elapsedTime() / units::milliseconds(), log.numDroppedMessages());
+    }
+    FileSystem::removeFile(filename);
+    printf("\n");
+}
@@ -0,0 +1,380 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+#include <ctime>
+using G3D::uint8;
+using G3D::uint16;
+using G3D::uint32;
+using G3D::uint64;
+
+namespace {
+
+const uint16 PORT = 10012;
+const uint32 NUM_CHANNELS = 3;
+
+/** Yields until \a pred is true. Returns false on timeout. */
+template<class Predicate>
+bool waitUntil(const Predicate& pred, RealTime timeout = 10.0) {
+    const RealTime stop = System::time() + timeout;
+    while (! pred()) {
+        if (System::time() > stop) {
+            return false;
+        }
+        System::sleep(0);
+    }
+    return true;
+}
+
+
+/** A server and one client connected to it over loopback */
+class Loopback {
+public:
+    shared_ptr<NetServer>       server;
+    shared_ptr<NetConnection>   client;
+    shared_ptr<NetConnection>   serverSide;
+
+    Loopback() {
+        server = NetServer::create(NetAddress(NetAddress::DEFAULT_ADAPTER_HOST, PORT), 32, NUM_CHANNELS);
+        client = NetConnection::connectToServer(NetAddress("localhost", PORT), NUM_CHANNELS);
+
+        testAssertM(waitUntil([&] { return client->status() != NetConnection::WAITING_TO_CONNECT; }), "Connection timed out");
+        testAssertM(waitUntil([&] { return server->newConnectionIterator().isValid(); }), "Server did not accept the connection");
+
+        NetConnectionIterator& it = server->newConnectionIterator();
+        serverSide = it.connection();
+        ++it;
+    }
+
+    ~Loopback() {
+        client->disconnect(false);
+        server->stop();
+    }
+};
+
+
+/** Reads all waiting messages, checking that they carry consecutive sequence numbers
+    starting at \a next. Returns the number read. */
+int receiveSequence(const shared_ptr<NetConnection>& connection, int& next) {
+    int count = 0;
+    for (NetMessageIterator& msg = connection->incomingMessageIterator(); msg.isValid(); ++msg) {
+        BinaryInput& bi = msg.binaryInput();
+        testAssert(msg.type() == 1);
+        testAssert(bi.readInt32() == next);
+        const int n = bi.readInt32();
+        testAssert(n == int(msg.size()) - 8);
+        for (int i = 0; i < n; ++i) {
+            testAssert(bi.readUInt8() == uint8(next + i));
+        }
+        ++next;
+        ++count;
+    }
+    return count;
+}
+
+
+void sendSequence(const shared_ptr<NetSendConnection>& connection, int index) {
+    BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+    const int n = (index * 37) % 2000;
+    bo.writeInt32(index);
+    bo.writeInt32(n);
+    for (int i = 0; i < n; ++i) {
+        bo.writeUInt8(uint8(index + i));
+    }
+    connection->send(1, bo);
+}
+
+
+/** Counts frees so that the test can observe when the network releases zero-copy buffers */
+class CountingMemoryManager : public MemoryManager {
+public:
+    std::atomic<int> numFrees;
+
+    CountingMemoryManager() : numFrees(0) {}
+
+    virtual void* alloc(size_t s) override {
+        return System::malloc(s);
+    }
+
+    virtual void free(void* ptr) override {
+        System::free(ptr);
+        ++numFrees;
+    }
+
+    virtual bool isThreadsafe() const override {
+        return true;
+    }
+};
+
+
+/** Sends a three-part message whose second part is transmitted from application memory */
+void sendParts(const shared_ptr<NetSendConnection>& connection, const shared_ptr<MemoryManager>& manager, int index) {
+    const int32 header[2] = {index, 3};
+
+    Array<int32> first;
+    first.append(index, index + 1);
+
+    const int secondCount = 1000 + index * 50;
+    int32* second = static_cast<int32*>(manager->alloc(secondCount * sizeof(int32)));
+    for (int i = 0; i < secondCount; ++i) {
+        second[i] = index * i;
+    }
+
+    Array<NetBufferView> payload;
+    payload.append(NetBufferView(first.getCArray(), first.size() * sizeof(int32)));
+    payload.append(NetBufferView(second, secondCount * sizeof(int32), manager));
+    // Empty parts are allowed
+    payload.append(NetBufferView());
+
+    connection->send(4, NetBufferView(header, sizeof(header)), payload, 2);
+}
+
+
+/** Checks a message sent by sendParts */
+void checkParts(NetMessageIterator& msg, int index) {
+    testAssert(msg.channel() == 2);
+    testAssert(msg.headerBinaryInput().readInt32() == index);
+    testAssert(msg.headerBinaryInput().readInt32() == 3);
+    testAssert(msg.numParts() == 3);
+
+    const int secondCount = 1000 + index * 50;
+    testAssert(msg.partSize(0) == 2 * sizeof(int32));
+    testAssert(msg.partSize(1) == secondCount * sizeof(int32));
+    testAssert(msg.partSize(2) == 0);
+    testAssert(msg.size() == (2 + secondCount) * sizeof(int32));
+
+    BinaryInput& bi0 = msg.partBinaryInput(0);
+    testAssert(bi0.readInt32() == index);
+    testAssert(bi0.readInt32() == index + 1);
+
+    // Parts are read in place; data() concatenates them
+    const int32* second = static_cast<const int32*>(msg.partData(1));
+    const int32* all = static_cast<const int32*>(msg.data());
+    testAssert(all[0] == index);
+    for (int i = 0; i < secondCount; ++i) {
+        testAssert(second[i] == index * i);
+        testAssert(all[i + 2] == index * i);
+    }
+
+    BinaryInput& bi = msg.binaryInput();
+    testAssert(bi.getLength() == int64(msg.size()));
+    testAssert(bi.readInt32() == index);
+}
+
+}
+
+
+void testNetwork() {
+    printf("NetConnection ");
+    Loopback loopback;
+
+    // Client to server, in order, with counters on both ends
+    const int numMessages = 200;
+    uint64 bytes = 0;
+    for (int i = 0; i < numMessages; ++i) {
+        sendSequence(loopback.client, i);
+        bytes += 8 + (i * 37) % 2000;
+    }
+
+    int next = 0;
+    testAssertM(waitUntil([&] { receiveSequence(loopback.serverSide, next); return next == numMessages; }), "Messages were lost");
+
+    const NetStatistics& clientStats = loopback.client->statistics();
+    testAssert(clientStats.messagesSent == uint64(numMessages));
+    testAssert(clientStats.bytesSent == bytes);
+    testAssert(clientStats.messagesQueued == 0);
+    testAssert(clientStats.maxSendDelay >= clientStats.meanSendDelay);
+
+    const NetStatistics& serverStats = loopback.server->statistics();
+    testAssert(serverStats.messagesReceived == uint64(numMessages));
+    testAssert(serverStats.bytesReceived == bytes);
+
+    // Server to client, both directly and through the omniConnection
+    next = 0;
+    sendSequence(loopback.serverSide, 0);
+    sendSequence(loopback.server->omniConnection(), 1);
+    testAssertM(waitUntil([&] { receiveSequence(loopback.client, next); return next == 2; }), "Replies were lost");
+    testAssert(loopback.server->statistics().messagesSent == 2);
+    testAssert(loopback.client->statistics().messagesReceived == 2);
+
+    // Scatter/gather messages interleaved with ordinary ones on another channel
+    const shared_ptr<CountingMemoryManager> manager(new CountingMemoryManager());
+    const int numPartMessages = 20;
+    for (int i = 0; i < numPartMessages; ++i) {
+        sendParts(loopback.client, manager, i);
+        sendSequence(loopback.client, i);
+    }
+
+    // Each channel is delivered in order, but the two channels may interleave arbitrarily
+    int nextParts = 0;
+    next = 0;
+    testAssertM(waitUntil([&] {
+        for (NetMessageIterator& msg = loopback.serverSide->incomingMessageIterator(); msg.isValid(); ++msg) {
+            if (msg.type() == 4) {
+                checkParts(msg, nextParts);
+                ++nextParts;
+            } else {
+                // Single-part messages are received as they were before multi-part messages existed
+                testAssert(msg.type() == 1);
+                testAssert(msg.numParts() == 1);
+                testAssert(msg.binaryInput().readInt32() == next);
+                ++next;
+            }
+        }
+        return (nextParts == numPartMessages) && (next == numPartMessages);
+    }), "Messages were lost");
+
+    // Zero-copy buffers are released to their manager on the sending application's thread
+    testAssertM(waitUntil([&] {
+        loopback.client->status();
+        return manager->numFrees == numPartMessages;
+    }), "Zero-copy buffers were not freed");
+
+    printf("passed\n");
+}
+
+
+void perfNetwork() {
+    printf("NetConnection loopback:\n");
+    Loopback loopback;
+
+    {
+        // Processor time used by the network thread while nothing is sent
+        const std::clock_t start = std::clock();
+        System::sleep(1.0);
+        const double cpu = double(std::clock() - start) / CLOCKS_PER_SEC;
+        printf("  Idle network thread CPU:  %5.1f%%\n", cpu * 100.0);
+    }
+
+    {
+        const int numRoundTrips = 2000;
+        Stopwatch sw;
+        sw.tick();
+        for (int i = 0; i < numRoundTrips; ++i) {
+            BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+            bo.writeInt32(i);
+            loopback.client->send(2, bo);
+
+            waitUntil([&] {
+                NetMessageIterator& msg = loopback.serverSide->incomingMessageIterator();
+                if (msg.isValid()) {
+                    loopback.serverSide->send(2, msg.data(), msg.size());
+                    ++msg;
+                    return true;
+                }
+                return false;
+            });
+
+            waitUntil([&] {
+                NetMessageIterator& msg = loopback.client->incomingMessageIterator();
+                if (msg.isValid()) {
+                    ++msg;
+                    return true;
+                }
+                return false;
+            });
+        }
+        sw.tock();
+        printf("  Round trip:               %7.3f ms\n", sw.elapsedTime() / numRoundTrips / units::milliseconds());
+    }
+
+    {
+        const int numMessages = 20000;
+        const int messageSize = 1024;
+        Array<uint8> payload;
+        payload.resize(messageSize);
+
+        Stopwatch sw;
+        sw.tick();
+        int received = 0;
+        for (int i = 0; i < numMessages; ++i) {
+            loopback.client->send(3, payload.getCArray(), payload.size());
+            // Drain as we go so that the receive queue does not grow without bound
+            for (NetMessageIterator& msg = loopback.serverSide->incomingMessageIterator(); msg.isValid(); ++msg) {
+                ++received;
+            }
+        }
+        waitUntil([&] {
+            for (NetMessageIterator& msg = loopback.serverSide->incomingMessageIterator(); msg.isValid(); ++msg) {
+                ++received;
+            }
+            return received == numMessages;
+        }, 60.0);
+        sw.tock();
+
+        const NetStatistics& s = loopback.client->statistics();
+        printf("  Throughput, %d B messages: %6.1f MB/s  %8.0f msg/s\n", messageSize,
+               double(numMessages) * messageSize / sw.elapsedTime() / 1e6, numMessages / sw.elapsedTime());
+        printf("  Send queue delay:         %7.3f ms mean, %7.3f ms max\n",
+               s.meanSendDelay / units::milliseconds(), s.maxSendDelay / units::milliseconds());
+    }
+
+    {
+        // Replicating entity state held in parallel arrays, either serialized through
+        // BinaryOutput or sent in place as scatter/gather views
+        const int numEntities = 2048;
+        const int numMessages = 400;
+        const shared_ptr<CountingMemoryManager> manager(new CountingMemoryManager());
+
+        Array<Vector3> position, velocity;
+        Array<Quat> rotation;
+        position.resize(numEntities);
+        velocity.resize(numEntities);
+        rotation.resize(numEntities);
+        const size_t messageSize = numEntities * (2 * sizeof(Vector3) + sizeof(Quat));
+
+        // The first round warms up enet and the allocator and is not reported
+        for (int round = 0; round < 4; ++round) {
+            const int method = round % 2;
+            // The median excludes sends that were preempted by the network thread
+            Array<RealTime> sendTime;
+            int received = 0;
+
+            Stopwatch sw;
+            sw.tick();
+            for (int i = 0; i < numMessages; ++i) {
+                const RealTime start = System::time();
+                if (method == 0) {
+                    BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+                    bo.writeBytes(position.getCArray(), numEntities * sizeof(Vector3));
+                    bo.writeBytes(velocity.getCArray(), numEntities * sizeof(Vector3));
+                    bo.writeBytes(rotation.getCArray(), numEntities * sizeof(Quat));
+                    loopback.client->send(5, bo);
+                } else {
+                    // Snapshot buffers handed off to the network, as a double-buffered simulation would
+                    NetBufferView view[3];
+                    const void* src[3] = {position.getCArray(), velocity.getCArray(), rotation.getCArray()};
+                    const size_t bytes[3] = {numEntities * sizeof(Vector3), numEntities * sizeof(Vector3), numEntities * sizeof(Quat)};
+                    for (int v = 0; v < 3; ++v) {
+                        void* snapshot = manager->alloc(bytes[v]);
+                        System::memcpy(snapshot, src[v], bytes[v]);
+                        view[v] = NetBufferView(snapshot, bytes[v], manager);
+                    }
+                    loopback.client->send(5, NetBufferView(), view, 3);
+                }
+                sendTime.append(System::time() - start);
+
+                for (NetMessageIterator& msg = loopback.serverSide->incomingMessageIterator(); msg.isValid(); ++msg) {
+                    ++received;
+                }
+            }
+
+            waitUntil([&] {
+                for (NetMessageIterator& msg = loopback.serverSide->incomingMessageIterator(); msg.isValid(); ++msg) {
+                    ++received;
+                }
+                return received == numMessages;
+            }, 60.0);
+            sw.tock();
+            loopback.client->status();
+            sendTime.sort();
+
+            if (round < 2) {
+                continue;
+            }
+
+            printf("  %s, %d KB messages: %7.1f us/send (median)  %6.1f MB/s\n", (method == 0) ? "BinaryOutput   " : "NetBufferView[3]",
+                   int(messageSize / 1024), sendTime[sendTime.size() / 2] / units::milliseconds() * 1000.0,
+                   double(numMessages) * messageSize / sw.elapsedTime() / 1e6);
+        }
+    }
+    printf("\n");
+}
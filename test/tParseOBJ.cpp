@@ -0,0 +1,186 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+/** Writes an OBJ file exercising groups, materials, relative indices, comments, and mixed newlines */
+String makeOBJ(int numBlocks, int badLine = -1) {
+    String s;
+    s.reserve(numBlocks * 400);
+    s += "# Generated by tParseOBJ\nmtllib parseobj-test.mtl\n";
+    Random rnd(40, false);
+    int line = 3;
+    for (int b = 0; b < numBlocks; ++b) {
+        if (b % 7 == 0) {
+            s += format("g group%d\n", b % 5);
+            ++line;
+        }
+        if (b % 3 == 0) {
+            s += format("usemtl %s\n", (b % 2 == 0) ? "red" : "blue");
+            ++line;
+        }
+        if (line >= badLine && badLine >= 0) {
+            // Missing group name
+            s += "g \n";
+            badLine = -1;
+            ++line;
+        }
+        for (int v = 0; v < 4; ++v) {
+            s += format("v %g %g %g\r\n", rnd.uniform(-10, 10), rnd.uniform(-10, 10), rnd.uniform(-10, 10));
+            s += format("vt %g %g\n", rnd.uniform(), rnd.uniform());
+            s += format("vn %g %g %g\n", rnd.uniform(-1, 1), rnd.uniform(-1, 1), rnd.uniform(-1, 1));
+            line += 3;
+        }
+        s += "\n# quad and triangles\n";
+        line += 2;
+        switch (b % 3) {
+        case 0:
+            s += "f -4/-4/-4 -3/-3/-3 -2/-2/-2 -1/-1/-1\n";
+            break;
+        case 1:
+            s += format("f %d//%d %d//%d %d//%d\n", 4 * b + 1, 4 * b + 1, 4 * b + 2, 4 * b + 2, 4 * b + 3, 4 * b + 3);
+            break;
+        default:
+            // Refers back to vertices several blocks earlier
+            s += format("f %d -1 -%d\n", 4 * b + 4, 4 * min(b, 50) + 1);
+        }
+        ++line;
+    }
+    return s;
+}
+
+
+void writeMTL() {
+    TextOutput t("parseobj-test.mtl");
+    t.printf("newmtl red\nKd 1 0 0\n\nnewmtl blue\nKd 0 0 1\n");
+    t.commit();
+}
+
+
+void testSameFace(const ParseOBJ::Face& a, const ParseOBJ::Face& b) {
+    testAssert(a.size() == b.size());
+    for (int i = 0; i < a.size(); ++i) {
+        testAssert(a[i].vertex == b[i].vertex);
+        testAssert(a[i].texCoord == b[i].texCoord);
+        testAssert(a[i].normal == b[i].normal);
+    }
+}
+
+
+void testSameOBJ(const ParseOBJ& a, const ParseOBJ& b) {
+    testAssert(a.vertexArray.size() == b.vertexArray.size());
+    for (int i = 0; i < a.vertexArray.size(); ++i) {
+        testAssert(a.vertexArray[i] == b.vertexArray[i]);
+    }
+    testAssert(a.normalArray.size() == b.normalArray.size());
+    for (int i = 0; i < a.normalArray.size(); ++i) {
+        testAssert(a.normalArray[i] == b.normalArray[i]);
+    }
+    testAssert(a.texCoord0Array.size() == b.texCoord0Array.size());
+    for (int i = 0; i < a.texCoord0Array.size(); ++i) {
+        testAssert(a.texCoord0Array[i] == b.texCoord0Array[i]);
+    }
+    testAssert(a.texCoord1Array.size() == b.texCoord1Array.size());
+    testAssert(a.mtlArray.size() == b.mtlArray.size());
+
+    testAssert(a.groupTable.size() == b.groupTable.size());
+    for (ParseOBJ::GroupTable::Iterator it = a.groupTable.begin(); it.isValid(); ++it) {
+        const shared_ptr<ParseOBJ::Group>* g = b.groupTable.getPointer(it->key);
+        testAssert(notNull(g));
+        const ParseOBJ::MeshTable& meshTableA = it->value->meshTable;
+        const ParseOBJ::MeshTable& meshTableB = (*g)->meshTable;
+        testAssert(meshTableA.size() == meshTableB.size());
+
+        // Materials are different objects in each parse, so match meshes by material name
+        for (ParseOBJ::MeshTable::Iterator m = meshTableA.begin(); m.isValid(); ++m) {
+            shared_ptr<ParseOBJ::Mesh> meshB;
+            for (ParseOBJ::MeshTable::Iterator n = meshTableB.begin(); n.isValid(); ++n) {
+                if (n->key->name == m->key->name) {
+                    meshB = n->value;
+                }
+            }
+            testAssert(notNull(meshB));
+            const Array<ParseOBJ::Face>& faceArray = m->value->faceArray;
+            testAssert(faceArray.size() == meshB->faceArray.size());
+            for (int f = 0; f < faceArray.size(); ++f) {
+                testSameFace(faceArray[f], meshB->faceArray[f]);
+            }
+        }
+    }
+}
+
+}
+
+
+static void testChunked() {
+    writeMTL();
+    const String& obj = makeOBJ(12000);
+    testAssert(size_t(obj.size()) > 2 * ParseOBJ::PARALLEL_MIN_LENGTH);
+
+    ParseOBJ sequential;
+    sequential.parse(obj.c_str(), obj.size(), "", ParseOBJ::Options(), 1);
+    ParseOBJ chunked;
+    chunked.parse(obj.c_str(), obj.size(), "", ParseOBJ::Options());
+    testSameOBJ(sequential, chunked);
+    testAssert(sequential.groupTable.size() == 5);
+}
+
+
+static void testChunkedError() {
+    const int badLine = 150000;
+    const String& obj = makeOBJ(12000, badLine);
+    int sequentialLine = -1, chunkedLine = -2;
+
+    try {
+        ParseOBJ sequential;
+        sequential.parse(obj.c_str(), obj.size(), "", ParseOBJ::Options(), 1);
+    } catch (const ParseError& e) {
+        sequentialLine = e.line;
+    }
+    try {
+        ParseOBJ chunked;
+        chunked.parse(obj.c_str(), obj.size(), "", ParseOBJ::Options());
+    } catch (const ParseError& e) {
+        chunkedLine = e.line;
+    }
+    testAssert(sequentialLine >= badLine);
+    testAssert(sequentialLine == chunkedLine);
+}
+
+
+void testParseOBJ() {
+    printf("ParseOBJ ");
+    testChunked();
+    testChunkedError();
+    FileSystem::removeFile("parseobj-test.mtl");
+    printf("passed\n");
+}
+
+
+void perfParseOBJ() {
+    printf("ParseOBJ (in-memory text):\n");
+    writeMTL();
+    const String& obj = makeOBJ(150000);
+    const double megabytes = obj.size() / (1024.0 * 1024.0);
+    Stopwatch sw;
+
+    sw.tick();
+    {
+        ParseOBJ parser;
+        parser.parse(obj.c_str(), obj.size(), "", ParseOBJ::Options(), 1);
+    }
+    sw.tock();
+    const RealTime sequentialTime = sw.elapsedTime();
+
+    sw.tick();
+    {
+        ParseOBJ parser;
+        parser.parse(obj.c_str(), obj.size(), "", ParseOBJ::Options());
+    }
+    sw.tock();
+    const RealTime chunkedTime = sw.elapsedTime();
+    FileSystem::removeFile("parseobj-test.mtl");
+
+    printf("  %5.1f MB sequential:           %7.1f MB/s\n", megabytes, megabytes / sequentialTime);
+    printf("  %5.1f MB chunked on %2d threads: %7.1f MB/s\n\n", megabytes, ThreadPool::numThreads(), megabytes / chunkedTime);
+}
@@ -0,0 +1,147 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+void makeParticles(int n, Random& rnd, Array<ParticleSystem::Particle>& particleArray) {
+    particleArray.resize(n);
+    for (int i = 0; i < n; ++i) {
+        ParticleSystem::Particle& P = particleArray[i];
+        P.position        = Point3(rnd.uniform(-10, 10), rnd.uniform(0, 5), rnd.uniform(-10, 10));
+        P.velocity        = Vector3::random(rnd) * rnd.uniform(0, 3);
+        P.radius          = rnd.uniform(0.01f, 0.2f);
+        // Light enough for drag to matter but not so light that Euler integration is unstable
+        P.mass            = (4.0f / 3.0f) * pif() * P.radius * P.radius * P.radius * rnd.uniform(50.0f, 1000.0f);
+        P.dragCoefficient = rnd.uniform(0.0f, 1.0f);
+        P.angle           = rnd.uniform(0, 2 * pif());
+        P.angularVelocity = rnd.uniform(-1, 1);
+    }
+    // Exactly matching the wind exercises the zero-drag case
+    particleArray[0].velocity = Vector3(1, 0, 0);
+    particleArray[0].dragCoefficient = 0.5f;
+}
+
+
+/** The scalar integrator that ParticleSystem::integrateParticles replaced */
+void integrateScalar(Array<ParticleSystem::Particle>& particleArray, const Vector3& gravitationalAcceleration, const Vector3& windVelocity,
+                     float maxBrownianVelocity, int brownianTemporalOffset, float dt) {
+    for (int i = 0; i < particleArray.size(); ++i) {
+        ParticleSystem::Particle& P = particleArray[i];
+        const float area = pif() * square(P.radius);
+        const Point3int32& fixedPos = Point3int32(P.position * 200.0f);
+        const Vector3 brownianDirection(Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.y + 10208, fixedPos.z + 55010, 2),
+                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.z + 10208, fixedPos.x + 55010, 2),
+                                        Noise::common().sampleFloat(brownianTemporalOffset, fixedPos.x + 10208, fixedPos.y + 55010, 2));
+        const Vector3& localWindVelocity = windVelocity + maxBrownianVelocity * brownianDirection;
+        const Vector3& relativeVelocity = localWindVelocity - P.velocity;
+        const Vector3& dragForce = relativeVelocity.directionOrZero() * (0.5f * 1.185f * relativeVelocity.squaredMagnitude() * P.dragCoefficient * area);
+        const Vector3& acceleration = gravitationalAcceleration + dragForce / P.mass;
+        P.velocity += acceleration * dt;
+        P.position += P.velocity * dt;
+        P.angle += P.angularVelocity * dt;
+    }
+}
+
+}
+
+
+static void testNoiseSIMD() {
+    Random rnd(20, false);
+    Noise& noise = Noise::common();
+    for (int octaves = 1; octaves <= 3; ++octaves) {
+        for (int i = 0; i < 2000; ++i) {
+            int32 x[4], y[4], z[4];
+            float result[4];
+            for (int j = 0; j < 4; ++j) {
+                // Include negative coordinates and values near the lattice boundaries
+                x[j] = rnd.integer(-200000, 200000);
+                y[j] = rnd.integer(-200000, 200000);
+                z[j] = (i & 1) ? (rnd.integer(-4, 4) << 12) : rnd.integer(-200000, 200000);
+            }
+            noise.sampleFloat4(x, y, z, result, octaves);
+            for (int j = 0; j < 4; ++j) {
+                testAssert(result[j] == noise.sampleFloat(x[j], y[j], z[j], octaves));
+            }
+        }
+    }
+}
+
+
+static void testIntegrate() {
+    Random rnd(21, false);
+    Array<ParticleSystem::Particle> simd, scalar;
+    // Not a multiple of four, and large enough to be split across threads
+    makeParticles(10003, rnd, simd);
+    scalar = simd;
+
+    const Vector3 gravity(0, -9.8f, 0);
+    const Vector3 wind(1, 0, 0);
+    for (int step = 0; step < 10; ++step) {
+        const int offset = step * 7 - 1000;
+        ThreadPool::parallelForRange(0, simd.size(), [&](int begin, int end, int threadID) {
+            ParticleSystem::integrateParticles(simd.getCArray() + begin, end - begin, gravity, wind, 0.35f, offset, 1.0f / 60.0f);
+        }, 1024);
+        integrateScalar(scalar, gravity, wind, 0.35f, offset, 1.0f / 60.0f);
+    }
+
+    for (int i = 0; i < simd.size(); ++i) {
+        // Rounding differs slightly between the two, which can move a
+        // particle to an adjacent noise sample
+        testAssertM((simd[i].position - scalar[i].position).length() < 1e-3f, format("Particle %d", i));
+        testAssertM((simd[i].velocity - scalar[i].velocity).length() < 0.05f, format("Particle %d", i));
+        testAssert(fuzzyEq(simd[i].angle, scalar[i].angle));
+    }
+}
+
+
+void testParticleSystem() {
+    printf("ParticleSystem ");
+    testNoiseSIMD();
+    testIntegrate();
+    printf("passed\n");
+}
+
+
+void perfParticleSystem() {
+    printf("ParticleSystem physics (100k particles, 2 noise octaves):\n");
+
+    Random rnd(22, false);
+    Array<ParticleSystem::Particle> original;
+    makeParticles(100000, rnd, original);
+    Array<ParticleSystem::Particle> particleArray(original);
+
+    const Vector3 gravity(0, -9.8f, 0);
+    const Vector3 wind(1, 0, 0);
+    const float dt = 1.0f / 60.0f;
+    const int numSteps = 10;
+    Stopwatch sw;
+
+    sw.tick();
+    for (int step = 0; step < numSteps; ++step) {
+        integrateScalar(particleArray, gravity, wind, 0.35f, step, dt);
+    }
+    sw.tock();
+    const RealTime scalarTime = sw.elapsedTime() / numSteps;
+
+    particleArray = original;
+    sw.tick();
+    for (int step = 0; step < numSteps; ++step) {
+        ParticleSystem::integrateParticles(particleArray.getCArray(), particleArray.size(), gravity, wind, 0.35f, step, dt);
+    }
+    sw.tock();
+    const RealTime simdTime = sw.elapsedTime() / numSteps;
+
+    particleArray = original;
+    sw.tick();
+    for (int step = 0; step < numSteps; ++step) {
+        ThreadPool::parallelForRange(0, particleArray.size(), [&](int begin, int end, int threadID) {
+            ParticleSystem::integrateParticles(particleArray.getCArray() + begin, end - begin, gravity, wind, 0.35f, step, dt);
+        }, 2048);
+    }
+    sw.tock();
+    const RealTime parallelTime = sw.elapsedTime() / numSteps;
+
+    printf("  Scalar:                %7.2f ms\n", scalarTime / units::milliseconds());
+    printf("  SSE:                   %7.2f ms\n", simdTime / units::milliseconds());
+    printf("  SSE on %2d threads:     %7.2f ms\n\n", ThreadPool::numThreads(), parallelTime / units::milliseconds());
+}
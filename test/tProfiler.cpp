@@ -0,0 +1,239 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+/** Returns the tree and index of the first event named \a name from the previous frame, or -1 */
+int findEvent(const String& name, const Array<Profiler::Event>*& tree) {
+    Array<const Array<Profiler::Event>*> eventTreeArray;
+    Profiler::getEvents(eventTreeArray);
+    for (int t = 0; t < eventTreeArray.size(); ++t) {
+        for (int e = 0; e < eventTreeArray[t]->size(); ++e) {
+            if ((*eventTreeArray[t])[e].name() == name) {
+                tree = eventTreeArray[t];
+                return e;
+            }
+        }
+    }
+    tree = NULL;
+    return -1;
+}
+
+
+int countEvents(const String& name) {
+    Array<const Array<Profiler::Event>*> eventTreeArray;
+    Profiler::getEvents(eventTreeArray);
+    int count = 0;
+    for (int t = 0; t < eventTreeArray.size(); ++t) {
+        for (int e = 0; e < eventTreeArray[t]->size(); ++e) {
+            if ((*eventTreeArray[t])[e].name() == name) {
+                ++count;
+            }
+        }
+    }
+    return count;
+}
+
+
+void overflowThreadMain(void*) {
+    for (int i = 0; i < 100; ++i) {
+        BEGIN_PROFILER_EVENT("Overflow");
+        BEGIN_PROFILER_EVENT("OverflowChild");
+        END_PROFILER_EVENT();
+        END_PROFILER_EVENT();
+    }
+}
+
+}
+
+
+static void testNesting() {
+    BEGIN_PROFILER_EVENT("Outer");
+    {
+        BEGIN_PROFILER_EVENT("Inner");
+        END_PROFILER_EVENT();
+        BEGIN_PROFILER_EVENT_WITH_HINT("Hinted", "some hint");
+        END_PROFILER_EVENT();
+    }
+    END_PROFILER_EVENT();
+    Profiler::nextFrame();
+
+    const Array<Profiler::Event>* tree = NULL;
+    const int outer = findEvent("Outer", tree);
+    testAssert(outer >= 0);
+    const Array<Profiler::Event>& events = *tree;
+
+    // Outer, "other", Inner, Hinted in depth-first order
+    testAssert(outer + 3 < events.size());
+    testAssert(events[outer].level() == 0);
+    testAssert(events[outer].numChildren() == 3);
+    testAssert(events[outer + 1].name() == "other");
+    testAssert(events[outer + 2].name() == "Inner");
+    testAssert(events[outer + 2].parentIndex() == outer);
+    testAssert(events[outer + 2].level() == 1);
+    testAssert(events[outer + 3].name() == "Hinted");
+    testAssert(events[outer + 3].hint() == "some hint");
+    testAssert(events[outer + 3].hash() != events[outer + 2].hash());
+    testAssert(events[outer].cpuDuration() >= events[outer + 2].cpuDuration() + events[outer + 3].cpuDuration());
+    testAssert(events[outer + 2].startTime() >= events[outer].startTime());
+
+    // Call sites are interned once
+    testAssert(Profiler::internEvent("Inner", "x.cpp", 3) == Profiler::internEvent("Inner", "x.cpp", 3));
+    testAssert(Profiler::internEvent("Inner", "x.cpp", 3) != Profiler::internEvent("Inner", "x.cpp", 4));
+
+    // The String interface produces the same events
+    Profiler::beginEvent("Dynamic", __FILE__, __LINE__, 0, "");
+    Profiler::endEvent();
+    Profiler::beginEvent("Dynamic", __FILE__, __LINE__, 0, "");
+    Profiler::endEvent();
+    Profiler::nextFrame();
+    testAssert(countEvents("Dynamic") == 2);
+}
+
+
+static void testOpenAcrossFrames() {
+    BEGIN_PROFILER_EVENT("Spanning");
+    Profiler::nextFrame();
+    testAssert(countEvents("Spanning") == 0);
+
+    END_PROFILER_EVENT();
+    Profiler::nextFrame();
+    testAssert(countEvents("Spanning") == 1);
+
+    Profiler::nextFrame();
+    testAssert(countEvents("Spanning") == 0);
+}
+
+
+static void testThreads() {
+    const int n = 1000;
+    ThreadPool::parallelFor(0, n, [](int i, int threadID) {
+        BEGIN_PROFILER_EVENT("Parallel");
+        END_PROFILER_EVENT();
+    });
+    Profiler::nextFrame();
+    testAssert(countEvents("Parallel") == n);
+    testAssert(Profiler::numDroppedEvents() == 0);
+
+    // A small ring drops events but keeps the rest consistent
+    Profiler::setEventBufferSize(16);
+    GThreadRef thread = GThread::create("Overflow", overflowThreadMain);
+    thread->start();
+    thread->waitForCompletion();
+    Profiler::setEventBufferSize(1 << 16);
+    Profiler::nextFrame();
+
+    const int numOverflow = countEvents("Overflow");
+    testAssert(numOverflow > 0);
+    testAssert(numOverflow < 100);
+    testAssert(countEvents("OverflowChild") == numOverflow);
+    testAssert(Profiler::numDroppedEvents() == 2 * (100 - numOverflow));
+}
+
+
+static void testTraceCapture() {
+    const String filename = "Profiler-trace.json";
+
+    Profiler::startTraceCapture();
+    testAssert(Profiler::traceCaptureActive());
+    for (int frame = 0; frame < 3; ++frame) {
+        BEGIN_PROFILER_EVENT_WITH_HINT("Traced", "\"quoted\\path\"");
+        BEGIN_PROFILER_EVENT("TracedChild");
+        END_PROFILER_EVENT();
+        END_PROFILER_EVENT();
+        Profiler::nextFrame();
+    }
+    Profiler::stopTraceCapture(filename);
+    testAssert(! Profiler::traceCaptureActive());
+
+    const Any trace = Any::parse(readWholeFile(filename));
+    const Any& eventArray = trace["traceEvents"];
+    int numTraced = 0, numChild = 0;
+    for (int i = 0; i < eventArray.size(); ++i) {
+        const Any& event = eventArray[i];
+        if (String(event["ph"]) != "X") {
+            continue;
+        }
+        testAssert(String(event["cat"]) == "CPU");
+        testAssert(double(event["ts"]) >= 0);
+        if (String(event["name"]) == "Traced") {
+            ++numTraced;
+            testAssert(String(event["args"]["hint"]) == "\"quoted\\path\"");
+        } else if (String(event["name"]) == "TracedChild") {
+            ++numChild;
+        }
+        testAssert(String(event["name"]) != "other");
+    }
+    testAssert(numTraced == 3);
+    testAssert(numChild == 3);
+    FileSystem::removeFile(filename);
+}
+
+
+void testProfiler() {
+    printf("Profiler ");
+
+    const bool wasEnabled = Profiler::enabled();
+    Profiler::setEnabled(true);
+
+    testNesting();
+    testOpenAcrossFrames();
+    testThreads();
+    testTraceCapture();
+
+    Profiler::setEnabled(wasEnabled);
+
+    printf("passed\n");
+}
+
+
+void perfProfiler() {
+    printf("Profiler:\n");
+
+    const bool wasEnabled = Profiler::enabled();
+    Profiler::setEnabled(true);
+
+    const int n = 10000;
+    Stopwatch sw;
+
+    sw.tick();
+    for (int i = 0; i < n; ++i) {
+        BEGIN_PROFILER_EVENT("Interned");
+        END_PROFILER_EVENT();
+    }
+    sw.tock();
+    const RealTime internedTime = sw.elapsedTime() / n;
+    Profiler::nextFrame();
+
+    sw.tick();
+    for (int i = 0; i < n; ++i) {
+        Profiler::beginEvent("ByName", __FILE__, __LINE__, 0);
+        Profiler::endEvent();
+    }
+    sw.tock();
+    const RealTime byNameTime = sw.elapsedTime() / n;
+    Profiler::nextFrame();
+
+    const int numThreads = ThreadPool::numThreads();
+    sw.tick();
+    ThreadPool::parallelFor(0, numThreads, [](int i, int threadID) {
+        for (int j = 0; j < n; ++j) {
+            BEGIN_PROFILER_EVENT("Contended");
+            END_PROFILER_EVENT();
+        }
+    }, 1);
+    sw.tock();
+    const RealTime parallelTime = sw.elapsedTime() / n;
+
+    sw.tick();
+    Profiler::nextFrame();
+    sw.tock();
+    const RealTime nextFrameTime = sw.elapsedTime();
+
+    printf("  Begin/end pair, interned ID:   %6.0f ns\n", internedTime * 1e9);
+    printf("  Begin/end pair, String name:   %6.0f ns\n", byNameTime * 1e9);
+    printf("  Begin/end pair on %2d threads:  %6.0f ns\n", numThreads, parallelTime * 1e9);
+    printf("  nextFrame with %d events:  %6.2f ms\n\n", numThreads * n, nextFrameTime / units::milliseconds());
+
+    Profiler::setEnabled(wasEnabled);
+}
@@ -1,6 +1,178 @@
 #include <G3D/G3DAll.h>
 #include "testassert.h"
 
+namespace {
+
+void writeOFF(const String& filename, int numQuads) {
+    TextOutput t(filename);
+    t.printf("OFF\n%d %d 0\n", 4 * numQuads, 2 * numQuads);
+    for (int q = 0; q < numQuads; ++q) {
+        t.printf("%d 0 0\n%d 0 0\n%d 1 0\n%d 1 0\n", q, q + 1, q + 1, q);
+    }
+    for (int q = 0; q < numQuads; ++q) {
+        t.printf("3 %d %d %d\n3 %d %d %d\n", 4 * q, 4 * q + 1, 4 * q + 2, 4 * q, 4 * q + 2, 4 * q + 3);
+    }
+    t.commit();
+}
+
+
+void testSamePart(const ArticulatedModel::Part* a, const ArticulatedModel::Part* b) {
+    testAssert(a->name == b->name);
+    testAssert(a->uniqueID == b->uniqueID);
+    testAssert(a->cframe == b->cframe);
+    testAssert(a->inverseBindPoseTransform == b->inverseBindPoseTransform);
+    testAssert(a->childArray().size() == b->childArray().size());
+    for (int c = 0; c < a->childArray().size(); ++c) {
+        testAssert(b->childArray()[c]->parent() == b);
+        testSamePart(a->childArray()[c], b->childArray()[c]);
+    }
+}
+
+
+void testSameModel(const shared_ptr<ArticulatedModel>& a, const shared_ptr<ArticulatedModel>& b) {
+    testAssert(a->name() == b->name());
+
+    testAssert(a->rootArray().size() == b->rootArray().size());
+    for (int p = 0; p < a->rootArray().size(); ++p) {
+        testAssert(isNull(b->rootArray()[p]->parent()));
+        testSamePart(a->rootArray()[p], b->rootArray()[p]);
+    }
+
+    testAssert(a->geometryArray().size() == b->geometryArray().size());
+    for (int g = 0; g < a->geometryArray().size(); ++g) {
+        const CPUVertexArray& va = a->geometryArray()[g]->cpuVertexArray;
+        const CPUVertexArray& vb = b->geometryArray()[g]->cpuVertexArray;
+        testAssert(a->geometryArray()[g]->name == b->geometryArray()[g]->name);
+        testAssert(va.hasTangent == vb.hasTangent);
+        testAssert(va.hasTexCoord0 == vb.hasTexCoord0);
+        testAssert(va.size() == vb.size());
+        for (int v = 0; v < va.size(); ++v) {
+            testAssert(va.vertex[v].position == vb.vertex[v].position);
+            testAssert(va.vertex[v].normal == vb.vertex[v].normal);
+            testAssert(va.vertex[v].texCoord0 == vb.vertex[v].texCoord0);
+        }
+        testAssert(a->geometryArray()[g]->boxBounds == b->geometryArray()[g]->boxBounds);
+    }
+
+    testAssert(a->meshArray().size() == b->meshArray().size());
+    for (int m = 0; m < a->meshArray().size(); ++m) {
+        const ArticulatedModel::Mesh* ma = a->meshArray()[m];
+        const ArticulatedModel::Mesh* mb = b->meshArray()[m];
+        testAssert(ma->name == mb->name);
+        testAssert(ma->uniqueID == mb->uniqueID);
+        testAssert(ma->twoSided == mb->twoSided);
+        testAssert(ma->primitive == mb->primitive);
+        testAssert(ma->cpuIndexArray.size() == mb->cpuIndexArray.size());
+        for (int i = 0; i < ma->cpuIndexArray.size(); ++i) {
+            testAssert(ma->cpuIndexArray[i] == mb->cpuIndexArray[i]);
+        }
+        testAssert(ma->logicalPart->name == mb->logicalPart->name);
+        testAssert(ma->geometry->name == mb->geometry->name);
+        testAssert(ma->sphereBounds == mb->sphereBounds);
+    }
+}
+
+}
+
+
+static void testMaterialSpecification() {
+    const UniversalMaterial::Specification original(Any::parse(
+        "UniversalMaterial::Specification {"
+        "  lambertian = Color3(0.5, 0.25, 0.125);"
+        "  glossy = Color4(0.04, 0.04, 0.04, 0.5);"
+        "  emissive = Color3(1, 0, 0);"
+        "  etaTransmit = 1.3;"
+        "  alphaHint = BINARY;"
+        "  customShaderPrefix = \"#define FOO 1\";"
+        "}"));
+
+    const UniversalMaterial::Specification copy(original.toAny());
+    testAssert(copy == original);
+    testAssert(! original.referencesTextureObjects());
+}
+
+
+static void testModelRoundTrip() {
+    const shared_ptr<ArticulatedModel> model = ArticulatedModel::createEmpty("Robot");
+    ArticulatedModel::Part* body = model->addPart("body");
+    body->cframe = CFrame::fromXYZYPRDegrees(1, 2, 3, 45, 10, 0);
+    ArticulatedModel::Part* arm = model->addPart("arm", body);
+    arm->cframe = CFrame::fromXYZYPRDegrees(0, 1, 0);
+    model->addPart("hand", arm);
+    model->addPart("base");
+
+    ArticulatedModel::Geometry* geometry = model->addGeometry("geom");
+    Array<CPUVertexArray::Vertex>& vertex = geometry->cpuVertexArray.vertex;
+    Random rnd(30, false);
+    for (int i = 0; i < 30; ++i) {
+        CPUVertexArray::Vertex& v = vertex.next();
+        v.position  = Point3(rnd.uniform(), rnd.uniform(), rnd.uniform());
+        v.normal    = Vector3::random(rnd);
+        v.texCoord0 = Point2(rnd.uniform(), rnd.uniform());
+        v.tangent   = Vector4::zero();
+    }
+
+    ArticulatedModel::Mesh* mesh = model->addMesh("mesh0", body, geometry);
+    for (int i = 0; i < 30; ++i) {
+        mesh->cpuIndexArray.append(i);
+    }
+    mesh = model->addMesh("mesh1", arm, geometry);
+    mesh->twoSided = true;
+    mesh->primitive = PrimitiveType::LINES;
+    mesh->cpuIndexArray.append(0, 5, 7, 9);
+    model->computeBounds();
+
+    BinaryOutput out("<memory>", G3D_LITTLE_ENDIAN);
+    model->speedSerialize(out);
+
+    BinaryInput in(out.getCArray(), out.size(), G3D_LITTLE_ENDIAN);
+    const shared_ptr<ArticulatedModel> copy = ArticulatedModel::speedCreate(in);
+    testAssert(! in.hasMore());
+    testSameModel(model, copy);
+
+    // IDs continue from where the original left off
+    testAssert(copy->addPart("new")->uniqueID == model->addPart("new")->uniqueID);
+}
+
+
+static void testCache() {
+    const String directory = "speedload-cache";
+    const String filename = "speedload-model.off";
+    writeOFF(filename, 2);
+
+    ArticulatedModel::Specification spec;
+    spec.filename = filename;
+    spec.cachable = false;
+    ArticulatedModel::setSpeedLoadCacheDirectory(directory);
+
+    const shared_ptr<ArticulatedModel> original = ArticulatedModel::create(spec);
+    Array<String> cacheFiles;
+    FileSystem::getFiles(FilePath::concat(directory, "*.ArticulatedModel"), cacheFiles);
+    testAssert(cacheFiles.size() == 1);
+
+    const shared_ptr<ArticulatedModel> cached = ArticulatedModel::create(spec);
+    testSameModel(original, cached);
+
+    // A different specification uses a different entry
+    spec.scale = 2.0f;
+    const shared_ptr<ArticulatedModel> scaled = ArticulatedModel::create(spec);
+    testAssert(scaled->geometryArray()[0]->boxBounds.extent().x == 2.0f * original->geometryArray()[0]->boxBounds.extent().x);
+    cacheFiles.clear();
+    FileSystem::getFiles(FilePath::concat(directory, "*.ArticulatedModel"), cacheFiles);
+    testAssert(cacheFiles.size() == 2);
+
+    // Changing the source invalidates the cache
+    spec.scale = 1.0f;
+    writeOFF(filename, 3);
+    const shared_ptr<ArticulatedModel> changed = ArticulatedModel::create(spec);
+    testAssert(changed->meshArray()[0]->cpuIndexArray.size() == 18);
+
+    ArticulatedModel::setSpeedLoadCacheDirectory("");
+    FileSystem::removeFile(FilePath::concat(directory, "*.ArticulatedModel"));
+    FileSystem::removeFile(filename);
+}
+
+
 void testSpeedLoad() {
     debugPrintf("SpeedLoad...");
     {
@@ -16,5 +188,8 @@ void testSpeedLoad() {
         SpeedLoad::readHeader(b, "Chunk2");
         SpeedLoad::readHeader(b, "Chunk3");
     }
+    testMaterialSpecification();
+    testModelRoundTrip();
+    testCache();
     debugPrintf("Passed\n");
-}
+}
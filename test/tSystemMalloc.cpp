@@ -0,0 +1,243 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+#include <thread>
+using G3D::uint8;
+using G3D::uint32;
+using G3D::uint64;
+
+namespace {
+
+/** Fills \a ptr with a pattern derived from \a seed */
+void fill(void* ptr, size_t bytes, int seed) {
+    uint8* p = static_cast<uint8*>(ptr);
+    for (size_t i = 0; i < bytes; ++i) {
+        p[i] = uint8(seed + i * 7);
+    }
+}
+
+bool check(const void* ptr, size_t bytes, int seed) {
+    const uint8* p = static_cast<const uint8*>(ptr);
+    for (size_t i = 0; i < bytes; ++i) {
+        if (p[i] != uint8(seed + i * 7)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+
+static void testSingleThreaded() {
+    // Every size up to the largest size class and a few beyond, all live at once
+    Array<void*> ptr;
+    Array<size_t> bytes;
+    for (size_t n = 0; n < 9000; n += (n < 300) ? 1 : 37) {
+        void* p = System::malloc(n);
+        testAssert(p != NULL);
+        testAssertM((intptr_t(p) % 16) == 0, "System::malloc returned unaligned memory");
+        fill(p, n, int(n));
+        ptr.append(p);
+        bytes.append(n);
+    }
+
+    for (int i = 0; i < ptr.size(); ++i) {
+        testAssertM(check(ptr[i], bytes[i], int(bytes[i])), "System::malloc blocks overlap");
+        System::free(ptr[i]);
+    }
+
+    // Growing by realloc preserves the contents
+    void* p = System::malloc(10);
+    fill(p, 10, 3);
+    for (size_t n = 20; n < 20000; n *= 2) {
+        p = System::realloc(p, n);
+        testAssert(check(p, 10, 3));
+    }
+    System::free(p);
+
+    System::free(NULL);
+}
+
+
+/** Blocks allocated by one task and freed by another */
+static void testCrossThread() {
+    const int numTasks = max(4, ThreadPool::numThreads());
+    const int blocksPerTask = 2000;
+
+    Array< Array<void*> > block;
+    block.resize(numTasks);
+
+    for (int round = 0; round < 5; ++round) {
+        ThreadPool::parallelFor(0, numTasks, [&](int t, int) {
+            Random rnd(t + round * 100, false);
+            Array<void*>& mine = block[t];
+            mine.resize(blocksPerTask);
+            for (int i = 0; i < blocksPerTask; ++i) {
+                const size_t n = size_t(rnd.integer(1, (i % 10 == 0) ? 9000 : 300));
+                mine[i] = System::malloc(n + sizeof(size_t));
+                *static_cast<size_t*>(mine[i]) = n;
+                fill(static_cast<size_t*>(mine[i]) + 1, n, t + i);
+            }
+        }, 1);
+
+        ThreadPool::parallelFor(0, numTasks, [&](int t, int) {
+            const int other = (t + 1) % numTasks;
+            Array<void*>& theirs = block[other];
+            for (int i = 0; i < theirs.size(); ++i) {
+                const size_t n = *static_cast<size_t*>(theirs[i]);
+                testAssertM(check(static_cast<size_t*>(theirs[i]) + 1, n, other + i), "Block corrupted before cross-thread free");
+                System::free(theirs[i]);
+            }
+            theirs.fastClear();
+        }, 1);
+    }
+}
+
+
+/** Number of thread caches reported by System::mallocStatus() */
+static int numThreadCaches() {
+    const String& status = System::mallocStatus();
+    const size_t end = status.find(" thread caches");
+    testAssert(end != String::npos);
+    const size_t start = status.rfind(' ', end - 1) + 1;
+    return atoi(status.substr(start, end - start).c_str());
+}
+
+
+/** Threads that exit return their caches for reuse */
+static void testThreadExit() {
+    // Ensure that this thread has a cache before counting
+    System::free(System::malloc(16));
+    const int before = numThreadCaches();
+
+    for (int t = 0; t < 20; ++t) {
+        std::thread thread([t] {
+            Array<void*> ptr;
+            for (int i = 0; i < 500; ++i) {
+                ptr.append(System::malloc(16 + (i % 32) * 16));
+            }
+            // Leave blocks in the cache when exiting
+            for (int i = 0; i < ptr.size(); i += 2) {
+                System::free(ptr[i]);
+            }
+            for (int i = 1; i < ptr.size(); i += 2) {
+                System::free(ptr[i]);
+            }
+        });
+        thread.join();
+    }
+
+    testAssertM(numThreadCaches() <= before + 1, "Exited threads did not release their caches");
+}
+
+
+void testSystemMalloc() {
+    printf("System::malloc ");
+    testSingleThreaded();
+    testCrossThread();
+    testThreadExit();
+    testAssert(System::mallocStatus().find("Size class") != String::npos);
+    printf("passed\n");
+}
+
+
+namespace {
+
+typedef void* (*MallocFunc)(size_t);
+typedef void (*FreeFunc)(void*);
+
+/** Each task replaces random entries of a working set of small blocks.
+    Returns nanoseconds per malloc/free pair. */
+double stressSameThread(MallocFunc mallocFunc, FreeFunc freeFunc, int numTasks, int numOps) {
+    Stopwatch sw;
+    sw.tick();
+    ThreadPool::parallelFor(0, numTasks, [&](int t, int) {
+        const int workingSetSize = 512;
+        void* workingSet[workingSetSize];
+        for (int i = 0; i < workingSetSize; ++i) {
+            workingSet[i] = NULL;
+        }
+
+        Random rnd(t, false);
+        for (int i = 0; i < numOps; ++i) {
+            const int j = rnd.integer(0, workingSetSize - 1);
+            freeFunc(workingSet[j]);
+            // Mostly tiny requests, as from String and Table
+            const int n = ((i & 15) == 0) ? rnd.integer(257, 8192) : rnd.integer(8, 256);
+            workingSet[j] = mallocFunc(n);
+            static_cast<uint8*>(workingSet[j])[0] = uint8(i);
+        }
+
+        for (int i = 0; i < workingSetSize; ++i) {
+            freeFunc(workingSet[i]);
+        }
+    }, 1);
+    sw.tock();
+    return sw.elapsedTime() * 1e9 / (double(numTasks) * numOps);
+}
+
+
+/** Each task frees the blocks that the previous task allocated.
+    Returns nanoseconds per malloc/free pair. */
+double stressProducerConsumer(MallocFunc mallocFunc, FreeFunc freeFunc, int numTasks, int numOps) {
+    const int batch = 4096;
+    Array< Array<void*> > block;
+    block.resize(numTasks);
+
+    Stopwatch sw;
+    sw.tick();
+    for (int round = 0; round < numOps / batch; ++round) {
+        ThreadPool::parallelFor(0, numTasks, [&](int t, int) {
+            Array<void*>& theirs = block[(t + 1) % numTasks];
+            for (int i = 0; i < theirs.size(); ++i) {
+                freeFunc(theirs[i]);
+            }
+            theirs.fastClear();
+        }, 1);
+
+        ThreadPool::parallelFor(0, numTasks, [&](int t, int) {
+            Array<void*>& mine = block[t];
+            for (int i = 0; i < batch; ++i) {
+                mine.append(mallocFunc(16 + (i & 7) * 24));
+            }
+        }, 1);
+    }
+    sw.tock();
+
+    for (int t = 0; t < numTasks; ++t) {
+        for (int i = 0; i < block[t].size(); ++i) {
+            freeFunc(block[t][i]);
+        }
+    }
+
+    return sw.elapsedTime() * 1e9 / (double(numTasks) * (numOps / batch) * batch);
+}
+
+void* nativeMalloc(size_t bytes) {
+    return ::malloc(bytes);
+}
+
+void nativeFree(void* ptr) {
+    ::free(ptr);
+}
+
+}
+
+
+void perfSystemMalloc() {
+    printf("System::malloc multithreaded stress:\n");
+    const int numOps = 400000;
+
+    for (int numTasks = 1; numTasks <= max(4, ThreadPool::numThreads()); numTasks *= 2) {
+        // Warm up the caches of the pool threads
+        stressSameThread(System::malloc, System::free, numTasks, numOps / 10);
+
+        printf("  %2d threads, working set:        System::malloc %6.1f ns   ::malloc %6.1f ns\n", numTasks,
+               stressSameThread(System::malloc, System::free, numTasks, numOps),
+               stressSameThread(nativeMalloc, nativeFree, numTasks, numOps));
+        printf("  %2d threads, producer/consumer:  System::malloc %6.1f ns   ::malloc %6.1f ns\n", numTasks,
+               stressProducerConsumer(System::malloc, System::free, numTasks, numOps),
+               stressProducerConsumer(nativeMalloc, nativeFree, numTasks, numOps));
+    }
+    printf("\n");
+}
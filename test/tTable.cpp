@@ -220,9 +220,147 @@ void testTable() {
 }
 
 
+void testFlatTable() {
+
+    printf("G3D::FlatTable  ");
+
+    // Custom hashing struct
+    {
+        FlatTable<TableKeyWithCustomHashStruct, int, TableKeyCustomHashStruct> table;
+        int val;
+
+        table.set(1, 1);
+        table.set(2, 2);
+        table.set(3, 3);
+
+        table.remove(2);
+
+        testAssert(table.get(3) == 3);
+        testAssert(table.get(1, val) && val == 1);
+        testAssert(! table.get(2, val));
+        testAssert(table.containsKey(3));
+        testAssert(! table.containsKey(2));
+
+        table.remove(1);
+        table.remove(3);
+        testAssert(table.size() == 0);
+    }
+
+    // Every key has the same hash code, so all of them share one probe sequence
+    {
+        TableKey x[100];
+        FlatTable<TableKey*, int> table;
+        for (int i = 0; i < 100; ++i) {
+            x[i].value = i;
+            table.set(x + i, i);
+        }
+        testAssert(table.size() == 100);
+        for (int i = 0; i < 100; ++i) {
+            testAssert(table[x + i] == i);
+        }
+        for (int i = 0; i < 100; i += 2) {
+            testAssert(table.remove(x + i));
+        }
+        for (int i = 0; i < 100; ++i) {
+            testAssert(table.containsKey(x + i) == (i % 2 == 1));
+        }
+    }
+
+    // getCreate, getRemove, iteration, copying, and comparison
+    {
+        FlatTable<int, String> table;
+        bool created = false;
+        table.getCreate(7, created) = "seven";
+        testAssert(created);
+        table.getCreate(7, created);
+        testAssert(! created);
+        table.set(8, "eight");
+
+        int n = 0;
+        for (FlatTable<int, String>::Iterator it = table.begin(); it.isValid(); ++it) {
+            testAssert(((it->key == 7) && (it->value == "seven")) || ((it->key == 8) && (it->value == "eight")));
+            ++n;
+        }
+        testAssert(n == 2);
+
+        FlatTable<int, String> copy(table);
+        testAssert(copy == table);
+        copy.set(8, "huit");
+        testAssert(copy != table);
+        copy = table;
+        testAssert(copy == table);
+
+        int k;
+        String v;
+        testAssert(table.getRemove(7, k, v) && (k == 7) && (v == "seven"));
+        testAssert(! table.getRemove(7, k, v));
+        testAssert(table.size() == 1);
+        testAssert(copy.size() == 2);
+        testAssert(table.containsValue("eight") && ! table.containsValue("seven"));
+
+        table.clear();
+        testAssert(table.size() == 0);
+        testAssert(table.begin() == table.end());
+    }
+
+    // Randomized comparison against Table, with enough removals to
+    // force rehashing that only discards deleted slots
+    {
+        Random rnd(1234, false);
+        Table<int, int>     reference;
+        FlatTable<int, int> table;
+        for (int i = 0; i < 200000; ++i) {
+            const int key = rnd.integer(0, 3000);
+            switch (rnd.integer(0, 2)) {
+            case 0:
+                reference.set(key, i);
+                table.set(key, i);
+                break;
+
+            case 1:
+                testAssert(reference.remove(key) == table.remove(key));
+                break;
+
+            default:
+                {
+                    const int* a = reference.getPointer(key);
+                    const int* b = table.getPointer(key);
+                    testAssert((a == NULL) == (b == NULL));
+                    testAssert((a == NULL) || (*a == *b));
+                }
+            }
+            testAssert(reference.size() == table.size());
+        }
+
+        size_t n = 0;
+        for (FlatTable<int, int>::Iterator it = table.begin(); it != table.end(); ++it) {
+            testAssert(reference[it.key()] == it.value());
+            ++n;
+        }
+        testAssert(n == reference.size());
+        testAssert(table.debugGetLoad() <= 7.0 / 8.0);
+    }
+
+    // Size hints
+    {
+        FlatTable<int, int> table;
+        table.setSizeHint(1000);
+        const size_t numBuckets = table.debugGetNumBuckets();
+        for (int i = 0; i < 1000; ++i) {
+            table.set(i, -i);
+        }
+        testAssert(table.debugGetNumBuckets() == numBuckets);
+        testAssert(table.size() == 1000);
+    }
+
+    printf("passed\n");
+}
+
+
 template<class K, class V>
 void perfTest(const char* description, const K* keys, const V* vals, int M) {
     uint64 tableSet = 0, tableGet = 0, tableRemove = 0;
+    uint64 flatSet = 0, flatGet = 0, flatRemove = 0;
     uint64 mapSet = 0, mapGet = 0, mapRemove = 0;
 #   ifdef HAS_HASH_MAP
     uint64 hashMapSet = 0, hashMapGet = 0, hashMapRemove = 0;
@@ -238,6 +376,9 @@ void perfTest(const char* description, const K* keys, const V* vals, int M) {
         // counting cycles.
         System::beginCycleCount(overhead);
         K k; V v;
+        // Storing the address through a volatile keeps the optimizer
+        // from discarding the fetch loops
+        const V* volatile sink = &v;
         for (int i = 0; i < M; ++i) {
             k = keys[i];
             v = vals[i];
@@ -253,7 +394,7 @@ void perfTest(const char* description, const K* keys, const V* vals, int M) {
         
         System::beginCycleCount(tableGet);
         for (int i = 0; i < M; ++i) {
-            v=t[keys[i]];
+            sink = &t[keys[i]];
         }
         System::endCycleCount(tableGet);
 
@@ -266,6 +407,28 @@ void perfTest(const char* description, const K* keys, const V* vals, int M) {
 
         /////////////////////////////////
 
+        {FlatTable<K, V> t;
+        System::beginCycleCount(flatSet);
+        for (int i = 0; i < M; ++i) {
+            t.set(keys[i], vals[i]);
+        }
+        System::endCycleCount(flatSet);
+        
+        System::beginCycleCount(flatGet);
+        for (int i = 0; i < M; ++i) {
+            sink = &t[keys[i]];
+        }
+        System::endCycleCount(flatGet);
+
+        System::beginCycleCount(flatRemove);
+        for (int i = 0; i < M; ++i) {
+            t.remove(keys[i]);
+        }
+        System::endCycleCount(flatRemove);
+        }
+
+        /////////////////////////////////
+
         {std::map<K, V> t;
         System::beginCycleCount(mapSet);
         for (int i = 0; i < M; ++i) {
@@ -275,7 +438,7 @@ void perfTest(const char* description, const K* keys, const V* vals, int M) {
         
         System::beginCycleCount(mapGet);
         for (int i = 0; i < M; ++i) {
-            v=t[keys[i]];
+            sink = &t[keys[i]];
         }
         System::endCycleCount(mapGet);
 
@@ -298,7 +461,7 @@ void perfTest(const char* description, const K* keys, const V* vals, int M) {
         
         System::beginCycleCount(hashMapGet);
         for (int i = 0; i < M; ++i) {
-            v=t[keys[i]];
+            sink = &t[keys[i]];
         }
         System::endCycleCount(hashMapGet);
 
@@ -309,19 +472,16 @@ void perfTest(const char* description, const K* keys, const V* vals, int M) {
         System::endCycleCount(hashMapRemove);
         }
 #       endif
-    }
 
-    tableSet -= overhead;
-    if (tableGet < overhead) {
-        tableGet = 0;
-    } else {
-        tableGet -= overhead;
+        // Reading the sink back keeps it live without dereferencing a removed element
+        alwaysAssertM(sink != NULL, "Lookup loops produced no element");
     }
-    tableRemove -= overhead;
 
-    mapSet -= overhead;
-    mapGet -= overhead;
-    mapRemove -= overhead;
+    // Subtract the overhead, clamping at zero for operations that are faster than the loop itself
+    uint64* counts[] = {&tableSet, &tableGet, &tableRemove, &flatSet, &flatGet, &flatRemove, &mapSet, &mapGet, &mapRemove};
+    for (int i = 0; i < (int)(sizeof(counts) / sizeof(counts[0])); ++i) {
+        *counts[i] = (*counts[i] < overhead) ? 0 : *counts[i] - overhead;
+    }
 
     float N = (float)M;
     printf("%s\n", description);
@@ -332,6 +492,7 @@ void perfTest(const char* description, const K* keys, const V* vals, int M) {
     printf("Table         %9.1f  %9.1f  %9.1f   %s\n", 
            (float)tableSet / N, (float)tableGet / N, (float)tableRemove / N,
            G3Dwin ? " ok " : "FAIL"); 
+    printf("FlatTable     %9.1f  %9.1f  %9.1f\n", (float)flatSet / N, (float)flatGet / N, (float)flatRemove / N); 
 #   ifdef HAS_HASH_MAP
     printf("hash_map      %9.1f  %9.1f  %9.1f\n", (float)hashMapSet / N, (float)hashMapGet / N, (float)hashMapRemove / N); 
 #   endif
@@ -384,4 +545,26 @@ void perfTable() {
         }
         perfTest<String, String>("string, string", keys, vals, M);
     }
+
+    // Large tables, where the table no longer fits in cache
+    const int L = 100000;
+    {
+        Array<int> keys, vals;
+        Random rnd(1234, false);
+        for (int i = 0; i < L; ++i) {
+            keys.append(rnd.bits() & 0x7FFFFFFF);
+            vals.append(i);
+        }
+        perfTest<int, int>(format("int, int (%d keys)", L).c_str(), keys.getCArray(), vals.getCArray(), L);
+    }
+
+    {
+        Array<String> keys;
+        Array<int> vals;
+        for (int i = 0; i < L; ++i) {
+            keys.append(format("%d", i * 2));
+            vals.append(i);
+        }
+        perfTest<String, int>(format("string, int (%d keys)", L).c_str(), keys.getCArray(), vals.getCArray(), L);
+    }
 }
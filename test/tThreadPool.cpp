@@ -0,0 +1,184 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+#include <atomic>
+
+namespace {
+
+class Tracer {
+public:
+    Map2D<int>::Ref     count;
+    Array<int>          threadSeen;
+
+    Tracer(int w, int h, int numThreads) {
+        count = Map2D<int>::create(w, h);
+        count->setAll(0);
+        threadSeen.resize(numThreads);
+        for (int i = 0; i < numThreads; ++i) {
+            threadSeen[i] = 0;
+        }
+    }
+
+    void trace(int x, int y) {
+        ++count->get(x, y);
+    }
+
+    void traceWithID(int x, int y, int threadID) {
+        ++count->get(x, y);
+        testAssert(threadID >= 0 && threadID < threadSeen.size());
+        threadSeen[threadID] = 1;
+    }
+};
+
+}
+
+
+static void testParallelFor() {
+    const int N = 100003;
+    Array<int> hit;
+    hit.resize(N);
+    System::memset(hit.getCArray(), 0, sizeof(int) * N);
+
+    ThreadPool::parallelFor(0, N, [&](int i, int threadID) {
+        testAssert(threadID >= 0 && threadID < ThreadPool::numThreads());
+        ++hit[i];
+    });
+
+    for (int i = 0; i < N; ++i) {
+        testAssertM(hit[i] == 1, format("Iteration %d executed %d times", i, hit[i]));
+    }
+
+    // Empty and reversed ranges
+    ThreadPool::parallelFor(5, 5, [&](int i, int threadID) { testAssert(false); });
+    ThreadPool::parallelFor(5, 0, [&](int i, int threadID) { testAssert(false); });
+}
+
+
+static void testNestedParallelFor() {
+    const int outer = 64;
+    const int inner = 1000;
+    std::atomic<int> total(0);
+
+    // Per-thread state indexed by the outer threadID must not be
+    // reentered by a thread that helps with other work while waiting
+    Array<int> busy;
+    busy.resize(ThreadPool::numThreads());
+    System::memset(busy.getCArray(), 0, sizeof(int) * busy.size());
+    std::atomic<int> reentered(0);
+
+    ThreadPool::parallelFor(0, outer, [&](int i, int threadID) {
+        if (busy[threadID]) {
+            ++reentered;
+        }
+        busy[threadID] = 1;
+        std::atomic<int> subtotal(0);
+        ThreadPool::parallelFor(0, inner, [&](int j, int) {
+            ++subtotal;
+        }, 16);
+        testAssert(subtotal.load() == inner);
+        total += subtotal.load();
+        busy[threadID] = 0;
+    }, 1);
+
+    testAssert(total.load() == outer * inner);
+    testAssert(reentered.load() == 0);
+}
+
+
+static void testMaxThreads() {
+    // Thread IDs must respect maxThreads so that callers can size
+    // per-thread state by it
+    const int maxThreads = 2;
+    std::atomic<int> badID(0);
+    ThreadPool::parallelForRange(0, 10000, [&](int begin, int end, int threadID) {
+        if ((threadID < 0) || (threadID >= maxThreads)) {
+            ++badID;
+        }
+    }, 1, maxThreads);
+    testAssert(badID.load() == 0);
+}
+
+
+static void testRunConcurrently2D() {
+    const int w = 317, h = 211;
+    {
+        Tracer tracer(w, h, 1);
+        GThread::runConcurrently2D(Point2int32(0, 0), Point2int32(w, h), &tracer, &Tracer::trace);
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                testAssert(tracer.count->get(x, y) == 1);
+            }
+        }
+    }
+    {
+        const int numThreads = 3;
+        Tracer tracer(w, h, numThreads);
+        GThread::runConcurrently2D(Point2int32(10, 20), Point2int32(w, h), &tracer, &Tracer::traceWithID, numThreads);
+        for (int y = 0; y < h; ++y) {
+            for (int x = 0; x < w; ++x) {
+                const int expected = ((x >= 10) && (y >= 20)) ? 1 : 0;
+                testAssert(tracer.count->get(x, y) == expected);
+            }
+        }
+        testAssert(tracer.threadSeen[0] == 1);
+    }
+}
+
+
+void testThreadPool() {
+    printf("G3D::ThreadPool ");
+
+    testParallelFor();
+    testNestedParallelFor();
+    testMaxThreads();
+    testRunConcurrently2D();
+
+    printf("passed\n");
+}
+
+
+void perfThreadPool() {
+    printf("ThreadPool:\n");
+
+    // Many short loops measure per-call overhead, which used to include
+    // creating and joining one thread per core
+    const int numLoops = 2000;
+    const int N = 4096;
+    Array<float> data;
+    data.resize(N);
+
+    Stopwatch sw;
+    sw.tick();
+    for (int k = 0; k < numLoops; ++k) {
+        ThreadPool::parallelForRange(0, N, [&](int begin, int end, int) {
+            for (int i = begin; i < end; ++i) {
+                data[i] = sqrt(float(i + k));
+            }
+        });
+    }
+    sw.tock();
+    printf("  parallelForRange, %d iterations:  %6.2f us/call\n", N, sw.elapsedTime() * 1e6 / numLoops);
+
+    sw.tick();
+    for (int k = 0; k < numLoops; ++k) {
+        for (int i = 0; i < N; ++i) {
+            data[i] = sqrt(float(i + k));
+        }
+    }
+    sw.tock();
+    printf("  serial loop, %d iterations:       %6.2f us/call\n", N, sw.elapsedTime() * 1e6 / numLoops);
+
+    // Imbalanced work: cost grows with the row index
+    const int w = 256, h = 256;
+    Array<float> image;
+    image.resize(w * h);
+    sw.tick();
+    ThreadPool::parallelFor2D(Vector2int32(0, 0), Vector2int32(w, h), [&](int x, int y, int) {
+        float s = 0;
+        for (int i = 0; i < y * 4; ++i) {
+            s += sin(float(x + i));
+        }
+        image[x + y * w] = s;
+    });
+    sw.tock();
+    printf("  parallelFor2D, imbalanced %dx%d:  %6.2f ms\n\n", w, h, sw.elapsedTime() / units::milliseconds());
+}
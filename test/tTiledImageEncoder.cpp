@@ -0,0 +1,210 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+using G3D::uint8;
+
+namespace {
+
+/** A synthetic dashboard: a gradient background with a few filled boxes */
+shared_ptr<CPUPixelTransferBuffer> makeFrame(int width, int height, const ImageFormat* format = ImageFormat::RGB8()) {
+    const shared_ptr<CPUPixelTransferBuffer>& buffer = CPUPixelTransferBuffer::create(width, height, format);
+    const int bytesPerPixel = format->cpuBitsPerPixel / 8;
+    for (int y = 0; y < height; ++y) {
+        uint8* row = static_cast<uint8*>(buffer->row(y));
+        for (int x = 0; x < width; ++x) {
+            for (int c = 0; c < bytesPerPixel; ++c) {
+                row[x * bytesPerPixel + c] = uint8((x * (c + 1) + y * 3) >> 2);
+            }
+        }
+    }
+    return buffer;
+}
+
+
+/** Fills a rectangle of \a buffer with \a value */
+void fillRect(const shared_ptr<CPUPixelTransferBuffer>& buffer, int x0, int y0, int w, int h, uint8 value) {
+    const int bytesPerPixel = buffer->format()->cpuBitsPerPixel / 8;
+    for (int y = y0; y < y0 + h; ++y) {
+        uint8* row = static_cast<uint8*>(buffer->row(y));
+        memset(row + x0 * bytesPerPixel, value, w * bytesPerPixel);
+    }
+}
+
+
+bool sameContents(const shared_ptr<Image>& image, const shared_ptr<CPUPixelTransferBuffer>& expected) {
+    if ((image->width() != expected->width()) || (image->height() != expected->height())) {
+        return false;
+    }
+    const shared_ptr<CPUPixelTransferBuffer>& actual = image->toPixelTransferBuffer();
+    const size_t rowBytes = expected->width() * expected->format()->cpuBitsPerPixel / 8;
+    for (int y = 0; y < expected->height(); ++y) {
+        if (memcmp(actual->row(y), expected->row(y), rowBytes) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** Sends \a frame through serialization, as a network layer would */
+void transmit(const TiledImageEncoder::Frame& frame, TiledImageEncoder::Frame& received) {
+    BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+    frame.serialize(bo);
+    BinaryInput bi(bo.getCArray(), bo.size(), G3D_LITTLE_ENDIAN, false, true);
+    received.deserialize(bi);
+}
+
+}
+
+
+void testTiledImageEncoder() {
+    printf("TiledImageEncoder ");
+
+    // Not a multiple of the tile size, so that the edge tiles are partial
+    const int width = 200, height = 130;
+    TiledImageEncoder::Settings settings;
+    settings.tileSize = 32;
+    const int numTiles = 7 * 5;
+
+    const shared_ptr<TiledImageEncoder>& encoder = TiledImageEncoder::create(settings);
+    const shared_ptr<Image>& decoded = Image::create(1, 1, ImageFormat::RGB8());
+    const shared_ptr<CPUPixelTransferBuffer>& frame = makeFrame(width, height);
+
+    TiledImageEncoder::Frame encoded, received;
+
+    // The first frame is a keyframe with every tile
+    encoder->encode(frame, encoded);
+    testAssert(encoded.keyframe);
+    testAssert(encoded.index == 0);
+    testAssert(encoded.tile.size() == numTiles);
+    testAssert(encoded.tile.last().width == width - 6 * 32);
+    testAssert(encoded.tile.last().height == height - 4 * 32);
+    transmit(encoded, received);
+    TiledImageEncoder::decode(received, decoded);
+    testAssertM(sameContents(decoded, frame), "Keyframe did not round trip");
+
+    // An unchanged frame produces no tiles
+    encoder->encode(frame, encoded);
+    testAssert(! encoded.keyframe);
+    testAssert(encoded.index == 1);
+    testAssert(encoded.tile.size() == 0);
+
+    // A single pixel change resends only its tile
+    fillRect(frame, 70, 40, 1, 1, 255);
+    encoder->encode(frame, encoded);
+    testAssert(encoded.tile.size() == 1);
+    testAssert(encoded.tile[0].origin == Point2int32(64, 32));
+    transmit(encoded, received);
+    TiledImageEncoder::decode(received, decoded);
+    testAssertM(sameContents(decoded, frame), "Delta frame did not round trip");
+
+    // A box straddling tile boundaries, including the partial corner tile
+    fillRect(frame, 150, 100, 50, 30, 17);
+    encoder->encode(frame, encoded);
+    testAssert(encoded.tile.size() == 3 * 2);
+    for (int t = 1; t < encoded.tile.size(); ++t) {
+        const Point2int32& a = encoded.tile[t - 1].origin;
+        const Point2int32& b = encoded.tile[t].origin;
+        testAssertM((a.y < b.y) || ((a.y == b.y) && (a.x < b.x)), "Tiles are not in row-major order");
+    }
+    TiledImageEncoder::decode(encoded, decoded);
+    testAssert(sameContents(decoded, frame));
+
+    // forceKeyframe resends everything, as for a newly connected client
+    encoder->forceKeyframe();
+    encoder->encode(frame, encoded);
+    testAssert(encoded.keyframe);
+    testAssert(encoded.tile.size() == numTiles);
+    const shared_ptr<Image>& lateJoiner = Image::create(1, 1, ImageFormat::RGB8());
+    TiledImageEncoder::decode(encoded, lateJoiner);
+    testAssert(sameContents(lateJoiner, frame));
+
+    // A change in resolution forces a keyframe
+    const shared_ptr<CPUPixelTransferBuffer>& smaller = makeFrame(64, 64);
+    encoder->encode(smaller, encoded);
+    testAssert(encoded.keyframe);
+    testAssert(encoded.tile.size() == 4);
+    TiledImageEncoder::decode(encoded, decoded);
+    testAssert(sameContents(decoded, smaller));
+
+    // Periodic keyframes
+    settings.keyframeInterval = 3;
+    const shared_ptr<TiledImageEncoder>& periodic = TiledImageEncoder::create(settings);
+    for (int i = 0; i < 7; ++i) {
+        periodic->encode(smaller, encoded);
+        testAssert(encoded.keyframe == ((i % 3) == 0));
+    }
+
+    // JPEG tiles from RGBA8 input decode to an image of the right size
+    settings.keyframeInterval = 0;
+    settings.fileFormat = Image::JPEG;
+    const shared_ptr<TiledImageEncoder>& lossy = TiledImageEncoder::create(settings);
+    lossy->encode(makeFrame(width, height, ImageFormat::RGBA8()), encoded);
+    testAssert(encoded.tile.size() == numTiles);
+    const shared_ptr<Image>& lossyDecoded = Image::create(1, 1, ImageFormat::RGB8());
+    TiledImageEncoder::decode(encoded, lossyDecoded);
+    testAssert(lossyDecoded->width() == width && lossyDecoded->height() == height);
+
+    printf("passed\n");
+}
+
+
+void perfTiledImageEncoder() {
+    printf("TiledImageEncoder, 1920x1080 dashboard with one 200x100 widget changing per frame:\n");
+    const int width = 1920, height = 1080;
+    const int numFrames = 20;
+    const shared_ptr<CPUPixelTransferBuffer>& frame = makeFrame(width, height);
+
+    for (int f = 0; f < 2; ++f) {
+        const Image::ImageFileFormat fileFormat = (f == 0) ? Image::PNG : Image::JPEG;
+        const char* name = (f == 0) ? "PNG " : "JPEG";
+
+        // Full frames, as remoteRender sent them
+        size_t fullBytes = 0;
+        Stopwatch sw;
+        sw.tick();
+        for (int i = 0; i < numFrames; ++i) {
+            fillRect(frame, 400, 300, 200, 100, uint8(i * 10));
+            BinaryOutput bo("<memory>", G3D_LITTLE_ENDIAN);
+            Image::fromPixelTransferBuffer(frame)->serialize(bo, fileFormat);
+            fullBytes += size_t(bo.size());
+        }
+        sw.tock();
+        const RealTime fullTime = sw.elapsedTime() / numFrames;
+
+        TiledImageEncoder::Settings settings;
+        settings.fileFormat = fileFormat;
+        const shared_ptr<TiledImageEncoder>& encoder = TiledImageEncoder::create(settings);
+        TiledImageEncoder::Frame encoded;
+        encoder->encode(frame, encoded);
+        const size_t keyframeBytes = encoded.dataSize();
+
+        size_t deltaBytes = 0;
+        sw.tick();
+        for (int i = 0; i < numFrames; ++i) {
+            fillRect(frame, 400, 300, 200, 100, uint8(i * 10 + 5));
+            encoder->encode(frame, encoded);
+            deltaBytes += encoded.dataSize();
+        }
+        sw.tock();
+        const RealTime deltaTime = sw.elapsedTime() / numFrames;
+
+        printf("  %s full frame: %7.2f ms %8d bytes/frame    tiled delta: %7.2f ms %8d bytes/frame  (keyframe %d bytes)\n", name,
+               fullTime / units::milliseconds(), int(fullBytes / numFrames),
+               deltaTime / units::milliseconds(), int(deltaBytes / numFrames), int(keyframeBytes));
+    }
+
+    // Worst case: every tile changes every frame
+    TiledImageEncoder::Settings settings;
+    settings.fileFormat = Image::JPEG;
+    const shared_ptr<TiledImageEncoder>& encoder = TiledImageEncoder::create(settings);
+    TiledImageEncoder::Frame encoded;
+    Stopwatch sw;
+    sw.tick();
+    for (int i = 0; i < 5; ++i) {
+        fillRect(frame, 0, 0, width, height, uint8(i));
+        encoder->encode(frame, encoded);
+    }
+    sw.tock();
+    printf("  JPEG every tile changed: %7.2f ms/frame on %d threads\n", sw.elapsedTime() / 5 / units::milliseconds(), ThreadPool::numThreads());
+    printf("\n");
+}
@@ -0,0 +1,700 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+/** A bumpy heightfield plus a cloud of randomly oriented triangles,
+    which exercises both coherent and poorly distributed geometry. */
+void makeScene(int gridSize, int numSoupTris, Array<Tri>& triArray, CPUVertexArray& vertexArray) {
+    Random rnd(1234, false);
+    triArray.fastClear();
+    vertexArray.clear();
+
+    Array<CPUVertexArray::Vertex>& vertex = vertexArray.vertex;
+    for (int z = 0; z <= gridSize; ++z) {
+        for (int x = 0; x <= gridSize; ++x) {
+            CPUVertexArray::Vertex& v = vertex.next();
+            v.position  = Point3(float(x), 2.0f * sin(x * 0.3f) * cos(z * 0.2f), float(z));
+            v.normal    = Vector3::unitY();
+            v.tangent   = Vector4(1, 0, 0, 1);
+            v.texCoord0 = Point2(float(x), float(z)) / float(gridSize);
+        }
+    }
+
+    const int stride = gridSize + 1;
+    for (int z = 0; z < gridSize; ++z) {
+        for (int x = 0; x < gridSize; ++x) {
+            const int i = x + z * stride;
+            triArray.append(Tri(i, i + stride, i + 1, vertexArray));
+            triArray.append(Tri(i + 1, i + stride, i + stride + 1, vertexArray));
+        }
+    }
+
+    for (int t = 0; t < numSoupTris; ++t) {
+        const Point3 center(rnd.uniform(0.0f, float(gridSize)), rnd.uniform(0.0f, 10.0f), rnd.uniform(0.0f, float(gridSize)));
+        const int first = vertex.size();
+        for (int j = 0; j < 3; ++j) {
+            CPUVertexArray::Vertex& v = vertex.next();
+            v.position  = center + Vector3::random(rnd) * rnd.uniform(0.1f, 2.0f);
+            v.normal    = Vector3::unitY();
+            v.tangent   = Vector4(1, 0, 0, 1);
+            v.texCoord0 = Point2::zero();
+        }
+        triArray.append(Tri(first, first + 1, first + 2, vertexArray, lazy_ptr<ReferenceCountedObject>(), (t & 1) == 1));
+    }
+}
+
+
+void makeRays(int gridSize, int numRays, Array<Ray>& rayArray) {
+    Random rnd(5678, false);
+    rayArray.fastClear();
+    for (int r = 0; r < numRays; ++r) {
+        const Point3 origin(rnd.uniform(-2.0f, gridSize + 2.0f), rnd.uniform(-3.0f, 12.0f), rnd.uniform(-2.0f, gridSize + 2.0f));
+        rayArray.append(Ray::fromOriginAndDirection(origin, Vector3::random(rnd)));
+    }
+}
+
+
+/** Rays from a pinhole camera above the scene in scanline order */
+void makePrimaryRays(int gridSize, int width, int height, Array<Ray>& rayArray) {
+    rayArray.fastClear();
+    const Point3 eye(gridSize * 0.5f, gridSize * 0.75f, -gridSize * 0.25f);
+    for (int y = 0; y < height; ++y) {
+        for (int x = 0; x < width; ++x) {
+            const Vector3 direction(float(x) / width - 0.5f, -0.3f - 0.5f * float(y) / height, 1.0f);
+            rayArray.append(Ray::fromOriginAndDirection(eye, direction.direction()));
+        }
+    }
+}
+
+
+/** Closest hit by testing every triangle */
+float bruteForceDistance(const Ray& ray, const Array<Tri>& triArray, const CPUVertexArray& vertexArray, bool twoSided) {
+    Tri::Intersector intersector;
+    intersector.alphaTest = false;
+    float distance = finf();
+    for (int t = 0; t < triArray.size(); ++t) {
+        intersector(ray, vertexArray, triArray[t], twoSided, distance);
+    }
+    return distance;
+}
+
+}
+
+
+static void testIntersectRay(TriTree::Hierarchy hierarchy, TriTree::SplitAlgorithm algorithm, int parallelBuildThreshold) {
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeScene(24, 300, triArray, vertexArray);
+
+    TriTree::Settings settings;
+    settings.hierarchy = hierarchy;
+    settings.algorithm = algorithm;
+    settings.parallelBuildThreshold = parallelBuildThreshold;
+    const String name = String(TriTree::hierarchyName(hierarchy)) + " " + TriTree::algorithmName(algorithm);
+
+    TriTree tree;
+    tree.setContents(triArray, vertexArray, settings);
+    testAssert(tree.size() == triArray.size());
+    testAssert(tree.hierarchy() == hierarchy);
+
+    Array<Ray> rayArray;
+    makeRays(24, 2000, rayArray);
+
+    for (int r = 0; r < rayArray.size(); ++r) {
+        const Ray& ray = rayArray[r];
+        for (int twoSided = 0; twoSided < 2; ++twoSided) {
+            const float expected = bruteForceDistance(ray, triArray, vertexArray, twoSided == 1);
+
+            Tri::Intersector intersector;
+            intersector.alphaTest = false;
+            float distance = finf();
+            const bool hit = tree.intersectRay(ray, intersector, distance, false, twoSided == 1);
+
+            testAssertM(hit == (expected < finf()),
+                        format("%s: ray %d hit mismatch", name.c_str(), r));
+            if (hit) {
+                testAssertM(fuzzyEq(distance, expected),
+                            format("%s: ray %d distance %f, expected %f", name.c_str(), r, distance, expected));
+                testAssert(intersector.primitiveIndex >= 0 && &tree[intersector.primitiveIndex] == intersector.tri);
+            }
+
+            // Any-hit must agree on whether there is a hit at all
+            Tri::Intersector anyIntersector;
+            anyIntersector.alphaTest = false;
+            float anyDistance = finf();
+            testAssert(tree.intersectRay(ray, anyIntersector, anyDistance, true, twoSided == 1) == hit);
+        }
+    }
+}
+
+
+static void testIntersectRays(TriTree::Hierarchy hierarchy) {
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeScene(24, 300, triArray, vertexArray);
+
+    TriTree::Settings settings;
+    settings.hierarchy = hierarchy;
+    settings.algorithm = TriTree::BINNED_SAH;
+    TriTree tree;
+    tree.setContents(triArray, vertexArray, settings);
+
+    Array<Ray> rayArray;
+    makeRays(24, 1000, rayArray);
+    Array<Ray> primaryArray;
+    makePrimaryRays(24, 40, 25, primaryArray);
+    rayArray.append(primaryArray);
+
+    Array<float> maxDistanceArray;
+    Random rnd(17, false);
+    for (int r = 0; r < rayArray.size(); ++r) {
+        maxDistanceArray.append(rnd.uniform(0.0f, 30.0f));
+    }
+
+    for (TriTree::IntersectRayOptions options = 0; options < 16; ++options) {
+        if ((options & TriTree::NO_PARTIAL_COVERAGE_TEST) == 0) {
+            // Every material is opaque in this scene, so coverage does not matter
+            continue;
+        }
+        const bool anyHit   = (options & TriTree::OCCLUSION_TEST_ONLY) != 0;
+        const bool twoSided = (options & TriTree::DO_NOT_CULL_BACKFACES) != 0;
+
+        for (int limited = 0; limited < 2; ++limited) {
+            Array<TriTree::Hit> hitArray;
+            tree.intersectRays(rayArray, hitArray, options, (limited == 1) ? maxDistanceArray : Array<float>());
+            testAssert(hitArray.size() == rayArray.size());
+
+            for (int r = 0; r < rayArray.size(); ++r) {
+                Tri::Intersector intersector;
+                intersector.alphaTest = false;
+                float distance = (limited == 1) ? maxDistanceArray[r] : finf();
+                const bool expected = tree.intersectRay(rayArray[r], intersector, distance, anyHit, twoSided);
+
+                const TriTree::Hit& hit = hitArray[r];
+                testAssertM(hit.hit() == expected, format("%s options %d: ray %d hit mismatch", TriTree::hierarchyName(hierarchy), options, r));
+                if (! expected) {
+                    testAssert(hit.distance == finf());
+                } else if (anyHit) {
+                    testAssert(hit.distance <= ((limited == 1) ? maxDistanceArray[r] : finf()));
+                } else {
+                    testAssert(fuzzyEq(hit.distance, distance));
+                    testAssert(&tree[hit.triIndex] == intersector.tri);
+                    testAssert(fuzzyEq(hit.u, intersector.u) && fuzzyEq(hit.v, intersector.v));
+                    testAssert(hit.backside == intersector.backside);
+                }
+            }
+        }
+    }
+
+    Array<TriTree::Hit> hitArray;
+    tree.intersectRays(Array<Ray>(), hitArray);
+    testAssert(hitArray.size() == 0);
+}
+
+
+static void testAxisAlignedRays() {
+    // Rays with zero direction components, including ones that lie exactly in
+    // the planes of the BVH4 boxes
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeScene(8, 0, triArray, vertexArray);
+
+    TriTree::Settings settings;
+    settings.hierarchy = TriTree::BVH4;
+    TriTree tree;
+    tree.setContents(triArray, vertexArray, settings);
+
+    for (int x = 0; x <= 8; ++x) {
+        for (int z = 0; z <= 8; ++z) {
+            const Ray ray = Ray::fromOriginAndDirection(Point3(x + 0.25f, 10.0f, float(z)), -Vector3::unitY());
+            const float expected = bruteForceDistance(ray, triArray, vertexArray, false);
+            float distance = finf();
+            Tri::Intersector intersector;
+            intersector.alphaTest = false;
+            testAssert(tree.intersectRay(ray, intersector, distance) == (expected < finf()));
+            testAssert(distance == expected);
+        }
+    }
+}
+
+
+/** True if both arrays contain the same triangles, in any order */
+static bool sameTris(const Array<Tri>& a, const Array<Tri>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+
+    Array<Vector3int32> key[2];
+    for (int i = 0; i < 2; ++i) {
+        const Array<Tri>& triArray = (i == 0) ? a : b;
+        for (int t = 0; t < triArray.size(); ++t) {
+            key[i].append(Vector3int32(triArray[t].index[0], triArray[t].index[1], triArray[t].index[2]));
+        }
+        key[i].sort([](const Vector3int32& u, const Vector3int32& v) {
+            return (u.x < v.x) || ((u.x == v.x) && ((u.y < v.y) || ((u.y == v.y) && (u.z < v.z))));
+        });
+    }
+
+    for (int t = 0; t < a.size(); ++t) {
+        if (key[0][t] != key[1][t]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/** True if both arrays contain the same elements in the same order */
+static bool sameIndices(const Array<int>& a, const Array<int>& b) {
+    return (a.size() == b.size()) && ((a.size() == 0) || (memcmp(a.getCArray(), b.getCArray(), sizeof(int) * a.size()) == 0));
+}
+
+
+static void testVolumeQueries() {
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeScene(24, 300, triArray, vertexArray);
+
+    TriTree::Settings settings;
+    TriTree bih;
+    bih.setContents(triArray, vertexArray, settings);
+
+    settings.hierarchy = TriTree::BVH4;
+    TriTree bvh;
+    bvh.setContents(triArray, vertexArray, settings);
+
+    Random rnd(91, false);
+    for (int q = 0; q < 50; ++q) {
+        const Point3 center(rnd.uniform(0.0f, 24.0f), rnd.uniform(-2.0f, 10.0f), rnd.uniform(0.0f, 24.0f));
+        const Vector3 extent = Vector3(rnd.uniform(0.1f, 3.0f), rnd.uniform(0.1f, 3.0f), rnd.uniform(0.1f, 3.0f));
+
+        Array<Tri> a, b;
+        bih.intersectBox(AABox(center - extent, center + extent), a);
+        bvh.intersectBox(AABox(center - extent, center + extent), b);
+        testAssert(sameTris(a, b));
+
+        a.fastClear(); b.fastClear();
+        bih.intersectSphere(Sphere(center, extent.x), a);
+        bvh.intersectSphere(Sphere(center, extent.x), b);
+        testAssert(sameTris(a, b));
+    }
+
+    // Index queries report each intersecting triangle exactly once
+    Array<AABox> boxArray;
+    Array<Sphere> sphereArray;
+    for (int q = 0; q < 100; ++q) {
+        const Point3 center(rnd.uniform(0.0f, 24.0f), rnd.uniform(-2.0f, 10.0f), rnd.uniform(0.0f, 24.0f));
+        const Vector3 extent = Vector3(rnd.uniform(0.1f, 3.0f), rnd.uniform(0.1f, 3.0f), rnd.uniform(0.1f, 3.0f));
+        boxArray.append(AABox(center - extent, center + extent));
+        sphereArray.append(Sphere(center, extent.x));
+    }
+
+    for (int h = 0; h < 2; ++h) {
+        const TriTree& tree = (h == 0) ? bih : bvh;
+
+        Array<Array<int> > boxResults, sphereResults;
+        tree.intersectBoxes(boxArray, boxResults);
+        tree.intersectSpheres(sphereArray, sphereResults);
+        testAssert((boxResults.size() == boxArray.size()) && (sphereResults.size() == sphereArray.size()));
+
+        for (int q = 0; q < boxArray.size(); ++q) {
+            Array<int> boxIndex, sphereIndex;
+            tree.intersectBox(boxArray[q], boxIndex);
+            tree.intersectSphere(sphereArray[q], sphereIndex);
+
+            Array<int> expectedBox, expectedSphere;
+            for (int t = 0; t < triArray.size(); ++t) {
+                const Triangle& triangle = triArray[t].toTriangle(vertexArray);
+                if (triArray[t].area() > 0) {
+                    if (CollisionDetection::fixedSolidBoxIntersectsFixedTriangle(boxArray[q], triangle)) {
+                        expectedBox.append(t);
+                    }
+                    if (CollisionDetection::fixedSolidSphereIntersectsFixedTriangle(sphereArray[q], triangle)) {
+                        expectedSphere.append(t);
+                    }
+                }
+            }
+
+            // The batched results are in the same order as the single queries
+            testAssert(sameIndices(boxResults[q], boxIndex));
+            testAssert(sameIndices(sphereResults[q], sphereIndex));
+
+            boxIndex.sort();
+            sphereIndex.sort();
+            testAssert(sameIndices(boxIndex, expectedBox));
+            testAssert(sameIndices(sphereIndex, expectedSphere));
+
+            Array<Tri> boxTris;
+            tree.intersectBox(boxArray[q], boxTris);
+            testAssert(boxTris.size() == expectedBox.size());
+        }
+    }
+}
+
+
+static void testDeterministicBuild() {
+    // A parallel build must produce exactly the same tree as a serial one
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeScene(64, 2000, triArray, vertexArray);
+
+    TriTree::Settings settings;
+    settings.algorithm = TriTree::BINNED_SAH;
+
+    settings.parallelBuildThreshold = std::numeric_limits<int>::max();
+    TriTree serialTree;
+    serialTree.setContents(triArray, vertexArray, settings);
+
+    settings.parallelBuildThreshold = 1;
+    TriTree parallelTree;
+    parallelTree.setContents(triArray, vertexArray, settings);
+
+    const TriTree::Stats a = serialTree.stats(settings.valuesPerLeaf);
+    const TriTree::Stats b = parallelTree.stats(settings.valuesPerLeaf);
+    testAssert(a.numNodes  == b.numNodes);
+    testAssert(a.numLeaves == b.numLeaves);
+    testAssert(a.numTris   == b.numTris);
+    testAssert(a.depth     == b.depth);
+}
+
+
+/** Moves the vertices of the triangle soup created by makeScene. Small
+    \a scale jitters them in place; large \a scale scatters them. */
+static void moveSoup(int gridSize, float scale, Random& rnd, CPUVertexArray& vertexArray) {
+    const int numGridVertices = square(gridSize + 1);
+    Array<CPUVertexArray::Vertex>& vertex = vertexArray.vertex;
+    for (int i = numGridVertices; i < vertex.size(); ++i) {
+        vertex[i].position += Vector3::random(rnd) * rnd.uniform(0.0f, scale);
+    }
+}
+
+
+/** Teleports \a count soup triangles starting at soup triangle \a first
+    to random locations without changing their shape */
+static void teleportSoup(int gridSize, int first, int count, Random& rnd, CPUVertexArray& vertexArray) {
+    const int numGridVertices = square(gridSize + 1);
+    Array<CPUVertexArray::Vertex>& vertex = vertexArray.vertex;
+    for (int t = first; t < first + count; ++t) {
+        const Vector3 offset(rnd.uniform(-1.0f, 1.0f) * gridSize, 0.0f, rnd.uniform(-1.0f, 1.0f) * gridSize);
+        for (int j = 0; j < 3; ++j) {
+            vertex[numGridVertices + t * 3 + j].position += offset;
+        }
+    }
+}
+
+
+/** Verifies closest-hit queries on a refit tree against brute force
+    over the triangles and vertices that the tree now contains */
+static void checkRefit(const TriTree& tree, const CPUVertexArray& vertexArray, const Array<Ray>& rayArray, const char* name) {
+    Array<Tri> triArray;
+    for (int t = 0; t < tree.size(); ++t) {
+        triArray.append(tree[t]);
+    }
+
+    for (int r = 0; r < rayArray.size(); ++r) {
+        const float expected = bruteForceDistance(rayArray[r], triArray, vertexArray, false);
+        Tri::Intersector intersector;
+        intersector.alphaTest = false;
+        float distance = finf();
+        const bool hit = tree.intersectRay(rayArray[r], intersector, distance);
+        testAssertM(hit == (expected < finf()), format("%s: ray %d hit mismatch after refit", name, r));
+        if (hit) {
+            testAssertM(fuzzyEq(distance, expected), format("%s: ray %d distance %f, expected %f", name, r, distance, expected));
+        }
+    }
+}
+
+
+static void testRefit(TriTree::Hierarchy hierarchy) {
+    const int gridSize = 24;
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeScene(gridSize, 300, triArray, vertexArray);
+
+    Array<Ray> rayArray;
+    makeRays(gridSize, 1000, rayArray);
+
+    TriTree::Settings settings;
+    settings.hierarchy = hierarchy;
+    settings.algorithm = TriTree::BINNED_SAH;
+    TriTree tree;
+    tree.setContents(triArray, vertexArray, settings);
+    const char* name = TriTree::hierarchyName(hierarchy);
+
+    Random rnd(99, false);
+    moveSoup(gridSize, 0.01f, rnd, vertexArray);
+    const int numJitterRebuilt = tree.refit(vertexArray);
+    if (hierarchy == TriTree::BVH4) {
+        // Jitter barely changes the bounds, so the hierarchy is still good
+        testAssert(numJitterRebuilt == 0);
+    }
+    checkRefit(tree, vertexArray, rayArray, name);
+
+    // Moving a few triangles far away degrades the subtrees that contain them
+    for (int i = 0; i < 8; ++i) {
+        teleportSoup(gridSize, i * 4, 4, rnd, vertexArray);
+        const int numRebuilt = tree.refit(vertexArray);
+        testAssert(numRebuilt > 0);
+        checkRefit(tree, vertexArray, rayArray, name);
+    }
+
+    // Scattering everything degrades the root
+    moveSoup(gridSize, 8.0f, rnd, vertexArray);
+    testAssert(tree.refit(vertexArray) > 0);
+    checkRefit(tree, vertexArray, rayArray, name);
+
+    // Bounds-only refit remains correct no matter how much the geometry moves
+    settings.refitRebuildThreshold = finf();
+    tree.setContents(triArray, vertexArray, settings);
+    moveSoup(gridSize, 8.0f, rnd, vertexArray);
+    if (hierarchy == TriTree::BVH4) {
+        testAssert(tree.refit(vertexArray) == 0);
+    } else {
+        tree.refit(vertexArray);
+    }
+    checkRefit(tree, vertexArray, rayArray, name);
+}
+
+
+void testTriTree() {
+    printf("TriTree ");
+
+    const int defaultThreshold = TriTree::Settings().parallelBuildThreshold;
+    for (int a = TriTree::MEAN_EXTENT; a <= TriTree::BINNED_SAH; ++a) {
+        testIntersectRay(TriTree::BIH, TriTree::SplitAlgorithm(a), defaultThreshold);
+    }
+    testIntersectRay(TriTree::BIH, TriTree::BINNED_SAH, 1);
+    testIntersectRay(TriTree::BVH4, TriTree::BINNED_SAH, defaultThreshold);
+    testIntersectRay(TriTree::BVH4, TriTree::BINNED_SAH, 1);
+    testAxisAlignedRays();
+    testIntersectRays(TriTree::BIH);
+    testIntersectRays(TriTree::BVH4);
+    testVolumeQueries();
+    testDeterministicBuild();
+    testRefit(TriTree::BIH);
+    testRefit(TriTree::BVH4);
+
+    printf("passed\n");
+}
+
+
+static void perfIntersectRays(const Array<Tri>& triArray, const CPUVertexArray& vertexArray, int gridSize) {
+    Array<Ray> primaryArray;
+    makePrimaryRays(gridSize, 512, 512, primaryArray);
+
+    Array<Ray> randomArray;
+    makeRays(gridSize, 200000, randomArray);
+
+    printf("  %-33s %12s %12s %12s\n", "Batch tracing (Mrays/s)", "intersectRay", "intersectRays", "coherent");
+    for (int h = TriTree::BIH; h <= TriTree::BVH4; ++h) {
+        TriTree::Settings settings;
+        settings.hierarchy = TriTree::Hierarchy(h);
+        settings.algorithm = TriTree::BINNED_SAH;
+        TriTree tree;
+        tree.setContents(triArray, vertexArray, settings);
+
+        for (int test = 0; test < 3; ++test) {
+            const Array<Ray>& rayArray = (test == 0) ? primaryArray : randomArray;
+            const TriTree::IntersectRayOptions options = (test == 2) ? TriTree::OCCLUSION_TEST_ONLY : 0;
+            const char* testName[] = {"primary", "random", "random any-hit"};
+            Stopwatch sw;
+
+            // One ray at a time on one thread
+            sw.tick();
+            for (int r = 0; r < rayArray.size(); ++r) {
+                Tri::Intersector intersector;
+                float distance = finf();
+                tree.intersectRay(rayArray[r], intersector, distance, options == TriTree::OCCLUSION_TEST_ONLY);
+            }
+            sw.tock();
+            const float single = float(rayArray.size() / sw.elapsedTime() / 1e6);
+
+            Array<TriTree::Hit> hitArray;
+            sw.tick();
+            tree.intersectRays(rayArray, hitArray, options);
+            sw.tock();
+            const float batch = float(rayArray.size() / sw.elapsedTime() / 1e6);
+
+            sw.tick();
+            tree.intersectRays(rayArray, hitArray, options | TriTree::COHERENT_RAY_HINT);
+            sw.tock();
+            const float coherent = float(rayArray.size() / sw.elapsedTime() / 1e6);
+
+            printf("  %-33s %12.2f %12.2f %12.2f\n",
+                   (String(TriTree::hierarchyName(settings.hierarchy)) + " " + testName[test]).c_str(), single, batch, coherent);
+        }
+    }
+    printf("\n");
+}
+
+
+/** Collision queries for many characters moving over the scene */
+static void perfVolumeQueries(const Array<Tri>& triArray, const CPUVertexArray& vertexArray, int gridSize) {
+    Random rnd(47, false);
+    Array<Sphere> sphereArray;
+    Array<AABox> boxArray;
+    for (int i = 0; i < 20000; ++i) {
+        const Point3 center(rnd.uniform(0.0f, float(gridSize)), rnd.uniform(0.0f, 3.0f), rnd.uniform(0.0f, float(gridSize)));
+        sphereArray.append(Sphere(center, rnd.uniform(0.5f, 2.0f)));
+        boxArray.append(AABox(center - Vector3(0.5f, 1.0f, 0.5f), center + Vector3(0.5f, 1.0f, 0.5f)));
+    }
+
+    printf("  %-33s %12s %12s %12s\n", "Volume queries (us/query)", "Array<Tri>", "indices", "batched");
+    for (int h = TriTree::BIH; h <= TriTree::BVH4; ++h) {
+        TriTree::Settings settings;
+        settings.hierarchy = TriTree::Hierarchy(h);
+        settings.algorithm = TriTree::BINNED_SAH;
+        TriTree tree;
+        tree.setContents(triArray, vertexArray, settings);
+
+        for (int shape = 0; shape < 2; ++shape) {
+            const int n = sphereArray.size();
+            Stopwatch sw;
+
+            Array<Tri> tris;
+            sw.tick();
+            for (int i = 0; i < n; ++i) {
+                tris.fastClear();
+                if (shape == 0) {
+                    tree.intersectSphere(sphereArray[i], tris);
+                } else {
+                    tree.intersectBox(boxArray[i], tris);
+                }
+            }
+            sw.tock();
+            const RealTime copyTime = sw.elapsedTime();
+
+            Array<int> indices;
+            sw.tick();
+            for (int i = 0; i < n; ++i) {
+                indices.fastClear();
+                if (shape == 0) {
+                    tree.intersectSphere(sphereArray[i], indices);
+                } else {
+                    tree.intersectBox(boxArray[i], indices);
+                }
+            }
+            sw.tock();
+            const RealTime indexTime = sw.elapsedTime();
+
+            Array<Array<int> > results;
+            sw.tick();
+            if (shape == 0) {
+                tree.intersectSpheres(sphereArray, results);
+            } else {
+                tree.intersectBoxes(boxArray, results);
+            }
+            sw.tock();
+            const RealTime batchTime = sw.elapsedTime();
+
+            printf("  %-33s %12.2f %12.2f %12.2f\n",
+                   (String(TriTree::hierarchyName(settings.hierarchy)) + ((shape == 0) ? " sphere" : " box")).c_str(),
+                   copyTime * 1e6 / n, indexTime * 1e6 / n, batchTime * 1e6 / n);
+        }
+    }
+    printf("\n");
+}
+
+
+static void perfRefit(const Array<Tri>& triArray, const CPUVertexArray& originalVertexArray, int gridSize) {
+    Array<Ray> rayArray;
+    makeRays(gridSize, 100000, rayArray);
+
+    CPUVertexArray vertexArray;
+    vertexArray.copyFrom(originalVertexArray);
+
+    TriTree::Settings settings;
+    settings.hierarchy = TriTree::BVH4;
+    settings.algorithm = TriTree::BINNED_SAH;
+    TriTree tree;
+    tree.setContents(triArray, vertexArray, settings);
+
+    printf("  %-33s %9s %9s %9s\n", "BVH4 animation (soup motion)", "Update(ms)", "Rebuilt", "Trace(ms)");
+    Random rnd(31, false);
+    const float motion[] = {0.05f, 0.5f, 4.0f};
+    for (int m = 0; m < 3; ++m) {
+        moveSoup(gridSize, motion[m], rnd, vertexArray);
+        for (int rebuild = 0; rebuild < 2; ++rebuild) {
+            Stopwatch sw;
+            sw.tick();
+            int numRebuilt = 1;
+            if (rebuild == 1) {
+                tree.setContents(triArray, vertexArray, settings);
+            } else {
+                numRebuilt = tree.refit(vertexArray);
+            }
+            sw.tock();
+            const RealTime updateTime = sw.elapsedTime();
+
+            sw.tick();
+            for (int r = 0; r < rayArray.size(); ++r) {
+                Tri::Intersector intersector;
+                float distance = finf();
+                tree.intersectRay(rayArray[r], intersector, distance);
+            }
+            sw.tock();
+
+            printf("  %-33s %9.1f %9d %9.1f\n", format("%s, motion %.2f", (rebuild == 1) ? "setContents" : "refit", motion[m]).c_str(),
+                   updateTime / units::milliseconds(), numRebuilt, sw.elapsedTime() / units::milliseconds());
+        }
+    }
+    printf("\n");
+}
+
+
+void perfTriTree() {
+    printf("TriTree:\n");
+
+    Array<Tri> triArray;
+    CPUVertexArray vertexArray;
+    makeScene(256, 50000, triArray, vertexArray);
+    printf("  %d triangles\n", triArray.size());
+
+    Array<Ray> rayArray;
+    makeRays(256, 100000, rayArray);
+
+    printf("  %-33s %9s %9s %7s %7s %6s %9s\n", "Structure", "Build(ms)", "Nodes", "Leaves", "Tris/lf", "Depth", "Trace(ms)");
+
+    // The final two rows are the BVH4 built in parallel and serially
+    for (int a = TriTree::MEAN_EXTENT; a <= TriTree::BINNED_SAH + 3; ++a) {
+        TriTree::Settings settings;
+        settings.algorithm = TriTree::SplitAlgorithm(min(a, int(TriTree::BINNED_SAH)));
+        if (a > TriTree::BINNED_SAH + 1) {
+            settings.hierarchy = TriTree::BVH4;
+        }
+        String name = String(TriTree::hierarchyName(settings.hierarchy)) + " " + TriTree::algorithmName(settings.algorithm);
+        if ((a == TriTree::BINNED_SAH + 1) || (a == TriTree::BINNED_SAH + 3)) {
+            // Same structure on the calling thread only, to show the parallel speedup
+            settings.parallelBuildThreshold = std::numeric_limits<int>::max();
+            name += " (serial)";
+        }
+
+        TriTree tree;
+        Stopwatch sw;
+        sw.tick();
+        tree.setContents(triArray, vertexArray, settings);
+        sw.tock();
+        const RealTime buildTime = sw.elapsedTime();
+
+        sw.tick();
+        int numHits = 0;
+        for (int r = 0; r < rayArray.size(); ++r) {
+            Tri::Intersector intersector;
+            float distance = finf();
+            if (tree.intersectRay(rayArray[r], intersector, distance)) {
+                ++numHits;
+            }
+        }
+        sw.tock();
+
+        const TriTree::Stats s = tree.stats(settings.valuesPerLeaf);
+        printf("  %-33s %9.1f %9d %7d %7.1f %6d %9.1f\n", name.c_str(), buildTime / units::milliseconds(),
+               s.numNodes, s.numLeaves, s.averageValuesPerLeaf, s.depth, sw.elapsedTime() / units::milliseconds());
+    }
+    printf("\n");
+
+    perfRefit(triArray, vertexArray, 256);
+    perfIntersectRays(triArray, vertexArray, 256);
+    perfVolumeQueries(triArray, vertexArray, 256);
+}
@@ -0,0 +1,195 @@
+#include "G3D/G3DAll.h"
+#include "testassert.h"
+
+namespace {
+
+/** Macros and uniforms like those that a typical material sets on every draw call */
+void setupDrawArgs(Args& args, int variant) {
+    args.setMacro("HAS_NORMAL_BUMP_MAP", (variant & 1) != 0);
+    args.setMacro("HAS_ALPHA", (variant & 2) != 0);
+    args.setMacro("HAS_EMISSIVE", (variant & 4) != 0);
+    args.setMacro("NUM_LIGHTS", variant >> 3);
+    args.setMacro("HAS_VERTEX_COLOR", 0);
+    args.setMacro("NUM_BONES", 0);
+    args.setMacro("INFER_AMBIENT_OCCLUSION_AT_TRANSPARENT_PIXELS", 1);
+    args.setMacro("UNBLENDED_PASS", 1);
+
+    args.setUniform("lambertianConstant", Color4(0.5f, 0.5f, 0.5f, 1.0f));
+    args.setUniform("glossyConstant", Color4(0.04f, 0.04f, 0.04f, 0.3f));
+    args.setUniform("emissiveConstant", Color3(0.0f));
+    args.setUniform("alphaThreshold", 0.5f);
+    args.setUniform("bumpMapScale", 0.05f);
+    args.setUniform("bumpMapBias", 0.0f);
+    args.setUniform("objectToWorldMatrix", CFrame::fromXYZYPRDegrees(1, 2, 3, 10, 20, 30));
+    args.setUniform("previousObjectToWorldMatrix", CFrame::fromXYZYPRDegrees(1, 2, 3, 10, 20, 30));
+}
+
+}
+
+
+static void testVariantHash() {
+    UniformTable a, b;
+    testAssert(a.variantHash() == b.variantHash());
+    testAssert(a.sameVariant(b));
+
+    // Order independence
+    a.setMacro("X", 1);
+    a.setMacro("Y", 2);
+    b.setMacro("Y", 2);
+    b.setMacro("X", 1);
+    testAssert(a.variantHash() == b.variantHash());
+    testAssert(a.sameVariant(b));
+    testAssert(a.preambleAndMacroString() == b.preambleAndMacroString());
+
+    // Changing a value and changing it back restores the hash
+    const uint64 original = a.variantHash();
+    a.setMacro("X", 3);
+    testAssert(a.variantHash() != original);
+    testAssert(! a.sameVariant(b));
+    a.setMacro("X", 1);
+    testAssert(a.variantHash() == original);
+    testAssert(a.sameVariant(b));
+
+    // Swapping values between names changes the variant
+    UniformTable c;
+    c.setMacro("X", 2);
+    c.setMacro("Y", 1);
+    testAssert(c.variantHash() != a.variantHash());
+    testAssert(! c.sameVariant(a));
+
+    // Preamble
+    a.setPreamble("#extension GL_ARB_foo : enable\n");
+    testAssert(! a.sameVariant(b));
+    b.appendToPreamble("#extension GL_ARB_foo");
+    b.appendToPreamble(" : enable\n");
+    testAssert(a.variantHash() == b.variantHash());
+    testAssert(a.sameVariant(b));
+
+    // Copies and appended tables match
+    const UniformTable d(a);
+    testAssert(d.sameVariant(a));
+    UniformTable e;
+    e.append(a);
+    testAssert(e.sameVariant(a));
+}
+
+
+static void testVariantTable() {
+    ShaderVariantTable<int> table;
+
+    Array<shared_ptr<Args> > argsArray;
+    for (int v = 0; v < 32; ++v) {
+        argsArray.append(shared_ptr<Args>(new Args()));
+        setupDrawArgs(*argsArray.last(), v);
+        testAssert(isNull(table.getPointer(*argsArray.last())));
+        table.set(*argsArray.last(), v);
+    }
+    testAssert(table.size() == 32);
+
+    for (int v = 0; v < 32; ++v) {
+        // A freshly built Args with the same macros finds the same entry
+        Args args;
+        setupDrawArgs(args, v);
+        args.setUniform("alphaThreshold", 0.25f);
+        const int* value = table.getPointer(args);
+        testAssert(notNull(value) && (*value == v));
+    }
+
+    // Overwrite
+    table.set(*argsArray[3], 100);
+    testAssert(table.size() == 32);
+    testAssert(*table.getPointer(*argsArray[3]) == 100);
+
+    // Differs only in the preamble
+    Args args;
+    setupDrawArgs(args, 0);
+    args.setPreamble("#define EXTRA 1\n");
+    testAssert(isNull(table.getPointer(args)));
+
+    table.clear();
+    testAssert(table.size() == 0);
+    testAssert(isNull(table.getPointer(*argsArray[0])));
+}
+
+
+void testUniformTable() {
+    printf("UniformTable ");
+    testVariantHash();
+    testVariantTable();
+    printf("passed\n");
+}
+
+
+void perfUniformTable() {
+    printf("UniformTable shader variant lookup (CPU only):\n");
+
+    const int numVariants = 16;
+    const int numDraws = 20000;
+
+    // Previous scheme: key by the full preamble and macro string
+    Table<String, int> stringCache;
+    ShaderVariantTable<int> variantCache;
+    for (int v = 0; v < numVariants; ++v) {
+        Args args;
+        setupDrawArgs(args, v);
+        stringCache.set(args.preambleAndMacroString(), v);
+        variantCache.set(args, v);
+    }
+
+    Stopwatch sw;
+    int check = 0;
+
+    sw.tick();
+    for (int i = 0; i < numDraws; ++i) {
+        Args args;
+        setupDrawArgs(args, i % numVariants);
+    }
+    sw.tock();
+    const RealTime setupTime = sw.elapsedTime() / numDraws;
+
+    sw.tick();
+    for (int i = 0; i < numDraws; ++i) {
+        Args args;
+        setupDrawArgs(args, i % numVariants);
+        check += *stringCache.getPointer(args.preambleAndMacroString());
+    }
+    sw.tock();
+    const RealTime stringTime = sw.elapsedTime() / numDraws;
+
+    sw.tick();
+    for (int i = 0; i < numDraws; ++i) {
+        Args args;
+        setupDrawArgs(args, i % numVariants);
+        check -= *variantCache.getPointer(args);
+    }
+    sw.tock();
+    const RealTime hashTime = sw.elapsedTime() / numDraws;
+    testAssert(check == 0);
+
+    // Lookup alone, with the Args already built
+    Array<shared_ptr<Args> > argsArray;
+    for (int v = 0; v < numVariants; ++v) {
+        argsArray.append(shared_ptr<Args>(new Args()));
+        setupDrawArgs(*argsArray.last(), v);
+    }
+
+    sw.tick();
+    for (int i = 0; i < numDraws; ++i) {
+        check += *stringCache.getPointer(argsArray[i % numVariants]->preambleAndMacroString());
+    }
+    sw.tock();
+    const RealTime stringLookupTime = sw.elapsedTime() / numDraws;
+
+    sw.tick();
+    for (int i = 0; i < numDraws; ++i) {
+        check -= *variantCache.getPointer(*argsArray[i % numVariants]);
+    }
+    sw.tock();
+    const RealTime hashLookupTime = sw.elapsedTime() / numDraws;
+    testAssert(check == 0);
+
+    printf("  %-24s %14s %14s\n", "", "Setup+lookup", "Lookup only");
+    printf("  %-24s %11.3f us\n", "Args setup", setupTime * 1e6);
+    printf("  %-24s %11.3f us %11.3f us\n", "String-keyed cache", stringTime * 1e6, stringLookupTime * 1e6);
+    printf("  %-24s %11.3f us %11.3f us\n\n", "Variant hash cache", hashTime * 1e6, hashLookupTime * 1e6);
+}